@@ -1045,19 +1045,10 @@ unsigned32              *st;
     }
 
     /*
-     * A connection is now set up. Tell the receiver thread to begin
+     * A connection is now set up. Tell the receiver to begin
      * receiving on the connection.
      */
-    if (assoc->cn_ctlblk.cn_rcvr_waiters)
-    {
-        RPC_COND_SIGNAL (assoc->cn_ctlblk.cn_rcvr_cond,
-                         rpc_g_global_mutex);
-    }
-    else
-    {
-        RPC_DBG_PRINTF (rpc_e_dbg_threads, RPC_C_CN_DBG_THREADS,
-	    ( "####### assoc->%x We're not signalling here\n", assoc ));
-    }
+    rpc__cn_network_receiver_start (assoc);
     *st = rpc_s_ok;
     RPC_LOG_CN_ASSOC_LIS_XIT;
     return (assoc);
@@ -4749,7 +4740,7 @@ rpc_cn_assoc_p_t   assoc;
 **  This routine will initialize an association control block
 **  which is allocated from heap by rpc__list_element_alloc. It
 **  will create the mutexes and condition variables as well as
-**  create the receiver thread.
+**  create the receiver thread (unless the event receiver is in use).
 **
 **  INPUTS:
 **
@@ -4791,17 +4782,7 @@ rpc_cn_assoc_p_t        assoc;
     /*
      * Create the receiver thread.
      */
-    RPC_DBG_PRINTF (rpc_e_dbg_threads, RPC_C_CN_DBG_THREADS,
-        ( "####### assoc->%x Created receiver thread\n", assoc ));
-
-    DCETHREAD_TRY {
-    dcethread_create_throw (&(assoc->cn_ctlblk.cn_rcvr_thread_id),
-                    &rpc_g_default_dcethread_attr,
-                    (dcethread_startroutine) rpc__cn_network_receiver,
-                    (dcethread_addr) assoc);
-    } DCETHREAD_CATCH_ALL(THIS_CATCH) {
-        DCETHREAD_RERAISE;
-    } DCETHREAD_ENDTRY
+    rpc__cn_network_receiver_create (assoc);
 
     RPC_LOG_CN_ASSOC_ACB_CR_XIT;
 }
@@ -4866,19 +4847,21 @@ rpc_cn_assoc_p_t        assoc;
      */
     ccb = &assoc->cn_ctlblk;
 
-#ifdef notdef
-    if (ccb->cn_rcvr_thread_id == (dcethread*) NULL)
-    {
-        RPC_LOG_CN_ASSOC_ACB_FR_XIT;
-        return;
-    }
-#endif
-
     /*
      * Determine whether we are now running in the receiver thread.
      */
     current_thread_id = dcethread_self();
-    if (dcethread_equal (current_thread_id, ccb->cn_rcvr_thread_id) )
+    if (ccb->cn_rcvr_thread_id == (dcethread*) NULL)
+    {
+        /*
+         * There is no receiver thread; connections on this
+         * association have been serviced by the event receiver, which
+         * lets go of the association before deallocating it.
+         */
+        RPC_COND_DELETE (ccb->cn_rcvr_cond, rpc_g_global_mutex);
+        RPC_COND_DELETE (assoc->assoc_msg_cond, rpc_g_global_mutex);
+    }
+    else if (dcethread_equal (current_thread_id, ccb->cn_rcvr_thread_id) )
     {
         /*
          * We are the receiver thread.
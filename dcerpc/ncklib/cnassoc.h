@@ -135,6 +135,18 @@ error "***Make sure memcmp works on this version of UUIDs***"
 
 #define RPC_CN_ASSOC_WAKEUP(assoc)          rpc__cn_assoc_queue_dummy_frag(assoc);
 
+/*
+ * R P C _ C N _ A S S O C _ I N _ R C V R
+ *
+ * True if the given thread is receiving on the association, either
+ * as its dedicated receiver thread or as the event receiver work
+ * thread currently dispatching its packets.
+ */
+
+#define RPC_CN_ASSOC_IN_RCVR(assoc, thread_id)\
+    (dcethread_equal ((thread_id), (assoc)->cn_ctlblk.cn_rcvr_thread_id) ||\
+     dcethread_equal ((thread_id), (assoc)->cn_ctlblk.cn_rcvr_evt_thread_id))
+
 /*
  * R P C _ C N _ A S S O C _ C A N C E L _ A N D _ W A K E U P
  */
@@ -1979,8 +1979,7 @@ pointer_t       sm;
      * Wake up any threads blocked waiting for receive data.
      */
     current_thread_id = dcethread_self();
-    if (dcethread_equal (current_thread_id,
-                       assoc->cn_ctlblk.cn_rcvr_thread_id))
+    if (RPC_CN_ASSOC_IN_RCVR (assoc, current_thread_id))
     {
         RPC_CN_ASSOC_WAKEUP (assoc);
     }
@@ -4779,8 +4778,7 @@ rpc_g_cn_assoc_client_events[assoc->assoc_state.cur_event-RPC_C_CN_STATEBASE],
      * Wake up any threads blocked waiting for receive data.
      */
     current_thread_id = dcethread_self();
-    if (dcethread_equal (current_thread_id,
-                       assoc->cn_ctlblk.cn_rcvr_thread_id))
+    if (RPC_CN_ASSOC_IN_RCVR (assoc, current_thread_id))
     {
         RPC_CN_ASSOC_WAKEUP (assoc);
     }
@@ -45,7 +45,477 @@
 
 GLOBAL unsigned32 rpc_g_cn_large_frag_size = RPC_C_CN_LARGE_FRAG_SIZE;
 
-
+/*
+ * Fragment buffers are kept in size classes: small, large and a few
+ * power of two classes for the oversized fragments received through
+ * rpc__cn_fragbuf_alloc_dyn. Freed buffers go to a cache private to
+ * the freeing thread and, once that is full, to a depot shared by all
+ * threads. Allocations are satisfied from the thread's cache first
+ * and refill it from the depot a batch at a time, so the common case
+ * takes no lock at all and the depot mutex is taken at most once per
+ * batch. Buffers beyond the largest class are not pooled.
+ */
+#define RPC_C_CN_FBUF_CLASS_SMALL       0
+#define RPC_C_CN_FBUF_CLASS_LARGE       1
+#define RPC_C_CN_FBUF_CLASS_DYN         2
+#define RPC_C_CN_FBUF_CLASSES           6
+
+/*
+ * Data size of the first dynamic class (8K); each following dynamic
+ * class doubles it, up to 64K.
+ */
+#define RPC_C_CN_FBUF_DYN_MIN_SHIFT     13
+
+/*
+ * Per-class limits on the number of buffers kept in a thread cache,
+ * the number moved between the depot and a thread cache at once, and
+ * the number kept in the depot.
+ */
+INTERNAL unsigned32 fbuf_thread_max[RPC_C_CN_FBUF_CLASSES] =
+    { 32, 16, 2, 2, 1, 1 };
+INTERNAL unsigned32 fbuf_batch[RPC_C_CN_FBUF_CLASSES] =
+    { 16, 8, 1, 1, 1, 1 };
+INTERNAL unsigned32 fbuf_depot_max[RPC_C_CN_FBUF_CLASSES] =
+    { 256, 128, 8, 8, 4, 4 };
+
+typedef struct
+{
+    rpc_cn_fragbuf_p_t      head[RPC_C_CN_FBUF_CLASSES];
+    unsigned32              count[RPC_C_CN_FBUF_CLASSES];
+} rpc_cn_fbuf_cache_t, *rpc_cn_fbuf_cache_p_t;
+
+INTERNAL rpc_cn_fbuf_cache_t    fbuf_depot;
+INTERNAL rpc_mutex_t            fbuf_depot_mutex;
+INTERNAL dcethread_key          fbuf_cache_key;
+
+/*
+ * Cached buffers are chained through the (otherwise unused) link field.
+ */
+#define FBUF_NEXT(fbp) ((rpc_cn_fragbuf_p_t) (fbp)->link.next)
+
+/*
+ * The data size of a fragment buffer size class.
+ */
+#define FBUF_CLASS_SIZE(class) \
+    (((class) == RPC_C_CN_FBUF_CLASS_SMALL) ? RPC_C_CN_SMALL_FRAG_SIZE : \
+     ((class) == RPC_C_CN_FBUF_CLASS_LARGE) ? rpc_g_cn_large_frag_size : \
+     (1U << (RPC_C_CN_FBUF_DYN_MIN_SHIFT + (class) - RPC_C_CN_FBUF_CLASS_DYN)))
+
+/*
+ * The memory type a fragment buffer of a size class is allocated as.
+ */
+#define FBUF_CLASS_MEM_TYPE(class) \
+    (((class) == RPC_C_CN_FBUF_CLASS_SMALL) ? RPC_C_MEM_CN_SM_FRAGBUF : \
+     ((class) == RPC_C_CN_FBUF_CLASS_LARGE) ? RPC_C_MEM_CN_LG_FRAGBUF : \
+     RPC_C_MEM_CN_PAC_BUF)
+
+INTERNAL void fbuf_cache_destructor _DCE_PROTOTYPE_ ((
+    rpc_cn_fbuf_cache_p_t   /* cache */));
+
+INTERNAL rpc_cn_fbuf_cache_p_t fbuf_thread_cache _DCE_PROTOTYPE_ ((void));
+
+INTERNAL rpc_cn_fragbuf_p_t fbuf_get _DCE_PROTOTYPE_ ((
+    unsigned32              /* class */));
+
+INTERNAL void fbuf_put _DCE_PROTOTYPE_ ((
+    rpc_cn_fragbuf_p_t      /* fbp */,
+    unsigned32              /* class */));
+
+
+/*
+**++
+**
+**  ROUTINE NAME:       rpc__cn_fragbuf_init
+**
+**  SCOPE:              PRIVATE
+**
+**  DESCRIPTION:
+**
+**  Initializes the fragment buffer pools.
+**
+**  INPUTS:             none
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:            none
+**
+**  IMPLICIT INPUTS:    none
+**
+**  IMPLICIT OUTPUTS:   fbuf_depot, fbuf_depot_mutex, fbuf_cache_key
+**
+**  FUNCTION VALUE:     none
+**
+**  SIDE EFFECTS:       none
+**
+**--
+**/
+
+PRIVATE void rpc__cn_fragbuf_init (void)
+{
+    memset (&fbuf_depot, 0, sizeof (fbuf_depot));
+    RPC_MUTEX_INIT (fbuf_depot_mutex);
+    dcethread_keycreate_throw (&fbuf_cache_key,
+        (void (*) _DCE_PROTOTYPE_((pointer_t))) fbuf_cache_destructor);
+}
+
+/*
+**++
+**
+**  ROUTINE NAME:       fbuf_cache_destructor
+**
+**  SCOPE:              INTERNAL - declared locally
+**
+**  DESCRIPTION:
+**
+**  Thread specific data destructor for a thread's fragment buffer
+**  cache. The cached buffers are moved to the depot, or freed if the
+**  depot is full.
+**
+**  INPUTS:
+**
+**      cache           The exiting thread's cache.
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:            none
+**
+**  IMPLICIT INPUTS:    none
+**
+**  IMPLICIT OUTPUTS:   fbuf_depot
+**
+**  FUNCTION VALUE:     none
+**
+**  SIDE EFFECTS:       none
+**
+**--
+**/
+
+INTERNAL void fbuf_cache_destructor
+#ifdef _DCE_PROTO_
+(
+    rpc_cn_fbuf_cache_p_t   cache
+)
+#else
+(cache)
+rpc_cn_fbuf_cache_p_t   cache;
+#endif
+{
+    rpc_cn_fragbuf_p_t  fbp;
+    unsigned32          class;
+
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    for (class = 0; class < RPC_C_CN_FBUF_CLASSES; class++)
+    {
+        RPC_MUTEX_LOCK (fbuf_depot_mutex);
+        while (cache->head[class] != NULL &&
+               fbuf_depot.count[class] < fbuf_depot_max[class])
+        {
+            fbp = cache->head[class];
+            cache->head[class] = FBUF_NEXT (fbp);
+            fbp->link.next = (pointer_t) fbuf_depot.head[class];
+            fbuf_depot.head[class] = fbp;
+            fbuf_depot.count[class]++;
+        }
+        RPC_MUTEX_UNLOCK (fbuf_depot_mutex);
+
+        while (cache->head[class] != NULL)
+        {
+            fbp = cache->head[class];
+            cache->head[class] = FBUF_NEXT (fbp);
+            RPC_MEM_FREE (fbp, FBUF_CLASS_MEM_TYPE (class));
+        }
+    }
+
+    RPC_MEM_FREE (cache, RPC_C_MEM_CN_FBUF_CACHE);
+}
+
+/*
+**++
+**
+**  ROUTINE NAME:       fbuf_thread_cache
+**
+**  SCOPE:              INTERNAL - declared locally
+**
+**  DESCRIPTION:
+**
+**  Returns the calling thread's fragment buffer cache, creating it on
+**  first use.
+**
+**  INPUTS:             none
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:            none
+**
+**  IMPLICIT INPUTS:    fbuf_cache_key
+**
+**  IMPLICIT OUTPUTS:   none
+**
+**  FUNCTION VALUE:     The thread's cache, or NULL if it could not be
+**                      created (callers then use the depot directly).
+**
+**  SIDE EFFECTS:       none
+**
+**--
+**/
+
+INTERNAL rpc_cn_fbuf_cache_p_t fbuf_thread_cache (void)
+{
+    rpc_cn_fbuf_cache_p_t   cache = NULL;
+
+    dcethread_getspecific (fbuf_cache_key, (dcethread_addr *) &cache);
+    if (cache == NULL)
+    {
+        RPC_MEM_ALLOC (cache,
+                       rpc_cn_fbuf_cache_p_t,
+                       sizeof (rpc_cn_fbuf_cache_t),
+                       RPC_C_MEM_CN_FBUF_CACHE,
+                       RPC_C_MEM_NOWAIT);
+        if (cache == NULL)
+        {
+            return (NULL);
+        }
+        memset (cache, 0, sizeof (rpc_cn_fbuf_cache_t));
+        if (dcethread_setspecific (fbuf_cache_key, (dcethread_addr) cache) != 0)
+        {
+            RPC_MEM_FREE (cache, RPC_C_MEM_CN_FBUF_CACHE);
+            return (NULL);
+        }
+    }
+
+    return (cache);
+}
+
+/*
+**++
+**
+**  ROUTINE NAME:       fbuf_get
+**
+**  SCOPE:              INTERNAL - declared locally
+**
+**  DESCRIPTION:
+**
+**  Gets a fragment buffer of the given size class, from the thread's
+**  cache, then the depot, then the heap.
+**
+**  INPUTS:
+**
+**      class           The size class.
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:            none
+**
+**  IMPLICIT INPUTS:    fbuf_depot
+**
+**  IMPLICIT OUTPUTS:   fbuf_depot
+**
+**  FUNCTION VALUE:     The fragment buffer, or NULL if out of memory.
+**                      Its header is zeroed apart from max_data_size.
+**
+**  SIDE EFFECTS:       none
+**
+**--
+**/
+
+INTERNAL rpc_cn_fragbuf_p_t fbuf_get
+#ifdef _DCE_PROTO_
+(
+    unsigned32              class
+)
+#else
+(class)
+unsigned32              class;
+#endif
+{
+    rpc_cn_fbuf_cache_p_t   cache;
+    rpc_cn_fragbuf_p_t      fbp = NULL;
+    unsigned32              n;
+
+    cache = fbuf_thread_cache ();
+
+    if (cache != NULL && cache->head[class] != NULL)
+    {
+        fbp = cache->head[class];
+        cache->head[class] = FBUF_NEXT (fbp);
+        cache->count[class]--;
+    }
+    else if (fbuf_depot.count[class] != 0)
+    {
+        /*
+         * The unlocked look at the depot count is only a hint to avoid
+         * taking the mutex when the depot is empty; it is checked again
+         * under the mutex. Take one buffer for the caller and, if we
+         * have a cache, refill it with up to a batch more.
+         */
+        RPC_MUTEX_LOCK (fbuf_depot_mutex);
+        if (fbuf_depot.head[class] != NULL)
+        {
+            fbp = fbuf_depot.head[class];
+            fbuf_depot.head[class] = FBUF_NEXT (fbp);
+            fbuf_depot.count[class]--;
+
+            for (n = 1;
+                 cache != NULL && n < fbuf_batch[class] &&
+                 fbuf_depot.head[class] != NULL;
+                 n++)
+            {
+                rpc_cn_fragbuf_p_t  next = fbuf_depot.head[class];
+
+                fbuf_depot.head[class] = FBUF_NEXT (next);
+                fbuf_depot.count[class]--;
+                next->link.next = (pointer_t) cache->head[class];
+                cache->head[class] = next;
+                cache->count[class]++;
+            }
+        }
+        RPC_MUTEX_UNLOCK (fbuf_depot_mutex);
+    }
+
+    if (fbp == NULL)
+    {
+        /*
+         * Note that 7 extra bytes are allocated so that we can adjust
+         * the data pointer to be on an 8 byte boundary and still have
+         * the same size data area.
+         */
+        RPC_MEM_ALLOC (fbp,
+                       rpc_cn_fragbuf_p_t,
+                       sizeof (rpc_cn_fragbuf_t) - 1 +
+                       FBUF_CLASS_SIZE (class) + 7,
+                       FBUF_CLASS_MEM_TYPE (class),
+                       RPC_C_MEM_NOWAIT);
+        if (fbp == NULL)
+        {
+            return (NULL);
+        }
+    }
+
+    memset (fbp, 0, sizeof (rpc_cn_fragbuf_t));
+    fbp->max_data_size = FBUF_CLASS_SIZE (class);
+
+    return (fbp);
+}
+
+/*
+**++
+**
+**  ROUTINE NAME:       fbuf_put
+**
+**  SCOPE:              INTERNAL - declared locally
+**
+**  DESCRIPTION:
+**
+**  Returns a fragment buffer to the thread's cache, or, if that is
+**  full, moves a batch of buffers from the cache to the depot. Buffers
+**  which fit in neither are freed.
+**
+**  INPUTS:
+**
+**      fbp             The fragment buffer.
+**
+**      class           Its size class.
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:            none
+**
+**  IMPLICIT INPUTS:    fbuf_depot
+**
+**  IMPLICIT OUTPUTS:   fbuf_depot
+**
+**  FUNCTION VALUE:     none
+**
+**  SIDE EFFECTS:       none
+**
+**--
+**/
+
+INTERNAL void fbuf_put
+#ifdef _DCE_PROTO_
+(
+    rpc_cn_fragbuf_p_t      fbp,
+    unsigned32              class
+)
+#else
+(fbp, class)
+rpc_cn_fragbuf_p_t      fbp;
+unsigned32              class;
+#endif
+{
+    rpc_cn_fbuf_cache_p_t   cache;
+    rpc_cn_fragbuf_p_t      victim;
+    rpc_cn_fragbuf_p_t      spill = NULL;
+    unsigned32              n;
+
+    cache = fbuf_thread_cache ();
+
+    if (cache != NULL && cache->count[class] >= fbuf_thread_max[class])
+    {
+        /*
+         * Spill a batch to the depot to make room. Whatever the depot
+         * has no room for is freed once the depot mutex is dropped.
+         */
+        RPC_MUTEX_LOCK (fbuf_depot_mutex);
+        for (n = 0; n < fbuf_batch[class] && cache->head[class] != NULL; n++)
+        {
+            victim = cache->head[class];
+            cache->head[class] = FBUF_NEXT (victim);
+            cache->count[class]--;
+
+            if (fbuf_depot.count[class] < fbuf_depot_max[class])
+            {
+                victim->link.next = (pointer_t) fbuf_depot.head[class];
+                fbuf_depot.head[class] = victim;
+                fbuf_depot.count[class]++;
+            }
+            else
+            {
+                victim->link.next = (pointer_t) spill;
+                spill = victim;
+            }
+        }
+        RPC_MUTEX_UNLOCK (fbuf_depot_mutex);
+
+        while (spill != NULL)
+        {
+            victim = spill;
+            spill = FBUF_NEXT (victim);
+            RPC_MEM_FREE (victim, FBUF_CLASS_MEM_TYPE (class));
+        }
+    }
+
+    if (cache != NULL)
+    {
+        fbp->link.next = (pointer_t) cache->head[class];
+        cache->head[class] = fbp;
+        cache->count[class]++;
+        return;
+    }
+
+    /*
+     * No thread cache; go straight to the depot.
+     */
+    RPC_MUTEX_LOCK (fbuf_depot_mutex);
+    if (fbuf_depot.count[class] < fbuf_depot_max[class])
+    {
+        fbp->link.next = (pointer_t) fbuf_depot.head[class];
+        fbuf_depot.head[class] = fbp;
+        fbuf_depot.count[class]++;
+        fbp = NULL;
+    }
+    RPC_MUTEX_UNLOCK (fbuf_depot_mutex);
+
+    if (fbp != NULL)
+    {
+        RPC_MEM_FREE (fbp, FBUF_CLASS_MEM_TYPE (class));
+    }
+}
+
 /*
 **++
 **
@@ -66,7 +536,7 @@ GLOBAL unsigned32 rpc_g_cn_large_frag_size = RPC_C_CN_LARGE_FRAG_SIZE;
 **
 **  OUTPUTS:            none
 **
-**  IMPLICIT INPUTS:    lg_fragbuf_list
+**  IMPLICIT INPUTS:    none
 **
 **  IMPLICIT OUTPUTS:   none
 **
@@ -91,10 +561,9 @@ rpc_cn_fragbuf_p_t            buffer_p;
     memset ((char *) buffer_p->data_area, 0, rpc_g_cn_large_frag_size);
     memset ((char *) buffer_p, 0, sizeof (rpc_cn_fragbuf_t));
 #endif
-    rpc__list_element_free (&rpc_g_cn_lg_fbuf_lookaside_list,
-                            (pointer_t) buffer_p);
+    fbuf_put (buffer_p, RPC_C_CN_FBUF_CLASS_LARGE);
 }
-
+
 /*
 **++
 **
@@ -115,7 +584,7 @@ rpc_cn_fragbuf_p_t            buffer_p;
 **
 **  OUTPUTS:            none
 **
-**  IMPLICIT INPUTS:    sm_fragbuf_list
+**  IMPLICIT INPUTS:    none
 **
 **  IMPLICIT OUTPUTS:   none
 **
@@ -140,10 +609,9 @@ rpc_cn_fragbuf_p_t      buffer_p;
     memset ((char *) buffer_p->data_area, 0, RPC_C_CN_SMALL_FRAG_SIZE);
     memset ((char *) buffer_p, 0, sizeof (rpc_cn_fragbuf_t));
 #endif
-    rpc__list_element_free (&rpc_g_cn_sm_fbuf_lookaside_list,
-                            (pointer_t) buffer_p );
+    fbuf_put (buffer_p, RPC_C_CN_FBUF_CLASS_SMALL);
 }
-
+
 /*
 **++
 **
@@ -188,18 +656,15 @@ boolean32               alloc_large_buf;
     rpc_cn_fragbuf_p_t  fbp;
 
     /*
-     * Get a fragment buffer from the appropriate lookaside list
+     * Get a fragment buffer from the appropriate size class.
      */
 
     if (alloc_large_buf)
     {
-	fbp = (rpc_cn_fragbuf_p_t)
-            rpc__list_element_alloc (&rpc_g_cn_lg_fbuf_lookaside_list,
-                                     true);
+        fbp = fbuf_get (RPC_C_CN_FBUF_CLASS_LARGE);
         if (fbp != NULL)
         {
             fbp->fragbuf_dealloc = rpc__cn_fragbuf_free;
-            fbp->max_data_size = rpc_g_cn_large_frag_size;
         }
         else
         {
@@ -208,13 +673,10 @@ boolean32               alloc_large_buf;
     }
     else
     {
-        fbp = (rpc_cn_fragbuf_p_t)
-            rpc__list_element_alloc (&rpc_g_cn_sm_fbuf_lookaside_list,
-                                     true);
+        fbp = fbuf_get (RPC_C_CN_FBUF_CLASS_SMALL);
         if (fbp != NULL)
         {
             fbp->fragbuf_dealloc = rpc__cn_smfragbuf_free;
-            fbp->max_data_size = RPC_C_CN_SMALL_FRAG_SIZE;
         }
         else
         {
@@ -249,7 +711,8 @@ boolean32               alloc_large_buf;
 **
 **  DESCRIPTION:
 **
-**  Deallocates a dynamic fragment buffer.
+**  Deallocates a dynamic fragment buffer. Buffers of one of the
+**  dynamic size classes are returned to the pool.
 **
 **  INPUTS:
 **
@@ -281,12 +744,26 @@ INTERNAL void rpc__cn_dynfragbuf_free
 rpc_cn_fragbuf_p_t            buffer_p;
 #endif
 {
+    unsigned32          class;
+
+    for (class = RPC_C_CN_FBUF_CLASS_DYN;
+         class < RPC_C_CN_FBUF_CLASSES &&
+         FBUF_CLASS_SIZE (class) != buffer_p->max_data_size;
+         class++);
+
 #ifdef MAX_DEBUG
     memset ((char *) buffer_p->data_area, 0, buffer_p->max_data_size);
     memset ((char *) buffer_p, 0, sizeof (rpc_cn_fragbuf_t));
 #endif
 
-    RPC_MEM_FREE(buffer_p, RPC_C_MEM_CN_PAC_BUF);
+    if (class < RPC_C_CN_FBUF_CLASSES)
+    {
+        fbuf_put (buffer_p, class);
+    }
+    else
+    {
+        RPC_MEM_FREE(buffer_p, RPC_C_MEM_CN_PAC_BUF);
+    }
 }
 
 /*
@@ -329,18 +806,38 @@ unsigned32               alloc_size;
 #endif
 {
     rpc_cn_fragbuf_p_t  fbp;
+    unsigned32          class;
+
+    /*
+     * Use the smallest dynamic size class the fragment fits in, if
+     * any. The buffer's max_data_size is that of the class.
+     */
+    for (class = RPC_C_CN_FBUF_CLASS_DYN;
+         class < RPC_C_CN_FBUF_CLASSES &&
+         FBUF_CLASS_SIZE (class) < alloc_size;
+         class++);
 
-    RPC_MEM_ALLOC (fbp,
-                   rpc_cn_fragbuf_p_t,
-                   sizeof(rpc_cn_fragbuf_t) + alloc_size,
-                   RPC_C_MEM_CN_PAC_BUF,
-                   RPC_C_MEM_NOWAIT);
+    if (class < RPC_C_CN_FBUF_CLASSES)
+    {
+        fbp = fbuf_get (class);
+    }
+    else
+    {
+        RPC_MEM_ALLOC (fbp,
+                       rpc_cn_fragbuf_p_t,
+                       sizeof(rpc_cn_fragbuf_t) + alloc_size,
+                       RPC_C_MEM_CN_PAC_BUF,
+                       RPC_C_MEM_NOWAIT);
+        if (fbp != NULL)
+        {
+            memset(fbp, 0, sizeof(rpc_cn_fragbuf_t));
+            fbp->max_data_size = alloc_size;
+        }
+    }
 
     if (fbp != NULL)
     {
-        memset(fbp, 0, sizeof(rpc_cn_fragbuf_t));
         fbp->fragbuf_dealloc = rpc__cn_dynfragbuf_free;
-        fbp->max_data_size = alloc_size;
     }
     else
     {
@@ -352,7 +849,7 @@ unsigned32               alloc_size;
      */
 
     fbp->data_p = (pointer_t) RPC_CN_ALIGN_PTR(fbp->data_area, 8);
-    memset(fbp->data_area, 0, fbp->max_data_size);
+    memset(fbp->data_area, 0, alloc_size);
 
     /*
      * Set up the size of the data being pointed to.
@@ -99,6 +99,15 @@ EXTERNAL unsigned32 rpc_g_cn_large_frag_size;
 #define RPC_CN_FRAGBUF_SET_DATA_P(fbp)\
     (fbp)->data_p = (pointer_t) RPC_CN_ALIGN_PTR((fbp)->data_area, 8);
 
+/***********************************************************************/
+/*
+ * R P C _ _ C N _ F R A G B U F _ I N I T
+ *
+ */
+
+void rpc__cn_fragbuf_init _DCE_PROTOTYPE_ ((void));
+
+
 /***********************************************************************/
 /*
  * R P C _ _ C N _ F R A G B U F _ F R E E
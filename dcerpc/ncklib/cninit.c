@@ -49,6 +49,7 @@
 #include <cnfbuf.h>     /* NCA connection fragment buffer service */
 #include <cnpkt.h>	/* NCA connection packet layout */
 #include <cnassoc.h>    /* NCA connection association service */
+#include <cnrcvr.h>     /* NCA connection receiver service */
 
 void rpc__cn_minute_system_time _DCE_PROTOTYPE_ ((void));
 
@@ -229,35 +230,12 @@ unsigned32                      *st;
                          &rpc_g_global_mutex,
                          &rpc_g_cn_lookaside_cond);
     /*
-     * Initialize fragment buffer lookaside lists. Note that 7 extra
-     * bytes will be allocated per structure. This is so that we can
-     * adjust the data pointer to be on an 8 byte boundary and still
-     * have the same size data area. Note that the CN global mutex
-     * cannot be used to protect the large fragbuf lookaside list,
-     * hence the NULL input args for mutex and cond to
-     * rpc__list_desc_init. This is because large fragbufs are given
-     * to stubs which indirectly call the fragbuf free routine which
-     * calls the list free routine. Since this fragbuf free routine is
-     * also called internally, where the CN global mutex is held,
-     * it would be difficult to determine whether the CN global mutex
-     * needed to be acquired in the fragbuf free routine.
+     * Initialize the fragment buffer pools. These are not lookaside
+     * lists protected by the CN global mutex since fragbufs are given
+     * to stubs which indirectly call the fragbuf free routine, which
+     * is also called internally where the CN global mutex is held.
      */
-    rpc__list_desc_init (&rpc_g_cn_lg_fbuf_lookaside_list,
-                         RPC_C_CN_FRAGBUF_LOOKASIDE_MAX,
-                         RPC_C_CN_LG_FRAGBUF_ALLOC_SIZE + 7,
-                         RPC_C_MEM_CN_LG_FRAGBUF,
-                         NULL,
-                         NULL,
-                         NULL,
-                         NULL);
-    rpc__list_desc_init (&rpc_g_cn_sm_fbuf_lookaside_list,
-                         RPC_C_CN_FRAGBUF_LOOKASIDE_MAX,
-                         RPC_C_CN_SM_FRAGBUF_ALLOC_SIZE + 7,
-                         RPC_C_MEM_CN_SM_FRAGBUF,
-                         NULL,
-                         NULL,
-                         &rpc_g_global_mutex,
-                         &rpc_g_cn_lookaside_cond);
+    rpc__cn_fragbuf_init ();
     /*
      * Initialize the association control block lookaside list.
      */
@@ -297,6 +275,11 @@ unsigned32                      *st;
      */
     rpc__cn_assoc_grp_tbl_init ();
 
+    /*
+     * Initialize the receiver service.
+     */
+    rpc__cn_network_receiver_init ();
+
     /*
      * Return the interface to the NCA Connection Protocol Service in the four
      * EPVs.
@@ -48,6 +48,7 @@
 #include <cnfbuf.h>     /* NCA Connection fragment buffer service */
 #include <cncall.h>     /* NCA Connection call service */
 #include <cnnet.h>
+#include <cnrcvr.h>     /* NCA Connection receiver service */
 #include <lw/ntstatus.h>
 
 /***********************************************************************/
@@ -1434,14 +1435,10 @@ unsigned32              *st;
             assoc->cn_ctlblk.cn_state = RPC_C_CN_OPEN;
 
             /*
-             * A connection is now set up. Tell the receiver thread to begin
+             * A connection is now set up. Tell the receiver to begin
              * receiving on the connection.
              */
-            if (assoc->cn_ctlblk.cn_rcvr_waiters)
-            {
-                RPC_COND_SIGNAL (assoc->cn_ctlblk.cn_rcvr_cond,
-                                 rpc_g_global_mutex);
-            }
+            rpc__cn_network_receiver_start (assoc);
 
             /*
              * Set the keepalive socket option for this connection.
@@ -1547,7 +1544,7 @@ unsigned32              *st;
      */
     if (assoc->cn_ctlblk.cn_state == RPC_C_CN_OPEN)
     {
-        dcethread_interrupt_throw (assoc->cn_ctlblk.cn_rcvr_thread_id);
+        rpc__cn_network_receiver_stop (assoc);
     }
     else
     {
@@ -47,8 +47,6 @@ GLOBAL rpc_list_desc_t          rpc_g_cn_syntax_lookaside_list;
 GLOBAL rpc_list_desc_t          rpc_g_cn_sec_lookaside_list;
 GLOBAL rpc_list_desc_t          rpc_g_cn_assoc_lookaside_list;
 GLOBAL rpc_list_desc_t          rpc_g_cn_binding_lookaside_list;
-GLOBAL rpc_list_desc_t          rpc_g_cn_lg_fbuf_lookaside_list;
-GLOBAL rpc_list_desc_t          rpc_g_cn_sm_fbuf_lookaside_list;
 GLOBAL rpc_list_desc_t          rpc_g_cn_call_lookaside_list;
 GLOBAL rpc_cn_assoc_grp_tbl_t   rpc_g_cn_assoc_grp_tbl;
 GLOBAL unsigned32               rpc_g_cn_call_id;
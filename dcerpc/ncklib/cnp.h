@@ -580,6 +580,8 @@ typedef struct
     rpc_mutex_t                         cn_rcvr_mutex; /* unused so far */
     rpc_cond_t                          cn_rcvr_cond;
     dcethread*                          cn_rcvr_thread_id;
+    struct rpc_cn_rcvr_evt_s_t          *cn_rcvr_evt;  /* event receiver, if any */
+    dcethread*                          cn_rcvr_evt_thread_id;
     unsigned_char_t                     *cn_listening_endpoint;
     rpc_socket_t volatile               cn_sock;
     rpc_addr_p_t                        rpc_addr;
@@ -831,15 +833,6 @@ EXTERNAL rpc_list_desc_t        rpc_g_cn_call_lookaside_list;
 #define RPC_C_CN_BINDING_LOOKASIDE_MAX          8
 EXTERNAL rpc_list_desc_t          rpc_g_cn_binding_lookaside_list;
 
-
-/*
- * R P C _ G _ C N _ [ L G , S M ] _ F R A G B U F _ L I S T
- */
-
-#define RPC_C_CN_FRAGBUF_LOOKASIDE_MAX          0
-EXTERNAL rpc_list_desc_t          rpc_g_cn_lg_fbuf_lookaside_list;
-EXTERNAL rpc_list_desc_t          rpc_g_cn_sm_fbuf_lookaside_list;
-
 /*
  * R P C _ G _ C N _ L O O K A S I D E _ C O N D
  */
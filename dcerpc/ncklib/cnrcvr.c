@@ -79,6 +79,7 @@
 #include <cncall.h>     /* NCA connection call service */
 #include <comcthd.h>    /* Externals for call thread services component */
 #include <cncthd.h>     /* NCA Connection call executor service */
+#include <lw/base.h>
 
 
 /******************************************************************************/
@@ -133,6 +134,76 @@ INTERNAL rpc_cn_pkt_info_t packet_info_table[] =
 };
 
 
+/*
+ * R P C _ C N _ R C V R _ S T A T E _ T
+ *
+ * Receive state carried across calls to receive_dispatch when packets
+ * are dispatched by the event receiver rather than by a receiver
+ * thread which stays in receive_dispatch for the life of the
+ * connection.
+ *
+ * partial_fragbuf_p holds a fragment receive_packet has started but
+ * could not finish without blocking; its data_size is the offset at
+ * which the next read resumes.
+ */
+
+typedef struct
+{
+    int                         fd;
+    unsigned32                  next_seq;
+    boolean                     unpack_ints;
+    boolean                     close_pending;
+    rpc_cn_fragbuf_p_t          ovf_fragbuf_p;
+    rpc_cn_fragbuf_p_t          partial_fragbuf_p;
+    rpc_cn_sec_context_t        *sec_context;
+} rpc_cn_rcvr_state_t, *rpc_cn_rcvr_state_p_t;
+
+/*
+ * R P C _ C N _ R C V R _ E V T _ T
+ *
+ * The event receiver for one connection. Rather than dedicating a
+ * thread to each association, the event receiver has a task in a
+ * shared thread pool wait for the connection's socket to become
+ * readable, then queues a work item which dispatches the packets
+ * which have arrived and returns as soon as receiving another one
+ * would block.
+ *
+ * The structure belongs to its task and is freed by it once the
+ * connection has been torn down. It does not live in the association
+ * control block since the final work item may return that block to
+ * the lookaside list before the task has run for the last time.
+ */
+
+typedef struct rpc_cn_rcvr_evt_s_t
+{
+    rpc_cn_assoc_p_t            assoc;
+    PLW_TASK                    task;
+    PLW_WORK_ITEM               work_item;
+    rpc_cn_rcvr_state_t         state;
+
+    /*
+     * Only touched by the task function.
+     */
+    boolean                     polling;
+    boolean                     busy;
+
+    /*
+     * Protected by lock. close_pending in the receive state above is
+     * also protected by it in addition to the CN global mutex.
+     */
+    pthread_mutex_t             lock;
+    boolean                     finished;   /* work item has returned */
+    boolean                     ended;      /* receiving has stopped */
+    boolean                     done;       /* connection torn down */
+} rpc_cn_rcvr_evt_t, *rpc_cn_rcvr_evt_p_t;
+
+/*
+ * The thread pool used by the event receiver, or NULL if every
+ * association has its own receiver thread.
+ */
+INTERNAL PLW_THREAD_POOL rcvr_evt_pool = NULL;
+
+
 /******************************************************************************/
 /*
  * Internal routine declarations
@@ -141,8 +212,9 @@ INTERNAL rpc_cn_pkt_info_t packet_info_table[] =
 /*
  * R E C E I V E _ D I S P A T C H
  */
-INTERNAL void receive_dispatch _DCE_PROTOTYPE_ ((
-        rpc_cn_assoc_p_t        /*assoc*/
+INTERNAL boolean receive_dispatch _DCE_PROTOTYPE_ ((
+        rpc_cn_assoc_p_t        /*assoc*/,
+        rpc_cn_rcvr_state_p_t   /*rstate*/
     ));
 
 /*
@@ -150,11 +222,45 @@ INTERNAL void receive_dispatch _DCE_PROTOTYPE_ ((
  */
 INTERNAL void receive_packet _DCE_PROTOTYPE_ ((
         rpc_cn_assoc_p_t        /*assoc*/,
+        rpc_cn_rcvr_state_p_t   /*rstate*/,
         rpc_cn_fragbuf_p_t      * /*fragbuf_p*/,
         rpc_cn_fragbuf_p_t      * /*ovf_fragbuf_p*/,
         unsigned32              * /*st*/
     ));
 
+/*
+ * R C V R _ E V T _ P O O L _ C R E A T E
+ */
+INTERNAL NTSTATUS rcvr_evt_pool_create _DCE_PROTOTYPE_ ((
+        LONG                    /*threads*/
+    ));
+
+/*
+ * R E C E I V E R _ T H R E A D _ C R E A T E
+ */
+INTERNAL void receiver_thread_create _DCE_PROTOTYPE_ ((
+        rpc_cn_assoc_p_t        /*assoc*/
+    ));
+
+/*
+ * R C V R _ E V T _ T A S K
+ */
+INTERNAL void rcvr_evt_task _DCE_PROTOTYPE_ ((
+        PLW_TASK                /*task*/,
+        PVOID                   /*context*/,
+        LW_TASK_EVENT_MASK      /*wake_mask*/,
+        LW_TASK_EVENT_MASK      * /*wait_mask*/,
+        LONG64                  * /*time*/
+    ));
+
+/*
+ * R C V R _ E V T _ W O R K
+ */
+INTERNAL void rcvr_evt_work _DCE_PROTOTYPE_ ((
+        PLW_WORK_ITEM           /*work_item*/,
+        PVOID                   /*context*/
+    ));
+
 /*
  * R P C _ C N _ S E N D _ F A U L T
  *
@@ -341,7 +447,7 @@ rpc_cn_assoc_p_t        assoc;
                 RPC_CN_STATS_INCR (connections);
                 DCETHREAD_TRY
                 {
-                    receive_dispatch (assoc);
+                    receive_dispatch (assoc, NULL);
                 }
                 DCETHREAD_CATCH(dcethread_interrupt_e)
                 {
@@ -504,14 +610,22 @@ rpc_cn_assoc_p_t        assoc;
 **
 **  This is the low-level routine for receiving and dispatching packets.
 **
-**  This routine is called once per "connection" and will continue to
-**  receive and dispatch packets until some kind of error is encountered.
+**  When called from a receiver thread (rstate is NULL) this routine
+**  is called once per "connection" and will continue to receive and
+**  dispatch packets until some kind of error is encountered.
+**
+**  When called from the event receiver it picks up where the previous
+**  call left off, including any partially received fragment, and
+**  returns as soon as reading the socket would block. Work threads
+**  are therefore never held waiting for the rest of a fragment.
 **
 **  INPUTS:
 **
 **      assoc           pointer to an association control block
 **
-**  INPUTS/OUTPUTS:     none
+**  INPUTS/OUTPUTS:
+**
+**      rstate          event receiver state, or NULL
 **
 **  OUTPUTS:            none
 **
@@ -519,21 +633,26 @@ rpc_cn_assoc_p_t        assoc;
 **
 **  IMPLICIT OUTPUTS:   none
 **
-**  FUNCTION VALUE:     none
+**  FUNCTION VALUE:
+**
+**      true            receiving was suspended until more data arrives
+**      false           the connection has failed or been closed
 **
 **  SIDE EFFECTS:       none
 **
 **--
 **/
 
-INTERNAL void receive_dispatch
+INTERNAL boolean receive_dispatch
 #ifdef _DCE_PROTO_
 (
-  rpc_cn_assoc_p_t        assoc
+  rpc_cn_assoc_p_t        assoc,
+  rpc_cn_rcvr_state_p_t   rstate
 )
 #else
-(assoc)
+(assoc, rstate)
 rpc_cn_assoc_p_t        assoc;
+rpc_cn_rcvr_state_p_t   rstate;
 #endif
 {
     volatile rpc_cn_fragbuf_p_t          fragbuf_p;
@@ -544,6 +663,7 @@ rpc_cn_assoc_p_t        assoc;
     unsigned8                   ptype;
     volatile boolean                     unpack_ints = false;
     volatile unsigned32                  i;
+    unsigned32                  first_seq;
     rpc_cn_syntax_t             *pres_context;
     unsigned32                  auth_st;
     rpc_cn_sec_context_t        *sec_context;
@@ -560,6 +680,16 @@ rpc_cn_assoc_p_t        assoc;
     ovf_fragbuf_p = NULL;
     call_r = NULL;
     sec_context = NULL;
+    first_seq = 0;
+
+    if (rstate != NULL)
+    {
+        ovf_fragbuf_p = rstate->ovf_fragbuf_p;
+        rstate->ovf_fragbuf_p = NULL;
+        unpack_ints = rstate->unpack_ints;
+        sec_context = rstate->sec_context;
+        first_seq = rstate->next_seq;
+    }
 
     /*
      * Main receive processing.
@@ -567,8 +697,22 @@ rpc_cn_assoc_p_t        assoc;
      * We loop, receiving and processing packets until some kind of error
      * is encountered.
      */
-    for (i = 0;; i++)
+    for (i = first_seq;; i++)
     {
+        if (rstate != NULL)
+        {
+            if (rstate->close_pending)
+            {
+                /*
+                 * rpc__cn_network_receiver_stop() was called; this is
+                 * the event receiver's equivalent of the cancel a
+                 * receiver thread would have been sent.
+                 */
+                st = rpc_s_connection_closed;
+                break;
+            }
+        }
+
         RPC_LOG_CN_PROCESS_PKT_NTR;
 
         /*
@@ -583,6 +727,7 @@ rpc_cn_assoc_p_t        assoc;
         DCETHREAD_TRY
         {
             receive_packet (assoc,
+                            rstate,
                             (rpc_cn_fragbuf_p_t*)&fragbuf_p,
                             (rpc_cn_fragbuf_p_t*)&ovf_fragbuf_p,
                             (unsigned32*)&st);
@@ -616,6 +761,21 @@ rpc_cn_assoc_p_t        assoc;
             break;
         }
 
+        if (fragbuf_p == NULL)
+        {
+            /*
+             * The event receiver's read would have blocked. Any part
+             * of a fragment already read was kept in rstate by
+             * receive_packet; give the work thread back and pick up
+             * again when the socket becomes readable.
+             */
+            rstate->next_seq = i;
+            rstate->unpack_ints = unpack_ints;
+            rstate->ovf_fragbuf_p = ovf_fragbuf_p;
+            rstate->sec_context = sec_context;
+            return (true);
+        }
+
         already_unpacked = false;
 
         /*
@@ -1288,6 +1448,11 @@ rpc_cn_assoc_p_t        assoc;
     {
         (*ovf_fragbuf_p->fragbuf_dealloc)(ovf_fragbuf_p);
     }
+    if (rstate != NULL && rstate->partial_fragbuf_p)
+    {
+        (*rstate->partial_fragbuf_p->fragbuf_dealloc)(rstate->partial_fragbuf_p);
+        rstate->partial_fragbuf_p = NULL;
+    }
     if (st != rpc_s_ok)
     {
         if (assoc->security.auth_buffer_info.auth_buffer)
@@ -1301,6 +1466,8 @@ rpc_cn_assoc_p_t        assoc;
             assoc->raw_packet_p = NULL;
         }
     }
+
+    return (false);
 }
 
 
@@ -1322,12 +1489,19 @@ rpc_cn_assoc_p_t        assoc;
 **  read operation, we preserve the excess bytes read and return them the next
 **  time we are called.
 **
+**  For the event receiver (rstate is not NULL) rpc__socket_recv_ready
+**  is asked before each read whether the read would block. If it would
+**  the fragment received so far is left in rstate->partial_fragbuf_p,
+**  and rpc_s_ok is returned with a NULL fragbuf; the next call resumes
+**  reading into it.
+**
 **  INPUTS:
 **
 **      assoc           pointer to an association control block
 **
 **  INPUTS/OUTPUTS:
 **
+**      rstate          event receiver state, or NULL
 **      fragbuf_p       pointer to a fragbuf pointer
 **      ovf_fragbuf_p   pointer to a overflow fragbuf pointer
 **
@@ -1350,13 +1524,15 @@ INTERNAL void receive_packet
 #ifdef _DCE_PROTO_
 (
   rpc_cn_assoc_p_t        assoc,
+  rpc_cn_rcvr_state_p_t   rstate,
   rpc_cn_fragbuf_p_t      *fragbuf_p,
   rpc_cn_fragbuf_p_t      *ovf_fragbuf_p,
   unsigned32              *st
 )
 #else
-(assoc, fragbuf_p, ovf_fragbuf_p, st)
+(assoc, rstate, fragbuf_p, ovf_fragbuf_p, st)
 rpc_cn_assoc_p_t        assoc;
+rpc_cn_rcvr_state_p_t   rstate;
 rpc_cn_fragbuf_p_t      *fragbuf_p;
 rpc_cn_fragbuf_p_t      *ovf_fragbuf_p;
 unsigned32              *st;
@@ -1387,9 +1563,17 @@ unsigned32              *st;
     *fragbuf_p = NULL;
 
     /*
-     * If we have a left over fragment buffer (overflow), then use it.
+     * If the event receiver left a fragment half read, carry on with
+     * it. Otherwise, if we have a left over fragment buffer (overflow),
+     * then use it. There is never both: an overflow buffer is only
+     * left behind once a whole fragment has been received.
      */
-    if (*ovf_fragbuf_p != NULL)
+    if (rstate != NULL && rstate->partial_fragbuf_p != NULL)
+    {
+        fbp = rstate->partial_fragbuf_p;
+        rstate->partial_fragbuf_p = NULL;
+    }
+    else if (*ovf_fragbuf_p != NULL)
     {
         fbp = *ovf_fragbuf_p;
         *ovf_fragbuf_p = NULL;
@@ -1488,6 +1672,34 @@ unsigned32              *st;
             (*fbp->fragbuf_dealloc)(fbp);
             return;
         }
+
+        /*
+         * The event receiver must not block a work thread waiting for
+         * the rest of the fragment. Park what we have (an empty
+         * fragbuf isn't worth keeping for an idle connection) and
+         * return.
+         */
+        if (rstate != NULL &&
+            !rpc__socket_recv_ready (assoc->cn_ctlblk.cn_sock))
+        {
+            if (fbp->data_size == 0)
+            {
+                (*fbp->fragbuf_dealloc)(fbp);
+            }
+            else
+            {
+                RPC_DBG_PRINTF (rpc_e_dbg_general, RPC_C_CN_DBG_GENERAL,
+                                ("CN: call_rep->%p assoc->%p desc->%p partial fragment, %ld bytes so far\n",
+                                 assoc->call_rep,
+                                 assoc,
+                                 assoc->cn_ctlblk.cn_sock,
+                                 (long) fbp->data_size));
+                rstate->partial_fragbuf_p = fbp;
+            }
+            *st = rpc_s_ok;
+            return;
+        }
+
         /*
          * Release the CN global mutex before reading from the
          * socket. This will allow other threads to run if we have to
@@ -1787,3 +1999,816 @@ unsigned32              *st;
     RPC_LOG_CN_RCV_PKT_XIT;
 }
 
+
+
+/******************************************************************************/
+/*
+**++
+**
+**  ROUTINE NAME:       receiver_thread_create
+**
+**  SCOPE:              INTERNAL - declared locally
+**
+**  DESCRIPTION:
+**
+**  Create the receiver thread for an association control block.
+**
+**  INPUTS:
+**
+**      assoc           pointer to an association control block
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:            none
+**
+**  IMPLICIT INPUTS:    none
+**
+**  IMPLICIT OUTPUTS:   none
+**
+**  FUNCTION VALUE:     none
+**
+**  SIDE EFFECTS:       Raises an exception if the thread can't be created.
+**
+**--
+**/
+
+INTERNAL void receiver_thread_create
+#ifdef _DCE_PROTO_
+(
+  rpc_cn_assoc_p_t        assoc
+)
+#else
+(assoc)
+rpc_cn_assoc_p_t        assoc;
+#endif
+{
+    RPC_DBG_PRINTF (rpc_e_dbg_threads, RPC_C_CN_DBG_THREADS,
+        ( "####### assoc->%x Created receiver thread\n", assoc ));
+
+    DCETHREAD_TRY {
+    dcethread_create_throw (&(assoc->cn_ctlblk.cn_rcvr_thread_id),
+                    &rpc_g_default_dcethread_attr,
+                    (dcethread_startroutine) rpc__cn_network_receiver,
+                    (dcethread_addr) assoc);
+    } DCETHREAD_CATCH_ALL(THIS_CATCH) {
+        DCETHREAD_RERAISE;
+    } DCETHREAD_ENDTRY
+}
+
+
+/******************************************************************************/
+/*
+**++
+**
+**  ROUTINE NAME:       rcvr_evt_pool_create
+**
+**  SCOPE:              INTERNAL - declared locally
+**
+**  DESCRIPTION:
+**
+**  Create the event receiver's thread pool.
+**
+**  INPUTS:
+**
+**      threads         maximum number of work threads; as with the
+**                      thread pool setting it is passed to, a negative
+**                      value is a multiple of the number of CPUs
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:            none
+**
+**  IMPLICIT INPUTS:    none
+**
+**  IMPLICIT OUTPUTS:   rcvr_evt_pool
+**
+**  FUNCTION VALUE:     NTSTATUS from the thread pool
+**
+**  SIDE EFFECTS:       none
+**
+**--
+**/
+
+INTERNAL NTSTATUS rcvr_evt_pool_create
+#ifdef _DCE_PROTO_
+(
+  LONG                    threads
+)
+#else
+(threads)
+LONG                    threads;
+#endif
+{
+    PLW_THREAD_POOL_ATTRIBUTES  attrs = NULL;
+    PLW_THREAD_POOL             pool = NULL;
+    NTSTATUS                    status;
+
+    status = LwRtlCreateThreadPoolAttributes (&attrs);
+    if (status == STATUS_SUCCESS)
+    {
+        status = LwRtlSetThreadPoolAttribute (attrs,
+                                              LW_THREAD_POOL_OPTION_WORK_THREADS,
+                                              threads);
+    }
+    if (status == STATUS_SUCCESS)
+    {
+        status = LwRtlCreateThreadPool (&pool, attrs);
+    }
+    LwRtlFreeThreadPoolAttributes (&attrs);
+
+    if (status == STATUS_SUCCESS)
+    {
+        rcvr_evt_pool = pool;
+    }
+
+    return (status);
+}
+
+
+/******************************************************************************/
+/*
+**++
+**
+**  ROUTINE NAME:       rpc__cn_network_receiver_init
+**
+**  SCOPE:              PRIVATE - declared in cnrcvr.h
+**
+**  DESCRIPTION:
+**
+**  One-time initialization of the receiver service.
+**
+**  By default each association control block gets its own receiver
+**  thread. Servers turn on the event receiver with
+**  rpc_mgmt_set_server_rcvr_threads(); for programs which don't, it
+**  can also be turned on by setting RPC_CN_RCVR_THREADS in the
+**  environment to the value that routine would be given.
+**
+**  INPUTS:             none
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:            none
+**
+**  IMPLICIT INPUTS:    none
+**
+**  IMPLICIT OUTPUTS:   none
+**
+**  FUNCTION VALUE:     none
+**
+**  SIDE EFFECTS:       none
+**
+**--
+**/
+
+PRIVATE void rpc__cn_network_receiver_init (void)
+{
+    char                        *x;
+    LONG                        threads = 0;
+    NTSTATUS                    status;
+
+    x = getenv("RPC_CN_RCVR_THREADS");
+    if (x != NULL)
+        threads = (LONG)atoi(x);
+    if (threads == 0)
+        return;
+
+    status = rcvr_evt_pool_create (threads);
+    if (status != STATUS_SUCCESS)
+    {
+        /*
+         * Not fatal; we just fall back to a thread per association.
+         */
+        RPC_DBG_PRINTF (rpc_e_dbg_general, RPC_C_CN_DBG_ERRORS,
+            ("(rpc__cn_network_receiver_init) could not create thread pool, status = 0x%x\n",
+             status));
+    }
+}
+
+
+/******************************************************************************/
+/*
+**++
+**
+**  ROUTINE NAME:       rpc_mgmt_set_server_rcvr_threads
+**
+**  SCOPE:              PUBLIC - declared in rpc.idl
+**
+**  DESCRIPTION:
+**
+**  This is a Local management function that turns on the event
+**  receiver for connection-oriented associations. Rather than each
+**  association having a receiver thread of its own, the connections
+**  share a pool of at most max_threads threads which dispatch packets
+**  as they arrive.
+**
+**  Only connections whose sockets can be polled (ncalrpc,
+**  ncacn_ip_tcp, ncacn_ip6_tcp, and ncacn_np pipes which npfs hands
+**  over through a channel socket) use the pool. Other ncacn_np
+**  connections still get a receiver thread each, since an lwio file
+**  handle has no descriptor to poll.
+**
+**  Associations which already have a receiver thread keep it, so this
+**  should be called before rpc_server_use_protseq() and friends. Once
+**  the pool exists later calls succeed without changing it.
+**
+**  INPUTS:
+**
+**      max_threads     the maximum number of threads the pool may use
+**                      to dispatch packets; a negative value is a
+**                      multiple of the number of CPUs
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:
+**
+**      status          A value indicating the status of the routine.
+**
+**          rpc_s_ok        The call was successful.
+**          rpc_s_invalid_arg
+**          rpc_s_cthread_create_failed
+**          rpc_s_coding_error
+**
+**  IMPLICIT INPUTS:    none
+**
+**  IMPLICIT OUTPUTS:   none
+**
+**  FUNCTION VALUE:     void
+**
+**  SIDE EFFECTS:       none
+**
+**--
+**/
+
+PUBLIC void rpc_mgmt_set_server_rcvr_threads
+#ifdef _DCE_PROTO_
+(
+    signed32                max_threads,
+    unsigned32              *status
+)
+#else
+(max_threads, status)
+signed32                max_threads;
+unsigned32              *status;
+#endif
+{
+    NTSTATUS            ntstatus = STATUS_SUCCESS;
+
+    CODING_ERROR (status);
+    RPC_VERIFY_INIT ();
+
+    if (max_threads == 0)
+    {
+        *status = rpc_s_invalid_arg;
+        return;
+    }
+
+    RPC_CN_LOCK ();
+    if (rcvr_evt_pool == NULL)
+    {
+        ntstatus = rcvr_evt_pool_create ((LONG) max_threads);
+    }
+    RPC_CN_UNLOCK ();
+
+    if (ntstatus != STATUS_SUCCESS)
+    {
+        RPC_DBG_PRINTF (rpc_e_dbg_general, RPC_C_CN_DBG_ERRORS,
+            ("(rpc_mgmt_set_server_rcvr_threads) could not create thread pool, status = 0x%x\n",
+             ntstatus));
+        *status = rpc_s_cthread_create_failed;
+        return;
+    }
+
+    *status = rpc_s_ok;
+}
+
+
+/******************************************************************************/
+/*
+**++
+**
+**  ROUTINE NAME:       rpc__cn_network_receiver_create
+**
+**  SCOPE:              PRIVATE - declared in cnrcvr.h
+**
+**  DESCRIPTION:
+**
+**  Called when an association control block is created. Creates the
+**  receiver thread for it, unless the event receiver is in use, in
+**  which case nothing is done until a connection is established.
+**
+**  INPUTS:
+**
+**      assoc           pointer to an association control block
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:            none
+**
+**  IMPLICIT INPUTS:    none
+**
+**  IMPLICIT OUTPUTS:   none
+**
+**  FUNCTION VALUE:     none
+**
+**  SIDE EFFECTS:       none
+**
+**--
+**/
+
+PRIVATE void rpc__cn_network_receiver_create
+#ifdef _DCE_PROTO_
+(
+  rpc_cn_assoc_p_t        assoc
+)
+#else
+(assoc)
+rpc_cn_assoc_p_t        assoc;
+#endif
+{
+    if (rcvr_evt_pool == NULL)
+    {
+        receiver_thread_create (assoc);
+    }
+}
+
+
+/******************************************************************************/
+/*
+**++
+**
+**  ROUTINE NAME:       rpc__cn_network_receiver_start
+**
+**  SCOPE:              PRIVATE - declared in cnrcvr.h
+**
+**  DESCRIPTION:
+**
+**  Called with the CN global mutex held once a connection has been set
+**  up on an association. Tells the receiver to begin receiving on it.
+**
+**  If the association has a receiver thread it is woken up. Otherwise
+**  the connection is handed to the event receiver if its socket can be
+**  polled, or a receiver thread is created for it if not.
+**
+**  INPUTS:
+**
+**      assoc           pointer to an association control block
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:            none
+**
+**  IMPLICIT INPUTS:    none
+**
+**  IMPLICIT OUTPUTS:   none
+**
+**  FUNCTION VALUE:     none
+**
+**  SIDE EFFECTS:       none
+**
+**--
+**/
+
+PRIVATE void rpc__cn_network_receiver_start
+#ifdef _DCE_PROTO_
+(
+  rpc_cn_assoc_p_t        assoc
+)
+#else
+(assoc)
+rpc_cn_assoc_p_t        assoc;
+#endif
+{
+    rpc_cn_rcvr_evt_p_t evt;
+    rpc_protseq_id_t    pseq_id;
+    NTSTATUS            status;
+
+    RPC_CN_DBG_RTN_PRINTF (rpc__cn_network_receiver_start);
+
+    if (assoc->cn_ctlblk.cn_rcvr_thread_id != NULL)
+    {
+        if (assoc->cn_ctlblk.cn_rcvr_waiters)
+        {
+            RPC_COND_SIGNAL (assoc->cn_ctlblk.cn_rcvr_cond,
+                             rpc_g_global_mutex);
+        }
+        else
+        {
+            RPC_DBG_PRINTF (rpc_e_dbg_threads, RPC_C_CN_DBG_THREADS,
+                ( "####### assoc->%x We're not signalling here\n", assoc ));
+        }
+        return;
+    }
+
+    /*
+     * Only sockets which deliver their data through the descriptor
+     * rpc__socket_get_select_desc() returns can be polled. ncacn_np
+     * does when the pipe came with a channel, and has no descriptor
+     * otherwise.
+     */
+    pseq_id = assoc->cn_ctlblk.cn_sock->pseq_id;
+    if (rcvr_evt_pool == NULL ||
+        (pseq_id != RPC_C_PROTSEQ_ID_NCALRPC &&
+         pseq_id != RPC_C_PROTSEQ_ID_NCACN_IP_TCP &&
+         pseq_id != RPC_C_PROTSEQ_ID_NCACN_IP6_TCP &&
+         pseq_id != RPC_C_PROTSEQ_ID_NCACN_NP) ||
+        rpc__socket_get_select_desc (assoc->cn_ctlblk.cn_sock) < 0)
+    {
+        receiver_thread_create (assoc);
+        return;
+    }
+
+    RPC_MEM_ALLOC (evt,
+                   rpc_cn_rcvr_evt_p_t,
+                   sizeof (rpc_cn_rcvr_evt_t),
+                   RPC_C_MEM_CN_RCVR_EVT,
+                   RPC_C_MEM_WAITOK);
+    if (evt == NULL)
+    {
+        receiver_thread_create (assoc);
+        return;
+    }
+
+    memset (evt, 0, sizeof (rpc_cn_rcvr_evt_t));
+    evt->assoc = assoc;
+    evt->state.fd = rpc__socket_get_select_desc (assoc->cn_ctlblk.cn_sock);
+    pthread_mutex_init (&evt->lock, NULL);
+
+    status = LwRtlCreateWorkItem (rcvr_evt_pool,
+                                  &evt->work_item,
+                                  rcvr_evt_work,
+                                  evt);
+    if (status == STATUS_SUCCESS)
+    {
+        /*
+         * The task may run before we return, so set up everything
+         * it looks at first.
+         */
+        RPC_CN_ASSOC_ACB_INC_REF (assoc);
+        assoc->cn_ctlblk.cn_rcvr_evt = evt;
+
+        status = LwRtlCreateTask (rcvr_evt_pool,
+                                  &evt->task,
+                                  NULL,
+                                  rcvr_evt_task,
+                                  evt);
+        if (status != STATUS_SUCCESS)
+        {
+            assoc->cn_ctlblk.cn_rcvr_evt = NULL;
+            RPC_CN_ASSOC_ACB_DEC_REF (assoc);
+            LwRtlFreeWorkItem (&evt->work_item);
+        }
+    }
+
+    if (status != STATUS_SUCCESS)
+    {
+        RPC_DBG_PRINTF (rpc_e_dbg_general, RPC_C_CN_DBG_ERRORS,
+            ("(rpc__cn_network_receiver_start) assoc->%p could not create task, status = 0x%x\n",
+             assoc,
+             status));
+        pthread_mutex_destroy (&evt->lock);
+        RPC_MEM_FREE (evt, RPC_C_MEM_CN_RCVR_EVT);
+        receiver_thread_create (assoc);
+        return;
+    }
+
+    RPC_CN_STATS_INCR (connections);
+
+    RPC_DBG_PRINTF (rpc_e_dbg_threads, RPC_C_CN_DBG_THREADS,
+        ( "####### assoc->%p Connection handed to event receiver\n", assoc ));
+}
+
+
+/******************************************************************************/
+/*
+**++
+**
+**  ROUTINE NAME:       rpc__cn_network_receiver_stop
+**
+**  SCOPE:              PRIVATE - declared in cnrcvr.h
+**
+**  DESCRIPTION:
+**
+**  Called with the CN global mutex held to make the receiver stop
+**  receiving on an open connection and close it. A receiver thread is
+**  sent a cancel. The event receiver is told to close the connection
+**  the next time it dispatches. Since the event receiver never waits
+**  in the socket for the rest of a fragment, that is as soon as its
+**  task is woken.
+**
+**  INPUTS:
+**
+**      assoc           pointer to an association control block
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:            none
+**
+**  IMPLICIT INPUTS:    none
+**
+**  IMPLICIT OUTPUTS:   none
+**
+**  FUNCTION VALUE:     none
+**
+**  SIDE EFFECTS:       none
+**
+**--
+**/
+
+PRIVATE void rpc__cn_network_receiver_stop
+#ifdef _DCE_PROTO_
+(
+  rpc_cn_assoc_p_t        assoc
+)
+#else
+(assoc)
+rpc_cn_assoc_p_t        assoc;
+#endif
+{
+    rpc_cn_rcvr_evt_p_t evt = assoc->cn_ctlblk.cn_rcvr_evt;
+
+    if (evt == NULL)
+    {
+        dcethread_interrupt_throw (assoc->cn_ctlblk.cn_rcvr_thread_id);
+        return;
+    }
+
+    /*
+     * The event receiver clears cn_rcvr_evt with the CN global mutex
+     * held before it lets go of evt, so evt is still valid here.
+     */
+    pthread_mutex_lock (&evt->lock);
+    evt->state.close_pending = true;
+    pthread_mutex_unlock (&evt->lock);
+
+    LwRtlWakeTask (evt->task);
+}
+
+
+/******************************************************************************/
+/*
+**++
+**
+**  ROUTINE NAME:       rcvr_evt_task
+**
+**  SCOPE:              INTERNAL - declared locally
+**
+**  DESCRIPTION:
+**
+**  The task function of an event receiver. It polls the connection's
+**  socket, and each time it becomes readable (or the receiver is told
+**  to stop) runs the work item which dispatches packets. The socket
+**  isn't polled again until the work item has returned, so only one
+**  work thread at a time is ever receiving on a connection.
+**
+**  INPUTS:
+**
+**      task            the task
+**      context         the event receiver
+**      wake_mask       the events which woke the task
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:
+**
+**      wait_mask       the events to wait for next
+**      time            unused
+**
+**  IMPLICIT INPUTS:    none
+**
+**  IMPLICIT OUTPUTS:   none
+**
+**  FUNCTION VALUE:     none
+**
+**  SIDE EFFECTS:       Frees the event receiver when it completes.
+**
+**--
+**/
+
+INTERNAL void rcvr_evt_task
+#ifdef _DCE_PROTO_
+(
+  PLW_TASK                task,
+  PVOID                   context,
+  LW_TASK_EVENT_MASK      wake_mask,
+  LW_TASK_EVENT_MASK      *wait_mask,
+  LONG64                  *time
+)
+#else
+(task, context, wake_mask, wait_mask, time)
+PLW_TASK                task;
+PVOID                   context;
+LW_TASK_EVENT_MASK      wake_mask;
+LW_TASK_EVENT_MASK      *wait_mask;
+LONG64                  *time;
+#endif
+{
+    rpc_cn_rcvr_evt_p_t evt = (rpc_cn_rcvr_evt_p_t) context;
+    boolean             finished;
+    boolean             ended;
+    boolean             done;
+    boolean             close_pending;
+
+    if (wake_mask & LW_TASK_EVENT_INIT)
+    {
+        evt->polling =
+            (LwRtlSetTaskFd (task, evt->state.fd, LW_TASK_EVENT_FD_READABLE)
+             == STATUS_SUCCESS);
+        if (!evt->polling)
+        {
+            /*
+             * There is no way of knowing when to receive, so just
+             * close the connection.
+             */
+            pthread_mutex_lock (&evt->lock);
+            evt->state.close_pending = true;
+            pthread_mutex_unlock (&evt->lock);
+        }
+    }
+
+    pthread_mutex_lock (&evt->lock);
+    finished = evt->finished;
+    evt->finished = false;
+    ended = evt->ended;
+    done = evt->done;
+    close_pending = evt->state.close_pending;
+    pthread_mutex_unlock (&evt->lock);
+
+    if (evt->busy)
+    {
+        if (!finished)
+        {
+            /*
+             * Woken by rpc__cn_network_receiver_stop() while the work
+             * item is running. It will see close_pending itself, or
+             * we'll see it once it has returned.
+             */
+            *wait_mask = LW_TASK_EVENT_EXPLICIT;
+            return;
+        }
+        evt->busy = false;
+    }
+
+    if (done)
+    {
+        LwRtlFreeWorkItem (&evt->work_item);
+        pthread_mutex_destroy (&evt->lock);
+        LwRtlReleaseTask (&evt->task);
+        RPC_MEM_FREE (evt, RPC_C_MEM_CN_RCVR_EVT);
+        *wait_mask = LW_TASK_EVENT_COMPLETE;
+        return;
+    }
+
+    if (ended || close_pending || (wake_mask & LW_TASK_EVENT_FD_READABLE))
+    {
+        if (ended && evt->polling)
+        {
+            /*
+             * Stop polling the descriptor before the work item closes
+             * it.
+             */
+            LwRtlSetTaskFd (task, evt->state.fd, 0);
+            evt->polling = false;
+        }
+
+        evt->busy = true;
+        LwRtlScheduleWorkItem (evt->work_item, 0);
+        *wait_mask = LW_TASK_EVENT_EXPLICIT;
+        return;
+    }
+
+    *wait_mask = LW_TASK_EVENT_FD_READABLE | LW_TASK_EVENT_EXPLICIT;
+}
+
+
+/******************************************************************************/
+/*
+**++
+**
+**  ROUTINE NAME:       rcvr_evt_work
+**
+**  SCOPE:              INTERNAL - declared locally
+**
+**  DESCRIPTION:
+**
+**  The work item of an event receiver. While the connection is up it
+**  dispatches the packets which have arrived on it. Once receiving has
+**  stopped it is run one last time, after the task has stopped polling
+**  the socket, to close the socket and deallocate the association
+**  control block as rpc__cn_network_receiver does when
+**  receive_dispatch returns.
+**
+**  INPUTS:
+**
+**      work_item       the work item
+**      context         the event receiver
+**
+**  INPUTS/OUTPUTS:     none
+**
+**  OUTPUTS:            none
+**
+**  IMPLICIT INPUTS:    none
+**
+**  IMPLICIT OUTPUTS:   none
+**
+**  FUNCTION VALUE:     none
+**
+**  SIDE EFFECTS:       Posts events to the association and call state machines.
+**
+**--
+**/
+
+INTERNAL void rcvr_evt_work
+#ifdef _DCE_PROTO_
+(
+  PLW_WORK_ITEM           work_item,
+  PVOID                   context
+)
+#else
+(work_item, context)
+PLW_WORK_ITEM           work_item;
+PVOID                   context;
+#endif
+{
+    rpc_cn_rcvr_evt_p_t evt = (rpc_cn_rcvr_evt_p_t) context;
+    rpc_cn_assoc_p_t    assoc = evt->assoc;
+    rpc_socket_error_t  serr;
+    boolean             ended;
+    volatile boolean    suspended = false;
+
+    RPC_CN_LOCK ();
+
+    pthread_mutex_lock (&evt->lock);
+    ended = evt->ended;
+    pthread_mutex_unlock (&evt->lock);
+
+    if (!ended)
+    {
+        assoc->cn_ctlblk.cn_rcvr_evt_thread_id = dcethread_self ();
+
+        DCETHREAD_TRY
+        {
+            suspended = receive_dispatch (assoc, &evt->state);
+        }
+        DCETHREAD_CATCH_ALL(THIS_CATCH)
+        {
+            /*
+             * rpc_m_unexpected_exc
+             * "(%s) Unexpected exception was raised"
+             */
+            RPC_DCE_SVC_PRINTF ((
+                DCE_SVC(RPC__SVC_HANDLE, "%s"),
+                rpc_svc_recv,
+                svc_c_sev_fatal | svc_c_action_abort,
+                rpc_m_unexpected_exc,
+                "rcvr_evt_work" ));
+        }
+        DCETHREAD_ENDTRY
+
+        assoc->cn_ctlblk.cn_rcvr_evt_thread_id = NULL;
+    }
+    else
+    {
+        RPC_DBG_PRINTF (rpc_e_dbg_general, RPC_C_CN_DBG_GENERAL,
+                        ("CN: assoc->%p call_rep->none No longer receiving...Close socket\n",
+                         assoc));
+
+        RPC_CN_STATS_INCR (closed_connections);
+        serr = RPC_SOCKET_CLOSE (assoc->cn_ctlblk.cn_sock);
+        if (RPC_SOCKET_IS_ERR(serr))
+        {
+            RPC_DBG_PRINTF (rpc_e_dbg_general, RPC_C_CN_DBG_ERRORS,
+("(rcvr_evt_work) assoc->%p desc->%p RPC_SOCKET_CLOSE failed, error = %d\n",
+                             assoc,
+                             assoc->cn_ctlblk.cn_sock,
+                             RPC_SOCKET_ETOI(serr)));
+        }
+
+        assoc->cn_ctlblk.cn_state = RPC_C_CN_CLOSED;
+        assoc->cn_ctlblk.cn_rcvr_evt = NULL;
+        evt->assoc = NULL;
+
+        /*
+         * Deallocate the association control block. This may free it.
+         */
+        rpc__cn_assoc_acb_dealloc (assoc);
+    }
+
+    RPC_CN_UNLOCK ();
+
+    /*
+     * The task frees evt once it sees done, so nothing may touch evt
+     * after its lock is dropped.
+     */
+    pthread_mutex_lock (&evt->lock);
+    evt->finished = true;
+    if (ended)
+    {
+        evt->done = true;
+    }
+    else if (!suspended)
+    {
+        evt->ended = true;
+    }
+    LwRtlWakeTask (evt->task);
+    pthread_mutex_unlock (&evt->lock);
+}
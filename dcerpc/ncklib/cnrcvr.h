@@ -42,4 +42,12 @@
 
 PRIVATE void rpc__cn_network_receiver    _DCE_PROTOTYPE_ ((rpc_cn_assoc_p_t));
 
+PRIVATE void rpc__cn_network_receiver_init _DCE_PROTOTYPE_ ((void));
+
+PRIVATE void rpc__cn_network_receiver_create _DCE_PROTOTYPE_ ((rpc_cn_assoc_p_t));
+
+PRIVATE void rpc__cn_network_receiver_start _DCE_PROTOTYPE_ ((rpc_cn_assoc_p_t));
+
+PRIVATE void rpc__cn_network_receiver_stop _DCE_PROTOTYPE_ ((rpc_cn_assoc_p_t));
+
 #endif /* _CNRCVR_H */
@@ -2698,8 +2698,7 @@ pointer_t       sm;
      * will wake up any threads blocked waiting for receive data.
      */
     current_thread_id = dcethread_self();
-    if (dcethread_equal (current_thread_id,
-                       assoc->cn_ctlblk.cn_rcvr_thread_id))
+    if (RPC_CN_ASSOC_IN_RCVR (assoc, current_thread_id))
     {
         RPC_CN_ASSOC_WAKEUP (assoc);
     }
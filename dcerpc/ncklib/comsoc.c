@@ -6,6 +6,7 @@
 #include <comsoc.h>
 #include <comsoc_bsd.h>
 #include <errno.h>
+#include <poll.h>
 
 rpc_socket_error_t
 rpc__socket_open_basic (
@@ -282,6 +283,32 @@ rpc__socket_get_select_desc(
     return sock->vtbl->socket_get_select_desc(sock);
 }
 
+boolean
+rpc__socket_recv_ready(
+    rpc_socket_t sock
+    )
+{
+    struct pollfd pfd;
+    int ret;
+
+    if (sock->vtbl->socket_recv_ready)
+    {
+        return sock->vtbl->socket_recv_ready(sock);
+    }
+
+    pfd.fd = sock->vtbl->socket_get_select_desc(sock);
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    do
+    {
+        ret = poll(&pfd, 1, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    /* Let the receive report a failure */
+    return (ret != 0);
+}
+
 rpc_socket_error_t
 rpc__socket_enum_ifaces (
     rpc_socket_t sock,
@@ -270,6 +270,12 @@ typedef struct rpc_socket_vtbl_s
         rpc_transport_info_handle_t info,
         rpc_access_token_p_t* token
         );
+    /* Read what has arrived without blocking and say whether a receive
+       would block; optional for sockets whose select descriptor tells */
+    boolean
+    (*socket_recv_ready) (
+        rpc_socket_t sock
+        );
 } rpc_socket_vtbl_t, *rpc_socket_vtbl_p_t;
 
 typedef struct rpc_socket_handle_s
@@ -666,6 +672,17 @@ rpc__socket_get_select_desc(
     rpc_socket_t sock
     );
 
+/*
+ * R P C _ _ S O C K E T _ R E C V _ R E A D Y
+ *
+ * Return true if a receive on the socket would not block.
+ */
+
+PRIVATE boolean
+rpc__socket_recv_ready(
+    rpc_socket_t sock
+    );
+
 PRIVATE rpc_socket_error_t
 rpc__socket_enum_ifaces (
     rpc_socket_t sock,
@@ -7,6 +7,7 @@
 #include <comsoc_smb.h>
 #include <fcntl.h>
 #include <sys/un.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <cnp.h>
@@ -68,6 +69,8 @@ typedef struct rpc_smb_socket_s
     rpc_smb_transport_info_t info;
     IO_FILE_NAME filename;
     IO_FILE_HANDLE np;
+    /* Direct data channel to npfs for accepted pipes, or -1 */
+    int channel;
     rpc_smb_close_context_p_t close_context;
     IO_STATUS_BLOCK io_status;
     IO_ASYNC_CONTROL_BLOCK io_async;
@@ -75,6 +78,8 @@ typedef struct rpc_smb_socket_s
     unsigned retry_timer_set:1;
     rpc_smb_buffer_t sendbuffer;
     rpc_smb_buffer_t recvbuffer;
+    /* recvbuffer holds a complete PDU which is being handed out */
+    boolean received_pdu;
     boolean received_last;
     struct
     {
@@ -436,6 +441,7 @@ rpc__smb_socket_create(
     }
     sock->accept_backlog.selectfd[0] = -1;
     sock->accept_backlog.selectfd[1] = -1;
+    sock->channel = -1;
 
     /* Set up reasonable default local endpoint */
     sock->localaddr.rpc_protseq_id = RPC_C_PROTSEQ_ID_NCACN_NP;
@@ -521,6 +527,11 @@ rpc__smb_socket_destroy(
             LwRtlUnicodeStringFree(&sock->filename.Name);
         }
 
+        if (sock->channel >= 0)
+        {
+            close(sock->channel);
+        }
+
         if (sock->close_context)
         {
             sock->close_context->io_async.Callback = rpc__smb_close_file_complete;
@@ -968,6 +979,13 @@ rpc__smb_socket_accept(
         goto error;
     }
 
+    /* Move fragments over a direct channel when npfs offers one;
+       otherwise stay on NtReadFile/NtWriteFile */
+    if (LwIoOpenNamedPipeChannel(npsmb->np, &npsmb->channel) != STATUS_SUCCESS)
+    {
+        npsmb->channel = -1;
+    }
+
     *newsock = npsock;
     npsock = NULL;
 
@@ -1258,6 +1276,125 @@ error:
     return serr;
 }
 
+INTERNAL
+rpc_socket_error_t
+rpc__smb_socket_do_channel_send(
+    rpc_smb_socket_p_t smb
+    )
+{
+    rpc_socket_error_t serr = RPC_C_SOCKET_OK;
+    unsigned char* cursor = smb->sendbuffer.base;
+    ssize_t bytes_written = 0;
+
+    while (cursor < smb->sendbuffer.start_cursor)
+    {
+        bytes_written = dcethread_write(
+            smb->channel,
+            cursor,
+            smb->sendbuffer.start_cursor - cursor);
+        if (bytes_written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            serr = errno;
+            goto error;
+        }
+
+        cursor += bytes_written;
+    }
+
+    rpc__smb_buffer_settle(&smb->sendbuffer);
+
+error:
+
+    return serr;
+}
+
+INTERNAL
+rpc_socket_error_t
+rpc__smb_socket_do_channel_recv(
+    rpc_smb_socket_p_t smb,
+    boolean block,
+    size_t* count
+    )
+{
+    rpc_socket_error_t serr = RPC_C_SOCKET_OK;
+    size_t packet_size = 0;
+    size_t pending = 0;
+    size_t bytes_requested = 0;
+    ssize_t bytes_read = 0;
+
+    /* Never read past the end of the PDU at the head of the buffer:
+       anything after it stays in the channel, where polling the
+       descriptor will find it */
+    for (;;)
+    {
+        packet_size = rpc__smb_buffer_packet_size(&smb->recvbuffer);
+        pending = rpc__smb_buffer_pending(&smb->recvbuffer);
+
+        if (packet_size <= pending)
+        {
+            break;
+        }
+
+        bytes_requested = packet_size - pending;
+
+        serr = rpc__smb_buffer_ensure_available(&smb->recvbuffer, bytes_requested);
+        if (serr)
+        {
+            goto error;
+        }
+
+        if (block)
+        {
+            bytes_read = dcethread_read(
+                smb->channel,
+                smb->recvbuffer.end_cursor,
+                bytes_requested);
+        }
+        else
+        {
+            bytes_read = recv(
+                smb->channel,
+                smb->recvbuffer.end_cursor,
+                bytes_requested,
+                MSG_DONTWAIT);
+        }
+
+        if (bytes_read < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            else if (!block && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                serr = RPC_C_SOCKET_EWOULDBLOCK;
+                goto error;
+            }
+
+            serr = errno;
+            goto error;
+        }
+
+        /* Zero bytes is end of file: the client closed the pipe */
+        if (bytes_read == 0)
+        {
+            break;
+        }
+
+        smb->recvbuffer.end_cursor += bytes_read;
+        *count += bytes_read;
+    }
+
+error:
+
+    return serr;
+}
+
 INTERNAL
 rpc_socket_error_t
 rpc__smb_socket_do_send(
@@ -1270,6 +1407,12 @@ rpc__smb_socket_do_send(
     unsigned char* cursor = smb->sendbuffer.base;
     IO_STATUS_BLOCK io_status = { 0 };
 
+    if (smb->channel >= 0)
+    {
+        serr = rpc__smb_socket_do_channel_send(smb);
+        goto error;
+    }
+
     do
     {
         serr = NtStatusToErrno(
@@ -1317,6 +1460,12 @@ rpc__smb_socket_do_recv(
 
     *count = 0;
 
+    if (smb->channel >= 0)
+    {
+        serr = rpc__smb_socket_do_channel_recv(smb, true, count);
+        goto error;
+    }
+
     do
     {
         /* FIXME: magic number */
@@ -1479,10 +1628,11 @@ rpc__smb_socket_recvmsg(
 
     *cc = 0;
 
-    if (rpc__smb_buffer_length(&smb->recvbuffer) == 0)
+    if (!smb->received_pdu)
     {
-        /* Nothing in buffer, read a complete PDU */
-        do
+        /* Read a complete PDU, some of which rpc__smb_socket_recv_ready
+           may already have buffered */
+        while (!rpc__smb_buffer_advance_cursor(&smb->recvbuffer, &smb->received_last))
         {
             serr = rpc__smb_socket_do_recv(sock, &count);
             if (serr)
@@ -1493,10 +1643,11 @@ rpc__smb_socket_recvmsg(
             {
                 break;
             }
-        } while (!rpc__smb_buffer_advance_cursor(&smb->recvbuffer, &smb->received_last));
+        }
 
         /* Reset cursor back to start to begin disperal into scatter buffer */
         smb->recvbuffer.start_cursor = smb->recvbuffer.base;
+        smb->received_pdu = true;
     }
 
     for (i = 0; i < iov_len; i++)
@@ -1517,6 +1668,7 @@ rpc__smb_socket_recvmsg(
 
             /* Reset buffer because we have emptied it */
             smb->recvbuffer.start_cursor = smb->recvbuffer.end_cursor = smb->recvbuffer.base;
+            smb->received_pdu = false;
             /* Switch into send mode if this was the last PDU */
             if (smb->received_last)
             {
@@ -1714,9 +1866,46 @@ rpc__smb_socket_get_select_desc(
     )
 {
     rpc_smb_socket_p_t smb = (rpc_smb_socket_p_t) sock->data.pointer;
+
+    /* An accepted pipe with a channel is read through it; a listening
+       socket signals new connections on its backlog pipe */
+    if (smb->channel >= 0)
+    {
+        return smb->channel;
+    }
+
     return smb->accept_backlog.selectfd[0];
 }
 
+INTERNAL
+boolean
+rpc__smb_socket_recv_ready(
+    rpc_socket_t sock
+    )
+{
+    rpc_smb_socket_p_t smb = (rpc_smb_socket_p_t) sock->data.pointer;
+    boolean ready = true;
+    size_t count = 0;
+
+    SMB_SOCKET_LOCK(smb);
+
+    /* Receives only wait on the descriptor when a channel is being
+       read for the next PDU. Otherwise recvmsg either has data to hand
+       out, fails, or waits for the reply to the last request to be
+       sent, as it does for a receiver thread. */
+    if (smb->channel >= 0 &&
+        smb->state == SMB_STATE_RECV &&
+        !smb->received_pdu)
+    {
+        ready = (rpc__smb_socket_do_channel_recv(smb, false, &count) !=
+                 RPC_C_SOCKET_EWOULDBLOCK);
+    }
+
+    SMB_SOCKET_UNLOCK(smb);
+
+    return ready;
+}
+
 INTERNAL
 rpc_socket_error_t
 rpc__smb_socket_enum_ifaces(
@@ -1841,5 +2030,6 @@ rpc_socket_vtbl_t rpc_g_smb_socket_vtbl =
     .socket_inq_transport_info = rpc__smb_socket_inq_transport_info,
     .transport_info_free = rpc_smb_transport_info_free,
     .transport_info_equal = rpc__smb_transport_info_equal,
-    .transport_inq_access_token = rpc__smb_socket_transport_inq_access_token
+    .transport_inq_access_token = rpc__smb_socket_transport_inq_access_token,
+    .socket_recv_ready = rpc__smb_socket_recv_ready
 };
@@ -185,9 +185,11 @@
 #define RPC_C_MEM_NAMED_PIPE_INFO  100      /* rpc_np_auth_info_t */
 #define RPC_C_MEM_NTLMAUTH_INFO    101      /* rpc_ntlmauth_info_t */
 #define RPC_C_MEM_NTLMAUTH_CN_INFO 102      /* rpc_ntlmauth_cn_info_t */
+#define RPC_C_MEM_CN_RCVR_EVT      103      /* rpc_cn_rcvr_evt_t */
+#define RPC_C_MEM_CN_FBUF_CACHE    104      /* rpc_cn_fbuf_cache_t */
 
 /* can only use up to "rpc_c_mem_maxtypes - 1" without upping it */
-#define RPC_C_MEM_MAX_TYPES        103       /* i.e. 0 : (max_types - 1)     */
+#define RPC_C_MEM_MAX_TYPES        105       /* i.e. 0 : (max_types - 1)     */
 
 
 /*
@@ -0,0 +1,1451 @@
+/* ex: set shiftwidth=4 softtabstop=4 expandtab: */
+/*
+ * rpcperf          : DCE/RPC loopback benchmark
+ *
+ * Runs a perf server in a child process and drives it over ncalrpc
+ * and/or ncacn_ip_tcp on loopback, measuring:
+ *
+ *   - null call latency
+ *   - [in] and [out] array throughput for payloads around multiples of
+ *     the large fragment size
+ *   - context handle churn (create, use and free a context handle)
+ *   - null call latency and rate with several concurrent clients
+ *
+ * Every test reports the call rate and latency percentiles. The exit
+ * status is non-zero if any call failed, so with -r (and -s) it also
+ * serves as a test of the shared receiver thread pool.
+ */
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef _POSIX_PTHREAD_SEMANTICS
+#define _POSIX_PTHREAD_SEMANTICS 1
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <dce/dcethread.h>
+#include <dce/dce_error.h>
+
+#include "perf.h"
+
+#define PROTOCOL_TCP "ncacn_ip_tcp"
+#define PROTOCOL_NCALRPC "ncalrpc"
+
+/*
+ * The connection-oriented runtime's default large fragment size
+ * (RPC_C_CN_LARGE_FRAG_SIZE, the initial value of
+ * rpc_g_cn_large_frag_size).
+ */
+#define DEFAULT_FRAG_SIZE 4096
+
+#define MAX_BINDING 512
+#define MAX_CLIENTS 256
+#define MAX_STALLED 64
+
+/*
+ * How long a run with -r may take before it is treated as hung.
+ */
+#define RCVR_WATCHDOG_SECS 300
+
+typedef struct
+{
+    char *protseq;
+    char *endpoint;
+    unsigned32 calls;
+    unsigned32 clients;
+    unsigned32 frag_size;
+    unsigned32 max_calls;
+    signed32 rcvr_threads;
+    unsigned32 stalled;
+    int verbose;
+} perf_options_t;
+
+typedef struct
+{
+    unsigned64 *samples;
+    unsigned32 count;
+    unsigned32 size;
+    unsigned64 elapsed;
+    unsigned64 bytes;
+    unsigned32 failures;
+} perf_result_t;
+
+typedef struct
+{
+    const char *binding;
+    unsigned32 calls;
+    pthread_mutex_t *start_lock;
+    pthread_cond_t *start_cond;
+    int *started;
+    perf_result_t result;
+} perf_client_t;
+
+static perf_options_t options =
+{
+    NULL,
+    NULL,
+    2000,
+    8,
+    DEFAULT_FRAG_SIZE,
+    rpc_c_listen_max_calls_default,
+    0,
+    0,
+    0
+};
+
+static unsigned32 total_failures = 0;
+static pid_t server_pid = -1;
+
+/*=========================================================================
+ *
+ * Utilities
+ *
+ *=========================================================================*/
+
+static void
+chk_dce_err(
+    error_status_t ecode,
+    const char * where,
+    unsigned int fatal
+    )
+{
+    dce_error_string_t errstr;
+    int error_status;
+
+    if (ecode != error_status_ok)
+    {
+        dce_error_inq_text(ecode, (unsigned char *) errstr, &error_status);
+        if (error_status == error_status_ok)
+            fprintf(stderr, "ERROR.  where = <%s> error code = 0x%x reason = <%s>\n",
+                    where, ecode, errstr);
+        else
+            fprintf(stderr, "ERROR.  where = <%s> error code = 0x%x\n",
+                    where, ecode);
+
+        if (fatal) exit(1);
+    }
+}
+
+static unsigned64
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+result_init(
+    perf_result_t *result,
+    unsigned32 size
+    )
+{
+    memset(result, 0, sizeof(*result));
+    result->samples = calloc(size ? size : 1, sizeof(*result->samples));
+    if (result->samples == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    result->size = size;
+}
+
+static void
+result_add(
+    perf_result_t *result,
+    unsigned64 sample
+    )
+{
+    if (result->count < result->size)
+    {
+        result->samples[result->count++] = sample;
+    }
+}
+
+static void
+result_merge(
+    perf_result_t *into,
+    perf_result_t *from
+    )
+{
+    unsigned32 i;
+
+    for (i = 0; i < from->count; i++)
+    {
+        result_add(into, from->samples[i]);
+    }
+    into->bytes += from->bytes;
+    into->failures += from->failures;
+}
+
+static void
+result_free(
+    perf_result_t *result
+    )
+{
+    free(result->samples);
+    result->samples = NULL;
+}
+
+static int
+compare_samples(
+    const void *a,
+    const void *b
+    )
+{
+    unsigned64 x = *(const unsigned64 *) a;
+    unsigned64 y = *(const unsigned64 *) b;
+
+    return (x > y) - (x < y);
+}
+
+static double
+percentile_us(
+    perf_result_t *result,
+    double pct
+    )
+{
+    unsigned32 index;
+
+    if (result->count == 0)
+    {
+        return 0.0;
+    }
+
+    index = (unsigned32) (pct / 100.0 * (result->count - 1) + 0.5);
+
+    return result->samples[index] / 1000.0;
+}
+
+static void
+print_header(void)
+{
+    printf("%-14s %-24s %8s %10s %9s %9s %9s %9s %9s %9s\n",
+           "protseq", "test", "calls", "calls/s", "MB/s",
+           "p50(us)", "p90(us)", "p99(us)", "p99.9(us)", "max(us)");
+}
+
+static void
+print_result(
+    const char *protseq,
+    const char *test,
+    perf_result_t *result
+    )
+{
+    double secs = result->elapsed / 1e9;
+
+    qsort(result->samples, result->count, sizeof(*result->samples),
+          compare_samples);
+
+    printf("%-14s %-24s %8u %10.0f %9.2f %9.1f %9.1f %9.1f %9.1f %9.1f",
+           protseq,
+           test,
+           result->count,
+           secs > 0 ? result->count / secs : 0.0,
+           secs > 0 ? result->bytes / secs / (1024.0 * 1024.0) : 0.0,
+           percentile_us(result, 50.0),
+           percentile_us(result, 90.0),
+           percentile_us(result, 99.0),
+           percentile_us(result, 99.9),
+           percentile_us(result, 100.0));
+
+    if (result->failures)
+    {
+        printf("  (%u failed)", result->failures);
+        total_failures += result->failures;
+    }
+
+    printf("\n");
+    fflush(stdout);
+}
+
+/*=========================================================================
+ *
+ * Server
+ *
+ *=========================================================================*/
+
+#define CONTEXT_MAGIC 0xfeedf00d
+
+struct perf_context
+{
+    unsigned32 magic;
+    unsigned32 data;
+};
+
+static void
+mgr_init(
+    handle_t h ATTRIBUTE_UNUSED
+    )
+{
+}
+
+static void
+mgr_info(
+    handle_t h ATTRIBUTE_UNUSED,
+    unsigned32 *n,
+    unsigned32 *nm,
+    unsigned32 *nb,
+    unsigned32 *nbm
+    )
+{
+    *n = *nm = *nb = *nbm = 0;
+}
+
+static void
+mgr_null(
+    handle_t h ATTRIBUTE_UNUSED
+    )
+{
+}
+
+static void
+mgr_in(
+    handle_t h ATTRIBUTE_UNUSED,
+    perf_data_t d,
+    unsigned32 l,
+    idl_boolean verify,
+    unsigned32 *sum
+    )
+{
+    unsigned32 i, rsum;
+
+    if (!verify)
+    {
+        *sum = 0;
+        return;
+    }
+
+    for (i = 0, rsum = 0; i < l; i++)
+    {
+        rsum += d[i];
+    }
+
+    *sum = rsum;
+}
+
+static void
+mgr_out(
+    handle_t h ATTRIBUTE_UNUSED,
+    perf_data_t d,
+    unsigned32 *l,
+    unsigned32 m,
+    unsigned32 pass,
+    idl_boolean verify
+    )
+{
+    unsigned32 i;
+
+    if (*l > m)
+    {
+        *l = m;
+    }
+
+    if (verify)
+    {
+        for (i = 0; i < *l; i++)
+        {
+            d[i] = i * perf_magic * pass;
+        }
+    }
+}
+
+static void
+mgr_brd(
+    handle_t h ATTRIBUTE_UNUSED,
+    idl_char *name
+    )
+{
+    name[0] = '\0';
+}
+
+static void
+mgr_fp_test(
+    handle_t h ATTRIBUTE_UNUSED,
+    float *f1,
+    float *f2,
+    double d1,
+    double d2,
+    float *o1,
+    double *o2
+    )
+{
+    *o1 = *f1 / *f2;
+    *o2 = d1 / d2;
+}
+
+static void
+mgr_register_b(
+    handle_t h ATTRIBUTE_UNUSED,
+    idl_boolean global ATTRIBUTE_UNUSED,
+    unsigned32 *st
+    )
+{
+    *st = rpc_s_not_supported;
+}
+
+static void
+mgr_unregister_b(
+    handle_t h ATTRIBUTE_UNUSED,
+    unsigned32 *st
+    )
+{
+    *st = rpc_s_not_supported;
+}
+
+static void
+mgr_null_slow(
+    handle_t h ATTRIBUTE_UNUSED,
+    perf_slow_mode_t mode ATTRIBUTE_UNUSED,
+    unsigned32 secs
+    )
+{
+    sleep(secs);
+}
+
+static void
+mgr_shutdown(
+    handle_t h ATTRIBUTE_UNUSED
+    )
+{
+    unsigned32 st;
+
+    rpc_mgmt_stop_server_listening(NULL, &st);
+}
+
+static void
+mgr_call_callback(
+    handle_t h ATTRIBUTE_UNUSED,
+    unsigned32 idem ATTRIBUTE_UNUSED
+    )
+{
+}
+
+static void
+mgr_get_context(
+    handle_t h ATTRIBUTE_UNUSED,
+    unsigned32 data,
+    perf_context_t *context
+    )
+{
+    struct perf_context *p;
+
+    p = malloc(sizeof(*p));
+    if (p == NULL)
+    {
+        *context = NULL;
+        return;
+    }
+
+    p->magic = CONTEXT_MAGIC;
+    p->data = data;
+
+    *context = (perf_context_t) p;
+}
+
+static idl_boolean
+mgr_test_context(
+    perf_context_t context,
+    unsigned32 *data
+    )
+{
+    struct perf_context *p = (struct perf_context *) context;
+
+    if (p == NULL || p->magic != CONTEXT_MAGIC)
+    {
+        return false;
+    }
+
+    *data = p->data;
+
+    return true;
+}
+
+static idl_boolean
+mgr_free_context(
+    perf_context_t *context,
+    unsigned32 *data
+    )
+{
+    struct perf_context *p = (struct perf_context *) *context;
+
+    *context = NULL;
+
+    if (p == NULL || p->magic != CONTEXT_MAGIC)
+    {
+        return false;
+    }
+
+    *data = p->data;
+
+    free(p);
+
+    return true;
+}
+
+static void
+mgr_shutdown2(
+    handle_t h,
+    unsigned32 secs ATTRIBUTE_UNUSED
+    )
+{
+    mgr_shutdown(h);
+}
+
+void
+perf_context_t_rundown(
+    rpc_ss_context_t context
+    )
+{
+    struct perf_context *p = (struct perf_context *) context;
+
+    if (p != NULL && p->magic == CONTEXT_MAGIC)
+    {
+        free(p);
+    }
+}
+
+static perf_v2_0_epv_t perf_mgr_epv =
+{
+    mgr_init,
+    mgr_info,
+    mgr_null,
+    mgr_null,
+    mgr_in,
+    mgr_in,
+    mgr_out,
+    mgr_out,
+    mgr_brd,
+    mgr_null,
+    mgr_null,
+    mgr_fp_test,
+    mgr_register_b,
+    mgr_unregister_b,
+    mgr_null,
+    mgr_null_slow,
+    mgr_null_slow,
+    mgr_shutdown,
+    mgr_call_callback,
+    mgr_get_context,
+    mgr_test_context,
+    mgr_free_context,
+    mgr_shutdown2,
+    mgr_null
+};
+
+/*
+ * Find the server's binding for protseq and turn it into a loopback
+ * string binding the client can use.
+ */
+static int
+server_binding_string(
+    const char *protseq,
+    char *buffer,
+    size_t size
+    )
+{
+    rpc_binding_vector_p_t bindings = NULL;
+    unsigned char *string_binding = NULL;
+    unsigned char *b_protseq = NULL;
+    unsigned char *b_endpoint = NULL;
+    unsigned char *loopback = NULL;
+    unsigned32 st, st2;
+    unsigned32 i;
+    int found = 0;
+
+    rpc_server_inq_bindings(&bindings, &st);
+    chk_dce_err(st, "rpc_server_inq_bindings()", 1);
+
+    for (i = 0; !found && i < bindings->count; i++)
+    {
+        rpc_binding_to_string_binding(bindings->binding_h[i],
+                                      &string_binding,
+                                      &st);
+        if (st != rpc_s_ok)
+        {
+            continue;
+        }
+
+        rpc_string_binding_parse(string_binding, NULL, &b_protseq, NULL,
+                                 &b_endpoint, NULL, &st);
+        if (st == rpc_s_ok &&
+            !strcmp((char *) b_protseq, protseq) &&
+            b_endpoint != NULL)
+        {
+            rpc_string_binding_compose(NULL,
+                                       (unsigned char *) protseq,
+                                       (unsigned char *)
+                                       (strcmp(protseq, PROTOCOL_TCP) ?
+                                        NULL : "127.0.0.1"),
+                                       b_endpoint,
+                                       NULL,
+                                       &loopback,
+                                       &st);
+            if (st == rpc_s_ok && strlen((char *) loopback) < size)
+            {
+                strcpy(buffer, (char *) loopback);
+                found = 1;
+            }
+            rpc_string_free(&loopback, &st2);
+        }
+
+        rpc_string_free(&b_protseq, &st2);
+        rpc_string_free(&b_endpoint, &st2);
+        rpc_string_free(&string_binding, &st2);
+    }
+
+    rpc_binding_vector_free(&bindings, &st);
+
+    return found ? 0 : -1;
+}
+
+/*
+ * Run the server. Once it is ready, the string binding clients should
+ * use is written to ready_fd (if not -1) or stdout.
+ */
+static int
+run_server(
+    const char *protseq,
+    const char *endpoint,
+    int ready_fd
+    )
+{
+    unsigned32 st;
+    char binding[MAX_BINDING];
+    size_t length;
+
+    if (options.rcvr_threads)
+    {
+        rpc_mgmt_set_server_rcvr_threads(options.rcvr_threads, &st);
+        chk_dce_err(st, "rpc_mgmt_set_server_rcvr_threads()", 1);
+    }
+
+    rpc_server_register_if(perf_v2_0_s_ifspec,
+                           NULL,
+                           (rpc_mgr_epv_t) &perf_mgr_epv,
+                           &st);
+    chk_dce_err(st, "rpc_server_register_if()", 1);
+
+    if (endpoint)
+    {
+        rpc_server_use_protseq_ep((unsigned char *) protseq,
+                                  options.max_calls,
+                                  (unsigned char *) endpoint,
+                                  &st);
+        chk_dce_err(st, "rpc_server_use_protseq_ep()", 1);
+    }
+    else
+    {
+        rpc_server_use_protseq((unsigned char *) protseq,
+                               options.max_calls,
+                               &st);
+        chk_dce_err(st, "rpc_server_use_protseq()", 1);
+    }
+
+    if (server_binding_string(protseq, binding, sizeof(binding)) < 0)
+    {
+        fprintf(stderr, "no %s binding for the server\n", protseq);
+        return 1;
+    }
+
+    if (ready_fd >= 0)
+    {
+        length = strlen(binding) + 1;
+        if (write(ready_fd, binding, length) != (ssize_t) length)
+        {
+            return 1;
+        }
+        close(ready_fd);
+    }
+    else
+    {
+        printf("%s\n", binding);
+        fflush(stdout);
+    }
+
+    DCETHREAD_TRY
+    {
+        rpc_server_listen(options.max_calls, &st);
+    }
+    DCETHREAD_CATCH_ALL(THIS_CATCH)
+    {
+        st = rpc_s_ok;
+    }
+    DCETHREAD_ENDTRY;
+
+    rpc_server_unregister_if(perf_v2_0_s_ifspec, NULL, &st);
+
+    return 0;
+}
+
+/*
+ * Start a server for protseq in a child process and return the string
+ * binding to reach it.
+ */
+static pid_t
+start_server(
+    const char *protseq,
+    const char *endpoint,
+    char *binding,
+    size_t size
+    )
+{
+    int fds[2];
+    pid_t pid;
+    size_t got = 0;
+    ssize_t n;
+
+    if (pipe(fds) < 0)
+    {
+        perror("pipe");
+        exit(1);
+    }
+
+    pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        exit(1);
+    }
+
+    if (pid == 0)
+    {
+        close(fds[0]);
+        exit(run_server(protseq, endpoint, fds[1]));
+    }
+
+    close(fds[1]);
+
+    while (got < size && (n = read(fds[0], binding + got, size - got)) > 0)
+    {
+        got += n;
+        if (binding[got - 1] == '\0')
+        {
+            break;
+        }
+    }
+
+    close(fds[0]);
+
+    if (got == 0 || binding[got - 1] != '\0')
+    {
+        fprintf(stderr, "%s server failed to start\n", protseq);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+
+    return pid;
+}
+
+/*=========================================================================
+ *
+ * Client
+ *
+ *=========================================================================*/
+
+static rpc_binding_handle_t
+client_bind(
+    const char *string_binding
+    )
+{
+    rpc_binding_handle_t h = NULL;
+    unsigned32 st;
+
+    rpc_binding_from_string_binding((unsigned char *) string_binding,
+                                    &h,
+                                    &st);
+    chk_dce_err(st, "rpc_binding_from_string_binding()", 1);
+
+    return h;
+}
+
+static void
+client_unbind(
+    rpc_binding_handle_t *h
+    )
+{
+    unsigned32 st;
+
+    rpc_binding_free(h, &st);
+}
+
+/*
+ * Each test body makes one measured call (or sequence of calls) and
+ * returns the number of payload bytes moved, or -1 if it failed.
+ */
+typedef long (*perf_test_fn_t)(
+    rpc_binding_handle_t h,
+    unsigned32 pass,
+    void *arg
+    );
+
+static long
+test_null(
+    rpc_binding_handle_t h,
+    unsigned32 pass ATTRIBUTE_UNUSED,
+    void *arg ATTRIBUTE_UNUSED
+    )
+{
+    perf_null(h);
+
+    return 0;
+}
+
+typedef struct
+{
+    unsigned32 *data;
+    unsigned32 count;
+    unsigned32 expected_sum;
+} perf_array_arg_t;
+
+static long
+test_in(
+    rpc_binding_handle_t h,
+    unsigned32 pass ATTRIBUTE_UNUSED,
+    void *arg
+    )
+{
+    perf_array_arg_t *a = arg;
+    unsigned32 sum = 0;
+
+    perf_in(h, a->data, a->count, true, &sum);
+
+    if (sum != a->expected_sum)
+    {
+        return -1;
+    }
+
+    return (long) a->count * sizeof(unsigned32);
+}
+
+static long
+test_out(
+    rpc_binding_handle_t h,
+    unsigned32 pass,
+    void *arg
+    )
+{
+    perf_array_arg_t *a = arg;
+    unsigned32 length = a->count;
+    unsigned32 i;
+
+    perf_out(h, a->data, &length, a->count, pass, true);
+
+    if (length != a->count)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < length; i += 97)
+    {
+        if (a->data[i] != i * perf_magic * pass)
+        {
+            return -1;
+        }
+    }
+
+    return (long) length * sizeof(unsigned32);
+}
+
+static long
+test_context(
+    rpc_binding_handle_t h,
+    unsigned32 pass,
+    void *arg ATTRIBUTE_UNUSED
+    )
+{
+    perf_context_t context = NULL;
+    unsigned32 data = 0;
+
+    perf_get_context(h, pass, &context);
+
+    if (!perf_test_context(context, &data) || data != pass)
+    {
+        return -1;
+    }
+
+    if (!perf_free_context(&context, &data) || data != pass)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+static void
+run_test(
+    rpc_binding_handle_t h,
+    unsigned32 calls,
+    perf_test_fn_t fn,
+    void *arg,
+    perf_result_t *result
+    )
+{
+    unsigned32 pass;
+    unsigned64 start, begin;
+    volatile long bytes;
+
+    begin = now_ns();
+
+    for (pass = 1; pass <= calls; pass++)
+    {
+        start = now_ns();
+
+        DCETHREAD_TRY
+        {
+            bytes = fn(h, pass, arg);
+        }
+        DCETHREAD_CATCH_ALL(THIS_CATCH)
+        {
+            bytes = -1;
+        }
+        DCETHREAD_ENDTRY;
+
+        if (bytes < 0)
+        {
+            result->failures++;
+            continue;
+        }
+
+        result_add(result, now_ns() - start);
+        result->bytes += bytes;
+    }
+
+    result->elapsed = now_ns() - begin;
+}
+
+/*
+ * Connect to the server at binding without going through the runtime
+ * and send the start of a bind PDU whose header promises more than is
+ * sent. The server is left holding a partial fragment on the
+ * connection for as long as it stays open.
+ */
+static int
+open_stalled(
+    const char *binding
+    )
+{
+    static const unsigned char partial_bind[] =
+    {
+        5, 0, 11, 3,                /* v5.0 bind, first and last frag */
+        0x10, 0, 0, 0,              /* little endian, ASCII, IEEE */
+        72, 0,                      /* frag_length */
+        0, 0,                       /* auth_length */
+        1, 0, 0, 0                  /* call_id */
+    };
+    unsigned char *protseq = NULL;
+    unsigned char *endpoint = NULL;
+    struct sockaddr_in addr_in;
+    struct sockaddr_un addr_un;
+    unsigned32 st;
+    int fd = -1;
+
+    rpc_string_binding_parse((unsigned char *) binding, NULL, &protseq,
+                             NULL, &endpoint, NULL, &st);
+    chk_dce_err(st, "rpc_string_binding_parse()", 1);
+
+    if (!strcmp((char *) protseq, PROTOCOL_TCP))
+    {
+        memset(&addr_in, 0, sizeof(addr_in));
+        addr_in.sin_family = AF_INET;
+        addr_in.sin_port = htons(atoi((char *) endpoint));
+        addr_in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *) &addr_in, sizeof(addr_in)) < 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    else if (!strcmp((char *) protseq, PROTOCOL_NCALRPC) &&
+             strlen((char *) endpoint) < sizeof(addr_un.sun_path))
+    {
+        memset(&addr_un, 0, sizeof(addr_un));
+        addr_un.sun_family = AF_UNIX;
+        strcpy(addr_un.sun_path, (char *) endpoint);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *) &addr_un, sizeof(addr_un)) < 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    rpc_string_free(&protseq, &st);
+    rpc_string_free(&endpoint, &st);
+
+    if (fd < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+
+    if (write(fd, partial_bind, sizeof(partial_bind)) !=
+        (ssize_t) sizeof(partial_bind))
+    {
+        perror("write");
+        exit(1);
+    }
+
+    return fd;
+}
+
+static void *
+client_thread(
+    void *arg
+    )
+{
+    perf_client_t *client = arg;
+    rpc_binding_handle_t h = client_bind(client->binding);
+
+    /*
+     * Connect before the clock starts.
+     */
+    DCETHREAD_TRY
+    {
+        perf_null(h);
+    }
+    DCETHREAD_CATCH_ALL(THIS_CATCH)
+    {
+    }
+    DCETHREAD_ENDTRY;
+
+    pthread_mutex_lock(client->start_lock);
+    while (!*client->started)
+    {
+        pthread_cond_wait(client->start_cond, client->start_lock);
+    }
+    pthread_mutex_unlock(client->start_lock);
+
+    run_test(h, client->calls, test_null, NULL, &client->result);
+
+    client_unbind(&h);
+
+    return NULL;
+}
+
+static void
+run_concurrent(
+    const char *protseq,
+    const char *binding,
+    unsigned32 clients,
+    unsigned32 calls
+    )
+{
+    perf_client_t client[MAX_CLIENTS];
+    pthread_t thread[MAX_CLIENTS];
+    pthread_mutex_t start_lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+    int started = 0;
+    int stalled[MAX_STALLED];
+    perf_result_t total;
+    unsigned64 begin;
+    unsigned32 i;
+    char test[64];
+
+    /*
+     * Stalled peers go first so that they are holding partial
+     * fragments on the server before any client connects.
+     */
+    for (i = 0; i < options.stalled; i++)
+    {
+        stalled[i] = open_stalled(binding);
+    }
+
+    for (i = 0; i < clients; i++)
+    {
+        client[i].binding = binding;
+        client[i].calls = calls;
+        client[i].start_lock = &start_lock;
+        client[i].start_cond = &start_cond;
+        client[i].started = &started;
+        result_init(&client[i].result, calls);
+
+        if (pthread_create(&thread[i], NULL, client_thread, &client[i]) != 0)
+        {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+
+    /*
+     * Give the clients a moment to connect, then release them all.
+     */
+    sleep(1);
+
+    pthread_mutex_lock(&start_lock);
+    started = 1;
+    begin = now_ns();
+    pthread_cond_broadcast(&start_cond);
+    pthread_mutex_unlock(&start_lock);
+
+    result_init(&total, clients * calls);
+
+    for (i = 0; i < clients; i++)
+    {
+        pthread_join(thread[i], NULL);
+        result_merge(&total, &client[i].result);
+        result_free(&client[i].result);
+    }
+
+    total.elapsed = now_ns() - begin;
+
+    for (i = 0; i < options.stalled; i++)
+    {
+        close(stalled[i]);
+    }
+
+    if (options.stalled)
+    {
+        snprintf(test, sizeof(test), "null x%u clients, %u stalled",
+                 clients, options.stalled);
+    }
+    else
+    {
+        snprintf(test, sizeof(test), "null x%u clients", clients);
+    }
+    print_result(protseq, test, &total);
+    result_free(&total);
+}
+
+static void
+run_suite(
+    const char *protseq,
+    const char *binding
+    )
+{
+    rpc_binding_handle_t h = client_bind(binding);
+    perf_result_t result;
+    perf_array_arg_t array;
+    unsigned32 frag = options.frag_size;
+    unsigned32 calls;
+    unsigned32 i, j;
+    char test[64];
+
+    /*
+     * Payload sizes in bytes: within one fragment, either side of the
+     * fragment boundary, and spanning many fragments. perf_data_t is a
+     * v1_array, so stay under 64K elements.
+     */
+    const unsigned32 payloads[] =
+    {
+        frag / 4,
+        frag - 256,
+        frag + 256,
+        2 * frag,
+        4 * frag,
+        16 * frag,
+        30 * frag
+    };
+
+    /*
+     * Warm up the association.
+     */
+    run_test(h, 1, test_null, NULL, &(perf_result_t) { 0 });
+
+    result_init(&result, options.calls);
+    run_test(h, options.calls, test_null, NULL, &result);
+    print_result(protseq, "null", &result);
+    result_free(&result);
+
+    array.data = malloc(payloads[sizeof(payloads) / sizeof(payloads[0]) - 1]);
+    if (array.data == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for (i = 0; i < sizeof(payloads) / sizeof(payloads[0]); i++)
+    {
+        array.count = payloads[i] / sizeof(unsigned32);
+        array.expected_sum = 0;
+        for (j = 0; j < array.count; j++)
+        {
+            array.data[j] = j;
+            array.expected_sum += j;
+        }
+
+        /*
+         * Keep the total volume per test roughly constant.
+         */
+        calls = options.calls;
+        if (payloads[i] > frag)
+        {
+            calls = options.calls * frag / payloads[i];
+        }
+        if (calls < 20)
+        {
+            calls = 20;
+        }
+
+        result_init(&result, calls);
+        run_test(h, calls, test_in, &array, &result);
+        snprintf(test, sizeof(test), "in %u bytes", payloads[i]);
+        print_result(protseq, test, &result);
+        result_free(&result);
+
+        result_init(&result, calls);
+        run_test(h, calls, test_out, &array, &result);
+        snprintf(test, sizeof(test), "out %u bytes", payloads[i]);
+        print_result(protseq, test, &result);
+        result_free(&result);
+    }
+
+    free(array.data);
+
+    result_init(&result, options.calls);
+    run_test(h, options.calls, test_context, NULL, &result);
+    print_result(protseq, "context get/test/free", &result);
+    result_free(&result);
+
+    client_unbind(&h);
+
+    if (options.clients > 1)
+    {
+        run_concurrent(protseq, binding, options.clients,
+                       options.calls / options.clients > 100 ?
+                       options.calls / options.clients : 100);
+    }
+}
+
+static void
+stop_server(
+    const char *binding
+    )
+{
+    rpc_binding_handle_t h = client_bind(binding);
+
+    DCETHREAD_TRY
+    {
+        perf_shutdown(h);
+    }
+    DCETHREAD_CATCH_ALL(THIS_CATCH)
+    {
+    }
+    DCETHREAD_ENDTRY;
+
+    client_unbind(&h);
+}
+
+/*=========================================================================
+ *
+ * Main
+ *
+ *=========================================================================*/
+
+/*
+ * A receiver that has stopped dispatching leaves the clients waiting
+ * forever; fail the run instead.
+ */
+static void
+watchdog(
+    int sig
+    )
+{
+    static const char msg[] = "rpcperf: timed out, receiver hung?\n";
+
+    if (write(2, msg, sizeof(msg) - 1) < 0)
+    {
+        /* nothing more we can do */
+    }
+
+    if (server_pid > 0)
+    {
+        kill(server_pid, SIGKILL);
+    }
+
+    _exit(2);
+}
+
+static void usage()
+{
+    printf("usage: rpcperf [-l] [-t] [-e endpoint] [-n calls] [-c clients]\n"
+           "               [-f frag_size] [-r threads [-s stalled]] [-v]\n"
+           "               [-S | -b binding]\n");
+    printf("         -l:  use ncalrpc protocol\n");
+    printf("         -t:  use TCP protocol\n");
+    printf("              (default: run the suite over both)\n");
+    printf("         -e:  server endpoint (default: dynamic, or a socket in\n");
+    printf("              /tmp for ncalrpc)\n");
+    printf("         -n:  calls per test (default %u)\n", options.calls);
+    printf("         -c:  concurrent clients, 1 to skip (default %u)\n",
+           options.clients);
+    printf("         -f:  fragment size the payloads are based on (default %u)\n",
+           options.frag_size);
+    printf("         -r:  receiver threads the server's connections share\n");
+    printf("              (default: a receiver thread per connection)\n");
+    printf("         -s:  hold this many connections with a partial fragment\n");
+    printf("              open during the concurrent clients test\n");
+    printf("         -S:  only run a server and print its binding\n");
+    printf("         -b:  only run the client against the server at binding\n");
+    printf("         -v:  print the bindings used\n");
+    printf("\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *protseqs[2];
+    unsigned32 nprotseqs = 0;
+    unsigned32 i;
+    char *client_binding = NULL;
+    int server_only = 0;
+    char binding[MAX_BINDING];
+    char endpoint[64];
+    const char *ep;
+    pid_t pid;
+    int status;
+    int ret = 0;
+    int c;
+
+    while ((c = getopt(argc, argv, "lte:n:c:f:r:s:Sb:v")) != EOF)
+    {
+        switch (c)
+        {
+        case 'l':
+            protseqs[nprotseqs++ % 2] = PROTOCOL_NCALRPC;
+            break;
+        case 't':
+            protseqs[nprotseqs++ % 2] = PROTOCOL_TCP;
+            break;
+        case 'e':
+            options.endpoint = optarg;
+            break;
+        case 'n':
+            options.calls = strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            options.clients = strtoul(optarg, NULL, 0);
+            break;
+        case 'f':
+            options.frag_size = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            options.rcvr_threads = strtol(optarg, NULL, 0);
+            break;
+        case 's':
+            options.stalled = strtoul(optarg, NULL, 0);
+            break;
+        case 'S':
+            server_only = 1;
+            break;
+        case 'b':
+            client_binding = optarg;
+            break;
+        case 'v':
+            options.verbose = 1;
+            break;
+        default:
+            usage();
+        }
+    }
+
+    if (nprotseqs > 2 ||
+        options.calls == 0 ||
+        options.clients == 0 || options.clients > MAX_CLIENTS ||
+        options.frag_size < 1024 || options.frag_size > 8192 ||
+        options.stalled > MAX_STALLED ||
+        (options.stalled && (options.rcvr_threads == 0 ||
+                             options.clients < 2)))
+    {
+        usage();
+    }
+
+    if (client_binding)
+    {
+        print_header();
+        run_suite("(remote)", client_binding);
+        return total_failures ? 1 : 0;
+    }
+
+    if (nprotseqs == 0)
+    {
+        protseqs[nprotseqs++] = PROTOCOL_NCALRPC;
+        protseqs[nprotseqs++] = PROTOCOL_TCP;
+    }
+
+    /*
+     * A stopped server shouldn't take us down with it.
+     */
+    signal(SIGPIPE, SIG_IGN);
+
+    if (server_only)
+    {
+        return run_server(protseqs[0], options.endpoint, -1);
+    }
+
+    if (options.rcvr_threads)
+    {
+        signal(SIGALRM, watchdog);
+        alarm(RCVR_WATCHDOG_SECS);
+    }
+
+    print_header();
+
+    for (i = 0; i < nprotseqs; i++)
+    {
+        ep = options.endpoint;
+        if (!ep && !strcmp(protseqs[i], PROTOCOL_NCALRPC))
+        {
+            snprintf(endpoint, sizeof(endpoint), "/tmp/.rpcperf-%ld",
+                     (long) getpid());
+            ep = endpoint;
+        }
+
+        pid = start_server(protseqs[i], ep, binding, sizeof(binding));
+        if (pid < 0)
+        {
+            ret = 1;
+            continue;
+        }
+        server_pid = pid;
+
+        if (options.verbose)
+        {
+            printf("# %s\n", binding);
+        }
+
+        run_suite(protseqs[i], binding);
+        stop_server(binding);
+
+        if (waitpid(pid, &status, 0) < 0 ||
+            !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            fprintf(stderr, "%s server did not exit cleanly\n", protseqs[i]);
+            ret = 1;
+        }
+        server_pid = -1;
+
+        if (ep == endpoint)
+        {
+            unlink(endpoint);
+        }
+    }
+
+    if (total_failures)
+    {
+        ret = 1;
+    }
+
+    return ret;
+}
@@ -67,6 +67,7 @@ extern DWORD gdwNewEventCount;
 #define EVT_DEFAULT_MAX_RECORDS     100000	//100k,converting it 100 * 1000
 #define EVT_DEFAULT_MAX_AGE         90 //days
 #define EVT_DEFAULT_PURGE_INTERVAL  1 //days
+#define EVT_DEFAULT_RECEIVER_THREADS 4
 #define EVT_MAINTAIN_EVENT_COUNT  50
 
 #endif /* __SERVER_EXTERNS_H__ */
@@ -91,6 +91,12 @@ EVTGetRegisterTcpIp(
     PBOOLEAN pbRegisterTcpIp
     );
 
+static
+DWORD
+EVTGetReceiverThreads(
+    PDWORD pdwReceiverThreads
+    );
+
 static
 void
 EVTExitHandler(
@@ -429,6 +435,23 @@ EVTGetRegisterTcpIp(
     return (dwError);
 }
 
+static
+DWORD
+EVTGetReceiverThreads(
+    PDWORD pdwReceiverThreads
+    )
+{
+    DWORD dwError = 0;
+
+    EVT_LOCK_SERVERINFO;
+
+    *pdwReceiverThreads = gServerInfo.dwReceiverThreads;
+
+    EVT_UNLOCK_SERVERINFO;
+
+    return (dwError);
+}
+
 DWORD
 EVTGetPrefixPath(
     PSTR* ppszPath
@@ -827,6 +850,7 @@ EVTSetConfigDefaults()
     gServerInfo.dwMaxRecords =  EVT_DEFAULT_MAX_RECORDS;
     gServerInfo.dwMaxAge = EVT_DEFAULT_MAX_AGE;
     gServerInfo.dwPurgeInterval = EVT_DEFAULT_PURGE_INTERVAL;
+    gServerInfo.dwReceiverThreads = EVT_DEFAULT_RECEIVER_THREADS;
 
     EVTFreeSecurityDescriptor(gServerInfo.pAccess);
     gServerInfo.pAccess = NULL;
@@ -963,6 +987,15 @@ static EVT_CONFIG_TABLE gConfigDescription[] =
         NULL,
         &(gServerInfo.bRegisterTcpIp)
     },
+    {
+        "ReceiverThreads",
+        TRUE,
+        EVTTypeDword,
+        0,
+        256,
+        NULL,
+        &(gServerInfo.dwReceiverThreads)
+    },
     {
         "AllowReadTo",
         TRUE,
@@ -1008,6 +1041,7 @@ EVTLogConfigReload(
                  "     Max Event Lifespan:              %d\r\n" \
                  "     Remove Events As Needed:         %s\r\n" \
                  "     Register TCP/IP RPC endpoints:   %s\r\n" \
+                 "     RPC receiver threads:            %d\r\n" \
                  "     Allow Read   To :                %s\r\n" \
                  "     Allow Write  To :                %s\r\n" \
                  "     Allow Delete To :                %s\r\n",
@@ -1016,6 +1050,7 @@ EVTLogConfigReload(
                  gServerInfo.dwMaxAge,
                  gServerInfo.bRemoveAsNeeded? "true" : "false",
                  gServerInfo.bRegisterTcpIp ? "true" : "false",
+                 gServerInfo.dwReceiverThreads,
                  gServerInfo.pszAllowReadTo ?
                     gServerInfo.pszAllowReadTo: "",
                  gServerInfo.pszAllowWriteTo ?
@@ -1750,6 +1785,8 @@ main(
     };
     BOOLEAN bExitNow = FALSE;
     BOOLEAN bRegisterTcpIp = TRUE;
+    DWORD dwReceiverThreads = 0;
+    unsigned32 rpcStatus = 0;
 
     setlocale(LC_ALL, "");
 
@@ -1802,6 +1839,20 @@ main(
     dwError = EVTGetRegisterTcpIp(&bRegisterTcpIp);
     BAIL_ON_EVT_ERROR(dwError);
 
+    dwError = EVTGetReceiverThreads(&dwReceiverThreads);
+    BAIL_ON_EVT_ERROR(dwError);
+
+    /* Has to be set before any endpoint is registered */
+    if (dwReceiverThreads)
+    {
+        rpc_mgmt_set_server_rcvr_threads(dwReceiverThreads, &rpcStatus);
+        if (rpcStatus)
+        {
+            EVT_LOG_ERROR("Failed to set up shared RPC receiver threads. "
+                          "Error code: [%u]\n", rpcStatus);
+        }
+    }
+
     dwError = SrvInitEventDatabase();
     BAIL_ON_EVT_ERROR(dwError);
 
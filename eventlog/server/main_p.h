@@ -88,6 +88,8 @@ typedef struct {
     BOOLEAN bRemoveAsNeeded;
     /* Flag to Register TCP/IP RPC endpoints */
     BOOLEAN bRegisterTcpIp;
+    /* Threads shared by RPC connections, 0 for a thread per connection */
+    DWORD dwReceiverThreads;
 
     /* Who is allowed to read, write, and delete events. The security
      * descriptor is set when all of the users/groups can be resolved. */
@@ -87,5 +87,10 @@ krb5_error_code krb5_rc_register_type(krb5_context, const krb5_rc_ops *);
 
 extern const krb5_rc_ops krb5_rc_dfl_ops;
 extern const krb5_rc_ops krb5_rc_none_ops;
+extern const krb5_rc_ops krb5_rc_mem_ops;
+
+int krb5int_rc_mem_finish_init(void);
+
+void krb5int_rc_mem_terminate(void);
 
 #endif /* __KRB5_RCACHE_INT_H__ */
@@ -0,0 +1,388 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* lib/krb5/rcache/rc_mem.c */
+/*
+ * Copyright Likewise Software
+ * All rights reserved.
+ *
+ * This file may be used, modified and redistributed under the same
+ * terms as the rest of this MIT Kerberos distribution; see NOTICE.
+ */
+
+/*
+ * In-memory replay cache implementation
+ *
+ * All "memory" replay caches in a process share one store, so a replay
+ * is caught no matter which handle (or which acceptor credential) sees
+ * it.  Nothing is written to disk: replay detection only covers the
+ * life of the process, which is what a long-running acceptor wants in
+ * exchange for not paying an fsync per authentication.
+ *
+ * The store is split into stripes selected by the record hash, each
+ * with its own lock and hash table, so concurrent acceptors rarely
+ * contend.  Within a stripe, records are also threaded onto a ring of
+ * time buckets keyed by expiry time; a bucket whose time has passed is
+ * freed as a whole, without walking the hash table.  The ring grows to
+ * cover the longest lifespan it is asked to hold.
+ */
+
+#include "k5-int.h"
+#include "rc-int.h"
+
+#define MEM_STRIPES     16
+#define MEM_HASHSIZE    1021    /* per stripe */
+#define MEM_BUCKET_SECS 30
+#define MEM_NBUCKETS    64      /* initial ring size; doubled as needed */
+
+struct mem_entry {
+    struct mem_entry *hnext;    /* hash chain */
+    struct mem_entry **hprev;
+    struct mem_entry *bnext;    /* expiry bucket */
+    krb5_int32 expiry;
+    krb5_donot_replay rep;
+};
+
+struct mem_bucket {
+    krb5_int32 epoch;           /* expiry time / MEM_BUCKET_SECS */
+    struct mem_entry *head;
+};
+
+struct mem_stripe {
+    k5_mutex_t lock;
+    krb5_int32 swept;           /* epoch of the last sweep */
+    struct mem_entry *h[MEM_HASHSIZE];
+    struct mem_bucket *b;
+    int nbuckets;
+};
+
+struct mem_data {
+    char *name;
+    krb5_deltat lifespan;
+};
+
+static struct mem_stripe stripes[MEM_STRIPES];
+
+static unsigned int
+hash(krb5_donot_replay *rep)
+{
+    unsigned int h = rep->cusec * 31 + rep->ctime;
+    const char *p;
+
+    for (p = rep->client; *p; p++)
+        h = h * 31 + (unsigned char)*p;
+    for (p = rep->server; *p; p++)
+        h = h * 31 + (unsigned char)*p;
+    return h;
+}
+
+static int
+cmp(krb5_donot_replay *old, krb5_donot_replay *new1)
+{
+    if ((old->cusec == new1->cusec) && /* most likely to distinguish */
+        (old->ctime == new1->ctime) &&
+        (strcmp(old->client, new1->client) == 0) &&
+        (strcmp(old->server, new1->server) == 0)) {
+        /* If both records include message hashes, compare them as well. */
+        if (old->msghash == NULL || new1->msghash == NULL ||
+            strcmp(old->msghash, new1->msghash) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+static void
+free_entry(struct mem_entry *e)
+{
+    free(e->rep.client);
+    free(e->rep.server);
+    free(e->rep.msghash);
+    free(e);
+}
+
+/* Free every bucket of s whose records have all expired by now. */
+static void
+sweep_locked(struct mem_stripe *s, krb5_int32 now)
+{
+    krb5_int32 epoch = now / MEM_BUCKET_SECS;
+    struct mem_bucket *b;
+    struct mem_entry *e, *next;
+    int i;
+
+    if (s->swept == epoch)
+        return;
+    s->swept = epoch;
+
+    for (i = 0; i < s->nbuckets; i++) {
+        b = &s->b[i];
+        if (b->head == NULL || b->epoch >= epoch)
+            continue;
+        for (e = b->head; e != NULL; e = next) {
+            next = e->bnext;
+            *e->hprev = e->hnext;
+            if (e->hnext != NULL)
+                e->hnext->hprev = e->hprev;
+            free_entry(e);
+        }
+        b->head = NULL;
+    }
+}
+
+/* Thread e onto the bucket for its expiry time. */
+static void
+bucket_insert(struct mem_bucket *ring, int nbuckets, struct mem_entry *e)
+{
+    krb5_int32 epoch = e->expiry / MEM_BUCKET_SECS;
+    struct mem_bucket *b = &ring[epoch % nbuckets];
+
+    /*
+     * The ring spans every live epoch, so a bucket holding an older one
+     * has already been swept.  If the clock went backwards it may still
+     * hold a later one; keep that so no record is dropped early.
+     */
+    if (b->head == NULL || b->epoch < epoch)
+        b->epoch = epoch;
+    e->bnext = b->head;
+    b->head = e;
+}
+
+/*
+ * Make the ring of s span at least span seconds past the current epoch,
+ * rethreading the records already held.
+ */
+static krb5_error_code
+grow_locked(struct mem_stripe *s, krb5_int32 span)
+{
+    struct mem_bucket *ring;
+    struct mem_entry *e, *next;
+    int n, i;
+
+    n = s->nbuckets ? s->nbuckets : MEM_NBUCKETS;
+    while (n < span / MEM_BUCKET_SECS + 2)
+        n *= 2;
+    if (n == s->nbuckets)
+        return 0;
+
+    ring = calloc(n, sizeof(*ring));
+    if (ring == NULL)
+        return KRB5_RC_MALLOC;
+
+    for (i = 0; i < s->nbuckets; i++) {
+        for (e = s->b[i].head; e != NULL; e = next) {
+            next = e->bnext;
+            bucket_insert(ring, n, e);
+        }
+    }
+    free(s->b);
+    s->b = ring;
+    s->nbuckets = n;
+    return 0;
+}
+
+int
+krb5int_rc_mem_finish_init(void)
+{
+    int i, err;
+
+    for (i = 0; i < MEM_STRIPES; i++) {
+        err = k5_mutex_init(&stripes[i].lock);
+        if (err) {
+            while (--i >= 0)
+                k5_mutex_destroy(&stripes[i].lock);
+            return err;
+        }
+    }
+    return 0;
+}
+
+void
+krb5int_rc_mem_terminate(void)
+{
+    struct mem_entry *e, *next;
+    int i, j;
+
+    for (i = 0; i < MEM_STRIPES; i++) {
+        for (j = 0; j < stripes[i].nbuckets; j++) {
+            for (e = stripes[i].b[j].head; e != NULL; e = next) {
+                next = e->bnext;
+                free_entry(e);
+            }
+        }
+        memset(&stripes[i].h, 0, sizeof(stripes[i].h));
+        free(stripes[i].b);
+        stripes[i].b = NULL;
+        stripes[i].nbuckets = 0;
+        k5_mutex_destroy(&stripes[i].lock);
+    }
+}
+
+static krb5_error_code KRB5_CALLCONV
+krb5_rc_mem_init(krb5_context context, krb5_rcache id, krb5_deltat lifespan)
+{
+    struct mem_data *t = id->data;
+
+    /* default to clockskew from the context */
+    t->lifespan = lifespan ? lifespan : context->clockskew;
+    return 0;
+}
+#define krb5_rc_mem_recover_or_init krb5_rc_mem_init
+
+static krb5_error_code KRB5_CALLCONV
+krb5_rc_mem_recover(krb5_context context, krb5_rcache id)
+{
+    /* There is nothing on disk to recover. */
+    return krb5_rc_mem_init(context, id, 0);
+}
+
+static krb5_error_code KRB5_CALLCONV
+krb5_rc_mem_close(krb5_context context, krb5_rcache id)
+{
+    struct mem_data *t = id->data;
+
+    /* The records belong to the shared store and outlive the handle. */
+    free(t->name);
+    free(t);
+    k5_mutex_destroy(&id->lock);
+    free(id);
+    return 0;
+}
+#define krb5_rc_mem_destroy krb5_rc_mem_close
+
+static krb5_error_code KRB5_CALLCONV
+krb5_rc_mem_store(krb5_context context, krb5_rcache id, krb5_donot_replay *rep)
+{
+    struct mem_data *t = id->data;
+    struct mem_stripe *s;
+    struct mem_entry *e = NULL, **head;
+    krb5_error_code ret;
+    krb5_int32 now, expiry;
+    unsigned int h;
+
+    ret = krb5_timeofday(context, &now);
+    if (ret)
+        return ret;
+
+    expiry = rep->ctime + t->lifespan;
+
+    h = hash(rep);
+    s = &stripes[h % MEM_STRIPES];
+    head = &s->h[(h / MEM_STRIPES) % MEM_HASHSIZE];
+
+    k5_mutex_lock(&s->lock);
+    sweep_locked(s, now);
+
+    for (e = *head; e != NULL; e = e->hnext) {
+        if (cmp(&e->rep, rep)) {
+            k5_mutex_unlock(&s->lock);
+            return KRB5KRB_AP_ERR_REPEAT;
+        }
+    }
+
+    /* A record that has already expired need not be remembered. */
+    if (expiry < now) {
+        k5_mutex_unlock(&s->lock);
+        return 0;
+    }
+
+    if (s->nbuckets < (expiry - now) / MEM_BUCKET_SECS + 2) {
+        ret = grow_locked(s, expiry - now);
+        if (ret) {
+            k5_mutex_unlock(&s->lock);
+            return ret;
+        }
+    }
+
+    e = calloc(1, sizeof(*e));
+    if (e == NULL)
+        goto nomem;
+    e->expiry = expiry;
+    e->rep = *rep;
+    e->rep.client = e->rep.server = e->rep.msghash = NULL;
+    if (!(e->rep.client = strdup(rep->client)))
+        goto nomem;
+    if (!(e->rep.server = strdup(rep->server)))
+        goto nomem;
+    if (rep->msghash && !(e->rep.msghash = strdup(rep->msghash)))
+        goto nomem;
+
+    e->hnext = *head;
+    if (e->hnext != NULL)
+        e->hnext->hprev = &e->hnext;
+    e->hprev = head;
+    *head = e;
+
+    bucket_insert(s->b, s->nbuckets, e);
+
+    k5_mutex_unlock(&s->lock);
+    return 0;
+
+nomem:
+    k5_mutex_unlock(&s->lock);
+    if (e != NULL)
+        free_entry(e);
+    return KRB5_RC_MALLOC;
+}
+
+static krb5_error_code KRB5_CALLCONV
+krb5_rc_mem_expunge(krb5_context context, krb5_rcache id)
+{
+    krb5_error_code ret;
+    krb5_int32 now;
+    int i;
+
+    ret = krb5_timeofday(context, &now);
+    if (ret)
+        return ret;
+
+    for (i = 0; i < MEM_STRIPES; i++) {
+        k5_mutex_lock(&stripes[i].lock);
+        sweep_locked(&stripes[i], now);
+        k5_mutex_unlock(&stripes[i].lock);
+    }
+    return 0;
+}
+
+static krb5_error_code KRB5_CALLCONV
+krb5_rc_mem_get_span(krb5_context context, krb5_rcache id,
+                     krb5_deltat *lifespan)
+{
+    *lifespan = ((struct mem_data *)id->data)->lifespan;
+    return 0;
+}
+
+static char * KRB5_CALLCONV
+krb5_rc_mem_get_name(krb5_context context, krb5_rcache id)
+{
+    struct mem_data *t = id->data;
+
+    return t->name ? t->name : "";
+}
+
+static krb5_error_code KRB5_CALLCONV
+krb5_rc_mem_resolve(krb5_context context, krb5_rcache id, char *name)
+{
+    struct mem_data *t;
+
+    t = calloc(1, sizeof(*t));
+    if (t == NULL)
+        return KRB5_RC_MALLOC;
+    if (name && !(t->name = strdup(name))) {
+        free(t);
+        return KRB5_RC_MALLOC;
+    }
+    id->data = t;
+    return 0;
+}
+
+const krb5_rc_ops krb5_rc_mem_ops = {
+    0,
+    "memory",
+    krb5_rc_mem_init,
+    krb5_rc_mem_recover,
+    krb5_rc_mem_recover_or_init,
+    krb5_rc_mem_destroy,
+    krb5_rc_mem_close,
+    krb5_rc_mem_store,
+    krb5_rc_mem_expunge,
+    krb5_rc_mem_get_span,
+    krb5_rc_mem_get_name,
+    krb5_rc_mem_resolve
+};
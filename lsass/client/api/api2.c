@@ -442,6 +442,41 @@ LsaFindGroupAndExpandedMembers(
         pppMemberObjects);
 }
 
+LW_DWORD
+LsaFindGroupAndMemberNames(
+    LW_IN LW_HANDLE hLsa,
+    LW_PCSTR pszTargetProvider,
+    LW_IN LSA_FIND_FLAGS FindFlags,
+    LW_IN LSA_QUERY_TYPE QueryType,
+    LW_IN LSA_QUERY_ITEM QueryItem,
+    LW_IN LW_DWORD dwMaxMemberNamesLength,
+    LW_OUT PLSA_SECURITY_OBJECT* ppGroupObject,
+    LW_OUT LW_PDWORD pdwMemberCount,
+    LW_OUT LW_PDWORD pdwMemberNamesLength,
+    LW_OUT LW_PSTR* ppszMemberNames
+    )
+{
+    return LsaTransactFindGroupAndMemberNames(
+        hLsa,
+        pszTargetProvider,
+        FindFlags,
+        QueryType,
+        QueryItem,
+        dwMaxMemberNamesLength,
+        ppGroupObject,
+        pdwMemberCount,
+        pdwMemberNamesLength,
+        ppszMemberNames);
+}
+
+VOID
+LsaFreeMemberNames(
+    IN OUT PSTR pszMemberNames
+    )
+{
+    LW_SAFE_FREE_MEMORY(pszMemberNames);
+}
+
 LW_DWORD
 LsaDeleteObject(
     LW_HANDLE hLsaConnection,
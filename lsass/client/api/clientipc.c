@@ -1366,6 +1366,104 @@ error:
     goto cleanup;
 }
 
+LW_DWORD
+LsaTransactFindGroupAndMemberNames(
+    LW_IN LW_HANDLE hLsa,
+    LW_PCSTR pszTargetProvider,
+    LW_IN LSA_FIND_FLAGS FindFlags,
+    LW_IN LSA_QUERY_TYPE QueryType,
+    LW_IN LSA_QUERY_ITEM QueryItem,
+    LW_IN LW_DWORD dwMaxMemberNamesLength,
+    LW_OUT PLSA_SECURITY_OBJECT* ppGroupObject,
+    LW_OUT LW_PDWORD pdwMemberCount,
+    LW_OUT LW_PDWORD pdwMemberNamesLength,
+    LW_OUT LW_PSTR* ppszMemberNames
+    )
+{
+    DWORD dwError = 0;
+    LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_REQ req = {0};
+    PLSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_RES pRes = NULL;
+    PLSA_IPC_ERROR pError = NULL;
+    LWMsgParams in = LWMSG_PARAMS_INITIALIZER;
+    LWMsgParams out = LWMSG_PARAMS_INITIALIZER;
+    LWMsgCall* pCall = NULL;
+
+    dwError = LsaIpcAcquireCall(hLsa, &pCall);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    req.pszTargetProvider = pszTargetProvider;
+    req.FindFlags = FindFlags;
+    req.QueryType = QueryType;
+    req.QueryItem = QueryItem;
+    req.dwMaxMemberNamesLength = dwMaxMemberNamesLength;
+
+    switch(QueryType)
+    {
+    case LSA_QUERY_TYPE_BY_UNIX_ID:
+        req.IpcQueryType = LSA2_IPC_QUERY_DWORDS;
+        break;
+    default:
+        req.IpcQueryType = LSA2_IPC_QUERY_STRINGS;
+        break;
+    }
+
+    in.tag = LSA2_Q_FIND_GROUP_AND_MEMBER_NAMES;
+    in.data = &req;
+
+    dwError = MAP_LWMSG_ERROR(lwmsg_call_dispatch(pCall, &in, &out, NULL, NULL));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    switch (out.tag)
+    {
+    case LSA2_R_FIND_GROUP_AND_MEMBER_NAMES:
+        pRes = out.data;
+
+        /* The names must be terminated where the server says they end */
+        if (pRes->dwMemberNamesLength &&
+            pRes->pMemberNames[pRes->dwMemberNamesLength - 1] != '\0')
+        {
+            dwError = LW_ERROR_INTERNAL;
+            BAIL_ON_LSA_ERROR(dwError);
+        }
+
+        *ppGroupObject = pRes->pGroup;
+        *pdwMemberCount = pRes->dwMemberCount;
+        *pdwMemberNamesLength = pRes->dwMemberNamesLength;
+        *ppszMemberNames = (PSTR) pRes->pMemberNames;
+
+        pRes->pGroup = NULL;
+        pRes->pMemberNames = NULL;
+        break;
+    case LSA2_R_ERROR:
+        pError = (PLSA_IPC_ERROR) out.data;
+        dwError = pError->dwError;
+        BAIL_ON_LSA_ERROR(dwError);
+        break;
+    default:
+        dwError = LW_ERROR_INTERNAL;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+cleanup:
+
+    if (pCall)
+    {
+        lwmsg_call_destroy_params(pCall, &out);
+        lwmsg_call_release(pCall);
+    }
+
+    return dwError;
+
+error:
+
+   *ppGroupObject = NULL;
+   *pdwMemberCount = 0;
+   *pdwMemberNamesLength = 0;
+   *ppszMemberNames = NULL;
+
+    goto cleanup;
+}
+
 DWORD
 LsaTransactCloseEnum(
     IN HANDLE hLsa,
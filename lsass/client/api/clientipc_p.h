@@ -225,6 +225,20 @@ LsaTransactFindGroupAndExpandedMembers(
     LW_OUT PLSA_SECURITY_OBJECT** pppMemberObjects
     );
 
+LW_DWORD
+LsaTransactFindGroupAndMemberNames(
+    LW_IN LW_HANDLE hLsa,
+    LW_PCSTR pszTargetProvider,
+    LW_IN LSA_FIND_FLAGS FindFlags,
+    LW_IN LSA_QUERY_TYPE QueryType,
+    LW_IN LSA_QUERY_ITEM QueryItem,
+    LW_IN LW_DWORD dwMaxMemberNamesLength,
+    LW_OUT PLSA_SECURITY_OBJECT* ppGroupObject,
+    LW_OUT LW_PDWORD pdwMemberCount,
+    LW_OUT LW_PDWORD pdwMemberNamesLength,
+    LW_OUT LW_PSTR* ppszMemberNames
+    );
+
 DWORD
 LsaTransactCloseEnum(
     IN HANDLE hLsa,
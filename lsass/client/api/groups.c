@@ -156,6 +156,9 @@ LsaFindGroupByName(
     DWORD dwObjectCount = 1;
     PLSA_SECURITY_OBJECT* ppObjects = NULL;
     PLSA_SECURITY_OBJECT pGroup = NULL;
+    DWORD dwMemberCount = 0;
+    DWORD dwMemberNamesLength = 0;
+    PSTR pszMemberNames = NULL;
 
     BAIL_ON_INVALID_HANDLE(hLsaConnection);
     BAIL_ON_INVALID_STRING(pszGroupName);
@@ -171,23 +174,26 @@ LsaFindGroupByName(
         /* Fast path */
         QueryItem.pszString = pszGroupName;
 
-        dwError = LsaFindGroupAndExpandedMembers(
+        dwError = LsaFindGroupAndMemberNames(
             hLsaConnection,
             NULL,
             FindFlags,
             LSA_QUERY_TYPE_BY_NAME,
             QueryItem,
+            0,
             &pGroup,
-            &dwObjectCount,
-            &ppObjects);
+            &dwMemberCount,
+            &dwMemberNamesLength,
+            &pszMemberNames);
         BAIL_ON_LSA_ERROR(dwError);
 
         dwError = LsaMarshalGroupInfo1(
             hLsaConnection,
             FindFlags,
             pGroup,
-            dwObjectCount,
-            ppObjects,
+            dwMemberCount,
+            dwMemberNamesLength,
+            pszMemberNames,
             dwGroupInfoLevel,
             &pGroupInfo);
         BAIL_ON_LSA_ERROR(dwError);
@@ -233,6 +239,8 @@ error:
         LsaFreeSecurityObject(pGroup);
     }
 
+    LsaFreeMemberNames(pszMemberNames);
+
     if (ppObjects)
     {
         LsaFreeSecurityObjectList(dwObjectCount, ppObjects);
@@ -259,6 +267,9 @@ LsaFindGroupById(
     DWORD dwObjectCount = 1;
     PLSA_SECURITY_OBJECT* ppObjects = NULL;
     PLSA_SECURITY_OBJECT pGroup = NULL;
+    DWORD dwMemberCount = 0;
+    DWORD dwMemberNamesLength = 0;
+    PSTR pszMemberNames = NULL;
     DWORD dwGid = (DWORD) gid;
 
     BAIL_ON_INVALID_HANDLE(hLsaConnection);
@@ -274,23 +285,26 @@ LsaFindGroupById(
         /* Fast path */
         QueryItem.dwId = dwGid;
 
-        dwError = LsaFindGroupAndExpandedMembers(
+        dwError = LsaFindGroupAndMemberNames(
             hLsaConnection,
             NULL,
             FindFlags,
             LSA_QUERY_TYPE_BY_UNIX_ID,
             QueryItem,
+            0,
             &pGroup,
-            &dwObjectCount,
-            &ppObjects);
+            &dwMemberCount,
+            &dwMemberNamesLength,
+            &pszMemberNames);
         BAIL_ON_LSA_ERROR(dwError);
 
         dwError = LsaMarshalGroupInfo1(
             hLsaConnection,
             FindFlags,
             pGroup,
-            dwObjectCount,
-            ppObjects,
+            dwMemberCount,
+            dwMemberNamesLength,
+            pszMemberNames,
             dwGroupInfoLevel,
             &pGroupInfo);
         BAIL_ON_LSA_ERROR(dwError);
@@ -336,6 +350,8 @@ error:
         LsaFreeSecurityObject(pGroup);
     }
 
+    LsaFreeMemberNames(pszMemberNames);
+
     if (ppObjects)
     {
         LsaFreeSecurityObjectList(dwObjectCount, ppObjects);
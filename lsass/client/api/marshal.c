@@ -506,7 +506,8 @@ LsaMarshalGroupInfo1(
     LSA_FIND_FLAGS FindFlags,
     PLSA_SECURITY_OBJECT     pGroup,
     DWORD dwMemberCount,
-    PLSA_SECURITY_OBJECT* ppMembers,
+    DWORD dwMemberNamesLength,
+    PCSTR pszMemberNames,
     DWORD                   dwGroupInfoLevel,
     PVOID*                  ppGroupInfo
     )
@@ -517,8 +518,9 @@ LsaMarshalGroupInfo1(
     /* The variable represents pGroupInfo casted to different types. Do not
      * free these values directly, free pGroupInfo instead.
      */
-    size_t sIndex = 0;
-    size_t sEnabled = 0;
+    DWORD dwIndex = 0;
+    PCSTR pszMember = pszMemberNames;
+    PCSTR pszEnd = pszMemberNames + dwMemberNamesLength;
 
     *ppGroupInfo = NULL;
 
@@ -570,43 +572,27 @@ LsaMarshalGroupInfo1(
         BAIL_ON_LSA_ERROR(dwError);
     }
 
-    for (sIndex = 0; sIndex < dwMemberCount; sIndex++)
-    {
-        if (ppMembers[sIndex])
-        {
-            if (ppMembers[sIndex]->enabled)
-            {
-                sEnabled++;
-            }
-
-            if (ppMembers[sIndex]->type != LSA_OBJECT_TYPE_USER)
-            {
-                dwError = LW_ERROR_INVALID_PARAMETER;
-                BAIL_ON_LSA_ERROR(dwError);
-            }
-        }
-    }
-
     dwError = LwAllocateMemory(
         //Leave room for terminating null pointer
-        sizeof(PSTR) * (sEnabled+1),
+        sizeof(PSTR) * (dwMemberCount+1),
         (PVOID*)&pGroupInfo1->ppszMembers);
     BAIL_ON_LSA_ERROR(dwError);
 
-    sEnabled = 0;
-
-    for (sIndex = 0; sIndex < dwMemberCount; sIndex++)
+    // The server only sends enabled user members, packed back to back
+    for (dwIndex = 0; dwIndex < dwMemberCount; dwIndex++)
     {
-        if (ppMembers[sIndex])
+        if (pszMember >= pszEnd)
         {
-            if (ppMembers[sIndex]->enabled)
-            {
-                dwError = LwAllocateString(
-                    ppMembers[sIndex]->userInfo.pszUnixName,
-                    &pGroupInfo1->ppszMembers[sEnabled++]);
-                BAIL_ON_LSA_ERROR(dwError);
-            }
+            dwError = LW_ERROR_INTERNAL;
+            BAIL_ON_LSA_ERROR(dwError);
         }
+
+        dwError = LwAllocateString(
+            pszMember,
+            &pGroupInfo1->ppszMembers[dwIndex]);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        pszMember += strlen(pszMember) + 1;
     }
 
     *ppGroupInfo = pGroupInfo;
@@ -79,7 +79,8 @@ LsaMarshalGroupInfo1(
     LSA_FIND_FLAGS FindFlags,
     PLSA_SECURITY_OBJECT     pGroup,
     DWORD dwMemberCount,
-    PLSA_SECURITY_OBJECT* ppMembers,
+    DWORD dwMemberNamesLength,
+    PCSTR pszMemberNames,
     DWORD                   dwGroupInfoLevel,
     PVOID*                  ppGroupInfo
     );
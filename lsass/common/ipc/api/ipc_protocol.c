@@ -428,8 +428,65 @@ static LWMsgTypeSpec gLsaMetricPack1Spec[] =
     LWMSG_TYPE_END
 };
 
+static LWMsgTypeSpec gLsaMetricLatencySpec[] =
+{
+    LWMSG_STRUCT_BEGIN(LSA_METRIC_LATENCY),
+    LWMSG_MEMBER_UINT64(LSA_METRIC_LATENCY, count),
+    LWMSG_MEMBER_UINT64(LSA_METRIC_LATENCY, failed),
+    LWMSG_MEMBER_UINT64(LSA_METRIC_LATENCY, totalMicroseconds),
+    LWMSG_MEMBER_UINT64(LSA_METRIC_LATENCY, maxMicroseconds),
+    LWMSG_MEMBER_ARRAY_BEGIN(LSA_METRIC_LATENCY, buckets),
+    LWMSG_UINT64(LW_UINT64),
+    LWMSG_ARRAY_END,
+    LWMSG_ATTR_LENGTH_STATIC(LSA_METRIC_LATENCY_BUCKETS),
+    LWMSG_STRUCT_END,
+    LWMSG_TYPE_END
+};
+
+static LWMsgTypeSpec gLsaMetricDcTargetSpec[] =
+{
+    LWMSG_STRUCT_BEGIN(LSA_METRIC_DC_TARGET),
+    LWMSG_MEMBER_ARRAY_BEGIN(LSA_METRIC_DC_TARGET, szName),
+    LWMSG_UINT8(LW_CHAR),
+    LWMSG_ARRAY_END,
+    LWMSG_ATTR_LENGTH_STATIC(LSA_METRIC_DC_TARGET_NAME_SIZE),
+    LWMSG_MEMBER_TYPESPEC(LSA_METRIC_DC_TARGET, ldapLatency, gLsaMetricLatencySpec),
+    LWMSG_MEMBER_TYPESPEC(LSA_METRIC_DC_TARGET, rpcLatency, gLsaMetricLatencySpec),
+    LWMSG_STRUCT_END,
+    LWMSG_TYPE_END
+};
+
+static LWMsgTypeSpec gLsaMetricPack2Spec[] =
+{
+    LWMSG_STRUCT_BEGIN(LSA_METRIC_PACK_2),
+    LWMSG_MEMBER_TYPESPEC(LSA_METRIC_PACK_2, counters, gLsaMetricPack1Spec),
+    LWMSG_MEMBER_UINT64(LSA_METRIC_PACK_2, unauthorizedAccesses),
+    LWMSG_MEMBER_UINT64(LSA_METRIC_PACK_2, operationsInFlight),
+    LWMSG_MEMBER_UINT64(LSA_METRIC_PACK_2, operationsInFlightPeak),
+    LWMSG_MEMBER_ARRAY_BEGIN(LSA_METRIC_PACK_2, operations),
+    LWMSG_TYPESPEC(gLsaMetricLatencySpec),
+    LWMSG_ARRAY_END,
+    LWMSG_ATTR_LENGTH_STATIC(LSA_METRIC_OP_COUNT),
+    LWMSG_MEMBER_ARRAY_BEGIN(LSA_METRIC_PACK_2, cacheHits),
+    LWMSG_UINT64(LW_UINT64),
+    LWMSG_ARRAY_END,
+    LWMSG_ATTR_LENGTH_STATIC(LSA_METRIC_CACHE_COUNT),
+    LWMSG_MEMBER_ARRAY_BEGIN(LSA_METRIC_PACK_2, cacheMisses),
+    LWMSG_UINT64(LW_UINT64),
+    LWMSG_ARRAY_END,
+    LWMSG_ATTR_LENGTH_STATIC(LSA_METRIC_CACHE_COUNT),
+    LWMSG_MEMBER_UINT32(LSA_METRIC_PACK_2, dwDcTargetCount),
+    LWMSG_MEMBER_ARRAY_BEGIN(LSA_METRIC_PACK_2, dcTargets),
+    LWMSG_TYPESPEC(gLsaMetricDcTargetSpec),
+    LWMSG_ARRAY_END,
+    LWMSG_ATTR_LENGTH_STATIC(LSA_METRIC_MAX_DC_TARGETS),
+    LWMSG_STRUCT_END,
+    LWMSG_TYPE_END
+};
+
 #define METRIC_INFO_LEVEL_0 0
 #define METRIC_INFO_LEVEL_1 1
+#define METRIC_INFO_LEVEL_2 2
 
 static LWMsgTypeSpec gLsaMetricPackSpec[] =
 {
@@ -444,6 +501,10 @@ static LWMsgTypeSpec gLsaMetricPackSpec[] =
     LWMSG_TYPESPEC(gLsaMetricPack1Spec),
     LWMSG_POINTER_END,
     LWMSG_ATTR_TAG(METRIC_INFO_LEVEL_1),
+    LWMSG_MEMBER_POINTER_BEGIN(union _METRIC_PACK, pMetricPack2),
+    LWMSG_TYPESPEC(gLsaMetricPack2Spec),
+    LWMSG_POINTER_END,
+    LWMSG_ATTR_TAG(METRIC_INFO_LEVEL_2),
     LWMSG_UNION_END,
     LWMSG_ATTR_DISCRIM(LSA_METRIC_PACK, dwInfoLevel),
     LWMSG_STRUCT_END,
@@ -1221,6 +1282,41 @@ static LWMsgTypeSpec gLsa2IpcFindGroupAndExpandedGroupMembersResSpec[] =
     LWMSG_TYPE_END
 };
 
+static LWMsgTypeSpec gLsa2IpcFindGroupAndMemberNamesReqSpec[] =
+{
+    LWMSG_STRUCT_BEGIN(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_REQ),
+    LWMSG_MEMBER_PSTR(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_REQ, pszTargetProvider),
+    LWMSG_MEMBER_UINT32(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_REQ, FindFlags),
+    LWMSG_MEMBER_UINT8(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_REQ, QueryType),
+    LWMSG_MEMBER_UINT8(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_REQ, IpcQueryType),
+    LWMSG_MEMBER_UNION_BEGIN(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_REQ, QueryItem),
+    LWMSG_MEMBER_PSTR(LSA_QUERY_ITEM, pszString),
+    LWMSG_ATTR_NOT_NULL,
+    LWMSG_ATTR_TAG(LSA2_IPC_QUERY_STRINGS),
+    LWMSG_MEMBER_UINT32(LSA_QUERY_ITEM, dwId),
+    LWMSG_ATTR_TAG(LSA2_IPC_QUERY_DWORDS),
+    LWMSG_UNION_END,
+    LWMSG_ATTR_DISCRIM(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_REQ, IpcQueryType),
+    LWMSG_MEMBER_UINT32(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_REQ, dwMaxMemberNamesLength),
+    LWMSG_STRUCT_END,
+    LWMSG_TYPE_END
+};
+
+static LWMsgTypeSpec gLsa2IpcFindGroupAndMemberNamesResSpec[] =
+{
+    LWMSG_STRUCT_BEGIN(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_RES),
+    LWMSG_MEMBER_POINTER(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_RES, pGroup, LWMSG_TYPESPEC(gLsaSecurityObjectSpec)),
+    LWMSG_ATTR_NOT_NULL,
+    LWMSG_MEMBER_UINT32(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_RES, dwMemberCount),
+    LWMSG_MEMBER_UINT32(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_RES, dwMemberNamesLength),
+    LWMSG_MEMBER_POINTER_BEGIN(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_RES, pMemberNames),
+    LWMSG_UINT8(BYTE),
+    LWMSG_POINTER_END,
+    LWMSG_ATTR_LENGTH_MEMBER(LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_RES, dwMemberNamesLength),
+    LWMSG_STRUCT_END,
+    LWMSG_TYPE_END
+};
+
 static LWMsgTypeSpec gLsa2IpcCloseEnumReqSpec[] =
 {
     LWMSG_HANDLE(LSA2_IPC_ENUM_HANDLE),
@@ -1403,6 +1499,8 @@ static LWMsgProtocolSpec gLsaIPCSpec[] =
     LWMSG_MESSAGE(LSA_PRIVS_R_REMOVE_ACCOUNT_RIGHTS, NULL),
     LWMSG_MESSAGE(LSA_PRIVS_Q_ENUM_ACCOUNT_RIGHTS, gLsaPrivsIPCEnumAccountRightsReqSpec),
     LWMSG_MESSAGE(LSA_PRIVS_R_ENUM_ACCOUNT_RIGHTS, gLsaPrivsIPCEnumAccountRightsRespSpec),
+    LWMSG_MESSAGE(LSA2_Q_FIND_GROUP_AND_MEMBER_NAMES, gLsa2IpcFindGroupAndMemberNamesReqSpec),
+    LWMSG_MESSAGE(LSA2_R_FIND_GROUP_AND_MEMBER_NAMES, gLsa2IpcFindGroupAndMemberNamesResSpec),
     LWMSG_PROTOCOL_END
 };
 
@@ -574,6 +574,67 @@ typedef struct __LSA_METRIC_PACK_1
     LW_UINT64 failedChangePassword;
 } LSA_METRIC_PACK_1, *PLSA_METRIC_PACK_1;
 
+/* Operations timed in LSA_METRIC_PACK_2.operations */
+#define LSA_METRIC_OP_AUTHENTICATE_USER_PAM  0
+#define LSA_METRIC_OP_AUTHENTICATE_USER_EX   1
+#define LSA_METRIC_OP_CHANGE_PASSWORD        2
+#define LSA_METRIC_OP_OPEN_SESSION           3
+#define LSA_METRIC_OP_CLOSE_SESSION          4
+#define LSA_METRIC_OP_FIND_OBJECTS           5
+#define LSA_METRIC_OP_ENUM_OBJECTS           6
+#define LSA_METRIC_OP_QUERY_MEMBER_OF        7
+#define LSA_METRIC_OP_COUNT                  8
+
+/* Cache indexes counted in LSA_METRIC_PACK_2.cacheHits/cacheMisses */
+#define LSA_METRIC_CACHE_USER_BY_NAME        0
+#define LSA_METRIC_CACHE_USER_BY_ID          1
+#define LSA_METRIC_CACHE_GROUP_BY_NAME       2
+#define LSA_METRIC_CACHE_GROUP_BY_ID         3
+#define LSA_METRIC_CACHE_OBJECT_BY_DN        4
+#define LSA_METRIC_CACHE_OBJECT_BY_SID       5
+#define LSA_METRIC_CACHE_MEMBERSHIP          6
+#define LSA_METRIC_CACHE_PASSWORD_VERIFIER   7
+#define LSA_METRIC_CACHE_NEGATIVE_LOOKUP     8
+#define LSA_METRIC_CACHE_MEMBER_NAMES        9
+#define LSA_METRIC_CACHE_COUNT              10
+
+/* Bucket 0 counts calls under 1us, bucket n calls in [2^(n-1), 2^n) us;
+   the last bucket also takes everything slower */
+#define LSA_METRIC_LATENCY_BUCKETS          24
+
+#define LSA_METRIC_MAX_DC_TARGETS           16
+#define LSA_METRIC_DC_TARGET_NAME_SIZE      64
+
+typedef struct __LSA_METRIC_LATENCY
+{
+    LW_UINT64 count;
+    LW_UINT64 failed;
+    LW_UINT64 totalMicroseconds;
+    LW_UINT64 maxMicroseconds;
+    LW_UINT64 buckets[LSA_METRIC_LATENCY_BUCKETS];
+} LSA_METRIC_LATENCY, *PLSA_METRIC_LATENCY;
+
+typedef struct __LSA_METRIC_DC_TARGET
+{
+    /* DC host name for RPC calls, DNS domain name for LDAP */
+    LW_CHAR szName[LSA_METRIC_DC_TARGET_NAME_SIZE];
+    LSA_METRIC_LATENCY ldapLatency;
+    LSA_METRIC_LATENCY rpcLatency;
+} LSA_METRIC_DC_TARGET, *PLSA_METRIC_DC_TARGET;
+
+typedef struct __LSA_METRIC_PACK_2
+{
+    LSA_METRIC_PACK_1 counters;
+    LW_UINT64 unauthorizedAccesses;
+    LW_UINT64 operationsInFlight;
+    LW_UINT64 operationsInFlightPeak;
+    LSA_METRIC_LATENCY operations[LSA_METRIC_OP_COUNT];
+    LW_UINT64 cacheHits[LSA_METRIC_CACHE_COUNT];
+    LW_UINT64 cacheMisses[LSA_METRIC_CACHE_COUNT];
+    LW_DWORD dwDcTargetCount;
+    LSA_METRIC_DC_TARGET dcTargets[LSA_METRIC_MAX_DC_TARGETS];
+} LSA_METRIC_PACK_2, *PLSA_METRIC_PACK_2;
+
 typedef struct __LSA_METRIC_PACK
 {
     LW_DWORD dwInfoLevel;
@@ -581,6 +642,7 @@ typedef struct __LSA_METRIC_PACK
     {
         PLSA_METRIC_PACK_0 pMetricPack0;
         PLSA_METRIC_PACK_1 pMetricPack1;
+        PLSA_METRIC_PACK_2 pMetricPack2;
     } pMetricPack;
 } LSA_METRIC_PACK, *PLSA_METRIC_PACK;
 
@@ -1972,6 +2034,32 @@ LsaFindGroupAndExpandedMembers(
     LW_OUT PLSA_SECURITY_OBJECT** pppMemberObjects
     );
 
+/*
+ * Finds a group and the unix names of its enabled, expanded user members.
+ * The names come back packed as *pdwMemberCount NUL-terminated strings
+ * totalling *pdwMemberNamesLength bytes; free them with LsaFreeMemberNames.
+ * If dwMaxMemberNamesLength is non-zero and the names would not fit,
+ * LW_ERROR_INSUFFICIENT_BUFFER is returned without transferring them.
+ */
+LW_DWORD
+LsaFindGroupAndMemberNames(
+    LW_IN LW_HANDLE hLsa,
+    LW_PCSTR pszTargetProvider,
+    LW_IN LSA_FIND_FLAGS FindFlags,
+    LW_IN LSA_QUERY_TYPE QueryType,
+    LW_IN LSA_QUERY_ITEM QueryItem,
+    LW_IN LW_DWORD dwMaxMemberNamesLength,
+    LW_OUT PLSA_SECURITY_OBJECT* ppGroupObject,
+    LW_OUT LW_PDWORD pdwMemberCount,
+    LW_OUT LW_PDWORD pdwMemberNamesLength,
+    LW_OUT LW_PSTR* ppszMemberNames
+    );
+
+LW_VOID
+LsaFreeMemberNames(
+    LW_IN LW_OUT LW_PSTR pszMemberNames
+    );
+
 LW_DWORD
 LsaModifyUser2(
     LW_HANDLE hLsaConnection,
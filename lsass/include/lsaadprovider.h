@@ -65,6 +65,7 @@
 #define LSA_AD_IO_GET_MACHINE_ACCOUNT   12
 #define LSA_AD_IO_GET_MACHINE_PASSWORD  13
 #define LSA_AD_IO_GET_COMPUTER_DN       14
+#define LSA_AD_IO_GET_CACHE_GENERATION  15
 
 
 typedef struct __LSA_AD_IPC_ENUM_USERS_FROM_CACHE_REQ {
@@ -159,7 +159,10 @@ typedef enum __LSA_IPC_TAG
     LSA_PRIVS_Q_REMOVE_ACCOUNT_RIGHTS,
     LSA_PRIVS_R_REMOVE_ACCOUNT_RIGHTS,
     LSA_PRIVS_Q_ENUM_ACCOUNT_RIGHTS,
-    LSA_PRIVS_R_ENUM_ACCOUNT_RIGHTS
+    LSA_PRIVS_R_ENUM_ACCOUNT_RIGHTS,
+
+    LSA2_Q_FIND_GROUP_AND_MEMBER_NAMES,
+    LSA2_R_FIND_GROUP_AND_MEMBER_NAMES
 } LSA_IPC_TAG;
 
 
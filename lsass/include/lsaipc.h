@@ -237,6 +237,26 @@ typedef struct _LSA2_IPC_FIND_GROUP_AND_EXPANDED_MEMBERS_RES
     PLSA_SECURITY_OBJECT* ppMemberObjects;
 } LSA2_IPC_FIND_GROUP_AND_EXPANDED_MEMBERS_RES, *PLSA2_IPC_FIND_GROUP_AND_EXPANDED_MEMBERS_RES;
 
+typedef struct _LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_REQ
+{
+    PCSTR pszTargetProvider;
+    LSA_FIND_FLAGS FindFlags;
+    LSA_QUERY_TYPE QueryType;
+    LSA2_IPC_QUERY_TYPE IpcQueryType;
+    LSA_QUERY_ITEM QueryItem;
+    // 0 means no limit
+    DWORD dwMaxMemberNamesLength;
+} LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_REQ, *PLSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_REQ;
+
+typedef struct _LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_RES
+{
+    PLSA_SECURITY_OBJECT pGroup;
+    DWORD dwMemberCount;
+    DWORD dwMemberNamesLength;
+    // dwMemberCount NUL-terminated names, back to back
+    PBYTE pMemberNames;
+} LSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_RES, *PLSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_RES;
+
 typedef struct _LSA2_IPC_GET_SMART_CARD_USER_RES
 {
     PLSA_SECURITY_OBJECT pObject;
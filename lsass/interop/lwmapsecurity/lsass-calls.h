@@ -68,6 +68,7 @@
 #define LsaAuthenticateUserEx LsaSrvAuthenticateUserEx
 #define LsaPrivsEnumAccountRightsSids LsaSrvPrivsEnumAccountRightsSids
 #define LsaGetStatus2 LsaSrvGetStatus
+#define LsaProviderIoControl LsaSrvProviderIoControl
 
 #endif /* LSASS_INTERNAL_PLUGIN */
 
@@ -62,7 +62,10 @@
 #include "lwstr.h"
 #include "lwsecurityidentifier.h"
 #include "lsautils.h"
+#include "lsaadprovider.h"
 #include <assert.h>
+#include <pthread.h>
+#include <time.h>
 #include "lsass-calls.h"
 
 #define LSA_MAP_SECURITY_MAP_TO_GUEST_RID   DOMAIN_USER_RID_GUEST
@@ -70,13 +73,53 @@
 /* TBD: BUG 1066874 - This isn't working; turn off for now */
 #define LSA_DISABLE_PRIVILEGE_LOOKUP 1
 
+// Idle LSASS connections kept open for reuse
+#define LSA_MAP_SECURITY_CONNECTION_POOL_SIZE   8
+
+// Token create information cached by PAC logon info
+#define LSA_MAP_SECURITY_TOKEN_CACHE_SIZE       1024
+#define LSA_MAP_SECURITY_TOKEN_CACHE_LIFETIME   120
+// How often the AD cache generation is polled for flushes
+#define LSA_MAP_SECURITY_TOKEN_CACHE_CHECK_INTERVAL 5
+
+typedef struct _LSA_MAP_SECURITY_PAC_KEY {
+    ULONG Length;
+    PBYTE Data;
+} LSA_MAP_SECURITY_PAC_KEY, *PLSA_MAP_SECURITY_PAC_KEY;
+
+typedef const LSA_MAP_SECURITY_PAC_KEY *PCLSA_MAP_SECURITY_PAC_KEY;
+
+typedef struct _LSA_MAP_SECURITY_TOKEN_CACHE_ENTRY {
+    LW_HASHTABLE_NODE Node;
+    LSA_MAP_SECURITY_PAC_KEY Key;
+    time_t ExpirationTime;
+    PACCESS_TOKEN_CREATE_INFORMATION CreateInformation;
+} LSA_MAP_SECURITY_TOKEN_CACHE_ENTRY, *PLSA_MAP_SECURITY_TOKEN_CACHE_ENTRY;
+
 typedef struct _LW_MAP_SECURITY_PLUGIN_CONTEXT {
-    // TODO-Add connection caching using TLS, a connection pool,
-    // or somesuch.  It may be useful to change the calls to LSASS to
-    // go through a LsaMapSecurityCallLsass() that is like
-    // LsaDmConnectDomain() so we can automatically retry on
-    // connection-type errors.
-    HANDLE hUnusedConnection;
+    // Connections are handed out one caller at a time and returned
+    // here when done, so a burst of session setups does not pay for
+    // a fresh LSASS connection per lookup.  A connection whose last
+    // call failed is closed rather than pooled, so a broken one is
+    // never handed out twice.
+    pthread_mutex_t ConnectionLock;
+    BOOLEAN bConnectionLockInit;
+    HANDLE hConnections[LSA_MAP_SECURITY_CONNECTION_POOL_SIZE];
+    ULONG ConnectionCount;
+    // Reconnecting clients present the same PAC over and over, so the
+    // token built from it is kept for a short while keyed by the
+    // PAC logon info.
+    pthread_mutex_t TokenCacheLock;
+    BOOLEAN bTokenCacheLockInit;
+    PLW_HASHTABLE pTokenCache;
+    // The AD provider bumps its cache generation whenever cached users
+    // or groups are flushed (lw-ad-cache --delete-*, etc.).  The token
+    // cache is emptied when that changes, and the epoch keeps a lookup
+    // that started before the flush from putting its result back.
+    DWORD TokenCacheGeneration;
+    BOOLEAN bTokenCacheGenerationValid;
+    time_t TokenCacheCheckTime;
+    ULONG TokenCacheEpoch;
 } LW_MAP_SECURITY_PLUGIN_CONTEXT;
 
 typedef UCHAR LSA_MAP_SECURITY_OBJECT_INFO_FLAGS, *PLSA_MAP_SECURITY_OBJECT_INFO_FLAGS;
@@ -126,8 +169,19 @@ LsaMapSecurityOpenConnection(
     DWORD dwError = LW_ERROR_SUCCESS;
     HANDLE hConnection = NULL;
 
-    dwError = LsaOpenServer(&hConnection);
-    status = LsaLsaErrorToNtStatus(dwError);
+    pthread_mutex_lock(&Context->ConnectionLock);
+    if (Context->ConnectionCount)
+    {
+        hConnection = Context->hConnections[--Context->ConnectionCount];
+        Context->hConnections[Context->ConnectionCount] = NULL;
+    }
+    pthread_mutex_unlock(&Context->ConnectionLock);
+
+    if (!hConnection)
+    {
+        dwError = LsaOpenServer(&hConnection);
+        status = LsaLsaErrorToNtStatus(dwError);
+    }
 
     *phConnection = hConnection;
 
@@ -138,7 +192,8 @@ static
 VOID
 LsaMapSecurityCloseConnection(
     IN PLW_MAP_SECURITY_PLUGIN_CONTEXT Context,
-    IN OUT PHANDLE phConnection
+    IN OUT PHANDLE phConnection,
+    IN NTSTATUS Status
     )
 {
     HANDLE hConnection = *phConnection;
@@ -148,8 +203,22 @@ LsaMapSecurityCloseConnection(
         NTSTATUS status = STATUS_SUCCESS;
         DWORD dwError = LW_ERROR_SUCCESS;
 
-        dwError = LsaCloseServer(hConnection);
-        status = LsaLsaErrorToNtStatus(dwError);
+        if (NT_SUCCESS(Status))
+        {
+            pthread_mutex_lock(&Context->ConnectionLock);
+            if (Context->ConnectionCount < LSA_MAP_SECURITY_CONNECTION_POOL_SIZE)
+            {
+                Context->hConnections[Context->ConnectionCount++] = hConnection;
+                hConnection = NULL;
+            }
+            pthread_mutex_unlock(&Context->ConnectionLock);
+        }
+
+        if (hConnection)
+        {
+            dwError = LsaCloseServer(hConnection);
+            status = LsaLsaErrorToNtStatus(dwError);
+        }
 
         *phConnection = NULL;
     }
@@ -243,7 +312,10 @@ LsaMapSecurityResolveObjectInfo(
             dwError = LW_ERROR_NO_SUCH_OBJECT;
         }
 
-        LsaMapSecurityCloseConnection(Context, &hConnection);
+        LsaMapSecurityCloseConnection(
+            Context,
+            &hConnection,
+            IS_NOT_FOUND_ERROR(dwError) ? STATUS_SUCCESS : LsaLsaErrorToNtStatus(dwError));
     }
     else
     {
@@ -385,8 +457,6 @@ LsaMapSecurityResolveObjectInfoBySid(
     assert(STATUS_NOT_FOUND != status);
     GOTO_CLEANUP_ON_STATUS(status);
 
-    LsaMapSecurityCloseConnection(Context, &hConnection);
-
     if (ppObjects[0]->type == LSA_OBJECT_TYPE_USER)
     {
         SetFlag(objectInfo.Flags, LSA_MAP_SECURITY_OBJECT_INFO_FLAG_IS_USER);
@@ -411,6 +481,11 @@ LsaMapSecurityResolveObjectInfoBySid(
 
 cleanup:
 
+    LsaMapSecurityCloseConnection(
+        Context,
+        &hConnection,
+        IS_NOT_FOUND_ERROR(dwError) ? STATUS_SUCCESS : status);
+
     if (!NT_SUCCESS(status))
     {
         LsaMapSecurityFreeObjectInfo(&objectInfo);
@@ -591,7 +666,7 @@ cleanup:
         LsaMapSecurityFreeObjectInfo(&objectInfo);
     }
 
-    LsaMapSecurityCloseConnection(Context, &hLsaConnection);
+    LsaMapSecurityCloseConnection(Context, &hLsaConnection, status);
 
     *pObjectInfo = objectInfo;
 
@@ -1071,7 +1146,7 @@ LsaMapSecurityGetAccessTokenCreateInformationFromObjectInfo(
     status = LsaLsaErrorToNtStatus(dwError);
     GOTO_CLEANUP_ON_STATUS(status);
 
-    LsaMapSecurityCloseConnection(Context, &hConnection);
+    LsaMapSecurityCloseConnection(Context, &hConnection, status);
     hConnection = NULL;
 
 
@@ -1208,7 +1283,7 @@ LsaMapSecurityGetAccessTokenCreateInformationFromObjectInfo(
 cleanup:
     if (hConnection)
     {
-        LsaMapSecurityCloseConnection(Context, &hConnection);
+        LsaMapSecurityCloseConnection(Context, &hConnection, status);
     }
 
     if (!NT_SUCCESS(status))
@@ -1412,7 +1487,7 @@ LsaMapSecurityGetAccessTokenCreateInformationFromObjectInfoAndGroups(
     GOTO_CLEANUP_ON_STATUS(status);
 #endif
 
-    LsaMapSecurityCloseConnection(Context, &hConnection);
+    LsaMapSecurityCloseConnection(Context, &hConnection, status);
     hConnection = NULL;
 
     //
@@ -1526,7 +1601,7 @@ LsaMapSecurityGetAccessTokenCreateInformationFromObjectInfoAndGroups(
 cleanup:
     if (hConnection)
     {
-        LsaMapSecurityCloseConnection(Context, &hConnection);
+        LsaMapSecurityCloseConnection(Context, &hConnection, status);
     }
 
     if (!NT_SUCCESS(status))
@@ -1608,6 +1683,7 @@ NTSTATUS
 LsaMapSecurityGetPacInfoFromGssContext(
     IN PLW_MAP_SECURITY_PLUGIN_CONTEXT Context,
     OUT PAC_LOGON_INFO** ppPac,
+    OUT PLSA_MAP_SECURITY_PAC_KEY pPacKey,
     IN LW_MAP_SECURITY_GSS_CONTEXT GssContext
     )
 {
@@ -1624,6 +1700,7 @@ LsaMapSecurityGetPacInfoFromGssContext(
     gss_buffer_desc pacData = {0};
     gss_buffer_desc displayData = {0};
     PAC_LOGON_INFO *pPac = NULL;
+    LSA_MAP_SECURITY_PAC_KEY pacKey = { 0 };
     int more = -1;
 
     majorStatus = gss_inquire_context(
@@ -1673,7 +1750,14 @@ LsaMapSecurityGetPacInfoFromGssContext(
         &pPac);
     GOTO_CLEANUP_ON_STATUS(status);
 
+    status = RTL_ALLOCATE(&pacKey.Data, BYTE, pacData.length);
+    GOTO_CLEANUP_ON_STATUS(status);
+
+    memcpy(pacKey.Data, pacData.value, pacData.length);
+    pacKey.Length = pacData.length;
+
     *ppPac = pPac;
+    *pPacKey = pacKey;
 
 cleanup:
 
@@ -1684,6 +1768,10 @@ cleanup:
         {
             FreePacLogonInfo(pPac);
         }
+
+        RTL_FREE(&pacKey.Data);
+        pPacKey->Data = NULL;
+        pPacKey->Length = 0;
     }
 
     if (pacData.value)
@@ -1704,6 +1792,355 @@ cleanup:
     return status;
 }
 
+static
+PCVOID
+LsaMapSecurityTokenCacheGetKey(
+    IN PLW_HASHTABLE_NODE pNode,
+    IN PVOID pUnused
+    )
+{
+    PLSA_MAP_SECURITY_TOKEN_CACHE_ENTRY pEntry =
+        LW_STRUCT_FROM_FIELD(pNode, LSA_MAP_SECURITY_TOKEN_CACHE_ENTRY, Node);
+
+    return &pEntry->Key;
+}
+
+static
+ULONG
+LsaMapSecurityTokenCacheDigest(
+    IN PCVOID pKey,
+    IN PVOID pUnused
+    )
+{
+    PCLSA_MAP_SECURITY_PAC_KEY pPacKey = pKey;
+    ULONG ulDigest = 0;
+    ULONG i = 0;
+
+    for (i = 0; i < pPacKey->Length; i++)
+    {
+        ulDigest = ulDigest * 31 + pPacKey->Data[i];
+    }
+
+    return ulDigest;
+}
+
+static
+BOOLEAN
+LsaMapSecurityTokenCacheEqual(
+    IN PCVOID pKey1,
+    IN PCVOID pKey2,
+    IN PVOID pUnused
+    )
+{
+    PCLSA_MAP_SECURITY_PAC_KEY pPacKey1 = pKey1;
+    PCLSA_MAP_SECURITY_PAC_KEY pPacKey2 = pKey2;
+
+    return (pPacKey1->Length == pPacKey2->Length &&
+            !memcmp(pPacKey1->Data, pPacKey2->Data, pPacKey1->Length));
+}
+
+static
+VOID
+LsaMapSecurityFreeTokenCacheEntry(
+    IN PLW_HASHTABLE_NODE pNode,
+    IN PVOID pUserData
+    )
+{
+    PLW_MAP_SECURITY_PLUGIN_CONTEXT Context = pUserData;
+    PLSA_MAP_SECURITY_TOKEN_CACHE_ENTRY pEntry =
+        LW_STRUCT_FROM_FIELD(pNode, LSA_MAP_SECURITY_TOKEN_CACHE_ENTRY, Node);
+
+    LsaMapSecurityFreeAccessTokenCreateInformation(Context, &pEntry->CreateInformation);
+    RTL_FREE(&pEntry->Key.Data);
+    RTL_FREE(&pEntry);
+}
+
+static
+NTSTATUS
+LsaMapSecurityDuplicateAccessTokenCreateInformation(
+    IN PLW_MAP_SECURITY_PLUGIN_CONTEXT Context,
+    OUT PACCESS_TOKEN_CREATE_INFORMATION* CreateInformation,
+    IN PACCESS_TOKEN_CREATE_INFORMATION Source
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    PACCESS_TOKEN_CREATE_INFORMATION createInformation = NULL;
+    ULONG i = 0;
+
+    status = LsaMapSecurityAllocateAccessTokenCreateInformation(
+        &createInformation,
+        Source->Groups->GroupCount,
+        Source->Privileges->PrivilegeCount);
+    GOTO_CLEANUP_ON_STATUS(status);
+
+    if (Source->Unix)
+    {
+        *createInformation->Unix = *Source->Unix;
+    }
+    else
+    {
+        createInformation->Unix = NULL;
+    }
+
+    status = RtlDuplicateSid(&createInformation->User->User.Sid, Source->User->User.Sid);
+    GOTO_CLEANUP_ON_STATUS(status);
+
+    createInformation->User->User.Attributes = Source->User->User.Attributes;
+
+    for (i = 0; i < Source->Groups->GroupCount; i++)
+    {
+        PSID_AND_ATTRIBUTES group = &createInformation->Groups->Groups[i];
+
+        status = RtlDuplicateSid(&group->Sid, Source->Groups->Groups[i].Sid);
+        GOTO_CLEANUP_ON_STATUS(status);
+
+        group->Attributes = Source->Groups->Groups[i].Attributes;
+
+        createInformation->Groups->GroupCount++;
+    }
+
+    for (i = 0; i < Source->Privileges->PrivilegeCount; i++)
+    {
+        createInformation->Privileges->Privileges[i] = Source->Privileges->Privileges[i];
+    }
+
+    createInformation->Privileges->PrivilegeCount = Source->Privileges->PrivilegeCount;
+
+    status = RtlDuplicateSid(&createInformation->Owner->Owner, Source->Owner->Owner);
+    GOTO_CLEANUP_ON_STATUS(status);
+
+    status = RtlDuplicateSid(
+        &createInformation->PrimaryGroup->PrimaryGroup,
+        Source->PrimaryGroup->PrimaryGroup);
+    GOTO_CLEANUP_ON_STATUS(status);
+
+    status = LsaMapSecurityCreateTokenDefaultDacl(
+                 &createInformation->DefaultDacl->DefaultDacl,
+                 createInformation->Owner->Owner);
+    GOTO_CLEANUP_ON_STATUS(status);
+
+cleanup:
+    if (!NT_SUCCESS(status))
+    {
+        LsaMapSecurityFreeAccessTokenCreateInformation(Context, &createInformation);
+    }
+
+    *CreateInformation = createInformation;
+
+    return status;
+}
+
+static
+VOID
+LsaMapSecurityTokenCacheCheckGeneration(
+    IN PLW_MAP_SECURITY_PLUGIN_CONTEXT Context,
+    OUT PULONG pEpoch
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    DWORD dwError = LW_ERROR_SUCCESS;
+    HANDLE hConnection = NULL;
+    DWORD dwOutputBufferSize = 0;
+    PVOID pOutputBuffer = NULL;
+    DWORD dwGeneration = 0;
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&Context->TokenCacheLock);
+    if (now < Context->TokenCacheCheckTime)
+    {
+        *pEpoch = Context->TokenCacheEpoch;
+        pthread_mutex_unlock(&Context->TokenCacheLock);
+        return;
+    }
+    // Claim this round so concurrent lookups do not all go to LSASS.
+    Context->TokenCacheCheckTime = now + LSA_MAP_SECURITY_TOKEN_CACHE_CHECK_INTERVAL;
+    pthread_mutex_unlock(&Context->TokenCacheLock);
+
+    status = LsaMapSecurityOpenConnection(Context, &hConnection);
+    if (NT_SUCCESS(status))
+    {
+        dwError = LsaProviderIoControl(
+                        hConnection,
+                        LSA_PROVIDER_TAG_AD,
+                        LSA_AD_IO_GET_CACHE_GENERATION,
+                        0,
+                        NULL,
+                        &dwOutputBufferSize,
+                        &pOutputBuffer);
+        if (!dwError && dwOutputBufferSize != sizeof(dwGeneration))
+        {
+            dwError = LW_ERROR_INVALID_MESSAGE;
+        }
+        status = LsaLsaErrorToNtStatus(dwError);
+    }
+
+    if (NT_SUCCESS(status))
+    {
+        memcpy(&dwGeneration, pOutputBuffer, sizeof(dwGeneration));
+    }
+
+    LsaMapSecurityCloseConnection(Context, &hConnection, status);
+    LW_SAFE_FREE_MEMORY(pOutputBuffer);
+
+    pthread_mutex_lock(&Context->TokenCacheLock);
+    // If the generation cannot be read, there is no telling what was
+    // flushed (LSASS may even have restarted), so drop everything and
+    // ask again on the next lookup.
+    if (!NT_SUCCESS(status) ||
+        !Context->bTokenCacheGenerationValid ||
+        Context->TokenCacheGeneration != dwGeneration)
+    {
+        LwRtlHashTableClear(
+            Context->pTokenCache,
+            LsaMapSecurityFreeTokenCacheEntry,
+            Context);
+        Context->TokenCacheEpoch++;
+        Context->TokenCacheGeneration = dwGeneration;
+        Context->bTokenCacheGenerationValid = NT_SUCCESS(status);
+
+        if (!NT_SUCCESS(status))
+        {
+            Context->TokenCacheCheckTime = 0;
+        }
+    }
+    *pEpoch = Context->TokenCacheEpoch;
+    pthread_mutex_unlock(&Context->TokenCacheLock);
+}
+
+static
+NTSTATUS
+LsaMapSecurityTokenCacheLookup(
+    IN PLW_MAP_SECURITY_PLUGIN_CONTEXT Context,
+    IN PLSA_MAP_SECURITY_PAC_KEY pPacKey,
+    OUT PACCESS_TOKEN_CREATE_INFORMATION* CreateInformation
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    PLW_HASHTABLE_NODE pNode = NULL;
+    PLSA_MAP_SECURITY_TOKEN_CACHE_ENTRY pEntry = NULL;
+    PACCESS_TOKEN_CREATE_INFORMATION createInformation = NULL;
+    BOOLEAN bInLock = FALSE;
+
+    pthread_mutex_lock(&Context->TokenCacheLock);
+    bInLock = TRUE;
+
+    status = LwRtlHashTableFindKey(Context->pTokenCache, &pNode, pPacKey);
+    GOTO_CLEANUP_ON_STATUS(status);
+
+    pEntry = LW_STRUCT_FROM_FIELD(pNode, LSA_MAP_SECURITY_TOKEN_CACHE_ENTRY, Node);
+
+    if (pEntry->ExpirationTime <= time(NULL))
+    {
+        LwRtlHashTableRemove(Context->pTokenCache, pNode);
+        LsaMapSecurityFreeTokenCacheEntry(pNode, Context);
+
+        status = STATUS_NOT_FOUND;
+        GOTO_CLEANUP_ON_STATUS(status);
+    }
+
+    status = LsaMapSecurityDuplicateAccessTokenCreateInformation(
+        Context,
+        &createInformation,
+        pEntry->CreateInformation);
+    GOTO_CLEANUP_ON_STATUS(status);
+
+cleanup:
+    if (bInLock)
+    {
+        pthread_mutex_unlock(&Context->TokenCacheLock);
+    }
+
+    *CreateInformation = createInformation;
+
+    return status;
+}
+
+static
+VOID
+LsaMapSecurityTokenCacheAdd(
+    IN PLW_MAP_SECURITY_PLUGIN_CONTEXT Context,
+    IN ULONG Epoch,
+    IN PLSA_MAP_SECURITY_PAC_KEY pPacKey,
+    IN PACCESS_TOKEN_CREATE_INFORMATION CreateInformation
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    PLSA_MAP_SECURITY_TOKEN_CACHE_ENTRY pEntry = NULL;
+    PLW_HASHTABLE_NODE pNode = NULL;
+    PLW_HASHTABLE_NODE pPrevNode = NULL;
+    LW_HASHTABLE_ITER iter = LW_HASHTABLE_ITER_INIT;
+    time_t now = time(NULL);
+    BOOLEAN bInLock = FALSE;
+
+    status = RTL_ALLOCATE(&pEntry, LSA_MAP_SECURITY_TOKEN_CACHE_ENTRY, sizeof(*pEntry));
+    GOTO_CLEANUP_ON_STATUS(status);
+
+    status = RTL_ALLOCATE(&pEntry->Key.Data, BYTE, pPacKey->Length);
+    GOTO_CLEANUP_ON_STATUS(status);
+
+    memcpy(pEntry->Key.Data, pPacKey->Data, pPacKey->Length);
+    pEntry->Key.Length = pPacKey->Length;
+    pEntry->ExpirationTime = now + LSA_MAP_SECURITY_TOKEN_CACHE_LIFETIME;
+
+    status = LsaMapSecurityDuplicateAccessTokenCreateInformation(
+        Context,
+        &pEntry->CreateInformation,
+        CreateInformation);
+    GOTO_CLEANUP_ON_STATUS(status);
+
+    pthread_mutex_lock(&Context->TokenCacheLock);
+    bInLock = TRUE;
+
+    if (Context->TokenCacheEpoch != Epoch)
+    {
+        // The cache was flushed while this token was being built.
+        goto cleanup;
+    }
+
+    if (LwRtlHashTableGetCount(Context->pTokenCache) >= LSA_MAP_SECURITY_TOKEN_CACHE_SIZE)
+    {
+        // Drop whatever has expired, and everything if that was not enough.
+        while ((pNode = LwRtlHashTableIterate(Context->pTokenCache, &iter)))
+        {
+            PLSA_MAP_SECURITY_TOKEN_CACHE_ENTRY pOldEntry =
+                LW_STRUCT_FROM_FIELD(pNode, LSA_MAP_SECURITY_TOKEN_CACHE_ENTRY, Node);
+
+            if (pOldEntry->ExpirationTime <= now)
+            {
+                LwRtlHashTableRemove(Context->pTokenCache, pNode);
+                LsaMapSecurityFreeTokenCacheEntry(pNode, Context);
+            }
+        }
+
+        if (LwRtlHashTableGetCount(Context->pTokenCache) >= LSA_MAP_SECURITY_TOKEN_CACHE_SIZE)
+        {
+            LwRtlHashTableClear(
+                Context->pTokenCache,
+                LsaMapSecurityFreeTokenCacheEntry,
+                Context);
+        }
+    }
+
+    LwRtlHashTableInsert(Context->pTokenCache, &pEntry->Node, &pPrevNode);
+    pEntry = NULL;
+
+    if (pPrevNode)
+    {
+        LsaMapSecurityFreeTokenCacheEntry(pPrevNode, Context);
+    }
+
+cleanup:
+    if (bInLock)
+    {
+        pthread_mutex_unlock(&Context->TokenCacheLock);
+    }
+
+    if (pEntry)
+    {
+        LsaMapSecurityFreeTokenCacheEntry(&pEntry->Node, Context);
+    }
+}
+
 static
 NTSTATUS
 LsaMapSecurityGetAccessTokenCreateInformationFromUid(
@@ -1752,13 +2189,24 @@ LsaMapSecurityGetAccessTokenCreateInformationFromGssContext(
     PSID* ppInputSids = NULL;
     DWORD dwIndex = 0;
     PSID pSid = NULL;
+    LSA_MAP_SECURITY_PAC_KEY pacKey = { 0 };
+    ULONG epoch = 0;
 
     status = LsaMapSecurityGetPacInfoFromGssContext(
         Context,
         &pPac,
+        &pacKey,
         GssContext);
     GOTO_CLEANUP_ON_STATUS(status);
 
+    LsaMapSecurityTokenCacheCheckGeneration(Context, &epoch);
+
+    status = LsaMapSecurityTokenCacheLookup(Context, &pacKey, CreateInformation);
+    if (NT_SUCCESS(status))
+    {
+        goto cleanup;
+    }
+
     status = LsaMapSecurityResolveObjectInfoFromPac(Context, pPac, &objectInfo);
     GOTO_CLEANUP_ON_STATUS(status);
 
@@ -1809,9 +2257,12 @@ LsaMapSecurityGetAccessTokenCreateInformationFromGssContext(
         ppInputSids);
     GOTO_CLEANUP_ON_STATUS(status);
 
+    LsaMapSecurityTokenCacheAdd(Context, epoch, &pacKey, *CreateInformation);
+
 cleanup:
 
     RTL_FREE(&pSid);
+    RTL_FREE(&pacKey.Data);
 
     for (dwIndex = 0; dwIndex < dwInputSidCount; dwIndex++)
     {
@@ -1840,6 +2291,32 @@ LsaMapSecurityFreeContext(
 
     if (context)
     {
+        ULONG i = 0;
+
+        for (i = 0; i < context->ConnectionCount; i++)
+        {
+            (VOID) LsaCloseServer(context->hConnections[i]);
+        }
+
+        if (context->pTokenCache)
+        {
+            LwRtlHashTableClear(
+                context->pTokenCache,
+                LsaMapSecurityFreeTokenCacheEntry,
+                context);
+            LwRtlFreeHashTable(&context->pTokenCache);
+        }
+
+        if (context->bConnectionLockInit)
+        {
+            pthread_mutex_destroy(&context->ConnectionLock);
+        }
+
+        if (context->bTokenCacheLockInit)
+        {
+            pthread_mutex_destroy(&context->TokenCacheLock);
+        }
+
         RTL_FREE(&context);
         *Context = NULL;
     }
@@ -1892,7 +2369,7 @@ cleanup:
         LsaMapSecurityFreeSid(pContext, &pGuestSid);
     }
 
-    LsaMapSecurityCloseConnection(pContext, &hLsaConnection);
+    LsaMapSecurityCloseConnection(pContext, &hLsaConnection, status);
 
     *ppGuestSid = pGuestSid;
 
@@ -2228,7 +2705,7 @@ cleanup:
 
     RTL_FREE(&ppInputSids);
 
-    LsaMapSecurityCloseConnection(Context, &hLsaConnection);
+    LsaMapSecurityCloseConnection(Context, &hLsaConnection, status);
     LsaMapSecurityFreeObjectInfo(&objectInfo);
 
     *ppNtlmResult = pNtlmResult;
@@ -2269,6 +2746,25 @@ MapSecurityPluginCreateContext(
     status = RTL_ALLOCATE(&context, LW_MAP_SECURITY_PLUGIN_CONTEXT, sizeof(*context));
     GOTO_CLEANUP_ON_STATUS(status);
 
+    status = LwErrnoToNtStatus(pthread_mutex_init(&context->ConnectionLock, NULL));
+    GOTO_CLEANUP_ON_STATUS(status);
+
+    context->bConnectionLockInit = TRUE;
+
+    status = LwErrnoToNtStatus(pthread_mutex_init(&context->TokenCacheLock, NULL));
+    GOTO_CLEANUP_ON_STATUS(status);
+
+    context->bTokenCacheLockInit = TRUE;
+
+    status = LwRtlCreateHashTable(
+        &context->pTokenCache,
+        LsaMapSecurityTokenCacheGetKey,
+        LsaMapSecurityTokenCacheDigest,
+        LsaMapSecurityTokenCacheEqual,
+        NULL,
+        LSA_MAP_SECURITY_TOKEN_CACHE_SIZE);
+    GOTO_CLEANUP_ON_STATUS(status);
+
 cleanup:
     if (!NT_SUCCESS(status))
     {
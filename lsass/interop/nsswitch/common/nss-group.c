@@ -49,7 +49,7 @@
 
 #include "lsanss.h"
 
-static const DWORD MAX_NUM_GROUPS = 500;
+static const DWORD MAX_NUM_GROUPS = 2000;
 
 VOID
 LsaNssClearEnumGroupsState(
@@ -226,6 +226,180 @@ error:
     goto cleanup;
 }
 
+DWORD
+LsaNssWriteGroupObject(
+    PLSA_SECURITY_OBJECT pGroup,
+    DWORD       dwMemberCount,
+    DWORD       dwMemberNamesLength,
+    PCSTR       pszMemberNames,
+    group_ptr_t pResultGroup,
+    char**      ppszBuf,
+    int         bufLen)
+{
+    DWORD dwError = 0;
+    PSTR  pszMarker = *ppszBuf;
+    PCSTR pszMember = pszMemberNames;
+    PCSTR pszPasswd = NULL;
+    size_t sAlignBytes = 0;
+    size_t sRequired = 0;
+    size_t sLen = 0;
+    DWORD iMember = 0;
+
+    memset(pResultGroup, 0, sizeof(struct group));
+
+    if (!pGroup->enabled)
+    {
+        dwError = LW_ERROR_NO_SUCH_GROUP;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    pszPasswd = LW_IS_NULL_OR_EMPTY_STR(pGroup->groupInfo.pszPasswd) ?
+                    "x" : pGroup->groupInfo.pszPasswd;
+
+    sAlignBytes = (sizeof(PSTR) - ((size_t)pszMarker) % sizeof(PSTR)) % sizeof(PSTR);
+
+    sRequired = sAlignBytes +
+                sizeof(PSTR) * (dwMemberCount + 1) +
+                dwMemberNamesLength +
+                strlen(pGroup->groupInfo.pszUnixName) + 1 +
+                strlen(pszPasswd) + 1;
+
+    if (bufLen < 0 || sRequired > (size_t) bufLen)
+    {
+        dwError = LW_ERROR_INSUFFICIENT_BUFFER;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    pResultGroup->gr_gid = pGroup->groupInfo.gid;
+
+    pszMarker += sAlignBytes;
+    pResultGroup->gr_mem = (PSTR*)pszMarker;
+    pszMarker += sizeof(PSTR) * (dwMemberCount + 1);
+
+    //
+    // The names are already packed the way they are laid out here, so
+    // copy them in one go and just point gr_mem into the copy.
+    //
+    if (dwMemberNamesLength)
+    {
+        memcpy(pszMarker, pszMemberNames, dwMemberNamesLength);
+    }
+
+    for (iMember = 0; iMember < dwMemberCount; iMember++)
+    {
+        if (pszMember >= pszMemberNames + dwMemberNamesLength)
+        {
+            dwError = LW_ERROR_INTERNAL;
+            BAIL_ON_LSA_ERROR(dwError);
+        }
+
+        pResultGroup->gr_mem[iMember] = pszMarker + (pszMember - pszMemberNames);
+        pszMember += strlen(pszMember) + 1;
+    }
+    pResultGroup->gr_mem[iMember] = NULL;
+    pszMarker += dwMemberNamesLength;
+
+    sLen = strlen(pGroup->groupInfo.pszUnixName) + 1;
+    memcpy(pszMarker, pGroup->groupInfo.pszUnixName, sLen);
+    pResultGroup->gr_name = pszMarker;
+    pszMarker += sLen;
+
+    sLen = strlen(pszPasswd) + 1;
+    memcpy(pszMarker, pszPasswd, sLen);
+    pResultGroup->gr_passwd = pszMarker;
+    pszMarker += sLen;
+
+cleanup:
+
+    return dwError;
+
+error:
+
+    goto cleanup;
+}
+
+static
+NSS_STATUS
+LsaNssCommonGroupFind(
+    PLSA_NSS_CACHED_HANDLE pConnection,
+    LSA_QUERY_TYPE QueryType,
+    LSA_QUERY_ITEM QueryItem,
+    struct group* pResultGroup,
+    char* pszBuf,
+    size_t bufLen,
+    int* pErrorNumber
+    )
+{
+    int ret = NSS_STATUS_SUCCESS;
+    HANDLE hLsaConnection = NULL;
+    PLSA_SECURITY_OBJECT pGroup = NULL;
+    DWORD dwMemberCount = 0;
+    DWORD dwMemberNamesLength = 0;
+    PSTR pszMemberNames = NULL;
+    DWORD dwMaxMemberNamesLength = 0;
+
+    ret = MAP_LSA_ERROR(NULL,
+            LsaNssCommonEnsureConnected(pConnection));
+    BAIL_ON_NSS_ERROR(ret);
+    hLsaConnection = pConnection->hLsaConnection;
+
+    /*
+     * The member names can never need more room than the caller gave us,
+     * so let lsassd refuse early instead of sending a list that would
+     * only be thrown away before the caller retries with a bigger buffer.
+     */
+    dwMaxMemberNamesLength = (bufLen > (DWORD) -1) ? (DWORD) -1 : (DWORD) bufLen;
+    if (!dwMaxMemberNamesLength)
+    {
+        dwMaxMemberNamesLength = 1;
+    }
+
+    ret = MAP_LSA_ERROR(pErrorNumber,
+                        LsaFindGroupAndMemberNames(
+                            hLsaConnection,
+                            NULL,
+                            LSA_FIND_FLAGS_NSS,
+                            QueryType,
+                            QueryItem,
+                            dwMaxMemberNamesLength,
+                            &pGroup,
+                            &dwMemberCount,
+                            &dwMemberNamesLength,
+                            &pszMemberNames));
+    BAIL_ON_NSS_ERROR(ret);
+
+    ret = MAP_LSA_ERROR(pErrorNumber,
+                        LsaNssWriteGroupObject(
+                            pGroup,
+                            dwMemberCount,
+                            dwMemberNamesLength,
+                            pszMemberNames,
+                            pResultGroup,
+                            &pszBuf,
+                            bufLen));
+    BAIL_ON_NSS_ERROR(ret);
+
+cleanup:
+
+    if (pGroup)
+    {
+        LsaFreeSecurityObject(pGroup);
+    }
+
+    LsaFreeMemberNames(pszMemberNames);
+
+    return ret;
+
+error:
+
+    if (ret != NSS_STATUS_TRYAGAIN && ret != NSS_STATUS_NOTFOUND)
+    {
+        LsaNssCommonCloseConnection(pConnection);
+    }
+
+    goto cleanup;
+}
+
 NSS_STATUS
 LsaNssCommonGroupSetgrent(
     PLSA_NSS_CACHED_HANDLE pConnection,
@@ -385,52 +559,18 @@ LsaNssCommonGroupGetgrgid(
     int* pErrorNumber
     )
 {
-    int ret = NSS_STATUS_SUCCESS;
-    HANDLE hLsaConnection = NULL;
-    PVOID pGroupInfo = NULL;
-    DWORD dwGroupInfoLevel = 1;
-
-    ret = MAP_LSA_ERROR(NULL,
-            LsaNssCommonEnsureConnected(pConnection));
-    BAIL_ON_NSS_ERROR(ret);
-    hLsaConnection = pConnection->hLsaConnection;
-
-    ret = MAP_LSA_ERROR(pErrorNumber,
-                        LsaFindGroupById(
-                            hLsaConnection,
-                            gid,
-                            LSA_FIND_FLAGS_NSS,
-                            dwGroupInfoLevel,
-                            &pGroupInfo));
-    BAIL_ON_NSS_ERROR(ret);
-
-    ret = MAP_LSA_ERROR(pErrorNumber,
-                        LsaNssWriteGroupInfo(
-                            dwGroupInfoLevel,
-                            pGroupInfo,
-                            pResultGroup,
-                            &pszBuf,
-                            bufLen
-                            ));
-    BAIL_ON_NSS_ERROR(ret);
-
-cleanup:
-
-    if (pGroupInfo)
-    {
-        LsaFreeGroupInfo(dwGroupInfoLevel, pGroupInfo);
-    }
-
-    return ret;
-
-error:
-
-    if (ret != NSS_STATUS_TRYAGAIN && ret != NSS_STATUS_NOTFOUND)
-    {
-        LsaNssCommonCloseConnection(pConnection);
-    }
-
-    goto cleanup;
+    LSA_QUERY_ITEM QueryItem;
+
+    QueryItem.dwId = (DWORD) gid;
+
+    return LsaNssCommonGroupFind(
+                pConnection,
+                LSA_QUERY_TYPE_BY_UNIX_ID,
+                QueryItem,
+                pResultGroup,
+                pszBuf,
+                bufLen,
+                pErrorNumber);
 }
 
 NSS_STATUS
@@ -444,9 +584,7 @@ LsaNssCommonGroupGetgrnam(
     )
 {
     int ret = NSS_STATUS_SUCCESS;
-    HANDLE  hLsaConnection = NULL;
-    PVOID pGroupInfo = NULL;
-    DWORD dwGroupInfoLevel = 1;
+    LSA_QUERY_ITEM QueryItem;
 
     if (LsaShouldIgnoreGroup(pszGroupName))
     {
@@ -454,45 +592,20 @@ LsaNssCommonGroupGetgrnam(
         BAIL_ON_NSS_ERROR(ret);
     }
 
-    ret = MAP_LSA_ERROR(NULL,
-            LsaNssCommonEnsureConnected(pConnection));
-    BAIL_ON_NSS_ERROR(ret);
-    hLsaConnection = pConnection->hLsaConnection;
-
-    ret = MAP_LSA_ERROR(pErrorNumber,
-                        LsaFindGroupByName(
-                            hLsaConnection,
-                            pszGroupName,
-                            LSA_FIND_FLAGS_NSS,
-                            dwGroupInfoLevel,
-                            &pGroupInfo));
-    BAIL_ON_NSS_ERROR(ret);
-
-    ret = MAP_LSA_ERROR(pErrorNumber,
-                        LsaNssWriteGroupInfo(
-                            dwGroupInfoLevel,
-                            pGroupInfo,
-                            pResultGroup,
-                            &pszBuf,
-                            bufLen));
-    BAIL_ON_NSS_ERROR(ret);
-
-cleanup:
+    QueryItem.pszString = pszGroupName;
 
-    if (pGroupInfo) {
-        LsaFreeGroupInfo(dwGroupInfoLevel, pGroupInfo);
-    }
-
-    return ret;
+    ret = LsaNssCommonGroupFind(
+                pConnection,
+                LSA_QUERY_TYPE_BY_NAME,
+                QueryItem,
+                pResultGroup,
+                pszBuf,
+                bufLen,
+                pErrorNumber);
 
 error:
 
-    if (ret != NSS_STATUS_TRYAGAIN && ret != NSS_STATUS_NOTFOUND)
-    {
-        LsaNssCommonCloseConnection(pConnection);
-    }
-
-    goto cleanup;
+    return ret;
 }
 
 NSS_STATUS
@@ -48,7 +48,7 @@
 
 #include "lsanss.h"
 
-static const int MAX_NUM_USERS = 500;
+static const int MAX_NUM_USERS = 2000;
 
 VOID
 LsaNssClearEnumUsersState(
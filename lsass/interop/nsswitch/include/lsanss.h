@@ -194,6 +194,17 @@ LsaNssWriteGroupInfo(
     int         bufLen
     );
 
+DWORD
+LsaNssWriteGroupObject(
+    PLSA_SECURITY_OBJECT pGroup,
+    DWORD       dwMemberCount,
+    DWORD       dwMemberNamesLength,
+    PCSTR       pszMemberNames,
+    group_ptr_t pResultGroup,
+    char**      ppszBuf,
+    int         bufLen
+    );
+
 VOID
 LsaNssClearEnumArtefactsState(
     HANDLE hLsaConnection,
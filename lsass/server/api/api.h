@@ -88,6 +88,8 @@
 #include "metrics_p.h"
 #include "status_p.h"
 #include "config_p.h"
+#include "membercache_p.h"
+#include "lookupcache_p.h"
 
 #include "lsasrvapi.h"
 #include "lsasrvapi2.h"
@@ -359,12 +359,47 @@ error:
     goto cleanup;
 }
 
+static
+VOID
+LsaSrvGetQueryItem(
+    IN LSA_QUERY_TYPE QueryType,
+    IN LSA_QUERY_LIST QueryList,
+    IN DWORD dwIndex,
+    OUT PLSA_QUERY_ITEM pQueryItem
+    )
+{
+    switch (QueryType)
+    {
+    case LSA_QUERY_TYPE_BY_UNIX_ID:
+        pQueryItem->dwId = QueryList.pdwIds[dwIndex];
+        break;
+    default:
+        pQueryItem->pszString = QueryList.ppszStrings[dwIndex];
+        break;
+    }
+}
+
+static
+BOOLEAN
+LsaSrvIsQueryKeyForProvider(
+    IN PLSA_AUTH_PROVIDER pProvider,
+    IN PLSA_SRV_QUERY_ROUTE pRoute,
+    IN PLSA_SECURITY_OBJECT pCombinedObject
+    )
+{
+    return (pCombinedObject == NULL &&
+            !pRoute->bMissing &&
+            (pRoute->pProvider == NULL || pRoute->pProvider == pProvider));
+}
+
 static
 VOID
 LsaSrvConstructPartialQuery(
+    IN PLSA_AUTH_PROVIDER pProvider,
     IN LSA_QUERY_TYPE QueryType,
     IN DWORD dwCount,
     IN LSA_QUERY_LIST QueryList,
+    IN PLSA_SRV_QUERY_ROUTE pRoutes,
     IN PLSA_SECURITY_OBJECT* ppCombinedObjects,
     OUT PDWORD pdwPartialCount,
     OUT LSA_QUERY_LIST PartialQueryList
@@ -375,7 +410,10 @@ LsaSrvConstructPartialQuery(
 
     for (dwIndex = 0; dwIndex < dwCount; dwIndex++)
     {
-        if (ppCombinedObjects[dwIndex] == NULL)
+        if (LsaSrvIsQueryKeyForProvider(
+                pProvider,
+                &pRoutes[dwIndex],
+                ppCombinedObjects[dwIndex]))
         {
             switch (QueryType)
             {
@@ -397,19 +435,40 @@ LsaSrvConstructPartialQuery(
 static
 VOID
 LsaSrvMergePartialQueryResult(
+    IN PLSA_AUTH_PROVIDER pProvider,
+    IN LSA_QUERY_TYPE QueryType,
     IN DWORD dwCount,
+    IN LSA_QUERY_LIST QueryList,
+    IN PLSA_SRV_QUERY_ROUTE pRoutes,
+    IN DWORD dwGeneration,
     IN PLSA_SECURITY_OBJECT* ppPartialObjects,
     OUT PLSA_SECURITY_OBJECT* ppCombinedObjects
     )
 {
     DWORD dwIndex = 0;
     DWORD dwPartialIndex = 0;
+    LSA_QUERY_ITEM QueryItem;
 
     for (dwIndex = 0; dwIndex < dwCount; dwIndex++)
     {
-        if (ppCombinedObjects[dwIndex] == NULL)
+        if (LsaSrvIsQueryKeyForProvider(
+                pProvider,
+                &pRoutes[dwIndex],
+                ppCombinedObjects[dwIndex]))
         {
             ppCombinedObjects[dwIndex] = ppPartialObjects[dwPartialIndex++];
+
+            if (ppCombinedObjects[dwIndex] && !pRoutes[dwIndex].pProvider)
+            {
+                LsaSrvGetQueryItem(QueryType, QueryList, dwIndex, &QueryItem);
+
+                LsaSrvLookupCacheAddRoutes(
+                    pProvider,
+                    QueryType,
+                    QueryItem,
+                    ppCombinedObjects[dwIndex],
+                    dwGeneration);
+            }
         }
     }
 }
@@ -437,9 +496,18 @@ LsaSrvFindObjectsInternal(
     BOOLEAN bFoundProvider = FALSE;
     PSTR pszTargetProviderName = NULL;
     PSTR pszTargetInstance = NULL;
+    PLSA_SRV_QUERY_ROUTE pRoutes = NULL;
+    DWORD dwGeneration = 0;
+    DWORD dwIndex = 0;
+    LSA_QUERY_ITEM QueryItem;
 
     memset(&PartialQueryList, 0, sizeof(PartialQueryList));
 
+    dwError = LwAllocateMemory(
+        sizeof(*pRoutes) * dwCount,
+        OUT_PPVOID(&pRoutes));
+    BAIL_ON_LSA_ERROR(dwError);
+
     switch (QueryType)
     {
     case LSA_QUERY_TYPE_BY_UNIX_ID:
@@ -465,8 +533,36 @@ LsaSrvFindObjectsInternal(
         BAIL_ON_LSA_ERROR(dwError);
     }
 
+    /* Anything that could create an object after this point makes
+       the misses found below unsafe to cache */
+    dwGeneration = LsaSrvGetLookupCacheGeneration();
+
     ENTER_AUTH_PROVIDER_LIST_READER_LOCK(bInLock);
 
+    for (dwIndex = 0; dwIndex < dwCount; dwIndex++)
+    {
+        LsaSrvGetQueryItem(QueryType, QueryList, dwIndex, &QueryItem);
+
+        pRoutes[dwIndex].bMissing = LsaSrvLookupCacheIsMissing(
+                                        pszTargetProvider,
+                                        FindFlags,
+                                        ObjectType,
+                                        QueryType,
+                                        QueryItem);
+        LsaSrvRecordCacheLookup(
+            LSA_METRIC_CACHE_NEGATIVE_LOOKUP,
+            pRoutes[dwIndex].bMissing);
+
+        /* Domain-qualified keys go straight to the provider that owns
+           the domain unless the caller picked a provider itself */
+        if (!pRoutes[dwIndex].bMissing && !pszTargetProviderName)
+        {
+            pRoutes[dwIndex].pProvider = LsaSrvLookupCacheGetRoute(
+                                            QueryType,
+                                            QueryItem);
+        }
+    }
+
     for (pProvider = gpAuthProviderList;
          pProvider;
          pProvider = pProvider->pNext)
@@ -489,17 +585,19 @@ LsaSrvFindObjectsInternal(
         }
 
         LsaSrvConstructPartialQuery(
+            pProvider,
             QueryType,
             dwCount,
             QueryList,
+            pRoutes,
             ppCombinedObjects,
             &dwPartialCount,
             PartialQueryList);
 
-        /* Stop iterating if all keys now have results */
+        /* Skip providers with nothing left to answer */
         if (dwPartialCount == 0)
         {
-            break;
+            continue;
         }
 
         dwError = LsaSrvOpenProvider(
@@ -527,7 +625,12 @@ LsaSrvFindObjectsInternal(
             BAIL_ON_LSA_ERROR(dwError);
 
             LsaSrvMergePartialQueryResult(
+                pProvider,
+                QueryType,
                 dwCount,
+                QueryList,
+                pRoutes,
+                dwGeneration,
                 ppPartialObjects,
                 ppCombinedObjects);
         }
@@ -543,6 +646,22 @@ LsaSrvFindObjectsInternal(
         BAIL_ON_LSA_ERROR(dwError);
     }
 
+    for (dwIndex = 0; dwIndex < dwCount; dwIndex++)
+    {
+        if (!ppCombinedObjects[dwIndex] && !pRoutes[dwIndex].bMissing)
+        {
+            LsaSrvGetQueryItem(QueryType, QueryList, dwIndex, &QueryItem);
+
+            LsaSrvLookupCacheAddMissing(
+                pszTargetProvider,
+                FindFlags,
+                ObjectType,
+                QueryType,
+                QueryItem,
+                dwGeneration);
+        }
+    }
+
 cleanup:
 
     /* All objects inside the partial result list were moved into
@@ -553,6 +672,7 @@ cleanup:
 
     LW_SAFE_FREE_STRING(pszTargetProviderName);
     LW_SAFE_FREE_STRING(pszTargetInstance);
+    LW_SAFE_FREE_MEMORY(pRoutes);
 
     if (hProvider != NULL)
     {
@@ -586,6 +706,7 @@ LsaSrvFindObjects(
     LSA_QUERY_LIST SingleList;
     LSA_QUERY_TYPE SingleType = 0;
     PLSA_LOGIN_NAME_INFO pLoginInfo = NULL;
+    UINT64 ullStartTime = LsaSrvBeginMetricOperation();
 
     dwError = LwAllocateMemory(
         sizeof(*ppCombinedObjects) * dwCount,
@@ -658,6 +779,8 @@ LsaSrvFindObjects(
 
 cleanup:
 
+    LsaSrvEndMetricOperation(LSA_METRIC_OP_FIND_OBJECTS, ullStartTime, dwError);
+
     if (pLoginInfo)
     {
         LsaSrvFreeNameInfo(pLoginInfo);
@@ -780,6 +903,7 @@ LsaSrvEnumObjects(
     PLSA_SECURITY_OBJECT* ppPartialObjects = NULL;
     DWORD dwCombinedObjectCount = 0;
     DWORD dwPartialObjectCount = 0;
+    UINT64 ullStartTime = LsaSrvBeginMetricOperation();
 
     if (pEnum->Type != LSA_SRV_ENUM_OBJECTS)
     {
@@ -873,6 +997,12 @@ LsaSrvEnumObjects(
 
 cleanup:
 
+    /* Running off the end is how enumerations finish, not a failure */
+    LsaSrvEndMetricOperation(
+        LSA_METRIC_OP_ENUM_OBJECTS,
+        ullStartTime,
+        dwError == ERROR_NO_MORE_ITEMS ? 0 : dwError);
+
     LW_SAFE_FREE_MEMORY(ppPartialObjects);
 
     return dwError;
@@ -1304,6 +1434,7 @@ LsaSrvQueryMemberOf(
     DWORD dwError = 0;
     PSTR pszTargetProviderName = NULL;
     PSTR pszTargetInstance = NULL;
+    UINT64 ullStartTime = LsaSrvBeginMetricOperation();
 
     if (pszTargetProvider)
     {
@@ -1350,6 +1481,8 @@ LsaSrvQueryMemberOf(
 
 cleanup:
 
+    LsaSrvEndMetricOperation(LSA_METRIC_OP_QUERY_MEMBER_OF, ullStartTime, dwError);
+
     LW_SAFE_FREE_STRING(pszTargetProviderName);
     LW_SAFE_FREE_STRING(pszTargetInstance);
 
@@ -1654,6 +1787,122 @@ error:
     goto cleanup;
 }
 
+DWORD
+LsaSrvFindGroupAndMemberNames(
+    IN HANDLE hServer,
+    IN OPTIONAL PCSTR pszTargetProvider,
+    IN LSA_FIND_FLAGS FindFlags,
+    IN LSA_QUERY_TYPE QueryType,
+    IN LSA_QUERY_ITEM QueryItem,
+    OUT PLSA_SECURITY_OBJECT* ppGroupObject,
+    OUT PLSA_SRV_MEMBER_NAMES* ppMemberNames
+    )
+{
+    DWORD dwError = 0;
+    LSA_QUERY_LIST QueryList;
+    PLSA_SECURITY_OBJECT* ppObjects = NULL;
+    DWORD dwMemberCount = 0;
+    PLSA_SECURITY_OBJECT* ppMembers = NULL;
+    PLSA_SRV_MEMBER_NAMES pMemberNames = NULL;
+    DWORD dwGeneration = 0;
+
+    switch(QueryType)
+    {
+    case LSA_QUERY_TYPE_BY_UNIX_ID:
+        QueryList.pdwIds = &QueryItem.dwId;
+        break;
+    default:
+        QueryList.ppszStrings = &QueryItem.pszString;
+        break;
+    }
+
+    dwError = LsaSrvFindObjects(
+        hServer,
+        pszTargetProvider,
+        FindFlags,
+        LSA_OBJECT_TYPE_GROUP,
+        QueryType,
+        1,
+        QueryList,
+        &ppObjects);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    if (!ppObjects[0])
+    {
+        dwError = LW_ERROR_NO_SUCH_GROUP;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    /*
+     * Only lookups across all providers are cached; a targeted lookup
+     * may see a different membership for the same SID.
+     */
+    if (pszTargetProvider)
+    {
+        dwError = ERROR_NOT_FOUND;
+    }
+    else
+    {
+        dwError = LsaSrvLookupMemberNames(
+            ppObjects[0]->pszObjectSid,
+            FindFlags,
+            &dwGeneration,
+            &pMemberNames);
+    }
+
+    if (dwError == ERROR_NOT_FOUND)
+    {
+        dwError = LsaSrvQueryExpandedGroupMembers(
+            hServer,
+            pszTargetProvider,
+            FindFlags,
+            LSA_OBJECT_TYPE_USER,
+            ppObjects[0]->pszObjectSid,
+            &dwMemberCount,
+            &ppMembers);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        dwError = LsaSrvCreateMemberNames(
+            ppObjects[0]->pszObjectSid,
+            FindFlags,
+            dwGeneration,
+            dwMemberCount,
+            ppMembers,
+            &pMemberNames);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        if (!pszTargetProvider)
+        {
+            LsaSrvCacheMemberNames(pMemberNames);
+        }
+    }
+    BAIL_ON_LSA_ERROR(dwError);
+
+    *ppGroupObject = ppObjects[0];
+    ppObjects[0] = NULL;
+    *ppMemberNames = pMemberNames;
+
+cleanup:
+
+    LsaUtilFreeSecurityObjectList(1, ppObjects);
+
+    if (ppMembers)
+    {
+        LsaUtilFreeSecurityObjectList(dwMemberCount, ppMembers);
+    }
+
+    return dwError;
+
+error:
+
+    *ppGroupObject = NULL;
+    *ppMemberNames = NULL;
+
+    LsaSrvReleaseMemberNames(pMemberNames);
+
+    goto cleanup;
+}
+
 VOID
 LsaSrvCloseEnum(
     IN HANDLE hServer,
@@ -1765,6 +2014,9 @@ LsaSrvAddUser2(
 
 cleanup:
 
+    LsaSrvInvalidateMemberNameCache();
+    LsaSrvInvalidateLookupCache();
+
     LW_SAFE_FREE_STRING(pszTargetProviderName);
     LW_SAFE_FREE_STRING(pszTargetInstance);
 
@@ -1868,6 +2120,9 @@ LsaSrvModifyUser2(
 
 cleanup:
 
+    LsaSrvInvalidateMemberNameCache();
+    LsaSrvInvalidateLookupCache();
+
     LW_SAFE_FREE_STRING(pszTargetProviderName);
     LW_SAFE_FREE_STRING(pszTargetInstance);
 
@@ -1968,6 +2223,9 @@ LsaSrvAddGroup2(
 
 cleanup:
 
+    LsaSrvInvalidateMemberNameCache();
+    LsaSrvInvalidateLookupCache();
+
     LW_SAFE_FREE_STRING(pszTargetProviderName);
     LW_SAFE_FREE_STRING(pszTargetInstance);
 
@@ -2071,6 +2329,9 @@ LsaSrvModifyGroup2(
 
 cleanup:
 
+    LsaSrvInvalidateMemberNameCache();
+    LsaSrvInvalidateLookupCache();
+
     LW_SAFE_FREE_STRING(pszTargetProviderName);
     LW_SAFE_FREE_STRING(pszTargetInstance);
 
@@ -2175,6 +2436,9 @@ LsaSrvDeleteObject(
 
 cleanup:
 
+    LsaSrvInvalidateMemberNameCache();
+    LsaSrvInvalidateLookupCache();
+
     LW_SAFE_FREE_STRING(pszTargetProviderName);
     LW_SAFE_FREE_STRING(pszTargetInstance);
 
@@ -54,6 +54,7 @@ LsaSrvAuthenticateUserPam(
     )
 {
     DWORD dwError = 0;
+    UINT64 ullStartTime = 0;
     DWORD dwTraceFlags[] = {LSA_TRACE_FLAG_AUTHENTICATION};
     BOOLEAN bInLock = FALSE;
     PLSA_AUTH_PROVIDER pProvider = NULL;
@@ -62,6 +63,8 @@ LsaSrvAuthenticateUserPam(
 
     LSA_TRACE_BEGIN_FUNCTION(dwTraceFlags, sizeof(dwTraceFlags)/sizeof(dwTraceFlags[0]));
 
+    ullStartTime = LsaSrvBeginMetricOperation();
+
     BAIL_ON_INVALID_POINTER(pParams);
     BAIL_ON_INVALID_STRING(pParams->pszLoginName);
 
@@ -143,6 +146,8 @@ cleanup:
 
     LEAVE_AUTH_PROVIDER_LIST_READER_LOCK(bInLock);
 
+    LsaSrvEndMetricOperation(LSA_METRIC_OP_AUTHENTICATE_USER_PAM, ullStartTime, dwError);
+
     if (!dwError)
     {
         LsaSrvIncrementMetricValue(LsaMetricSuccessfulAuthentications);
@@ -187,6 +192,7 @@ LsaSrvAuthenticateUserEx(
     )
 {
     DWORD dwError = 0;
+    UINT64 ullStartTime = 0;
     DWORD dwTraceFlags[] = {LSA_TRACE_FLAG_AUTHENTICATION};
     BOOLEAN bInLock = FALSE;
     PLSA_AUTH_PROVIDER pProvider = NULL;
@@ -202,6 +208,8 @@ LsaSrvAuthenticateUserEx(
 
     LSA_TRACE_BEGIN_FUNCTION(dwTraceFlags, sizeof(dwTraceFlags)/sizeof(dwTraceFlags[0]));
 
+    ullStartTime = LsaSrvBeginMetricOperation();
+
     /* Make copy of parameters structure so we can modify it */
     localUserParams = *pUserParams;
 
@@ -369,6 +377,8 @@ cleanup:
         LsaSrvFreeNameInfo(pLoginInfo);
     }
 
+    LsaSrvEndMetricOperation(LSA_METRIC_OP_AUTHENTICATE_USER_EX, ullStartTime, dwError);
+
     if (!dwError)
     {
         LsaSrvIncrementMetricValue(LsaMetricSuccessfulAuthentications);
@@ -577,6 +587,7 @@ LsaSrvChangePassword(
     )
 {
     DWORD  dwError = 0;
+    UINT64 ullStartTime = 0;
     DWORD dwTraceFlags[] = {LSA_TRACE_FLAG_AUTHENTICATION};
     PLSA_AUTH_PROVIDER pProvider = NULL;
     HANDLE hProvider = (HANDLE)NULL;
@@ -584,6 +595,8 @@ LsaSrvChangePassword(
 
     LSA_TRACE_BEGIN_FUNCTION(dwTraceFlags, sizeof(dwTraceFlags)/sizeof(dwTraceFlags[0]));
 
+    ullStartTime = LsaSrvBeginMetricOperation();
+
     ENTER_AUTH_PROVIDER_LIST_READER_LOCK(bInLock);
 
     dwError = LW_ERROR_NOT_HANDLED;
@@ -642,6 +655,8 @@ cleanup:
 
     LEAVE_AUTH_PROVIDER_LIST_READER_LOCK(bInLock);
 
+    LsaSrvEndMetricOperation(LSA_METRIC_OP_CHANGE_PASSWORD, ullStartTime, dwError);
+
     if (!dwError)
     {
         LsaSrvIncrementMetricValue(LsaMetricSuccessfulChangePassword);
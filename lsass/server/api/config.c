@@ -113,6 +113,9 @@ LsaSrvRefreshConfiguration(
         hProvider = (HANDLE)NULL;
     }
 
+    LsaSrvInvalidateMemberNameCache();
+    LsaSrvInvalidateLookupCache();
+
 cleanup:
 
     if (hProvider != (HANDLE)NULL) {
@@ -147,6 +150,7 @@ LsaSrvApiInitConfig(
     pConfig->bEnableEventLog = FALSE;
     pConfig->cDomainSeparator = '\\';
     pConfig->cSpaceReplacement = '^';
+    pConfig->dwNegativeCacheTimeout = LSA_SRV_DEFAULT_NEGATIVE_CACHE_TIMEOUT_SECS;
 
     return 0;
 }
@@ -191,6 +195,16 @@ LsaSrvApiReadRegistry(
            NULL,
            &pszSpaceReplacement
         },
+        {
+           "NegativeCacheTimeout",
+           TRUE,
+           LsaTypeDword,
+           0,
+           3600,
+           NULL,
+           &StagingConfig.dwNegativeCacheTimeout,
+           NULL
+        },
     };
 
     memset(&StagingConfig, 0, sizeof(StagingConfig));
@@ -309,6 +323,22 @@ LsaSrvApiFreeConfigContents(
     memset(pConfig, 0, sizeof(*pConfig));
 }
 
+DWORD
+LsaSrvNegativeCacheTimeout(
+    VOID
+    )
+{
+    DWORD dwResult = 0;
+
+    pthread_mutex_lock(&gAPIConfigLock);
+
+    dwResult = gAPIConfig.dwNegativeCacheTimeout;
+
+    pthread_mutex_unlock(&gAPIConfigLock);
+
+    return dwResult;
+}
+
 BOOLEAN
 LsaSrvEventlogEnabled(
     VOID
@@ -78,6 +78,11 @@ LsaSrvEventlogEnabled(
     VOID
     );
 
+DWORD
+LsaSrvNegativeCacheTimeout(
+    VOID
+    );
+
 VOID
 LsaSrvEnableEventlog(
     BOOLEAN bValue
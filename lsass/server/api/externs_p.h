@@ -115,9 +115,6 @@ extern pthread_rwlock_t gpRpcServerList_rwlock;
 extern PLSA_RPC_SERVER gpRpcServerList;
 
 
-extern pthread_rwlock_t gPerfCounters_rwlock;
-extern UINT64 gPerfCounters[LsaMetricSentinel];
-
 extern pthread_mutex_t    gAPIConfigLock;
 
 extern LSA_SRV_API_CONFIG gAPIConfig;
@@ -56,9 +56,6 @@ pthread_rwlock_t gpRpcServerList_rwlock;
 
 pthread_t gRpcSrvWorker;
 
-pthread_rwlock_t gPerfCounters_rwlock;
-UINT64 gPerfCounters[LsaMetricSentinel];
-
 pthread_mutex_t    gAPIConfigLock     = PTHREAD_MUTEX_INITIALIZER;
 LSA_SRV_API_CONFIG gAPIConfig = {0};
 
@@ -81,9 +78,8 @@ LsaSrvApiInit(
 
     gServerStartTime = time(NULL);
 
-    pthread_rwlock_init(&gPerfCounters_rwlock, NULL);
-
-    memset(&gPerfCounters[0], 0, sizeof(gPerfCounters));
+    dwError = LsaSrvInitMetrics();
+    BAIL_ON_LSA_ERROR(dwError);
 
     pthread_rwlock_init(&gpAuthProviderList_rwlock, NULL);
 
@@ -143,6 +139,9 @@ LsaSrvApiShutdown(
 {
     LsaSrvFreeAuthProviders();
 
+    LsaSrvFreeMemberNameCache();
+    LsaSrvFreeLookupCache();
+
     LsaSrvFreeRpcServers();
 
     LsaSrvFreePrivileges();
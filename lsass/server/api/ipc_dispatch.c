@@ -955,6 +955,11 @@ LsaSrvIpcGetMetrics(
                 pMetricPack = NULL;
                 break;
 
+            case 2:
+                pResult->pMetricPack.pMetricPack2 = (PLSA_METRIC_PACK_2)pMetricPack;
+                pMetricPack = NULL;
+                break;
+
             default:
                 dwError = LW_ERROR_INVALID_PARAMETER;
                 BAIL_ON_LSA_ERROR(dwError);
@@ -1915,6 +1920,126 @@ error:
     goto cleanup;
 }
 
+static LWMsgStatus
+LsaSrvIpcFindGroupAndMemberNames(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    )
+{
+    DWORD dwError = 0;
+    PLSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_REQ pReq = pIn->data;
+    PLSA2_IPC_FIND_GROUP_AND_MEMBER_NAMES_RES pRes = NULL;
+    PLSA_SECURITY_OBJECT pGroupObject = NULL;
+    PLSA_SRV_MEMBER_NAMES pMemberNames = NULL;
+    PLSA_IPC_ERROR pError = NULL;
+
+    switch (pReq->QueryType)
+    {
+    case LSA_QUERY_TYPE_BY_UNIX_ID:
+        if (pReq->IpcQueryType != LSA2_IPC_QUERY_DWORDS)
+        {
+            dwError = LW_ERROR_INTERNAL;
+        }
+        break;
+    case LSA_QUERY_TYPE_BY_DN:
+    case LSA_QUERY_TYPE_BY_SID:
+    case LSA_QUERY_TYPE_BY_NT4:
+    case LSA_QUERY_TYPE_BY_ALIAS:
+    case LSA_QUERY_TYPE_BY_UPN:
+    case LSA_QUERY_TYPE_BY_NAME:
+        if (pReq->IpcQueryType != LSA2_IPC_QUERY_STRINGS)
+        {
+            dwError = LW_ERROR_INTERNAL;
+        }
+        break;
+    default:
+        dwError = LW_ERROR_INTERNAL;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    if (!dwError)
+    {
+        dwError = LsaSrvFindGroupAndMemberNames(
+            LsaSrvIpcGetSessionData(pCall),
+            pReq->pszTargetProvider,
+            pReq->FindFlags,
+            pReq->QueryType,
+            pReq->QueryItem,
+            &pGroupObject,
+            &pMemberNames);
+    }
+
+    /*
+     * Let the caller size its buffer without shipping a member list
+     * it has no room for.
+     */
+    if (!dwError &&
+        pReq->dwMaxMemberNamesLength &&
+        pMemberNames->dwMemberNamesLength > pReq->dwMaxMemberNamesLength)
+    {
+        dwError = LW_ERROR_INSUFFICIENT_BUFFER;
+    }
+
+    if (!dwError)
+    {
+        dwError = LwAllocateMemory(sizeof(*pRes), OUT_PPVOID(&pRes));
+        BAIL_ON_LSA_ERROR(dwError);
+
+        if (pMemberNames->dwMemberNamesLength)
+        {
+            dwError = LwAllocateMemory(
+                pMemberNames->dwMemberNamesLength,
+                OUT_PPVOID(&pRes->pMemberNames));
+            BAIL_ON_LSA_ERROR(dwError);
+
+            memcpy(pRes->pMemberNames,
+                   pMemberNames->pMemberNames,
+                   pMemberNames->dwMemberNamesLength);
+        }
+
+        pRes->pGroup = pGroupObject;
+        pRes->dwMemberCount = pMemberNames->dwMemberCount;
+        pRes->dwMemberNamesLength = pMemberNames->dwMemberNamesLength;
+
+        pGroupObject = NULL;
+
+        pOut->tag = LSA2_R_FIND_GROUP_AND_MEMBER_NAMES;
+        pOut->data = pRes;
+        pRes = NULL;
+    }
+    else
+    {
+        dwError = LsaSrvIpcCreateError(dwError, NULL, &pError);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        pOut->tag = LSA2_R_ERROR;
+        pOut->data = pError;
+    }
+
+cleanup:
+
+    if (pGroupObject)
+    {
+        LsaUtilFreeSecurityObject(pGroupObject);
+    }
+
+    LsaSrvReleaseMemberNames(pMemberNames);
+
+    return MAP_LW_ERROR_IPC(dwError);
+
+error:
+
+    if (pRes)
+    {
+        LW_SAFE_FREE_MEMORY(pRes->pMemberNames);
+        LwFreeMemory(pRes);
+    }
+
+    goto cleanup;
+}
+
 static LWMsgStatus
 LsaSrvIpcCloseEnum(
     LWMsgCall* pCall,
@@ -2048,6 +2173,7 @@ static LWMsgDispatchSpec gMessageHandlers[] =
     LWMSG_DISPATCH_BLOCK(LSA_PRIVS_Q_ADD_ACCOUNT_RIGHTS, LsaSrvIpcPrivsAddAccountRights),
     LWMSG_DISPATCH_BLOCK(LSA_PRIVS_Q_REMOVE_ACCOUNT_RIGHTS, LsaSrvIpcPrivsRemoveAccountRights),
     LWMSG_DISPATCH_BLOCK(LSA_PRIVS_Q_ENUM_ACCOUNT_RIGHTS, LsaSrvIpcPrivsEnumAccountRights),
+    LWMSG_DISPATCH_BLOCK(LSA2_Q_FIND_GROUP_AND_MEMBER_NAMES, LsaSrvIpcFindGroupAndMemberNames),
     LWMSG_DISPATCH_END
 };
 
@@ -0,0 +1,596 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software    2004-2008
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ *
+ * Module Name:
+ *
+ *        lookupcache.c
+ *
+ * Abstract:
+ *
+ *        Likewise Security and Authentication Subsystem (LSASS)
+ *
+ *        Negative lookup and provider routing cache (Server)
+ *
+ *        Lookups for names and SIDs that do not exist walk every provider,
+ *        touching the local database and then the directory each time.
+ *        Keys that came back empty are remembered here for a short while
+ *        (NegativeCacheTimeout) so repeated misses are answered at once.
+ *
+ *        The providers that resolved domain-qualified names and domain
+ *        SIDs are also remembered per domain, so later NT4 name and SID
+ *        lookups in that domain go straight to the owning provider.
+ *
+ *        Both tables are dropped whenever the cache generation is bumped
+ *        (object add/modify/delete, provider ioctls such as joins, and
+ *        configuration refresh).
+ *
+ */
+#include "api.h"
+
+#define LSA_SRV_MISSING_MAX_ENTRIES 4096
+#define LSA_SRV_MISSING_TABLE_SIZE 1021
+#define LSA_SRV_ROUTE_MAX_ENTRIES 1024
+#define LSA_SRV_ROUTE_TABLE_SIZE 127
+
+/* Only domain SIDs name a single owning domain */
+#define LSA_SRV_DOMAIN_SID_PREFIX "S-1-5-21-"
+
+static pthread_mutex_t gLookupCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static PLW_HASH_TABLE gpMissingCache = NULL;
+static PLW_HASH_TABLE gpRouteCache = NULL;
+static DWORD gdwLookupCacheGeneration = 0;
+
+static
+VOID
+LsaSrvFreeLookupCacheEntry(
+    IN const LW_HASH_ENTRY* pEntry
+    )
+{
+    PLSA_SRV_LOOKUP_CACHE_ENTRY pCacheEntry = pEntry->pValue;
+
+    if (pCacheEntry)
+    {
+        LW_SAFE_FREE_STRING(pCacheEntry->pszKey);
+        LW_SAFE_FREE_STRING(pCacheEntry->pszProvider);
+        LwFreeMemory(pCacheEntry);
+    }
+}
+
+static
+DWORD
+LsaSrvBuildMissingKey(
+    IN OPTIONAL PCSTR pszTargetProvider,
+    IN LSA_FIND_FLAGS FindFlags,
+    IN LSA_OBJECT_TYPE ObjectType,
+    IN LSA_QUERY_TYPE QueryType,
+    IN LSA_QUERY_ITEM QueryItem,
+    OUT PSTR* ppszKey
+    )
+{
+    if (QueryType == LSA_QUERY_TYPE_BY_UNIX_ID)
+    {
+        return LwAllocateStringPrintf(
+                    ppszKey,
+                    "%s|%u|%u|%u|%u",
+                    pszTargetProvider ? pszTargetProvider : "",
+                    FindFlags,
+                    ObjectType,
+                    QueryType,
+                    QueryItem.dwId);
+    }
+    else
+    {
+        return LwAllocateStringPrintf(
+                    ppszKey,
+                    "%s|%u|%u|%u|%s",
+                    pszTargetProvider ? pszTargetProvider : "",
+                    FindFlags,
+                    ObjectType,
+                    QueryType,
+                    QueryItem.pszString);
+    }
+}
+
+/*
+ * Route key for the domain of an NT4 name ("nt4:DOMAIN") or of a domain
+ * SID ("sid:S-1-5-21-x-y-z").  Returns ERROR_NOT_FOUND for anything that
+ * does not name a domain.
+ */
+static
+DWORD
+LsaSrvBuildRouteKey(
+    IN LSA_QUERY_TYPE QueryType,
+    IN PCSTR pszString,
+    OUT PSTR* ppszKey
+    )
+{
+    DWORD dwError = 0;
+    PCSTR pszEnd = NULL;
+
+    *ppszKey = NULL;
+
+    if (!pszString)
+    {
+        return ERROR_NOT_FOUND;
+    }
+
+    switch (QueryType)
+    {
+    case LSA_QUERY_TYPE_BY_NT4:
+        pszEnd = strchr(pszString, LsaSrvDomainSeparator());
+        if (!pszEnd || pszEnd == pszString)
+        {
+            dwError = ERROR_NOT_FOUND;
+            break;
+        }
+
+        dwError = LwAllocateStringPrintf(
+                        ppszKey,
+                        "nt4:%.*s",
+                        (int) (pszEnd - pszString),
+                        pszString);
+        break;
+
+    case LSA_QUERY_TYPE_BY_SID:
+        pszEnd = strrchr(pszString, '-');
+        if (strncasecmp(pszString,
+                        LSA_SRV_DOMAIN_SID_PREFIX,
+                        sizeof(LSA_SRV_DOMAIN_SID_PREFIX) - 1) ||
+            pszEnd < pszString + sizeof(LSA_SRV_DOMAIN_SID_PREFIX) - 1)
+        {
+            dwError = ERROR_NOT_FOUND;
+            break;
+        }
+
+        dwError = LwAllocateStringPrintf(
+                        ppszKey,
+                        "sid:%.*s",
+                        (int) (pszEnd - pszString),
+                        pszString);
+        break;
+
+    default:
+        dwError = ERROR_NOT_FOUND;
+        break;
+    }
+
+    return dwError;
+}
+
+static
+BOOLEAN
+LsaSrvLookupCacheEntryExpired(
+    IN const LW_HASH_ENTRY* pEntry,
+    IN PVOID pNow
+    )
+{
+    PLSA_SRV_LOOKUP_CACHE_ENTRY pCacheEntry = pEntry->pValue;
+
+    return pCacheEntry->tExpire <= *(time_t*) pNow;
+}
+
+DWORD
+LsaSrvGetLookupCacheGeneration(
+    VOID
+    )
+{
+    DWORD dwGeneration = 0;
+
+    pthread_mutex_lock(&gLookupCacheLock);
+
+    dwGeneration = gdwLookupCacheGeneration;
+
+    pthread_mutex_unlock(&gLookupCacheLock);
+
+    return dwGeneration;
+}
+
+BOOLEAN
+LsaSrvLookupCacheIsMissing(
+    IN OPTIONAL PCSTR pszTargetProvider,
+    IN LSA_FIND_FLAGS FindFlags,
+    IN LSA_OBJECT_TYPE ObjectType,
+    IN LSA_QUERY_TYPE QueryType,
+    IN LSA_QUERY_ITEM QueryItem
+    )
+{
+    DWORD dwError = 0;
+    BOOLEAN bMissing = FALSE;
+    PSTR pszKey = NULL;
+    PLSA_SRV_LOOKUP_CACHE_ENTRY pCacheEntry = NULL;
+
+    if (!gpMissingCache)
+    {
+        /* Nothing was ever cached; avoid building the key */
+        goto cleanup;
+    }
+
+    dwError = LsaSrvBuildMissingKey(
+                    pszTargetProvider,
+                    FindFlags,
+                    ObjectType,
+                    QueryType,
+                    QueryItem,
+                    &pszKey);
+    if (dwError)
+    {
+        goto cleanup;
+    }
+
+    pthread_mutex_lock(&gLookupCacheLock);
+
+    if (gpMissingCache &&
+        LwHashGetValue(
+            gpMissingCache,
+            pszKey,
+            OUT_PPVOID(&pCacheEntry)) == 0)
+    {
+        if (pCacheEntry->tExpire > time(NULL))
+        {
+            bMissing = TRUE;
+        }
+        else
+        {
+            LwHashRemoveKey(gpMissingCache, pszKey);
+        }
+    }
+
+    pthread_mutex_unlock(&gLookupCacheLock);
+
+cleanup:
+
+    LW_SAFE_FREE_STRING(pszKey);
+
+    return bMissing;
+}
+
+VOID
+LsaSrvLookupCacheAddMissing(
+    IN OPTIONAL PCSTR pszTargetProvider,
+    IN LSA_FIND_FLAGS FindFlags,
+    IN LSA_OBJECT_TYPE ObjectType,
+    IN LSA_QUERY_TYPE QueryType,
+    IN LSA_QUERY_ITEM QueryItem,
+    IN DWORD dwGeneration
+    )
+{
+    DWORD dwError = 0;
+    DWORD dwTimeout = LsaSrvNegativeCacheTimeout();
+    PLSA_SRV_LOOKUP_CACHE_ENTRY pCacheEntry = NULL;
+    BOOLEAN bInLock = FALSE;
+    time_t now = 0;
+
+    if (!dwTimeout)
+    {
+        goto cleanup;
+    }
+
+    dwError = LwAllocateMemory(sizeof(*pCacheEntry), OUT_PPVOID(&pCacheEntry));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LsaSrvBuildMissingKey(
+                    pszTargetProvider,
+                    FindFlags,
+                    ObjectType,
+                    QueryType,
+                    QueryItem,
+                    &pCacheEntry->pszKey);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pthread_mutex_lock(&gLookupCacheLock);
+    bInLock = TRUE;
+
+    /*
+     * Something that could create the object happened while the
+     * providers were being asked, so the miss may already be stale.
+     */
+    if (dwGeneration != gdwLookupCacheGeneration)
+    {
+        goto cleanup;
+    }
+
+    if (!gpMissingCache)
+    {
+        dwError = LwHashCreate(
+                        LSA_SRV_MISSING_TABLE_SIZE,
+                        LwHashCaselessStringCompare,
+                        LwHashCaselessStringHash,
+                        LsaSrvFreeLookupCacheEntry,
+                        NULL,
+                        &gpMissingCache);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    now = time(NULL);
+
+    if (LwHashGetKeyCount(gpMissingCache) >= LSA_SRV_MISSING_MAX_ENTRIES)
+    {
+        LwHashPrune(
+            gpMissingCache,
+            LsaSrvLookupCacheEntryExpired,
+            &now,
+            LSA_SRV_MISSING_MAX_ENTRIES);
+    }
+
+    pCacheEntry->tExpire = now + dwTimeout;
+
+    dwError = LwHashSetValue(gpMissingCache, pCacheEntry->pszKey, pCacheEntry);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pCacheEntry = NULL;
+
+cleanup:
+
+    if (bInLock)
+    {
+        pthread_mutex_unlock(&gLookupCacheLock);
+    }
+
+    if (pCacheEntry)
+    {
+        LW_SAFE_FREE_STRING(pCacheEntry->pszKey);
+        LwFreeMemory(pCacheEntry);
+    }
+
+    return;
+
+error:
+
+    LSA_LOG_DEBUG("Failed to cache lookup miss (error = %u)", dwError);
+
+    goto cleanup;
+}
+
+/*
+ * The caller must hold the provider list lock; the returned provider is
+ * only valid while it does.
+ */
+PLSA_AUTH_PROVIDER
+LsaSrvLookupCacheGetRoute(
+    IN LSA_QUERY_TYPE QueryType,
+    IN LSA_QUERY_ITEM QueryItem
+    )
+{
+    PLSA_AUTH_PROVIDER pProvider = NULL;
+    PLSA_SRV_LOOKUP_CACHE_ENTRY pCacheEntry = NULL;
+    PSTR pszKey = NULL;
+
+    if (!gpRouteCache ||
+        LsaSrvBuildRouteKey(QueryType, QueryItem.pszString, &pszKey))
+    {
+        goto cleanup;
+    }
+
+    pthread_mutex_lock(&gLookupCacheLock);
+
+    if (gpRouteCache &&
+        LwHashGetValue(
+            gpRouteCache,
+            pszKey,
+            OUT_PPVOID(&pCacheEntry)) == 0 &&
+        pCacheEntry->pszProvider)
+    {
+        for (pProvider = gpAuthProviderList;
+             pProvider;
+             pProvider = pProvider->pNext)
+        {
+            if (!strcmp(pProvider->pszName, pCacheEntry->pszProvider))
+            {
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&gLookupCacheLock);
+
+cleanup:
+
+    LW_SAFE_FREE_STRING(pszKey);
+
+    return pProvider;
+}
+
+static
+DWORD
+LsaSrvAddRouteInLock(
+    IN PLSA_AUTH_PROVIDER pProvider,
+    IN PSTR pszKey
+    )
+{
+    DWORD dwError = 0;
+    PLSA_SRV_LOOKUP_CACHE_ENTRY pCacheEntry = NULL;
+
+    if (LwHashGetValue(gpRouteCache, pszKey, OUT_PPVOID(&pCacheEntry)) == 0)
+    {
+        if (pCacheEntry->pszProvider &&
+            strcmp(pCacheEntry->pszProvider, pProvider->pszName))
+        {
+            /* Two providers answer for this domain; stop routing it */
+            LW_SAFE_FREE_STRING(pCacheEntry->pszProvider);
+        }
+
+        LW_SAFE_FREE_STRING(pszKey);
+        goto cleanup;
+    }
+
+    if (LwHashGetKeyCount(gpRouteCache) >= LSA_SRV_ROUTE_MAX_ENTRIES)
+    {
+        LwHashRemoveAll(gpRouteCache);
+    }
+
+    dwError = LwAllocateMemory(sizeof(*pCacheEntry), OUT_PPVOID(&pCacheEntry));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pCacheEntry->pszKey = pszKey;
+    pszKey = NULL;
+
+    dwError = LwAllocateString(pProvider->pszName, &pCacheEntry->pszProvider);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LwHashSetValue(gpRouteCache, pCacheEntry->pszKey, pCacheEntry);
+    BAIL_ON_LSA_ERROR(dwError);
+
+cleanup:
+
+    return dwError;
+
+error:
+
+    LW_SAFE_FREE_STRING(pszKey);
+
+    if (pCacheEntry)
+    {
+        LW_SAFE_FREE_STRING(pCacheEntry->pszKey);
+        LW_SAFE_FREE_STRING(pCacheEntry->pszProvider);
+        LwFreeMemory(pCacheEntry);
+    }
+
+    goto cleanup;
+}
+
+/*
+ * Remember pProvider as the owner of the domains named by a query key it
+ * resolved and by the object it returned for it.
+ */
+VOID
+LsaSrvLookupCacheAddRoutes(
+    IN PLSA_AUTH_PROVIDER pProvider,
+    IN LSA_QUERY_TYPE QueryType,
+    IN LSA_QUERY_ITEM QueryItem,
+    IN PLSA_SECURITY_OBJECT pObject,
+    IN DWORD dwGeneration
+    )
+{
+    DWORD dwError = 0;
+    PSTR ppszKeys[3] = { NULL, NULL, NULL };
+    DWORD dwIndex = 0;
+
+    if (QueryType == LSA_QUERY_TYPE_BY_NT4 || QueryType == LSA_QUERY_TYPE_BY_SID)
+    {
+        LsaSrvBuildRouteKey(QueryType, QueryItem.pszString, &ppszKeys[0]);
+    }
+
+    if (pObject->pszNetbiosDomainName)
+    {
+        LwAllocateStringPrintf(
+            &ppszKeys[1],
+            "nt4:%s",
+            pObject->pszNetbiosDomainName);
+    }
+
+    LsaSrvBuildRouteKey(
+        LSA_QUERY_TYPE_BY_SID,
+        pObject->pszObjectSid,
+        &ppszKeys[2]);
+
+    pthread_mutex_lock(&gLookupCacheLock);
+
+    if (dwGeneration != gdwLookupCacheGeneration)
+    {
+        goto cleanup;
+    }
+
+    if (!gpRouteCache)
+    {
+        dwError = LwHashCreate(
+                        LSA_SRV_ROUTE_TABLE_SIZE,
+                        LwHashCaselessStringCompare,
+                        LwHashCaselessStringHash,
+                        LsaSrvFreeLookupCacheEntry,
+                        NULL,
+                        &gpRouteCache);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    for (dwIndex = 0; dwIndex < sizeof(ppszKeys)/sizeof(ppszKeys[0]); dwIndex++)
+    {
+        if (ppszKeys[dwIndex])
+        {
+            /* The key is consumed either way */
+            dwError = LsaSrvAddRouteInLock(pProvider, ppszKeys[dwIndex]);
+            ppszKeys[dwIndex] = NULL;
+            BAIL_ON_LSA_ERROR(dwError);
+        }
+    }
+
+cleanup:
+
+    pthread_mutex_unlock(&gLookupCacheLock);
+
+    for (dwIndex = 0; dwIndex < sizeof(ppszKeys)/sizeof(ppszKeys[0]); dwIndex++)
+    {
+        LW_SAFE_FREE_STRING(ppszKeys[dwIndex]);
+    }
+
+    return;
+
+error:
+
+    LSA_LOG_DEBUG("Failed to cache provider route (error = %u)", dwError);
+
+    goto cleanup;
+}
+
+VOID
+LsaSrvInvalidateLookupCache(
+    VOID
+    )
+{
+    pthread_mutex_lock(&gLookupCacheLock);
+
+    gdwLookupCacheGeneration++;
+
+    if (gpMissingCache)
+    {
+        LwHashRemoveAll(gpMissingCache);
+    }
+
+    if (gpRouteCache)
+    {
+        LwHashRemoveAll(gpRouteCache);
+    }
+
+    pthread_mutex_unlock(&gLookupCacheLock);
+}
+
+VOID
+LsaSrvFreeLookupCache(
+    VOID
+    )
+{
+    pthread_mutex_lock(&gLookupCacheLock);
+
+    LwHashSafeFree(&gpMissingCache);
+    LwHashSafeFree(&gpRouteCache);
+
+    pthread_mutex_unlock(&gLookupCacheLock);
+}
@@ -0,0 +1,99 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software    2004-2008
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ *
+ * Module Name:
+ *
+ *        lookupcache_p.h
+ *
+ * Abstract:
+ *
+ *        Likewise Security and Authentication Subsystem (LSASS)
+ *
+ *        Negative lookup and provider routing cache (Server)
+ *
+ */
+#ifndef __LOOKUPCACHE_P_H__
+#define __LOOKUPCACHE_P_H__
+
+/* Default for the NegativeCacheTimeout setting (0 disables the cache) */
+#define LSA_SRV_DEFAULT_NEGATIVE_CACHE_TIMEOUT_SECS 30
+
+DWORD
+LsaSrvGetLookupCacheGeneration(
+    VOID
+    );
+
+BOOLEAN
+LsaSrvLookupCacheIsMissing(
+    IN OPTIONAL PCSTR pszTargetProvider,
+    IN LSA_FIND_FLAGS FindFlags,
+    IN LSA_OBJECT_TYPE ObjectType,
+    IN LSA_QUERY_TYPE QueryType,
+    IN LSA_QUERY_ITEM QueryItem
+    );
+
+VOID
+LsaSrvLookupCacheAddMissing(
+    IN OPTIONAL PCSTR pszTargetProvider,
+    IN LSA_FIND_FLAGS FindFlags,
+    IN LSA_OBJECT_TYPE ObjectType,
+    IN LSA_QUERY_TYPE QueryType,
+    IN LSA_QUERY_ITEM QueryItem,
+    IN DWORD dwGeneration
+    );
+
+PLSA_AUTH_PROVIDER
+LsaSrvLookupCacheGetRoute(
+    IN LSA_QUERY_TYPE QueryType,
+    IN LSA_QUERY_ITEM QueryItem
+    );
+
+VOID
+LsaSrvLookupCacheAddRoutes(
+    IN PLSA_AUTH_PROVIDER pProvider,
+    IN LSA_QUERY_TYPE QueryType,
+    IN LSA_QUERY_ITEM QueryItem,
+    IN PLSA_SECURITY_OBJECT pObject,
+    IN DWORD dwGeneration
+    );
+
+VOID
+LsaSrvInvalidateLookupCache(
+    VOID
+    );
+
+VOID
+LsaSrvFreeLookupCache(
+    VOID
+    );
+
+#endif /* __LOOKUPCACHE_P_H__ */
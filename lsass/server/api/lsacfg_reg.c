@@ -42,6 +42,38 @@
  */
 #include "api.h"
 
+/*
+ * Values under these keys are served from an in-process cache that lwreg
+ * invalidates on change, so refreshes do not cost a round trip per value.
+ */
+static PCSTR gLsaConfigCacheKeys[] =
+{
+    "Services\\lsass",
+    "Policy\\Services\\lsass"
+};
+
+static pthread_mutex_t gLsaConfigCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static HANDLE ghLsaConfigCacheConnection = NULL;
+static PLWREG_CONFIG_CACHE gpLsaConfigCache = NULL;
+
+static
+PLWREG_CONFIG_CACHE
+LsaGetConfigCache(
+    VOID
+    );
+
+static
+DWORD
+LsaGetConfigValue(
+    PLSA_CONFIG_REG pReg,
+    PCSTR pszKey,
+    PCSTR pszName,
+    REG_DATA_TYPE_FLAGS Flags,
+    PDWORD pdwType,
+    PVOID pvData,
+    PDWORD pcbData
+    );
+
 DWORD
 LsaProcessConfig(
     PCSTR pszConfigKey,
@@ -58,7 +90,7 @@ LsaProcessConfig(
     dwError = LsaOpenConfig(pszConfigKey, pszPolicyKey, &pReg);
     BAIL_ON_LSA_ERROR(dwError);
 
-    if ( pReg == NULL || pReg->hConnection == NULL )
+    if ( pReg == NULL || (pReg->hConnection == NULL && pReg->pCache == NULL) )
     {
         goto error;
     }
@@ -150,6 +182,13 @@ LsaOpenConfig(
     dwError = LwAllocateString(pszPolicyKey, &(pReg->pszPolicyKey));
     BAIL_ON_LSA_ERROR(dwError);
 
+    // The cache carries its own connection, so only open one without it
+    pReg->pCache = LsaGetConfigCache();
+    if (pReg->pCache)
+    {
+        goto cleanup;
+    }
+
     dwError = RegOpenServer(&(pReg->hConnection));
     if ( dwError || (pReg->hConnection == NULL))
     {
@@ -230,9 +269,8 @@ LsaReadConfigString(
     {
         dwSize = sizeof(szValue);
         memset(szValue, 0, dwSize);
-        dwError = RegGetValueA(
-                    pReg->hConnection,
-                    pReg->hKey,
+        dwError = LsaGetConfigValue(
+                    pReg,
                     pReg->pszPolicyKey,
                     pszName,
                     RRF_RT_REG_SZ,
@@ -247,9 +285,8 @@ LsaReadConfigString(
     {
         dwSize = sizeof(szValue);
         memset(szValue, 0, dwSize);
-        dwError = RegGetValueA(
-                    pReg->hConnection,
-                    pReg->hKey,
+        dwError = LsaGetConfigValue(
+                    pReg,
                     pReg->pszConfigKey,
                     pszName,
                     RRF_RT_REG_SZ,
@@ -308,9 +345,8 @@ LsaReadConfigMultiString(
     {
         dwSize = sizeof(szValue);
         memset(szValue, 0, dwSize);
-        dwError = RegGetValueA(
-                    pReg->hConnection,
-                    pReg->hKey,
+        dwError = LsaGetConfigValue(
+                    pReg,
                     pReg->pszPolicyKey,
                     pszName,
                     RRF_RT_REG_MULTI_SZ,
@@ -325,9 +361,8 @@ LsaReadConfigMultiString(
     {
         dwSize = sizeof(szValue);
         memset(szValue, 0, dwSize);
-        dwError = RegGetValueA(
-                    pReg->hConnection,
-                    pReg->hKey,
+        dwError = LsaGetConfigValue(
+                    pReg,
                     pReg->pszConfigKey,
                     pszName,
                     RRF_RT_REG_MULTI_SZ,
@@ -387,9 +422,8 @@ LsaReadConfigDword(
     if (bUsePolicy)
     {
         dwSize = sizeof(dwValue);
-        dwError = RegGetValueA(
-                    pReg->hConnection,
-                    pReg->hKey,
+        dwError = LsaGetConfigValue(
+                    pReg,
                     pReg->pszPolicyKey,
                     pszName,
                     RRF_RT_REG_DWORD,
@@ -405,9 +439,8 @@ LsaReadConfigDword(
     if (!bGotValue)
     {
         dwSize = sizeof(dwValue);
-        dwError = RegGetValueA(
-                    pReg->hConnection,
-                    pReg->hKey,
+        dwError = LsaGetConfigValue(
+                    pReg,
                     pReg->pszConfigKey,
                     pszName,
                     RRF_RT_REG_DWORD,
@@ -509,3 +542,75 @@ error:
     goto cleanup;
 }
 
+static
+PLWREG_CONFIG_CACHE
+LsaGetConfigCache(
+    VOID
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+
+    pthread_mutex_lock(&gLsaConfigCacheLock);
+
+    if (!gpLsaConfigCache)
+    {
+        if (!ghLsaConfigCacheConnection)
+        {
+            status = NtRegOpenServer(&ghLsaConfigCacheConnection);
+        }
+
+        if (!status)
+        {
+            // Kept for the life of the process
+            status = NtRegOpenConfigCache(
+                            ghLsaConfigCacheConnection,
+                            sizeof(gLsaConfigCacheKeys) /
+                            sizeof(gLsaConfigCacheKeys[0]),
+                            gLsaConfigCacheKeys,
+                            &gpLsaConfigCache);
+        }
+
+        // On failure configuration is simply read without a cache
+    }
+
+    pthread_mutex_unlock(&gLsaConfigCacheLock);
+
+    return gpLsaConfigCache;
+}
+
+static
+DWORD
+LsaGetConfigValue(
+    PLSA_CONFIG_REG pReg,
+    PCSTR pszKey,
+    PCSTR pszName,
+    REG_DATA_TYPE_FLAGS Flags,
+    PDWORD pdwType,
+    PVOID pvData,
+    PDWORD pcbData
+    )
+{
+    if (pReg->pCache)
+    {
+        return LwNtStatusToWin32Error(
+                   NtRegConfigCacheGetValueA(
+                        pReg->pCache,
+                        pszKey,
+                        pszName,
+                        Flags,
+                        pdwType,
+                        pvData,
+                        pcbData));
+    }
+
+    return RegGetValueA(
+                pReg->hConnection,
+                pReg->hKey,
+                pszKey,
+                pszName,
+                Flags,
+                pdwType,
+                pvData,
+                pcbData);
+}
+
@@ -0,0 +1,332 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software    2004-2008
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        membercache.c
+ *
+ * Abstract:
+ *
+ *        Likewise Security and Authentication Subsystem (LSASS)
+ *
+ *        Expanded group member name cache (Server)
+ *
+ *        NSS group lookups need only the unix names of the expanded user
+ *        members of a group.  Expanding a large group means walking the
+ *        providers for every nested member, so the resulting name list is
+ *        kept here, keyed by group SID, and shared by reference until it
+ *        expires or something that could change membership bumps the
+ *        cache generation.
+ *
+ */
+#include "api.h"
+
+/* How long a member name list may be served without re-expanding */
+#define LSA_SRV_MEMBER_NAMES_TTL_SECS 60
+#define LSA_SRV_MEMBER_NAMES_MAX_ENTRIES 256
+#define LSA_SRV_MEMBER_NAMES_TABLE_SIZE 61
+
+static pthread_mutex_t gMemberNameCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static PLW_HASH_TABLE gpMemberNameCache = NULL;
+static DWORD gdwMemberNameGeneration = 0;
+
+static
+VOID
+LsaSrvFreeMemberNameCacheEntry(
+    IN const LW_HASH_ENTRY* pEntry
+    )
+{
+    LsaSrvReleaseMemberNames((PLSA_SRV_MEMBER_NAMES) pEntry->pValue);
+}
+
+// Must hold gMemberNameCacheLock
+static
+BOOLEAN
+LsaSrvMemberNamesExpired(
+    IN const LW_HASH_ENTRY* pEntry,
+    IN PVOID pNow
+    )
+{
+    PLSA_SRV_MEMBER_NAMES pNames = pEntry->pValue;
+
+    return pNames->tExpire <= *(time_t*) pNow ||
+           pNames->dwGeneration != gdwMemberNameGeneration;
+}
+
+DWORD
+LsaSrvLookupMemberNames(
+    IN PCSTR pszGroupSid,
+    IN LSA_FIND_FLAGS FindFlags,
+    OUT PDWORD pdwGeneration,
+    OUT PLSA_SRV_MEMBER_NAMES* ppNames
+    )
+{
+    DWORD dwError = 0;
+    PLSA_SRV_MEMBER_NAMES pNames = NULL;
+
+    pthread_mutex_lock(&gMemberNameCacheLock);
+
+    *pdwGeneration = gdwMemberNameGeneration;
+
+    if (!gpMemberNameCache)
+    {
+        dwError = ERROR_NOT_FOUND;
+        goto cleanup;
+    }
+
+    dwError = LwHashGetValue(
+                    gpMemberNameCache,
+                    pszGroupSid,
+                    OUT_PPVOID(&pNames));
+    if (dwError)
+    {
+        goto cleanup;
+    }
+
+    if (pNames->FindFlags != FindFlags ||
+        pNames->dwGeneration != gdwMemberNameGeneration ||
+        pNames->tExpire <= time(NULL))
+    {
+        pNames = NULL;
+        dwError = ERROR_NOT_FOUND;
+        goto cleanup;
+    }
+
+    InterlockedIncrement(&pNames->nRefCount);
+
+cleanup:
+
+    pthread_mutex_unlock(&gMemberNameCacheLock);
+
+    LsaSrvRecordCacheLookup(LSA_METRIC_CACHE_MEMBER_NAMES, pNames != NULL);
+
+    *ppNames = pNames;
+
+    return dwError;
+}
+
+DWORD
+LsaSrvCreateMemberNames(
+    IN PCSTR pszGroupSid,
+    IN LSA_FIND_FLAGS FindFlags,
+    IN DWORD dwGeneration,
+    IN DWORD dwMemberCount,
+    IN PLSA_SECURITY_OBJECT* ppMembers,
+    OUT PLSA_SRV_MEMBER_NAMES* ppNames
+    )
+{
+    DWORD dwError = 0;
+    PLSA_SRV_MEMBER_NAMES pNames = NULL;
+    DWORD dwIndex = 0;
+    DWORD dwEnabled = 0;
+    size_t sLength = 0;
+    size_t sNameLength = 0;
+    PBYTE pCursor = NULL;
+
+    for (dwIndex = 0; dwIndex < dwMemberCount; dwIndex++)
+    {
+        if (ppMembers[dwIndex])
+        {
+            if (ppMembers[dwIndex]->type != LSA_OBJECT_TYPE_USER)
+            {
+                dwError = LW_ERROR_INVALID_PARAMETER;
+                BAIL_ON_LSA_ERROR(dwError);
+            }
+
+            if (ppMembers[dwIndex]->enabled)
+            {
+                sLength += strlen(ppMembers[dwIndex]->userInfo.pszUnixName) + 1;
+                dwEnabled++;
+            }
+        }
+    }
+
+    if (sLength > (DWORD) -1)
+    {
+        dwError = LW_ERROR_OUT_OF_MEMORY;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    /* The names live in the same allocation as the header */
+    dwError = LwAllocateMemory(
+                    sizeof(*pNames) + sLength,
+                    OUT_PPVOID(&pNames));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pNames->nRefCount = 1;
+    pNames->FindFlags = FindFlags;
+    pNames->dwGeneration = dwGeneration;
+    pNames->tExpire = time(NULL) + LSA_SRV_MEMBER_NAMES_TTL_SECS;
+    pNames->dwMemberCount = dwEnabled;
+    pNames->dwMemberNamesLength = (DWORD) sLength;
+    pNames->pMemberNames = sLength ? (PBYTE) (pNames + 1) : NULL;
+
+    dwError = LwAllocateString(pszGroupSid, &pNames->pszGroupSid);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pCursor = pNames->pMemberNames;
+
+    for (dwIndex = 0; dwIndex < dwMemberCount; dwIndex++)
+    {
+        if (ppMembers[dwIndex] && ppMembers[dwIndex]->enabled)
+        {
+            sNameLength = strlen(ppMembers[dwIndex]->userInfo.pszUnixName) + 1;
+            memcpy(pCursor, ppMembers[dwIndex]->userInfo.pszUnixName, sNameLength);
+            pCursor += sNameLength;
+        }
+    }
+
+    *ppNames = pNames;
+
+cleanup:
+
+    return dwError;
+
+error:
+
+    *ppNames = NULL;
+
+    if (pNames)
+    {
+        LsaSrvReleaseMemberNames(pNames);
+    }
+
+    goto cleanup;
+}
+
+VOID
+LsaSrvCacheMemberNames(
+    IN PLSA_SRV_MEMBER_NAMES pNames
+    )
+{
+    DWORD dwError = 0;
+    time_t now = 0;
+
+    pthread_mutex_lock(&gMemberNameCacheLock);
+
+    /*
+     * Something that could change membership happened while this list
+     * was being built, so it must not be served to anyone else.
+     */
+    if (pNames->dwGeneration != gdwMemberNameGeneration)
+    {
+        goto cleanup;
+    }
+
+    if (!gpMemberNameCache)
+    {
+        dwError = LwHashCreate(
+                        LSA_SRV_MEMBER_NAMES_TABLE_SIZE,
+                        LwHashCaselessStringCompare,
+                        LwHashCaselessStringHash,
+                        LsaSrvFreeMemberNameCacheEntry,
+                        NULL,
+                        &gpMemberNameCache);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    if (LwHashGetKeyCount(gpMemberNameCache) >=
+            LSA_SRV_MEMBER_NAMES_MAX_ENTRIES)
+    {
+        now = time(NULL);
+        LwHashPrune(
+            gpMemberNameCache,
+            LsaSrvMemberNamesExpired,
+            &now,
+            LSA_SRV_MEMBER_NAMES_MAX_ENTRIES);
+    }
+
+    InterlockedIncrement(&pNames->nRefCount);
+
+    dwError = LwHashSetValue(gpMemberNameCache, pNames->pszGroupSid, pNames);
+    if (dwError)
+    {
+        InterlockedDecrement(&pNames->nRefCount);
+    }
+    BAIL_ON_LSA_ERROR(dwError);
+
+cleanup:
+
+    pthread_mutex_unlock(&gMemberNameCacheLock);
+
+    return;
+
+error:
+
+    LSA_LOG_DEBUG("Failed to cache members of group %s (error = %u)",
+                  LSA_SAFE_LOG_STRING(pNames->pszGroupSid),
+                  dwError);
+
+    goto cleanup;
+}
+
+VOID
+LsaSrvReleaseMemberNames(
+    IN PLSA_SRV_MEMBER_NAMES pNames
+    )
+{
+    if (pNames && InterlockedDecrement(&pNames->nRefCount) == 0)
+    {
+        LW_SAFE_FREE_STRING(pNames->pszGroupSid);
+        LwFreeMemory(pNames);
+    }
+}
+
+VOID
+LsaSrvInvalidateMemberNameCache(
+    VOID
+    )
+{
+    pthread_mutex_lock(&gMemberNameCacheLock);
+
+    gdwMemberNameGeneration++;
+
+    if (gpMemberNameCache)
+    {
+        LwHashRemoveAll(gpMemberNameCache);
+    }
+
+    pthread_mutex_unlock(&gMemberNameCacheLock);
+}
+
+VOID
+LsaSrvFreeMemberNameCache(
+    VOID
+    )
+{
+    pthread_mutex_lock(&gMemberNameCacheLock);
+
+    LwHashSafeFree(&gpMemberNameCache);
+
+    pthread_mutex_unlock(&gMemberNameCacheLock);
+}
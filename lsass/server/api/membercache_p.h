@@ -0,0 +1,97 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software    2004-2008
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        membercache_p.h
+ *
+ * Abstract:
+ *
+ *        Likewise Security and Authentication Subsystem (LSASS)
+ *
+ *        Expanded group member name cache (Server)
+ *
+ */
+#ifndef __MEMBERCACHE_P_H__
+#define __MEMBERCACHE_P_H__
+
+DWORD
+LsaSrvFindGroupAndMemberNames(
+    IN HANDLE hServer,
+    IN OPTIONAL PCSTR pszTargetProvider,
+    IN LSA_FIND_FLAGS FindFlags,
+    IN LSA_QUERY_TYPE QueryType,
+    IN LSA_QUERY_ITEM QueryItem,
+    OUT PLSA_SECURITY_OBJECT* ppGroupObject,
+    OUT PLSA_SRV_MEMBER_NAMES* ppMemberNames
+    );
+
+DWORD
+LsaSrvLookupMemberNames(
+    IN PCSTR pszGroupSid,
+    IN LSA_FIND_FLAGS FindFlags,
+    OUT PDWORD pdwGeneration,
+    OUT PLSA_SRV_MEMBER_NAMES* ppNames
+    );
+
+DWORD
+LsaSrvCreateMemberNames(
+    IN PCSTR pszGroupSid,
+    IN LSA_FIND_FLAGS FindFlags,
+    IN DWORD dwGeneration,
+    IN DWORD dwMemberCount,
+    IN PLSA_SECURITY_OBJECT* ppMembers,
+    OUT PLSA_SRV_MEMBER_NAMES* ppNames
+    );
+
+VOID
+LsaSrvCacheMemberNames(
+    IN PLSA_SRV_MEMBER_NAMES pNames
+    );
+
+VOID
+LsaSrvReleaseMemberNames(
+    IN PLSA_SRV_MEMBER_NAMES pNames
+    );
+
+VOID
+LsaSrvInvalidateMemberNameCache(
+    VOID
+    );
+
+VOID
+LsaSrvFreeMemberNameCache(
+    VOID
+    );
+
+#endif /* __MEMBERCACHE_P_H__ */
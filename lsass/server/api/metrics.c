@@ -41,12 +41,215 @@
  *
  *        Metrics (Server)
  *
+ *        Counters and latency histograms are kept in per-thread stripes
+ *        so the lookup and authentication paths never serialize on a
+ *        shared lock; a query adds the stripes together.
+ *
  * Authors: Krishna Ganugapati (krishnag@likewisesoftware.com)
  *          Sriram Nambakam (snambakam@likewisesoftware.com)
  */
 
 #include "api.h"
 
+#define LSA_SRV_METRIC_STRIPES 32
+
+static LSA_SRV_METRIC_STRIPE gMetricStripes[LSA_SRV_METRIC_STRIPES];
+static pthread_key_t gMetricStripeKey;
+static pthread_once_t gMetricInitOnce = PTHREAD_ONCE_INIT;
+static DWORD gdwMetricInitError = 0;
+static LONG gnMetricNextStripe = 0;
+
+static LONG gnMetricInFlight = 0;
+static LONG gnMetricInFlightPeak = 0;
+
+static pthread_mutex_t gDcMetricsLock = PTHREAD_MUTEX_INITIALIZER;
+static LSA_METRIC_DC_TARGET gDcMetrics[LSA_METRIC_MAX_DC_TARGETS];
+static DWORD gdwDcMetricsCount = 0;
+
+static
+VOID
+LsaSrvInitMetricsOnce(
+    VOID
+    )
+{
+    DWORD dwIndex = 0;
+
+    for (dwIndex = 0; dwIndex < LSA_SRV_METRIC_STRIPES; dwIndex++)
+    {
+        pthread_mutex_init(&gMetricStripes[dwIndex].mutex, NULL);
+    }
+
+    gdwMetricInitError = LwMapErrnoToLwError(
+                             pthread_key_create(&gMetricStripeKey, NULL));
+}
+
+DWORD
+LsaSrvInitMetrics(
+    VOID
+    )
+{
+    pthread_once(&gMetricInitOnce, LsaSrvInitMetricsOnce);
+
+    return gdwMetricInitError;
+}
+
+static
+PLSA_SRV_METRIC_STRIPE
+LsaSrvLockMetricStripe(
+    VOID
+    )
+{
+    PLSA_SRV_METRIC_STRIPE pStripe = NULL;
+    size_t sIndex = 0;
+
+    /* Threads are dealt stripes round robin on first use and keep them */
+    sIndex = (size_t)pthread_getspecific(gMetricStripeKey);
+    if (!sIndex)
+    {
+        sIndex = (size_t)(InterlockedIncrement(&gnMetricNextStripe) - 1) %
+                 LSA_SRV_METRIC_STRIPES + 1;
+        pthread_setspecific(gMetricStripeKey, (PVOID)sIndex);
+    }
+
+    pStripe = &gMetricStripes[sIndex - 1];
+
+    pthread_mutex_lock(&pStripe->mutex);
+
+    return pStripe;
+}
+
+static
+VOID
+LsaSrvUnlockMetricStripe(
+    PLSA_SRV_METRIC_STRIPE pStripe
+    )
+{
+    pthread_mutex_unlock(&pStripe->mutex);
+}
+
+static
+VOID
+LsaSrvAddLatencySample(
+    PLSA_METRIC_LATENCY pLatency,
+    UINT64 ullMicroseconds,
+    DWORD dwError
+    )
+{
+    DWORD dwBucket = 0;
+    UINT64 ullRemaining = ullMicroseconds;
+
+    while (ullRemaining && dwBucket < LSA_METRIC_LATENCY_BUCKETS - 1)
+    {
+        ullRemaining >>= 1;
+        dwBucket++;
+    }
+
+    pLatency->count++;
+    if (dwError)
+    {
+        pLatency->failed++;
+    }
+    pLatency->totalMicroseconds += ullMicroseconds;
+    if (ullMicroseconds > pLatency->maxMicroseconds)
+    {
+        pLatency->maxMicroseconds = ullMicroseconds;
+    }
+    pLatency->buckets[dwBucket]++;
+}
+
+static
+VOID
+LsaSrvMergeLatency(
+    PLSA_METRIC_LATENCY pTotal,
+    const LSA_METRIC_LATENCY* pLatency
+    )
+{
+    DWORD dwBucket = 0;
+
+    pTotal->count += pLatency->count;
+    pTotal->failed += pLatency->failed;
+    pTotal->totalMicroseconds += pLatency->totalMicroseconds;
+    if (pLatency->maxMicroseconds > pTotal->maxMicroseconds)
+    {
+        pTotal->maxMicroseconds = pLatency->maxMicroseconds;
+    }
+
+    for (dwBucket = 0; dwBucket < LSA_METRIC_LATENCY_BUCKETS; dwBucket++)
+    {
+        pTotal->buckets[dwBucket] += pLatency->buckets[dwBucket];
+    }
+}
+
+static
+VOID
+LsaSrvSumMetricCounters(
+    UINT64 counters[LsaMetricSentinel]
+    )
+{
+    DWORD dwStripe = 0;
+    DWORD dwIndex = 0;
+    PLSA_SRV_METRIC_STRIPE pStripe = NULL;
+
+    memset(counters, 0, sizeof(counters[0]) * LsaMetricSentinel);
+
+    for (dwStripe = 0; dwStripe < LSA_SRV_METRIC_STRIPES; dwStripe++)
+    {
+        pStripe = &gMetricStripes[dwStripe];
+
+        pthread_mutex_lock(&pStripe->mutex);
+
+        for (dwIndex = 0; dwIndex < LsaMetricSentinel; dwIndex++)
+        {
+            counters[dwIndex] += pStripe->counters[dwIndex];
+        }
+
+        pthread_mutex_unlock(&pStripe->mutex);
+    }
+}
+
+static
+VOID
+LsaSrvFillMetricPack_1(
+    PLSA_METRIC_PACK_1 pMetricPack,
+    const UINT64 counters[LsaMetricSentinel]
+    )
+{
+    pMetricPack->successfulAuthentications =
+                 counters[LsaMetricSuccessfulAuthentications];
+    pMetricPack->failedAuthentications =
+                 counters[LsaMetricFailedAuthentications];
+    pMetricPack->rootUserAuthentications =
+                 counters[LsaMetricRootUserAuthentications];
+    pMetricPack->successfulUserLookupsByName =
+                 counters[LsaMetricSuccessfulUserLookupsByName];
+    pMetricPack->failedUserLookupsByName =
+                 counters[LsaMetricFailedUserLookupsByName];
+    pMetricPack->successfulUserLookupsById =
+                 counters[LsaMetricSuccessfulUserLookupsById];
+    pMetricPack->failedUserLookupsById =
+                 counters[LsaMetricFailedUserLookupsById];
+    pMetricPack->successfulGroupLookupsByName =
+                 counters[LsaMetricSuccessfulGroupLookupsByName];
+    pMetricPack->failedGroupLookupsByName =
+                 counters[LsaMetricFailedGroupLookupsByName];
+    pMetricPack->successfulGroupLookupsById =
+                 counters[LsaMetricSuccessfulGroupLookupsById];
+    pMetricPack->failedGroupLookupsById =
+                 counters[LsaMetricFailedGroupLookupsById];
+    pMetricPack->successfulOpenSession =
+                 counters[LsaMetricSuccessfulOpenSession];
+    pMetricPack->failedOpenSession =
+                 counters[LsaMetricFailedOpenSession];
+    pMetricPack->successfulCloseSession =
+                 counters[LsaMetricSuccessfulCloseSession];
+    pMetricPack->failedCloseSession =
+                 counters[LsaMetricFailedCloseSession];
+    pMetricPack->successfulChangePassword =
+                 counters[LsaMetricSuccessfulChangePassword];
+    pMetricPack->failedChangePassword =
+                 counters[LsaMetricFailedChangePassword];
+}
+
 DWORD
 LsaSrvGetMetrics(
     HANDLE hServer,
@@ -73,6 +276,12 @@ LsaSrvGetMetrics(
                             &pMetricPack);
             break;
 
+        case 2:
+
+            dwError = LsaSrvGetMetrics_2(
+                            &pMetricPack);
+            break;
+
         default:
 
             dwError = LW_ERROR_INVALID_METRIC_INFO_LEVEL;
@@ -103,37 +312,36 @@ LsaSrvGetMetrics_0(
 {
     DWORD dwError = 0;
     PLSA_METRIC_PACK_0 pMetricPack = NULL;
-
-    pthread_rwlock_rdlock(&gPerfCounters_rwlock);
+    UINT64 counters[LsaMetricSentinel];
 
     dwError = LwAllocateMemory(
                   sizeof(LSA_METRIC_PACK_0),
                   (PVOID*)&pMetricPack);
     BAIL_ON_LSA_ERROR(dwError);
 
+    LsaSrvSumMetricCounters(counters);
+
     pMetricPack->failedAuthentications =
-                 gPerfCounters[LsaMetricFailedAuthentications] ;
+                 counters[LsaMetricFailedAuthentications] ;
     pMetricPack->failedUserLookupsByName =
-                 gPerfCounters[LsaMetricFailedUserLookupsByName];
+                 counters[LsaMetricFailedUserLookupsByName];
     pMetricPack->failedUserLookupsById =
-                 gPerfCounters[LsaMetricFailedUserLookupsById];
+                 counters[LsaMetricFailedUserLookupsById];
     pMetricPack->failedGroupLookupsByName =
-                 gPerfCounters[LsaMetricFailedGroupLookupsByName];
+                 counters[LsaMetricFailedGroupLookupsByName];
     pMetricPack->failedGroupLookupsById =
-                 gPerfCounters[LsaMetricFailedGroupLookupsById];
+                 counters[LsaMetricFailedGroupLookupsById];
     pMetricPack->failedOpenSession =
-                 gPerfCounters[LsaMetricFailedOpenSession];
+                 counters[LsaMetricFailedOpenSession];
     pMetricPack->failedCloseSession =
-                 gPerfCounters[LsaMetricFailedCloseSession];
+                 counters[LsaMetricFailedCloseSession];
     pMetricPack->failedChangePassword =
-                 gPerfCounters[LsaMetricFailedChangePassword];
+                 counters[LsaMetricFailedChangePassword];
 
     *ppMetricPack = pMetricPack;
 
 cleanup:
 
-    pthread_rwlock_unlock(&gPerfCounters_rwlock);
-
     return dwError;
 
 error:
@@ -152,54 +360,99 @@ LsaSrvGetMetrics_1(
 {
     DWORD dwError = 0;
     PLSA_METRIC_PACK_1 pMetricPack = NULL;
-
-    pthread_rwlock_rdlock(&gPerfCounters_rwlock);
+    UINT64 counters[LsaMetricSentinel];
 
     dwError = LwAllocateMemory(
                   sizeof(LSA_METRIC_PACK_1),
                   (PVOID*)&pMetricPack);
     BAIL_ON_LSA_ERROR(dwError);
 
-    pMetricPack->successfulAuthentications =
-                 gPerfCounters[LsaMetricSuccessfulAuthentications];
-    pMetricPack->failedAuthentications =
-                 gPerfCounters[LsaMetricFailedAuthentications];
-    pMetricPack->rootUserAuthentications =
-                 gPerfCounters[LsaMetricRootUserAuthentications];
-    pMetricPack->successfulUserLookupsByName =
-                 gPerfCounters[LsaMetricSuccessfulUserLookupsByName];
-    pMetricPack->failedUserLookupsByName =
-                 gPerfCounters[LsaMetricFailedUserLookupsByName];
-    pMetricPack->successfulUserLookupsById =
-                 gPerfCounters[LsaMetricSuccessfulUserLookupsById];
-    pMetricPack->failedUserLookupsById =
-                 gPerfCounters[LsaMetricFailedUserLookupsById];
-    pMetricPack->successfulGroupLookupsByName =
-                 gPerfCounters[LsaMetricSuccessfulGroupLookupsByName];
-    pMetricPack->failedGroupLookupsByName =
-                 gPerfCounters[LsaMetricFailedGroupLookupsByName];
-    pMetricPack->successfulGroupLookupsById =
-                 gPerfCounters[LsaMetricSuccessfulGroupLookupsById];
-    pMetricPack->failedGroupLookupsById =
-                 gPerfCounters[LsaMetricFailedGroupLookupsById];
-    pMetricPack->successfulOpenSession =
-                 gPerfCounters[LsaMetricSuccessfulOpenSession];
-    pMetricPack->failedOpenSession =
-                 gPerfCounters[LsaMetricFailedOpenSession];
-    pMetricPack->successfulCloseSession =
-                 gPerfCounters[LsaMetricSuccessfulCloseSession];
-    pMetricPack->failedCloseSession =
-                 gPerfCounters[LsaMetricFailedCloseSession];
-    pMetricPack->successfulChangePassword =
-                 gPerfCounters[LsaMetricSuccessfulChangePassword];
-    pMetricPack->failedChangePassword =
-                 gPerfCounters[LsaMetricFailedChangePassword];
+    LsaSrvSumMetricCounters(counters);
+
+    LsaSrvFillMetricPack_1(pMetricPack, counters);
 
     *ppMetricPack = pMetricPack;
 
 cleanup:
 
-    pthread_rwlock_unlock(&gPerfCounters_rwlock);
+    return dwError;
+
+error:
+
+    *ppMetricPack = NULL;
+
+    LW_SAFE_FREE_MEMORY(pMetricPack);
+
+    goto cleanup;
+}
+
+DWORD
+LsaSrvGetMetrics_2(
+    PVOID* ppMetricPack
+    )
+{
+    DWORD dwError = 0;
+    PLSA_METRIC_PACK_2 pMetricPack = NULL;
+    UINT64 counters[LsaMetricSentinel];
+    PLSA_SRV_METRIC_STRIPE pStripe = NULL;
+    DWORD dwStripe = 0;
+    DWORD dwIndex = 0;
+
+    dwError = LwAllocateMemory(
+                  sizeof(LSA_METRIC_PACK_2),
+                  (PVOID*)&pMetricPack);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    memset(counters, 0, sizeof(counters));
+
+    for (dwStripe = 0; dwStripe < LSA_SRV_METRIC_STRIPES; dwStripe++)
+    {
+        pStripe = &gMetricStripes[dwStripe];
+
+        pthread_mutex_lock(&pStripe->mutex);
+
+        for (dwIndex = 0; dwIndex < LsaMetricSentinel; dwIndex++)
+        {
+            counters[dwIndex] += pStripe->counters[dwIndex];
+        }
+
+        for (dwIndex = 0; dwIndex < LSA_METRIC_OP_COUNT; dwIndex++)
+        {
+            LsaSrvMergeLatency(
+                &pMetricPack->operations[dwIndex],
+                &pStripe->operations[dwIndex]);
+        }
+
+        for (dwIndex = 0; dwIndex < LSA_METRIC_CACHE_COUNT; dwIndex++)
+        {
+            pMetricPack->cacheHits[dwIndex] += pStripe->cacheHits[dwIndex];
+            pMetricPack->cacheMisses[dwIndex] += pStripe->cacheMisses[dwIndex];
+        }
+
+        pthread_mutex_unlock(&pStripe->mutex);
+    }
+
+    LsaSrvFillMetricPack_1(&pMetricPack->counters, counters);
+
+    pMetricPack->unauthorizedAccesses =
+                 counters[LsaMetricUnauthorizedAccesses];
+    pMetricPack->operationsInFlight =
+                 InterlockedRead(&gnMetricInFlight);
+    pMetricPack->operationsInFlightPeak =
+                 InterlockedRead(&gnMetricInFlightPeak);
+
+    pthread_mutex_lock(&gDcMetricsLock);
+
+    pMetricPack->dwDcTargetCount = gdwDcMetricsCount;
+    memcpy(pMetricPack->dcTargets,
+           gDcMetrics,
+           sizeof(gDcMetrics[0]) * gdwDcMetricsCount);
+
+    pthread_mutex_unlock(&gDcMetricsLock);
+
+    *ppMetricPack = pMetricPack;
+
+cleanup:
 
     return dwError;
 
@@ -217,11 +470,172 @@ LsaSrvIncrementMetricValue(
     LsaMetricType metricType
     )
 {
-    pthread_rwlock_wrlock(&gPerfCounters_rwlock);
+    PLSA_SRV_METRIC_STRIPE pStripe = LsaSrvLockMetricStripe();
+
+    pStripe->counters[metricType]++;
+
+    LsaSrvUnlockMetricStripe(pStripe);
+}
+
+UINT64
+LsaSrvGetMetricTimestamp(
+    VOID
+    )
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec now = {0};
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) >= 0)
+    {
+        return (UINT64)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    }
+#endif
+    {
+        struct timeval tv = {0};
 
-    gPerfCounters[metricType]++;
+        gettimeofday(&tv, NULL);
 
-    pthread_rwlock_unlock(&gPerfCounters_rwlock);
+        return (UINT64)tv.tv_sec * 1000000 + tv.tv_usec;
+    }
+}
+
+static
+UINT64
+LsaSrvGetMetricElapsed(
+    UINT64 ullStartTime
+    )
+{
+    UINT64 ullNow = LsaSrvGetMetricTimestamp();
+
+    /* gettimeofday can step backwards */
+    return ullNow > ullStartTime ? ullNow - ullStartTime : 0;
+}
+
+UINT64
+LsaSrvBeginMetricOperation(
+    VOID
+    )
+{
+    LONG nInFlight = InterlockedIncrement(&gnMetricInFlight);
+    LONG nPeak = InterlockedRead(&gnMetricInFlightPeak);
+
+    while (nInFlight > nPeak)
+    {
+        LONG nOld = InterlockedCompareExchange(
+                        &gnMetricInFlightPeak,
+                        nInFlight,
+                        nPeak);
+        if (nOld == nPeak)
+        {
+            break;
+        }
+        nPeak = nOld;
+    }
+
+    return LsaSrvGetMetricTimestamp();
+}
+
+VOID
+LsaSrvEndMetricOperation(
+    DWORD dwOperation,
+    UINT64 ullStartTime,
+    DWORD dwError
+    )
+{
+    UINT64 ullElapsed = LsaSrvGetMetricElapsed(ullStartTime);
+    PLSA_SRV_METRIC_STRIPE pStripe = NULL;
+
+    InterlockedDecrement(&gnMetricInFlight);
+
+    if (dwOperation >= LSA_METRIC_OP_COUNT)
+    {
+        return;
+    }
+
+    pStripe = LsaSrvLockMetricStripe();
+
+    LsaSrvAddLatencySample(
+        &pStripe->operations[dwOperation],
+        ullElapsed,
+        dwError);
+
+    LsaSrvUnlockMetricStripe(pStripe);
+}
+
+VOID
+LsaSrvRecordCacheLookup(
+    DWORD dwCacheIndex,
+    BOOLEAN bHit
+    )
+{
+    PLSA_SRV_METRIC_STRIPE pStripe = NULL;
+
+    if (dwCacheIndex >= LSA_METRIC_CACHE_COUNT)
+    {
+        return;
+    }
+
+    pStripe = LsaSrvLockMetricStripe();
+
+    if (bHit)
+    {
+        pStripe->cacheHits[dwCacheIndex]++;
+    }
+    else
+    {
+        pStripe->cacheMisses[dwCacheIndex]++;
+    }
+
+    LsaSrvUnlockMetricStripe(pStripe);
+}
+
+VOID
+LsaSrvRecordDcCallLatency(
+    LsaMetricDcCallType callType,
+    PCSTR pszTarget,
+    UINT64 ullStartTime,
+    DWORD dwError
+    )
+{
+    UINT64 ullElapsed = LsaSrvGetMetricElapsed(ullStartTime);
+    PLSA_METRIC_DC_TARGET pTarget = NULL;
+    DWORD dwIndex = 0;
+
+    if (LW_IS_NULL_OR_EMPTY_STR(pszTarget))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&gDcMetricsLock);
+
+    for (dwIndex = 0; dwIndex < gdwDcMetricsCount; dwIndex++)
+    {
+        if (!strncasecmp(gDcMetrics[dwIndex].szName,
+                         pszTarget,
+                         sizeof(gDcMetrics[dwIndex].szName) - 1))
+        {
+            pTarget = &gDcMetrics[dwIndex];
+            break;
+        }
+    }
+
+    /* Targets past the table size are not tracked */
+    if (!pTarget && gdwDcMetricsCount < LSA_METRIC_MAX_DC_TARGETS)
+    {
+        pTarget = &gDcMetrics[gdwDcMetricsCount++];
+        strncpy(pTarget->szName, pszTarget, sizeof(pTarget->szName) - 1);
+    }
+
+    if (pTarget)
+    {
+        LsaSrvAddLatencySample(
+            callType == LsaMetricDcCallLdap ?
+                &pTarget->ldapLatency : &pTarget->rpcLatency,
+            ullElapsed,
+            dwError);
+    }
+
+    pthread_mutex_unlock(&gDcMetricsLock);
 }
 
 VOID
@@ -239,6 +653,9 @@ LsaSrvFreeIpcMetriPack(
             case 1:
                 LW_SAFE_FREE_MEMORY(pMetricPack->pMetricPack.pMetricPack1);
                 break;
+            case 2:
+                LW_SAFE_FREE_MEMORY(pMetricPack->pMetricPack.pMetricPack2);
+                break;
             default:
                 {
                     LSA_LOG_ERROR("Unsupported Metric Pack Info Level [%u]", pMetricPack->dwInfoLevel);
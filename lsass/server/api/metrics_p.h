@@ -52,14 +52,38 @@ LsaSrvGetMetrics_0(
     PVOID* ppMetricPack
     );
 
+DWORD
+LsaSrvInitMetrics(
+    VOID
+    );
+
 DWORD
 LsaSrvGetMetrics_1(
     PVOID* ppMetricPack
     );
 
+DWORD
+LsaSrvGetMetrics_2(
+    PVOID* ppMetricPack
+    );
+
 VOID
 LsaSrvIncrementMetricValue(
     LsaMetricType metricType
     );
 
+/* Counts the operation as in flight and returns its start timestamp */
+UINT64
+LsaSrvBeginMetricOperation(
+    VOID
+    );
+
+/* dwOperation is one of LSA_METRIC_OP_* */
+VOID
+LsaSrvEndMetricOperation(
+    DWORD dwOperation,
+    UINT64 ullStartTime,
+    DWORD dwError
+    );
+
 #endif /* __METRICS_P_H__ */
@@ -110,6 +110,9 @@ LsaSrvProviderIoControl(
 
 cleanup:
 
+    LsaSrvInvalidateMemberNameCache();
+    LsaSrvInvalidateLookupCache();
+
     LW_SAFE_FREE_STRING(pszTargetProviderName);
     LW_SAFE_FREE_STRING(pszTargetInstance);
 
@@ -61,6 +61,13 @@ LsaStopRpcSrv(
     );
 
 
+static
+VOID
+LsaRpcConfigureReceiver(
+    VOID
+    );
+
+
 DWORD
 LsaCheckInvalidRpcServer(
     PVOID pSymbol,
@@ -171,6 +178,9 @@ LsaSrvInitRpcServers(
     PLSA_RPC_SERVER pRpcList = NULL;
     BOOLEAN bLocked = TRUE;
 
+    /* Must happen before the servers register their endpoints */
+    LsaRpcConfigureReceiver();
+
     dwError = LsaRpcReadRegistry(&pUninitializedRpcList);
     BAIL_ON_LSA_ERROR(dwError);
 
@@ -572,6 +582,62 @@ LsaSrvFreeRpcServers(
 }
 
 
+static
+VOID
+LsaRpcConfigureReceiver(
+    VOID
+    )
+{
+    DWORD dwError = 0;
+    PLSA_CONFIG_REG pReg = NULL;
+    DWORD dwThreads = LSA_RPC_DEFAULT_RECEIVER_THREADS;
+    unsigned32 rpcStatus = 0;
+
+    dwError = LsaOpenConfig(
+                "Services\\lsass\\Parameters\\RPCServers",
+                "Policy\\Services\\lsass\\Parameters\\RPCServers",
+                &pReg);
+    if (dwError == 0 && pReg != NULL)
+    {
+        dwError = LsaReadConfigDword(
+                    pReg,
+                    "ReceiverThreads",
+                    TRUE,
+                    0,
+                    LSA_RPC_MAX_RECEIVER_THREADS,
+                    &dwThreads);
+    }
+
+    LsaCloseConfig(pReg);
+
+    if (dwError)
+    {
+        LSA_LOG_ERROR("Failed to read RPC receiver settings [error code:%u]",
+                      dwError);
+    }
+
+    if (dwThreads == 0)
+    {
+        /* Each connection keeps a receiver thread of its own */
+        return;
+    }
+
+    rpc_mgmt_set_server_rcvr_threads((signed32) dwThreads, &rpcStatus);
+    if (rpcStatus)
+    {
+        LSA_LOG_ERROR("Failed to set up %u shared RPC receiver threads "
+                      "[rpc status:0x%x]",
+                      dwThreads,
+                      rpcStatus);
+    }
+    else
+    {
+        LSA_LOG_VERBOSE("RPC connections share %u receiver threads",
+                        dwThreads);
+    }
+}
+
+
 /*
 local variables:
 mode: c
@@ -47,6 +47,14 @@
 #ifndef _RPC_SERVER_P_H_
 #define _RPC_SERVER_P_H_
 
+/*
+ * Threads shared by the connections of all the RPC servers
+ * (Parameters\RPCServers\ReceiverThreads, 0 for a thread per
+ * connection).
+ */
+#define LSA_RPC_DEFAULT_RECEIVER_THREADS    4
+#define LSA_RPC_MAX_RECEIVER_THREADS        256
+
 typedef struct lsa_rpc_server {
     PSTR                        pszSrvLibPath;
     PSTR                        pszName;
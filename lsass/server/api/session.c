@@ -54,6 +54,7 @@ LsaSrvOpenSession(
     )
 {
     DWORD dwError = 0;
+    UINT64 ullStartTime = 0;
     DWORD dwTraceFlags[] = {LSA_TRACE_FLAG_AUTHENTICATION};
     BOOLEAN bInLock = FALSE;
     PLSA_AUTH_PROVIDER pProvider = NULL;
@@ -61,6 +62,8 @@ LsaSrvOpenSession(
 
     LSA_TRACE_BEGIN_FUNCTION(dwTraceFlags, sizeof(dwTraceFlags)/sizeof(dwTraceFlags[0]));
 
+    ullStartTime = LsaSrvBeginMetricOperation();
+
     BAIL_ON_INVALID_STRING(pszLoginId);
 
     ENTER_AUTH_PROVIDER_LIST_READER_LOCK(bInLock);
@@ -127,6 +130,8 @@ cleanup:
 
     LEAVE_AUTH_PROVIDER_LIST_READER_LOCK(bInLock);
 
+    LsaSrvEndMetricOperation(LSA_METRIC_OP_OPEN_SESSION, ullStartTime, dwError);
+
     if (!dwError)
     {
         LsaSrvIncrementMetricValue(LsaMetricSuccessfulOpenSession);
@@ -153,6 +158,7 @@ LsaSrvCloseSession(
     )
 {
     DWORD dwError = 0;
+    UINT64 ullStartTime = 0;
     DWORD dwTraceFlags[] = {LSA_TRACE_FLAG_AUTHENTICATION};
     BOOLEAN bInLock = FALSE;
     PLSA_AUTH_PROVIDER pProvider = NULL;
@@ -160,6 +166,8 @@ LsaSrvCloseSession(
 
     LSA_TRACE_BEGIN_FUNCTION(dwTraceFlags, sizeof(dwTraceFlags)/sizeof(dwTraceFlags[0]));
 
+    ullStartTime = LsaSrvBeginMetricOperation();
+
     ENTER_AUTH_PROVIDER_LIST_READER_LOCK(bInLock);
 
     dwError = LW_ERROR_NOT_HANDLED;
@@ -213,6 +221,8 @@ cleanup:
 
     LEAVE_AUTH_PROVIDER_LIST_READER_LOCK(bInLock);
 
+    LsaSrvEndMetricOperation(LSA_METRIC_OP_CLOSE_SESSION, ullStartTime, dwError);
+
     if (!dwError)
     {
         LsaSrvIncrementMetricValue(LsaMetricSuccessfulCloseSession);
@@ -55,6 +55,59 @@ typedef struct __LSA_SRV_API_CONFIG
     BOOLEAN bEnableEventLog;
     char cDomainSeparator;
     char cSpaceReplacement;
+    DWORD dwNegativeCacheTimeout;
 } LSA_SRV_API_CONFIG, *PLSA_SRV_API_CONFIG;
 
+/*
+ * Names of the enabled user members of a group, packed back to back as
+ * NUL-terminated strings.  Entries are reference counted and immutable once
+ * built, so the same list can be handed to any number of callers.
+ */
+typedef struct __LSA_SRV_MEMBER_NAMES
+{
+    LONG nRefCount;
+    PSTR pszGroupSid;
+    LSA_FIND_FLAGS FindFlags;
+    DWORD dwGeneration;
+    time_t tExpire;
+    DWORD dwMemberCount;
+    DWORD dwMemberNamesLength;
+    PBYTE pMemberNames;
+} LSA_SRV_MEMBER_NAMES, *PLSA_SRV_MEMBER_NAMES;
+
+/*
+ * Entry of the negative lookup cache (keyed by query) or of the provider
+ * routing cache (keyed by domain, pszProvider NULL if ambiguous).
+ */
+typedef struct __LSA_SRV_LOOKUP_CACHE_ENTRY
+{
+    PSTR pszKey;
+    PSTR pszProvider;
+    time_t tExpire;
+} LSA_SRV_LOOKUP_CACHE_ENTRY, *PLSA_SRV_LOOKUP_CACHE_ENTRY;
+
+/* Which providers LsaSrvFindObjectsInternal asks about one query key */
+typedef struct __LSA_SRV_QUERY_ROUTE
+{
+    /* Only this provider can resolve the key (NULL asks all of them) */
+    struct _LSA_AUTH_PROVIDER* pProvider;
+    /* The key recently resolved to nothing, so ask no one */
+    BOOLEAN bMissing;
+} LSA_SRV_QUERY_ROUTE, *PLSA_SRV_QUERY_ROUTE;
+
+/*
+ * One shard of the server metrics.  A thread always updates the same
+ * stripe, so the stripe lock is rarely contended; readers add them up.
+ */
+typedef struct __LSA_SRV_METRIC_STRIPE
+{
+    pthread_mutex_t mutex;
+    UINT64 counters[LsaMetricSentinel];
+    LSA_METRIC_LATENCY operations[LSA_METRIC_OP_COUNT];
+    UINT64 cacheHits[LSA_METRIC_CACHE_COUNT];
+    UINT64 cacheMisses[LSA_METRIC_CACHE_COUNT];
+    /* Keeps the next stripe's lock off this stripe's last cache line */
+    BYTE padding[64];
+} LSA_SRV_METRIC_STRIPE, *PLSA_SRV_METRIC_STRIPE;
+
 #endif /* __STRUCTS_H__ */
@@ -44,6 +44,28 @@
  */
 #include "adprovider.h"
 
+static
+VOID
+ADCacheRecordLookups(
+    IN DWORD dwCacheIndex,
+    IN DWORD dwError,
+    IN size_t sCount,
+    IN OPTIONAL PLSA_SECURITY_OBJECT* ppResults
+    )
+{
+    size_t sIndex = 0;
+
+    if (dwError || !ppResults)
+    {
+        LsaSrvRecordCacheLookup(dwCacheIndex, !dwError);
+        return;
+    }
+
+    for (sIndex = 0; sIndex < sCount; sIndex++)
+    {
+        LsaSrvRecordCacheLookup(dwCacheIndex, ppResults[sIndex] != NULL);
+    }
+}
 
 DWORD
 ADCacheOpen(
@@ -100,6 +122,9 @@ ADCacheFindUserByName(
                         pUserNameInfo,
                         ppObject
                         );
+
+    ADCacheRecordLookups(LSA_METRIC_CACHE_USER_BY_NAME, dwError, 0, NULL);
+
     return dwError;
 }
 
@@ -118,6 +143,9 @@ ADCacheFindUserById(
                     uid,
                     ppObject
                     );
+
+    ADCacheRecordLookups(LSA_METRIC_CACHE_USER_BY_ID, dwError, 0, NULL);
+
     return dwError;
 }
 
@@ -135,6 +163,9 @@ ADCacheFindGroupByName(
                     pGroupNameInfo,
                     ppObject
                     );
+
+    ADCacheRecordLookups(LSA_METRIC_CACHE_GROUP_BY_NAME, dwError, 0, NULL);
+
     return dwError;
 }
 
@@ -152,6 +183,9 @@ ADCacheFindGroupById(
                     gid,
                     ppObject
                     );
+
+    ADCacheRecordLookups(LSA_METRIC_CACHE_GROUP_BY_ID, dwError, 0, NULL);
+
     return dwError;
 }
 
@@ -290,6 +324,8 @@ ADCacheGetMemberships(
                     pppResults
                     );
 
+    ADCacheRecordLookups(LSA_METRIC_CACHE_MEMBERSHIP, dwError, 0, NULL);
+
     return dwError;
 }
 
@@ -394,6 +430,9 @@ ADCacheFindObjectByDN(
                         pszDN,
                         ppObject
                         );
+
+    ADCacheRecordLookups(LSA_METRIC_CACHE_OBJECT_BY_DN, dwError, 0, NULL);
+
     return dwError;
 }
 
@@ -413,6 +452,9 @@ ADCacheFindObjectsByDNList(
                         ppszDnList,
                         pppResults
                         );
+
+    ADCacheRecordLookups(LSA_METRIC_CACHE_OBJECT_BY_DN, dwError, sCount, dwError ? NULL : *pppResults);
+
     return dwError;
 }
 
@@ -430,6 +472,8 @@ ADCacheFindObjectBySid(
                             ppObject
                             );
 
+    ADCacheRecordLookups(LSA_METRIC_CACHE_OBJECT_BY_SID, dwError, 0, NULL);
+
     return dwError;
 }
 
@@ -452,6 +496,8 @@ ADCacheFindObjectsBySidList(
                         pppResults
                         );
 
+    ADCacheRecordLookups(LSA_METRIC_CACHE_OBJECT_BY_SID, dwError, sCount, dwError ? NULL : *pppResults);
+
     return dwError;
 
 }
@@ -471,6 +517,9 @@ ADCacheGetPasswordVerifier(
                     pszUserSid,
                     ppResult
                     );
+
+    ADCacheRecordLookups(LSA_METRIC_CACHE_PASSWORD_VERIFIER, dwError, 0, NULL);
+
     return dwError;
 }
 
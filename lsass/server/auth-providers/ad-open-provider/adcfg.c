@@ -144,6 +144,8 @@ AD_InitializeConfig(
 
     pConfig->bMultiTenancyEnabled = FALSE;
     pConfig->bAddDomainToLocalGroupsEnabled = TRUE;
+    pConfig->dwNetlogonChannelCount = AD_NETLOGON_CHANNEL_COUNT_DEFAULT;
+    pConfig->dwNetlogonMaxConcurrentApi = AD_NETLOGON_MAX_CONCURRENT_DEFAULT;
 
     dwError = LwAllocateString(
                     AD_DEFAULT_SHELL,
@@ -570,6 +572,26 @@ AD_ReadRegistry(
             NULL,
             &StagingConfig.bAddDomainToLocalGroupsEnabled,
             NULL
+        },
+        {
+            "NetlogonChannelCount",
+            TRUE,
+            LsaTypeDword,
+            1,
+            AD_NETLOGON_CHANNEL_COUNT_MAXIMUM,
+            NULL,
+            &StagingConfig.dwNetlogonChannelCount,
+            NULL
+        },
+        {
+            "NetlogonMaxConcurrentApi",
+            TRUE,
+            LsaTypeDword,
+            1,
+            AD_NETLOGON_MAX_CONCURRENT_MAXIMUM,
+            NULL,
+            &StagingConfig.dwNetlogonMaxConcurrentApi,
+            NULL
         }
     };
 
@@ -1931,6 +1953,40 @@ AD_GetAddDomainToLocalGroupsEnabled(
     return result;
 }
 
+DWORD
+AD_GetNetlogonChannelCount(
+    IN PLSA_AD_PROVIDER_STATE pState
+    )
+{
+    DWORD dwResult = 0;
+    BOOLEAN bInLock = FALSE;
+
+    ENTER_AD_CONFIG_RW_READER_LOCK(bInLock, pState);
+
+    dwResult = pState->config.dwNetlogonChannelCount;
+
+    LEAVE_AD_CONFIG_RW_READER_LOCK(bInLock, pState);
+
+    return dwResult;
+}
+
+DWORD
+AD_GetNetlogonMaxConcurrentApi(
+    IN PLSA_AD_PROVIDER_STATE pState
+    )
+{
+    DWORD dwResult = 0;
+    BOOLEAN bInLock = FALSE;
+
+    ENTER_AD_CONFIG_RW_READER_LOCK(bInLock, pState);
+
+    dwResult = pState->config.dwNetlogonMaxConcurrentApi;
+
+    LEAVE_AD_CONFIG_RW_READER_LOCK(bInLock, pState);
+
+    return dwResult;
+}
+
 VOID
 AD_ConfigLockAcquireRead(
     PLSA_AD_PROVIDER_STATE pState
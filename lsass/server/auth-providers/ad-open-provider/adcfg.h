@@ -310,6 +310,16 @@ AD_GetAddDomainToLocalGroupsEnabled(
     IN PLSA_AD_PROVIDER_STATE pState
     );
 
+DWORD
+AD_GetNetlogonChannelCount(
+    IN PLSA_AD_PROVIDER_STATE pState
+    );
+
+DWORD
+AD_GetNetlogonMaxConcurrentApi(
+    IN PLSA_AD_PROVIDER_STATE pState
+    );
+
 VOID
 AD_ConfigLockAcquireRead(
     PLSA_AD_PROVIDER_STATE pState
@@ -64,6 +64,19 @@
 
 #define AD_MAX_ALLOWED_CLOCK_DRIFT_SECONDS 60
 
+#define AD_NETLOGON_CHANNEL_COUNT_DEFAULT     4
+#define AD_NETLOGON_CHANNEL_COUNT_MAXIMUM     16
+#define AD_NETLOGON_MAX_CONCURRENT_DEFAULT    10
+#define AD_NETLOGON_MAX_CONCURRENT_MAXIMUM    150
+
+#define AD_LSA_POLICY_POOL_MAX_PER_HOST       4
+#define AD_LSA_POLICY_POOL_IDLE_SECONDS       (5 * LSA_SECONDS_IN_MINUTE)
+
+#define AD_ENUM_SNAPSHOT_PAGE_SIZE            1000
+
+#define AD_CLOSURE_CACHE_TABLE_SIZE           257
+#define AD_CLOSURE_CACHE_MAX_ENTRIES          4096
+
 #define AD_STR_IS_SID(str) \
     (!LW_IS_NULL_OR_EMPTY_STR(str) && !strncasecmp(str, "s-", sizeof("s-")-1))
 
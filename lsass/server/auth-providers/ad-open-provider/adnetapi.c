@@ -50,14 +50,37 @@
 #include "adprovider.h"
 #include "adnetapi.h"
 
-typedef struct _LSA_SCHANNEL_STATE {
-    NetrCredentials SchannelCreds;
-    NetrCredentials *pSchannelCreds;
-    NETR_BINDING hSchannelBinding;
-    PSTR pszSchannelServer;
-    pthread_mutex_t SchannelLock;
-    pthread_mutex_t *pSchannelLock;
-} LSA_SCHANNEL_STATE;
+typedef struct _LSA_POLICY_CONNECTION {
+    LSA_BINDING hBinding;
+    POLICY_HANDLE hPolicy;
+    DWORD dwFlushGeneration;
+    time_t LastUsed;
+    struct _LSA_POLICY_CONNECTION *pNext;
+} LSA_POLICY_CONNECTION, *PLSA_POLICY_CONNECTION;
+
+typedef struct _LSA_POLICY_HOST {
+    PSTR pszHostname;
+    /* Idle connections; dwOpen also counts the checked out ones */
+    PLSA_POLICY_CONNECTION pIdle;
+    DWORD dwOpen;
+    struct _LSA_POLICY_HOST *pNext;
+} LSA_POLICY_HOST, *PLSA_POLICY_HOST;
+
+typedef struct _LSA_POLICY_POOL {
+    pthread_mutex_t Lock;
+    pthread_mutex_t *pLock;
+    pthread_cond_t Cond;
+    pthread_cond_t *pCond;
+    DWORD dwFlushGeneration;
+    PLSA_POLICY_HOST pHosts;
+} LSA_POLICY_POOL;
+
+typedef struct _AD_SCHANNEL_OPEN_CONTEXT {
+    PLSA_AD_PROVIDER_STATE pState;
+    PLSA_MACHINE_PASSWORD_INFO_W pMachinePasswordInfo;
+    PCWSTR pwszComputer;
+    PCWSTR pwszServerName;
+} AD_SCHANNEL_OPEN_CONTEXT, *PAD_SCHANNEL_OPEN_CONTEXT;
 
 static
 BOOLEAN
@@ -83,11 +106,6 @@ AD_WinErrorIsConnectionError(
     WINERROR winError
     );
 
-static
-VOID
-AD_ClearSchannelStateInLock(
-    IN PLSA_SCHANNEL_STATE pSchannelState
-    );
 
 static
 DWORD
@@ -186,57 +204,6 @@ error:
     goto cleanup;
 }
 
-DWORD
-AD_NetCreateSchannelState(
-    OUT PLSA_SCHANNEL_STATE* ppSchannelState
-    )
-{
-    DWORD dwError = 0;
-    PLSA_SCHANNEL_STATE pSchannelState = NULL;
-
-    dwError = LwAllocateMemory(
-                  sizeof(*pSchannelState),
-                  (PVOID*)&pSchannelState);
-    BAIL_ON_LSA_ERROR(dwError);
-
-    dwError = LwMapErrnoToLwError(pthread_mutex_init(&pSchannelState->SchannelLock, NULL));
-    BAIL_ON_LSA_ERROR(dwError);
-
-    pSchannelState->pSchannelLock = &pSchannelState->SchannelLock;
-
-    *ppSchannelState = pSchannelState;
-
-cleanup:
-
-    return dwError;
-
-error:
-
-    *ppSchannelState = NULL;
-
-    if (pSchannelState)
-    {
-        AD_NetDestroySchannelState(pSchannelState);
-    }
-
-    goto cleanup;
-}
-
-VOID
-AD_NetDestroySchannelState(
-    IN PLSA_SCHANNEL_STATE pSchannelState
-    )
-{
-    AD_ClearSchannelStateInLock(pSchannelState);
-
-    if (pSchannelState->pSchannelLock)
-    {
-        pthread_mutex_destroy(pSchannelState->pSchannelLock);
-    }
-
-    LwFreeMemory(pSchannelState);
-}
-
 DWORD
 AD_NetUserChangePassword(
     PCSTR pszDomainName,
@@ -355,115 +322,154 @@ GetObjectType(
     return ObjectType;
 }
 
-DWORD
-AD_NetLookupObjectSidByName(
-    IN PLSA_AD_PROVIDER_STATE pState,
-    IN PCSTR pszHostname,
-    IN PCSTR pszObjectName,
-    OUT PSTR* ppszObjectSid,
-    OUT LSA_OBJECT_TYPE* pObjectType,
-    OUT PBOOLEAN pbIsNetworkError
+/*
+ * Warm lsarpc bindings with an open policy handle, kept per DC.  A
+ * connection is checked out by one translation at a time; concurrent
+ * translations to the same DC use separate pooled connections, up to
+ * AD_LSA_POLICY_POOL_MAX_PER_HOST.  Idle connections expire after
+ * AD_LSA_POLICY_POOL_IDLE_SECONDS.
+ */
+static
+VOID
+AD_NetClosePolicyConnection(
+    IN PLSA_POLICY_CONNECTION pConn
     )
 {
-    DWORD dwError = 0;
-    PLSA_TRANSLATED_NAME_OR_SID* ppTranslatedSids = NULL;
-    PSTR pszObjectSid = NULL;
-    BOOLEAN bIsNetworkError = FALSE;
-
-    dwError = AD_NetLookupObjectSidsByNames(
-                 pState,
-                 pszHostname,
-                 1,
-                 (PSTR*)&pszObjectName,
-                 &ppTranslatedSids,
-                 NULL,
-                 &bIsNetworkError);
-    BAIL_ON_LSA_ERROR(dwError);
+    NTSTATUS status = 0;
 
-    // In case of NOT found, the above function bails out with dwError == LW_ERROR_RPC_LSA_LOOKUPNAMES_FAILED
-    // Double check here again
-    if (!ppTranslatedSids || !ppTranslatedSids[0])
+    if (pConn)
     {
-        dwError = LW_ERROR_NO_SUCH_OBJECT;
-        BAIL_ON_LSA_ERROR(dwError);
-    }
+        if (pConn->hPolicy)
+        {
+            status = LsaClose(pConn->hBinding, pConn->hPolicy);
+            if (status != 0)
+            {
+                LSA_LOG_DEBUG("LsaClose() failed with %u (0x%08x)", status, status);
+            }
+        }
 
-    dwError = LwAllocateString(ppTranslatedSids[0]->pszNT4NameOrSid,
-                                &pszObjectSid);
-    BAIL_ON_LSA_ERROR(dwError);
+        if (pConn->hBinding)
+        {
+            LsaFreeBinding(&pConn->hBinding);
+        }
 
-    *ppszObjectSid = pszObjectSid;
-    *pObjectType = ppTranslatedSids[0]->ObjectType;
+        LwFreeMemory(pConn);
+    }
+}
 
-cleanup:
-    *pbIsNetworkError = bIsNetworkError;
-    if (ppTranslatedSids)
+static
+VOID
+AD_NetClosePolicyConnectionList(
+    IN PLSA_POLICY_CONNECTION pConnList
+    )
+{
+    PLSA_POLICY_CONNECTION pConn = NULL;
+
+    while (pConnList)
     {
-       LsaFreeTranslatedNameList(ppTranslatedSids, 1);
+        pConn = pConnList;
+        pConnList = pConnList->pNext;
+
+        AD_NetClosePolicyConnection(pConn);
     }
-    return dwError;
+}
 
-error:
-    *ppszObjectSid = NULL;
-    LW_SAFE_FREE_STRING(pszObjectSid);
-    *pObjectType = LSA_OBJECT_TYPE_UNDEFINED;
-    LSA_LOG_ERROR("Failed to find user, group, or domain by name (name = '%s', searched host = '%s') -> error = %u, symbol = %s",
-            LSA_SAFE_LOG_STRING(pszObjectName),
-            LSA_SAFE_LOG_STRING(pszHostname),
-            dwError,
-            LwWin32ExtErrorToName(dwError));
-    dwError = LW_ERROR_NO_SUCH_OBJECT;
+/*
+ * Moves expired (or, with bExpireAll, all) idle connections of every
+ * host onto *ppExpired and drops hosts that no longer have any
+ * connection.
+ */
+static
+VOID
+AD_NetExpirePolicyConnectionsInLock(
+    IN PLSA_POLICY_POOL pPool,
+    IN time_t now,
+    IN BOOLEAN bExpireAll,
+    IN OUT PLSA_POLICY_CONNECTION* ppExpired
+    )
+{
+    PLSA_POLICY_HOST* ppHost = &pPool->pHosts;
+    PLSA_POLICY_HOST pHost = NULL;
+    PLSA_POLICY_CONNECTION* ppConn = NULL;
+    PLSA_POLICY_CONNECTION pConn = NULL;
 
-    goto cleanup;
+    while (*ppHost)
+    {
+        pHost = *ppHost;
+        ppConn = &pHost->pIdle;
+
+        while (*ppConn)
+        {
+            pConn = *ppConn;
+
+            if (bExpireAll ||
+                now < pConn->LastUsed ||
+                now - pConn->LastUsed >= AD_LSA_POLICY_POOL_IDLE_SECONDS)
+            {
+                *ppConn = pConn->pNext;
+                pConn->pNext = *ppExpired;
+                *ppExpired = pConn;
+                pHost->dwOpen--;
+            }
+            else
+            {
+                ppConn = &pConn->pNext;
+            }
+        }
+
+        if (!pHost->dwOpen)
+        {
+            *ppHost = pHost->pNext;
+            LW_SAFE_FREE_STRING(pHost->pszHostname);
+            LwFreeMemory(pHost);
+        }
+        else
+        {
+            ppHost = &pHost->pNext;
+        }
+    }
 }
 
+static
 DWORD
-AD_NetLookupObjectSidsByNames(
+AD_NetOpenPolicyConnection(
     IN PLSA_AD_PROVIDER_STATE pState,
     IN PCSTR pszHostname,
-    IN DWORD dwNamesCount,
-    IN PSTR* ppszNames,
-    OUT PLSA_TRANSLATED_NAME_OR_SID** pppTranslatedSids,
-    OUT OPTIONAL PDWORD pdwFoundSidsCount,
+    OUT PLSA_POLICY_CONNECTION* ppConn,
     OUT PBOOLEAN pbIsNetworkError
     )
 {
     DWORD dwError = 0;
-    PWSTR pwcHost = NULL;
     NTSTATUS status = 0;
-    LSA_BINDING lsa_binding = (HANDLE)NULL;
+    PWSTR pwcHost = NULL;
     DWORD dwAccess_rights = LSA_ACCESS_LOOKUP_NAMES_SIDS;
-    POLICY_HANDLE hPolicy = NULL;
-    DWORD dwLevel;
-    DWORD dwFoundSidsCount = 0;
-    PWSTR* ppwcNames = NULL;
-    RefDomainList* pDomains = NULL;
-    TranslatedSid2* pSids = NULL;
-    PLSA_TRANSLATED_NAME_OR_SID* ppTranslatedSids = NULL;
-    PSID pObject_sid = NULL;
+    PLSA_POLICY_CONNECTION pConn = NULL;
     BOOLEAN bIsNetworkError = FALSE;
-    DWORD i = 0;
     LW_PIO_CREDS pCreds = NULL;
     LW_PIO_CREDS pOldToken = NULL;
     BOOLEAN bChangedToken = FALSE;
 
-    BAIL_ON_INVALID_STRING(pszHostname);
     dwError = LwMbsToWc16s(
                   pszHostname,
                   &pwcHost);
     BAIL_ON_LSA_ERROR(dwError);
 
+    dwError = LwAllocateMemory(
+                  sizeof(*pConn),
+                  (PVOID*)&pConn);
+    BAIL_ON_LSA_ERROR(dwError);
+
     dwError = AD_SetSystemAccess(
                   pState,
                   &pOldToken);
     BAIL_ON_LSA_ERROR(dwError);
     bChangedToken = TRUE;
 
-	status = LwIoGetThreadCreds(&pCreds);
-	dwError = LwNtStatusToErrno(status);
+    status = LwIoGetThreadCreds(&pCreds);
+    dwError = LwNtStatusToErrno(status);
     BAIL_ON_LSA_ERROR(dwError);
 
-    status = LsaInitBindingDefault(&lsa_binding, pwcHost, pCreds);
+    status = LsaInitBindingDefault(&pConn->hBinding, pwcHost, pCreds);
     if (status != 0)
     {
         LSA_LOG_DEBUG("LsaInitBindingDefault() failed with %u (0x%08x)", status, status);
@@ -472,31 +478,17 @@ AD_NetLookupObjectSidsByNames(
         BAIL_ON_LSA_ERROR(dwError);
     }
 
-    if (lsa_binding == NULL)
+    if (pConn->hBinding == NULL)
     {
         dwError = LW_ERROR_RPC_LSABINDING_FAILED;
         BAIL_ON_LSA_ERROR(dwError);
     }
 
-    // Convert ppszNames to ppwcNames
-    dwError = LwAllocateMemory(
-                    sizeof(*ppwcNames)*dwNamesCount,
-                    (PVOID*)&ppwcNames);
-    BAIL_ON_LSA_ERROR(dwError);
-
-    for (i = 0; i < dwNamesCount; i++)
-    {
-        dwError = LwMbsToWc16s(
-                      ppszNames[i],
-                      &ppwcNames[i]);
-        BAIL_ON_LSA_ERROR(dwError);
-    }
-
-    status = LsaOpenPolicy2(lsa_binding,
+    status = LsaOpenPolicy2(pConn->hBinding,
                             pwcHost,
                             NULL,
                             dwAccess_rights,
-                            &hPolicy);
+                            &pConn->hPolicy);
     if (status != 0)
     {
         LSA_LOG_DEBUG("LsaOpenPolicy2() failed with %u (0x%08x)", status, status);
@@ -518,111 +510,556 @@ AD_NetLookupObjectSidsByNames(
         BAIL_ON_LSA_ERROR(dwError);
     }
 
-    /* Lookup name to sid */
-    dwLevel = 1;
-    status = LsaLookupNames2(
-                   lsa_binding,
-                   hPolicy,
-                   dwNamesCount,
-                   ppwcNames,
-                   &pDomains,
-                   &pSids,
-                   dwLevel,
-                   &dwFoundSidsCount);
-    if (status != 0)
-    {
-        if (LW_STATUS_NONE_MAPPED == status)
-        {
-            // This is ok.
-            LSA_LOG_DEBUG("LsaLookupNames2() empty results (0 out of %u)",
-                          dwNamesCount);
-
-            dwFoundSidsCount = 0;
-
-            dwError = LwAllocateMemory(
-                            sizeof(*ppTranslatedSids)*dwNamesCount,
-                            (PVOID*)&ppTranslatedSids);
-            BAIL_ON_LSA_ERROR(dwError);
-
-            dwError = 0;
-            goto cleanup;
-        }
-        else if (LW_STATUS_SOME_NOT_MAPPED == status)
-        {
-            LSA_LOG_DEBUG("LsaLookupNames2() partial results (%u out of %u)",
-                          dwFoundSidsCount, dwNamesCount);
-            dwError = 0;
-        }
-        else
-        {
-            LSA_LOG_DEBUG("LsaLookupNames2() failed with %u (0x%08x)", status, status);
+    *ppConn = pConn;
 
-            if (AD_NtStatusIsTgtRevokedError(status))
-            {
-                bIsNetworkError = TRUE;
-                dwError = LW_ERROR_KRB5KDC_ERR_TGT_REVOKED;
-            }
-            else
-            {
-                if (AD_NtStatusIsConnectionError(status))
-                {
-                    bIsNetworkError = TRUE;
-                }
+cleanup:
 
-                dwError = LW_ERROR_RPC_LSA_LOOKUPNAME2_FAILED;
-            }
+    LW_SAFE_FREE_MEMORY(pwcHost);
 
-            BAIL_ON_LSA_ERROR(dwError);
-        }
-    }
-    if (dwFoundSidsCount == 0)
+    if (bChangedToken)
     {
-        dwError = LW_ERROR_RPC_LSA_LOOKUPNAME2_NOT_FOUND;
-        BAIL_ON_LSA_ERROR(dwError);
+        LwIoSetThreadCreds(pOldToken);
     }
-    else if (dwFoundSidsCount > dwNamesCount)
+    if (pOldToken != NULL)
     {
-        dwError = LW_ERROR_RPC_LSA_LOOKUPNAME2_FOUND_DUPLICATES;
-        BAIL_ON_LSA_ERROR(dwError);
+        LwIoDeleteCreds(pOldToken);
     }
-    else if (!pSids || !pDomains)
+    if (pCreds)
     {
-        dwError = LW_ERROR_RPC_LSA_LOOKUPNAME2_NOT_FOUND;
-        BAIL_ON_LSA_ERROR(dwError);
+        LwIoDeleteCreds(pCreds);
     }
 
-    // For incomplete results (LW_STATUS_SOME_NOT_MAPPED == status), leave ppTranslatedSids[i] as NULL for those NOT found
-    // to maintain ppszNames[i] -> ppTranslatedSids[i]
-    dwError = LwAllocateMemory(
-                    sizeof(*ppTranslatedSids)*dwNamesCount,
-                    (PVOID*)&ppTranslatedSids);
-    BAIL_ON_LSA_ERROR(dwError);
+    *pbIsNetworkError = bIsNetworkError;
 
-    for (i = 0; i < dwNamesCount; i++)
-    {
-        LSA_OBJECT_TYPE ObjectType = LSA_OBJECT_TYPE_UNDEFINED;
-        DWORD dwDomainSid_index = 0;
+    return dwError;
 
-        ObjectType = GetObjectType(pSids[i].type);
-        if (ObjectType == LSA_OBJECT_TYPE_UNDEFINED)
-        {
-            continue;
-        }
+error:
 
-        dwError = LwAllocateMemory(
-                            sizeof(*ppTranslatedSids[i]),
-                            (PVOID*)&ppTranslatedSids[i]);
-        BAIL_ON_LSA_ERROR(dwError);
+    *ppConn = NULL;
 
-        ppTranslatedSids[i]->ObjectType = ObjectType;
+    AD_NetClosePolicyConnection(pConn);
 
-        dwDomainSid_index = pSids[i].index;
+    goto cleanup;
+}
 
-        if (dwDomainSid_index >= pDomains->count)
-        {
-            dwError = LW_ERROR_RPC_LSA_LOOKUPNAME2_FAILED;
-            BAIL_ON_LSA_ERROR(dwError);
-        }
+/*
+ * Checks out a connection to pszHostname, reusing an idle one when
+ * available.  *pbReused tells the caller whether a failure may just
+ * mean the pooled connection went stale.
+ */
+static
+DWORD
+AD_NetAcquirePolicyConnection(
+    IN PLSA_AD_PROVIDER_STATE pState,
+    IN PCSTR pszHostname,
+    OUT PLSA_POLICY_CONNECTION* ppConn,
+    OUT PBOOLEAN pbReused,
+    OUT PBOOLEAN pbIsNetworkError
+    )
+{
+    DWORD dwError = 0;
+    PLSA_POLICY_POOL pPool = pState->hPolicyPool;
+    PLSA_POLICY_HOST pHost = NULL;
+    PLSA_POLICY_CONNECTION pConn = NULL;
+    PLSA_POLICY_CONNECTION pExpired = NULL;
+    DWORD dwFlushGeneration = 0;
+    BOOLEAN bInLock = FALSE;
+    BOOLEAN bIsNetworkError = FALSE;
+
+    pthread_mutex_lock(pPool->pLock);
+    bInLock = TRUE;
+
+    AD_NetExpirePolicyConnectionsInLock(pPool, time(NULL), FALSE, &pExpired);
+
+    for (pHost = pPool->pHosts; pHost; pHost = pHost->pNext)
+    {
+        if (!strcasecmp(pHost->pszHostname, pszHostname))
+        {
+            break;
+        }
+    }
+
+    if (!pHost)
+    {
+        dwError = LwAllocateMemory(
+                      sizeof(*pHost),
+                      (PVOID*)&pHost);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        dwError = LwAllocateString(pszHostname, &pHost->pszHostname);
+        if (dwError)
+        {
+            LwFreeMemory(pHost);
+            pHost = NULL;
+        }
+        BAIL_ON_LSA_ERROR(dwError);
+
+        pHost->pNext = pPool->pHosts;
+        pPool->pHosts = pHost;
+    }
+
+    while (!pHost->pIdle &&
+           pHost->dwOpen >= AD_LSA_POLICY_POOL_MAX_PER_HOST)
+    {
+        pthread_cond_wait(pPool->pCond, pPool->pLock);
+    }
+
+    if (pHost->pIdle)
+    {
+        pConn = pHost->pIdle;
+        pHost->pIdle = pConn->pNext;
+        pConn->pNext = NULL;
+
+        *pbReused = TRUE;
+    }
+    else
+    {
+        /* Reserve the slot, then connect without holding the pool lock */
+        pHost->dwOpen++;
+        dwFlushGeneration = pPool->dwFlushGeneration;
+
+        pthread_mutex_unlock(pPool->pLock);
+        bInLock = FALSE;
+
+        dwError = AD_NetOpenPolicyConnection(
+                      pState,
+                      pszHostname,
+                      &pConn,
+                      &bIsNetworkError);
+        if (dwError)
+        {
+            pthread_mutex_lock(pPool->pLock);
+            bInLock = TRUE;
+
+            pHost->dwOpen--;
+            pthread_cond_signal(pPool->pCond);
+        }
+        BAIL_ON_LSA_ERROR(dwError);
+
+        pConn->dwFlushGeneration = dwFlushGeneration;
+        *pbReused = FALSE;
+    }
+
+    *ppConn = pConn;
+
+cleanup:
+
+    if (bInLock)
+    {
+        pthread_mutex_unlock(pPool->pLock);
+    }
+
+    AD_NetClosePolicyConnectionList(pExpired);
+
+    *pbIsNetworkError = bIsNetworkError;
+
+    return dwError;
+
+error:
+
+    *ppConn = NULL;
+    *pbReused = FALSE;
+
+    goto cleanup;
+}
+
+/*
+ * Returns a connection to the pool.  With bDiscard set the connection
+ * is closed along with every idle connection to the same host, since
+ * they most likely share its fate (e.g. the DC restarted).
+ */
+static
+VOID
+AD_NetReleasePolicyConnection(
+    IN PLSA_AD_PROVIDER_STATE pState,
+    IN PCSTR pszHostname,
+    IN PLSA_POLICY_CONNECTION pConn,
+    IN BOOLEAN bDiscard
+    )
+{
+    PLSA_POLICY_POOL pPool = pState->hPolicyPool;
+    PLSA_POLICY_HOST pHost = NULL;
+    PLSA_POLICY_CONNECTION pClose = NULL;
+    PLSA_POLICY_CONNECTION pIdle = NULL;
+
+    pthread_mutex_lock(pPool->pLock);
+
+    for (pHost = pPool->pHosts; pHost; pHost = pHost->pNext)
+    {
+        if (!strcasecmp(pHost->pszHostname, pszHostname))
+        {
+            break;
+        }
+    }
+
+    /* A host stays listed while any of its connections is checked out,
+       and a connection opened before a flush is not kept */
+    if (!bDiscard && pConn->dwFlushGeneration == pPool->dwFlushGeneration)
+    {
+        pConn->LastUsed = time(NULL);
+        pConn->pNext = pHost->pIdle;
+        pHost->pIdle = pConn;
+    }
+    else
+    {
+        pHost->dwOpen--;
+        pConn->pNext = NULL;
+        pClose = pConn;
+
+        while (bDiscard && pHost->pIdle)
+        {
+            pIdle = pHost->pIdle;
+            pHost->pIdle = pIdle->pNext;
+            pIdle->pNext = pClose;
+            pClose = pIdle;
+            pHost->dwOpen--;
+        }
+    }
+
+    pthread_cond_broadcast(pPool->pCond);
+
+    pthread_mutex_unlock(pPool->pLock);
+
+    AD_NetClosePolicyConnectionList(pClose);
+}
+
+DWORD
+AD_NetCreatePolicyPool(
+    OUT PLSA_POLICY_POOL* ppPool
+    )
+{
+    DWORD dwError = 0;
+    PLSA_POLICY_POOL pPool = NULL;
+
+    dwError = LwAllocateMemory(
+                  sizeof(*pPool),
+                  (PVOID*)&pPool);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LwMapErrnoToLwError(pthread_mutex_init(&pPool->Lock, NULL));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pPool->pLock = &pPool->Lock;
+
+    dwError = LwMapErrnoToLwError(pthread_cond_init(&pPool->Cond, NULL));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pPool->pCond = &pPool->Cond;
+
+    *ppPool = pPool;
+
+cleanup:
+
+    return dwError;
+
+error:
+
+    *ppPool = NULL;
+
+    if (pPool)
+    {
+        AD_NetDestroyPolicyPool(pPool);
+    }
+
+    goto cleanup;
+}
+
+VOID
+AD_NetFlushPolicyPool(
+    IN PLSA_POLICY_POOL pPool
+    )
+{
+    PLSA_POLICY_CONNECTION pExpired = NULL;
+
+    pthread_mutex_lock(pPool->pLock);
+
+    pPool->dwFlushGeneration++;
+    AD_NetExpirePolicyConnectionsInLock(pPool, time(NULL), TRUE, &pExpired);
+
+    pthread_mutex_unlock(pPool->pLock);
+
+    AD_NetClosePolicyConnectionList(pExpired);
+}
+
+VOID
+AD_NetDestroyPolicyPool(
+    IN PLSA_POLICY_POOL pPool
+    )
+{
+    PLSA_POLICY_HOST pHost = NULL;
+
+    if (pPool->pLock)
+    {
+        AD_NetFlushPolicyPool(pPool);
+
+        /* Nothing can be checked out once the provider is going away */
+        while (pPool->pHosts)
+        {
+            pHost = pPool->pHosts;
+            pPool->pHosts = pHost->pNext;
+
+            LW_SAFE_FREE_STRING(pHost->pszHostname);
+            LwFreeMemory(pHost);
+        }
+
+        pthread_mutex_destroy(pPool->pLock);
+    }
+
+    if (pPool->pCond)
+    {
+        pthread_cond_destroy(pPool->pCond);
+    }
+
+    LwFreeMemory(pPool);
+}
+
+DWORD
+AD_NetLookupObjectSidByName(
+    IN PLSA_AD_PROVIDER_STATE pState,
+    IN PCSTR pszHostname,
+    IN PCSTR pszObjectName,
+    OUT PSTR* ppszObjectSid,
+    OUT LSA_OBJECT_TYPE* pObjectType,
+    OUT PBOOLEAN pbIsNetworkError
+    )
+{
+    DWORD dwError = 0;
+    PLSA_TRANSLATED_NAME_OR_SID* ppTranslatedSids = NULL;
+    PSTR pszObjectSid = NULL;
+    BOOLEAN bIsNetworkError = FALSE;
+
+    dwError = AD_NetLookupObjectSidsByNames(
+                 pState,
+                 pszHostname,
+                 1,
+                 (PSTR*)&pszObjectName,
+                 &ppTranslatedSids,
+                 NULL,
+                 &bIsNetworkError);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    // In case of NOT found, the above function bails out with dwError == LW_ERROR_RPC_LSA_LOOKUPNAMES_FAILED
+    // Double check here again
+    if (!ppTranslatedSids || !ppTranslatedSids[0])
+    {
+        dwError = LW_ERROR_NO_SUCH_OBJECT;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    dwError = LwAllocateString(ppTranslatedSids[0]->pszNT4NameOrSid,
+                                &pszObjectSid);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    *ppszObjectSid = pszObjectSid;
+    *pObjectType = ppTranslatedSids[0]->ObjectType;
+
+cleanup:
+    *pbIsNetworkError = bIsNetworkError;
+    if (ppTranslatedSids)
+    {
+       LsaFreeTranslatedNameList(ppTranslatedSids, 1);
+    }
+    return dwError;
+
+error:
+    *ppszObjectSid = NULL;
+    LW_SAFE_FREE_STRING(pszObjectSid);
+    *pObjectType = LSA_OBJECT_TYPE_UNDEFINED;
+    LSA_LOG_ERROR("Failed to find user, group, or domain by name (name = '%s', searched host = '%s') -> error = %u, symbol = %s",
+            LSA_SAFE_LOG_STRING(pszObjectName),
+            LSA_SAFE_LOG_STRING(pszHostname),
+            dwError,
+            LwWin32ExtErrorToName(dwError));
+    dwError = LW_ERROR_NO_SUCH_OBJECT;
+
+    goto cleanup;
+}
+
+DWORD
+AD_NetLookupObjectSidsByNames(
+    IN PLSA_AD_PROVIDER_STATE pState,
+    IN PCSTR pszHostname,
+    IN DWORD dwNamesCount,
+    IN PSTR* ppszNames,
+    OUT PLSA_TRANSLATED_NAME_OR_SID** pppTranslatedSids,
+    OUT OPTIONAL PDWORD pdwFoundSidsCount,
+    OUT PBOOLEAN pbIsNetworkError
+    )
+{
+    DWORD dwError = 0;
+    NTSTATUS status = 0;
+    PLSA_POLICY_CONNECTION pConn = NULL;
+    BOOLEAN bReused = FALSE;
+    BOOLEAN bRetried = FALSE;
+    BOOLEAN bDiscardConn = FALSE;
+    DWORD dwLevel;
+    DWORD dwFoundSidsCount = 0;
+    PWSTR* ppwcNames = NULL;
+    RefDomainList* pDomains = NULL;
+    TranslatedSid2* pSids = NULL;
+    PLSA_TRANSLATED_NAME_OR_SID* ppTranslatedSids = NULL;
+    PSID pObject_sid = NULL;
+    BOOLEAN bIsNetworkError = FALSE;
+    DWORD i = 0;
+    UINT64 ullStartTime = 0;
+
+    BAIL_ON_INVALID_STRING(pszHostname);
+
+    // Convert ppszNames to ppwcNames
+    dwError = LwAllocateMemory(
+                    sizeof(*ppwcNames)*dwNamesCount,
+                    (PVOID*)&ppwcNames);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    for (i = 0; i < dwNamesCount; i++)
+    {
+        dwError = LwMbsToWc16s(
+                      ppszNames[i],
+                      &ppwcNames[i]);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    for (;;)
+    {
+        dwError = AD_NetAcquirePolicyConnection(
+                      pState,
+                      pszHostname,
+                      &pConn,
+                      &bReused,
+                      &bIsNetworkError);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        /* Lookup name to sid */
+        dwLevel = 1;
+        ullStartTime = LsaSrvGetMetricTimestamp();
+        status = LsaLookupNames2(
+                       pConn->hBinding,
+                       pConn->hPolicy,
+                       dwNamesCount,
+                       ppwcNames,
+                       &pDomains,
+                       &pSids,
+                       dwLevel,
+                       &dwFoundSidsCount);
+        LsaSrvRecordDcCallLatency(
+            LsaMetricDcCallRpc,
+            pszHostname,
+            ullStartTime,
+            status);
+        if (!status ||
+            LW_STATUS_NONE_MAPPED == status ||
+            LW_STATUS_SOME_NOT_MAPPED == status ||
+            !bReused || bRetried)
+        {
+            break;
+        }
+
+        /* The pooled connection may have gone stale; reconnect once */
+        LSA_LOG_DEBUG("LsaLookupNames2() failed with %u (0x%08x) on a pooled "
+                      "connection to %s, reconnecting",
+                      status, status, pszHostname);
+
+        AD_NetReleasePolicyConnection(pState, pszHostname, pConn, TRUE);
+        pConn = NULL;
+        bRetried = TRUE;
+    }
+
+    if (status != 0)
+    {
+        if (LW_STATUS_NONE_MAPPED == status)
+        {
+            // This is ok.
+            LSA_LOG_DEBUG("LsaLookupNames2() empty results (0 out of %u)",
+                          dwNamesCount);
+
+            dwFoundSidsCount = 0;
+
+            dwError = LwAllocateMemory(
+                            sizeof(*ppTranslatedSids)*dwNamesCount,
+                            (PVOID*)&ppTranslatedSids);
+            BAIL_ON_LSA_ERROR(dwError);
+
+            dwError = 0;
+            goto cleanup;
+        }
+        else if (LW_STATUS_SOME_NOT_MAPPED == status)
+        {
+            LSA_LOG_DEBUG("LsaLookupNames2() partial results (%u out of %u)",
+                          dwFoundSidsCount, dwNamesCount);
+            dwError = 0;
+        }
+        else
+        {
+            LSA_LOG_DEBUG("LsaLookupNames2() failed with %u (0x%08x)", status, status);
+
+            bDiscardConn = TRUE;
+
+            if (AD_NtStatusIsTgtRevokedError(status))
+            {
+                bIsNetworkError = TRUE;
+                dwError = LW_ERROR_KRB5KDC_ERR_TGT_REVOKED;
+            }
+            else
+            {
+                if (AD_NtStatusIsConnectionError(status))
+                {
+                    bIsNetworkError = TRUE;
+                }
+
+                dwError = LW_ERROR_RPC_LSA_LOOKUPNAME2_FAILED;
+            }
+
+            BAIL_ON_LSA_ERROR(dwError);
+        }
+    }
+    if (dwFoundSidsCount == 0)
+    {
+        dwError = LW_ERROR_RPC_LSA_LOOKUPNAME2_NOT_FOUND;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+    else if (dwFoundSidsCount > dwNamesCount)
+    {
+        dwError = LW_ERROR_RPC_LSA_LOOKUPNAME2_FOUND_DUPLICATES;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+    else if (!pSids || !pDomains)
+    {
+        dwError = LW_ERROR_RPC_LSA_LOOKUPNAME2_NOT_FOUND;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    // For incomplete results (LW_STATUS_SOME_NOT_MAPPED == status), leave ppTranslatedSids[i] as NULL for those NOT found
+    // to maintain ppszNames[i] -> ppTranslatedSids[i]
+    dwError = LwAllocateMemory(
+                    sizeof(*ppTranslatedSids)*dwNamesCount,
+                    (PVOID*)&ppTranslatedSids);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    for (i = 0; i < dwNamesCount; i++)
+    {
+        LSA_OBJECT_TYPE ObjectType = LSA_OBJECT_TYPE_UNDEFINED;
+        DWORD dwDomainSid_index = 0;
+
+        ObjectType = GetObjectType(pSids[i].type);
+        if (ObjectType == LSA_OBJECT_TYPE_UNDEFINED)
+        {
+            continue;
+        }
+
+        dwError = LwAllocateMemory(
+                            sizeof(*ppTranslatedSids[i]),
+                            (PVOID*)&ppTranslatedSids[i]);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        ppTranslatedSids[i]->ObjectType = ObjectType;
+
+        dwDomainSid_index = pSids[i].index;
+
+        if (dwDomainSid_index >= pDomains->count)
+        {
+            dwError = LW_ERROR_RPC_LSA_LOOKUPNAME2_FAILED;
+            BAIL_ON_LSA_ERROR(dwError);
+        }
 
         LW_SAFE_FREE_MEMORY(pObject_sid);
 
@@ -649,7 +1086,6 @@ AD_NetLookupObjectSidsByNames(
     }
 
 cleanup:
-    LW_SAFE_FREE_MEMORY(pwcHost);
     if (ppwcNames)
     {
         for (i = 0; i < dwNamesCount; i++)
@@ -667,28 +1103,9 @@ cleanup:
         LsaRpcFreeMemory(pSids);
     }
     LW_SAFE_FREE_MEMORY(pObject_sid);
-    status = LsaClose(lsa_binding, hPolicy);
-    if (status != 0 && dwError == 0)
-    {
-        LSA_LOG_DEBUG("LsaClose() failed with %u (0x%08x)", status, status);
-        dwError = LW_ERROR_RPC_CLOSEPOLICY_FAILED;
-    }
-    if (lsa_binding)
-    {
-        LsaFreeBinding(&lsa_binding);
-    }
-    if (bChangedToken)
-    {
-        LwIoSetThreadCreds(pOldToken);
-    }
-    if (pOldToken != NULL)
-    {
-        LwIoDeleteCreds(pOldToken);
-    }
-
-    if (pCreds)
+    if (pConn)
     {
-        LwIoDeleteCreds(pCreds);
+        AD_NetReleasePolicyConnection(pState, pszHostname, pConn, bDiscardConn);
     }
 
     *pppTranslatedSids = ppTranslatedSids;
@@ -793,11 +1210,12 @@ AD_NetLookupObjectNamesBySids(
     )
 {
     DWORD dwError = 0;
-    PWSTR pwcHost = NULL;
     NTSTATUS status = 0;
-    LSA_BINDING lsa_binding = (HANDLE)NULL;
-    DWORD dwAccess_rights = LSA_ACCESS_LOOKUP_NAMES_SIDS;
-    POLICY_HANDLE hPolicy = NULL;
+    UINT64 ullStartTime = 0;
+    PLSA_POLICY_CONNECTION pConn = NULL;
+    BOOLEAN bReused = FALSE;
+    BOOLEAN bRetried = FALSE;
+    BOOLEAN bDiscardConn = FALSE;
     SID_ARRAY sid_array  = {0};
     DWORD dwLevel = 1;
     DWORD dwFoundNamesCount = 0;
@@ -809,42 +1227,9 @@ AD_NetLookupObjectNamesBySids(
     PLSA_TRANSLATED_NAME_OR_SID* ppTranslatedNames = NULL;
     BOOLEAN bIsNetworkError = FALSE;
     DWORD i = 0;
-    PIO_CREDS pCreds = NULL;
-    LW_PIO_CREDS pOldToken = NULL;
-    BOOLEAN bChangedToken = FALSE;
 
     BAIL_ON_INVALID_STRING(pszHostname);
 
-    dwError = LwMbsToWc16s(
-                  pszHostname,
-                  &pwcHost);
-    BAIL_ON_LSA_ERROR(dwError);
-
-    dwError = AD_SetSystemAccess(
-                  pState,
-                  &pOldToken);
-    BAIL_ON_LSA_ERROR(dwError);
-    bChangedToken = TRUE;
-
-    status = LwIoGetThreadCreds(&pCreds);
-    dwError = LwNtStatusToErrno(status);
-    BAIL_ON_LSA_ERROR(dwError);
-
-    status = LsaInitBindingDefault(&lsa_binding, pwcHost, pCreds);
-    if (status != 0)
-    {
-        LSA_LOG_DEBUG("LsaInitBindingDefault() failed with %u (0x%08x)", status, status);
-        dwError = LW_ERROR_RPC_LSABINDING_FAILED;
-        bIsNetworkError = TRUE;
-        BAIL_ON_LSA_ERROR(dwError);
-    }
-
-    if (lsa_binding == NULL)
-    {
-        dwError = LW_ERROR_RPC_LSABINDING_FAILED;
-        BAIL_ON_LSA_ERROR(dwError);
-    }
-
     // Convert ppszObjectSids to sid_array
     sid_array.dwNumSids = dwSidsCount;
     dwError = LwAllocateMemory(
@@ -863,41 +1248,49 @@ AD_NetLookupObjectNamesBySids(
         pObjectSID = NULL;
     }
 
-    status = LsaOpenPolicy2(lsa_binding,
-                            pwcHost,
-                            NULL,
-                            dwAccess_rights,
-                            &hPolicy);
-    if (status != 0)
+    for (;;)
     {
-        LSA_LOG_DEBUG("LsaOpenPolicy2() failed with %u (0x%08x)", status, status);
+        dwError = AD_NetAcquirePolicyConnection(
+                      pState,
+                      pszHostname,
+                      &pConn,
+                      &bReused,
+                      &bIsNetworkError);
+        BAIL_ON_LSA_ERROR(dwError);
 
-        if (AD_NtStatusIsTgtRevokedError(status))
+        /* Lookup sid to name */
+        ullStartTime = LsaSrvGetMetricTimestamp();
+        status = LsaLookupSids(
+                       pConn->hBinding,
+                       pConn->hPolicy,
+                       &sid_array,
+                       &pDomains,
+                       &name_array,
+                       dwLevel,
+                       &dwFoundNamesCount);
+        LsaSrvRecordDcCallLatency(
+            LsaMetricDcCallRpc,
+            pszHostname,
+            ullStartTime,
+            status);
+        if (!status ||
+            LW_STATUS_NONE_MAPPED == status ||
+            LW_STATUS_SOME_NOT_MAPPED == status ||
+            !bReused || bRetried)
         {
-            bIsNetworkError = TRUE;
-            dwError = LW_ERROR_KRB5KDC_ERR_TGT_REVOKED;
+            break;
         }
-        else
-        {
-            if (AD_NtStatusIsConnectionError(status))
-            {
-                bIsNetworkError = TRUE;
-            }
 
-            dwError = LW_ERROR_RPC_OPENPOLICY_FAILED;
-        }
-        BAIL_ON_LSA_ERROR(dwError);
+        /* The pooled connection may have gone stale; reconnect once */
+        LSA_LOG_DEBUG("LsaLookupSids() failed with %u (0x%08x) on a pooled "
+                      "connection to %s, reconnecting",
+                      status, status, pszHostname);
+
+        AD_NetReleasePolicyConnection(pState, pszHostname, pConn, TRUE);
+        pConn = NULL;
+        bRetried = TRUE;
     }
 
-    /* Lookup sid to name */
-    status = LsaLookupSids(
-                   lsa_binding,
-                   hPolicy,
-                   &sid_array,
-                   &pDomains,
-                   &name_array,
-                   dwLevel,
-                   &dwFoundNamesCount);
     if (status != 0)
     {
         if (LW_STATUS_NONE_MAPPED == status)
@@ -926,6 +1319,8 @@ AD_NetLookupObjectNamesBySids(
         {
             LSA_LOG_DEBUG("LsaLookupSids() failed with %u (0x%08x)", status, status);
 
+            bDiscardConn = TRUE;
+
             if (AD_NtStatusIsTgtRevokedError(status))
             {
                 bIsNetworkError = TRUE;
@@ -1057,8 +1452,6 @@ cleanup:
     }
 
     LW_SAFE_FREE_STRING(pszUsername);
-    LW_SAFE_FREE_MEMORY(pwcHost);
-
 
     if (name_array)
     {
@@ -1076,28 +1469,9 @@ cleanup:
 
     LW_SAFE_FREE_MEMORY(pObjectSID);
 
-    status = LsaClose(lsa_binding, hPolicy);
-    if (status != 0 && dwError == 0){
-        LSA_LOG_DEBUG("LsaClose() failed with %u (0x%08x)", status, status);
-        dwError = LW_ERROR_RPC_CLOSEPOLICY_FAILED;
-    }
-
-    if (lsa_binding)
-    {
-        LsaFreeBinding(&lsa_binding);
-    }
-    if (bChangedToken)
-    {
-        LwIoSetThreadCreds(pOldToken);
-    }
-    if (pOldToken != NULL)
-    {
-        LwIoDeleteCreds(pOldToken);
-    }
-
-    if (pCreds)
+    if (pConn)
     {
-        LwIoDeleteCreds(pCreds);
+        AD_NetReleasePolicyConnection(pState, pszHostname, pConn, bDiscardConn);
     }
 
     *pppTranslatedNames = ppTranslatedNames;
@@ -1452,7 +1826,7 @@ WinTimeToInt64(
 
 static DWORD
 LsaCopyNetrUserInfo3(
-    IN PLSA_SCHANNEL_STATE pSchannelState,
+    IN PLSA_SCHANNEL_SLOT pSlot,
     OUT PLSA_AUTH_USER_INFO pUserInfo,
     IN NetrValidationInfo *pNetrUserInfo3
     )
@@ -1488,7 +1862,7 @@ LsaCopyNetrUserInfo3(
 
     /* We have to decrypt the user session key before we can use it */
 
-    RC4_set_key(&RC4Key, 16, pSchannelState->pSchannelCreds->session_key);
+    RC4_set_key(&RC4Key, 16, pSlot->pSchannelCreds->session_key);
     RC4(&RC4Key,
         pUserInfo->pSessionKey->dwLen,
         pUserInfo->pSessionKey->pData,
@@ -1499,7 +1873,7 @@ LsaCopyNetrUserInfo3(
                                pBase->lmkey.key);
     BAIL_ON_LSA_ERROR(dwError);
 
-    RC4_set_key(&RC4Key, 16, pSchannelState->pSchannelCreds->session_key);
+    RC4_set_key(&RC4Key, 16, pSlot->pSchannelCreds->session_key);
     RC4(&RC4Key,
         pUserInfo->pLmSessionKey->dwLen,
         pUserInfo->pLmSessionKey->pData,
@@ -1595,110 +1969,233 @@ LsaCopyNetrUserInfo3(
         {
             PLSA_SID_ATTRIB pSidAttrib = &(pUserInfo->pSidAttribList[pUserInfo->dwNumSids]);
 
-            dwError = ERROR_SUCCESS;
+            dwError = ERROR_SUCCESS;
+
+            pSidAttrib->dwAttrib = pNetrUserInfo3->sam3->sids[i].attribute;
+
+            ntError = RtlAllocateCStringFromSid(
+                          &pSidAttrib->pszSid,
+                          pNetrUserInfo3->sam3->sids[i].sid);
+            dwError = LwNtStatusToWin32Error(ntError);
+            if (dwError != ERROR_SUCCESS)
+            {
+                if (pNetrUserInfo3->sam3->sids[i].sid)
+                {
+                    LSA_LOG_DEBUG(
+                        "Ignoring invalid SID (User = %s\\%s, Attribute = 0x%x, Revision = %d, SubAuthorityCount = %d).\n",
+                        pUserInfo->pszDomain ? pUserInfo->pszDomain : "NULL",
+                        pUserInfo->pszAccount ? pUserInfo->pszAccount : "NULL",
+                        pNetrUserInfo3->sam3->sids[i].attribute,
+                        pNetrUserInfo3->sam3->sids[i].sid->Revision,
+                        pNetrUserInfo3->sam3->sids[i].sid->SubAuthorityCount);
+                }
+                else
+                {
+                    LSA_LOG_DEBUG(
+                        "Ignoring NULL SID (User = %s\\%s, Attribute = 0x%x).\n",
+                        pUserInfo->pszDomain ? pUserInfo->pszDomain : "NULL",
+                        pUserInfo->pszAccount ? pUserInfo->pszAccount : "NULL",
+                        pNetrUserInfo3->sam3->sids[i].attribute);
+                }
+                continue;
+            }
+
+            // Successfully added another SID
+            pUserInfo->dwNumSids++;
+        }
+    }
+
+    /* All done */
+
+    dwError = LW_ERROR_SUCCESS;
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Opens the secure channel to the slot's target DC.  Called by
+ * AD_NetLockSchannelSlot with the slot lock held exclusively.
+ */
+static
+DWORD
+AD_NetOpenSchannelInLock(
+    IN PLSA_SCHANNEL_SLOT pSlot,
+    IN PVOID pContext,
+    OUT PBOOLEAN pbIsNetworkError
+    )
+{
+    PAD_SCHANNEL_OPEN_CONTEXT pOpenContext = pContext;
+    PLSA_AD_PROVIDER_STATE pState = pOpenContext->pState;
+    PLSA_MACHINE_PASSWORD_INFO_W pMachinePasswordInfo = pOpenContext->pMachinePasswordInfo;
+    DWORD dwError = 0;
+    NTSTATUS status = 0;
+    NTSTATUS nt_status = STATUS_UNHANDLED_EXCEPTION;
+    NETR_BINDING netr_b = NULL;
+    PWSTR pwszDomainController = NULL;
+    PWSTR pwszPrimaryShortDomain = NULL;
+    PWSTR pwszPrimaryFqdn = NULL;
+    LW_PIO_CREDS pCreds = NULL;
+    LW_PIO_CREDS pOldToken = NULL;
+    BOOLEAN bChangedToken = FALSE;
+    BOOLEAN bIsNetworkError = FALSE;
+
+    dwError = LwMbsToWc16s(pSlot->pszTarget, &pwszDomainController);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LwMbsToWc16s(pState->pProviderData->szShortDomain,
+                            &pwszPrimaryShortDomain);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LwMbsToWc16s(pState->pProviderData->szDomain,
+                           &pwszPrimaryFqdn);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LwWc16sToLower(pwszPrimaryFqdn);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    /* Establish the initial bind to \NETLOGON */
+
+    dwError = AD_SetSystemAccess(
+                  pState,
+                  &pOldToken);
+    BAIL_ON_LSA_ERROR(dwError);
+    bChangedToken = TRUE;
+
+    status = LwIoGetThreadCreds(&pCreds);
+    dwError = LwNtStatusToErrno(status);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    status = NetrInitBindingDefault(&netr_b, pwszDomainController, pCreds);
+    if (status != 0)
+    {
+        LSA_LOG_DEBUG("Failed to bind to %s (error %u)",
+                      pSlot->pszTarget, status);
+        dwError = LW_ERROR_RPC_NETLOGON_FAILED;
+        bIsNetworkError = TRUE;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    /* Now setup the Schannel session */
+
+    nt_status = NetrOpenSchannel(netr_b,
+                                 pMachinePasswordInfo->Account.SamAccountName,
+                                 pwszDomainController,
+                                 pOpenContext->pwszServerName,
+                                 pwszPrimaryShortDomain,
+                                 pwszPrimaryFqdn,
+                                 pOpenContext->pwszComputer,
+                                 pMachinePasswordInfo->Password,
+                                 &pSlot->SchannelCreds,
+                                 &pSlot->hSchannelBinding);
 
-            pSidAttrib->dwAttrib = pNetrUserInfo3->sam3->sids[i].attribute;
+    if (nt_status != STATUS_SUCCESS)
+    {
+        LSA_LOG_DEBUG("NetrOpenSchannel() failed with %u (0x%08x)", nt_status, nt_status);
 
-            ntError = RtlAllocateCStringFromSid(
-                          &pSidAttrib->pszSid,
-                          pNetrUserInfo3->sam3->sids[i].sid);
-            dwError = LwNtStatusToWin32Error(ntError);
-            if (dwError != ERROR_SUCCESS)
+        if (AD_NtStatusIsTgtRevokedError(nt_status))
+        {
+            bIsNetworkError = TRUE;
+            dwError = LW_ERROR_KRB5KDC_ERR_TGT_REVOKED;
+        }
+        else if (nt_status == STATUS_NO_TRUST_SAM_ACCOUNT)
+        {
+            bIsNetworkError = TRUE;
+            dwError = ERROR_NO_TRUST_SAM_ACCOUNT;
+        }
+        else
+        {
+            dwError = LW_ERROR_RPC_ERROR;
+            if (AD_NtStatusIsConnectionError(nt_status))
             {
-                if (pNetrUserInfo3->sam3->sids[i].sid)
-                {
-                    LSA_LOG_DEBUG(
-                        "Ignoring invalid SID (User = %s\\%s, Attribute = 0x%x, Revision = %d, SubAuthorityCount = %d).\n",
-                        pUserInfo->pszDomain ? pUserInfo->pszDomain : "NULL",
-                        pUserInfo->pszAccount ? pUserInfo->pszAccount : "NULL",
-                        pNetrUserInfo3->sam3->sids[i].attribute,
-                        pNetrUserInfo3->sam3->sids[i].sid->Revision,
-                        pNetrUserInfo3->sam3->sids[i].sid->SubAuthorityCount);
-                }
-                else
-                {
-                    LSA_LOG_DEBUG(
-                        "Ignoring NULL SID (User = %s\\%s, Attribute = 0x%x).\n",
-                        pUserInfo->pszDomain ? pUserInfo->pszDomain : "NULL",
-                        pUserInfo->pszAccount ? pUserInfo->pszAccount : "NULL",
-                        pNetrUserInfo3->sam3->sids[i].attribute);
-                }
-                continue;
+                bIsNetworkError = TRUE;
             }
-
-            // Successfully added another SID
-            pUserInfo->dwNumSids++;
         }
     }
+    BAIL_ON_LSA_ERROR(dwError);
 
-    /* All done */
+    dwError = LwAllocateString(
+                  pSlot->pszTarget,
+                  &pSlot->pszSchannelServer);
+    BAIL_ON_LSA_ERROR(dwError);
 
-    dwError = LW_ERROR_SUCCESS;
+    pSlot->pSchannelCreds = &pSlot->SchannelCreds;
 
 cleanup:
+
+    if (netr_b)
+    {
+        NetrFreeBinding(&netr_b);
+        netr_b = NULL;
+    }
+
+    if (bChangedToken)
+    {
+        LwIoSetThreadCreds(pOldToken);
+    }
+    if (pOldToken != NULL)
+    {
+        LwIoDeleteCreds(pOldToken);
+    }
+    if (pCreds != NULL)
+    {
+        LwIoDeleteCreds(pCreds);
+    }
+
+    LW_SAFE_FREE_MEMORY(pwszDomainController);
+    LW_SAFE_FREE_MEMORY(pwszPrimaryShortDomain);
+    LW_SAFE_FREE_MEMORY(pwszPrimaryFqdn);
+
+    *pbIsNetworkError = bIsNetworkError;
+
     return dwError;
 
 error:
+
     goto cleanup;
 }
 
+static
 DWORD
-AD_NetlogonAuthenticationUserEx(
+AD_NetSamLogonOnSlot(
     IN PLSA_AD_PROVIDER_STATE pState,
-    IN PSTR pszDomainController,
+    IN PLSA_SCHANNEL_SLOT pSlot,
+    IN PLSA_MACHINE_PASSWORD_INFO_W pMachinePasswordInfo,
+    IN PCWSTR pwszComputer,
     IN PLSA_AUTH_USER_PARAMS pUserParams,
     OUT PLSA_AUTH_USER_INFO *ppUserInfo,
     OUT PBOOLEAN pbIsNetworkError
     )
 {
     DWORD dwError = LW_ERROR_INTERNAL;
-    PLSA_SCHANNEL_STATE pSchannelState = pState->hSchannelState;
-    PWSTR pwszDomainController = NULL;
     PWSTR pwszServerName = NULL;
     PWSTR pwszShortDomain = NULL;
-    PWSTR pwszPrimaryShortDomain = NULL;
-    PWSTR pwszPrimaryFqdn = NULL;
     PWSTR pwszUsername = NULL;
-    PWSTR pwszComputer = NULL;
-    NTSTATUS status = 0;
-    NETR_BINDING netr_b = NULL;
-    PLSA_MACHINE_PASSWORD_INFO_W pMachinePasswordInfo = NULL;
     BOOLEAN bIsNetworkError = FALSE;
     NTSTATUS nt_status = STATUS_UNHANDLED_EXCEPTION;
     NetrValidationInfo  *pValidationInfo = NULL;
     UINT8 dwAuthoritative = 0;
     PSTR pszServerName = NULL;
-    DWORD dwDCNameLen = 0;
     PBYTE pChal = NULL;
     PBYTE pLMResp = NULL;
     DWORD LMRespLen = 0;
     PBYTE pNTResp = NULL;
     DWORD NTRespLen = 0;
-    LW_PIO_CREDS pCreds = NULL;
-    LW_PIO_CREDS pOldToken = NULL;
-    BOOLEAN bChangedToken = FALSE;
+    BOOLEAN bInLock = FALSE;
     BOOLEAN bResetSchannel = FALSE;
+    DWORD dwGeneration = 0;
+    AD_SCHANNEL_OPEN_CONTEXT OpenContext = { 0 };
     PLSA_AUTH_USER_INFO pUserInfo = NULL;
+    UINT64 ullStartTime = 0;
 
-    pthread_mutex_lock(pSchannelState->pSchannelLock);
-
-    /* Grab the machine password and account info */
-
-    dwError = LsaPcacheGetMachinePasswordInfoW(
-                  pState->pPcache,
-                  &pMachinePasswordInfo);
-    BAIL_ON_LSA_ERROR(dwError);
-
-    /* Gather other Schannel params */
-
-    /* Allocate space for the servername.  Include room for the terminating
-       NULL and \\ */
+    /* The slot's target stays fixed while this logon is in flight */
 
-    dwDCNameLen = strlen(pszDomainController) + 3;
-    dwError = LwAllocateMemory(dwDCNameLen, (PVOID*)&pszServerName);
+    dwError = LwAllocateStringPrintf(&pszServerName, "\\\\%s", pSlot->pszTarget);
     BAIL_ON_LSA_ERROR(dwError);
 
-    snprintf(pszServerName, dwDCNameLen, "\\\\%s", pszDomainController);
     dwError = LwMbsToWc16s(pszServerName, &pwszServerName);
     BAIL_ON_LSA_ERROR(dwError);
 
@@ -1708,110 +2205,19 @@ AD_NetlogonAuthenticationUserEx(
         BAIL_ON_LSA_ERROR(dwError);
     }
 
-    pwszComputer = wc16sdup(pMachinePasswordInfo->Account.SamAccountName);
-    if (!pwszComputer)
-    {
-        dwError = LW_ERROR_OUT_OF_MEMORY;
-    }
-    BAIL_ON_LSA_ERROR(dwError);
-
-    // Remove $ from account name
-    pwszComputer[wc16slen(pwszComputer) - 1] = 0;
-
-    if (pSchannelState->pszSchannelServer && strcasecmp(pSchannelState->pszSchannelServer, pszDomainController))
-    {
-        LSA_LOG_VERBOSE("Resetting schannel due to switching DC from '%s' to '%s'",
-                        pSchannelState->pszSchannelServer, pszDomainController);
-        AD_ClearSchannelStateInLock(pSchannelState);
-    }
-
-    if (!pSchannelState->hSchannelBinding)
-    {
-        dwError = LwMbsToWc16s(pszDomainController, &pwszDomainController);
-        BAIL_ON_LSA_ERROR(dwError);
-
-        dwError = LwMbsToWc16s(pState->pProviderData->szShortDomain,
-                                &pwszPrimaryShortDomain);
-        BAIL_ON_LSA_ERROR(dwError);
-
-        dwError = LwMbsToWc16s(pState->pProviderData->szDomain,
-                               &pwszPrimaryFqdn);
-        BAIL_ON_LSA_ERROR(dwError);
-
-        dwError = LwWc16sToLower(pwszPrimaryFqdn);
-        BAIL_ON_LSA_ERROR(dwError);
-
-        /* Establish the initial bind to \NETLOGON */
-
-        dwError = AD_SetSystemAccess(
-                      pState,
-                      &pOldToken);
-        BAIL_ON_LSA_ERROR(dwError);
-        bChangedToken = TRUE;
-
-        status = LwIoGetThreadCreds(&pCreds);
-        dwError = LwNtStatusToErrno(status);
-        BAIL_ON_LSA_ERROR(dwError);
-
-        status = NetrInitBindingDefault(&netr_b, pwszDomainController, pCreds);
-        if (status != 0)
-        {
-            LSA_LOG_DEBUG("Failed to bind to %s (error %u)",
-                          pszDomainController, status);
-            dwError = LW_ERROR_RPC_NETLOGON_FAILED;
-            bIsNetworkError = TRUE;
-            BAIL_ON_LSA_ERROR(dwError);
-        }
-
-        /* Now setup the Schannel session */
-
-        nt_status = NetrOpenSchannel(netr_b,
-                                     pMachinePasswordInfo->Account.SamAccountName,
-                                     pwszDomainController,
-                                     pwszServerName,
-                                     pwszPrimaryShortDomain,
-                                     pwszPrimaryFqdn,
-                                     pwszComputer,
-                                     pMachinePasswordInfo->Password,
-                                     &pSchannelState->SchannelCreds,
-                                     &pSchannelState->hSchannelBinding);
-
-        if (nt_status != STATUS_SUCCESS)
-        {
-            LSA_LOG_DEBUG("NetrOpenSchannel() failed with %u (0x%08x)", nt_status, nt_status);
-
-            if (AD_NtStatusIsTgtRevokedError(nt_status))
-            {
-                bIsNetworkError = TRUE;
-                dwError = LW_ERROR_KRB5KDC_ERR_TGT_REVOKED;
-            }
-            else if (nt_status == STATUS_NO_TRUST_SAM_ACCOUNT)
-            {
-                bIsNetworkError = TRUE;
-                dwError = ERROR_NO_TRUST_SAM_ACCOUNT;
-            }
-            else
-            {
-                bResetSchannel = TRUE;
-                dwError = LW_ERROR_RPC_ERROR;
-                if (AD_NtStatusIsConnectionError(nt_status))
-                {
-                    bIsNetworkError = TRUE;
-                }
-            }
-        }
-        BAIL_ON_LSA_ERROR(dwError);
-
-        if (!pSchannelState->pszSchannelServer)
-        {
-            dwError = LwAllocateString(
-                          pszDomainController,
-                          &pSchannelState->pszSchannelServer);
-            BAIL_ON_LSA_ERROR(dwError);
-        }
+    OpenContext.pState = pState;
+    OpenContext.pMachinePasswordInfo = pMachinePasswordInfo;
+    OpenContext.pwszComputer = pwszComputer;
+    OpenContext.pwszServerName = pwszServerName;
 
-        pSchannelState->pSchannelCreds = &pSchannelState->SchannelCreds;
-    }
+    dwError = AD_NetLockSchannelSlot(
+                  pSlot,
+                  AD_NetOpenSchannelInLock,
+                  &OpenContext,
+                  &dwGeneration,
+                  &bIsNetworkError);
+    BAIL_ON_LSA_ERROR(dwError);
+    bInLock = TRUE;
 
     /* Time to do the authentication */
 
@@ -1833,7 +2239,8 @@ AD_NetlogonAuthenticationUserEx(
         NTRespLen = LsaDataBlobLength(pUserParams->pass.chap.pNT_resp);
     }
 
-    nt_status = NetrSamLogonNetworkEx(pSchannelState->hSchannelBinding,
+    ullStartTime = LsaSrvGetMetricTimestamp();
+    nt_status = NetrSamLogonNetworkEx(pSlot->hSchannelBinding,
                                       pwszServerName,
                                       pwszShortDomain,
                                       pwszComputer,
@@ -1847,6 +2254,11 @@ AD_NetlogonAuthenticationUserEx(
                                       3,  /* Return NetSamInfo3 */
                                       &pValidationInfo,
                                       &dwAuthoritative);
+    LsaSrvRecordDcCallLatency(
+        LsaMetricDcCallRpc,
+        pSlot->pszTarget,
+        ullStartTime,
+        nt_status);
 
     if (nt_status)
     {
@@ -1906,8 +2318,9 @@ AD_NetlogonAuthenticationUserEx(
     default:
         bResetSchannel = TRUE;
         dwError = LW_ERROR_RPC_NETLOGON_FAILED;
-        LSA_LOG_ERROR("Resetting schannel due to status 0x%08x while "
+        LSA_LOG_ERROR("Resetting schannel to '%s' due to status 0x%08x while "
                       "authenticating user '%s\\%s'",
+                      pSlot->pszTarget,
                       nt_status,
                       pUserParams->pszDomain, pUserParams->pszAccountName);
         break;
@@ -1921,30 +2334,15 @@ AD_NetlogonAuthenticationUserEx(
     dwError = LwAllocateMemory(sizeof(LSA_AUTH_USER_INFO), (PVOID*)&pUserInfo);
     BAIL_ON_LSA_ERROR(dwError);
 
-    dwError = LsaCopyNetrUserInfo3(pSchannelState, pUserInfo, pValidationInfo);
+    dwError = LsaCopyNetrUserInfo3(pSlot, pUserInfo, pValidationInfo);
     BAIL_ON_LSA_ERROR(dwError);
 
 cleanup:
 
-    LsaPcacheReleaseMachinePasswordInfoW(pMachinePasswordInfo);
-
-    if (netr_b)
-    {
-        NetrFreeBinding(&netr_b);
-        netr_b = NULL;
-    }
-
-    if (bChangedToken)
-    {
-        LwIoSetThreadCreds(pOldToken);
-    }
-    if (pOldToken != NULL)
-    {
-        LwIoDeleteCreds(pOldToken);
-    }
-    if (pCreds != NULL)
+    if (bInLock)
     {
-        LwIoDeleteCreds(pCreds);
+        AD_NetUnlockSchannelSlot(pSlot, bResetSchannel, dwGeneration);
+        bInLock = FALSE;
     }
 
     if (pValidationInfo) {
@@ -1954,21 +2352,11 @@ cleanup:
     LW_SAFE_FREE_MEMORY(pszServerName);
 
     LW_SAFE_FREE_MEMORY(pwszUsername);
-    LW_SAFE_FREE_MEMORY(pwszDomainController);
     LW_SAFE_FREE_MEMORY(pwszServerName);
     LW_SAFE_FREE_MEMORY(pwszShortDomain);
-    LW_SAFE_FREE_MEMORY(pwszPrimaryShortDomain);
-    LW_SAFE_FREE_MEMORY(pwszPrimaryFqdn);
-    LW_SAFE_FREE_MEMORY(pwszComputer);
-
-    pthread_mutex_unlock(pSchannelState->pSchannelLock);
 
     *ppUserInfo = pUserInfo;
-
-    if (pbIsNetworkError)
-    {
-        *pbIsNetworkError = bIsNetworkError;
-    }
+    *pbIsNetworkError = bIsNetworkError;
 
     return dwError;
 
@@ -1976,33 +2364,129 @@ error:
 
     LsaFreeAuthUserInfo(&pUserInfo);
 
-    if (bResetSchannel)
-    {
-        AD_ClearSchannelStateInLock(pSchannelState);
-    }
-
     goto cleanup;
 }
 
-static
-VOID
-AD_ClearSchannelStateInLock(
-    IN PLSA_SCHANNEL_STATE pSchannelState
+DWORD
+AD_NetlogonAuthenticationUserEx(
+    IN PLSA_AD_PROVIDER_STATE pState,
+    IN PSTR pszDomainController,
+    IN PLSA_AUTH_USER_PARAMS pUserParams,
+    OUT PLSA_AUTH_USER_INFO *ppUserInfo,
+    OUT PBOOLEAN pbIsNetworkError
     )
 {
-    if (pSchannelState->hSchannelBinding)
+    DWORD dwError = LW_ERROR_INTERNAL;
+    PLSA_SCHANNEL_STATE pSchannelState = pState->hSchannelState;
+    PLSA_SCHANNEL_SLOT pSlot = NULL;
+    PLSA_SCHANNEL_SLOT pRetrySlot = NULL;
+    PWSTR pwszComputer = NULL;
+    PLSA_MACHINE_PASSWORD_INFO_W pMachinePasswordInfo = NULL;
+    BOOLEAN bIsNetworkError = FALSE;
+    DWORD dwChannelCount = AD_GetNetlogonChannelCount(pState);
+    DWORD dwMaxConcurrentApi = AD_GetNetlogonMaxConcurrentApi(pState);
+    PLSA_AUTH_USER_INFO pUserInfo = NULL;
+
+    /* Grab the machine password and account info */
+
+    dwError = LsaPcacheGetMachinePasswordInfoW(
+                  pState->pPcache,
+                  &pMachinePasswordInfo);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pwszComputer = wc16sdup(pMachinePasswordInfo->Account.SamAccountName);
+    if (!pwszComputer)
+    {
+        dwError = LW_ERROR_OUT_OF_MEMORY;
+    }
+    BAIL_ON_LSA_ERROR(dwError);
+
+    // Remove $ from account name
+    pwszComputer[wc16slen(pwszComputer) - 1] = 0;
+
+    dwError = AD_NetAcquireSchannelSlot(
+                  pSchannelState,
+                  pszDomainController,
+                  dwChannelCount,
+                  dwMaxConcurrentApi,
+                  FALSE,
+                  &pSlot);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = AD_NetSamLogonOnSlot(
+                  pState,
+                  pSlot,
+                  pMachinePasswordInfo,
+                  pwszComputer,
+                  pUserParams,
+                  &pUserInfo,
+                  &bIsNetworkError);
+    if (dwError && bIsNetworkError &&
+        strcasecmp(pSlot->pszTarget, pszDomainController))
+    {
+        /* The overflow DC failed; the caller only knows about its own DC,
+           so retry there rather than report a network error against it */
+        LSA_LOG_VERBOSE("Retrying logon on '%s' after network error on '%s'",
+                        pszDomainController, pSlot->pszTarget);
+
+        dwError = AD_NetAcquireSchannelSlot(
+                      pSchannelState,
+                      pszDomainController,
+                      dwChannelCount,
+                      dwMaxConcurrentApi,
+                      TRUE,
+                      &pRetrySlot);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        if (pRetrySlot)
+        {
+            dwError = AD_NetSamLogonOnSlot(
+                          pState,
+                          pRetrySlot,
+                          pMachinePasswordInfo,
+                          pwszComputer,
+                          pUserParams,
+                          &pUserInfo,
+                          &bIsNetworkError);
+        }
+        else
+        {
+            dwError = LW_ERROR_RPC_NETLOGON_FAILED;
+            bIsNetworkError = FALSE;
+        }
+    }
+    BAIL_ON_LSA_ERROR(dwError);
+
+cleanup:
+
+    if (pRetrySlot)
+    {
+        AD_NetReleaseSchannelSlot(pSchannelState, pRetrySlot);
+    }
+
+    if (pSlot)
     {
-        NetrCloseSchannel(pSchannelState->hSchannelBinding);
+        AD_NetReleaseSchannelSlot(pSchannelState, pSlot);
+    }
+
+    LsaPcacheReleaseMachinePasswordInfoW(pMachinePasswordInfo);
 
-        pSchannelState->hSchannelBinding = NULL;
+    LW_SAFE_FREE_MEMORY(pwszComputer);
 
-        memset(&pSchannelState->SchannelCreds,
-               0,
-               sizeof(pSchannelState->SchannelCreds));
-        pSchannelState->pSchannelCreds = NULL;
+    *ppUserInfo = pUserInfo;
 
-        LW_SAFE_FREE_MEMORY(pSchannelState->pszSchannelServer);
+    if (pbIsNetworkError)
+    {
+        *pbIsNetworkError = bIsNetworkError;
     }
+
+    return dwError;
+
+error:
+
+    LsaFreeAuthUserInfo(&pUserInfo);
+
+    goto cleanup;
 }
 
 static
@@ -62,7 +62,7 @@ typedef struct _LSA_TRANSLATED_NAME_OR_SID {
     LSA_OBJECT_TYPE ObjectType;
 } LSA_TRANSLATED_NAME_OR_SID, *PLSA_TRANSLATED_NAME_OR_SID;
 
-typedef struct _LSA_SCHANNEL_STATE* PLSA_SCHANNEL_STATE;
+typedef struct _LSA_POLICY_POOL* PLSA_POLICY_POOL;
 
 DWORD
 AD_SetSystemAccess(
@@ -71,13 +71,18 @@ AD_SetSystemAccess(
     );
 
 DWORD
-AD_NetCreateSchannelState(
-    OUT PLSA_SCHANNEL_STATE* ppSchannelState
+AD_NetCreatePolicyPool(
+    OUT PLSA_POLICY_POOL* ppPool
     );
 
 VOID
-AD_NetDestroySchannelState(
-    IN PLSA_SCHANNEL_STATE pSchannelState
+AD_NetFlushPolicyPool(
+    IN PLSA_POLICY_POOL pPool
+    );
+
+VOID
+AD_NetDestroyPolicyPool(
+    IN PLSA_POLICY_POOL pPool
     );
 
 DWORD
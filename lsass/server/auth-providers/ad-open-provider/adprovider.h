@@ -91,6 +91,7 @@
 #include "adcachespi.h"
 #include "adcfg.h"
 #include "adldapdef.h"
+#include "schannelpool.h"
 #include "adnetapi.h"
 #include "lsadm.h"
 #include "lsadmengine.h"
@@ -101,6 +102,7 @@
 #include "adldap.h"
 #include "adldap_p.h"
 #include "batch.h"
+#include "batch_coalesce.h"
 #include "unprov.h"
 #include "batch_marshal.h"
 #include "ad_marshal_group.h"
@@ -111,6 +113,8 @@
 #include "cellldap.h"
 #include "defldap.h"
 #include "enumstate.h"
+#include "enumcache.h"
+#include "closurecache.h"
 #include "machinepwd_p.h"
 #include "offline.h"
 #include "online.h"
@@ -107,6 +107,8 @@ typedef struct _LSA_AD_CONFIG {
     } DomainManager;
     BOOLEAN             bMultiTenancyEnabled;
     BOOLEAN             bAddDomainToLocalGroupsEnabled;
+    DWORD               dwNetlogonChannelCount;
+    DWORD               dwNetlogonMaxConcurrentApi;
 } LSA_AD_CONFIG, *PLSA_AD_CONFIG;
 
 struct _LSA_DB_CONNECTION;
@@ -124,6 +126,20 @@ struct _LSA_SCHANNEL_STATE;
 typedef struct _LSA_SCHANNEL_STATE *LSA_SCHANNEL_STATE_HANDLE;
 typedef struct _LSA_SCHANNEL_STATE **PLSA_SCHANNEL_STATE_HANDLE;
 
+struct _LSA_POLICY_POOL;
+typedef struct _LSA_POLICY_POOL *LSA_POLICY_POOL_HANDLE;
+
+struct _AD_ENUM_CACHE;
+typedef struct _AD_ENUM_CACHE *LSA_AD_ENUM_CACHE_HANDLE;
+
+typedef struct _AD_ENUM_SNAPSHOT AD_ENUM_SNAPSHOT, *PAD_ENUM_SNAPSHOT;
+
+struct _AD_CLOSURE_CACHE;
+typedef struct _AD_CLOSURE_CACHE *LSA_AD_CLOSURE_CACHE_HANDLE;
+
+struct _LSA_AD_BATCH_COALESCE;
+typedef struct _LSA_AD_BATCH_COALESCE *LSA_AD_BATCH_COALESCE_HANDLE;
+
 struct _LSA_MACHINEPWD_CACHE;
 typedef struct _LSA_MACHINEPWD_CACHE *LSA_MACHINEPWD_CACHE_HANDLE;
 typedef struct _LSA_MACHINEPWD_CACHE **PLSA_MACHINEPWD_CACHE_HANDLE;
@@ -201,6 +217,18 @@ typedef struct _LSA_AD_PROVIDER_STATE {
 
     LSA_SCHANNEL_STATE_HANDLE hSchannelState;
 
+    LSA_POLICY_POOL_HANDLE hPolicyPool;
+
+    LSA_AD_ENUM_CACHE_HANDLE hEnumCache;
+
+    LSA_AD_CLOSURE_CACHE_HANDLE hClosureCache;
+
+    LSA_AD_BATCH_COALESCE_HANDLE hBatchCoalesce;
+
+    /// Bumped whenever cached users or groups are flushed; see
+    /// LSA_AD_IO_GET_CACHE_GENERATION.
+    LONG lCacheGeneration;
+
     PAD_SMART_CARD_DATA pScData;
 } LSA_AD_PROVIDER_STATE, *PLSA_AD_PROVIDER_STATE;
 
@@ -245,6 +273,11 @@ typedef struct __AD_ENUM_HANDLE
     PSTR* ppszSids;
     DWORD dwSidCount;
     DWORD dwSidIndex;
+    // Set when the enumeration is served from an enumeration snapshot
+    // instead of the directory
+    BOOLEAN bSnapshotChecked;
+    PAD_ENUM_SNAPSHOT pSnapshot;
+    DWORD dwSnapshotIndex;
 
     PAD_PROVIDER_CONTEXT pProviderContext;
 } AD_ENUM_HANDLE, *PAD_ENUM_HANDLE;
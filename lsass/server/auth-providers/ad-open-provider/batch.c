@@ -1357,7 +1357,19 @@ LsaAdBatchFindSingleObject(
         BAIL_ON_LSA_ERROR(dwError);
     }
 
-    if (!LW_IS_NULL_OR_EMPTY_STR(pszQueryTerm))
+    if (pContext->pState->hBatchCoalesce &&
+        LsaAdBatchIsCoalescableQueryType(QueryType))
+    {
+        dwError = LsaAdBatchFindObjectsCoalesced(
+                        pContext,
+                        QueryType,
+                        pszQueryTerm,
+                        pdwId,
+                        &dwCount,
+                        &ppObjects);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+    else if (!LW_IS_NULL_OR_EMPTY_STR(pszQueryTerm))
     {
         dwError = LsaAdBatchFindObjects(
                         pContext,
@@ -0,0 +1,608 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software    2004-2008
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        batch_coalesce.c
+ *
+ * Abstract:
+ *
+ *        Likewise Security and Authentication Subsystem (LSASS)
+ *
+ *        Merging of concurrent single object lookups
+ *
+ *        Lookups by SID, uid or gid queue up per query type and, for
+ *        SIDs, per domain.  Up to LSA_AD_BATCH_COALESCE_MAXIMUM_IN_FLIGHT
+ *        lookups of a queue talk to AD at once; beyond that, one of the
+ *        queued threads resolves the whole queue with a single batch
+ *        lookup and hands each waiter its object.  An idle provider
+ *        therefore adds no latency, a busy one sends one query per
+ *        round trip instead of one per caller, and a slow trusted
+ *        domain only holds up lookups in that domain.
+ *
+ *        When a merged lookup fails, the batch is split in halves and
+ *        each half tried again, so only the keys that keep failing on
+ *        their own get the error.  A domain that is offline fails the
+ *        whole batch at once.  A waiter whose object is not in the
+ *        merged result looks itself up alone, so misses are reported
+ *        exactly as before.
+ *
+ */
+#include "adprovider.h"
+
+#define LSA_AD_BATCH_COALESCE_MAXIMUM_ITEMS 100
+#define LSA_AD_BATCH_COALESCE_MAXIMUM_IN_FLIGHT 2
+
+typedef struct _LSA_AD_BATCH_COALESCE_WAITER
+{
+    LSA_LIST_LINKS Links;
+    PCSTR pszQueryTerm;
+    DWORD dwId;
+    BOOLEAN bDone;
+    BOOLEAN bRetry;
+    DWORD dwError;
+    DWORD dwObjectsCount;
+    PLSA_SECURITY_OBJECT* ppObjects;
+} LSA_AD_BATCH_COALESCE_WAITER, *PLSA_AD_BATCH_COALESCE_WAITER;
+
+typedef struct _LSA_AD_BATCH_COALESCE_QUEUE
+{
+    LSA_LIST_LINKS Links;
+    LSA_AD_BATCH_QUERY_TYPE QueryType;
+    // Domain SID for lookups by SID, NULL for uid and gid
+    PSTR pszDomainSid;
+    // Threads waiting on this queue; it is freed when the last leaves
+    DWORD dwWaiterCount;
+    DWORD dwInProgressCount;
+    LSA_LIST_LINKS Pending;
+} LSA_AD_BATCH_COALESCE_QUEUE, *PLSA_AD_BATCH_COALESCE_QUEUE;
+
+typedef struct _LSA_AD_BATCH_COALESCE
+{
+    pthread_mutex_t Mutex;
+    pthread_cond_t Condition;
+    LSA_LIST_LINKS Queues;
+} LSA_AD_BATCH_COALESCE, *PLSA_AD_BATCH_COALESCE;
+
+static
+VOID
+LsaAdBatchCoalesceFreeQueue(
+    IN OUT PLSA_AD_BATCH_COALESCE_QUEUE pQueue
+    )
+{
+    LW_SAFE_FREE_STRING(pQueue->pszDomainSid);
+    LwFreeMemory(pQueue);
+}
+
+// Must hold the mutex.  Takes ownership of *ppszDomainSid when it
+// creates the queue.
+static
+DWORD
+LsaAdBatchCoalesceGetQueue(
+    IN PLSA_AD_BATCH_COALESCE pCoalesce,
+    IN LSA_AD_BATCH_QUERY_TYPE QueryType,
+    IN OUT PSTR* ppszDomainSid,
+    OUT PLSA_AD_BATCH_COALESCE_QUEUE* ppQueue
+    )
+{
+    DWORD dwError = 0;
+    PLSA_LIST_LINKS pLinks = NULL;
+    PLSA_AD_BATCH_COALESCE_QUEUE pQueue = NULL;
+
+    for (pLinks = pCoalesce->Queues.Next;
+         pLinks != &pCoalesce->Queues;
+         pLinks = pLinks->Next)
+    {
+        pQueue = LW_STRUCT_FROM_FIELD(pLinks, LSA_AD_BATCH_COALESCE_QUEUE, Links);
+
+        if (pQueue->QueryType == QueryType &&
+            (pQueue->pszDomainSid == *ppszDomainSid ||
+             (pQueue->pszDomainSid && *ppszDomainSid &&
+              !strcasecmp(pQueue->pszDomainSid, *ppszDomainSid))))
+        {
+            goto cleanup;
+        }
+    }
+
+    dwError = LwAllocateMemory(sizeof(*pQueue), OUT_PPVOID(&pQueue));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pQueue->QueryType = QueryType;
+    pQueue->pszDomainSid = *ppszDomainSid;
+    *ppszDomainSid = NULL;
+    LsaListInit(&pQueue->Pending);
+    LsaListInsertBefore(&pCoalesce->Queues, &pQueue->Links);
+
+cleanup:
+
+    *ppQueue = pQueue;
+
+    return dwError;
+
+error:
+
+    pQueue = NULL;
+
+    goto cleanup;
+}
+
+// Lookups by SID are queued per domain: everything up to the last
+// sub-authority.
+static
+DWORD
+LsaAdBatchCoalesceGetDomainSid(
+    IN LSA_AD_BATCH_QUERY_TYPE QueryType,
+    IN OPTIONAL PCSTR pszQueryTerm,
+    OUT PSTR* ppszDomainSid
+    )
+{
+    DWORD dwError = 0;
+    PSTR pszDomainSid = NULL;
+    PSTR pszLastDash = NULL;
+
+    if (QueryType == LSA_AD_BATCH_QUERY_TYPE_BY_SID)
+    {
+        dwError = LwAllocateString(pszQueryTerm, &pszDomainSid);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        pszLastDash = strrchr(pszDomainSid, '-');
+        if (pszLastDash)
+        {
+            *pszLastDash = 0;
+        }
+    }
+
+    *ppszDomainSid = pszDomainSid;
+
+cleanup:
+
+    return dwError;
+
+error:
+
+    *ppszDomainSid = NULL;
+
+    goto cleanup;
+}
+
+DWORD
+LsaAdBatchCreateCoalesceState(
+    OUT LSA_AD_BATCH_COALESCE_HANDLE* phCoalesce
+    )
+{
+    DWORD dwError = 0;
+    PLSA_AD_BATCH_COALESCE pCoalesce = NULL;
+    BOOLEAN bMutexCreated = FALSE;
+
+    dwError = LwAllocateMemory(sizeof(*pCoalesce), OUT_PPVOID(&pCoalesce));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LwMapErrnoToLwError(pthread_mutex_init(&pCoalesce->Mutex, NULL));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    bMutexCreated = TRUE;
+
+    dwError = LwMapErrnoToLwError(pthread_cond_init(&pCoalesce->Condition, NULL));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    LsaListInit(&pCoalesce->Queues);
+
+    *phCoalesce = pCoalesce;
+
+cleanup:
+
+    return dwError;
+
+error:
+
+    if (pCoalesce)
+    {
+        if (bMutexCreated)
+        {
+            pthread_mutex_destroy(&pCoalesce->Mutex);
+        }
+        LwFreeMemory(pCoalesce);
+    }
+    *phCoalesce = NULL;
+
+    goto cleanup;
+}
+
+VOID
+LsaAdBatchDestroyCoalesceState(
+    IN LSA_AD_BATCH_COALESCE_HANDLE hCoalesce
+    )
+{
+    PLSA_AD_BATCH_COALESCE pCoalesce = hCoalesce;
+    PLSA_LIST_LINKS pLinks = NULL;
+
+    if (pCoalesce)
+    {
+        // Queues go away with their last waiter, so this only finds
+        // any if the state is destroyed while lookups are running.
+        while (!LsaListIsEmpty(&pCoalesce->Queues))
+        {
+            pLinks = LsaListRemoveAfter(&pCoalesce->Queues);
+            LsaAdBatchCoalesceFreeQueue(
+                LW_STRUCT_FROM_FIELD(pLinks, LSA_AD_BATCH_COALESCE_QUEUE, Links));
+        }
+
+        pthread_cond_destroy(&pCoalesce->Condition);
+        pthread_mutex_destroy(&pCoalesce->Mutex);
+        LwFreeMemory(pCoalesce);
+    }
+}
+
+BOOLEAN
+LsaAdBatchIsCoalescableQueryType(
+    IN LSA_AD_BATCH_QUERY_TYPE QueryType
+    )
+{
+    // Only keys that identify the returned object exactly, so results
+    // can be matched back to the waiters.
+    switch (QueryType)
+    {
+        case LSA_AD_BATCH_QUERY_TYPE_BY_SID:
+        case LSA_AD_BATCH_QUERY_TYPE_BY_UID:
+        case LSA_AD_BATCH_QUERY_TYPE_BY_GID:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+static
+BOOLEAN
+LsaAdBatchCoalesceIsMatch(
+    IN LSA_AD_BATCH_QUERY_TYPE QueryType,
+    IN PLSA_AD_BATCH_COALESCE_WAITER pWaiter,
+    IN PLSA_SECURITY_OBJECT pObject
+    )
+{
+    switch (QueryType)
+    {
+        case LSA_AD_BATCH_QUERY_TYPE_BY_SID:
+            return (pObject->pszObjectSid &&
+                    !strcasecmp(pObject->pszObjectSid, pWaiter->pszQueryTerm));
+        case LSA_AD_BATCH_QUERY_TYPE_BY_UID:
+            return (pObject->enabled &&
+                    pObject->type == LSA_OBJECT_TYPE_USER &&
+                    pObject->userInfo.uid == pWaiter->dwId);
+        case LSA_AD_BATCH_QUERY_TYPE_BY_GID:
+            return (pObject->enabled &&
+                    pObject->type == LSA_OBJECT_TYPE_GROUP &&
+                    pObject->groupInfo.gid == pWaiter->dwId);
+        default:
+            return FALSE;
+    }
+}
+
+static
+DWORD
+LsaAdBatchCoalesceGiveObject(
+    IN OUT PLSA_AD_BATCH_COALESCE_WAITER pWaiter,
+    IN PLSA_SECURITY_OBJECT pObject
+    )
+{
+    DWORD dwError = 0;
+    PLSA_SECURITY_OBJECT* ppObjects = NULL;
+
+    dwError = LwAllocateMemory(sizeof(*ppObjects), OUT_PPVOID(&ppObjects));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = ADCacheDuplicateObject(&ppObjects[0], pObject);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pWaiter->dwError = 0;
+    pWaiter->dwObjectsCount = 1;
+    pWaiter->ppObjects = ppObjects;
+
+cleanup:
+
+    return dwError;
+
+error:
+
+    ADCacheSafeFreeObjectList(1, &ppObjects);
+
+    goto cleanup;
+}
+
+// Resolves every waiter in ppWaiters.  Called without the lock held;
+// the waiters stay blocked until the caller marks them done.
+static
+VOID
+LsaAdBatchCoalesceRun(
+    IN PAD_PROVIDER_CONTEXT pContext,
+    IN LSA_AD_BATCH_QUERY_TYPE QueryType,
+    IN PLSA_AD_BATCH_COALESCE_WAITER* ppWaiters,
+    IN DWORD dwCount
+    )
+{
+    DWORD dwError = 0;
+    PSTR* ppszQueryList = NULL;
+    PDWORD pdwIdList = NULL;
+    DWORD dwObjectsCount = 0;
+    PLSA_SECURITY_OBJECT* ppObjects = NULL;
+    PLSA_AD_BATCH_COALESCE_WAITER pWaiter = NULL;
+    DWORD i = 0;
+    DWORD j = 0;
+
+    if (QueryType == LSA_AD_BATCH_QUERY_TYPE_BY_SID)
+    {
+        dwError = LwAllocateMemory(
+                        sizeof(*ppszQueryList) * dwCount,
+                        OUT_PPVOID(&ppszQueryList));
+    }
+    else
+    {
+        dwError = LwAllocateMemory(
+                        sizeof(*pdwIdList) * dwCount,
+                        OUT_PPVOID(&pdwIdList));
+    }
+    if (dwError)
+    {
+        for (i = 0; i < dwCount; i++)
+        {
+            ppWaiters[i]->bRetry = TRUE;
+        }
+        goto cleanup;
+    }
+
+    for (i = 0; i < dwCount; i++)
+    {
+        if (ppszQueryList)
+        {
+            ppszQueryList[i] = (PSTR) ppWaiters[i]->pszQueryTerm;
+        }
+        else
+        {
+            pdwIdList[i] = ppWaiters[i]->dwId;
+        }
+    }
+
+    dwError = LsaAdBatchFindObjects(
+                    pContext,
+                    QueryType,
+                    dwCount,
+                    ppszQueryList,
+                    pdwIdList,
+                    &dwObjectsCount,
+                    &ppObjects);
+
+    if (dwCount == 1)
+    {
+        // Nothing was merged, so this is the waiter's own answer.
+        pWaiter = ppWaiters[0];
+        pWaiter->dwError = dwError;
+        pWaiter->dwObjectsCount = dwObjectsCount;
+        pWaiter->ppObjects = ppObjects;
+        dwObjectsCount = 0;
+        ppObjects = NULL;
+        goto cleanup;
+    }
+
+    if (dwError == LW_ERROR_DOMAIN_IS_OFFLINE &&
+        QueryType == LSA_AD_BATCH_QUERY_TYPE_BY_SID)
+    {
+        // Every SID here is in the one domain, so each would get the
+        // same answer on its own.
+        for (i = 0; i < dwCount; i++)
+        {
+            ppWaiters[i]->dwError = dwError;
+        }
+        goto cleanup;
+    }
+    else if (dwError)
+    {
+        LSA_LOG_VERBOSE("Merged lookup of %u objects failed (error = %u), "
+                        "splitting it", dwCount, dwError);
+
+        LW_SAFE_FREE_MEMORY(ppszQueryList);
+        LW_SAFE_FREE_MEMORY(pdwIdList);
+
+        LsaAdBatchCoalesceRun(pContext, QueryType, ppWaiters, dwCount / 2);
+        LsaAdBatchCoalesceRun(
+            pContext,
+            QueryType,
+            ppWaiters + dwCount / 2,
+            dwCount - dwCount / 2);
+        goto cleanup;
+    }
+
+    LSA_LOG_VERBOSE("Resolved %u merged single object lookups with one batch",
+                    dwCount);
+
+    for (i = 0; i < dwCount; i++)
+    {
+        pWaiter = ppWaiters[i];
+
+        for (j = 0; j < dwObjectsCount; j++)
+        {
+            if (ppObjects[j] &&
+                LsaAdBatchCoalesceIsMatch(QueryType, pWaiter, ppObjects[j]))
+            {
+                break;
+            }
+        }
+
+        if (j == dwObjectsCount ||
+            LsaAdBatchCoalesceGiveObject(pWaiter, ppObjects[j]))
+        {
+            pWaiter->bRetry = TRUE;
+        }
+    }
+
+cleanup:
+
+    LW_SAFE_FREE_MEMORY(ppszQueryList);
+    LW_SAFE_FREE_MEMORY(pdwIdList);
+    ADCacheSafeFreeObjectList(dwObjectsCount, &ppObjects);
+}
+
+DWORD
+LsaAdBatchFindObjectsCoalesced(
+    IN PAD_PROVIDER_CONTEXT pContext,
+    IN LSA_AD_BATCH_QUERY_TYPE QueryType,
+    IN OPTIONAL PCSTR pszQueryTerm,
+    IN OPTIONAL PDWORD pdwId,
+    OUT PDWORD pdwObjectsCount,
+    OUT PLSA_SECURITY_OBJECT** pppObjects
+    )
+{
+    DWORD dwError = 0;
+    PLSA_AD_BATCH_COALESCE pCoalesce = pContext->pState->hBatchCoalesce;
+    PLSA_AD_BATCH_COALESCE_QUEUE pQueue = NULL;
+    PSTR pszDomainSid = NULL;
+    LSA_AD_BATCH_COALESCE_WAITER waiter = { { 0 } };
+    PLSA_AD_BATCH_COALESCE_WAITER batch[LSA_AD_BATCH_COALESCE_MAXIMUM_ITEMS];
+    PLSA_LIST_LINKS pLinks = NULL;
+    BOOLEAN bInLock = FALSE;
+    DWORD dwCount = 0;
+    DWORD i = 0;
+
+    if (!LsaAdBatchIsCoalescableQueryType(QueryType) ||
+        !LSA_IS_XOR(!LW_IS_NULL_OR_EMPTY_STR(pszQueryTerm), pdwId))
+    {
+        LSA_ASSERT(FALSE);
+        dwError = LW_ERROR_INVALID_PARAMETER;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    waiter.pszQueryTerm = pszQueryTerm;
+    waiter.dwId = pdwId ? *pdwId : 0;
+
+    dwError = LsaAdBatchCoalesceGetDomainSid(QueryType, pszQueryTerm, &pszDomainSid);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pthread_mutex_lock(&pCoalesce->Mutex);
+    bInLock = TRUE;
+
+    dwError = LsaAdBatchCoalesceGetQueue(pCoalesce, QueryType, &pszDomainSid, &pQueue);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pQueue->dwWaiterCount++;
+    LsaListInsertBefore(&pQueue->Pending, &waiter.Links);
+
+    while (!waiter.bDone)
+    {
+        // Once another thread has taken this waiter, wait for it.
+        if (LsaListIsEmpty(&pQueue->Pending) ||
+            pQueue->dwInProgressCount >= LSA_AD_BATCH_COALESCE_MAXIMUM_IN_FLIGHT)
+        {
+            pthread_cond_wait(&pCoalesce->Condition, &pCoalesce->Mutex);
+            continue;
+        }
+
+        // Take the oldest waiters, which may or may not include this
+        // one, and resolve them together.
+        pQueue->dwInProgressCount++;
+
+        dwCount = 0;
+        while (!LsaListIsEmpty(&pQueue->Pending) &&
+               dwCount < LSA_AD_BATCH_COALESCE_MAXIMUM_ITEMS)
+        {
+            pLinks = LsaListRemoveAfter(&pQueue->Pending);
+            batch[dwCount++] = LW_STRUCT_FROM_FIELD(
+                                    pLinks,
+                                    LSA_AD_BATCH_COALESCE_WAITER,
+                                    Links);
+        }
+
+        pthread_mutex_unlock(&pCoalesce->Mutex);
+
+        LsaAdBatchCoalesceRun(pContext, QueryType, batch, dwCount);
+
+        pthread_mutex_lock(&pCoalesce->Mutex);
+
+        // The waiters live on their threads' stacks, so they must not
+        // be touched once released.
+        for (i = 0; i < dwCount; i++)
+        {
+            batch[i]->bDone = TRUE;
+        }
+
+        pQueue->dwInProgressCount--;
+        pthread_cond_broadcast(&pCoalesce->Condition);
+    }
+
+    if (--pQueue->dwWaiterCount == 0)
+    {
+        LsaListRemove(&pQueue->Links);
+        LsaAdBatchCoalesceFreeQueue(pQueue);
+    }
+
+    pthread_mutex_unlock(&pCoalesce->Mutex);
+    bInLock = FALSE;
+
+    if (waiter.bRetry)
+    {
+        dwError = LsaAdBatchFindObjects(
+                        pContext,
+                        QueryType,
+                        1,
+                        pszQueryTerm ? (PSTR*)&pszQueryTerm : NULL,
+                        pdwId,
+                        pdwObjectsCount,
+                        pppObjects);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+    else
+    {
+        dwError = waiter.dwError;
+        BAIL_ON_LSA_ERROR(dwError);
+
+        *pdwObjectsCount = waiter.dwObjectsCount;
+        *pppObjects = waiter.ppObjects;
+        waiter.ppObjects = NULL;
+    }
+
+cleanup:
+
+    if (bInLock)
+    {
+        pthread_mutex_unlock(&pCoalesce->Mutex);
+    }
+
+    LW_SAFE_FREE_STRING(pszDomainSid);
+
+    return dwError;
+
+error:
+
+    ADCacheSafeFreeObjectList(waiter.dwObjectsCount, &waiter.ppObjects);
+    *pdwObjectsCount = 0;
+    *pppObjects = NULL;
+
+    goto cleanup;
+}
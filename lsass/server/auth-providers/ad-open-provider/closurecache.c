@@ -0,0 +1,505 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software    2004-2008
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        closurecache.c
+ *
+ * Abstract:
+ *
+ *        Likewise Security and Authentication Subsystem (LSASS)
+ *
+ *        Cache of flattened (transitive) group memberships
+ *
+ *        Building an access token walks every nested membership edge of
+ *        the user in the cache.  The flattened set of group SIDs is kept
+ *        here per user SID.  Whenever the memberships of a SID are stored
+ *        again, every cached set that SID took part in is dropped, so the
+ *        rest stay usable until their underlying cache entries expire.
+ *
+ */
+#include "adprovider.h"
+
+typedef struct _AD_CLOSURE
+{
+    // "<nss>:<sid>"; pszSid points into it
+    PSTR pszKey;
+    PCSTR pszSid;
+    time_t tExpire;
+    DWORD dwSidCount;
+    // Sorted with strcasecmp
+    PSTR* ppszSids;
+} AD_CLOSURE, *PAD_CLOSURE;
+
+typedef struct _AD_CLOSURE_CACHE
+{
+    pthread_mutex_t Mutex;
+    PLW_HASH_TABLE pClosures;
+    // Bumped on every invalidation so that a closure computed while the
+    // memberships it was built from changed is never stored.
+    DWORD dwGeneration;
+} AD_CLOSURE_CACHE, *PAD_CLOSURE_CACHE;
+
+static
+VOID
+AD_FreeClosure(
+    IN PAD_CLOSURE pClosure
+    )
+{
+    if (pClosure)
+    {
+        if (pClosure->ppszSids)
+        {
+            LwFreeStringArray(pClosure->ppszSids, pClosure->dwSidCount);
+        }
+        LW_SAFE_FREE_STRING(pClosure->pszKey);
+        LwFreeMemory(pClosure);
+    }
+}
+
+static
+VOID
+AD_FreeClosureHashEntry(
+    IN const LW_HASH_ENTRY* pEntry
+    )
+{
+    AD_FreeClosure((PAD_CLOSURE) pEntry->pValue);
+}
+
+static
+int
+AD_CompareClosureSids(
+    const void* pLeft,
+    const void* pRight
+    )
+{
+    return strcasecmp(*(PCSTR*) pLeft, *(PCSTR*) pRight);
+}
+
+static
+DWORD
+AD_BuildClosureKey(
+    IN PCSTR pszSid,
+    IN LSA_FIND_FLAGS FindFlags,
+    OUT PSTR* ppszKey
+    )
+{
+    // Cache-only NSS lookups may see fewer memberships
+    return LwAllocateStringPrintf(
+                ppszKey,
+                "%d:%s",
+                (FindFlags & LSA_FIND_FLAGS_NSS) ? 1 : 0,
+                pszSid);
+}
+
+DWORD
+AD_CreateClosureCache(
+    OUT LSA_AD_CLOSURE_CACHE_HANDLE* phClosureCache
+    )
+{
+    DWORD dwError = 0;
+    PAD_CLOSURE_CACHE pCache = NULL;
+
+    dwError = LwAllocateMemory(sizeof(*pCache), OUT_PPVOID(&pCache));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LwHashCreate(
+                    AD_CLOSURE_CACHE_TABLE_SIZE,
+                    LwHashCaselessStringCompare,
+                    LwHashCaselessStringHash,
+                    AD_FreeClosureHashEntry,
+                    NULL,
+                    &pCache->pClosures);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LwMapErrnoToLwError(pthread_mutex_init(&pCache->Mutex, NULL));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    *phClosureCache = pCache;
+
+cleanup:
+
+    return dwError;
+
+error:
+
+    if (pCache)
+    {
+        LwHashSafeFree(&pCache->pClosures);
+        LwFreeMemory(pCache);
+    }
+    *phClosureCache = NULL;
+
+    goto cleanup;
+}
+
+VOID
+AD_FlushClosureCache(
+    IN LSA_AD_CLOSURE_CACHE_HANDLE hClosureCache
+    )
+{
+    PAD_CLOSURE_CACHE pCache = hClosureCache;
+
+    pthread_mutex_lock(&pCache->Mutex);
+
+    pCache->dwGeneration++;
+    LwHashRemoveAll(pCache->pClosures);
+
+    pthread_mutex_unlock(&pCache->Mutex);
+}
+
+VOID
+AD_DestroyClosureCache(
+    IN LSA_AD_CLOSURE_CACHE_HANDLE hClosureCache
+    )
+{
+    PAD_CLOSURE_CACHE pCache = hClosureCache;
+
+    if (pCache)
+    {
+        LwHashSafeFree(&pCache->pClosures);
+        pthread_mutex_destroy(&pCache->Mutex);
+        LwFreeMemory(pCache);
+    }
+}
+
+DWORD
+AD_MergeCachedClosure(
+    IN LSA_AD_CLOSURE_CACHE_HANDLE hClosureCache,
+    IN PCSTR pszSid,
+    IN LSA_FIND_FLAGS FindFlags,
+    IN OUT PLW_HASH_TABLE pGroupHash,
+    OUT PDWORD pdwGeneration
+    )
+{
+    DWORD dwError = 0;
+    PAD_CLOSURE_CACHE pCache = hClosureCache;
+    PSTR pszKey = NULL;
+    PAD_CLOSURE pClosure = NULL;
+    PSTR pszGroupSid = NULL;
+    DWORD dwIndex = 0;
+    time_t now = 0;
+    BOOLEAN bInLock = FALSE;
+
+    dwError = AD_BuildClosureKey(pszSid, FindFlags, &pszKey);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LsaGetCurrentTimeSeconds(&now);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pthread_mutex_lock(&pCache->Mutex);
+    bInLock = TRUE;
+
+    *pdwGeneration = pCache->dwGeneration;
+
+    dwError = LwHashGetValue(pCache->pClosures, pszKey, OUT_PPVOID(&pClosure));
+    if (dwError == ERROR_NOT_FOUND)
+    {
+        goto cleanup;
+    }
+    BAIL_ON_LSA_ERROR(dwError);
+
+    if (pClosure->tExpire <= now)
+    {
+        LwHashRemoveKey(pCache->pClosures, pszKey);
+        dwError = ERROR_NOT_FOUND;
+        goto cleanup;
+    }
+
+    for (dwIndex = 0; dwIndex < pClosure->dwSidCount; dwIndex++)
+    {
+        if (LwHashExists(pGroupHash, pClosure->ppszSids[dwIndex]))
+        {
+            continue;
+        }
+
+        dwError = LwAllocateString(pClosure->ppszSids[dwIndex], &pszGroupSid);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        dwError = LwHashSetValue(pGroupHash, pszGroupSid, pszGroupSid);
+        BAIL_ON_LSA_ERROR(dwError);
+        pszGroupSid = NULL;
+    }
+
+cleanup:
+
+    if (bInLock)
+    {
+        pthread_mutex_unlock(&pCache->Mutex);
+    }
+
+    LW_SAFE_FREE_STRING(pszKey);
+    LW_SAFE_FREE_STRING(pszGroupSid);
+
+    return dwError;
+
+error:
+
+    goto cleanup;
+}
+
+static
+BOOLEAN
+AD_ClosureExpired(
+    IN const LW_HASH_ENTRY* pEntry,
+    IN PVOID pNow
+    )
+{
+    return ((PAD_CLOSURE) pEntry->pValue)->tExpire <= *(time_t*) pNow;
+}
+
+VOID
+AD_StoreClosure(
+    IN LSA_AD_CLOSURE_CACHE_HANDLE hClosureCache,
+    IN PCSTR pszSid,
+    IN LSA_FIND_FLAGS FindFlags,
+    IN DWORD dwGeneration,
+    IN time_t tExpire,
+    IN PLW_HASH_TABLE pClosureHash
+    )
+{
+    DWORD dwError = 0;
+    PAD_CLOSURE_CACHE pCache = hClosureCache;
+    PAD_CLOSURE pClosure = NULL;
+    LW_HASH_ITERATOR iterator = {0};
+    LW_HASH_ENTRY* pEntry = NULL;
+    DWORD dwIndex = 0;
+    time_t now = 0;
+
+    dwError = LsaGetCurrentTimeSeconds(&now);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    if (tExpire <= now)
+    {
+        goto cleanup;
+    }
+
+    dwError = LwAllocateMemory(sizeof(*pClosure), OUT_PPVOID(&pClosure));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = AD_BuildClosureKey(pszSid, FindFlags, &pClosure->pszKey);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pClosure->pszSid = strchr(pClosure->pszKey, ':') + 1;
+    pClosure->tExpire = tExpire;
+
+    if (LwHashGetKeyCount(pClosureHash))
+    {
+        dwError = LwAllocateMemory(
+                        sizeof(*pClosure->ppszSids) * LwHashGetKeyCount(pClosureHash),
+                        OUT_PPVOID(&pClosure->ppszSids));
+        BAIL_ON_LSA_ERROR(dwError);
+
+        dwError = LwHashGetIterator(pClosureHash, &iterator);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        while ((pEntry = LwHashNext(&iterator)) != NULL)
+        {
+            dwError = LwAllocateString(
+                            pEntry->pKey,
+                            &pClosure->ppszSids[dwIndex]);
+            BAIL_ON_LSA_ERROR(dwError);
+
+            pClosure->dwSidCount = ++dwIndex;
+        }
+
+        qsort(pClosure->ppszSids,
+              pClosure->dwSidCount,
+              sizeof(*pClosure->ppszSids),
+              AD_CompareClosureSids);
+    }
+
+    pthread_mutex_lock(&pCache->Mutex);
+
+    if (dwGeneration == pCache->dwGeneration)
+    {
+        if (LwHashGetKeyCount(pCache->pClosures) >= AD_CLOSURE_CACHE_MAX_ENTRIES)
+        {
+            LwHashPrune(
+                pCache->pClosures,
+                AD_ClosureExpired,
+                &now,
+                AD_CLOSURE_CACHE_MAX_ENTRIES);
+        }
+
+        dwError = LwHashSetValue(pCache->pClosures, pClosure->pszKey, pClosure);
+        if (!dwError)
+        {
+            pClosure = NULL;
+        }
+    }
+
+    pthread_mutex_unlock(&pCache->Mutex);
+    BAIL_ON_LSA_ERROR(dwError);
+
+cleanup:
+
+    AD_FreeClosure(pClosure);
+
+    return;
+
+error:
+
+    LSA_LOG_DEBUG("Failed to cache group memberships of %s (error = %u)",
+                  LSA_SAFE_LOG_STRING(pszSid),
+                  dwError);
+
+    goto cleanup;
+}
+
+static
+BOOLEAN
+AD_ClosureIntersects(
+    IN PAD_CLOSURE pClosure,
+    IN DWORD dwSidCount,
+    IN PCSTR* ppszSortedSids
+    )
+{
+    DWORD dwIndex = 0;
+
+    if (bsearch(&pClosure->pszSid,
+                ppszSortedSids,
+                dwSidCount,
+                sizeof(*ppszSortedSids),
+                AD_CompareClosureSids))
+    {
+        return TRUE;
+    }
+
+    // Probe whichever side is smaller into the other
+    if (dwSidCount <= pClosure->dwSidCount)
+    {
+        for (dwIndex = 0; dwIndex < dwSidCount; dwIndex++)
+        {
+            if (bsearch(&ppszSortedSids[dwIndex],
+                        pClosure->ppszSids,
+                        pClosure->dwSidCount,
+                        sizeof(*pClosure->ppszSids),
+                        AD_CompareClosureSids))
+            {
+                return TRUE;
+            }
+        }
+    }
+    else
+    {
+        for (dwIndex = 0; dwIndex < pClosure->dwSidCount; dwIndex++)
+        {
+            if (bsearch(&pClosure->ppszSids[dwIndex],
+                        ppszSortedSids,
+                        dwSidCount,
+                        sizeof(*ppszSortedSids),
+                        AD_CompareClosureSids))
+            {
+                return TRUE;
+            }
+        }
+    }
+
+    return FALSE;
+}
+
+typedef struct _AD_CLOSURE_CHANGED_SIDS
+{
+    DWORD dwSidCount;
+    // Sorted with strcasecmp
+    PCSTR* ppszSortedSids;
+} AD_CLOSURE_CHANGED_SIDS, *PAD_CLOSURE_CHANGED_SIDS;
+
+static
+BOOLEAN
+AD_ClosureStale(
+    IN const LW_HASH_ENTRY* pEntry,
+    IN PVOID pChangedSids
+    )
+{
+    PAD_CLOSURE_CHANGED_SIDS pChanged = pChangedSids;
+
+    // An edge of one of the SIDs changed, so every set reached
+    // through it is stale.
+    return AD_ClosureIntersects(
+                pEntry->pValue,
+                pChanged->dwSidCount,
+                pChanged->ppszSortedSids);
+}
+
+VOID
+AD_InvalidateClosures(
+    IN LSA_AD_CLOSURE_CACHE_HANDLE hClosureCache,
+    IN DWORD dwSidCount,
+    IN PCSTR* ppszSids
+    )
+{
+    DWORD dwError = 0;
+    PAD_CLOSURE_CACHE pCache = hClosureCache;
+    PCSTR* ppszSortedSids = NULL;
+    AD_CLOSURE_CHANGED_SIDS changed = {0};
+
+    if (!pCache || !dwSidCount)
+    {
+        return;
+    }
+
+    dwError = LwAllocateMemory(
+                    sizeof(*ppszSortedSids) * dwSidCount,
+                    OUT_PPVOID(&ppszSortedSids));
+    if (!dwError)
+    {
+        memcpy(ppszSortedSids, ppszSids, sizeof(*ppszSortedSids) * dwSidCount);
+        qsort(ppszSortedSids,
+              dwSidCount,
+              sizeof(*ppszSortedSids),
+              AD_CompareClosureSids);
+    }
+
+    pthread_mutex_lock(&pCache->Mutex);
+
+    pCache->dwGeneration++;
+
+    if (dwError)
+    {
+        LwHashRemoveAll(pCache->pClosures);
+        goto cleanup;
+    }
+
+    changed.dwSidCount = dwSidCount;
+    changed.ppszSortedSids = ppszSortedSids;
+
+    LwHashPrune(pCache->pClosures, AD_ClosureStale, &changed, 0);
+
+cleanup:
+
+    pthread_mutex_unlock(&pCache->Mutex);
+
+    LW_SAFE_FREE_MEMORY(ppszSortedSids);
+}
@@ -0,0 +1,89 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software    2004-2008
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        closurecache.h
+ *
+ * Abstract:
+ *
+ *        Likewise Security and Authentication Subsystem (LSASS)
+ *
+ *        Cache of flattened (transitive) group memberships
+ *
+ */
+#ifndef __CLOSURE_CACHE_H__
+#define __CLOSURE_CACHE_H__
+
+DWORD
+AD_CreateClosureCache(
+    OUT LSA_AD_CLOSURE_CACHE_HANDLE* phClosureCache
+    );
+
+VOID
+AD_FlushClosureCache(
+    IN LSA_AD_CLOSURE_CACHE_HANDLE hClosureCache
+    );
+
+VOID
+AD_DestroyClosureCache(
+    IN LSA_AD_CLOSURE_CACHE_HANDLE hClosureCache
+    );
+
+DWORD
+AD_MergeCachedClosure(
+    IN LSA_AD_CLOSURE_CACHE_HANDLE hClosureCache,
+    IN PCSTR pszSid,
+    IN LSA_FIND_FLAGS FindFlags,
+    IN OUT PLW_HASH_TABLE pGroupHash,
+    OUT PDWORD pdwGeneration
+    );
+
+VOID
+AD_StoreClosure(
+    IN LSA_AD_CLOSURE_CACHE_HANDLE hClosureCache,
+    IN PCSTR pszSid,
+    IN LSA_FIND_FLAGS FindFlags,
+    IN DWORD dwGeneration,
+    IN time_t tExpire,
+    IN PLW_HASH_TABLE pClosureHash
+    );
+
+VOID
+AD_InvalidateClosures(
+    IN LSA_AD_CLOSURE_CACHE_HANDLE hClosureCache,
+    IN DWORD dwSidCount,
+    IN PCSTR* ppszSids
+    );
+
+#endif /* __CLOSURE_CACHE_H__ */
@@ -0,0 +1,571 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software    2004-2008
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        enumcache.c
+ *
+ * Abstract:
+ *
+ *        Likewise Security and Authentication Subsystem (LSASS)
+ *
+ *        Enumeration snapshots of all users and groups
+ *
+ *        Enumerating every user or group (setpwent/getpwent, getent passwd)
+ *        used to page through the directory for each enumeration handle.
+ *        Instead, a background thread walks the directory once and keeps
+ *        the result as a read-only, versioned snapshot. Enumeration handles
+ *        take a reference on the current snapshot and read from it with a
+ *        cursor, so a refresh in the middle of an enumeration does not
+ *        disturb it.
+ *
+ */
+#include "adprovider.h"
+
+struct _AD_ENUM_SNAPSHOT
+{
+    LONG nRefCount;
+    DWORD dwVersion;
+    time_t tCreated;
+    DWORD dwUserCount;
+    PLSA_SECURITY_OBJECT* ppUsers;
+    DWORD dwGroupCount;
+    PLSA_SECURITY_OBJECT* ppGroups;
+};
+
+typedef struct _AD_ENUM_CACHE
+{
+    PLSA_AD_PROVIDER_STATE pState;
+
+    pthread_mutex_t Mutex;
+    // Signalled when a refresh is requested or on shutdown
+    pthread_cond_t RefreshCond;
+    pthread_t Thread;
+    BOOLEAN bThreadStarted;
+
+    BOOLEAN bShutdown;
+    BOOLEAN bRefreshRequested;
+    BOOLEAN bRefreshing;
+    // Bumped by AD_FlushEnumCache so an in-progress refresh is discarded
+    DWORD dwGeneration;
+    DWORD dwLastVersion;
+
+    PAD_ENUM_SNAPSHOT pSnapshot;
+} AD_ENUM_CACHE, *PAD_ENUM_CACHE;
+
+static
+PVOID
+AD_EnumCacheThread(
+    PVOID pData
+    );
+
+DWORD
+AD_CreateEnumCache(
+    IN PLSA_AD_PROVIDER_STATE pState,
+    OUT LSA_AD_ENUM_CACHE_HANDLE* phEnumCache
+    )
+{
+    DWORD dwError = 0;
+    PAD_ENUM_CACHE pCache = NULL;
+
+    dwError = LwAllocateMemory(sizeof(*pCache), OUT_PPVOID(&pCache));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pCache->pState = pState;
+
+    dwError = LwMapErrnoToLwError(pthread_mutex_init(&pCache->Mutex, NULL));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LwMapErrnoToLwError(pthread_cond_init(&pCache->RefreshCond, NULL));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LwMapErrnoToLwError(pthread_create(
+                    &pCache->Thread,
+                    NULL,
+                    AD_EnumCacheThread,
+                    pCache));
+    BAIL_ON_LSA_ERROR(dwError);
+    pCache->bThreadStarted = TRUE;
+
+    *phEnumCache = pCache;
+
+cleanup:
+
+    return dwError;
+
+error:
+
+    AD_DestroyEnumCache(pCache);
+    *phEnumCache = NULL;
+
+    goto cleanup;
+}
+
+VOID
+AD_ReleaseEnumSnapshot(
+    IN PAD_ENUM_SNAPSHOT pSnapshot
+    )
+{
+    if (pSnapshot && InterlockedDecrement(&pSnapshot->nRefCount) == 0)
+    {
+        ADCacheSafeFreeObjectList(pSnapshot->dwUserCount, &pSnapshot->ppUsers);
+        ADCacheSafeFreeObjectList(pSnapshot->dwGroupCount, &pSnapshot->ppGroups);
+        LwFreeMemory(pSnapshot);
+    }
+}
+
+VOID
+AD_FlushEnumCache(
+    IN LSA_AD_ENUM_CACHE_HANDLE hEnumCache
+    )
+{
+    PAD_ENUM_CACHE pCache = hEnumCache;
+    PAD_ENUM_SNAPSHOT pOldSnapshot = NULL;
+
+    if (pCache)
+    {
+        pthread_mutex_lock(&pCache->Mutex);
+        pCache->dwGeneration++;
+        pOldSnapshot = pCache->pSnapshot;
+        pCache->pSnapshot = NULL;
+        pthread_mutex_unlock(&pCache->Mutex);
+
+        // Handles which are still enumerating keep their own reference
+        AD_ReleaseEnumSnapshot(pOldSnapshot);
+    }
+}
+
+VOID
+AD_DestroyEnumCache(
+    IN LSA_AD_ENUM_CACHE_HANDLE hEnumCache
+    )
+{
+    PAD_ENUM_CACHE pCache = hEnumCache;
+
+    if (pCache)
+    {
+        if (pCache->bThreadStarted)
+        {
+            pthread_mutex_lock(&pCache->Mutex);
+            pCache->bShutdown = TRUE;
+            pthread_cond_signal(&pCache->RefreshCond);
+            pthread_mutex_unlock(&pCache->Mutex);
+
+            pthread_join(pCache->Thread, NULL);
+        }
+
+        AD_ReleaseEnumSnapshot(pCache->pSnapshot);
+
+        pthread_cond_destroy(&pCache->RefreshCond);
+        pthread_mutex_destroy(&pCache->Mutex);
+
+        LwFreeMemory(pCache);
+    }
+}
+
+// Returns a referenced snapshot of all users and groups. A snapshot older
+// than dwMaxAgeSeconds is still returned, but a refresh is started in the
+// background. If there is no snapshot yet, ERROR_NOT_FOUND is returned and
+// the caller should enumerate the directory itself. Callers hold the provider
+// state lock, which the refresh thread also needs, so this never waits for a
+// refresh to finish.
+DWORD
+AD_GetEnumSnapshot(
+    IN LSA_AD_ENUM_CACHE_HANDLE hEnumCache,
+    IN DWORD dwMaxAgeSeconds,
+    OUT PAD_ENUM_SNAPSHOT* ppSnapshot
+    )
+{
+    DWORD dwError = 0;
+    PAD_ENUM_CACHE pCache = hEnumCache;
+    PAD_ENUM_SNAPSHOT pSnapshot = NULL;
+    time_t now = 0;
+
+    dwError = LsaGetCurrentTimeSeconds(&now);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pthread_mutex_lock(&pCache->Mutex);
+
+    if (!pCache->pSnapshot ||
+        now - pCache->pSnapshot->tCreated >= (time_t)dwMaxAgeSeconds ||
+        now < pCache->pSnapshot->tCreated)
+    {
+        if (!pCache->bRefreshing && !pCache->bRefreshRequested)
+        {
+            pCache->bRefreshRequested = TRUE;
+            pthread_cond_signal(&pCache->RefreshCond);
+        }
+    }
+
+    if (pCache->pSnapshot)
+    {
+        pSnapshot = pCache->pSnapshot;
+        InterlockedIncrement(&pSnapshot->nRefCount);
+    }
+
+    pthread_mutex_unlock(&pCache->Mutex);
+
+    if (!pSnapshot)
+    {
+        dwError = ERROR_NOT_FOUND;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    *ppSnapshot = pSnapshot;
+
+cleanup:
+
+    return dwError;
+
+error:
+
+    *ppSnapshot = NULL;
+
+    goto cleanup;
+}
+
+// Copies the next page of objects of the given type out of the snapshot.
+// Returns LW_ERROR_NO_MORE_USERS or LW_ERROR_NO_MORE_GROUPS at the end, like
+// LsaAdBatchEnumObjects.
+DWORD
+AD_EnumSnapshotObjects(
+    IN PAD_ENUM_SNAPSHOT pSnapshot,
+    IN LSA_OBJECT_TYPE ObjectType,
+    IN OUT PDWORD pdwIndex,
+    IN DWORD dwMaxObjectsCount,
+    OUT PDWORD pdwObjectsCount,
+    OUT PLSA_SECURITY_OBJECT** pppObjects
+    )
+{
+    DWORD dwError = 0;
+    DWORD dwCount = 0;
+    PLSA_SECURITY_OBJECT* ppSource = NULL;
+    PLSA_SECURITY_OBJECT* ppObjects = NULL;
+    DWORD dwObjectsCount = 0;
+    DWORD dwIndex = 0;
+
+    switch (ObjectType)
+    {
+        case LSA_OBJECT_TYPE_USER:
+            dwCount = pSnapshot->dwUserCount;
+            ppSource = pSnapshot->ppUsers;
+            break;
+        case LSA_OBJECT_TYPE_GROUP:
+            dwCount = pSnapshot->dwGroupCount;
+            ppSource = pSnapshot->ppGroups;
+            break;
+        default:
+            dwError = LW_ERROR_INVALID_PARAMETER;
+            BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    if (*pdwIndex >= dwCount)
+    {
+        dwError = (ObjectType == LSA_OBJECT_TYPE_USER) ?
+                      LW_ERROR_NO_MORE_USERS : LW_ERROR_NO_MORE_GROUPS;
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    dwObjectsCount = LW_MIN(dwMaxObjectsCount, dwCount - *pdwIndex);
+
+    dwError = LwAllocateMemory(
+                    sizeof(*ppObjects) * dwObjectsCount,
+                    OUT_PPVOID(&ppObjects));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    // The snapshot is shared, so callers get their own copies
+    for (dwIndex = 0; dwIndex < dwObjectsCount; dwIndex++)
+    {
+        dwError = ADCacheDuplicateObject(
+                        &ppObjects[dwIndex],
+                        ppSource[*pdwIndex + dwIndex]);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    *pdwIndex += dwObjectsCount;
+    *pdwObjectsCount = dwObjectsCount;
+    *pppObjects = ppObjects;
+
+cleanup:
+
+    return dwError;
+
+error:
+
+    ADCacheSafeFreeObjectList(dwObjectsCount, &ppObjects);
+    *pdwObjectsCount = 0;
+    *pppObjects = NULL;
+
+    goto cleanup;
+}
+
+static
+BOOLEAN
+AD_EnumCacheIsStale(
+    IN PAD_ENUM_CACHE pCache,
+    IN DWORD dwGeneration
+    )
+{
+    BOOLEAN bStale = FALSE;
+
+    pthread_mutex_lock(&pCache->Mutex);
+    bStale = pCache->bShutdown || pCache->dwGeneration != dwGeneration;
+    pthread_mutex_unlock(&pCache->Mutex);
+
+    return bStale;
+}
+
+static
+DWORD
+AD_EnumCacheWalk(
+    IN PAD_ENUM_CACHE pCache,
+    IN PAD_PROVIDER_CONTEXT pContext,
+    IN DWORD dwGeneration,
+    IN LSA_OBJECT_TYPE ObjectType,
+    IN OUT PDWORD pdwTotalCount,
+    IN OUT PLSA_SECURITY_OBJECT** pppTotalObjects
+    )
+{
+    DWORD dwError = 0;
+    PLSA_AD_PROVIDER_STATE pState = pCache->pState;
+    LW_SEARCH_COOKIE Cookie;
+    DWORD dwObjectsCount = 0;
+    PLSA_SECURITY_OBJECT* ppObjects = NULL;
+    BOOLEAN bLocked = FALSE;
+
+    LwInitCookie(&Cookie);
+
+    for (;;)
+    {
+        // The state lock is only held per page so that a leave or rejoin
+        // does not have to wait for the whole walk
+        if (AD_EnumCacheIsStale(pCache, dwGeneration))
+        {
+            dwError = ERROR_CANCELLED;
+            BAIL_ON_LSA_ERROR(dwError);
+        }
+
+        LsaAdProviderStateAcquireRead(pState);
+        bLocked = TRUE;
+
+        if (pState->joinState != LSA_AD_JOINED)
+        {
+            dwError = LW_ERROR_NOT_HANDLED;
+            BAIL_ON_LSA_ERROR(dwError);
+        }
+
+        dwError = LwKrb5SetThreadDefaultCachePath(
+                      pState->MachineCreds.pszCachePath,
+                      NULL);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        dwError = LsaAdBatchEnumObjects(
+                      pContext,
+                      &Cookie,
+                      ObjectType,
+                      NULL,
+                      AD_ENUM_SNAPSHOT_PAGE_SIZE,
+                      &dwObjectsCount,
+                      &ppObjects);
+        if (dwError == LW_ERROR_NO_MORE_USERS ||
+            dwError == LW_ERROR_NO_MORE_GROUPS)
+        {
+            dwError = 0;
+            break;
+        }
+        BAIL_ON_LSA_ERROR(dwError);
+
+        // Keep the object cache as warm as a directory enumeration would
+        dwError = ADCacheStoreObjectEntries(
+                      pState->hCacheConnection,
+                      dwObjectsCount,
+                      ppObjects);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        LsaAdProviderStateRelease(pState);
+        bLocked = FALSE;
+
+        dwError = LsaAppendAndFreePtrs(
+                      pdwTotalCount,
+                      (PVOID**)pppTotalObjects,
+                      &dwObjectsCount,
+                      (PVOID**)&ppObjects);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+cleanup:
+
+    if (bLocked)
+    {
+        LsaAdProviderStateRelease(pState);
+    }
+    ADCacheSafeFreeObjectList(dwObjectsCount, &ppObjects);
+    LwFreeCookieContents(&Cookie);
+
+    return dwError;
+
+error:
+
+    goto cleanup;
+}
+
+static
+DWORD
+AD_EnumCacheBuild(
+    IN PAD_ENUM_CACHE pCache,
+    IN DWORD dwGeneration,
+    OUT PAD_ENUM_SNAPSHOT* ppSnapshot
+    )
+{
+    DWORD dwError = 0;
+    PAD_PROVIDER_CONTEXT pContext = NULL;
+    PAD_ENUM_SNAPSHOT pSnapshot = NULL;
+
+    dwError = AD_CreateProviderContext(
+                  pCache->pState->pszDomainName,
+                  pCache->pState,
+                  &pContext);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LwAllocateMemory(sizeof(*pSnapshot), OUT_PPVOID(&pSnapshot));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pSnapshot->nRefCount = 1;
+
+    dwError = LsaGetCurrentTimeSeconds(&pSnapshot->tCreated);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = AD_EnumCacheWalk(
+                  pCache,
+                  pContext,
+                  dwGeneration,
+                  LSA_OBJECT_TYPE_USER,
+                  &pSnapshot->dwUserCount,
+                  &pSnapshot->ppUsers);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = AD_EnumCacheWalk(
+                  pCache,
+                  pContext,
+                  dwGeneration,
+                  LSA_OBJECT_TYPE_GROUP,
+                  &pSnapshot->dwGroupCount,
+                  &pSnapshot->ppGroups);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    *ppSnapshot = pSnapshot;
+
+cleanup:
+
+    AD_DereferenceProviderContext(pContext);
+
+    return dwError;
+
+error:
+
+    AD_ReleaseEnumSnapshot(pSnapshot);
+    *ppSnapshot = NULL;
+
+    goto cleanup;
+}
+
+static
+PVOID
+AD_EnumCacheThread(
+    PVOID pData
+    )
+{
+    DWORD dwError = 0;
+    PAD_ENUM_CACHE pCache = pData;
+    PAD_ENUM_SNAPSHOT pSnapshot = NULL;
+    PAD_ENUM_SNAPSHOT pOldSnapshot = NULL;
+    DWORD dwGeneration = 0;
+
+    pthread_mutex_lock(&pCache->Mutex);
+
+    while (!pCache->bShutdown)
+    {
+        if (!pCache->bRefreshRequested)
+        {
+            pthread_cond_wait(&pCache->RefreshCond, &pCache->Mutex);
+            continue;
+        }
+
+        pCache->bRefreshRequested = FALSE;
+        pCache->bRefreshing = TRUE;
+        dwGeneration = pCache->dwGeneration;
+
+        pthread_mutex_unlock(&pCache->Mutex);
+
+        dwError = AD_EnumCacheBuild(pCache, dwGeneration, &pSnapshot);
+
+        pthread_mutex_lock(&pCache->Mutex);
+
+        if (dwError)
+        {
+            LSA_LOG_INFO("Could not build the user and group enumeration snapshot (error %u)",
+                         dwError);
+        }
+        else if (pCache->dwGeneration != dwGeneration)
+        {
+            // Flushed while it was being built
+            pOldSnapshot = pSnapshot;
+        }
+        else
+        {
+            pSnapshot->dwVersion = ++pCache->dwLastVersion;
+            pOldSnapshot = pCache->pSnapshot;
+            pCache->pSnapshot = pSnapshot;
+
+            LSA_LOG_VERBOSE("Enumeration snapshot %u holds %u users and %u groups",
+                            pSnapshot->dwVersion,
+                            pSnapshot->dwUserCount,
+                            pSnapshot->dwGroupCount);
+        }
+        pSnapshot = NULL;
+
+        pCache->bRefreshing = FALSE;
+
+        if (pOldSnapshot)
+        {
+            pthread_mutex_unlock(&pCache->Mutex);
+            AD_ReleaseEnumSnapshot(pOldSnapshot);
+            pOldSnapshot = NULL;
+            pthread_mutex_lock(&pCache->Mutex);
+        }
+    }
+
+    pthread_mutex_unlock(&pCache->Mutex);
+
+    return NULL;
+}
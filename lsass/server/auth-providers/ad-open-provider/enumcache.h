@@ -0,0 +1,86 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software    2004-2008
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        enumcache.h
+ *
+ * Abstract:
+ *
+ *        Likewise Security and Authentication Subsystem (LSASS)
+ *
+ *        Enumeration snapshots of all users and groups
+ *
+ */
+#ifndef __ENUM_CACHE_H__
+#define __ENUM_CACHE_H__
+
+DWORD
+AD_CreateEnumCache(
+    IN PLSA_AD_PROVIDER_STATE pState,
+    OUT LSA_AD_ENUM_CACHE_HANDLE* phEnumCache
+    );
+
+VOID
+AD_FlushEnumCache(
+    IN LSA_AD_ENUM_CACHE_HANDLE hEnumCache
+    );
+
+VOID
+AD_DestroyEnumCache(
+    IN LSA_AD_ENUM_CACHE_HANDLE hEnumCache
+    );
+
+DWORD
+AD_GetEnumSnapshot(
+    IN LSA_AD_ENUM_CACHE_HANDLE hEnumCache,
+    IN DWORD dwMaxAgeSeconds,
+    OUT PAD_ENUM_SNAPSHOT* ppSnapshot
+    );
+
+VOID
+AD_ReleaseEnumSnapshot(
+    IN PAD_ENUM_SNAPSHOT pSnapshot
+    );
+
+DWORD
+AD_EnumSnapshotObjects(
+    IN PAD_ENUM_SNAPSHOT pSnapshot,
+    IN LSA_OBJECT_TYPE ObjectType,
+    IN OUT PDWORD pdwIndex,
+    IN DWORD dwMaxObjectsCount,
+    OUT PDWORD pdwObjectsCount,
+    OUT PLSA_SECURITY_OBJECT** pppObjects
+    );
+
+#endif /* __ENUM_CACHE_H__ */
@@ -3488,10 +3488,12 @@ LsaDmLdapDirectorySearch(
     DWORD dwError = 0;
     HANDLE hDirectory = NULL;
     DWORD dwTry = 0;
+    UINT64 ullStartTime = 0;
 
     while (TRUE)
     {
         hDirectory = LsaDmpGetLdapHandle(pConn);
+        ullStartTime = LsaSrvGetMetricTimestamp();
         dwError = LwLdapDirectorySearch(
                     hDirectory,
                     pszObjectDN,
@@ -3499,6 +3501,11 @@ LsaDmLdapDirectorySearch(
                     pszQuery,
                     ppszAttributeList,
                     ppMessage);
+        LsaSrvRecordDcCallLatency(
+            LsaMetricDcCallLdap,
+            pConn->pszDnsDomainName,
+            ullStartTime,
+            dwError);
         if (LsaDmpLdapIsRetryError(dwError) && dwTry < 3)
         {
             if (dwTry > 0)
@@ -3545,10 +3552,12 @@ LsaDmLdapDirectoryExtendedDNSearch(
     DWORD dwError = 0;
     HANDLE hDirectory = NULL;
     DWORD dwTry = 0;
+    UINT64 ullStartTime = 0;
 
     while (TRUE)
     {
         hDirectory = LsaDmpGetLdapHandle(pConn);
+        ullStartTime = LsaSrvGetMetricTimestamp();
         dwError = LwLdapDirectoryExtendedDNSearch(
                         hDirectory,
                         pszObjectDN,
@@ -3556,6 +3565,11 @@ LsaDmLdapDirectoryExtendedDNSearch(
                         ppszAttributeList,
                         scope,
                         ppMessage);
+        LsaSrvRecordDcCallLatency(
+            LsaMetricDcCallLdap,
+            pConn->pszDnsDomainName,
+            ullStartTime,
+            dwError);
         if (LsaDmpLdapIsRetryError(dwError) && dwTry < 3)
         {
             LSA_LOG_ERROR("Error code %u occurred during attempt %u of a ldap search. Retrying.", dwError, dwTry);
@@ -3602,10 +3616,12 @@ LsaDmLdapDirectoryOnePagedSearch(
     DWORD dwError = 0;
     HANDLE hDirectory = NULL;
     DWORD dwTry = 0;
+    UINT64 ullStartTime = 0;
 
     while (TRUE)
     {
         hDirectory = LsaDmpGetLdapHandle(pConn);
+        ullStartTime = LsaSrvGetMetricTimestamp();
         dwError = LwLdapDirectoryOnePagedSearch(
                         hDirectory,
                         pszObjectDN,
@@ -3615,6 +3631,11 @@ LsaDmLdapDirectoryOnePagedSearch(
                         pCookie,
                         scope,
                         ppMessage);
+        LsaSrvRecordDcCallLatency(
+            LsaMetricDcCallLdap,
+            pConn->pszDnsDomainName,
+            ullStartTime,
+            dwError);
         if (LsaDmpLdapIsRetryError(dwError) && dwTry < 3)
         {
             // When pCookie->pfnFree is null, the cookie has not been used yet,
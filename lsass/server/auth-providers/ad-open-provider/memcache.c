@@ -44,12 +44,14 @@
  */
 
 #include "adprovider.h"
+#include <sys/mman.h>
 
 typedef enum __MemCachePersistTag
 {
     MEM_CACHE_OBJECT,
     MEM_CACHE_MEMBERSHIP,
-    MEM_CACHE_PASSWORD
+    MEM_CACHE_PASSWORD,
+    MEM_CACHE_REMOVE
 } MemCachePersistTag;
 
 static LWMsgTypeSpec gLsaObjectTypeSpec[] =
@@ -159,44 +161,759 @@ static LWMsgTypeSpec gLsaCacheSecurityObjectSpec[] =
     LWMSG_TYPE_END
 };
 
-static LWMsgProtocolSpec gMemCachePersistence[] =
+static LWMsgTypeSpec gMemCacheRemoveRecordSpec[] =
 {
-    LWMSG_MESSAGE(MEM_CACHE_OBJECT, gLsaCacheSecurityObjectSpec),
-    LWMSG_MESSAGE(MEM_CACHE_MEMBERSHIP, gLsaGroupMembershipSpec),
-    LWMSG_MESSAGE(MEM_CACHE_PASSWORD, gLsaPasswordVerifierSpec),
-    LWMSG_PROTOCOL_END
+    LWMSG_STRUCT_BEGIN(MEM_CACHE_REMOVE_RECORD),
+    LWMSG_MEMBER_PSTR(MEM_CACHE_REMOVE_RECORD, pszSid),
+    LWMSG_MEMBER_UINT8(MEM_CACHE_REMOVE_RECORD, bIsParentSid),
+    LWMSG_MEMBER_UINT8(MEM_CACHE_REMOVE_RECORD, bRemoveObject),
+    LWMSG_MEMBER_UINT8(MEM_CACHE_REMOVE_RECORD, bRemoveCompleteness),
+    LWMSG_STRUCT_END,
+    LWMSG_TYPE_END
 };
 
 static
 DWORD
-MemCacheCheckSizeInLock(
+MemCacheCheckSizeInLock(
+    IN PMEM_DB_CONNECTION pConn
+    );
+
+void
+MemCacheFreeGuardian(
+    IN const LW_HASH_ENTRY* pEntry
+    )
+{
+    if (pEntry->pKey)
+    {
+        LwFreeString(pEntry->pKey);
+    }
+    if (pEntry->pValue)
+    {
+        LwFreeMemory(pEntry->pValue);
+    }
+}
+
+void
+MemCacheFreePasswordVerifier(
+    IN const LW_HASH_ENTRY* pEntry
+    )
+{
+    if (pEntry->pValue)
+    {
+        ADCacheFreePasswordVerifier((PLSA_PASSWORD_VERIFIER)pEntry->pValue);
+    }
+}
+
+static
+LWMsgTypeSpec*
+MemCacheGetRecordSpec(
+    IN DWORD dwTag
+    )
+{
+    switch (dwTag)
+    {
+        case MEM_CACHE_OBJECT:
+            return gLsaCacheSecurityObjectSpec;
+        case MEM_CACHE_MEMBERSHIP:
+            return gLsaGroupMembershipSpec;
+        case MEM_CACHE_PASSWORD:
+            return gLsaPasswordVerifierSpec;
+        case MEM_CACHE_REMOVE:
+            return gMemCacheRemoveRecordSpec;
+        default:
+            return NULL;
+    }
+}
+
+static
+VOID
+MemCacheFreeBuffer(
+    IN OUT PMEM_CACHE_BUFFER pBuffer
+    )
+{
+    LW_SAFE_FREE_MEMORY(pBuffer->pData);
+    pBuffer->sLength = 0;
+    pBuffer->sCapacity = 0;
+}
+
+static
+DWORD
+MemCacheAppendBuffer(
+    IN OUT PMEM_CACHE_BUFFER pBuffer,
+    IN const VOID* pData,
+    IN size_t sLength
+    )
+{
+    DWORD dwError = 0;
+    size_t sNewCapacity = 0;
+    PBYTE pNewData = NULL;
+
+    if (pBuffer->sLength + sLength > pBuffer->sCapacity)
+    {
+        sNewCapacity = pBuffer->sCapacity ? pBuffer->sCapacity * 2 : 4096;
+        while (sNewCapacity < pBuffer->sLength + sLength)
+        {
+            sNewCapacity *= 2;
+        }
+        if (sNewCapacity > (DWORD)-1)
+        {
+            dwError = LW_ERROR_OUT_OF_MEMORY;
+            BAIL_ON_LSA_ERROR(dwError);
+        }
+
+        dwError = LwReallocMemory(
+                        pBuffer->pData,
+                        (PVOID*)&pNewData,
+                        (DWORD)sNewCapacity);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        pBuffer->pData = pNewData;
+        pBuffer->sCapacity = sNewCapacity;
+    }
+
+    memcpy(pBuffer->pData + pBuffer->sLength, pData, sLength);
+    pBuffer->sLength += sLength;
+
+error:
+    return dwError;
+}
+
+static
+DWORD
+MemCacheAppendRecord(
+    IN PMEM_DB_CONNECTION pConn,
+    IN OUT PMEM_CACHE_BUFFER pBuffer,
+    IN MemCachePersistTag tag,
+    IN PVOID pData
+    )
+{
+    DWORD dwError = 0;
+    PVOID pMarshalled = NULL;
+    size_t sMarshalled = 0;
+    MEM_CACHE_RECORD_HEADER header = {0};
+    size_t sOldLength = pBuffer->sLength;
+
+    dwError = MAP_LWMSG_ERROR(lwmsg_data_marshal_flat_alloc(
+                    pConn->pDataContext,
+                    MemCacheGetRecordSpec(tag),
+                    pData,
+                    &pMarshalled,
+                    &sMarshalled));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    header.dwTag = tag;
+    header.dwLength = (DWORD)sMarshalled;
+
+    dwError = MemCacheAppendBuffer(pBuffer, &header, sizeof(header));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = MemCacheAppendBuffer(pBuffer, pMarshalled, sMarshalled);
+    BAIL_ON_LSA_ERROR(dwError);
+
+cleanup:
+    LW_SAFE_FREE_MEMORY(pMarshalled);
+    return dwError;
+
+error:
+    // Do not leave a partial record behind
+    pBuffer->sLength = sOldLength;
+    goto cleanup;
+}
+
+// Queues a record describing a change that was just made to the cache. The
+// caller must hold the writer lock.
+static
+VOID
+MemCacheJournalRecord(
+    IN PMEM_DB_CONNECTION pConn,
+    IN MemCachePersistTag tag,
+    IN PVOID pData
+    )
+{
+    DWORD dwError = 0;
+
+    if (pConn->bNeedCompaction)
+    {
+        // The next snapshot will include this change
+        return;
+    }
+
+    dwError = MemCacheAppendRecord(
+                    pConn,
+                    &pConn->journal,
+                    tag,
+                    pData);
+    if (dwError)
+    {
+        LSA_LOG_INFO("Unable to journal an in-memory cache change (error %u). A full backup will be written instead.", dwError);
+        MemCacheFreeBuffer(&pConn->journal);
+        pConn->bNeedCompaction = TRUE;
+    }
+}
+
+static
+VOID
+MemCacheJournalRemove(
+    IN PMEM_DB_CONNECTION pConn,
+    IN PCSTR pszSid,
+    IN BOOLEAN bIsParentSid,
+    IN BOOLEAN bRemoveObject,
+    IN BOOLEAN bRemoveCompleteness
+    )
+{
+    MEM_CACHE_REMOVE_RECORD record = {0};
+
+    record.pszSid = (PSTR)pszSid;
+    record.bIsParentSid = bIsParentSid;
+    record.bRemoveObject = bRemoveObject;
+    record.bRemoveCompleteness = bRemoveCompleteness;
+
+    MemCacheJournalRecord(pConn, MEM_CACHE_REMOVE, &record);
+}
+
+// Applies a record read from the snapshot or journal file. If the cache
+// takes ownership of the record data, *ppData is set to NULL.
+static
+DWORD
+MemCacheReplayRecordInLock(
+    IN PMEM_DB_CONNECTION pConn,
+    IN DWORD dwTag,
+    IN OUT PVOID* ppData
+    )
+{
+    DWORD dwError = 0;
+    PMEM_GROUP_MEMBERSHIP pMemCacheMembership = NULL;
+    // Do not free
+    PLSA_PASSWORD_VERIFIER pFromHash = NULL;
+    // Do not free
+    PLSA_PASSWORD_VERIFIER pVerifier = NULL;
+    // Do not free
+    PMEM_CACHE_REMOVE_RECORD pRemove = NULL;
+
+    switch(dwTag)
+    {
+        case MEM_CACHE_OBJECT:
+            dwError = MemCacheStoreObjectEntryInLock(
+                            pConn,
+                            (PLSA_SECURITY_OBJECT)*ppData);
+            // It is now owned by the global datastructures
+            *ppData = NULL;
+            BAIL_ON_LSA_ERROR(dwError);
+            break;
+        case MEM_CACHE_MEMBERSHIP:
+            dwError = MemCacheDuplicateMembership(
+                            &pMemCacheMembership,
+                            (PLSA_GROUP_MEMBERSHIP)*ppData);
+            BAIL_ON_LSA_ERROR(dwError);
+
+            dwError = MemCacheAddMembership(
+                            pConn,
+                            pMemCacheMembership);
+            BAIL_ON_LSA_ERROR(dwError);
+            pMemCacheMembership = NULL;
+            break;
+        case MEM_CACHE_PASSWORD:
+            pVerifier = (PLSA_PASSWORD_VERIFIER)*ppData;
+
+            dwError = LwHashGetValue(
+                            pConn->pSIDToPasswordVerifier,
+                            pVerifier->pszObjectSid,
+                            (PVOID*)&pFromHash);
+            if (dwError == ERROR_NOT_FOUND)
+            {
+                dwError = 0;
+            }
+            else if (!dwError)
+            {
+                pConn->sCacheSize -= pFromHash->version.dwObjectSize;
+            }
+            BAIL_ON_LSA_ERROR(dwError);
+
+            dwError = LwHashSetValue(
+                            pConn->pSIDToPasswordVerifier,
+                            pVerifier->pszObjectSid,
+                            pVerifier);
+            BAIL_ON_LSA_ERROR(dwError);
+            pConn->sCacheSize += pVerifier->version.dwObjectSize;
+            // It is now owned by the global datastructures
+            *ppData = NULL;
+            break;
+        case MEM_CACHE_REMOVE:
+            pRemove = (PMEM_CACHE_REMOVE_RECORD)*ppData;
+
+            if (pRemove->bRemoveObject)
+            {
+                dwError = MemCacheRemoveObjectByHashKey(
+                                pConn,
+                                pConn->pSIDToSecurityObject,
+                                pRemove->pszSid);
+                BAIL_ON_LSA_ERROR(dwError);
+            }
+
+            MemCacheRemoveMembershipsBySid(
+                pConn,
+                pRemove->pszSid,
+                pRemove->bIsParentSid,
+                pRemove->bRemoveCompleteness);
+            break;
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    MemCacheSafeFreeGroupMembership(&pMemCacheMembership);
+    goto cleanup;
+}
+
+// Replays a snapshot or journal file. The file is mapped rather than read, and
+// records are unmarshalled straight out of the mapping. A journal is skipped
+// unless it belongs to the snapshot generation in *pdwGeneration. A truncated
+// or damaged tail (for instance from a crash during an append) ends the replay
+// without failing it.
+static
+DWORD
+MemCacheReplayFile(
+    IN PMEM_DB_CONNECTION pConn,
+    IN PCSTR pszPath,
+    IN BOOLEAN bIsJournal,
+    IN OUT PDWORD pdwGeneration,
+    OUT PBOOLEAN pbFound
+    )
+{
+    DWORD dwError = 0;
+    int fd = -1;
+    struct stat statbuf = {0};
+    PBYTE pMap = MAP_FAILED;
+    size_t sFileSize = 0;
+    size_t sOffset = 0;
+    MEM_CACHE_FILE_HEADER fileHeader = {0};
+    MEM_CACHE_RECORD_HEADER header = {0};
+    // Do not free
+    LWMsgTypeSpec* pSpec = NULL;
+    PVOID pData = NULL;
+
+    *pbFound = FALSE;
+
+    fd = open(pszPath, O_RDONLY);
+    if (fd < 0)
+    {
+        if (errno == ENOENT)
+        {
+            goto cleanup;
+        }
+        dwError = LwMapErrnoToLwError(errno);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+    *pbFound = TRUE;
+
+    if (fstat(fd, &statbuf) < 0)
+    {
+        dwError = LwMapErrnoToLwError(errno);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+    sFileSize = statbuf.st_size;
+
+    if (sFileSize < sizeof(fileHeader))
+    {
+        LSA_LOG_INFO("The in-memory cache file %s is truncated and will be ignored", pszPath);
+        goto cleanup;
+    }
+
+    pMap = mmap(NULL, sFileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (pMap == MAP_FAILED)
+    {
+        dwError = LwMapErrnoToLwError(errno);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    memcpy(&fileHeader, pMap, sizeof(fileHeader));
+    if (fileHeader.dwMagic != MEM_CACHE_FILE_MAGIC ||
+        fileHeader.dwVersion != MEM_CACHE_FILE_VERSION)
+    {
+        LSA_LOG_INFO("The in-memory cache file %s has an unrecognized format and will be ignored", pszPath);
+        goto cleanup;
+    }
+
+    if (bIsJournal)
+    {
+        if (fileHeader.dwGeneration != *pdwGeneration)
+        {
+            LSA_LOG_INFO("The in-memory cache journal %s does not match the snapshot and will be ignored", pszPath);
+            goto cleanup;
+        }
+    }
+    else
+    {
+        *pdwGeneration = fileHeader.dwGeneration;
+    }
+
+    sOffset = sizeof(fileHeader);
+    while (sOffset < sFileSize)
+    {
+        if (sFileSize - sOffset < sizeof(header))
+        {
+            break;
+        }
+        memcpy(&header, pMap + sOffset, sizeof(header));
+        sOffset += sizeof(header);
+
+        if (header.dwLength > sFileSize - sOffset)
+        {
+            break;
+        }
+
+        pSpec = MemCacheGetRecordSpec(header.dwTag);
+        if (pSpec == NULL ||
+            lwmsg_data_unmarshal_flat(
+                    pConn->pDataContext,
+                    pSpec,
+                    pMap + sOffset,
+                    header.dwLength,
+                    &pData) != LWMSG_STATUS_SUCCESS)
+        {
+            sOffset -= sizeof(header);
+            break;
+        }
+        sOffset += header.dwLength;
+
+        dwError = MemCacheReplayRecordInLock(
+                        pConn,
+                        header.dwTag,
+                        &pData);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        if (pData)
+        {
+            lwmsg_data_free_graph(pConn->pDataContext, pSpec, pData);
+            pData = NULL;
+        }
+    }
+
+    if (sOffset < sFileSize)
+    {
+        LSA_LOG_INFO("Ignoring %lu bytes of damaged data at the end of the in-memory cache file %s",
+                (unsigned long)(sFileSize - sOffset), pszPath);
+    }
+
+cleanup:
+    if (pData)
+    {
+        lwmsg_data_free_graph(pConn->pDataContext, pSpec, pData);
+    }
+    if (pMap != MAP_FAILED)
+    {
+        munmap(pMap, sFileSize);
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static
+DWORD
+MemCacheWriteAll(
+    IN int fd,
+    IN const VOID* pData,
+    IN size_t sLength
+    )
+{
+    DWORD dwError = 0;
+    ssize_t sWritten = 0;
+
+    while (sLength > 0)
+    {
+        sWritten = write(fd, pData, sLength);
+        if (sWritten < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            dwError = LwMapErrnoToLwError(errno);
+            BAIL_ON_LSA_ERROR(dwError);
+        }
+        pData = (const BYTE*)pData + sWritten;
+        sLength -= sWritten;
+    }
+
+error:
+    return dwError;
+}
+
+// Atomically replaces pszPath with a file containing the given records
+static
+DWORD
+MemCacheWriteFile(
+    IN PCSTR pszPath,
+    IN DWORD dwGeneration,
+    IN OPTIONAL PMEM_CACHE_BUFFER pRecords
+    )
+{
+    DWORD dwError = 0;
+    PSTR pszTempFile = NULL;
+    int fd = -1;
+    MEM_CACHE_FILE_HEADER fileHeader = {0};
+
+    dwError = LwAllocateStringPrintf(
+                    &pszTempFile,
+                    "%s.new",
+                    pszPath);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    fd = open(pszTempFile, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        dwError = LwMapErrnoToLwError(errno);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    fileHeader.dwMagic = MEM_CACHE_FILE_MAGIC;
+    fileHeader.dwVersion = MEM_CACHE_FILE_VERSION;
+    fileHeader.dwGeneration = dwGeneration;
+
+    dwError = MemCacheWriteAll(fd, &fileHeader, sizeof(fileHeader));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    if (pRecords && pRecords->sLength)
+    {
+        dwError = MemCacheWriteAll(fd, pRecords->pData, pRecords->sLength);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    if (close(fd) < 0)
+    {
+        fd = -1;
+        dwError = LwMapErrnoToLwError(errno);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+    fd = -1;
+
+    dwError = LsaMoveFile(pszTempFile, pszPath);
+    BAIL_ON_LSA_ERROR(dwError);
+
+cleanup:
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    LW_SAFE_FREE_STRING(pszTempFile);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+// Marshals the whole cache into pSnapshot. The caller must hold at least the
+// reader lock.
+static
+DWORD
+MemCacheSnapshotInLock(
+    IN PMEM_DB_CONNECTION pConn,
+    OUT PMEM_CACHE_BUFFER pSnapshot
+    )
+{
+    DWORD dwError = 0;
+    LW_HASH_ITERATOR iterator = {0};
+    // do not free
+    LW_HASH_ENTRY *pEntry = NULL;
+    // do not free
+    PLSA_LIST_LINKS pGuardian = NULL;
+    // do not free
+    PLSA_LIST_LINKS pMemPos = NULL;
+    // do not free
+    PDLINKEDLIST pPos = NULL;
+
+    pPos = pConn->pObjects;
+    while (pPos)
+    {
+        dwError = MemCacheAppendRecord(
+                        pConn,
+                        pSnapshot,
+                        MEM_CACHE_OBJECT,
+                        pPos->pItem);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        pPos = pPos->pNext;
+    }
+
+    dwError = LwHashGetIterator(
+                    pConn->pParentSIDToMembershipList,
+                    &iterator);
+    BAIL_ON_LSA_ERROR(dwError);
+    while ((pEntry = LwHashNext(&iterator)) != NULL)
+    {
+        pGuardian = (PLSA_LIST_LINKS) pEntry->pValue;
+        pMemPos = pGuardian->Next;
+        while (pMemPos != pGuardian)
+        {
+            dwError = MemCacheAppendRecord(
+                            pConn,
+                            pSnapshot,
+                            MEM_CACHE_MEMBERSHIP,
+                            &(PARENT_NODE_TO_MEMBERSHIP(pMemPos))->membership);
+            BAIL_ON_LSA_ERROR(dwError);
+
+            pMemPos = pMemPos->Next;
+        }
+    }
+
+    dwError = LwHashGetIterator(
+                    pConn->pSIDToPasswordVerifier,
+                    &iterator);
+    BAIL_ON_LSA_ERROR(dwError);
+    while ((pEntry = LwHashNext(&iterator)) != NULL)
+    {
+        dwError = MemCacheAppendRecord(
+                        pConn,
+                        pSnapshot,
+                        MEM_CACHE_PASSWORD,
+                        pEntry->pValue);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+error:
+    return dwError;
+}
+
+// Writes a new snapshot and starts an empty journal for it. The cache is only
+// locked (for reading) while it is marshalled; the files are written after
+// the lock is released. The caller must hold fileMutex.
+static
+DWORD
+MemCacheCompactInFileLock(
     IN PMEM_DB_CONNECTION pConn
-    );
-
-void
-MemCacheFreeGuardian(
-    IN const LW_HASH_ENTRY* pEntry
     )
 {
-    if (pEntry->pKey)
-    {
-        LwFreeString(pEntry->pKey);
-    }
-    if (pEntry->pValue)
+    DWORD dwError = 0;
+    BOOLEAN bInLock = FALSE;
+    MEM_CACHE_BUFFER snapshot = {0};
+    DWORD dwGeneration = pConn->dwGeneration + 1;
+    BOOLEAN bJournalDropped = FALSE;
+
+    ENTER_READER_RW_LOCK(&pConn->lock, bInLock);
+
+    dwError = MemCacheSnapshotInLock(pConn, &snapshot);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    // Writers are excluded and fileMutex is held, so the pending journal may
+    // be dropped here. Everything in it is part of the snapshot.
+    MemCacheFreeBuffer(&pConn->journal);
+    pConn->bNeedCompaction = FALSE;
+    bJournalDropped = TRUE;
+
+    LEAVE_RW_LOCK(&pConn->lock, bInLock);
+
+    pConn->bJournalValid = FALSE;
+
+    dwError = MemCacheWriteFile(
+                    pConn->pszFilename,
+                    dwGeneration,
+                    &snapshot);
+    BAIL_ON_LSA_ERROR(dwError);
+    pConn->dwGeneration = dwGeneration;
+
+    dwError = MemCacheWriteFile(
+                    pConn->pszJournalFilename,
+                    dwGeneration,
+                    NULL);
+    BAIL_ON_LSA_ERROR(dwError);
+    pConn->sJournalSize = sizeof(MEM_CACHE_FILE_HEADER);
+    pConn->bJournalValid = TRUE;
+
+cleanup:
+    LEAVE_RW_LOCK(&pConn->lock, bInLock);
+    MemCacheFreeBuffer(&snapshot);
+    return dwError;
+
+error:
+    if (bJournalDropped)
     {
-        LwFreeMemory(pEntry->pValue);
+        // The dropped changes only exist in memory now
+        LEAVE_RW_LOCK(&pConn->lock, bInLock);
+        ENTER_WRITER_RW_LOCK(&pConn->lock, bInLock);
+        pConn->bNeedCompaction = TRUE;
     }
+    goto cleanup;
 }
 
-void
-MemCacheFreePasswordVerifier(
-    IN const LW_HASH_ENTRY* pEntry
+// Appends pending changes to the journal file, or compacts if the journal
+// cannot be used or has grown too large.
+static
+DWORD
+MemCacheFlushJournal(
+    IN PMEM_DB_CONNECTION pConn
     )
 {
-    if (pEntry->pValue)
+    DWORD dwError = 0;
+    BOOLEAN bFileLocked = FALSE;
+    BOOLEAN bInLock = FALSE;
+    BOOLEAN bCompact = FALSE;
+    MEM_CACHE_BUFFER pending = {0};
+    int fd = -1;
+
+    ENTER_MUTEX(&pConn->fileMutex, bFileLocked);
+
+    ENTER_READER_RW_LOCK(&pConn->lock, bInLock);
+    bCompact = pConn->bNeedCompaction || !pConn->bJournalValid ||
+        pConn->sJournalSize + pConn->journal.sLength > JOURNAL_COMPACT_SIZE;
+    if (!bCompact)
     {
-        ADCacheFreePasswordVerifier((PLSA_PASSWORD_VERIFIER)pEntry->pValue);
+        // Writers are excluded and fileMutex is held, so the pending records
+        // may be detached here
+        pending = pConn->journal;
+        memset(&pConn->journal, 0, sizeof(pConn->journal));
+    }
+    LEAVE_RW_LOCK(&pConn->lock, bInLock);
+
+    if (bCompact)
+    {
+        LSA_LOG_INFO("Compacting the in-memory cache backup");
+        dwError = MemCacheCompactInFileLock(pConn);
+        BAIL_ON_LSA_ERROR(dwError);
+        goto cleanup;
+    }
+
+    if (pending.sLength)
+    {
+        LSA_LOG_DEBUG("Appending %lu bytes to the in-memory cache journal",
+                (unsigned long)pending.sLength);
+
+        fd = open(pConn->pszJournalFilename, O_WRONLY | O_APPEND);
+        if (fd < 0)
+        {
+            dwError = LwMapErrnoToLwError(errno);
+            BAIL_ON_LSA_ERROR(dwError);
+        }
+
+        dwError = MemCacheWriteAll(fd, pending.pData, pending.sLength);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        pConn->sJournalSize += pending.sLength;
+    }
+
+cleanup:
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    MemCacheFreeBuffer(&pending);
+    LEAVE_MUTEX(&pConn->fileMutex, bFileLocked);
+    return dwError;
+
+error:
+    if (pending.sLength)
+    {
+        // The journal file may now end with a partial record, and the
+        // detached records are only in memory. A full snapshot covers both.
+        pConn->bJournalValid = FALSE;
     }
+    goto cleanup;
 }
 
 static
@@ -225,7 +942,6 @@ MemCacheBackupRoutine(
         {
             break;
         }
-        LSA_LOG_INFO("Delayed backup scheduled");
 
         timeout.tv_sec = time(NULL) + pConn->dwBackupDelay;
         timeout.tv_nsec = 0;
@@ -242,11 +958,21 @@ MemCacheBackupRoutine(
             BAIL_ON_LSA_ERROR(dwError);
         }
 
-        LSA_LOG_INFO("Performing backup");
-        dwError = MemCacheStoreFile((LSA_DB_HANDLE)pConn);
-        BAIL_ON_LSA_ERROR(dwError);
-
+        // Changes made from here on schedule another backup
         pConn->bNeedBackup = FALSE;
+
+        // Writers take backupMutex before the cache lock, so it must not be
+        // held while the files are written.
+        LEAVE_MUTEX(&pConn->backupMutex, bMutexLocked);
+
+        dwError = MemCacheFlushJournal(pConn);
+        if (dwError)
+        {
+            LSA_LOG_INFO("Unable to back up the in-memory cache (error %u)", dwError);
+            dwError = 0;
+        }
+
+        ENTER_MUTEX(&pConn->backupMutex, bMutexLocked);
     }
 
 cleanup:
@@ -284,6 +1010,20 @@ MemCacheOpen(
                     &pConn->pszFilename);
     BAIL_ON_LSA_ERROR(dwError);
 
+    dwError = LwAllocateStringPrintf(
+                    &pConn->pszJournalFilename,
+                    "%s.journal",
+                    pszDbPath);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = MAP_LWMSG_ERROR(lwmsg_context_new(NULL, &pConn->pContext));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = MAP_LWMSG_ERROR(lwmsg_data_context_new(
+                    pConn->pContext,
+                    &pConn->pDataContext));
+    BAIL_ON_LSA_ERROR(dwError);
+
     //indexes
     dwError = LwHashCreate(
                     100,
@@ -393,6 +1133,12 @@ MemCacheOpen(
     BAIL_ON_LSA_ERROR(dwError);
     pConn->bBackupMutexCreated = TRUE;
 
+    dwError = LwMapErrnoToLwError(pthread_mutex_init(
+            &pConn->fileMutex,
+            NULL));
+    BAIL_ON_LSA_ERROR(dwError);
+    pConn->bFileMutexCreated = TRUE;
+
     pConn->dwBackupDelay = BACKUP_DELAY;
 
     pConn->bNeedBackup = FALSE;
@@ -435,120 +1181,42 @@ MemCacheLoadFile(
     )
 {
     PMEM_DB_CONNECTION pConn = (PMEM_DB_CONNECTION)hDb;
-    LWMsgArchive* pArchive = NULL;
-    LWMsgProtocol* pArchiveProtocol = NULL;
-    LWMsgStatus status = 0;
     BOOLEAN bInLock = FALSE;
     DWORD dwError = 0;
-    LWMsgMessage message = LWMSG_MESSAGE_INITIALIZER;
-    PMEM_GROUP_MEMBERSHIP pMemCacheMembership = NULL;
     BOOLEAN bMutexLocked = FALSE;
-    PLSA_PASSWORD_VERIFIER pFromHash = NULL;
+    BOOLEAN bFound = FALSE;
 
     ENTER_MUTEX(&pConn->backupMutex, bMutexLocked);
     ENTER_WRITER_RW_LOCK(&pConn->lock, bInLock);
 
-    dwError = MAP_LWMSG_ERROR(lwmsg_protocol_new(
-                    NULL,
-                    &pArchiveProtocol));
-    BAIL_ON_LSA_ERROR(dwError);
-    dwError = MAP_LWMSG_ERROR(lwmsg_protocol_add_protocol_spec(
-                    pArchiveProtocol,
-                    gMemCachePersistence));
-    BAIL_ON_LSA_ERROR(dwError);
-
-    dwError = MAP_LWMSG_ERROR(lwmsg_archive_new(
-                    NULL,
-                    pArchiveProtocol,
-                    &pArchive));
-    BAIL_ON_LSA_ERROR(dwError);
-    dwError = MAP_LWMSG_ERROR(lwmsg_archive_set_file(
-                    pArchive,
+    dwError = MemCacheReplayFile(
+                    pConn,
                     pConn->pszFilename,
-                    0));
+                    FALSE,
+                    &pConn->dwGeneration,
+                    &bFound);
     BAIL_ON_LSA_ERROR(dwError);
 
-    status = lwmsg_archive_open(pArchive, LWMSG_ARCHIVE_READ | LWMSG_ARCHIVE_SCHEMA);
-    if (status == LWMSG_STATUS_FILE_NOT_FOUND)
+    if (!bFound)
     {
         LSA_LOG_INFO("The in-memory cache file does not exist yet");
-        status = 0;
-        goto cleanup;
     }
-    dwError = MAP_LWMSG_ERROR(status);
-    BAIL_ON_LSA_ERROR(dwError);
-
-    while (1)
+    else
     {
-        lwmsg_archive_destroy_message(pArchive, &message);
-        status = lwmsg_archive_read_message(pArchive, &message);
-        if (status == LWMSG_STATUS_EOF)
-        {
-            // There are no more messages in the file
-            status = 0;
-            break;
-        }
-        dwError = MAP_LWMSG_ERROR(status);
+        dwError = MemCacheReplayFile(
+                        pConn,
+                        pConn->pszJournalFilename,
+                        TRUE,
+                        &pConn->dwGeneration,
+                        &bFound);
         BAIL_ON_LSA_ERROR(dwError);
-
-        switch(message.tag)
-        {
-            case MEM_CACHE_OBJECT:
-                dwError = MemCacheStoreObjectEntryInLock(
-                                pConn,
-                                (PLSA_SECURITY_OBJECT)message.data);
-                // It is now owned by the global datastructures
-                message.data = NULL;
-                message.tag = -1;
-                BAIL_ON_LSA_ERROR(dwError);
-                break;
-            case MEM_CACHE_MEMBERSHIP:
-                dwError = MemCacheDuplicateMembership(
-                                &pMemCacheMembership,
-                                (PLSA_GROUP_MEMBERSHIP)message.data);
-                BAIL_ON_LSA_ERROR(dwError);
-
-                dwError = MemCacheAddMembership(
-                                pConn,
-                                pMemCacheMembership);
-                BAIL_ON_LSA_ERROR(dwError);
-                pMemCacheMembership = NULL;
-                break;
-            case MEM_CACHE_PASSWORD:
-                dwError = LwHashGetValue(
-                                pConn->pSIDToPasswordVerifier,
-                                ((PLSA_PASSWORD_VERIFIER)message.data)->pszObjectSid,
-                                (PVOID*)&pFromHash);
-                if (dwError == ERROR_NOT_FOUND)
-                {
-                    dwError = 0;
-                }
-                else if (!dwError)
-                {
-                    pConn->sCacheSize -= pFromHash->version.dwObjectSize;
-                }
-                BAIL_ON_LSA_ERROR(dwError);
-
-                dwError = LwHashSetValue(
-                                pConn->pSIDToPasswordVerifier,
-                                ((PLSA_PASSWORD_VERIFIER)message.data)->pszObjectSid,
-                                message.data);
-                BAIL_ON_LSA_ERROR(dwError);
-                pConn->sCacheSize += ((PLSA_PASSWORD_VERIFIER)message.data)->
-                                        version.dwObjectSize;
-                // It is now owned by the global datastructures
-                message.data = NULL;
-                message.tag = -1;
-                break;
-        }
     }
 
-    dwError = MAP_LWMSG_ERROR(lwmsg_archive_close(pArchive));
-    BAIL_ON_LSA_ERROR(dwError);
-
     dwError = MemCacheMaintainSizeCap(pConn);
     BAIL_ON_LSA_ERROR(dwError);
 
+    // Fold the replayed journal into a new snapshot
+    pConn->bNeedCompaction = TRUE;
     pConn->bNeedBackup = TRUE;
     if (pConn->bSignalBackupCreated)
     {
@@ -559,16 +1227,6 @@ MemCacheLoadFile(
 cleanup:
     LEAVE_RW_LOCK(&pConn->lock, bInLock);
     LEAVE_MUTEX(&pConn->backupMutex, bMutexLocked);
-    if (pArchive)
-    {
-        lwmsg_archive_destroy_message(pArchive, &message);
-        lwmsg_archive_delete(pArchive);
-    }
-
-    if (pArchiveProtocol)
-    {
-        lwmsg_protocol_delete(pArchiveProtocol);
-    }
 
     return dwError;
 
@@ -583,119 +1241,15 @@ MemCacheStoreFile(
 {
     PMEM_DB_CONNECTION pConn = (PMEM_DB_CONNECTION)hDb;
     DWORD dwError = 0;
-    LWMsgArchive* pArchive = NULL;
-    LWMsgProtocol* pArchiveProtocol = NULL;
-    BOOLEAN bInLock = FALSE;
-    LWMsgMessage message = LWMSG_MESSAGE_INITIALIZER;
-    LW_HASH_ITERATOR iterator = {0};
-    // do not free
-    LW_HASH_ENTRY *pEntry = NULL;
-    // do not free
-    PLSA_LIST_LINKS pGuardian = NULL;
-    // do not free
-    PLSA_LIST_LINKS pMemPos = NULL;
-    // do not free
-    PDLINKEDLIST pPos = NULL;
-    PSTR pszTempFile = NULL;
-
-    ENTER_READER_RW_LOCK(&pConn->lock, bInLock);
-
-    dwError = MAP_LWMSG_ERROR(lwmsg_protocol_new(
-                    NULL,
-                    &pArchiveProtocol));
-    BAIL_ON_LSA_ERROR(dwError);
-    dwError = MAP_LWMSG_ERROR(lwmsg_protocol_add_protocol_spec(
-                    pArchiveProtocol,
-                    gMemCachePersistence));
-    BAIL_ON_LSA_ERROR(dwError);
-
-    dwError = LwAllocateStringPrintf(
-                    &pszTempFile,
-                    "%s.new",
-                    pConn->pszFilename);
-    BAIL_ON_LSA_ERROR(dwError);
-    dwError = MAP_LWMSG_ERROR(lwmsg_archive_new(
-                    NULL,
-                    pArchiveProtocol,
-                    &pArchive));
-    BAIL_ON_LSA_ERROR(dwError);
-    dwError = MAP_LWMSG_ERROR(lwmsg_archive_set_file(
-                    pArchive,
-                    pszTempFile,
-                    0600));
-    BAIL_ON_LSA_ERROR(dwError);
-    dwError = MAP_LWMSG_ERROR(lwmsg_archive_open(
-                    pArchive,
-                    LWMSG_ARCHIVE_WRITE | LWMSG_ARCHIVE_SCHEMA));
-    BAIL_ON_LSA_ERROR(dwError);
-
-    message.tag = MEM_CACHE_OBJECT;
-    pPos = pConn->pObjects;
-    while (pPos)
-    {
-        message.data = pPos->pItem;
-        dwError = MAP_LWMSG_ERROR(lwmsg_archive_write_message(
-                        pArchive,
-                        &message));
-        BAIL_ON_LSA_ERROR(dwError);
-
-        pPos = pPos->pNext;
-    }
-
-    message.tag = MEM_CACHE_MEMBERSHIP;
-    dwError = LwHashGetIterator(
-                    pConn->pParentSIDToMembershipList,
-                    &iterator);
-    BAIL_ON_LSA_ERROR(dwError);
-    while ((pEntry = LwHashNext(&iterator)) != NULL)
-    {
-        pGuardian = (PLSA_LIST_LINKS) pEntry->pValue;
-        pMemPos = pGuardian->Next;
-        while (pMemPos != pGuardian)
-        {
-            message.data = PARENT_NODE_TO_MEMBERSHIP(pMemPos);
-            dwError = MAP_LWMSG_ERROR(lwmsg_archive_write_message(
-                            pArchive,
-                            &message));
-            BAIL_ON_LSA_ERROR(dwError);
-
-            pMemPos = pMemPos->Next;
-        }
-    }
-
-    message.tag = MEM_CACHE_PASSWORD;
-    dwError = LwHashGetIterator(
-                    pConn->pSIDToPasswordVerifier,
-                    &iterator);
-    BAIL_ON_LSA_ERROR(dwError);
-    while ((pEntry = LwHashNext(&iterator)) != NULL)
-    {
-        message.data = pEntry->pValue;
-        dwError = MAP_LWMSG_ERROR(lwmsg_archive_write_message(
-                        pArchive,
-                        &message));
-        BAIL_ON_LSA_ERROR(dwError);
-    }
+    BOOLEAN bFileLocked = FALSE;
 
-    dwError = MAP_LWMSG_ERROR(lwmsg_archive_close(pArchive));
-    BAIL_ON_LSA_ERROR(dwError);
+    ENTER_MUTEX(&pConn->fileMutex, bFileLocked);
 
-    dwError = LsaMoveFile(pszTempFile, pConn->pszFilename);
+    dwError = MemCacheCompactInFileLock(pConn);
     BAIL_ON_LSA_ERROR(dwError);
 
 cleanup:
-    LEAVE_RW_LOCK(&pConn->lock, bInLock);
-    if (pArchive)
-    {
-        lwmsg_archive_delete(pArchive);
-    }
-
-    if (pArchiveProtocol)
-    {
-        lwmsg_protocol_delete(pArchiveProtocol);
-    }
-
-    LW_SAFE_FREE_STRING(pszTempFile);
+    LEAVE_MUTEX(&pConn->fileMutex, bFileLocked);
 
     return dwError;
 
@@ -809,6 +1363,17 @@ MemCacheSafeClose(
         LwHashSafeFree(&pConn->pGIDToSecurityObject);
         LwHashSafeFree(&pConn->pGroupAliasToSecurityObject);
         LW_SAFE_FREE_STRING(pConn->pszFilename);
+        LW_SAFE_FREE_STRING(pConn->pszJournalFilename);
+        MemCacheFreeBuffer(&pConn->journal);
+
+        if (pConn->pDataContext)
+        {
+            lwmsg_data_context_delete(pConn->pDataContext);
+        }
+        if (pConn->pContext)
+        {
+            lwmsg_context_delete(pConn->pContext);
+        }
 
         LwHashSafeFree(&pConn->pParentSIDToMembershipList);
         LwHashSafeFree(&pConn->pChildSIDToMembershipList);
@@ -823,6 +1388,11 @@ MemCacheSafeClose(
             dwError = LwMapErrnoToLwError(pthread_mutex_destroy(&pConn->backupMutex));
             LSA_ASSERT(dwError == 0);
         }
+        if (pConn->bFileMutexCreated)
+        {
+            dwError = LwMapErrnoToLwError(pthread_mutex_destroy(&pConn->fileMutex));
+            LSA_ASSERT(dwError == 0);
+        }
         if (pConn->bSignalBackupCreated)
         {
             dwError = LwMapErrnoToLwError(pthread_cond_destroy(&pConn->signalBackup));
@@ -1182,6 +1752,8 @@ MemCacheRemoveUserBySid(
 
     MemCacheRemoveMembershipsBySid(pConn, pszSid, FALSE, TRUE);
 
+    MemCacheJournalRemove(pConn, pszSid, FALSE, TRUE, TRUE);
+
     pConn->bNeedBackup = TRUE;
     dwError = LwMapErrnoToLwError(pthread_cond_signal(&pConn->signalBackup));
     BAIL_ON_LSA_ERROR(dwError);
@@ -1217,6 +1789,8 @@ MemCacheRemoveGroupBySid(
 
     MemCacheRemoveMembershipsBySid(pConn, pszSid, TRUE, TRUE);
 
+    MemCacheJournalRemove(pConn, pszSid, TRUE, TRUE, TRUE);
+
     pConn->bNeedBackup = TRUE;
     dwError = LwMapErrnoToLwError(pthread_cond_signal(&pConn->signalBackup));
     BAIL_ON_LSA_ERROR(dwError);
@@ -1343,6 +1917,10 @@ MemCacheEmptyCache(
 
     if (bMutexLocked)
     {
+        // Nothing that was journaled so far matters anymore
+        MemCacheFreeBuffer(&pConn->journal);
+        pConn->bNeedCompaction = TRUE;
+
         pConn->bNeedBackup = TRUE;
         dwError = LwMapErrnoToLwError(pthread_cond_signal(&pConn->signalBackup));
         BAIL_ON_LSA_ERROR(dwError);
@@ -1765,6 +2343,8 @@ MemCacheStoreObjectEntries(
     // Do not free
     size_t sIndex = 0;
     PLSA_SECURITY_OBJECT pObject = NULL;
+    // Do not free
+    PLSA_SECURITY_OBJECT pStored = NULL;
     PSTR pszKey = NULL;
     time_t now = 0;
     BOOLEAN bMutexLocked = FALSE;
@@ -1836,8 +2416,11 @@ MemCacheStoreObjectEntries(
                         pConn,
                         pObject);
         // It is now owned by the hash table
+        pStored = pObject;
         pObject = NULL;
         BAIL_ON_LSA_ERROR(dwError);
+
+        MemCacheJournalRecord(pConn, MEM_CACHE_OBJECT, pStored);
     }
 
     dwError = MemCacheMaintainSizeCap(pConn);
@@ -3130,6 +3713,8 @@ MemCacheStoreGroupMembership(
         TRUE,
         FALSE);
 
+    MemCacheJournalRemove(pConn, pszParentSid, TRUE, FALSE, FALSE);
+
     // Copy the combined list into the parent and child hashes
     dwError = LwHashGetIterator(
                     pCombined,
@@ -3143,6 +3728,11 @@ MemCacheStoreGroupMembership(
                     (PMEM_GROUP_MEMBERSHIP)pEntry->pValue);
         BAIL_ON_LSA_ERROR(dwError);
 
+        MemCacheJournalRecord(
+            pConn,
+            MEM_CACHE_MEMBERSHIP,
+            &((PMEM_GROUP_MEMBERSHIP)pEntry->pValue)->membership);
+
         pEntry->pValue = NULL;
     }
 
@@ -3304,6 +3894,8 @@ MemCacheStoreGroupsForUser(
         FALSE,
         FALSE);
 
+    MemCacheJournalRemove(pConn, pszChildSid, FALSE, FALSE, FALSE);
+
     // Copy the combined list into the parent and child hashes
     dwError = LwHashGetIterator(
                     pCombined,
@@ -3324,6 +3916,8 @@ MemCacheStoreGroupsForUser(
                     pMember);
         BAIL_ON_LSA_ERROR(dwError);
 
+        MemCacheJournalRecord(pConn, MEM_CACHE_MEMBERSHIP, &pMember->membership);
+
         pEntry->pValue = NULL;
     }
 
@@ -3938,6 +4532,9 @@ MemCacheStorePasswordVerifier(
                     pCopy->pszObjectSid,
                     pCopy);
     BAIL_ON_LSA_ERROR(dwError);
+
+    MemCacheJournalRecord(pConn, MEM_CACHE_PASSWORD, pCopy);
+
     // This is now owned by the hash
     pCopy = NULL;
 
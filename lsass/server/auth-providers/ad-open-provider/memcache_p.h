@@ -111,7 +111,50 @@ typedef struct _MEM_GROUP_MEMBERSHIP
 // matter how old the entries are
 #define PINNED_USER_COUNT 10
 
-#define BACKUP_DELAY (5 * 60)
+// Changes are appended to the journal file this many seconds after the first
+// one is made
+#define BACKUP_DELAY 5
+
+// Once the journal file grows past this size, the next backup writes a new
+// snapshot and starts an empty journal
+#define JOURNAL_COMPACT_SIZE (8 * 1024 * 1024)
+
+#define MEM_CACHE_FILE_MAGIC    0x4c434d31
+#define MEM_CACHE_FILE_VERSION  1
+
+// Both the snapshot file and the journal file start with this header. The
+// journal is only replayed on top of a snapshot of the same generation.
+typedef struct _MEM_CACHE_FILE_HEADER
+{
+    DWORD dwMagic;
+    DWORD dwVersion;
+    DWORD dwGeneration;
+    DWORD dwReserved;
+} MEM_CACHE_FILE_HEADER, *PMEM_CACHE_FILE_HEADER;
+
+// Every record in the files is a header followed by dwLength bytes of flat
+// lwmsg data of the type indicated by dwTag
+typedef struct _MEM_CACHE_RECORD_HEADER
+{
+    DWORD dwTag;
+    DWORD dwLength;
+} MEM_CACHE_RECORD_HEADER, *PMEM_CACHE_RECORD_HEADER;
+
+// Journaled removal of an object and/or its memberships
+typedef struct _MEM_CACHE_REMOVE_RECORD
+{
+    PSTR pszSid;
+    BOOLEAN bIsParentSid;
+    BOOLEAN bRemoveObject;
+    BOOLEAN bRemoveCompleteness;
+} MEM_CACHE_REMOVE_RECORD, *PMEM_CACHE_REMOVE_RECORD;
+
+typedef struct _MEM_CACHE_BUFFER
+{
+    PBYTE pData;
+    size_t sLength;
+    size_t sCapacity;
+} MEM_CACHE_BUFFER, *PMEM_CACHE_BUFFER;
 
 
 typedef struct _MEM_DB_CONNECTION
@@ -132,7 +175,27 @@ typedef struct _MEM_DB_CONNECTION
     pthread_cond_t signalShutdown;
     BOOLEAN bSignalShutdownCreated;
 
+    // Serializes writes to the snapshot and journal files. It must be
+    // acquired before lock.
+    pthread_mutex_t fileMutex;
+    BOOLEAN bFileMutexCreated;
+    // Used to (un)marshal file records. Only used under the writer lock, or
+    // under the reader lock while fileMutex is held.
+    LWMsgContext* pContext;
+    LWMsgDataContext* pDataContext;
+    // Records for changes which have not been written to the journal file
+    // yet. Appended to under the writer lock; detached by the file writer.
+    MEM_CACHE_BUFFER journal;
+    // Set when a change cannot be journaled. The next backup then writes a
+    // full snapshot instead of appending to the journal.
+    BOOLEAN bNeedCompaction;
+    // The following are protected by fileMutex
+    DWORD dwGeneration;
+    BOOLEAN bJournalValid;
+    size_t sJournalSize;
+
     PSTR pszFilename;
+    PSTR pszJournalFilename;
 
     size_t sCacheSize;
     size_t sSizeCap;
@@ -1361,6 +1361,11 @@ AD_CacheGroupMembershipFromPac(
                         TRUE);
     BAIL_ON_LSA_ERROR(dwError);
 
+    AD_InvalidateClosures(
+        pContext->pState->hClosureCache,
+        1,
+        (PCSTR*) &pUserInfo->pszObjectSid);
+
     /* Create primary group sid from pac */
     dwError = LsaReplaceSidRid(
         pUserInfo->pszObjectSid,
@@ -2170,7 +2175,7 @@ AD_IncludeOnlyUnexpirableGroupMembershipsCallback(
 static
 DWORD
 AD_CacheMembershipFromRelatedObjects(
-    IN LSA_DB_HANDLE hDb,
+    IN PLSA_AD_PROVIDER_STATE pState,
     IN PCSTR pszSid,
     IN int iPrimaryGroupIndex,
     IN BOOLEAN bIsParent,
@@ -2185,6 +2190,8 @@ AD_CacheMembershipFromRelatedObjects(
     size_t sIndex = 0;
     size_t sMembershipCount = 0;
     PLSA_SECURITY_OBJECT pPrimaryGroup = NULL;
+    PCSTR* ppszChangedSids = NULL;
+    DWORD dwChangedSidCount = 0;
 
     if (iPrimaryGroupIndex >= 0)
     {
@@ -2249,10 +2256,24 @@ AD_CacheMembershipFromRelatedObjects(
     }
     sMembershipCount++;
 
+    // Every flattened membership set that went through an edge of
+    // pszSid (or, for a member list, of one of the members) may change.
+    dwError = LwAllocateMemory(
+                    sizeof(*ppszChangedSids) * sMaxMemberships,
+                    OUT_PPVOID(&ppszChangedSids));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    ppszChangedSids[dwChangedSidCount++] = pszSid;
+
     if (bIsParent)
     {
+        for (sIndex = 0; sIndex < sMembershipCount - 1; sIndex++)
+        {
+            ppszChangedSids[dwChangedSidCount++] = ppMemberships[sIndex]->pszChildSid;
+        }
+
         dwError = ADCacheStoreGroupMembership(
-                        hDb,
+                        pState->hCacheConnection,
                         pszSid,
                         sMembershipCount,
                         ppMemberships);
@@ -2261,7 +2282,7 @@ AD_CacheMembershipFromRelatedObjects(
     else
     {
         dwError = ADCacheStoreGroupsForUser(
-                        hDb,
+                        pState->hCacheConnection,
                         pszSid,
                         sMembershipCount,
                         ppMemberships,
@@ -2269,9 +2290,15 @@ AD_CacheMembershipFromRelatedObjects(
         BAIL_ON_LSA_ERROR(dwError);
     }
 
+    AD_InvalidateClosures(
+        pState->hClosureCache,
+        dwChangedSidCount,
+        ppszChangedSids);
+
 cleanup:
     LW_SAFE_FREE_MEMORY(ppMemberships);
     LW_SAFE_FREE_MEMORY(pMembershipBuffers);
+    LW_SAFE_FREE_MEMORY(ppszChangedSids);
     return dwError;
 
 error:
@@ -2612,7 +2639,7 @@ AD_OnlineGetUserGroupObjectMembership(
         AD_FilterNullEntries(ppResults, &sResultsCount);
 
         dwError = AD_CacheMembershipFromRelatedObjects(
-                        pContext->pState->hCacheConnection,
+                        pContext->pState,
                         pszSid,
                         iPrimaryGroupIndex,
                         FALSE,
@@ -3326,7 +3353,7 @@ AD_OnlineGetGroupMembers(
         BAIL_ON_LSA_ERROR(dwError);
 
         dwError = AD_CacheMembershipFromRelatedObjects(
-                        pContext->pState->hCacheConnection,
+                        pContext->pState,
                         pszSid,
                         -1,
                         TRUE,
@@ -4627,30 +4654,64 @@ AD_OnlineEnumObjects(
         goto cleanup;
     }
 
+    if (!pEnum->bSnapshotChecked)
+    {
+        pEnum->bSnapshotChecked = TRUE;
+
+        // Enumerations of every domain are served from the shared snapshot
+        // when one is available; the first one falls back to the directory
+        // while the snapshot is built.
+        if (!pEnum->pszDomainName)
+        {
+            dwError = AD_GetEnumSnapshot(
+                          pState->hEnumCache,
+                          AD_GetCacheEntryExpirySeconds(pState),
+                          &pEnum->pSnapshot);
+            if (dwError == ERROR_NOT_FOUND)
+            {
+                dwError = 0;
+            }
+            BAIL_ON_LSA_ERROR(dwError);
+        }
+    }
+
     do
     {
-        switch (pEnum->CurrentObjectType)
+        if (pEnum->pSnapshot)
         {
-        case LSA_OBJECT_TYPE_USER:
-            dwError = LsaAdBatchEnumObjects(
-                pContext,
-                &pEnum->Cookie,
-                LSA_OBJECT_TYPE_USER,
-                pEnum->pszDomainName,
-                dwMaxObjectsCount,
-                pdwObjectsCount,
-                pppObjects);
-            break;
-        case LSA_OBJECT_TYPE_GROUP:
-            dwError = LsaAdBatchEnumObjects(
-                pContext,
-                &pEnum->Cookie,
-                LSA_OBJECT_TYPE_GROUP,
-                pEnum->pszDomainName,
+            dwError = AD_EnumSnapshotObjects(
+                pEnum->pSnapshot,
+                pEnum->CurrentObjectType,
+                &pEnum->dwSnapshotIndex,
                 dwMaxObjectsCount,
                 pdwObjectsCount,
                 pppObjects);
-            break;
+        }
+        else
+        {
+            switch (pEnum->CurrentObjectType)
+            {
+            case LSA_OBJECT_TYPE_USER:
+                dwError = LsaAdBatchEnumObjects(
+                    pContext,
+                    &pEnum->Cookie,
+                    LSA_OBJECT_TYPE_USER,
+                    pEnum->pszDomainName,
+                    dwMaxObjectsCount,
+                    pdwObjectsCount,
+                    pppObjects);
+                break;
+            case LSA_OBJECT_TYPE_GROUP:
+                dwError = LsaAdBatchEnumObjects(
+                    pContext,
+                    &pEnum->Cookie,
+                    LSA_OBJECT_TYPE_GROUP,
+                    pEnum->pszDomainName,
+                    dwMaxObjectsCount,
+                    pdwObjectsCount,
+                    pppObjects);
+                break;
+            }
         }
 
         if ((dwError == LW_ERROR_NO_MORE_USERS ||
@@ -4664,6 +4725,7 @@ AD_OnlineEnumObjects(
                 pEnum->CurrentObjectType++;
                 LwFreeCookieContents(&pEnum->Cookie);
                 LwInitCookie(&pEnum->Cookie);
+                pEnum->dwSnapshotIndex = 0;
                 continue;
             }
             else
@@ -4676,11 +4738,15 @@ AD_OnlineEnumObjects(
 
     BAIL_ON_LSA_ERROR(dwError);
 
-    dwError = ADCacheStoreObjectEntries(
-        pContext->pState->hCacheConnection,
-        *pdwObjectsCount,
-        *pppObjects);
-    BAIL_ON_LSA_ERROR(dwError);
+    if (!pEnum->pSnapshot)
+    {
+        // Objects in a snapshot were cached when it was built
+        dwError = ADCacheStoreObjectEntries(
+            pContext->pState->hCacheConnection,
+            *pdwObjectsCount,
+            *pppObjects);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
 
 cleanup:
 
@@ -4700,7 +4766,8 @@ AD_OnlineQueryMemberOfForSid(
     IN PAD_PROVIDER_CONTEXT pContext,
     IN LSA_FIND_FLAGS FindFlags,
     IN PSTR pszSid,
-    IN OUT PLW_HASH_TABLE pGroupHash
+    IN OUT PLW_HASH_TABLE pGroupHash,
+    IN OUT time_t* ptExpire
     )
 {
     DWORD dwError = LW_ERROR_SUCCESS;
@@ -4710,6 +4777,7 @@ AD_OnlineQueryMemberOfForSid(
     BOOLEAN bExpired = FALSE;
     BOOLEAN bIsComplete = FALSE;
     BOOLEAN bUseCache = FALSE;
+    BOOLEAN bIsCurrent = FALSE;
     size_t sResultsCount = 0;
     PLSA_SECURITY_OBJECT* ppResults = NULL;
     // Only free top level array, do not free string pointers.
@@ -4762,7 +4830,9 @@ AD_OnlineQueryMemberOfForSid(
             pszSid);
     }
 
-    if (bExpired || !bIsComplete)
+    bIsCurrent = !bExpired && bIsComplete;
+
+    if (!bIsCurrent)
     {
         LSA_TRUST_DIRECTION dwTrustDirection = LSA_TRUST_DIRECTION_UNKNOWN;
 
@@ -4796,6 +4866,29 @@ AD_OnlineQueryMemberOfForSid(
         bUseCache = TRUE;
     }
 
+    if (bUseCache && !bIsCurrent)
+    {
+        // Never remember a flattened set built from stale memberships
+        *ptExpire = 0;
+    }
+    else if (bUseCache)
+    {
+        DWORD dwCacheEntryExpirySeconds = AD_GetCacheEntryExpirySeconds(pContext->pState);
+
+        for (dwIndex = 0; dwIndex < sMembershipCount; dwIndex++)
+        {
+            PLSA_GROUP_MEMBERSHIP pMembership = ppMemberships[dwIndex];
+
+            if (!pMembership->bIsInPac &&
+                !pMembership->bIsDomainPrimaryGroup &&
+                pMembership->version.tLastUpdated > 0 &&
+                pMembership->version.tLastUpdated + dwCacheEntryExpirySeconds < *ptExpire)
+            {
+                *ptExpire = pMembership->version.tLastUpdated + dwCacheEntryExpirySeconds;
+            }
+        }
+    }
+
     if (!bUseCache)
     {
         dwError = ADLdap_GetObjectGroupMembership(
@@ -4818,7 +4911,7 @@ AD_OnlineQueryMemberOfForSid(
         AD_FilterNullEntries(ppResults, &sResultsCount);
 
         dwError = AD_CacheMembershipFromRelatedObjects(
-                        pContext->pState->hCacheConnection,
+                        pContext->pState,
                         pszSid,
                         iPrimaryGroupIndex,
                         FALSE,
@@ -4850,7 +4943,8 @@ AD_OnlineQueryMemberOfForSid(
                     pContext,
                     FindFlags,
                     pszGroupSid,
-                    pGroupHash);
+                    pGroupHash,
+                    ptExpire);
                 pszGroupSid = NULL;
                 BAIL_ON_LSA_ERROR(dwError);
             }
@@ -4875,7 +4969,8 @@ AD_OnlineQueryMemberOfForSid(
                     pContext,
                     FindFlags,
                     pszGroupSid,
-                    pGroupHash);
+                    pGroupHash,
+                    ptExpire);
                 pszGroupSid = NULL;
                 BAIL_ON_LSA_ERROR(dwError);
             }
@@ -4933,6 +5028,9 @@ AD_OnlineQueryMemberOf(
     LW_HASH_ENTRY*   pHashEntry = NULL;
     DWORD dwGroupSidCount = 0;
     PSTR* ppszGroupSids = NULL;
+    PLW_HASH_TABLE pSidHash = NULL;
+    DWORD dwGeneration = 0;
+    time_t tExpire = 0;
 
     dwError = LwHashCreate(
         13,
@@ -4950,12 +5048,68 @@ AD_OnlineQueryMemberOf(
             continue;
         }
 
+        dwError = AD_MergeCachedClosure(
+            pContext->pState->hClosureCache,
+            ppszSids[dwIndex],
+            FindFlags,
+            pGroupHash,
+            &dwGeneration);
+        if (dwError != ERROR_NOT_FOUND)
+        {
+            BAIL_ON_LSA_ERROR(dwError);
+            continue;
+        }
+
+        // Flatten the memberships of this SID on its own so that the
+        // result can be remembered for the next token built for it.
+        dwError = LwHashCreate(
+            13,
+            LwHashCaselessStringCompare,
+            LwHashCaselessStringHash,
+            AD_OnlineFreeMemberOfHashEntry,
+            NULL,
+            &pSidHash);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        dwError = LsaGetCurrentTimeSeconds(&tExpire);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        tExpire += AD_GetCacheEntryExpirySeconds(pContext->pState);
+
         dwError = AD_OnlineQueryMemberOfForSid(
             pContext,
             FindFlags,
             ppszSids[dwIndex],
-            pGroupHash);
+            pSidHash,
+            &tExpire);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        AD_StoreClosure(
+            pContext->pState->hClosureCache,
+            ppszSids[dwIndex],
+            FindFlags,
+            dwGeneration,
+            tExpire,
+            pSidHash);
+
+        dwError = LwHashGetIterator(pSidHash, &hashIterator);
         BAIL_ON_LSA_ERROR(dwError);
+
+        while ((pHashEntry = LwHashNext(&hashIterator)) != NULL)
+        {
+            if (!LwHashExists(pGroupHash, pHashEntry->pKey))
+            {
+                dwError = LwHashSetValue(
+                    pGroupHash,
+                    pHashEntry->pValue,
+                    pHashEntry->pValue);
+                BAIL_ON_LSA_ERROR(dwError);
+                // pGroupHash owns the string now
+                pHashEntry->pValue = NULL;
+            }
+        }
+
+        LwHashSafeFree(&pSidHash);
     }
 
     dwGroupSidCount = (DWORD) LwHashGetKeyCount(pGroupHash);
@@ -4982,6 +5136,7 @@ AD_OnlineQueryMemberOf(
 
 cleanup:
 
+    LwHashSafeFree(&pSidHash);
     LwHashSafeFree(&pGroupHash);
 
     return dwError;
@@ -5103,7 +5258,7 @@ AD_OnlineGetGroupMemberSids(
         BAIL_ON_LSA_ERROR(dwError);
 
         dwError = AD_CacheMembershipFromRelatedObjects(
-                        pContext->pState->hCacheConnection,
+                        pContext->pState,
                         pszSid,
                         -1,
                         TRUE,
@@ -662,6 +662,13 @@ LsaAdProviderStateDestroy(
 {
     if (pState)
     {
+        // The refresh thread takes the state lock, so stop it first
+        if (pState->hEnumCache)
+        {
+            AD_DestroyEnumCache(pState->hEnumCache);
+            pState->hEnumCache = NULL;
+        }
+
         if (pState->pStateLock)
         {
             LsaAdProviderStateAcquireWrite(pState);
@@ -680,6 +687,24 @@ LsaAdProviderStateDestroy(
             pState->hSchannelState = NULL;
         }
 
+        if (pState->hPolicyPool)
+        {
+            AD_NetDestroyPolicyPool(pState->hPolicyPool);
+            pState->hPolicyPool = NULL;
+        }
+
+        if (pState->hClosureCache)
+        {
+            AD_DestroyClosureCache(pState->hClosureCache);
+            pState->hClosureCache = NULL;
+        }
+
+        if (pState->hBatchCoalesce)
+        {
+            LsaAdBatchDestroyCoalesceState(pState->hBatchCoalesce);
+            pState->hBatchCoalesce = NULL;
+        }
+
         AD_FreeAllowedSIDs_InLock(pState);
 
         if (pState->MediaSenseHandle)
@@ -821,6 +846,18 @@ LsaAdProviderStateCreate(
     dwError = AD_NetCreateSchannelState(&pState->hSchannelState);
     BAIL_ON_LSA_ERROR(dwError);
 
+    dwError = AD_NetCreatePolicyPool(&pState->hPolicyPool);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = AD_CreateEnumCache(pState, &pState->hEnumCache);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = AD_CreateClosureCache(&pState->hClosureCache);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LsaAdBatchCreateCoalesceState(&pState->hBatchCoalesce);
+    BAIL_ON_LSA_ERROR(dwError);
+
     dwError = AD_InitializeConfig(&config);
     BAIL_ON_LSA_ERROR(dwError);
 
@@ -1311,6 +1348,23 @@ AD_Deactivate(
 
     AD_MachineCredentialsCacheClear(pState);
 
+    if (pState->hPolicyPool)
+    {
+        AD_NetFlushPolicyPool(pState->hPolicyPool);
+    }
+
+    if (pState->hEnumCache)
+    {
+        AD_FlushEnumCache(pState->hEnumCache);
+    }
+
+    if (pState->hClosureCache)
+    {
+        AD_FlushClosureCache(pState->hClosureCache);
+    }
+
+    InterlockedIncrement(&pState->lCacheGeneration);
+
     if (pState->pProviderData)
     {
         ADProviderFreeProviderData(pState->pProviderData);
@@ -2011,6 +2065,13 @@ AD_RemoveUserByNameFromCache(
                   ppObjects[0]->pszObjectSid);
     BAIL_ON_LSA_ERROR(dwError);
 
+    AD_InvalidateClosures(
+        pContext->pState->hClosureCache,
+        1,
+        (PCSTR*) &ppObjects[0]->pszObjectSid);
+
+    InterlockedIncrement(&pContext->pState->lCacheGeneration);
+
 cleanup:
     LsaUtilFreeSecurityObjectList(1, ppObjects);
     AD_ClearProviderState(pContext);
@@ -2083,6 +2144,13 @@ AD_RemoveUserByIdFromCache(
                   ppObjects[0]->pszObjectSid);
     BAIL_ON_LSA_ERROR(dwError);
 
+    AD_InvalidateClosures(
+        pContext->pState->hClosureCache,
+        1,
+        (PCSTR*) &ppObjects[0]->pszObjectSid);
+
+    InterlockedIncrement(&pContext->pState->lCacheGeneration);
+
 cleanup:
     LsaUtilFreeSecurityObjectList(1, ppObjects);
     AD_ClearProviderState(pContext);
@@ -3025,6 +3093,13 @@ AD_RemoveGroupByNameFromCache(
                   ppObjects[0]->pszObjectSid);
     BAIL_ON_LSA_ERROR(dwError);
 
+    AD_InvalidateClosures(
+        pContext->pState->hClosureCache,
+        1,
+        (PCSTR*) &ppObjects[0]->pszObjectSid);
+
+    InterlockedIncrement(&pContext->pState->lCacheGeneration);
+
 cleanup:
     LsaUtilFreeSecurityObjectList(1, ppObjects);
     AD_ClearProviderState(pContext);
@@ -3090,6 +3165,13 @@ AD_RemoveGroupByIdFromCache(
                   ppObjects[0]->pszObjectSid);
     BAIL_ON_LSA_ERROR(dwError);
 
+    AD_InvalidateClosures(
+        pContext->pState->hClosureCache,
+        1,
+        (PCSTR*) &ppObjects[0]->pszObjectSid);
+
+    InterlockedIncrement(&pContext->pState->lCacheGeneration);
+
 cleanup:
     LsaUtilFreeSecurityObjectList(1, ppObjects);
     AD_ClearProviderState(pContext);
@@ -3266,6 +3348,47 @@ AD_EmptyCache(
                   pContext->pState->hCacheConnection);
     BAIL_ON_LSA_ERROR(dwError);
 
+    AD_FlushClosureCache(pContext->pState->hClosureCache);
+
+    InterlockedIncrement(&pContext->pState->lCacheGeneration);
+
+cleanup:
+
+    AD_ClearProviderState(pContext);
+
+    return dwError;
+
+error:
+
+    goto cleanup;
+}
+
+/*
+ * Returns the cache generation as a host order DWORD.  Anyone may ask;
+ * it lets out of provider token caches notice a flush.
+ */
+DWORD
+AD_GetCacheGeneration(
+    IN HANDLE hProvider,
+    OUT DWORD* pdwOutputBufferSize,
+    OUT PVOID* ppOutputBuffer
+    )
+{
+    DWORD dwError = 0;
+    PAD_PROVIDER_CONTEXT pContext = NULL;
+    PDWORD pdwGeneration = NULL;
+
+    dwError = AD_ResolveProviderState(hProvider, &pContext);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LwAllocateMemory(sizeof(*pdwGeneration), OUT_PPVOID(&pdwGeneration));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    *pdwGeneration = (DWORD) pContext->pState->lCacheGeneration;
+
+    *pdwOutputBufferSize = sizeof(*pdwGeneration);
+    *ppOutputBuffer = pdwGeneration;
+
 cleanup:
 
     AD_ClearProviderState(pContext);
@@ -3274,6 +3397,11 @@ cleanup:
 
 error:
 
+    *pdwOutputBufferSize = 0;
+    *ppOutputBuffer = NULL;
+
+    LW_SAFE_FREE_MEMORY(pdwGeneration);
+
     goto cleanup;
 }
 
@@ -4370,6 +4498,12 @@ AD_ProviderIoControl(
                             pdwOutputBufferSize,
                             ppOutputBuffer);
             break;
+        case LSA_AD_IO_GET_CACHE_GENERATION:
+            dwError = AD_GetCacheGeneration(
+                          hProvider,
+                          pdwOutputBufferSize,
+                          ppOutputBuffer);
+            break;
         default:
             dwError = LW_ERROR_NOT_HANDLED;
             break;
@@ -5031,6 +5165,7 @@ AD_CloseEnum(
         {
             LwFreeStringArray(pEnum->ppszSids, pEnum->dwSidCount);
         }
+        AD_ReleaseEnumSnapshot(pEnum->pSnapshot);
         LwFreeMemory(pEnum);
 
         AD_ClearProviderState(pContext);
@@ -281,6 +281,13 @@ AD_EmptyCache(
     IN gid_t  peerGID
     );
 
+DWORD
+AD_GetCacheGeneration(
+    IN HANDLE hProvider,
+    OUT DWORD* pdwOutputBufferSize,
+    OUT PVOID* ppOutputBuffer
+    );
+
 DWORD
 AD_OpenSession(
     HANDLE hProvider,
@@ -0,0 +1,407 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software    2004-2008
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        schannelpool.c
+ *
+ * Abstract:
+ *
+ *        Likewise Security and Authentication Subsystem (LSASS)
+ *
+ *        Pool of netlogon secure channels
+ *
+ *        Kept free of the rest of the provider so that
+ *        tests/test_schannel_pool can build it on its own.
+ */
+
+#include "config.h"
+#include "lsasystem.h"
+#include "lsadef.h"
+#include "lsa/lsa.h"
+#include "lwmem.h"
+#include "lwstr.h"
+#include "lsautils.h"
+#include <lwio/lwio.h>
+#include <lw/rpc/samr.h>
+
+#include "addef.h"
+#include "schannelpool.h"
+
+DWORD
+AD_NetCreateSchannelState(
+    OUT PLSA_SCHANNEL_STATE* ppSchannelState
+    )
+{
+    DWORD dwError = 0;
+    PLSA_SCHANNEL_STATE pSchannelState = NULL;
+    PLSA_SCHANNEL_SLOT pSlot = NULL;
+    DWORD dwIndex = 0;
+
+    dwError = LwAllocateMemory(
+                  sizeof(*pSchannelState),
+                  (PVOID*)&pSchannelState);
+    BAIL_ON_LSA_ERROR(dwError);
+
+    dwError = LwMapErrnoToLwError(pthread_mutex_init(&pSchannelState->PoolLock, NULL));
+    BAIL_ON_LSA_ERROR(dwError);
+
+    pSchannelState->pPoolLock = &pSchannelState->PoolLock;
+
+    for (dwIndex = 0; dwIndex < AD_NETLOGON_CHANNEL_COUNT_MAXIMUM; dwIndex++)
+    {
+        pSlot = &pSchannelState->Slots[dwIndex];
+
+        dwError = LwMapErrnoToLwError(pthread_rwlock_init(&pSlot->SchannelLock, NULL));
+        BAIL_ON_LSA_ERROR(dwError);
+
+        pSlot->pSchannelLock = &pSlot->SchannelLock;
+    }
+
+    *ppSchannelState = pSchannelState;
+
+cleanup:
+
+    return dwError;
+
+error:
+
+    *ppSchannelState = NULL;
+
+    if (pSchannelState)
+    {
+        AD_NetDestroySchannelState(pSchannelState);
+    }
+
+    goto cleanup;
+}
+
+VOID
+AD_NetDestroySchannelState(
+    IN PLSA_SCHANNEL_STATE pSchannelState
+    )
+{
+    PLSA_SCHANNEL_SLOT pSlot = NULL;
+    DWORD dwIndex = 0;
+
+    for (dwIndex = 0; dwIndex < AD_NETLOGON_CHANNEL_COUNT_MAXIMUM; dwIndex++)
+    {
+        pSlot = &pSchannelState->Slots[dwIndex];
+
+        AD_ClearSchannelSlotInLock(pSlot);
+        LW_SAFE_FREE_STRING(pSlot->pszTarget);
+
+        if (pSlot->pSchannelLock)
+        {
+            pthread_rwlock_destroy(pSlot->pSchannelLock);
+        }
+    }
+
+    if (pSchannelState->pPoolLock)
+    {
+        pthread_mutex_destroy(pSchannelState->pPoolLock);
+    }
+
+    LwFreeMemory(pSchannelState);
+}
+
+/*
+ * Picks the secure channel slot for a logon against pszDomainController.
+ * The slot already bound to that DC is preferred until it carries
+ * dwMaxConcurrentApi logons, at which point the least loaded slot bound
+ * to another DC takes the overflow.  A DC without a slot claims an
+ * unused one or the least recently used idle one.  With
+ * bRequireDomainController set only a slot for that DC is returned,
+ * or NULL when none can be claimed.
+ */
+DWORD
+AD_NetAcquireSchannelSlot(
+    IN PLSA_SCHANNEL_STATE pSchannelState,
+    IN PCSTR pszDomainController,
+    IN DWORD dwChannelCount,
+    IN DWORD dwMaxConcurrentApi,
+    IN BOOLEAN bRequireDomainController,
+    OUT PLSA_SCHANNEL_SLOT* ppSlot
+    )
+{
+    DWORD dwError = 0;
+    PLSA_SCHANNEL_SLOT pSlot = NULL;
+    PLSA_SCHANNEL_SLOT pTargetSlot = NULL;
+    PLSA_SCHANNEL_SLOT pIdleSlot = NULL;
+    PLSA_SCHANNEL_SLOT pLeastLoadedSlot = NULL;
+    PSTR pszTarget = NULL;
+    DWORD dwIndex = 0;
+
+    if (dwChannelCount < 1)
+    {
+        dwChannelCount = 1;
+    }
+    else if (dwChannelCount > AD_NETLOGON_CHANNEL_COUNT_MAXIMUM)
+    {
+        dwChannelCount = AD_NETLOGON_CHANNEL_COUNT_MAXIMUM;
+    }
+
+    pthread_mutex_lock(pSchannelState->pPoolLock);
+
+    for (dwIndex = 0; dwIndex < dwChannelCount; dwIndex++)
+    {
+        pSlot = &pSchannelState->Slots[dwIndex];
+
+        if (!pSlot->pszTarget)
+        {
+            if (!pIdleSlot || pIdleSlot->pszTarget)
+            {
+                pIdleSlot = pSlot;
+            }
+            continue;
+        }
+
+        if (!strcasecmp(pSlot->pszTarget, pszDomainController))
+        {
+            pTargetSlot = pSlot;
+            continue;
+        }
+
+        if (!pSlot->dwInFlight &&
+            (!pIdleSlot ||
+             (pIdleSlot->pszTarget && pSlot->LastUsed < pIdleSlot->LastUsed)))
+        {
+            pIdleSlot = pSlot;
+        }
+
+        if (!pLeastLoadedSlot ||
+            pSlot->dwInFlight < pLeastLoadedSlot->dwInFlight)
+        {
+            pLeastLoadedSlot = pSlot;
+        }
+    }
+
+    if (pTargetSlot)
+    {
+        pSlot = pTargetSlot;
+
+        if (!bRequireDomainController &&
+            pTargetSlot->dwInFlight >= dwMaxConcurrentApi &&
+            pLeastLoadedSlot &&
+            pLeastLoadedSlot->dwInFlight < pTargetSlot->dwInFlight)
+        {
+            pSlot = pLeastLoadedSlot;
+        }
+    }
+    else if (pIdleSlot)
+    {
+        dwError = LwAllocateString(pszDomainController, &pszTarget);
+        BAIL_ON_LSA_ERROR(dwError);
+
+        if (pIdleSlot->pszTarget)
+        {
+            LSA_LOG_VERBOSE("Moving netlogon channel from '%s' to '%s'",
+                            pIdleSlot->pszTarget, pszDomainController);
+        }
+
+        LW_SAFE_FREE_STRING(pIdleSlot->pszTarget);
+        pIdleSlot->pszTarget = pszTarget;
+        pszTarget = NULL;
+
+        pSlot = pIdleSlot;
+    }
+    else if (!bRequireDomainController)
+    {
+        pSlot = pLeastLoadedSlot;
+    }
+    else
+    {
+        pSlot = NULL;
+    }
+
+    if (pSlot)
+    {
+        pSlot->dwInFlight++;
+    }
+
+    *ppSlot = pSlot;
+
+cleanup:
+
+    pthread_mutex_unlock(pSchannelState->pPoolLock);
+
+    return dwError;
+
+error:
+
+    LW_SAFE_FREE_STRING(pszTarget);
+
+    *ppSlot = NULL;
+
+    goto cleanup;
+}
+
+VOID
+AD_NetReleaseSchannelSlot(
+    IN PLSA_SCHANNEL_STATE pSchannelState,
+    IN PLSA_SCHANNEL_SLOT pSlot
+    )
+{
+    pthread_mutex_lock(pSchannelState->pPoolLock);
+
+    pSlot->dwInFlight--;
+    pSlot->LastUsed = time(NULL);
+
+    pthread_mutex_unlock(pSchannelState->pPoolLock);
+}
+
+/*
+ * Takes the slot lock shared with the secure channel to the slot's
+ * target open, opening (or re-targeting) it first through
+ * pfnOpenSchannel under the exclusive lock.  *pdwGeneration identifies
+ * the channel in use so that a later reset cannot close one that
+ * another thread has since reopened.  On success the caller must
+ * release the slot with AD_NetUnlockSchannelSlot.
+ */
+DWORD
+AD_NetLockSchannelSlot(
+    IN PLSA_SCHANNEL_SLOT pSlot,
+    IN PFN_AD_OPEN_SCHANNEL pfnOpenSchannel,
+    IN PVOID pContext,
+    OUT PDWORD pdwGeneration,
+    OUT PBOOLEAN pbIsNetworkError
+    )
+{
+    DWORD dwError = 0;
+    BOOLEAN bIsNetworkError = FALSE;
+
+    for (;;)
+    {
+        pthread_rwlock_rdlock(pSlot->pSchannelLock);
+
+        if (pSlot->hSchannelBinding &&
+            !strcasecmp(pSlot->pszSchannelServer, pSlot->pszTarget))
+        {
+            break;
+        }
+
+        pthread_rwlock_unlock(pSlot->pSchannelLock);
+
+        pthread_rwlock_wrlock(pSlot->pSchannelLock);
+
+        if (pSlot->hSchannelBinding &&
+            strcasecmp(pSlot->pszSchannelServer, pSlot->pszTarget))
+        {
+            LSA_LOG_VERBOSE("Resetting schannel due to switching DC from '%s' to '%s'",
+                            pSlot->pszSchannelServer, pSlot->pszTarget);
+            AD_ClearSchannelSlotInLock(pSlot);
+        }
+
+        if (!pSlot->hSchannelBinding)
+        {
+            dwError = pfnOpenSchannel(pSlot, pContext, &bIsNetworkError);
+            if (dwError)
+            {
+                AD_ClearSchannelSlotInLock(pSlot);
+            }
+        }
+
+        pthread_rwlock_unlock(pSlot->pSchannelLock);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    *pdwGeneration = pSlot->dwGeneration;
+
+cleanup:
+
+    *pbIsNetworkError = bIsNetworkError;
+
+    return dwError;
+
+error:
+
+    *pdwGeneration = 0;
+
+    goto cleanup;
+}
+
+VOID
+AD_NetUnlockSchannelSlot(
+    IN PLSA_SCHANNEL_SLOT pSlot,
+    IN BOOLEAN bResetSchannel,
+    IN DWORD dwGeneration
+    )
+{
+    pthread_rwlock_unlock(pSlot->pSchannelLock);
+
+    if (bResetSchannel)
+    {
+        /* Only close the channel this logon used; another thread may
+           already have reopened it */
+        pthread_rwlock_wrlock(pSlot->pSchannelLock);
+
+        if (pSlot->dwGeneration == dwGeneration)
+        {
+            AD_ClearSchannelSlotInLock(pSlot);
+        }
+
+        pthread_rwlock_unlock(pSlot->pSchannelLock);
+    }
+}
+
+VOID
+AD_ClearSchannelSlotInLock(
+    IN PLSA_SCHANNEL_SLOT pSlot
+    )
+{
+    if (pSlot->hSchannelBinding)
+    {
+        NetrCloseSchannel(pSlot->hSchannelBinding);
+
+        pSlot->hSchannelBinding = NULL;
+
+        memset(&pSlot->SchannelCreds,
+               0,
+               sizeof(pSlot->SchannelCreds));
+        pSlot->pSchannelCreds = NULL;
+
+        pSlot->dwGeneration++;
+    }
+
+    LW_SAFE_FREE_MEMORY(pSlot->pszSchannelServer);
+}
+
+
+/*
+local variables:
+mode: c
+c-basic-offset: 4
+indent-tabs-mode: nil
+tab-width: 4
+end:
+*/
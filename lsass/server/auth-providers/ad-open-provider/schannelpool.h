@@ -0,0 +1,134 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software    2004-2008
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        schannelpool.h
+ *
+ * Abstract:
+ *
+ *        Likewise Security and Authentication Subsystem (LSASS)
+ *
+ *        Pool of netlogon secure channels
+ *
+ */
+#ifndef __SCHANNELPOOL_H__
+#define __SCHANNELPOOL_H__
+
+#include <lw/rpc/netlogon.h>
+
+/*
+ * A DC keeps a single secure channel session per machine account, so
+ * each slot is bound to a distinct DC.  Logons share a slot under the
+ * read side of its lock (SamLogonEx carries no credential chain);
+ * opening or closing the channel takes the write side.
+ */
+typedef struct _LSA_SCHANNEL_SLOT {
+    NetrCredentials SchannelCreds;
+    NetrCredentials *pSchannelCreds;
+    NETR_BINDING hSchannelBinding;
+    PSTR pszSchannelServer;
+    DWORD dwGeneration;
+    pthread_rwlock_t SchannelLock;
+    pthread_rwlock_t *pSchannelLock;
+    /* Protected by the pool lock */
+    PSTR pszTarget;
+    DWORD dwInFlight;
+    time_t LastUsed;
+} LSA_SCHANNEL_SLOT, *PLSA_SCHANNEL_SLOT;
+
+typedef struct _LSA_SCHANNEL_STATE {
+    pthread_mutex_t PoolLock;
+    pthread_mutex_t *pPoolLock;
+    LSA_SCHANNEL_SLOT Slots[AD_NETLOGON_CHANNEL_COUNT_MAXIMUM];
+} LSA_SCHANNEL_STATE, *PLSA_SCHANNEL_STATE;
+
+/*
+ * Opens the secure channel to pSlot->pszTarget, filling in
+ * hSchannelBinding, SchannelCreds and pszSchannelServer.  Called with
+ * the slot lock held exclusively.
+ */
+typedef DWORD (*PFN_AD_OPEN_SCHANNEL)(
+    IN PLSA_SCHANNEL_SLOT pSlot,
+    IN PVOID pContext,
+    OUT PBOOLEAN pbIsNetworkError
+    );
+
+DWORD
+AD_NetCreateSchannelState(
+    OUT PLSA_SCHANNEL_STATE* ppSchannelState
+    );
+
+VOID
+AD_NetDestroySchannelState(
+    IN PLSA_SCHANNEL_STATE pSchannelState
+    );
+
+DWORD
+AD_NetAcquireSchannelSlot(
+    IN PLSA_SCHANNEL_STATE pSchannelState,
+    IN PCSTR pszDomainController,
+    IN DWORD dwChannelCount,
+    IN DWORD dwMaxConcurrentApi,
+    IN BOOLEAN bRequireDomainController,
+    OUT PLSA_SCHANNEL_SLOT* ppSlot
+    );
+
+VOID
+AD_NetReleaseSchannelSlot(
+    IN PLSA_SCHANNEL_STATE pSchannelState,
+    IN PLSA_SCHANNEL_SLOT pSlot
+    );
+
+DWORD
+AD_NetLockSchannelSlot(
+    IN PLSA_SCHANNEL_SLOT pSlot,
+    IN PFN_AD_OPEN_SCHANNEL pfnOpenSchannel,
+    IN PVOID pContext,
+    OUT PDWORD pdwGeneration,
+    OUT PBOOLEAN pbIsNetworkError
+    );
+
+VOID
+AD_NetUnlockSchannelSlot(
+    IN PLSA_SCHANNEL_SLOT pSlot,
+    IN BOOLEAN bResetSchannel,
+    IN DWORD dwGeneration
+    );
+
+VOID
+AD_ClearSchannelSlotInLock(
+    IN PLSA_SCHANNEL_SLOT pSlot
+    );
+
+#endif /* __SCHANNELPOOL_H__ */
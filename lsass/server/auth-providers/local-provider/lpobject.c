@@ -599,6 +599,9 @@ typedef struct _LOCAL_ENUM_HANDLE
     PDIRECTORY_ENTRY pEntries;
     DWORD dwIndex;
     LONG64 llSequenceNumber;
+    /* Object enumerations page through the directory */
+    PWSTR pwszFilter;
+    LONG64 llCookie;
 
 } *LOCAL_ENUM_HANDLE, **PLOCAL_ENUM_HANDLE;
 
@@ -613,49 +616,8 @@ LocalDirOpenEnumObjects(
 {
     DWORD dwError = 0;
     PLOCAL_PROVIDER_CONTEXT pContext = (PLOCAL_PROVIDER_CONTEXT)hProvider;
-    static WCHAR wszAttrNameObjectClass[]    = LOCAL_DIR_ATTR_OBJECT_CLASS;
-    static WCHAR wszAttrNameUID[]            = LOCAL_DIR_ATTR_UID;
-    static WCHAR wszAttrNameGID[]            = LOCAL_DIR_ATTR_GID;
-    static WCHAR wszAttrNamePrimaryGroup[]   = LOCAL_DIR_ATTR_PRIMARY_GROUP;
-    static WCHAR wszAttrNameSamAccountName[] = LOCAL_DIR_ATTR_SAM_ACCOUNT_NAME;
-    static WCHAR wszAttrNamePassword[]       = LOCAL_DIR_ATTR_PASSWORD;
-    static WCHAR wszAttrNameGecos[]          = LOCAL_DIR_ATTR_GECOS;
-    static WCHAR wszAttrNameShell[]          = LOCAL_DIR_ATTR_SHELL;
-    static WCHAR wszAttrNameHomedir[]        = LOCAL_DIR_ATTR_HOME_DIR;
-    static WCHAR wszAttrNameUPN[]            = LOCAL_DIR_ATTR_USER_PRINCIPAL_NAME;
-    static WCHAR wszAttrNameObjectSID[]      = LOCAL_DIR_ATTR_OBJECT_SID;
-    static WCHAR wszAttrNameDN[]             = LOCAL_DIR_ATTR_DISTINGUISHED_NAME;
-    static WCHAR wszAttrNameNetBIOSDomain[]  = LOCAL_DIR_ATTR_NETBIOS_NAME;
-    static WCHAR wszAttrNameUserInfoFlags[]  = LOCAL_DIR_ATTR_ACCOUNT_FLAGS;
-    static WCHAR wszAttrNameAccountExpiry[]  = LOCAL_DIR_ATTR_ACCOUNT_EXPIRY;
-    static WCHAR wszAttrNamePasswdLastSet[]  = LOCAL_DIR_ATTR_PASSWORD_LAST_SET;
-    static WCHAR wszAttrNameNTHash[]         = LOCAL_DIR_ATTR_NT_HASH;
-    static WCHAR wszAttrNameLMHash[]         = LOCAL_DIR_ATTR_LM_HASH;
-    static PWSTR wszAttrs[] =
-    {
-        wszAttrNameObjectClass,
-        wszAttrNameUID,
-        wszAttrNameGID,
-        wszAttrNamePrimaryGroup,
-        wszAttrNameSamAccountName,
-        wszAttrNamePassword,
-        wszAttrNameGecos,
-        wszAttrNameShell,
-        wszAttrNameHomedir,
-        wszAttrNameUPN,
-        wszAttrNameObjectSID,
-        wszAttrNameDN,
-        wszAttrNameNetBIOSDomain,
-        wszAttrNameUserInfoFlags,
-        wszAttrNameAccountExpiry,
-        wszAttrNamePasswdLastSet,
-        wszAttrNameNTHash,
-        wszAttrNameLMHash,
-        NULL
-    };
     PSTR pszTypeFilter = NULL;
     PSTR pszFilter = NULL;
-    PWSTR pwszFilter = NULL;
     DWORD dwObjectClass = LOCAL_OBJECT_CLASS_UNKNOWN;
     LOCAL_ENUM_HANDLE hEnum = NULL;
 
@@ -717,18 +679,7 @@ LocalDirOpenEnumObjects(
 
     dwError = LwMbsToWc16s(
         pszFilter,
-        &pwszFilter);
-    BAIL_ON_LSA_ERROR(dwError);
-
-    dwError = DirectorySearch(
-        pContext->hDirectory,
-        NULL,
-        0,
-        pwszFilter,
-        wszAttrs,
-        FALSE,
-        &hEnum->pEntries,
-        &hEnum->dwCount);
+        &hEnum->pwszFilter);
     BAIL_ON_LSA_ERROR(dwError);
 
     dwError = LocalGetSequenceNumber(
@@ -742,7 +693,6 @@ cleanup:
 
     LW_SAFE_FREE_STRING(pszTypeFilter);
     LW_SAFE_FREE_STRING(pszFilter);
-    LW_SAFE_FREE_MEMORY(pwszFilter);
 
     return dwError;
 
@@ -767,17 +717,52 @@ LocalDirEnumObjects(
     DWORD dwError = 0;
     LOCAL_ENUM_HANDLE pEnum = (LOCAL_ENUM_HANDLE) hEnum;
     PLOCAL_PROVIDER_CONTEXT pContext = (PLOCAL_PROVIDER_CONTEXT) pEnum->hProvider;
+    static WCHAR wszAttrNameObjectClass[]    = LOCAL_DIR_ATTR_OBJECT_CLASS;
+    static WCHAR wszAttrNameUID[]            = LOCAL_DIR_ATTR_UID;
+    static WCHAR wszAttrNameGID[]            = LOCAL_DIR_ATTR_GID;
+    static WCHAR wszAttrNamePrimaryGroup[]   = LOCAL_DIR_ATTR_PRIMARY_GROUP;
+    static WCHAR wszAttrNameSamAccountName[] = LOCAL_DIR_ATTR_SAM_ACCOUNT_NAME;
+    static WCHAR wszAttrNamePassword[]       = LOCAL_DIR_ATTR_PASSWORD;
+    static WCHAR wszAttrNameGecos[]          = LOCAL_DIR_ATTR_GECOS;
+    static WCHAR wszAttrNameShell[]          = LOCAL_DIR_ATTR_SHELL;
+    static WCHAR wszAttrNameHomedir[]        = LOCAL_DIR_ATTR_HOME_DIR;
+    static WCHAR wszAttrNameUPN[]            = LOCAL_DIR_ATTR_USER_PRINCIPAL_NAME;
+    static WCHAR wszAttrNameObjectSID[]      = LOCAL_DIR_ATTR_OBJECT_SID;
+    static WCHAR wszAttrNameDN[]             = LOCAL_DIR_ATTR_DISTINGUISHED_NAME;
+    static WCHAR wszAttrNameNetBIOSDomain[]  = LOCAL_DIR_ATTR_NETBIOS_NAME;
+    static WCHAR wszAttrNameUserInfoFlags[]  = LOCAL_DIR_ATTR_ACCOUNT_FLAGS;
+    static WCHAR wszAttrNameAccountExpiry[]  = LOCAL_DIR_ATTR_ACCOUNT_EXPIRY;
+    static WCHAR wszAttrNamePasswdLastSet[]  = LOCAL_DIR_ATTR_PASSWORD_LAST_SET;
+    static WCHAR wszAttrNameNTHash[]         = LOCAL_DIR_ATTR_NT_HASH;
+    static WCHAR wszAttrNameLMHash[]         = LOCAL_DIR_ATTR_LM_HASH;
+    static PWSTR wszAttrs[] =
+    {
+        wszAttrNameObjectClass,
+        wszAttrNameUID,
+        wszAttrNameGID,
+        wszAttrNamePrimaryGroup,
+        wszAttrNameSamAccountName,
+        wszAttrNamePassword,
+        wszAttrNameGecos,
+        wszAttrNameShell,
+        wszAttrNameHomedir,
+        wszAttrNameUPN,
+        wszAttrNameObjectSID,
+        wszAttrNameDN,
+        wszAttrNameNetBIOSDomain,
+        wszAttrNameUserInfoFlags,
+        wszAttrNameAccountExpiry,
+        wszAttrNamePasswdLastSet,
+        wszAttrNameNTHash,
+        wszAttrNameLMHash,
+        NULL
+    };
     LONG64 llSequenceNumber = 0;
     DWORD dwAllocCount = 0;
     PLSA_SECURITY_OBJECT* ppObjects = NULL;
     DWORD dwIndex = 0;
-    PDIRECTORY_ENTRY pEntry = NULL;
-
-    if (pEnum->dwIndex >= pEnum->dwCount)
-    {
-        dwError = ERROR_NO_MORE_ITEMS;
-        BAIL_ON_LSA_ERROR(dwError);
-    }
+    PDIRECTORY_ENTRY pEntries = NULL;
+    DWORD dwNumEntries = 0;
 
     dwError = LocalGetSequenceNumber(
         pContext,
@@ -790,18 +775,37 @@ LocalDirEnumObjects(
         BAIL_ON_LSA_ERROR(dwError);
     }
 
-    dwAllocCount = dwMaxObjectsCount;
-    if (dwAllocCount > pEnum->dwCount - pEnum->dwIndex)
+    if (dwMaxObjectsCount)
     {
-        dwAllocCount = pEnum->dwCount - pEnum->dwIndex;
+        /* Only fetch what the caller asked for */
+        dwError = DirectorySearchPaged(
+            pContext->hDirectory,
+            NULL,
+            0,
+            pEnum->pwszFilter,
+            wszAttrs,
+            FALSE,
+            dwMaxObjectsCount,
+            &pEnum->llCookie,
+            &pEntries,
+            &dwNumEntries);
+        BAIL_ON_LSA_ERROR(dwError);
+    }
+
+    if (dwNumEntries == 0)
+    {
+        dwError = ERROR_NO_MORE_ITEMS;
+        BAIL_ON_LSA_ERROR(dwError);
     }
 
+    dwAllocCount = dwNumEntries;
+
     dwError = LwAllocateMemory(sizeof(*ppObjects) * dwAllocCount, OUT_PPVOID(&ppObjects));
     BAIL_ON_LSA_ERROR(dwError);
 
     for(dwIndex = 0; dwIndex < dwAllocCount; dwIndex++)
     {
-        pEntry = &pEnum->pEntries[pEnum->dwIndex++];
+        PDIRECTORY_ENTRY pEntry = &pEntries[dwIndex];
 
         dwError = LocalMarshalEntryToSecurityObject(
             pEntry,
@@ -819,6 +823,11 @@ LocalDirEnumObjects(
 
 cleanup:
 
+    if (pEntries)
+    {
+        DirectoryFreeEntries(pEntries, dwNumEntries);
+    }
+
     return dwError;
 
 error:
@@ -848,6 +857,8 @@ LocalDirCloseEnum(
             DirectoryFreeEntries(pEnum->pEntries, pEnum->dwCount);
         }
 
+        LW_SAFE_FREE_MEMORY(pEnum->pwszFilter);
+
         LwFreeMemory(pEnum);
     }
 }
@@ -312,6 +312,26 @@ DirectorySearch(
     PDWORD            pdwNumEntries
     );
 
+/*
+ * Pages through the entries matching pwszFilter in a stable order.
+ * *pllCookie must be 0 for the first page and is advanced past each
+ * page returned; a page with no entries ends the search.  Filters may
+ * not carry their own ORDER BY/LIMIT clauses.
+ */
+DWORD
+DirectorySearchPaged(
+    HANDLE            hDirectory,
+    PWSTR             pwszBase,
+    ULONG             ulScope,
+    PWSTR             pwszFilter,
+    PWSTR             wszAttributes[],
+    ULONG             ulAttributesOnly,
+    ULONG             ulPageSize,
+    PLONG64           pllCookie,
+    PDIRECTORY_ENTRY* ppDirectoryEntries,
+    PDWORD            pdwNumEntries
+    );
+
 DWORD
 DirectoryDeleteObject(
     HANDLE hBindHandle,
@@ -364,6 +364,34 @@ LsaSrvDuplicateMachinePasswordInfoW(
     OUT PLSA_MACHINE_PASSWORD_INFO_W* ppNewPasswordInfo
     );
 
+typedef enum
+{
+    LsaMetricDcCallLdap = 0,
+    LsaMetricDcCallRpc  = 1
+} LsaMetricDcCallType;
+
+/* Monotonic timestamp in microseconds for the metric calls below */
+UINT64
+LsaSrvGetMetricTimestamp(
+    VOID
+    );
+
+/* dwCacheIndex is one of LSA_METRIC_CACHE_* */
+VOID
+LsaSrvRecordCacheLookup(
+    DWORD dwCacheIndex,
+    BOOLEAN bHit
+    );
+
+/* Adds the time since ullStartTime to the histogram of pszTarget */
+VOID
+LsaSrvRecordDcCallLatency(
+    LsaMetricDcCallType callType,
+    PCSTR pszTarget,
+    UINT64 ullStartTime,
+    DWORD dwError
+    );
+
 DWORD
 LsaSrvProviderServicesDomain(
     IN PCSTR pszProvider,
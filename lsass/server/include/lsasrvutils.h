@@ -173,6 +173,8 @@ typedef struct _LSA_CONFIG_REG
     HKEY    hKey;
     PSTR    pszConfigKey;
     PSTR    pszPolicyKey;
+    // Process-wide, not owned
+    PLWREG_CONFIG_CACHE pCache;
 } LSA_CONFIG_REG, *PLSA_CONFIG_REG;
 
 typedef enum
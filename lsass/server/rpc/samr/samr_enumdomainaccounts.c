@@ -66,6 +66,7 @@ SamrSrvEnumDomainAccounts(
     PDOMAIN_CONTEXT pDomCtx = NULL;
     PCONNECT_CONTEXT pConnCtx = NULL;
     PWSTR pwszBase = NULL;
+    WCHAR wszAttrRecordId[] = DS_ATTR_RECORD_ID;
     WCHAR wszAttrObjectClass[] = DS_ATTR_OBJECT_CLASS;
     WCHAR wszAttrDomainName[] = DS_ATTR_DOMAIN;
     WCHAR wszAttrAccountFlags[] = DS_ATTR_ACCOUNT_FLAGS;
@@ -83,7 +84,7 @@ SamrSrvEnumDomainAccounts(
     DWORD dwSize = 0;
     DWORD i = 0;
     DWORD dwCount = 0;
-    DWORD dwNumEntriesReturned = 0;
+    DWORD dwAllocCount = 0;
     DWORD dwResume = 0;
     DWORD dwAccountFlags = 0;
     size_t sNameLen = 0;
@@ -92,10 +93,16 @@ SamrSrvEnumDomainAccounts(
     PSID pSid = NULL;
     DWORD dwRid = 0;
     RID_NAME_ARRAY *pNames = NULL;
+    RID_NAME *pNewEntries = NULL;
     RID_NAME *pName = NULL;
-    DWORD dwNewResumeIdx = 0;
+    LONG64 llCookie = 0;
+    LONG64 llRecordId = 0;
+    LONG64 llLastRecordId = 0;
+    BOOLEAN bFirstPage = TRUE;
+    BOOLEAN bDone = FALSE;
 
     PWSTR wszAttributes[] = {
+        wszAttrRecordId,
         wszAttrSamAccountName,
         wszAttrObjectSid,
         wszAttrAccountFlags,
@@ -149,136 +156,151 @@ SamrSrvEnumDomainAccounts(
         BAIL_ON_NTSTATUS_ERROR(ntStatus);
     }
 
-    dwError = DirectorySearch(pConnCtx->hDirectory,
-                              pwszBase,
-                              dwScope,
-                              pwszFilter,
-                              wszAttributes,
-                              FALSE,
-                              &pEntries,
-                              &dwNumEntries);
-    BAIL_ON_LSA_ERROR(dwError);
-
     ntStatus = SamrSrvAllocateMemory(OUT_PPVOID(&pNames),
                                      sizeof(*pNames));
     BAIL_ON_NTSTATUS_ERROR(ntStatus);
 
-
-    if (dwResume >= dwNumEntries)
-    {
-        ntEnumStatus = STATUS_NO_MORE_ENTRIES;
-        BAIL_ON_NTSTATUS_ERROR(ntStatus);
-    }
+    /*
+     * The resume handle is the record id of the last account
+     * returned, so the directory is read a page at a time
+     * instead of being loaded whole on every call.
+     */
+    llCookie       = dwResume;
+    llLastRecordId = dwResume;
 
     dwTotalSize += sizeof(pNames->dwCount);
 
-    for (i = 0; i + dwResume < dwNumEntries; i++)
+    while (!bDone)
     {
-        pEntry = &(pEntries[i + dwResume]);
-
-        dwError = DirectoryGetEntryAttrValueByName(
-                                     pEntry,
-                                     wszAttrSamAccountName,
-                                     DIRECTORY_ATTR_TYPE_UNICODE_STRING,
-                                     &pwszName);
-        BAIL_ON_LSA_ERROR(dwError);
-
-        dwError = DirectoryGetEntryAttrValueByName(
-                                     pEntry,
-                                     wszAttrAccountFlags,
-                                     DIRECTORY_ATTR_TYPE_INTEGER,
-                                     &dwAccountFlags);
-        BAIL_ON_LSA_ERROR(dwError);
-
-        dwSize = 0;
-
-        if (dwFlagsFilter &&
-            !(dwAccountFlags & dwFlagsFilter))
-        {
-            continue;
-        }
-
-        dwError = LwWc16sLen(pwszName, &sNameLen);
+        dwError = DirectorySearchPaged(pConnCtx->hDirectory,
+                                       pwszBase,
+                                       dwScope,
+                                       pwszFilter,
+                                       wszAttributes,
+                                       FALSE,
+                                       SAMR_ENUM_ACCOUNTS_PAGE_SIZE,
+                                       &llCookie,
+                                       &pEntries,
+                                       &dwNumEntries);
         BAIL_ON_LSA_ERROR(dwError);
 
-        dwSize += sizeof(UINT32);
-        dwSize += sNameLen * sizeof(pwszName[0]);
-        dwSize += 2 * sizeof(UINT16);
-
-        dwTotalSize += dwSize;
-        dwCount++;
-
-        if (dwTotalSize > dwMaxSize)
+        if (dwNumEntries == 0)
         {
-            dwTotalSize -= dwSize;
-            dwCount--;
+            if (bFirstPage)
+            {
+                ntEnumStatus = STATUS_NO_MORE_ENTRIES;
+            }
 
-            ntEnumStatus = STATUS_MORE_ENTRIES;
             break;
         }
-    }
 
-    /*
-     * At least one entry is returned regardless of declared
-     * max response size
-     */
-    dwNumEntriesReturned = (dwSize > 0 && dwCount == 0) ? 1 : dwCount;
-
-    pNames->dwCount = dwNumEntriesReturned;
-    ntStatus = SamrSrvAllocateMemory(
-                           OUT_PPVOID(&pNames->pEntries),
-                           sizeof(pNames->pEntries[0]) * pNames->dwCount);
-    BAIL_ON_NTSTATUS_ERROR(ntStatus);
-
-    for (i = 0, dwCount = 0;
-         dwCount < dwNumEntriesReturned && i + dwResume < dwNumEntries;
-         i++)
-    {
-        pEntry = &(pEntries[i + dwResume]);
-
-        dwError = DirectoryGetEntryAttrValueByName(pEntry,
-                                                   wszAttrObjectSid,
-                                                   DIRECTORY_ATTR_TYPE_UNICODE_STRING,
-                                                   &pwszSid);
-        BAIL_ON_LSA_ERROR(dwError);
-
-        dwError = DirectoryGetEntryAttrValueByName(pEntry,
-                                                   wszAttrSamAccountName,
-                                                   DIRECTORY_ATTR_TYPE_UNICODE_STRING,
-                                                   &pwszName);
-        BAIL_ON_LSA_ERROR(dwError);
+        bFirstPage = FALSE;
 
-        dwError = DirectoryGetEntryAttrValueByName(pEntry,
-                                                   wszAttrAccountFlags,
-                                                   DIRECTORY_ATTR_TYPE_INTEGER,
-                                                   &dwAccountFlags);
-        BAIL_ON_LSA_ERROR(dwError);
-
-        dwNewResumeIdx = i + dwResume + 1;
-
-        if (dwFlagsFilter &&
-            !(dwAccountFlags & dwFlagsFilter))
+        for (i = 0; i < dwNumEntries; i++)
         {
-            continue;
+            pEntry = &(pEntries[i]);
+
+            dwError = DirectoryGetEntryAttrValueByName(
+                                         pEntry,
+                                         wszAttrRecordId,
+                                         DIRECTORY_ATTR_TYPE_LARGE_INTEGER,
+                                         &llRecordId);
+            BAIL_ON_LSA_ERROR(dwError);
+
+            dwError = DirectoryGetEntryAttrValueByName(
+                                         pEntry,
+                                         wszAttrSamAccountName,
+                                         DIRECTORY_ATTR_TYPE_UNICODE_STRING,
+                                         &pwszName);
+            BAIL_ON_LSA_ERROR(dwError);
+
+            dwError = DirectoryGetEntryAttrValueByName(
+                                         pEntry,
+                                         wszAttrAccountFlags,
+                                         DIRECTORY_ATTR_TYPE_INTEGER,
+                                         &dwAccountFlags);
+            BAIL_ON_LSA_ERROR(dwError);
+
+            if (dwFlagsFilter &&
+                !(dwAccountFlags & dwFlagsFilter))
+            {
+                llLastRecordId = llRecordId;
+                continue;
+            }
+
+            dwError = LwWc16sLen(pwszName, &sNameLen);
+            BAIL_ON_LSA_ERROR(dwError);
+
+            dwSize  = sizeof(UINT32);
+            dwSize += sNameLen * sizeof(pwszName[0]);
+            dwSize += 2 * sizeof(UINT16);
+
+            /*
+             * At least one entry is returned regardless of declared
+             * max response size
+             */
+            if (dwCount > 0 &&
+                dwTotalSize + dwSize > dwMaxSize)
+            {
+                ntEnumStatus = STATUS_MORE_ENTRIES;
+                bDone = TRUE;
+                break;
+            }
+
+            dwError = DirectoryGetEntryAttrValueByName(
+                                         pEntry,
+                                         wszAttrObjectSid,
+                                         DIRECTORY_ATTR_TYPE_UNICODE_STRING,
+                                         &pwszSid);
+            BAIL_ON_LSA_ERROR(dwError);
+
+            if (dwCount == dwAllocCount)
+            {
+                dwAllocCount = dwAllocCount ? dwAllocCount * 2 : 16;
+
+                ntStatus = SamrSrvAllocateMemory(
+                                       OUT_PPVOID(&pNewEntries),
+                                       sizeof(pNewEntries[0]) * dwAllocCount);
+                BAIL_ON_NTSTATUS_ERROR(ntStatus);
+
+                if (pNames->pEntries)
+                {
+                    memcpy(pNewEntries,
+                           pNames->pEntries,
+                           sizeof(pNewEntries[0]) * dwCount);
+                    SamrSrvFreeMemory(pNames->pEntries);
+                }
+
+                pNames->pEntries = pNewEntries;
+                pNewEntries      = NULL;
+            }
+
+            pName = &(pNames->pEntries[dwCount]);
+
+            ntStatus = RtlAllocateSidFromWC16String(&pSid, pwszSid);
+            BAIL_ON_NTSTATUS_ERROR(ntStatus);
+
+            dwRid        = pSid->SubAuthority[pSid->SubAuthorityCount - 1];
+            pName->dwRid = (UINT32)dwRid;
+
+            ntStatus = SamrSrvInitUnicodeString(&pName->Name,
+                                                pwszName);
+            BAIL_ON_NTSTATUS_ERROR(ntStatus);
+
+            RTL_FREE(&pSid);
+
+            pNames->dwCount = ++dwCount;
+            dwTotalSize    += dwSize;
+            llLastRecordId  = llRecordId;
         }
 
-        pName = &(pNames->pEntries[dwCount++]);
-
-        ntStatus = RtlAllocateSidFromWC16String(&pSid, pwszSid);
-        BAIL_ON_NTSTATUS_ERROR(ntStatus);
-
-        dwRid        = pSid->SubAuthority[pSid->SubAuthorityCount - 1];
-        pName->dwRid = (UINT32)dwRid;
-
-        ntStatus = SamrSrvInitUnicodeString(&pName->Name,
-                                            pwszName);
-        BAIL_ON_NTSTATUS_ERROR(ntStatus);
-
-        RTL_FREE(&pSid);
+        DirectoryFreeEntries(pEntries, dwNumEntries);
+        pEntries     = NULL;
+        dwNumEntries = 0;
     }
 
-    *pdwResume      = dwNewResumeIdx;
-    *pdwNumEntries  = dwNumEntriesReturned;
+    *pdwResume      = (DWORD)llLastRecordId;
+    *pdwNumEntries  = dwCount;
     *ppNames        = pNames;
 
 cleanup:
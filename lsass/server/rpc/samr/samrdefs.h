@@ -175,6 +175,9 @@
 #define SAMR_BUILTIN_DOMAIN_NAME \
     {'B','U','I','L','T','I','N',0}
 
+/* Accounts fetched from the directory per round trip while enumerating */
+#define SAMR_ENUM_ACCOUNTS_PAGE_SIZE     (64)
+
 
 #define BAIL_ON_NTSTATUS_ERROR(status)                   \
     do {                                                 \
@@ -266,6 +266,7 @@ DirectoryValidateProvider(
         !pProvider->pProviderFnTbl->pfnDirectoryRemoveFromGroup ||
         !pProvider->pProviderFnTbl->pfnDirectoryOpen ||
         !pProvider->pProviderFnTbl->pfnDirectorySearch ||
+        !pProvider->pProviderFnTbl->pfnDirectorySearchPaged ||
         !pProvider->pProviderFnTbl->pfnDirectoryGetUserCount ||
         !pProvider->pProviderFnTbl->pfnDirectoryGetGroupCount)
     {
@@ -83,3 +83,43 @@ error:
 
     return dwError;
 }
+
+DWORD
+DirectorySearchPaged(
+    HANDLE            hDirectory,
+    PWSTR             pwszBase,
+    ULONG             ulScope,
+    PWSTR             pwszFilter,
+    PWSTR             wszAttributes[],
+    ULONG             ulAttributesOnly,
+    ULONG             ulPageSize,
+    PLONG64           pllCookie,
+    PDIRECTORY_ENTRY* ppDirectoryEntries,
+    PDWORD            pdwNumEntries
+    )
+{
+    DWORD dwError = 0;
+    PDIRECTORY_CONTEXT pContext = (PDIRECTORY_CONTEXT)hDirectory;
+
+    if (!pContext || !pContext->pProvider)
+    {
+        dwError = LW_ERROR_INVALID_PARAMETER;
+        BAIL_ON_DIRECTORY_ERROR(dwError);
+    }
+
+    dwError = pContext->pProvider->pProviderFnTbl->pfnDirectorySearchPaged(
+                    pContext->hBindHandle,
+                    pwszBase,
+                    ulScope,
+                    pwszFilter,
+                    wszAttributes,
+                    ulAttributesOnly,
+                    ulPageSize,
+                    pllCookie,
+                    ppDirectoryEntries,
+                    pdwNumEntries);
+
+error:
+
+    return dwError;
+}
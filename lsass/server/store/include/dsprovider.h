@@ -75,6 +75,19 @@ typedef DWORD (*PFNDIRECTORYSEARCH)(
                     PDWORD            pdwNumEntries
                     );
 
+typedef DWORD (*PFNDIRECTORYSEARCHPAGED)(
+                    HANDLE            hDirectory,
+                    PWSTR             pwszBase,
+                    ULONG             ulScope,
+                    PWSTR             pwszFilter,
+                    PWSTR             wszAttributes[],
+                    ULONG             ulAttributesOnly,
+                    ULONG             ulPageSize,
+                    PLONG64           pllCookie,
+                    PDIRECTORY_ENTRY* ppDirectoryEntries,
+                    PDWORD            pdwNumEntries
+                    );
+
 typedef DWORD (*PFNDIRECTORYGETUSERCOUNT)(
                     HANDLE hDirectory,
                     PDWORD pdwNumUsers
@@ -109,6 +122,7 @@ typedef struct __LSA_DIRECTORY_PROVIDER_FUNCTION_TABLE
     PFNDIRECTORYMANAGEMEMBER   pfnDirectoryRemoveFromGroup;
     PFNDIRECTORYDELETE         pfnDirectoryDelete;
     PFNDIRECTORYSEARCH         pfnDirectorySearch;
+    PFNDIRECTORYSEARCHPAGED    pfnDirectorySearchPaged;
     PFNDIRECTORYGETUSERCOUNT   pfnDirectoryGetUserCount;
     PFNDIRECTORYGETGROUPCOUNT  pfnDirectoryGetGroupCount;
     PFNDIRECTORYCLOSE          pfnDirectoryClose;
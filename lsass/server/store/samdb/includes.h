@@ -60,6 +60,7 @@
 #include "samdbdn.h"
 #include "samdbmisc.h"
 #include "samdbcontext.h"
+#include "samdbstmt.h"
 #include "samdbcounter.h"
 #include "samdbtrans.h"
 #include "samdbschema.h"
@@ -95,6 +95,20 @@ SamDbSearchObject(
     PDWORD            pdwNumEntries
     );
 
+DWORD
+SamDbSearchObjectPaged(
+    HANDLE            hDirectory,
+    PWSTR             pwszBase,
+    ULONG             ulScope,
+    PWSTR             pwszFilter,
+    PWSTR             wszAttributes[],
+    ULONG             ulAttributesOnly,
+    ULONG             ulPageSize,
+    PLONG64           pllCookie,
+    PDIRECTORY_ENTRY* ppDirectoryEntries,
+    PDWORD            pdwNumEntries
+    );
+
 DWORD
 SamDbSearchObject_inlock(
     HANDLE            hDirectory,
@@ -139,6 +139,9 @@ SamDbAcquireDbContext(
                         pszDbPath,
                         &pDbContext->pDbHandle);
         BAIL_ON_SAMDB_ERROR(dwError);
+
+        dwError = SamDbInitStatementCache(pDbContext);
+        BAIL_ON_SAMDB_ERROR(dwError);
     }
 
     *ppDbContext = pDbContext;
@@ -229,6 +232,8 @@ SamDbFreeDbContext(
         sqlite3_finalize(pDbContext->pQueryObjectRecordInfoStmt);
     }
 
+    SamDbFreeStatementCache(pDbContext);
+
     if (pDbContext->pDbHandle)
     {
         sqlite3_close(pDbContext->pDbHandle);
@@ -56,6 +56,8 @@
 
 #define SAM_DB_CONTEXT_POOL_MAX_ENTRIES 10
 
+#define SAM_DB_STMT_CACHE_SIZE          16
+
 #define SAM_DB_DEFAULT_ADMINISTRATOR_SHELL   "/bin/sh"
 #define SAM_DB_DEFAULT_ADMINISTRATOR_HOMEDIR "/"
 
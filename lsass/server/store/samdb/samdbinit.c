@@ -165,6 +165,7 @@ DirectoryInitializeProvider(
                 .pfnDirectoryRemoveFromGroup = &SamDbRemoveFromGroup,
                 .pfnDirectoryDelete          = &SamDbDeleteObject,
                 .pfnDirectorySearch          = &SamDbSearchObject,
+                .pfnDirectorySearchPaged     = &SamDbSearchObjectPaged,
                 .pfnDirectoryGetUserCount    = &SamDbGetUserCount,
                 .pfnDirectoryGetGroupCount   = &SamDbGetGroupCount,
                 .pfnDirectoryClose           = &SamDbClose
@@ -50,6 +50,44 @@
 
 #include "includes.h"
 
+static
+DWORD
+SamDbSearch_inlock(
+    HANDLE            hDirectory,
+    PWSTR             pwszFilter,
+    PWSTR             wszAttributes[],
+    ULONG             ulAttributesOnly,
+    PLONG64           pllPageStart,
+    ULONG             ulPageSize,
+    PDIRECTORY_ENTRY* ppDirectoryEntries,
+    PDWORD            pdwNumEntries
+    );
+
+static
+DWORD
+SamDbNormalizeFilter(
+    PCSTR                pszFilter,
+    PSTR*                ppszFilter,
+    PSAM_DB_QUERY_PARAM* ppParams,
+    PDWORD               pdwNumParams,
+    PBOOLEAN             pbHasTrailingClause
+    );
+
+static
+DWORD
+SamDbAddQueryParam(
+    PSAM_DB_QUERY_PARAM* ppParams,
+    PDWORD               pdwNumParams,
+    PSAM_DB_QUERY_PARAM* ppParam
+    );
+
+static
+VOID
+SamDbFreeQueryParams(
+    PSAM_DB_QUERY_PARAM pParams,
+    DWORD               dwNumParams
+    );
+
 static
 DWORD
 SamDbBuildSqlQuery(
@@ -57,7 +95,11 @@ SamDbBuildSqlQuery(
     PWSTR                  pwszFilter,
     PWSTR                  wszAttributes[],
     ULONG                  ulAttributesOnly,
+    PLONG64                pllPageStart,
+    ULONG                  ulPageSize,
     PSTR*                  ppszQuery,
+    PSAM_DB_QUERY_PARAM*   ppParams,
+    PDWORD                 pdwNumParams,
     PBOOLEAN               pbMembersAttrExists,
     PSAM_DB_COLUMN_VALUE*  ppColumnValueList
     );
@@ -67,8 +109,11 @@ DWORD
 SamDbSearchExecute(
     PSAM_DIRECTORY_CONTEXT pDirectoryContext,
     PCSTR                  pszQuery,
+    PSAM_DB_QUERY_PARAM    pParams,
+    DWORD                  dwNumParams,
     PSAM_DB_COLUMN_VALUE   pColumnValueList,
     ULONG                  ulAttributesOnly,
+    PLONG64                pllLastRecordId,
     PDIRECTORY_ENTRY*      ppDirectoryEntries,
     PDWORD                 pdwNumEntries
     );
@@ -89,8 +134,11 @@ DWORD
 SamDbSearchMarshallResultsAttributesValues(
     PSAM_DIRECTORY_CONTEXT pDirectoryContext,
     PCSTR                  pszQuery,
+    PSAM_DB_QUERY_PARAM    pParams,
+    DWORD                  dwNumParams,
     PSAM_DB_COLUMN_VALUE   pColumnValueList,
     ULONG                  ulAttributesOnly,
+    PLONG64                pllLastRecordId,
     PDIRECTORY_ENTRY*      ppDirectoryEntries,
     PDWORD                 pdwNumEntries
     );
@@ -141,14 +189,91 @@ SamDbSearchObject_inlock(
     PDIRECTORY_ENTRY* ppDirectoryEntries,
     PDWORD            pdwNumEntries
     )
+{
+    return SamDbSearch_inlock(
+                    hDirectory,
+                    pwszFilter,
+                    wszAttributes,
+                    ulAttributesOnly,
+                    NULL,
+                    0,
+                    ppDirectoryEntries,
+                    pdwNumEntries);
+}
+
+/*
+ * Returns up to ulPageSize entries matching pwszFilter whose record id
+ * is greater than *pllCookie, in record id order, and advances
+ * *pllCookie past the last one returned.  Start with a cookie of 0;
+ * an empty page means the search is complete.  Nothing is held
+ * between pages, so callers may keep the cookie across requests.
+ */
+DWORD
+SamDbSearchObjectPaged(
+    HANDLE            hDirectory,
+    PWSTR             pwszBase,
+    ULONG             ulScope,
+    PWSTR             pwszFilter,
+    PWSTR             wszAttributes[],
+    ULONG             ulAttributesOnly,
+    ULONG             ulPageSize,
+    PLONG64           pllCookie,
+    PDIRECTORY_ENTRY* ppDirectoryEntries,
+    PDWORD            pdwNumEntries
+    )
+{
+    DWORD dwError = 0;
+    BOOLEAN bInLock = FALSE;
+
+    if (!pllCookie || !ulPageSize || ulAttributesOnly)
+    {
+        dwError = LW_ERROR_INVALID_PARAMETER;
+        BAIL_ON_SAMDB_ERROR(dwError);
+    }
+
+    SAMDB_LOCK_RWMUTEX_SHARED(bInLock, &gSamGlobals.rwLock);
+
+    dwError = SamDbSearch_inlock(
+                    hDirectory,
+                    pwszFilter,
+                    wszAttributes,
+                    ulAttributesOnly,
+                    pllCookie,
+                    ulPageSize,
+                    ppDirectoryEntries,
+                    pdwNumEntries);
+    BAIL_ON_SAMDB_ERROR(dwError);
+
+error:
+
+    SAMDB_UNLOCK_RWMUTEX(bInLock, &gSamGlobals.rwLock);
+
+    return dwError;
+}
+
+static
+DWORD
+SamDbSearch_inlock(
+    HANDLE            hDirectory,
+    PWSTR             pwszFilter,
+    PWSTR             wszAttributes[],
+    ULONG             ulAttributesOnly,
+    PLONG64           pllPageStart,
+    ULONG             ulPageSize,
+    PDIRECTORY_ENTRY* ppDirectoryEntries,
+    PDWORD            pdwNumEntries
+    )
 {
     DWORD dwError = 0;
     PSAM_DIRECTORY_CONTEXT pDirectoryContext = NULL;
     PSTR  pszQuery = NULL;
+    PSAM_DB_QUERY_PARAM pParams = NULL;
+    DWORD dwNumParams = 0;
     BOOLEAN bMembersAttrExists = FALSE;
     PSAM_DB_COLUMN_VALUE pColumnValueList = NULL;
     PDIRECTORY_ENTRY pDirectoryEntries = NULL;
     DWORD            dwNumEntries = 0;
+    LONG64           llLastRecordId = 0;
 
     pDirectoryContext = (PSAM_DIRECTORY_CONTEXT)hDirectory;
 
@@ -157,7 +282,11 @@ SamDbSearchObject_inlock(
                     pwszFilter,
                     wszAttributes,
                     ulAttributesOnly,
+                    pllPageStart,
+                    ulPageSize,
                     &pszQuery,
+                    &pParams,
+                    &dwNumParams,
                     &bMembersAttrExists,
                     &pColumnValueList);
     BAIL_ON_SAMDB_ERROR(dwError);
@@ -165,12 +294,20 @@ SamDbSearchObject_inlock(
     dwError = SamDbSearchExecute(
                     pDirectoryContext,
                     pszQuery,
+                    pParams,
+                    dwNumParams,
                     pColumnValueList,
                     ulAttributesOnly,
+                    pllPageStart ? &llLastRecordId : NULL,
                     &pDirectoryEntries,
                     &dwNumEntries);
     BAIL_ON_SAMDB_ERROR(dwError);
 
+    if (pllPageStart && dwNumEntries)
+    {
+        *pllPageStart = llLastRecordId;
+    }
+
     *ppDirectoryEntries = pDirectoryEntries;
     *pdwNumEntries = dwNumEntries;
 
@@ -181,12 +318,17 @@ cleanup:
         SamDbFreeColumnValueList(pColumnValueList);
     }
 
+    SamDbFreeQueryParams(pParams, dwNumParams);
+
     DIRECTORY_FREE_STRING(pszQuery);
 
     return(dwError);
 
 error:
 
+    *ppDirectoryEntries = NULL;
+    *pdwNumEntries = 0;
+
     if (pDirectoryEntries)
     {
         DirectoryFreeEntries(pDirectoryEntries, dwNumEntries);
@@ -195,11 +337,266 @@ error:
     goto cleanup;
 }
 
+static
+DWORD
+SamDbAddQueryParam(
+    PSAM_DB_QUERY_PARAM* ppParams,
+    PDWORD               pdwNumParams,
+    PSAM_DB_QUERY_PARAM* ppParam
+    )
+{
+    DWORD dwError = 0;
+    PSAM_DB_QUERY_PARAM pParams = *ppParams;
+    DWORD dwNumParams = *pdwNumParams;
+
+    /* Grow in steps of 8 */
+    if (!(dwNumParams % 8))
+    {
+        dwError = DirectoryReallocMemory(
+                        pParams,
+                        (PVOID*)&pParams,
+                        (dwNumParams + 8) * sizeof(SAM_DB_QUERY_PARAM));
+        BAIL_ON_SAMDB_ERROR(dwError);
+
+        memset(&pParams[dwNumParams], 0, 8 * sizeof(SAM_DB_QUERY_PARAM));
+
+        *ppParams = pParams;
+    }
+
+    *ppParam = &pParams[dwNumParams];
+    *pdwNumParams = dwNumParams + 1;
+
+error:
+
+    return dwError;
+}
+
+static
+VOID
+SamDbFreeQueryParams(
+    PSAM_DB_QUERY_PARAM pParams,
+    DWORD               dwNumParams
+    )
+{
+    DWORD iParam = 0;
+
+    if (pParams)
+    {
+        for (iParam = 0; iParam < dwNumParams; iParam++)
+        {
+            DIRECTORY_FREE_STRING(pParams[iParam].pszValue);
+        }
+
+        DirectoryFreeMemory(pParams);
+    }
+}
+
+/*
+ * Rewrites the SQL filter so that single-quoted strings and integer
+ * literals become '?' parameters, returning their values in order.
+ * Searches that differ only in their values then produce the same SQL
+ * and share a cached statement.  Double-quoted tokens are left alone
+ * since sqlite may resolve them as column names.  Everything from an
+ * ORDER BY, GROUP BY or LIMIT clause on is copied verbatim and reported
+ * through pbHasTrailingClause.
+ */
+static
+DWORD
+SamDbNormalizeFilter(
+    PCSTR                pszFilter,
+    PSTR*                ppszFilter,
+    PSAM_DB_QUERY_PARAM* ppParams,
+    PDWORD               pdwNumParams,
+    PBOOLEAN             pbHasTrailingClause
+    )
+{
+    DWORD dwError = 0;
+    PSTR pszOutput = NULL;
+    PSTR pszOut = NULL;
+    PCSTR pszIn = pszFilter;
+    PCSTR pszToken = NULL;
+    PSAM_DB_QUERY_PARAM pParams = NULL;
+    PSAM_DB_QUERY_PARAM pParam = NULL;
+    DWORD dwNumParams = 0;
+    BOOLEAN bVerbatim = FALSE;
+    BOOLEAN bHasTrailingClause = FALSE;
+    PSTR pszValue = NULL;
+    LONG64 llValue = 0;
+    size_t sLen = 0;
+    char chClose = 0;
+
+    dwError = DirectoryAllocateMemory(
+                    strlen(pszFilter) + 1,
+                    (PVOID*)&pszOutput);
+    BAIL_ON_SAMDB_ERROR(dwError);
+
+    pszOut = pszOutput;
+
+    while (*pszIn)
+    {
+        if (bVerbatim)
+        {
+            *pszOut++ = *pszIn++;
+        }
+        else if (*pszIn == '\'')
+        {
+            pszToken = ++pszIn;
+            sLen = 0;
+
+            while (*pszIn && (*pszIn != '\'' || pszIn[1] == '\''))
+            {
+                pszIn += (*pszIn == '\'') ? 2 : 1;
+                sLen++;
+            }
+
+            if (!*pszIn)
+            {
+                /* Unterminated, let sqlite report it */
+                pszIn = pszToken - 1;
+                bVerbatim = TRUE;
+                continue;
+            }
+
+            dwError = DirectoryAllocateMemory(sLen + 1, (PVOID*)&pszValue);
+            BAIL_ON_SAMDB_ERROR(dwError);
+
+            for (sLen = 0; pszToken < pszIn; sLen++)
+            {
+                pszValue[sLen] = *pszToken;
+                pszToken += (*pszToken == '\'') ? 2 : 1;
+            }
+
+            dwError = SamDbAddQueryParam(&pParams, &dwNumParams, &pParam);
+            BAIL_ON_SAMDB_ERROR(dwError);
+
+            pParam->pszValue = pszValue;
+            pszValue = NULL;
+
+            *pszOut++ = '?';
+            pszIn++;
+        }
+        else if (*pszIn == '"' || *pszIn == '`' || *pszIn == '[')
+        {
+            chClose = (*pszIn == '[') ? ']' : *pszIn;
+
+            *pszOut++ = *pszIn++;
+            while (*pszIn && *pszIn != chClose)
+            {
+                *pszOut++ = *pszIn++;
+            }
+            if (*pszIn)
+            {
+                *pszOut++ = *pszIn++;
+            }
+        }
+        else if (isalpha((int)*pszIn) || *pszIn == '_')
+        {
+            pszToken = pszIn;
+
+            while (isalnum((int)*pszIn) || *pszIn == '_' || *pszIn == '$')
+            {
+                *pszOut++ = *pszIn++;
+            }
+
+            sLen = pszIn - pszToken;
+
+            if (sLen == 1 && toupper((int)*pszToken) == 'X' && *pszIn == '\'')
+            {
+                /* Blob literal */
+                *pszOut++ = *pszIn++;
+                while (*pszIn && *pszIn != '\'')
+                {
+                    *pszOut++ = *pszIn++;
+                }
+                if (*pszIn)
+                {
+                    *pszOut++ = *pszIn++;
+                }
+            }
+            else if (sLen == 5 &&
+                     (!strncasecmp(pszToken, "ORDER", 5) ||
+                      !strncasecmp(pszToken, "GROUP", 5) ||
+                      !strncasecmp(pszToken, "LIMIT", 5)))
+            {
+                bHasTrailingClause = TRUE;
+                bVerbatim = TRUE;
+            }
+        }
+        else if (isdigit((int)*pszIn))
+        {
+            pszToken = pszIn;
+
+            while (isdigit((int)*pszIn))
+            {
+                pszIn++;
+            }
+
+            errno = 0;
+            llValue = strtoll(pszToken, NULL, 10);
+
+            if (*pszIn == '.' || isalpha((int)*pszIn) || *pszIn == '_' ||
+                errno == ERANGE)
+            {
+                /* Real, hex or out of range; keep it as written */
+                pszIn = pszToken;
+                while (isalnum((int)*pszIn) || *pszIn == '.' ||
+                       ((*pszIn == '+' || *pszIn == '-') &&
+                        toupper((int)pszIn[-1]) == 'E'))
+                {
+                    *pszOut++ = *pszIn++;
+                }
+            }
+            else
+            {
+                dwError = SamDbAddQueryParam(&pParams, &dwNumParams, &pParam);
+                BAIL_ON_SAMDB_ERROR(dwError);
+
+                pParam->bIsInteger = TRUE;
+                pParam->llValue = llValue;
+
+                *pszOut++ = '?';
+            }
+        }
+        else
+        {
+            *pszOut++ = *pszIn++;
+        }
+    }
+
+    *ppszFilter = pszOutput;
+    *ppParams = pParams;
+    *pdwNumParams = dwNumParams;
+    *pbHasTrailingClause = bHasTrailingClause;
+
+cleanup:
+
+    DIRECTORY_FREE_STRING(pszValue);
+
+    return dwError;
+
+error:
+
+    *ppszFilter = NULL;
+    *ppParams = NULL;
+    *pdwNumParams = 0;
+    *pbHasTrailingClause = FALSE;
+
+    DIRECTORY_FREE_STRING(pszOutput);
+    SamDbFreeQueryParams(pParams, dwNumParams);
+
+    goto cleanup;
+}
+
 #define SAM_DB_SEARCH_QUERY_PREFIX          "SELECT "
 #define SAM_DB_SEARCH_QUERY_FIELD_SEPARATOR ","
 #define SAM_DB_SEARCH_QUERY_FROM            " FROM " SAM_DB_OBJECTS_TABLE " "
 #define SAM_DB_SEARCH_QUERY_WHERE           " WHERE "
 #define SAM_DB_SEARCH_QUERY_SUFFIX          ";"
+#define SAM_DB_SEARCH_QUERY_PAGE_COLUMN     SAM_DB_COL_RECORD_ID
+#define SAM_DB_SEARCH_QUERY_PAGE_OPEN       "("
+#define SAM_DB_SEARCH_QUERY_PAGE_CLOSE      ") AND "
+#define SAM_DB_SEARCH_QUERY_PAGE_LIMIT \
+    SAM_DB_COL_RECORD_ID " > ? ORDER BY " SAM_DB_COL_RECORD_ID " LIMIT ?"
 
 static
 DWORD
@@ -208,13 +605,19 @@ SamDbBuildSqlQuery(
     PWSTR                  pwszFilter,
     PWSTR                  wszAttributes[],
     ULONG                  ulAttributesOnly,
+    PLONG64                pllPageStart,
+    ULONG                  ulPageSize,
     PSTR*                  ppszQuery,
+    PSAM_DB_QUERY_PARAM*   ppParams,
+    PDWORD                 pdwNumParams,
     PBOOLEAN               pbMembersAttrExists,
     PSAM_DB_COLUMN_VALUE*  ppColumnValueList
     )
 {
     DWORD dwError = 0;
     BOOLEAN bMembersAttrExists = FALSE;
+    BOOLEAN bHasTrailingClause = FALSE;
+    BOOLEAN bHasFilter = FALSE;
     DWORD dwQueryLen = 0;
     DWORD dwColNamesLen = 0;
     DWORD dwNumAttrs = 0;
@@ -222,6 +625,10 @@ SamDbBuildSqlQuery(
     PSTR  pszQueryCursor = NULL;
     PSTR  pszCursor = NULL;
     PSTR  pszFilter = NULL;
+    PSTR  pszNormalFilter = NULL;
+    PSAM_DB_QUERY_PARAM pParams = NULL;
+    PSAM_DB_QUERY_PARAM pParam = NULL;
+    DWORD dwNumParams = 0;
     PSAM_DB_COLUMN_VALUE pColumnValueList = NULL;
     PSAM_DB_COLUMN_VALUE pIter = NULL;
 
@@ -233,6 +640,23 @@ SamDbBuildSqlQuery(
         BAIL_ON_SAMDB_ERROR(dwError);
 
         LwStripWhitespace(pszFilter, TRUE, TRUE);
+
+        dwError = SamDbNormalizeFilter(
+                        pszFilter,
+                        &pszNormalFilter,
+                        &pParams,
+                        &dwNumParams,
+                        &bHasTrailingClause);
+        BAIL_ON_SAMDB_ERROR(dwError);
+
+        bHasFilter = (*pszNormalFilter != '\0');
+    }
+
+    if (pllPageStart && bHasTrailingClause)
+    {
+        /* Paging supplies its own ordering and limit */
+        dwError = LW_ERROR_INVALID_PARAMETER;
+        BAIL_ON_SAMDB_ERROR(dwError);
     }
 
     while (wszAttributes[dwNumAttrs])
@@ -282,14 +706,40 @@ SamDbBuildSqlQuery(
         dwNumAttrs++;
     }
 
+    if (pllPageStart)
+    {
+        /* Trailing record id column drives the next page */
+        if (dwColNamesLen)
+        {
+            dwColNamesLen += sizeof(SAM_DB_SEARCH_QUERY_FIELD_SEPARATOR)-1;
+        }
+
+        dwColNamesLen += sizeof(SAM_DB_SEARCH_QUERY_PAGE_COLUMN) - 1;
+    }
+
     dwQueryLen = sizeof(SAM_DB_SEARCH_QUERY_PREFIX) - 1;
     dwQueryLen += dwColNamesLen;
     dwQueryLen += sizeof(SAM_DB_SEARCH_QUERY_FROM) - 1;
 
-    if (pszFilter && *pszFilter)
+    if (bHasFilter || pllPageStart)
     {
         dwQueryLen += sizeof(SAM_DB_SEARCH_QUERY_WHERE) - 1;
-        dwQueryLen += strlen(pszFilter);
+    }
+
+    if (bHasFilter)
+    {
+        dwQueryLen += strlen(pszNormalFilter);
+    }
+
+    if (pllPageStart)
+    {
+        if (bHasFilter)
+        {
+            dwQueryLen += sizeof(SAM_DB_SEARCH_QUERY_PAGE_OPEN) - 1;
+            dwQueryLen += sizeof(SAM_DB_SEARCH_QUERY_PAGE_CLOSE) - 1;
+        }
+
+        dwQueryLen += sizeof(SAM_DB_SEARCH_QUERY_PAGE_LIMIT) - 1;
     }
     dwQueryLen += sizeof(SAM_DB_SEARCH_QUERY_SUFFIX) - 1;
     dwQueryLen++;
@@ -330,25 +780,85 @@ SamDbBuildSqlQuery(
         }
     }
 
+    if (pllPageStart)
+    {
+        if (dwColNamesLen)
+        {
+            pszCursor = SAM_DB_SEARCH_QUERY_FIELD_SEPARATOR;
+            while (pszCursor && *pszCursor)
+            {
+                *pszQueryCursor++ = *pszCursor++;
+            }
+        }
+
+        pszCursor = SAM_DB_SEARCH_QUERY_PAGE_COLUMN;
+        while (pszCursor && *pszCursor)
+        {
+            *pszQueryCursor++ = *pszCursor++;
+        }
+    }
+
     pszCursor = SAM_DB_SEARCH_QUERY_FROM;
     while (pszCursor && *pszCursor)
     {
         *pszQueryCursor++ = *pszCursor++;
     }
 
-    if (pszFilter && *pszFilter)
+    if (bHasFilter || pllPageStart)
     {
         pszCursor = SAM_DB_SEARCH_QUERY_WHERE;
         while (pszCursor && *pszCursor)
         {
             *pszQueryCursor++ = *pszCursor++;
         }
+    }
+
+    if (bHasFilter && pllPageStart)
+    {
+        pszCursor = SAM_DB_SEARCH_QUERY_PAGE_OPEN;
+        while (pszCursor && *pszCursor)
+        {
+            *pszQueryCursor++ = *pszCursor++;
+        }
+    }
+
+    if (bHasFilter)
+    {
+        pszCursor = pszNormalFilter;
+        while (pszCursor && *pszCursor)
+        {
+            *pszQueryCursor++ = *pszCursor++;
+        }
+    }
 
-        pszCursor = pszFilter;
+    if (pllPageStart)
+    {
+        if (bHasFilter)
+        {
+            pszCursor = SAM_DB_SEARCH_QUERY_PAGE_CLOSE;
+            while (pszCursor && *pszCursor)
+            {
+                *pszQueryCursor++ = *pszCursor++;
+            }
+        }
+
+        pszCursor = SAM_DB_SEARCH_QUERY_PAGE_LIMIT;
         while (pszCursor && *pszCursor)
         {
             *pszQueryCursor++ = *pszCursor++;
         }
+
+        dwError = SamDbAddQueryParam(&pParams, &dwNumParams, &pParam);
+        BAIL_ON_SAMDB_ERROR(dwError);
+
+        pParam->bIsInteger = TRUE;
+        pParam->llValue = *pllPageStart;
+
+        dwError = SamDbAddQueryParam(&pParams, &dwNumParams, &pParam);
+        BAIL_ON_SAMDB_ERROR(dwError);
+
+        pParam->bIsInteger = TRUE;
+        pParam->llValue = ulPageSize;
     }
 
     pszCursor = SAM_DB_SEARCH_QUERY_SUFFIX;
@@ -358,22 +868,28 @@ SamDbBuildSqlQuery(
     }
 
     *ppszQuery = pszQuery;
+    *ppParams = pParams;
+    *pdwNumParams = dwNumParams;
     *pbMembersAttrExists = bMembersAttrExists;
     *ppColumnValueList = pColumnValueList;
 
 cleanup:
 
     DIRECTORY_FREE_STRING(pszFilter);
+    DIRECTORY_FREE_STRING(pszNormalFilter);
 
     return dwError;
 
 error:
 
     *ppszQuery = NULL;
+    *ppParams = NULL;
+    *pdwNumParams = 0;
     *pbMembersAttrExists = FALSE;
     *ppColumnValueList = NULL;
 
     DIRECTORY_FREE_STRING(pszQuery);
+    SamDbFreeQueryParams(pParams, dwNumParams);
 
     if (pColumnValueList)
     {
@@ -388,8 +904,11 @@ DWORD
 SamDbSearchExecute(
     PSAM_DIRECTORY_CONTEXT pDirectoryContext,
     PCSTR                  pszQuery,
+    PSAM_DB_QUERY_PARAM    pParams,
+    DWORD                  dwNumParams,
     PSAM_DB_COLUMN_VALUE   pColumnValueList,
     ULONG                  ulAttributesOnly,
+    PLONG64                pllLastRecordId,
     PDIRECTORY_ENTRY*      ppDirectoryEntries,
     PDWORD                 pdwNumEntries
     )
@@ -411,8 +930,11 @@ SamDbSearchExecute(
         dwError = SamDbSearchMarshallResultsAttributesValues(
                         pDirectoryContext,
                         pszQuery,
+                        pParams,
+                        dwNumParams,
                         pColumnValueList,
                         ulAttributesOnly,
+                        pllLastRecordId,
                         ppDirectoryEntries,
                         pdwNumEntries);
     }
@@ -535,8 +1057,11 @@ DWORD
 SamDbSearchMarshallResultsAttributesValues(
     PSAM_DIRECTORY_CONTEXT pDirectoryContext,
     PCSTR                  pszQuery,
+    PSAM_DB_QUERY_PARAM    pParams,
+    DWORD                  dwNumParams,
     PSAM_DB_COLUMN_VALUE   pColumnValueList,
     ULONG                  ulAttributesOnly,
+    PLONG64                pllLastRecordId,
     PDIRECTORY_ENTRY*      ppDirectoryEntries,
     PDWORD                 pdwNumEntries
     )
@@ -551,31 +1076,53 @@ SamDbSearchMarshallResultsAttributesValues(
     PSAM_DB_COLUMN_VALUE pIter = NULL;
     PDIRECTORY_ATTRIBUTE pAttrs = NULL;
     DWORD                dwNumAttrs = 0;
+    DWORD                iParam = 0;
 
     for (pIter = pColumnValueList; pIter; pIter = pIter->pNext)
     {
         dwNumCols++;
     }
 
-    dwError = sqlite3_prepare_v2(
-                    pDirectoryContext->pDbContext->pDbHandle,
+    dwError = SamDbAcquireStatement(
+                    pDirectoryContext->pDbContext,
                     pszQuery,
-                    -1,
-                    &pSqlStatement,
-                    NULL);
-    BAIL_ON_SAMDB_SQLITE_ERROR_DB(dwError, pDirectoryContext->pDbContext->pDbHandle);
+                    &pSqlStatement);
+    BAIL_ON_SAMDB_ERROR(dwError);
+
+    for (iParam = 0; iParam < dwNumParams; iParam++)
+    {
+        if (pParams[iParam].bIsInteger)
+        {
+            dwError = sqlite3_bind_int64(
+                            pSqlStatement,
+                            iParam + 1,
+                            pParams[iParam].llValue);
+        }
+        else
+        {
+            dwError = sqlite3_bind_text(
+                            pSqlStatement,
+                            iParam + 1,
+                            pParams[iParam].pszValue,
+                            -1,
+                            SQLITE_TRANSIENT);
+        }
+        BAIL_ON_SAMDB_SQLITE_ERROR_STMT(dwError, pSqlStatement);
+    }
 
     while ((dwError = sqlite3_step(pSqlStatement)) == SQLITE_ROW)
     {
         DWORD iCol = 0;
 
-        dwNumAttrs = sqlite3_column_count(pSqlStatement);
-        if (dwNumAttrs != dwNumCols)
+        if (sqlite3_column_count(pSqlStatement) !=
+            dwNumCols + (pllLastRecordId ? 1 : 0))
         {
             dwError = LW_ERROR_DATA_ERROR;
             BAIL_ON_SAMDB_ERROR(dwError);
         }
 
+        dwNumAttrs = dwNumCols;
+
         if (!dwEntriesAvailable)
         {
             DWORD dwNewEntryCount = dwTotalEntries + 5;
@@ -763,6 +1310,11 @@ SamDbSearchMarshallResultsAttributesValues(
             }
         }
 
+        if (pllLastRecordId)
+        {
+            *pllLastRecordId = sqlite3_column_int64(pSqlStatement, dwNumCols);
+        }
+
         pDirectoryEntries[dwNumEntries].ulNumAttributes = dwNumAttrs;
         pDirectoryEntries[dwNumEntries].pAttributes = pAttrs;
 
@@ -786,7 +1338,7 @@ cleanup:
 
     if (pSqlStatement)
     {
-        sqlite3_finalize(pSqlStatement);
+        SamDbReleaseStatement(pDirectoryContext->pDbContext, pSqlStatement);
     }
 
     return dwError;
@@ -0,0 +1,257 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ */
+
+/*
+ * Copyright Likewise Software
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        samdbstmt.c
+ *
+ * Abstract:
+ *
+ *
+ *      Likewise SAM Database Provider
+ *
+ *      Prepared statement cache
+ *
+ *      Each database context keeps the statements it prepared for
+ *      searches, keyed by SQL text.  Search filters are normalized so
+ *      literals become bound parameters, which lets repeated searches
+ *      that differ only in their values share one statement.
+ *
+ */
+
+#include "includes.h"
+
+DWORD
+SamDbInitStatementCache(
+    PSAM_DB_CONTEXT pDbContext
+    )
+{
+    DWORD dwError = 0;
+
+    dwError = LwMapErrnoToLwError(
+                    pthread_mutex_init(&pDbContext->stmtCacheMutex, NULL));
+    BAIL_ON_SAMDB_ERROR(dwError);
+
+    pDbContext->pStmtCacheMutex = &pDbContext->stmtCacheMutex;
+
+error:
+
+    return dwError;
+}
+
+/*
+ * Returns a statement for pszQuery with no bindings.  A cached
+ * statement is handed out to one caller at a time; when the matching
+ * one is busy (e.g. a nested search on the same context) an uncached
+ * statement is prepared instead.
+ */
+DWORD
+SamDbAcquireStatement(
+    PSAM_DB_CONTEXT pDbContext,
+    PCSTR           pszQuery,
+    sqlite3_stmt**  ppSqlStatement
+    )
+{
+    DWORD dwError = 0;
+    BOOLEAN bInLock = FALSE;
+    PSAM_DB_CACHED_STMT pEntry = NULL;
+    PSAM_DB_CACHED_STMT pVictim = NULL;
+    PSTR pszCachedQuery = NULL;
+    sqlite3_stmt* pSqlStatement = NULL;
+    DWORD iEntry = 0;
+
+    SAMDB_LOCK_MUTEX(bInLock, pDbContext->pStmtCacheMutex);
+
+    pDbContext->dwStmtCacheClock++;
+
+    for (iEntry = 0; iEntry < SAM_DB_STMT_CACHE_SIZE; iEntry++)
+    {
+        pEntry = &pDbContext->stmtCache[iEntry];
+
+        if (pEntry->bInUse)
+        {
+            continue;
+        }
+
+        if (pEntry->pszQuery && !strcmp(pEntry->pszQuery, pszQuery))
+        {
+            pEntry->bInUse = TRUE;
+            pEntry->dwLastUse = pDbContext->dwStmtCacheClock;
+
+            *ppSqlStatement = pEntry->pSqlStatement;
+            goto cleanup;
+        }
+
+        if (!pVictim ||
+            (pVictim->pszQuery &&
+             (!pEntry->pszQuery || pEntry->dwLastUse < pVictim->dwLastUse)))
+        {
+            pVictim = pEntry;
+        }
+    }
+
+    if (pVictim)
+    {
+        /* Hold the slot while preparing outside the lock */
+        pVictim->bInUse = TRUE;
+    }
+
+    SAMDB_UNLOCK_MUTEX(bInLock, pDbContext->pStmtCacheMutex);
+
+    dwError = sqlite3_prepare_v2(
+                    pDbContext->pDbHandle,
+                    pszQuery,
+                    -1,
+                    &pSqlStatement,
+                    NULL);
+    BAIL_ON_SAMDB_SQLITE_ERROR_DB(dwError, pDbContext->pDbHandle);
+
+    if (pVictim)
+    {
+        dwError = LwAllocateString(pszQuery, &pszCachedQuery);
+        BAIL_ON_SAMDB_ERROR(dwError);
+
+        if (pVictim->pSqlStatement)
+        {
+            sqlite3_finalize(pVictim->pSqlStatement);
+        }
+        LW_SAFE_FREE_STRING(pVictim->pszQuery);
+
+        SAMDB_LOCK_MUTEX(bInLock, pDbContext->pStmtCacheMutex);
+
+        pVictim->pszQuery = pszCachedQuery;
+        pVictim->pSqlStatement = pSqlStatement;
+        pVictim->dwLastUse = pDbContext->dwStmtCacheClock;
+
+        pszCachedQuery = NULL;
+    }
+
+    *ppSqlStatement = pSqlStatement;
+
+cleanup:
+
+    SAMDB_UNLOCK_MUTEX(bInLock, pDbContext->pStmtCacheMutex);
+
+    return dwError;
+
+error:
+
+    *ppSqlStatement = NULL;
+
+    if (pSqlStatement)
+    {
+        sqlite3_finalize(pSqlStatement);
+    }
+
+    LW_SAFE_FREE_STRING(pszCachedQuery);
+
+    if (pVictim)
+    {
+        /* The slot still holds its previous statement */
+        SAMDB_LOCK_MUTEX(bInLock, pDbContext->pStmtCacheMutex);
+
+        pVictim->bInUse = FALSE;
+    }
+
+    goto cleanup;
+}
+
+VOID
+SamDbReleaseStatement(
+    PSAM_DB_CONTEXT pDbContext,
+    sqlite3_stmt*   pSqlStatement
+    )
+{
+    BOOLEAN bInLock = FALSE;
+    DWORD iEntry = 0;
+
+    sqlite3_reset(pSqlStatement);
+    sqlite3_clear_bindings(pSqlStatement);
+
+    SAMDB_LOCK_MUTEX(bInLock, pDbContext->pStmtCacheMutex);
+
+    for (iEntry = 0; iEntry < SAM_DB_STMT_CACHE_SIZE; iEntry++)
+    {
+        if (pDbContext->stmtCache[iEntry].pSqlStatement == pSqlStatement)
+        {
+            pDbContext->stmtCache[iEntry].bInUse = FALSE;
+            pSqlStatement = NULL;
+            break;
+        }
+    }
+
+    SAMDB_UNLOCK_MUTEX(bInLock, pDbContext->pStmtCacheMutex);
+
+    if (pSqlStatement)
+    {
+        sqlite3_finalize(pSqlStatement);
+    }
+}
+
+VOID
+SamDbFreeStatementCache(
+    PSAM_DB_CONTEXT pDbContext
+    )
+{
+    PSAM_DB_CACHED_STMT pEntry = NULL;
+    DWORD iEntry = 0;
+
+    for (iEntry = 0; iEntry < SAM_DB_STMT_CACHE_SIZE; iEntry++)
+    {
+        pEntry = &pDbContext->stmtCache[iEntry];
+
+        if (pEntry->pSqlStatement)
+        {
+            sqlite3_finalize(pEntry->pSqlStatement);
+            pEntry->pSqlStatement = NULL;
+        }
+
+        LW_SAFE_FREE_STRING(pEntry->pszQuery);
+    }
+
+    if (pDbContext->pStmtCacheMutex)
+    {
+        pthread_mutex_destroy(pDbContext->pStmtCacheMutex);
+        pDbContext->pStmtCacheMutex = NULL;
+    }
+}
+
+
+/*
+local variables:
+mode: c
+c-basic-offset: 4
+indent-tabs-mode: nil
+tab-width: 4
+end:
+*/
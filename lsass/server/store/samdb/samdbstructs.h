@@ -59,6 +59,15 @@ typedef struct _SAMDB_OBJECTCLASS_TO_ATTR_MAP_INFO
 
 } SAMDB_OBJECTCLASS_TO_ATTR_MAP_INFO, *PSAMDB_OBJECTCLASS_TO_ATTR_MAP_INFO;
 
+typedef struct _SAM_DB_CACHED_STMT
+{
+    PSTR          pszQuery;
+    sqlite3_stmt* pSqlStatement;
+    BOOLEAN       bInUse;
+    DWORD         dwLastUse;
+
+} SAM_DB_CACHED_STMT, *PSAM_DB_CACHED_STMT;
+
 typedef struct _SAM_DB_CONTEXT
 {
     sqlite3* pDbHandle;
@@ -67,6 +76,11 @@ typedef struct _SAM_DB_CONTEXT
     sqlite3_stmt* pQueryObjectCountStmt;
     sqlite3_stmt* pQueryObjectRecordInfoStmt;
 
+    pthread_mutex_t    stmtCacheMutex;
+    pthread_mutex_t*   pStmtCacheMutex;
+    SAM_DB_CACHED_STMT stmtCache[SAM_DB_STMT_CACHE_SIZE];
+    DWORD              dwStmtCacheClock;
+
     struct _SAM_DB_CONTEXT* pNext;
 
 } SAM_DB_CONTEXT, *PSAM_DB_CONTEXT;
@@ -158,6 +172,14 @@ typedef struct _SAM_DB_COLUMN_VALUE
 
 } SAM_DB_COLUMN_VALUE, *PSAM_DB_COLUMN_VALUE;
 
+typedef struct _SAM_DB_QUERY_PARAM
+{
+    BOOLEAN bIsInteger;
+    LONG64  llValue;
+    PSTR    pszValue;
+
+} SAM_DB_QUERY_PARAM, *PSAM_DB_QUERY_PARAM;
+
 #endif /* __SAMDBSTRUCTS_H__ */
 
 
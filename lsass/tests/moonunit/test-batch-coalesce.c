@@ -0,0 +1,499 @@
+/*
+ * Exercises the merging of concurrent single object lookups with the
+ * batch lookup and object cache calls stubbed out: lookups in a fast
+ * domain finishing while a slow domain is busy, uid lookups sharing
+ * batches, a failing key in a merged batch failing alone, and an
+ * offline domain failing a merged batch without per-key lookups.
+ */
+
+#include "adprovider.h"
+#include <moonunit/moonunit.h>
+
+#define FAST_DOMAIN     "S-1-5-21-1-1-1"
+#define SLOW_DOMAIN     "S-1-5-21-9-9-9"
+#define SPLIT_DOMAIN    "S-1-5-21-2-2-2"
+#define OFFLINE_DOMAIN  "S-1-5-21-7-7-7"
+#define BAD_RID         666
+
+#define FAST_THREADS 16
+#define FAST_ITERATIONS 50
+#define SLOW_THREADS 4
+#define SLOW_DELAY_MS 500
+#define QUEUED_THREADS 15
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gCondition = PTHREAD_COND_INITIALIZER;
+static BOOLEAN gbHold = FALSE;
+static DWORD gdwCalls = 0;
+static DWORD gdwMergedCalls = 0;
+static DWORD gdwFailures = 0;
+
+static AD_PROVIDER_CONTEXT gContext;
+static LSA_AD_PROVIDER_STATE gState;
+
+/* Worker threads and stubs count failures for the test to assert on */
+static VOID
+record_failure(VOID)
+{
+    pthread_mutex_lock(&gLock);
+    gdwFailures++;
+    pthread_mutex_unlock(&gLock);
+}
+
+static DWORD
+now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (DWORD) (ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static DWORD
+new_object(PCSTR pszSid, DWORD dwUid, PLSA_SECURITY_OBJECT* ppObject)
+{
+    DWORD dwError = 0;
+    PLSA_SECURITY_OBJECT pObject = NULL;
+
+    dwError = LwAllocateMemory(sizeof(*pObject), OUT_PPVOID(&pObject));
+    if (dwError)
+    {
+        return dwError;
+    }
+
+    dwError = LwAllocateString(pszSid, &pObject->pszObjectSid);
+    if (dwError)
+    {
+        LwFreeMemory(pObject);
+        return dwError;
+    }
+
+    pObject->enabled = TRUE;
+    pObject->type = LSA_OBJECT_TYPE_USER;
+    pObject->userInfo.uid = dwUid;
+
+    *ppObject = pObject;
+
+    return dwError;
+}
+
+DWORD
+ADCacheDuplicateObject(
+    OUT PLSA_SECURITY_OBJECT* ppDest,
+    IN PLSA_SECURITY_OBJECT pSrc
+    )
+{
+    return new_object(pSrc->pszObjectSid, pSrc->userInfo.uid, ppDest);
+}
+
+void
+ADCacheSafeFreeObjectList(
+    size_t sCount,
+    PLSA_SECURITY_OBJECT** pppObjectList
+    )
+{
+    size_t i = 0;
+
+    if (*pppObjectList)
+    {
+        for (i = 0; i < sCount; i++)
+        {
+            if ((*pppObjectList)[i])
+            {
+                LW_SAFE_FREE_STRING((*pppObjectList)[i]->pszObjectSid);
+                LwFreeMemory((*pppObjectList)[i]);
+            }
+        }
+        LW_SAFE_FREE_MEMORY(*pppObjectList);
+    }
+}
+
+/* Stands in for the LDAP batch lookup */
+DWORD
+LsaAdBatchFindObjects(
+    IN PAD_PROVIDER_CONTEXT pContext,
+    IN LSA_AD_BATCH_QUERY_TYPE QueryType,
+    IN DWORD dwQueryItemsCount,
+    IN OPTIONAL PSTR* ppszQueryList,
+    IN OPTIONAL PDWORD pdwId,
+    OUT PDWORD pdwObjectsCount,
+    OUT PLSA_SECURITY_OBJECT** pppObjects
+    )
+{
+    DWORD dwError = 0;
+    PLSA_SECURITY_OBJECT* ppObjects = NULL;
+    CHAR szSid[64] = { 0 };
+    DWORD i = 0;
+
+    if (pContext != &gContext)
+    {
+        record_failure();
+    }
+
+    pthread_mutex_lock(&gLock);
+    gdwCalls++;
+    if (dwQueryItemsCount > 1)
+    {
+        gdwMergedCalls++;
+    }
+    if (ppszQueryList &&
+        (!strncmp(ppszQueryList[0], SPLIT_DOMAIN, strlen(SPLIT_DOMAIN)) ||
+         !strncmp(ppszQueryList[0], OFFLINE_DOMAIN, strlen(OFFLINE_DOMAIN))))
+    {
+        while (gbHold)
+        {
+            pthread_cond_wait(&gCondition, &gLock);
+        }
+    }
+    pthread_mutex_unlock(&gLock);
+
+    for (i = 0; ppszQueryList && i < dwQueryItemsCount; i++)
+    {
+        // Every batch the coalescer sends is for a single domain.
+        if (strncmp(ppszQueryList[i], ppszQueryList[0], strlen(FAST_DOMAIN)))
+        {
+            record_failure();
+        }
+        if (!strncmp(ppszQueryList[i], OFFLINE_DOMAIN, strlen(OFFLINE_DOMAIN)))
+        {
+            dwError = LW_ERROR_DOMAIN_IS_OFFLINE;
+        }
+        if (atoi(strrchr(ppszQueryList[i], '-') + 1) == BAD_RID)
+        {
+            dwError = LW_ERROR_INVALID_SID;
+        }
+    }
+    if (dwError)
+    {
+        *pdwObjectsCount = 0;
+        *pppObjects = NULL;
+        return dwError;
+    }
+
+    if (ppszQueryList &&
+        !strncmp(ppszQueryList[0], SLOW_DOMAIN, strlen(SLOW_DOMAIN)))
+    {
+        usleep(SLOW_DELAY_MS * 1000);
+    }
+    else
+    {
+        usleep(2000);
+    }
+
+    dwError = LwAllocateMemory(
+                    sizeof(*ppObjects) * dwQueryItemsCount,
+                    OUT_PPVOID(&ppObjects));
+    if (dwError)
+    {
+        return dwError;
+    }
+
+    // Answer in reverse order so matching does not rely on it.
+    for (i = 0; !dwError && i < dwQueryItemsCount; i++)
+    {
+        DWORD dwIndex = dwQueryItemsCount - i - 1;
+
+        if (pdwId)
+        {
+            snprintf(szSid, sizeof(szSid), FAST_DOMAIN "-%u", pdwId[dwIndex]);
+            dwError = new_object(szSid, pdwId[dwIndex], &ppObjects[i]);
+        }
+        else
+        {
+            dwError = new_object(ppszQueryList[dwIndex], 0, &ppObjects[i]);
+        }
+    }
+    if (dwError)
+    {
+        ADCacheSafeFreeObjectList(dwQueryItemsCount, &ppObjects);
+        *pdwObjectsCount = 0;
+        *pppObjects = NULL;
+        return dwError;
+    }
+
+    *pdwObjectsCount = dwQueryItemsCount;
+    *pppObjects = ppObjects;
+
+    return dwError;
+}
+
+static DWORD
+find_by_sid(PCSTR pszDomain, DWORD dwRid)
+{
+    DWORD dwError = 0;
+    CHAR szSid[64] = { 0 };
+    DWORD dwCount = 0;
+    PLSA_SECURITY_OBJECT* ppObjects = NULL;
+
+    snprintf(szSid, sizeof(szSid), "%s-%u", pszDomain, dwRid);
+
+    dwError = LsaAdBatchFindObjectsCoalesced(
+                    &gContext,
+                    LSA_AD_BATCH_QUERY_TYPE_BY_SID,
+                    szSid,
+                    NULL,
+                    &dwCount,
+                    &ppObjects);
+    if (!dwError &&
+        (dwCount != 1 || strcmp(ppObjects[0]->pszObjectSid, szSid)))
+    {
+        record_failure();
+    }
+
+    ADCacheSafeFreeObjectList(dwCount, &ppObjects);
+
+    return dwError;
+}
+
+static PVOID
+fast_thread(PVOID pArg)
+{
+    DWORD dwThread = (DWORD) (size_t) pArg;
+    DWORD dwLongest = 0;
+    DWORD i = 0;
+
+    for (i = 0; i < FAST_ITERATIONS; i++)
+    {
+        DWORD dwStart = now_ms();
+        DWORD dwCount = 0;
+        DWORD dwUid = 1000 + dwThread * FAST_ITERATIONS + i;
+        PLSA_SECURITY_OBJECT* ppObjects = NULL;
+
+        if (find_by_sid(FAST_DOMAIN, dwUid))
+        {
+            record_failure();
+        }
+
+        if (LsaAdBatchFindObjectsCoalesced(
+                &gContext,
+                LSA_AD_BATCH_QUERY_TYPE_BY_UID,
+                NULL,
+                &dwUid,
+                &dwCount,
+                &ppObjects) ||
+            dwCount != 1 ||
+            ppObjects[0]->userInfo.uid != dwUid)
+        {
+            record_failure();
+        }
+        ADCacheSafeFreeObjectList(dwCount, &ppObjects);
+
+        if (now_ms() - dwStart > dwLongest)
+        {
+            dwLongest = now_ms() - dwStart;
+        }
+    }
+
+    return (PVOID) (size_t) dwLongest;
+}
+
+static PVOID
+slow_thread(PVOID pArg)
+{
+    if (find_by_sid(SLOW_DOMAIN, (DWORD) (size_t) pArg))
+    {
+        record_failure();
+    }
+
+    return NULL;
+}
+
+MU_FIXTURE_SETUP(BatchCoalesce)
+{
+    gdwCalls = 0;
+    gdwMergedCalls = 0;
+    gdwFailures = 0;
+    gbHold = FALSE;
+
+    gContext.pState = &gState;
+
+    MU_ASSERT_EQUAL(
+        MU_TYPE_INTEGER,
+        LsaAdBatchCreateCoalesceState(&gState.hBatchCoalesce),
+        0);
+}
+
+MU_FIXTURE_TEARDOWN(BatchCoalesce)
+{
+    LsaAdBatchDestroyCoalesceState(gState.hBatchCoalesce);
+    gState.hBatchCoalesce = NULL;
+}
+
+MU_TEST(BatchCoalesce, Concurrent)
+{
+    pthread_t slow[SLOW_THREADS];
+    pthread_t fast[FAST_THREADS];
+    DWORD dwLongest = 0;
+    PVOID pResult = NULL;
+    size_t i = 0;
+
+    for (i = 0; i < SLOW_THREADS; i++)
+    {
+        MU_ASSERT_EQUAL(
+            MU_TYPE_INTEGER,
+            pthread_create(&slow[i], NULL, slow_thread, (PVOID) i),
+            0);
+    }
+
+    // Let the slow domain fill its batches before the fast one starts.
+    usleep(50 * 1000);
+
+    for (i = 0; i < FAST_THREADS; i++)
+    {
+        MU_ASSERT_EQUAL(
+            MU_TYPE_INTEGER,
+            pthread_create(&fast[i], NULL, fast_thread, (PVOID) i),
+            0);
+    }
+
+    for (i = 0; i < FAST_THREADS; i++)
+    {
+        pthread_join(fast[i], &pResult);
+        if ((DWORD) (size_t) pResult > dwLongest)
+        {
+            dwLongest = (DWORD) (size_t) pResult;
+        }
+    }
+
+    for (i = 0; i < SLOW_THREADS; i++)
+    {
+        pthread_join(slow[i], NULL);
+    }
+
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, gdwFailures, 0);
+
+    MU_INFO("Slowest fast domain lookup: %u ms", dwLongest);
+    MU_ASSERT(dwLongest < SLOW_DELAY_MS / 2);
+
+    MU_INFO("Lookups: %u, calls: %u, merged calls: %u",
+            FAST_THREADS * FAST_ITERATIONS * 2 + SLOW_THREADS,
+            gdwCalls,
+            gdwMergedCalls);
+    MU_ASSERT(gdwMergedCalls > 0);
+}
+
+typedef struct _QUEUED_LOOKUP {
+    PCSTR pszDomain;
+    DWORD dwRid;
+    DWORD dwError;
+} QUEUED_LOOKUP, *PQUEUED_LOOKUP;
+
+static PVOID
+queued_thread(PVOID pArg)
+{
+    PQUEUED_LOOKUP pLookup = pArg;
+
+    pLookup->dwError = find_by_sid(pLookup->pszDomain, pLookup->dwRid);
+
+    return NULL;
+}
+
+/*
+ * Holds the domain's first lookups in the stub so that the rest queue
+ * up behind them, then lets everything go.  Returns the number of stub
+ * calls the queued lookups needed.
+ */
+static DWORD
+run_queued(PCSTR pszDomain, PQUEUED_LOOKUP pLookups, DWORD dwCount)
+{
+    pthread_t threads[QUEUED_THREADS + 2];
+    QUEUED_LOOKUP held[2] = { { pszDomain, 1 }, { pszDomain, 2 } };
+    DWORD dwCallsBefore = 0;
+    DWORD i = 0;
+
+    pthread_mutex_lock(&gLock);
+    gbHold = TRUE;
+    dwCallsBefore = gdwCalls;
+    pthread_mutex_unlock(&gLock);
+
+    for (i = 0; i < 2; i++)
+    {
+        MU_ASSERT_EQUAL(
+            MU_TYPE_INTEGER,
+            pthread_create(&threads[i], NULL, queued_thread, &held[i]),
+            0);
+    }
+
+    usleep(100 * 1000);
+
+    for (i = 0; i < dwCount; i++)
+    {
+        MU_ASSERT_EQUAL(
+            MU_TYPE_INTEGER,
+            pthread_create(&threads[i + 2], NULL, queued_thread, &pLookups[i]),
+            0);
+    }
+
+    usleep(300 * 1000);
+
+    pthread_mutex_lock(&gLock);
+    gbHold = FALSE;
+    pthread_cond_broadcast(&gCondition);
+    pthread_mutex_unlock(&gLock);
+
+    for (i = 0; i < dwCount + 2; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    return gdwCalls - dwCallsBefore - 2;
+}
+
+MU_TEST(BatchCoalesce, SplitFailure)
+{
+    QUEUED_LOOKUP lookups[QUEUED_THREADS];
+    DWORD dwCalls = 0;
+    DWORD i = 0;
+
+    for (i = 0; i < QUEUED_THREADS; i++)
+    {
+        lookups[i].pszDomain = SPLIT_DOMAIN;
+        lookups[i].dwRid = (i == QUEUED_THREADS / 2) ? BAD_RID : 100 + i;
+        lookups[i].dwError = 0;
+    }
+
+    dwCalls = run_queued(SPLIT_DOMAIN, lookups, QUEUED_THREADS);
+
+    for (i = 0; i < QUEUED_THREADS; i++)
+    {
+        MU_ASSERT_EQUAL(
+            MU_TYPE_INTEGER,
+            lookups[i].dwError,
+            lookups[i].dwRid == BAD_RID ? LW_ERROR_INVALID_SID : 0);
+    }
+
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, gdwFailures, 0);
+
+    MU_INFO("Failed merged batch of %u took %u calls", QUEUED_THREADS, dwCalls);
+
+    // One call for the merged batch and two per halving down to the
+    // bad key, rather than one more per key.
+    MU_ASSERT(dwCalls <= 1 + 2 * 4);
+}
+
+MU_TEST(BatchCoalesce, Offline)
+{
+    QUEUED_LOOKUP lookups[QUEUED_THREADS];
+    DWORD dwCalls = 0;
+    DWORD i = 0;
+
+    for (i = 0; i < QUEUED_THREADS; i++)
+    {
+        lookups[i].pszDomain = OFFLINE_DOMAIN;
+        lookups[i].dwRid = 100 + i;
+        lookups[i].dwError = 0;
+    }
+
+    dwCalls = run_queued(OFFLINE_DOMAIN, lookups, QUEUED_THREADS);
+
+    for (i = 0; i < QUEUED_THREADS; i++)
+    {
+        MU_ASSERT_EQUAL(MU_TYPE_INTEGER, lookups[i].dwError, LW_ERROR_DOMAIN_IS_OFFLINE);
+    }
+
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, gdwFailures, 0);
+
+    MU_INFO("Offline merged batch of %u took %u calls", QUEUED_THREADS, dwCalls);
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, dwCalls, 1);
+}
@@ -0,0 +1,314 @@
+/*
+ * Exercises the netlogon secure channel pool with NetrCloseSchannel and
+ * the logon call stubbed out: slot selection, overflow past
+ * MaxConcurrentApi, and resets that must not close a channel another
+ * logon has already reopened.
+ */
+
+#include "config.h"
+#include "lsasystem.h"
+#include "lsadef.h"
+#include "lsa/lsa.h"
+#include "lwmem.h"
+#include "lwstr.h"
+#include "lsautils.h"
+#include <lwio/lwio.h>
+#include <lw/rpc/samr.h>
+#include <moonunit/moonunit.h>
+
+#include "addef.h"
+#include "schannelpool.h"
+
+#define CHANNELS 3
+#define MAX_CONCURRENT 2
+#define THREADS 8
+#define ITERATIONS 2000
+
+typedef struct _FAKE_SCHANNEL {
+    DWORD dwId;
+} FAKE_SCHANNEL, *PFAKE_SCHANNEL;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static DWORD gdwOpens = 0;
+static DWORD gdwCloses = 0;
+static BOOLEAN gbFailOpen = FALSE;
+static DWORD gdwFailures = 0;
+static PLSA_SCHANNEL_STATE gpState = NULL;
+
+VOID
+NetrCloseSchannel(
+    IN NETR_BINDING hSchannelBinding
+    )
+{
+    pthread_mutex_lock(&gLock);
+    gdwCloses++;
+    pthread_mutex_unlock(&gLock);
+
+    free(hSchannelBinding);
+}
+
+static DWORD
+open_schannel(PLSA_SCHANNEL_SLOT pSlot, PVOID pContext, PBOOLEAN pbIsNetworkError)
+{
+    PFAKE_SCHANNEL pChannel = NULL;
+
+    if (gbFailOpen)
+    {
+        *pbIsNetworkError = TRUE;
+        return LW_ERROR_RPC_NETLOGON_FAILED;
+    }
+
+    pChannel = calloc(1, sizeof(*pChannel));
+    if (!pChannel)
+    {
+        return LW_ERROR_OUT_OF_MEMORY;
+    }
+
+    pthread_mutex_lock(&gLock);
+    pChannel->dwId = ++gdwOpens;
+    pthread_mutex_unlock(&gLock);
+
+    pSlot->hSchannelBinding = pChannel;
+    pSlot->pSchannelCreds = &pSlot->SchannelCreds;
+
+    return LwAllocateString(pSlot->pszTarget, &pSlot->pszSchannelServer);
+}
+
+/* Stands in for NetrSamLogonNetworkEx */
+static NTSTATUS
+sam_logon_ex(NETR_BINDING hSchannelBinding, BOOLEAN bFail)
+{
+    if (!hSchannelBinding)
+    {
+        pthread_mutex_lock(&gLock);
+        gdwFailures++;
+        pthread_mutex_unlock(&gLock);
+    }
+
+    return bFail ? STATUS_UNHANDLED_EXCEPTION : STATUS_SUCCESS;
+}
+
+/* The AD_NetSamLogonOnSlot sequence against the stubs */
+static DWORD
+logon(PLSA_SCHANNEL_STATE pState, PCSTR pszDC, BOOLEAN bFail)
+{
+    DWORD dwError = 0;
+    PLSA_SCHANNEL_SLOT pSlot = NULL;
+    DWORD dwGeneration = 0;
+    BOOLEAN bIsNetworkError = FALSE;
+    NTSTATUS status = 0;
+
+    dwError = AD_NetAcquireSchannelSlot(pState, pszDC, CHANNELS, MAX_CONCURRENT, FALSE, &pSlot);
+    if (!dwError && !pSlot)
+    {
+        dwError = LW_ERROR_INTERNAL;
+    }
+    if (dwError)
+    {
+        return dwError;
+    }
+
+    dwError = AD_NetLockSchannelSlot(pSlot, open_schannel, NULL, &dwGeneration, &bIsNetworkError);
+    if (!dwError)
+    {
+        status = sam_logon_ex(pSlot->hSchannelBinding, bFail);
+        AD_NetUnlockSchannelSlot(pSlot, status != STATUS_SUCCESS, dwGeneration);
+    }
+
+    AD_NetReleaseSchannelSlot(pState, pSlot);
+
+    return dwError;
+}
+
+
+MU_FIXTURE_SETUP(SchannelPool)
+{
+    gdwOpens = 0;
+    gdwCloses = 0;
+    gdwFailures = 0;
+    gbFailOpen = FALSE;
+
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, AD_NetCreateSchannelState(&gpState), 0);
+}
+
+MU_FIXTURE_TEARDOWN(SchannelPool)
+{
+    AD_NetDestroySchannelState(gpState);
+    gpState = NULL;
+}
+
+MU_TEST(SchannelPool, Selection)
+{
+    PLSA_SCHANNEL_SLOT pA1 = NULL;
+    PLSA_SCHANNEL_SLOT pB = NULL;
+    PLSA_SCHANNEL_SLOT pA2 = NULL;
+    PLSA_SCHANNEL_SLOT pA3 = NULL;
+    PLSA_SCHANNEL_SLOT pA4 = NULL;
+    PLSA_SCHANNEL_SLOT pC = NULL;
+    PLSA_SCHANNEL_SLOT pD = NULL;
+    PLSA_SCHANNEL_SLOT pE = NULL;
+
+    /* Each DC claims an unused slot, and the same DC shares it */
+    AD_NetAcquireSchannelSlot(gpState, "dc-a", CHANNELS, MAX_CONCURRENT, FALSE, &pA1);
+    AD_NetAcquireSchannelSlot(gpState, "dc-b", CHANNELS, MAX_CONCURRENT, FALSE, &pB);
+    AD_NetAcquireSchannelSlot(gpState, "DC-A", CHANNELS, MAX_CONCURRENT, FALSE, &pA2);
+
+    MU_ASSERT(pA1 != NULL);
+    MU_ASSERT(pB != NULL);
+    MU_ASSERT(pA1 != pB);
+    MU_ASSERT_EQUAL(MU_TYPE_POINTER, pA2, pA1);
+    MU_ASSERT_EQUAL(MU_TYPE_STRING, pA1->pszTarget, "dc-a");
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, pA1->dwInFlight, 2);
+
+    /* dc-a is at MaxConcurrentApi, so the least loaded other slot
+       takes the overflow */
+    AD_NetAcquireSchannelSlot(gpState, "dc-a", CHANNELS, MAX_CONCURRENT, FALSE, &pA3);
+    MU_ASSERT_EQUAL(MU_TYPE_POINTER, pA3, pB);
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, pB->dwInFlight, 2);
+
+    /* ...unless the caller needs that DC */
+    AD_NetAcquireSchannelSlot(gpState, "dc-a", CHANNELS, MAX_CONCURRENT, TRUE, &pA4);
+    MU_ASSERT_EQUAL(MU_TYPE_POINTER, pA4, pA1);
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, pA1->dwInFlight, 3);
+
+    /* The last unused slot goes to a new DC; after that a new DC only
+       gets an idle slot */
+    AD_NetAcquireSchannelSlot(gpState, "dc-c", CHANNELS, MAX_CONCURRENT, FALSE, &pC);
+    MU_ASSERT(pC != NULL);
+    MU_ASSERT(pC != pA1);
+    MU_ASSERT(pC != pB);
+
+    AD_NetAcquireSchannelSlot(gpState, "dc-d", CHANNELS, MAX_CONCURRENT, TRUE, &pD);
+    MU_ASSERT_EQUAL(MU_TYPE_POINTER, pD, NULL);
+
+    AD_NetReleaseSchannelSlot(gpState, pA4);
+    AD_NetReleaseSchannelSlot(gpState, pA3);
+    AD_NetReleaseSchannelSlot(gpState, pA2);
+    AD_NetReleaseSchannelSlot(gpState, pA1);
+    AD_NetReleaseSchannelSlot(gpState, pB);
+    AD_NetReleaseSchannelSlot(gpState, pC);
+
+    /* All idle: the least recently used slot moves to the new DC */
+    pA1->LastUsed = 300;
+    pB->LastUsed = 100;
+    pC->LastUsed = 200;
+
+    AD_NetAcquireSchannelSlot(gpState, "dc-e", CHANNELS, MAX_CONCURRENT, FALSE, &pE);
+    MU_ASSERT_EQUAL(MU_TYPE_POINTER, pE, pB);
+    MU_ASSERT_EQUAL(MU_TYPE_STRING, pE->pszTarget, "dc-e");
+
+    AD_NetReleaseSchannelSlot(gpState, pE);
+}
+
+MU_TEST(SchannelPool, Reset)
+{
+    PLSA_SCHANNEL_SLOT pSlot = NULL;
+    DWORD dwStale = 0;
+    DWORD dwGeneration = 0;
+    BOOLEAN bIsNetworkError = FALSE;
+    NETR_BINDING hReopened = NULL;
+
+    AD_NetAcquireSchannelSlot(gpState, "dc-r", 1, MAX_CONCURRENT, FALSE, &pSlot);
+    MU_ASSERT(pSlot != NULL);
+
+    /* A failed logon closes the channel it used */
+    MU_ASSERT_EQUAL(
+        MU_TYPE_INTEGER,
+        AD_NetLockSchannelSlot(pSlot, open_schannel, NULL, &dwStale, &bIsNetworkError),
+        0);
+    AD_NetUnlockSchannelSlot(pSlot, TRUE, dwStale);
+
+    MU_ASSERT_EQUAL(MU_TYPE_POINTER, pSlot->hSchannelBinding, NULL);
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, gdwCloses, 1);
+
+    /* A slower logon that failed on that same channel must not close
+       the one opened since */
+    MU_ASSERT_EQUAL(
+        MU_TYPE_INTEGER,
+        AD_NetLockSchannelSlot(pSlot, open_schannel, NULL, &dwGeneration, &bIsNetworkError),
+        0);
+    hReopened = pSlot->hSchannelBinding;
+    AD_NetUnlockSchannelSlot(pSlot, FALSE, dwGeneration);
+
+    MU_ASSERT(dwGeneration != dwStale);
+
+    AD_NetLockSchannelSlot(pSlot, open_schannel, NULL, &dwGeneration, &bIsNetworkError);
+    AD_NetUnlockSchannelSlot(pSlot, TRUE, dwStale);
+
+    MU_ASSERT_EQUAL(MU_TYPE_POINTER, pSlot->hSchannelBinding, hReopened);
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, gdwCloses, 1);
+
+    /* A failed open reports the error and leaves the slot closed */
+    AD_NetLockSchannelSlot(pSlot, open_schannel, NULL, &dwGeneration, &bIsNetworkError);
+    AD_NetUnlockSchannelSlot(pSlot, TRUE, dwGeneration);
+
+    gbFailOpen = TRUE;
+    MU_ASSERT(AD_NetLockSchannelSlot(pSlot, open_schannel, NULL, &dwGeneration, &bIsNetworkError) != 0);
+    MU_ASSERT(bIsNetworkError);
+    MU_ASSERT_EQUAL(MU_TYPE_POINTER, pSlot->hSchannelBinding, NULL);
+    MU_ASSERT_EQUAL(MU_TYPE_POINTER, pSlot->pszSchannelServer, NULL);
+    gbFailOpen = FALSE;
+
+    AD_NetReleaseSchannelSlot(gpState, pSlot);
+}
+
+static void*
+logon_thread(void* pData)
+{
+    PLSA_SCHANNEL_STATE pState = pData;
+    static PCSTR ppszDCs[] = { "dc-1", "dc-2", "dc-3", "dc-4" };
+    unsigned int seed = (unsigned int) (size_t) pthread_self();
+    DWORD i;
+
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        if (logon(pState, ppszDCs[rand_r(&seed) % 4], rand_r(&seed) % 10 == 0))
+        {
+            pthread_mutex_lock(&gLock);
+            gdwFailures++;
+            pthread_mutex_unlock(&gLock);
+        }
+    }
+
+    return NULL;
+}
+
+MU_TEST(SchannelPool, Concurrent)
+{
+    pthread_t threads[THREADS];
+    DWORD dwOpen = 0;
+    DWORD i;
+
+    for (i = 0; i < THREADS; i++)
+    {
+        MU_ASSERT_EQUAL(
+            MU_TYPE_INTEGER,
+            pthread_create(&threads[i], NULL, logon_thread, gpState),
+            0);
+    }
+
+    for (i = 0; i < THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, gdwFailures, 0);
+
+    for (i = 0; i < AD_NETLOGON_CHANNEL_COUNT_MAXIMUM; i++)
+    {
+        MU_ASSERT_EQUAL(MU_TYPE_INTEGER, gpState->Slots[i].dwInFlight, 0);
+
+        if (gpState->Slots[i].hSchannelBinding)
+        {
+            dwOpen++;
+        }
+    }
+
+    /* Every channel opened is either still in a slot or was closed
+       exactly once */
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, gdwOpens, gdwCloses + dwOpen);
+
+    MU_INFO("Channels opened: %lu, closed: %lu",
+            (unsigned long) gdwOpens,
+            (unsigned long) gdwCloses);
+}
@@ -79,6 +79,12 @@ PrintMetricPack_1(
     PLSA_METRIC_PACK_1 pMetricPack
     );
 
+static
+VOID
+PrintMetricPack_2(
+    PLSA_METRIC_PACK_2 pMetricPack
+    );
+
 static
 DWORD
 MapErrorCode(
@@ -131,6 +137,13 @@ get_metrics_main(
 
             break;
 
+        case 2:
+
+            PrintMetricPack_2(
+                 (PLSA_METRIC_PACK_2)pMetricPack);
+
+            break;
+
     }
 
 cleanup:
@@ -270,7 +283,7 @@ ParseArgs(
 void
 ShowUsage()
 {
-    printf("Usage: lw-get-metrics { --level [0, 1] }\n");
+    printf("Usage: lw-get-metrics { --level [0, 1, 2] }\n");
 }
 
 VOID
@@ -312,6 +325,122 @@ PrintMetricPack_1(
     printf("Failed password changes:              %llu\n", (unsigned long long)pMetricPack->failedChangePassword);
 }
 
+static
+VOID
+PrintLatency(
+    PCSTR pszName,
+    PLSA_METRIC_LATENCY pLatency
+    )
+{
+    DWORD dwBucket = 0;
+    BOOLEAN bFirst = TRUE;
+
+    if (!pLatency->count)
+    {
+        return;
+    }
+
+    printf("  %-24s calls %llu, failed %llu, avg %lluus, max %lluus\n",
+           pszName,
+           (unsigned long long)pLatency->count,
+           (unsigned long long)pLatency->failed,
+           (unsigned long long)(pLatency->totalMicroseconds / pLatency->count),
+           (unsigned long long)pLatency->maxMicroseconds);
+
+    printf("  %-24s", "");
+    for (dwBucket = 0; dwBucket < LSA_METRIC_LATENCY_BUCKETS; dwBucket++)
+    {
+        if (!pLatency->buckets[dwBucket])
+        {
+            continue;
+        }
+
+        if (dwBucket == LSA_METRIC_LATENCY_BUCKETS - 1)
+        {
+            printf("%s>=%lluus:%llu",
+                   bFirst ? "" : " ",
+                   1ULL << (dwBucket - 1),
+                   (unsigned long long)pLatency->buckets[dwBucket]);
+        }
+        else
+        {
+            printf("%s<%lluus:%llu",
+                   bFirst ? "" : " ",
+                   1ULL << dwBucket,
+                   (unsigned long long)pLatency->buckets[dwBucket]);
+        }
+        bFirst = FALSE;
+    }
+    printf("\n");
+}
+
+VOID
+PrintMetricPack_2(
+    PLSA_METRIC_PACK_2 pMetricPack
+    )
+{
+    static PCSTR ppszOperations[LSA_METRIC_OP_COUNT] =
+    {
+        "Authenticate (PAM)",
+        "Authenticate (Ex)",
+        "Change password",
+        "Open session",
+        "Close session",
+        "Find objects",
+        "Enumerate objects",
+        "Query member of"
+    };
+    static PCSTR ppszCaches[LSA_METRIC_CACHE_COUNT] =
+    {
+        "User by name",
+        "User by id",
+        "Group by name",
+        "Group by id",
+        "Object by DN",
+        "Object by SID",
+        "Membership",
+        "Password verifier",
+        "Negative lookup",
+        "Member names"
+    };
+    DWORD dwIndex = 0;
+    PLSA_METRIC_DC_TARGET pTarget = NULL;
+
+    PrintMetricPack_1(&pMetricPack->counters);
+
+    printf("Unauthorized accesses:                %llu\n", (unsigned long long)pMetricPack->unauthorizedAccesses);
+    printf("Operations in flight:                 %llu\n", (unsigned long long)pMetricPack->operationsInFlight);
+    printf("Peak operations in flight:            %llu\n", (unsigned long long)pMetricPack->operationsInFlightPeak);
+
+    printf("\nOperation latency:\n");
+    for (dwIndex = 0; dwIndex < LSA_METRIC_OP_COUNT; dwIndex++)
+    {
+        PrintLatency(ppszOperations[dwIndex], &pMetricPack->operations[dwIndex]);
+    }
+
+    printf("\nCache lookups:\n");
+    for (dwIndex = 0; dwIndex < LSA_METRIC_CACHE_COUNT; dwIndex++)
+    {
+        printf("  %-24s hits %llu, misses %llu\n",
+               ppszCaches[dwIndex],
+               (unsigned long long)pMetricPack->cacheHits[dwIndex],
+               (unsigned long long)pMetricPack->cacheMisses[dwIndex]);
+    }
+
+    printf("\nDomain controller latency:\n");
+    for (dwIndex = 0;
+         dwIndex < pMetricPack->dwDcTargetCount &&
+         dwIndex < LSA_METRIC_MAX_DC_TARGETS;
+         dwIndex++)
+    {
+        pTarget = &pMetricPack->dcTargets[dwIndex];
+
+        printf(" %.*s\n", (int)sizeof(pTarget->szName), pTarget->szName);
+        PrintLatency("LDAP", &pTarget->ldapLatency);
+        PrintLatency("RPC", &pTarget->rpcLatency);
+    }
+}
+
 DWORD
 MapErrorCode(
     DWORD dwError
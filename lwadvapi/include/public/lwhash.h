@@ -55,6 +55,7 @@ typedef int (*LW_HASH_KEY_COMPARE)(PCVOID, PCVOID);
 typedef size_t (*LW_HASH_KEY)(PCVOID);
 typedef void (*LW_HASH_FREE_ENTRY)(const LW_HASH_ENTRY *);
 typedef DWORD (*LW_HASH_COPY_ENTRY)(const LW_HASH_ENTRY *, LW_HASH_ENTRY *);
+typedef BOOLEAN (*LW_HASH_PREDICATE)(const LW_HASH_ENTRY *, PVOID);
 
 struct __LW_HASH_ENTRY
 {
@@ -158,6 +159,17 @@ LwHashRemoveKey(
     PVOID  pKey
     );
 
+//Removes every entry fnExpired returns TRUE for.  If sMaxCount is not 0
+//and the table still holds at least that many entries, all of them are
+//removed.
+void
+LwHashPrune(
+    LW_HASH_TABLE *pTable,
+    LW_HASH_PREDICATE fnExpired,
+    PVOID pContext,
+    size_t sMaxCount
+    );
+
 int
 LwHashStringCompare(
     PCVOID str1,
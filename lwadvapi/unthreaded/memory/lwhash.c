@@ -425,6 +425,47 @@ cleanup:
     return dwError;
 }
 
+void
+LwHashPrune(
+        LW_HASH_TABLE *pTable,
+        LW_HASH_PREDICATE fnExpired,
+        PVOID pContext,
+        size_t sMaxCount)
+{
+    size_t sBucket = 0;
+    LW_HASH_ENTRY **ppExamine = NULL;
+    LW_HASH_ENTRY *pDelete = NULL;
+
+    for (sBucket = 0; sBucket < pTable->sTableSize; sBucket++)
+    {
+        ppExamine = &pTable->ppEntries[sBucket];
+
+        while (*ppExamine != NULL)
+        {
+            if (!fnExpired(*ppExamine, pContext))
+            {
+                ppExamine = &(*ppExamine)->pNext;
+                continue;
+            }
+
+            pDelete = *ppExamine;
+            if (pTable->fnFree != NULL)
+            {
+                pTable->fnFree(pDelete);
+            }
+
+            pTable->sCount--;
+            *ppExamine = pDelete->pNext;
+            LW_SAFE_FREE_MEMORY(pDelete);
+        }
+    }
+
+    if (sMaxCount && pTable->sCount >= sMaxCount)
+    {
+        LwHashRemoveAll(pTable);
+    }
+}
+
 static size_t
 LwHashChar(
         size_t hash,
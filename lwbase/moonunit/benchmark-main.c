@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <locale.h>
 
 #include "benchmark.h"
 
@@ -6,6 +7,8 @@
 #define SEND_SEGMENTS 1
 #define NUM_ITERATIONS 2
 #define NUM_PAIRS 5000
+#define STRING_LENGTH 128
+#define STRING_ITERATIONS 1000000
 
 int main(int argc, char** argv)
 {
@@ -16,6 +19,12 @@ int main(int argc, char** argv)
         .ulIterations = NUM_ITERATIONS,
         .ulPairs = NUM_PAIRS
     };
+    static BENCHMARK_STRING_SETTINGS stringSettings =
+    {
+        .ulLength = STRING_LENGTH,
+        .ulIterations = STRING_ITERATIONS
+    };
+    BENCHMARK_STRING_RESULTS stringResults = {0};
     PLW_THREAD_POOL pPool = NULL;
     ULONG64 ullTotal = 0;
     ULONG64 ullTime = 0;
@@ -33,5 +42,16 @@ int main(int argc, char** argv)
            ullTime / 1000000000.0,
            (ullTotal / 131072.0) / (ullTime / 1000000000.0));
 
+    setlocale(LC_ALL, "");
+
+    BenchmarkStrings(&stringSettings, &stringResults);
+
+    printf("%u-character strings: mbstowc16s %.1f ns, wc16stombs %.1f ns, "
+           "wc16scasecmp %.1f ns\n",
+           STRING_LENGTH,
+           (double) stringResults.ullToWc16Duration / STRING_ITERATIONS,
+           (double) stringResults.ullToMbsDuration / STRING_ITERATIONS,
+           (double) stringResults.ullCaseCompareDuration / STRING_ITERATIONS);
+
     return 0;
 }
@@ -8,6 +8,7 @@
 #include <sys/time.h>
 #include <stdio.h>
 #include <assert.h>
+#include <wc16str.h>
 
 #include "benchmark.h"
 
@@ -275,3 +276,67 @@ BenchmarkThreadPool(
     *pullDuration = ullTime;
     *pullBytesTransferred = ullTotal;
 }
+
+VOID
+BenchmarkStrings(
+    PBENCHMARK_STRING_SETTINGS pSettings,
+    PBENCHMARK_STRING_RESULTS pResults
+    )
+{
+    static const CHAR szAlphabet[] = "abcdefghijklmnopqrstuvwxyz\\._-$";
+    PSTR pszString = NULL;
+    PSTR pszConverted = NULL;
+    PWSTR pwszString = NULL;
+    PWSTR pwszUpper = NULL;
+    ULONG i = 0;
+    LONG64 llStart = 0;
+    LONG64 llEnd = 0;
+    volatile int result = 0;
+
+    ASSERT_SUCCESS(LW_RTL_ALLOCATE_ARRAY_AUTO(&pszString, pSettings->ulLength + 1));
+    ASSERT_SUCCESS(LW_RTL_ALLOCATE_ARRAY_AUTO(&pszConverted, pSettings->ulLength + 1));
+    ASSERT_SUCCESS(LW_RTL_ALLOCATE_ARRAY_AUTO(&pwszString, pSettings->ulLength + 1));
+    ASSERT_SUCCESS(LW_RTL_ALLOCATE_ARRAY_AUTO(&pwszUpper, pSettings->ulLength + 1));
+
+    /* A typical path or principal name: all ASCII */
+    for (i = 0; i < pSettings->ulLength; i++)
+    {
+        pszString[i] = szAlphabet[i % (sizeof(szAlphabet) - 1)];
+    }
+
+    ASSERT_SUCCESS(TimeNow(&llStart));
+    for (i = 0; i < pSettings->ulIterations; i++)
+    {
+        mbstowc16s(pwszString, pszString, pSettings->ulLength + 1);
+    }
+    ASSERT_SUCCESS(TimeNow(&llEnd));
+    pResults->ullToWc16Duration = (ULONG64) (llEnd - llStart);
+
+    ASSERT_SUCCESS(TimeNow(&llStart));
+    for (i = 0; i < pSettings->ulIterations; i++)
+    {
+        wc16stombs(pszConverted, pwszString, pSettings->ulLength + 1);
+    }
+    ASSERT_SUCCESS(TimeNow(&llEnd));
+    pResults->ullToMbsDuration = (ULONG64) (llEnd - llStart);
+
+    assert(!strcmp(pszString, pszConverted));
+
+    memcpy(pwszUpper, pwszString, (pSettings->ulLength + 1) * sizeof(WCHAR));
+    wc16supper(pwszUpper);
+
+    ASSERT_SUCCESS(TimeNow(&llStart));
+    for (i = 0; i < pSettings->ulIterations; i++)
+    {
+        result += wc16scasecmp(pwszString, pwszUpper);
+    }
+    ASSERT_SUCCESS(TimeNow(&llEnd));
+    pResults->ullCaseCompareDuration = (ULONG64) (llEnd - llStart);
+
+    assert(result == 0);
+
+    RTL_FREE(&pszString);
+    RTL_FREE(&pszConverted);
+    RTL_FREE(&pwszString);
+    RTL_FREE(&pwszUpper);
+}
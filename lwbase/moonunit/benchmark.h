@@ -9,6 +9,19 @@ typedef struct _BENCHMARK_SETTINGS
 } BENCHMARK_SETTINGS, *PBENCHMARK_SETTINGS;
 
 
+typedef struct _BENCHMARK_STRING_SETTINGS
+{
+    ULONG ulLength;
+    ULONG ulIterations;
+} BENCHMARK_STRING_SETTINGS, *PBENCHMARK_STRING_SETTINGS;
+
+typedef struct _BENCHMARK_STRING_RESULTS
+{
+    ULONG64 ullToWc16Duration;
+    ULONG64 ullToMbsDuration;
+    ULONG64 ullCaseCompareDuration;
+} BENCHMARK_STRING_RESULTS, *PBENCHMARK_STRING_RESULTS;
+
 VOID
 BenchmarkThreadPool(
     PLW_THREAD_POOL pPool,
@@ -16,3 +29,9 @@ BenchmarkThreadPool(
     PULONG64 pullDuration,
     PULONG64 pullBytesTransferred
     );
+
+VOID
+BenchmarkStrings(
+    PBENCHMARK_STRING_SETTINGS pSettings,
+    PBENCHMARK_STRING_RESULTS pResults
+    );
@@ -15,3 +15,31 @@ MU_TEST(compare, wc16scasecmp)
     MU_ASSERT(wc16scasecmp(str2, str3) < 0);
     MU_ASSERT(wc16scasecmp(str3, str1) > 0);
 }
+
+MU_TEST(compare, wc16scasecmp_long)
+{
+    wchar16_t str1[80];
+    wchar16_t str2[80];
+    int i;
+
+    setlocale(LC_ALL, "en_US.UTF-8");
+
+    for (i = 0; i < 79; i++)
+    {
+        str1[i] = 'a' + i % 26;
+        str2[i] = 'A' + i % 26;
+    }
+    str1[79] = str2[79] = 0;
+
+    MU_ASSERT(wc16scasecmp(str1, str2) == 0);
+    MU_ASSERT(wc16scasecmp(str1 + 1, str2 + 1) == 0);
+
+    /* Differences and non-ASCII past the first vector block */
+    str2[40] = 0xE9;
+    MU_ASSERT(wc16scasecmp(str1, str2) < 0);
+    str1[40] = 0xC9;
+    MU_ASSERT(wc16scasecmp(str1, str2) == 0);
+
+    str2[70] = 0;
+    MU_ASSERT(wc16scasecmp(str1, str2) > 0);
+}
@@ -39,6 +39,8 @@
 #include <wchar.h>
 #include <locale.h>
 
+#include "benchmark.h"
+
 static
 void CheckCharToWchar16(const char *input)
 {
@@ -121,6 +123,69 @@ MU_TEST(mbstowc16s, longstr)
     }
 }
 
+MU_TEST(mbstowc16s, mixed)
+{
+    char buffer[128];
+    int i;
+
+    setlocale(LC_ALL, "en_US.UTF-8");
+
+    /* Move the first non-ASCII character across the vector blocks */
+    for(i = 0; i < 64; i++)
+    {
+        memset(buffer, 'a', i);
+        strcpy(buffer + i, "日本語 tail");
+        CheckCharToWchar16(buffer);
+    }
+}
+
+MU_TEST(mbstowc16s, truncated)
+{
+    const char *input = "an ascii string longer than one vector block";
+    wchar16_t buffer[64];
+    size_t cch;
+
+    setlocale(LC_ALL, "en_US.UTF-8");
+
+    for(cch = 0; cch <= strlen(input) + 1; cch++)
+    {
+        buffer[cch] = 0xFFFF;
+        MU_ASSERT(mbstowc16s(buffer, input, cch) == (cch <= strlen(input) ? cch : strlen(input)));
+        MU_ASSERT(buffer[cch] == 0xFFFF);
+    }
+}
+
+MU_TEST(wc16stombs, count)
+{
+    wchar16_t buffer[64];
+
+    setlocale(LC_ALL, "en_US.UTF-8");
+
+    MU_ASSERT(mbstowc16s(buffer, "ascii then é", 64) == 12);
+    MU_ASSERT(wc16stombs(NULL, buffer, 0) == 13);
+}
+
+MU_TEST(wc16str, Benchmark)
+{
+    static BENCHMARK_STRING_SETTINGS settings =
+    {
+        .ulLength = 128,
+        .ulIterations = 100000
+    };
+    BENCHMARK_STRING_RESULTS results = {0};
+
+    setlocale(LC_ALL, "en_US.UTF-8");
+
+    BenchmarkStrings(&settings, &results);
+
+    MU_INFO("%u-character strings: mbstowc16s %.1f ns, wc16stombs %.1f ns, "
+            "wc16scasecmp %.1f ns",
+            settings.ulLength,
+            (double) results.ullToWc16Duration / settings.ulIterations,
+            (double) results.ullToMbsDuration / settings.ulIterations,
+            (double) results.ullCaseCompareDuration / settings.ulIterations);
+}
+
 MU_TEST(wcstowc16s, simple)
 {
     setlocale(LC_ALL, "en_US.UTF-8");
@@ -745,6 +745,16 @@ LwRtlHashEqualPstrCaseless(
              LwRtlCStringIsEqual(pszStr1, pszStr2, FALSE)));
 }
 
+/*
+ * The digests below are the usual d = d * 31 + c over each unit.
+ * Taking four units per step as d * 31^4 + c0 * 31^3 + ... + c3 gives
+ * the same value (the arithmetic is modulo 2^32 either way) without one
+ * long chain of dependent multiplies.
+ */
+#define HASH_31_2 (31U * 31U)
+#define HASH_31_3 (31U * 31U * 31U)
+#define HASH_31_4 (31U * 31U * 31U * 31U)
+
 LW_ULONG
 LwRtlHashDigestPwstr(
     LW_PCVOID pKey,
@@ -756,6 +766,16 @@ LwRtlHashDigestPwstr(
 
     if (pwszStr)
     {
+        while (pwszStr[0] && pwszStr[1] && pwszStr[2] && pwszStr[3])
+        {
+            ulDigest = ulDigest * HASH_31_4 +
+                       pwszStr[0] * HASH_31_3 +
+                       pwszStr[1] * HASH_31_2 +
+                       pwszStr[2] * 31U +
+                       pwszStr[3];
+            pwszStr += 4;
+        }
+
         while (*pwszStr)
         {
             ulDigest = ulDigest * 31 + *(pwszStr++);
@@ -780,20 +800,14 @@ LwRtlHashEqualPwstr(
              LwRtlWC16StringIsEqual(pwszStr1, pwszStr2, TRUE)));
 }
 
-static
+static inline
 WCHAR
 ToUpper(
     WCHAR c
     )
 {
-    if (c >= 0x61 && c <= 0x7A)
-    {
-        return c - 0x20;
-    }
-    else
-    {
-        return c;
-    }
+    /* Branch-free: subtract 0x20 from 'a'..'z' only */
+    return c - (((WCHAR) (c - 0x61) < 26) << 5);
 }
 
 LW_ULONG
@@ -807,6 +821,16 @@ LwRtlHashDigestPwstrCaseless(
 
     if (pwszStr)
     {
+        while (pwszStr[0] && pwszStr[1] && pwszStr[2] && pwszStr[3])
+        {
+            ulDigest = ulDigest * HASH_31_4 +
+                       ToUpper(pwszStr[0]) * HASH_31_3 +
+                       ToUpper(pwszStr[1]) * HASH_31_2 +
+                       ToUpper(pwszStr[2]) * 31U +
+                       ToUpper(pwszStr[3]);
+            pwszStr += 4;
+        }
+
         while (*pwszStr)
         {
             ulDigest = ulDigest * 31 + ToUpper(*(pwszStr++));
@@ -47,6 +47,7 @@
 #include <lw/rtlmemory.h>
 #include <lw/rtlgoto.h>
 #include <wc16str.h>
+#include "wc16str-internal.h"
 
 VOID
 LwRtlUnicodeStringInit(
@@ -273,19 +274,24 @@ LwRtlUnicodeStringIsEqual(
     }
     else if (bIsCaseSensitive)
     {
-        ULONG i;
-        for (i = 0; i < pString1->Length / sizeof(pString1->Buffer[0]); i++)
+        ULONG count = pString1->Length / sizeof(pString1->Buffer[0]);
+
+        if (wc16s_mismatch_n(pString1->Buffer, pString2->Buffer, count) != count)
         {
-            if (pString1->Buffer[i] != pString2->Buffer[i])
-            {
-                GOTO_CLEANUP();
-            }
+            GOTO_CLEANUP();
         }
     }
     else
     {
-        ULONG i;
-        for (i = 0; i < pString1->Length / sizeof(pString1->Buffer[0]); i++)
+        ULONG count = pString1->Length / sizeof(pString1->Buffer[0]);
+        ULONG i = 0;
+
+        /* Only units that differ need case folding */
+        for (i = wc16s_mismatch_n(pString1->Buffer, pString2->Buffer, count);
+             i < count;
+             i += 1 + wc16s_mismatch_n(pString1->Buffer + i + 1,
+                                       pString2->Buffer + i + 1,
+                                       count - i - 1))
         {
             wchar16_t c1[] = { pString1->Buffer[i], 0 };
             wchar16_t c2[] = { pString2->Buffer[i], 0 };
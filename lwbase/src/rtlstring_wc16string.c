@@ -48,6 +48,7 @@
 #include <lw/rtlgoto.h>
 #include <wc16str.h>
 #include <wc16printf.h>
+#include "wc16str-internal.h"
 
 size_t
 LwRtlWC16StringNumChars(
@@ -172,20 +173,16 @@ LwRtlWC16StringIsEqual(
     BOOLEAN bIsEqual = FALSE;
     PCWSTR pCurrent1 = pString1;
     PCWSTR pCurrent2 = pString2;
+    size_t sMismatch = 0;
 
     // TODO--comparison -- need fix in libunistr...
 
     if (bIsCaseSensitive)
     {
-        while (pCurrent1[0] && pCurrent2[0])
-        {
-            if (pCurrent1[0] != pCurrent2[0])
-            {
-                GOTO_CLEANUP();
-            }
-            pCurrent1++;
-            pCurrent2++;
-        }
+        sMismatch = wc16s_mismatch(pCurrent1, pCurrent2);
+        pCurrent1 += sMismatch;
+        pCurrent2 += sMismatch;
+
         if (pCurrent1[0] || pCurrent2[0])
         {
             GOTO_CLEANUP();
@@ -193,10 +190,23 @@ LwRtlWC16StringIsEqual(
     }
     else
     {
-        while (pCurrent1[0] && pCurrent2[0])
+        for (;;)
         {
-            wchar16_t c1[] = { pCurrent1[0], 0 };
-            wchar16_t c2[] = { pCurrent2[0], 0 };
+            wchar16_t c1[] = { 0, 0 };
+            wchar16_t c2[] = { 0, 0 };
+
+            /* Only units that differ need case folding */
+            sMismatch = wc16s_mismatch(pCurrent1, pCurrent2);
+            pCurrent1 += sMismatch;
+            pCurrent2 += sMismatch;
+
+            if (!pCurrent1[0] || !pCurrent2[0])
+            {
+                break;
+            }
+
+            c1[0] = pCurrent1[0];
+            c2[0] = pCurrent2[0];
             wc16supper(c1);
             wc16supper(c2);
             if (c1[0] != c2[0])
@@ -0,0 +1,85 @@
+/*
+ * Copyright Likewise Software
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the license, or (at
+ * your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+ * General Public License for more details.  You should have received a copy
+ * of the GNU Lesser General Public License along with this program.  If
+ * not, see <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * LESSER GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Module Name:
+ *
+ *        wc16str-internal.h
+ *
+ * Abstract:
+ *
+ *        ASCII fast paths shared by the string routines
+ *
+ *        Each routine handles the longest leading run it can and
+ *        returns its length; the caller finishes the rest with the
+ *        general (locale/iconv aware) code, so results are identical
+ *        to the slow path for any input.
+ *
+ */
+
+#ifndef __LWBASE_WC16STR_INTERNAL_H__
+#define __LWBASE_WC16STR_INTERNAL_H__
+
+#include <wc16str.h>
+
+/* Narrow the leading run of non-NUL ASCII units of src (at most n)
+ * into dest, which may be NULL to only count them.
+ */
+size_t
+wc16s_ascii_narrow(
+    char* dest,
+    const wchar16_t* src,
+    size_t n
+    );
+
+/* Widen the leading run of non-NUL ASCII bytes of src (at most n)
+ * into dest, which may be NULL to only count them.
+ */
+size_t
+mbs_ascii_widen(
+    wchar16_t* dest,
+    const char* src,
+    size_t n
+    );
+
+/* Index of the first unit where s1 and s2 differ, or of the common
+ * NUL terminator if they do not.
+ */
+size_t
+wc16s_mismatch(
+    const wchar16_t* s1,
+    const wchar16_t* s2
+    );
+
+/* Index of the first of n units where s1 and s2 differ, or n */
+size_t
+wc16s_mismatch_n(
+    const wchar16_t* s1,
+    const wchar16_t* s2,
+    size_t n
+    );
+
+#endif
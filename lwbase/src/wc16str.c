@@ -54,6 +54,14 @@
 #include <limits.h>
 #include <stdio.h>
 #include "wc16printf.h"
+#include "wc16str-internal.h"
+
+/* SSE2 is part of the x86-64 baseline; everything else gets the
+ * scalar loops */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define WC16STR_USE_SSE2 1
+#endif
 
 #ifdef _WIN32
 #pragma warning( disable : 4996 )
@@ -86,6 +94,276 @@
 typedef int (*caseconv)(int c);
 typedef wint_t (*wcaseconv)(wint_t c);
 
+#define IS_ASCII_UNIT(c) ((c) != 0 && (c) < 0x80)
+
+#ifdef WC16STR_USE_SSE2
+/*
+ * The vector loops below read whole 16-byte blocks.  A block read
+ * through an aligned pointer never crosses a page, so reading past the
+ * terminator is safe; an unaligned pointer must be checked first.
+ */
+#define WC16STR_ALIGNED(p)      ((((uintptr_t) (p)) & 15) == 0)
+#define WC16STR_CROSSES_PAGE(p) ((((uintptr_t) (p)) & 4095) > 4096 - 16)
+
+/* 0xFFFF in each 16-bit lane holding a non-NUL ASCII unit */
+static inline
+__m128i
+wc16s_ascii_lanes(
+    __m128i v
+    )
+{
+    const __m128i high = _mm_set1_epi16((short) 0xFF80);
+    const __m128i zero = _mm_setzero_si128();
+
+    return _mm_andnot_si128(
+                _mm_cmpeq_epi16(v, zero),
+                _mm_cmpeq_epi16(_mm_and_si128(v, high), zero));
+}
+#endif
+
+size_t
+wc16s_ascii_narrow(
+    char* dest,
+    const wchar16_t* src,
+    size_t n
+    )
+{
+    size_t i = 0;
+
+#ifdef WC16STR_USE_SSE2
+    if ((((uintptr_t) src) & 1) == 0)
+    {
+        for (; i < n && !WC16STR_ALIGNED(src + i); i++)
+        {
+            if (!IS_ASCII_UNIT(src[i]))
+            {
+                return i;
+            }
+            if (dest)
+            {
+                dest[i] = (char) src[i];
+            }
+        }
+
+        for (; n - i >= 8; i += 8)
+        {
+            __m128i v = _mm_load_si128((const __m128i*) (src + i));
+
+            if (_mm_movemask_epi8(wc16s_ascii_lanes(v)) != 0xFFFF)
+            {
+                break;
+            }
+            if (dest)
+            {
+                _mm_storel_epi64((__m128i*) (dest + i), _mm_packus_epi16(v, v));
+            }
+        }
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        if (!IS_ASCII_UNIT(src[i]))
+        {
+            break;
+        }
+        if (dest)
+        {
+            dest[i] = (char) src[i];
+        }
+    }
+
+    return i;
+}
+
+size_t
+mbs_ascii_widen(
+    wchar16_t* dest,
+    const char* src,
+    size_t n
+    )
+{
+    const unsigned char* usrc = (const unsigned char*) src;
+    size_t i = 0;
+
+#ifdef WC16STR_USE_SSE2
+    for (; i < n && !WC16STR_ALIGNED(usrc + i); i++)
+    {
+        if (!IS_ASCII_UNIT(usrc[i]))
+        {
+            return i;
+        }
+        if (dest)
+        {
+            dest[i] = usrc[i];
+        }
+    }
+
+    for (; n - i >= 16; i += 16)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i v = _mm_load_si128((const __m128i*) (usrc + i));
+
+        /* High bit set means non-ASCII */
+        if (_mm_movemask_epi8(v) | _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)))
+        {
+            break;
+        }
+        if (dest)
+        {
+            _mm_storeu_si128((__m128i*) (dest + i), _mm_unpacklo_epi8(v, zero));
+            _mm_storeu_si128((__m128i*) (dest + i + 8), _mm_unpackhi_epi8(v, zero));
+        }
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        if (!IS_ASCII_UNIT(usrc[i]))
+        {
+            break;
+        }
+        if (dest)
+        {
+            dest[i] = usrc[i];
+        }
+    }
+
+    return i;
+}
+
+size_t
+wc16s_mismatch(
+    const wchar16_t* s1,
+    const wchar16_t* s2
+    )
+{
+    size_t i = 0;
+
+#ifdef WC16STR_USE_SSE2
+    if (((((uintptr_t) s1) | ((uintptr_t) s2)) & 1) == 0)
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        /* Callers often resume right after a case difference, so try
+           one unaligned block before lining up on s1 */
+        if (!WC16STR_ALIGNED(s1) &&
+            !WC16STR_CROSSES_PAGE(s1) &&
+            !WC16STR_CROSSES_PAGE(s2))
+        {
+            __m128i v1 = _mm_loadu_si128((const __m128i*) s1);
+            int mask = _mm_movemask_epi8(
+                            _mm_andnot_si128(
+                                _mm_cmpeq_epi16(v1, zero),
+                                _mm_cmpeq_epi16(
+                                    v1,
+                                    _mm_loadu_si128((const __m128i*) s2))));
+            if (mask != 0xFFFF)
+            {
+                return __builtin_ctz(~mask) / 2;
+            }
+
+            i = (16 - (((uintptr_t) s1) & 15)) / 2;
+        }
+
+        for (; !WC16STR_ALIGNED(s1 + i); i++)
+        {
+            if (s1[i] != s2[i] || !s1[i])
+            {
+                return i;
+            }
+        }
+
+        for (;;)
+        {
+            __m128i v1;
+            __m128i v2;
+            int mask = 0;
+
+            if (WC16STR_CROSSES_PAGE(s2 + i))
+            {
+                size_t end = i + 8;
+
+                for (; i < end; i++)
+                {
+                    if (s1[i] != s2[i] || !s1[i])
+                    {
+                        return i;
+                    }
+                }
+                continue;
+            }
+
+            v1 = _mm_load_si128((const __m128i*) (s1 + i));
+            v2 = _mm_loadu_si128((const __m128i*) (s2 + i));
+
+            mask = _mm_movemask_epi8(
+                        _mm_andnot_si128(
+                            _mm_cmpeq_epi16(v1, zero),
+                            _mm_cmpeq_epi16(v1, v2)));
+            if (mask != 0xFFFF)
+            {
+                return i + __builtin_ctz(~mask) / 2;
+            }
+
+            i += 8;
+        }
+    }
+#endif
+
+    while (s1[i] == s2[i] && s1[i])
+    {
+        i++;
+    }
+
+    return i;
+}
+
+size_t
+wc16s_mismatch_n(
+    const wchar16_t* s1,
+    const wchar16_t* s2,
+    size_t n
+    )
+{
+    size_t i = 0;
+
+#ifdef WC16STR_USE_SSE2
+    for (; n - i >= 8; i += 8)
+    {
+        __m128i v1 = _mm_loadu_si128((const __m128i*) (s1 + i));
+        __m128i v2 = _mm_loadu_si128((const __m128i*) (s2 + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(v1, v2));
+
+        if (mask != 0xFFFF)
+        {
+            return i + __builtin_ctz(~mask) / 2;
+        }
+    }
+#endif
+
+    while (i < n && s1[i] == s2[i])
+    {
+        i++;
+    }
+
+    return i;
+}
+
+/* Locales whose multibyte encoding represents ASCII as itself */
+static
+int
+locale_is_ascii_compatible(
+    void
+    )
+{
+    char* lcname = setlocale(LC_CTYPE, NULL);
+
+    return (strstr(lcname, ".UTF-8") ||
+            !strcmp(lcname, "C") ||
+            !strcmp(lcname, "POSIX"));
+}
+
 // Returns the integer value of a digit character for a given base. If the
 // character is not a valid digit, -1 is returned.
 static
@@ -226,6 +504,31 @@ size_t _wc16slen(const wchar16_t *str)
     size_t i = 0;
     if (str == NULL) return i;
 
+#ifdef WC16STR_USE_SSE2
+    if ((((uintptr_t) str) & 1) == 0)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        int mask = 0;
+
+        for (; !WC16STR_ALIGNED(str + i); i++)
+        {
+            if (str[i] == 0) return i;
+        }
+
+        for (;; i += 8)
+        {
+            mask = _mm_movemask_epi8(
+                        _mm_cmpeq_epi16(
+                            _mm_load_si128((const __m128i*) (str + i)),
+                            zero));
+            if (mask)
+            {
+                return i + __builtin_ctz(mask) / 2;
+            }
+        }
+    }
+#endif
+
     while (str[i] != 0) i++;
 
     return i;
@@ -419,7 +722,7 @@ extern int wcscasecmp(const wchar_t *w1, const wchar_t *w2);
 
 #endif
 
-int wc16scasecmp(const wchar16_t *s1, const wchar16_t *s2)
+static int wc16scasecmp_slow(const wchar16_t *s1, const wchar16_t *s2)
 {
     int need_free = 0;
     wchar_t* w1, *w2;
@@ -439,6 +742,49 @@ int wc16scasecmp(const wchar16_t *s1, const wchar16_t *s2)
     return result;
 }
 
+/*
+ * Skip the common prefix (identical units, or ASCII units equal after
+ * towlower) and hand whatever is left to wcscasecmp, which compares
+ * position by position and so gives the same answer on the suffix.
+ */
+int wc16scasecmp(const wchar16_t *s1, const wchar16_t *s2)
+{
+    size_t i = 0;
+
+    for (;;)
+    {
+        wchar16_t c1 = s1[i];
+        wchar16_t c2 = s2[i];
+
+        if (c1 == c2)
+        {
+            if (!c1)
+            {
+                return 0;
+            }
+
+            i += wc16s_mismatch(s1 + i, s2 + i);
+            continue;
+        }
+
+        if (!IS_ASCII_UNIT(c1) || !IS_ASCII_UNIT(c2) ||
+            towlower(c1) != towlower(c2))
+        {
+            break;
+        }
+
+        i++;
+    }
+
+    /* Never split a surrogate pair */
+    if (i > 0 && s1[i - 1] >= 0xD800 && s1[i - 1] <= 0xDBFF)
+    {
+        i--;
+    }
+
+    return wc16scasecmp_slow(s1 + i, s2 + i);
+}
+
 /*Optimistically try to wc16sncpy()
  *
  * Returns the length of dest needed for a successful copy including
@@ -622,7 +968,9 @@ wchar16_t *ambstowc16s(const char *input)
     wchar16_t *buffer;
     if(input == NULL)
         return NULL;
-    cchlen = mbstrlen(input);
+    cchlen = mbs_ascii_widen(NULL, input, SIZE_MAX);
+    if(input[cchlen] != '\0' || !locale_is_ascii_compatible())
+        cchlen = mbstrlen(input);
     if(cchlen == (size_t)-1)
         return NULL;
     buffer = malloc((cchlen + 1) * sizeof(wchar16_t));
@@ -636,11 +984,7 @@ wchar16_t *ambstowc16s(const char *input)
     return buffer;
 }
 
-/*Convert a multibyte character string to a wchar16_t string and return the number of characters converted.
- *
- * cchn is the maximum number of characters to store in dest (including null).
- */
-size_t mbstowc16s(wchar16_t *dest, const char *src, size_t cchcopy)
+static size_t mbstowc16s_slow(wchar16_t *dest, const char *src, size_t cchcopy)
 {
 #ifdef WCHAR16_IS_WCHAR
     return mbstowcs(dest, src, cchcopy);
@@ -669,6 +1013,35 @@ size_t mbstowc16s(wchar16_t *dest, const char *src, size_t cchcopy)
 #endif
 }
 
+/*Convert a multibyte character string to a wchar16_t string and return the number of characters converted.
+ *
+ * cchn is the maximum number of characters to store in dest (including null).
+ */
+size_t mbstowc16s(wchar16_t *dest, const char *src, size_t cchcopy)
+{
+    size_t i = 0;
+    size_t res = 0;
+
+    if (!dest || !src || !locale_is_ascii_compatible())
+    {
+        return mbstowc16s_slow(dest, src, cchcopy);
+    }
+
+    i = mbs_ascii_widen(dest, src, cchcopy);
+    if (i == cchcopy)
+    {
+        return i;
+    }
+    else if (src[i] == '\0')
+    {
+        dest[i] = 0;
+        return i;
+    }
+
+    res = mbstowc16s_slow(dest + i, src + i, cchcopy - i);
+    return res == (size_t) -1 ? res : i + res;
+}
+
 size_t mbstowc16les(wchar16_t *dest, const char *src, size_t cchcopy)
 {
 #ifdef WCHAR16_IS_WCHAR
@@ -821,48 +1194,35 @@ static size_t wc16stombs_slow(char *dest, const wchar16_t *src, size_t cbcopy)
 
 static size_t wc16stombs_fast(char* dest, const wchar16_t *src, size_t cbcopy)
 {
+    size_t n = dest ? cbcopy : SIZE_MAX;
     size_t i = 0;
     size_t res = 0;
 
-    for (i = 0; !dest || i < cbcopy; i++)
+    i = wc16s_ascii_narrow(dest, src, n);
+    if (i == n)
     {
-        wchar16_t wc = src[i];
-        wchar16_t upper = wc & 0xFF00;
-        wchar16_t lower = wc & 0x00FF;
-
-        if (upper == 0 && lower <= 127)
-        {
-            if (dest)
-            {
-                dest[i] = (char) lower;
-            }
-
-            if (lower == 0)
-            {
-                break;
-            }
-        }
-        else
+        return i;
+    }
+    else if (src[i] == 0)
+    {
+        if (dest)
         {
-            /* We encountered a character we couldn't handle, so fall back
-               on slow but accurate conversion path */
-            res = wc16stombs_slow((dest ? dest + i : NULL),
-                                  src + i,
-                                  (i > cbcopy ? 0 : cbcopy - i));
-            return res == (size_t) -1 ? res : i + res;
+            dest[i] = '\0';
         }
+        return i;
     }
 
-    return i;
+    /* We encountered a character we couldn't handle, so fall back
+       on slow but accurate conversion path */
+    res = wc16stombs_slow((dest ? dest + i : NULL),
+                          src + i,
+                          (i > cbcopy ? 0 : cbcopy - i));
+    return res == (size_t) -1 ? res : i + res;
 }
 
 size_t wc16stombs(char *dest, const wchar16_t *src, size_t cbcopy)
 {
-    char* lcname = setlocale(LC_CTYPE, NULL);
-
-    if (strstr (lcname, ".UTF-8") ||
-        !strcmp (lcname, "C") ||
-        !strcmp (lcname, "POSIX"))
+    if (locale_is_ascii_compatible())
     {
         return wc16stombs_fast(dest, src, cbcopy);
     }
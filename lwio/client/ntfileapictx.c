@@ -1674,6 +1674,56 @@ cleanup:
     return status;
 }
 
+NTSTATUS
+LwIoOpenNamedPipeChannel(
+    IN IO_FILE_HANDLE File,
+    OUT int* pFd
+    )
+{
+    NTSTATUS status = 0;
+    int EE = 0;
+    const LWMsgTag requestType = NT_IPC_MESSAGE_TYPE_OPEN_PIPE_CHANNEL;
+    const LWMsgTag responseType = NT_IPC_MESSAGE_TYPE_OPEN_PIPE_CHANNEL_RESULT;
+    NT_IPC_MESSAGE_GENERIC_FILE request = { 0 };
+    PNT_IPC_MESSAGE_OPEN_PIPE_CHANNEL_RESULT pResponse = NULL;
+    PVOID pReply = NULL;
+    LWMsgCall* pCall = NULL;
+
+    *pFd = -1;
+
+    status = LwIoConnectionAcquireCall(&pCall);
+    GOTO_CLEANUP_ON_STATUS_EE(status, EE);
+
+    request.FileHandle = File;
+
+    status = NtpCtxCall(pCall,
+                        requestType,
+                        &request,
+                        responseType,
+                        &pReply);
+    GOTO_CLEANUP_ON_STATUS_EE(status, EE);
+
+    pResponse = (PNT_IPC_MESSAGE_OPEN_PIPE_CHANNEL_RESULT) pReply;
+
+    status = pResponse->Status;
+    GOTO_CLEANUP_ON_STATUS_EE(status, EE);
+
+    // Take the descriptor so freeing the response does not close it
+    *pFd = pResponse->Fd;
+    pResponse->Fd = -1;
+
+cleanup:
+
+    if (pCall)
+    {
+        NtpCtxFreeResponse(pCall, responseType, pResponse);
+        lwmsg_call_release(pCall);
+    }
+
+    LOG_LEAVE_IF_STATUS_EE(status, EE);
+    return status;
+}
+
 VOID
 LwNtCancelAsyncCancelContext(
     LW_IN PIO_ASYNC_CANCEL_CONTEXT AsyncCancelContext
@@ -104,10 +104,21 @@
 #define IO_OPLOCK_REQUEST_OPLOCK_BATCH      0x01
 #define IO_OPLOCK_REQUEST_OPLOCK_LEVEL_1    0x02
 #define IO_OPLOCK_REQUEST_OPLOCK_LEVEL_2    0x03
+#define IO_OPLOCK_REQUEST_LEASE             0x04
+
+// Lease state bits used with IO_OPLOCK_REQUEST_LEASE.  All handles
+// opened with the same lease key (see SRV_ECP_TYPE_LEASE_KEY) share
+// a single lease state.
+
+#define IO_LEASE_STATE_NONE                 0x00
+#define IO_LEASE_STATE_READ                 0x01
+#define IO_LEASE_STATE_HANDLE               0x02
+#define IO_LEASE_STATE_WRITE                0x04
 
 typedef struct _IO_FSCTL_REQUEST_OPLOCK_INPUT_BUFFER
 {
     ULONG OplockRequestType;
+    ULONG LeaseState;
 
 } IO_FSCTL_OPLOCK_REQUEST_INPUT_BUFFER,
     *PIO_FSCTL_OPLOCK_REQUEST_INPUT_BUFFER;
@@ -118,9 +129,12 @@ typedef struct _IO_FSCTL_REQUEST_OPLOCK_INPUT_BUFFER
 #define IO_OPLOCK_BROKEN_TO_NONE             0x00000001
 #define IO_OPLOCK_BROKEN_TO_LEVEL_2          0x00000002
 
+// For leases, LeaseState holds the state the lease was broken to
+
 typedef struct _IO_FSCTL_OPLOCK_REQUEST_OUTPUT_BUFFER
 {
     ULONG OplockBreakResult;
+    ULONG LeaseState;
 
 } IO_FSCTL_OPLOCK_REQUEST_OUTPUT_BUFFER,
     *PIO_FSCTL_OPLOCK_REQUEST_OUTPUT_BUFFER;
@@ -132,9 +146,12 @@ typedef struct _IO_FSCTL_OPLOCK_REQUEST_OUTPUT_BUFFER
 #define IO_OPLOCK_BREAK_ACK_NO_LEVEL_2      0x02
 #define IO_OPLOCK_BREAK_CLOSE_PENDING       0x03
 
+// For leases, LeaseState is the state acknowledged by the client
+
 typedef struct _IO_FSCTL_OPLOCK_BREAK_ACK_INPUT_BUFFER
 {
     ULONG Response;
+    ULONG LeaseState;
 
 } IO_FSCTL_OPLOCK_BREAK_ACK_INPUT_BUFFER,
     *PIO_FSCTL_OPLOCK_BREAK_ACK_INPUT_BUFFER;
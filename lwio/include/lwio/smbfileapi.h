@@ -70,6 +70,19 @@ LwIoConnectNamedPipe(
     PIO_STATUS_BLOCK IoStatusBlock
     );
 
+/**
+ * Trade the server end of a connected named pipe for one end of a
+ * socket.  Pipe data can then be moved with read/write on the
+ * returned descriptor instead of NtReadFile/NtWriteFile; the pipe
+ * handle must stay open (and is still used for queries) until the
+ * descriptor is closed.  Only npfs pipes support this.
+ */
+LW_NTSTATUS
+LwIoOpenNamedPipeChannel(
+    IO_FILE_HANDLE File,
+    int* pFd
+    );
+
 LW_NTSTATUS
 LwIoSetRdrDomainHints(
     LW_PWSTR* ppwszDomains,
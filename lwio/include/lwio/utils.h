@@ -164,6 +164,16 @@ LwIoCloseConfig(
     PLWIO_CONFIG_REG pReg
     );
 
+NTSTATUS
+LwIoWaitForConfigChange(
+    PDWORD pdwGeneration
+    );
+
+VOID
+LwIoCancelWaitForConfigChange(
+    VOID
+    );
+
 NTSTATUS
 LwIoReadConfigString(
     PLWIO_CONFIG_REG pReg,
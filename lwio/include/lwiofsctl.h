@@ -49,6 +49,7 @@
 #define IO_NPFS_FSCTL_CONNECT_NAMED_PIPE    0x02
 #define IO_FSCTL_SMB_GET_PEER_ACCESS_TOKEN  0x03
 #define IO_FSCTL_SMB_GET_PEER_ADDRESS       0x04
+#define IO_NPFS_FSCTL_OPEN_CHANNEL          0x05
 
 #define IO_FSCTL_PIPE_WAIT                  0x00110018
 #define IO_FSCTL_PIPE_TRANSCEIVE            0x0011C017
@@ -101,7 +101,9 @@ typedef enum _NT_IPC_MESSAGE_TYPE
     NT_IPC_MESSAGE_TYPE_QUERY_SECURITY_FILE,
     NT_IPC_MESSAGE_TYPE_QUERY_SECURITY_FILE_RESULT,
     NT_IPC_MESSAGE_TYPE_SET_SECURITY_FILE,
-    NT_IPC_MESSAGE_TYPE_SET_SECURITY_FILE_RESULT
+    NT_IPC_MESSAGE_TYPE_SET_SECURITY_FILE_RESULT,
+    NT_IPC_MESSAGE_TYPE_OPEN_PIPE_CHANNEL,              // NT_IPC_MESSAGE_GENERIC_FILE
+    NT_IPC_MESSAGE_TYPE_OPEN_PIPE_CHANNEL_RESULT
 } NT_IPC_MESSAGE_TYPE, *PNT_IPC_MESSAGE_TYPE;
 
 //
@@ -398,6 +400,22 @@ typedef struct _NT_IPC_MESSAGE_SET_SECURITY_FILE {
     IN ULONG Length;
 } NT_IPC_MESSAGE_SET_SECURITY_FILE, *PNT_IPC_MESSAGE_SET_SECURITY_FILE;
 
+//
+// LwIoOpenNamedPipeChannel
+//
+// IN TAG:  NT_IPC_MESSAGE_TYPE_OPEN_PIPE_CHANNEL
+// OUT TAG: NT_IPC_MESSAGE_TYPE_OPEN_PIPE_CHANNEL_RESULT
+//
+// IN:  NT_IPC_MESSAGE_GENERIC_FILE
+// OUT: NT_IPC_MESSAGE_OPEN_PIPE_CHANNEL_RESULT
+//
+
+typedef struct _NT_IPC_MESSAGE_OPEN_PIPE_CHANNEL_RESULT {
+    OUT NTSTATUS Status;
+    // Server end of the channel, passed to the caller as a descriptor
+    OUT int Fd;
+} NT_IPC_MESSAGE_OPEN_PIPE_CHANNEL_RESULT, *PNT_IPC_MESSAGE_OPEN_PIPE_CHANNEL_RESULT;
+
 //
 // Functions
 //
@@ -374,6 +374,16 @@ LWMsgTypeSpec gNtIpcTypeSpecMessageSetSecurityFile[] =
     LWMSG_TYPE_END
 };
 
+static
+LWMsgTypeSpec gNtIpcTypeSpecMessageOpenPipeChannelResult[] =
+{
+    LWMSG_STRUCT_BEGIN(NT_IPC_MESSAGE_OPEN_PIPE_CHANNEL_RESULT),
+    _LWMSG_MEMBER_NTSTATUS(NT_IPC_MESSAGE_OPEN_PIPE_CHANNEL_RESULT, Status),
+    LWMSG_MEMBER_FD(NT_IPC_MESSAGE_OPEN_PIPE_CHANNEL_RESULT, Fd),
+    LWMSG_STRUCT_END,
+    LWMSG_TYPE_END
+};
+
 static
 LWMsgProtocolSpec gNtIpcProtocolSpec[] =
 {
@@ -409,6 +419,8 @@ LWMsgProtocolSpec gNtIpcProtocolSpec[] =
     LWMSG_MESSAGE(NT_IPC_MESSAGE_TYPE_QUERY_SECURITY_FILE_RESULT,    gNtIpcTypeSpecMessageGenericFileBufferResult),
     LWMSG_MESSAGE(NT_IPC_MESSAGE_TYPE_SET_SECURITY_FILE,             gNtIpcTypeSpecMessageSetSecurityFile),
     LWMSG_MESSAGE(NT_IPC_MESSAGE_TYPE_SET_SECURITY_FILE_RESULT,      gNtIpcTypeSpecMessageGenericFileIoResult),
+    LWMSG_MESSAGE(NT_IPC_MESSAGE_TYPE_OPEN_PIPE_CHANNEL,             gNtIpcTypeSpecMessageGenericFile),
+    LWMSG_MESSAGE(NT_IPC_MESSAGE_TYPE_OPEN_PIPE_CHANNEL_RESULT,      gNtIpcTypeSpecMessageOpenPipeChannelResult),
     LWMSG_PROTOCOL_END
 };
 
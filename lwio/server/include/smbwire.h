@@ -188,6 +188,26 @@ typedef ULONG SMB2_FLAGS;
 #define SMB2_FLAGS_SIGNED            0x00000008
 #define SMB2_FLAGS_DFS_OPERATIONS    0x10000000
 
+typedef USHORT SMB2_DIALECT;
+
+#define SMB2_DIALECT_2_002           0x0202
+#define SMB2_DIALECT_2_1             0x0210
+#define SMB2_DIALECT_WILDCARD        0x02FF
+
+typedef ULONG SMB2_GLOBAL_CAPABILITIES;
+
+#define SMB2_GLOBAL_CAP_DFS          0x00000001
+#define SMB2_GLOBAL_CAP_LEASING      0x00000002
+
+typedef ULONG SMB2_LEASE_STATE;
+
+#define SMB2_LEASE_NONE              0x00000000
+#define SMB2_LEASE_READ_CACHING      0x00000001
+#define SMB2_LEASE_HANDLE_CACHING    0x00000002
+#define SMB2_LEASE_WRITE_CACHING     0x00000004
+
+#define SMB2_NOTIFY_BREAK_LEASE_FLAG_ACK_REQUIRED 0x00000001
+
 typedef USHORT SMB2_SESSION_FLAGS;
 
 #define SMB2_SESSION_FLAGS_IS_GUEST_USER 0x0001
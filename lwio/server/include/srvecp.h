@@ -38,5 +38,15 @@
 #define SRV_ECP_TYPE_NET_OPEN_INFO   "Likewise.SRV.NetworkOpenInfo"
 #define SRV_ECP_TYPE_PIPE_INFO       "Likewise.SRV.FilePipeInfo"
 #define SRV_ECP_TYPE_PIPE_LOCAL_INFO "Likewise.SRV.FilePipeLocalInfo"
+#define SRV_ECP_TYPE_LEASE_KEY       "Likewise.SRV.LeaseKey"
+
+/* SMB2.1 lease keys are only unique per client */
+
+typedef struct _SRV_ECP_LEASE_KEY
+{
+    UCHAR ClientGuid[16];
+    UCHAR LeaseKey[16];
+
+} SRV_ECP_LEASE_KEY, *PSRV_ECP_LEASE_KEY;
 
 #endif /* __SRV_ECP_H__ */
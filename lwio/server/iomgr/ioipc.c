@@ -44,6 +44,7 @@
 
 #include "iop.h"
 #include "ntipcmsg.h"
+#include "lwiofsctl.h"
 #include "ntlogmacros.h"
 #include <lwio/ioapi.h>
 #include "ioipc.h"
@@ -679,15 +680,24 @@ IopIpcFsControlFile(
         GOTO_CLEANUP_ON_STATUS_EE(pReply->Status, EE);
     }
 
-    status = IoFsControlFile(
-        pMessage->FileHandle,
-        &pContext->asyncBlock,
-        &pContext->ioStatusBlock,
-        pMessage->ControlCode,
-        pMessage->InputBuffer,
-        pMessage->InputBufferLength,
-        pReply->Buffer,
-        pMessage->OutputBufferLength);
+    if (pMessage->ControlCode == IO_NPFS_FSCTL_OPEN_CHANNEL)
+    {
+        // The descriptor is only meaningful in this process;
+        // callers must use NT_IPC_MESSAGE_TYPE_OPEN_PIPE_CHANNEL.
+        status = STATUS_INVALID_DEVICE_REQUEST;
+    }
+    else
+    {
+        status = IoFsControlFile(
+            pMessage->FileHandle,
+            &pContext->asyncBlock,
+            &pContext->ioStatusBlock,
+            pMessage->ControlCode,
+            pMessage->InputBuffer,
+            pMessage->InputBufferLength,
+            pReply->Buffer,
+            pMessage->OutputBufferLength);
+    }
 
     switch (status)
     {
@@ -1142,6 +1152,54 @@ cleanup:
     return NtIpcNtStatusToLWMsgStatus(status);
 }
 
+LWMsgStatus
+IopIpcOpenPipeChannel(
+    IN LWMsgCall* pCall,
+    IN const LWMsgParams* pIn,
+    OUT LWMsgParams* pOut,
+    IN void* pData
+    )
+{
+    NTSTATUS status = 0;
+    int EE = 0;
+    const LWMsgTag messageType = NT_IPC_MESSAGE_TYPE_OPEN_PIPE_CHANNEL;
+    const LWMsgTag replyType = NT_IPC_MESSAGE_TYPE_OPEN_PIPE_CHANNEL_RESULT;
+    PNT_IPC_MESSAGE_GENERIC_FILE pMessage = (PNT_IPC_MESSAGE_GENERIC_FILE) pIn->data;
+    PNT_IPC_MESSAGE_OPEN_PIPE_CHANNEL_RESULT pReply = NULL;
+    IO_STATUS_BLOCK ioStatusBlock = { 0 };
+    int fd = -1;
+
+    assert(messageType == pIn->tag);
+
+    status = IO_ALLOCATE(&pReply, NT_IPC_MESSAGE_OPEN_PIPE_CHANNEL_RESULT, sizeof(*pReply));
+    GOTO_CLEANUP_ON_STATUS_EE(status, EE);
+
+    pReply->Fd = -1;
+
+    pOut->tag = replyType;
+    pOut->data = pReply;
+
+    pReply->Status = IoFsControlFile(
+                            pMessage->FileHandle,
+                            NULL,
+                            &ioStatusBlock,
+                            IO_NPFS_FSCTL_OPEN_CHANNEL,
+                            NULL,
+                            0,
+                            &fd,
+                            sizeof(fd));
+    if (pReply->Status == STATUS_SUCCESS)
+    {
+        // lwmsg passes the descriptor along and closes our copy
+        // when the reply is freed.
+        pReply->Fd = fd;
+    }
+
+cleanup:
+    LOG_LEAVE_IF_STATUS_EE(status, EE);
+    return NtIpcNtStatusToLWMsgStatus(status);
+}
+
 static
 LWMsgDispatchSpec gIopIpcDispatchSpec[] =
 {
@@ -1161,6 +1219,7 @@ LWMsgDispatchSpec gIopIpcDispatchSpec[] =
     LWMSG_DISPATCH_BLOCK(NT_IPC_MESSAGE_TYPE_UNLOCK_FILE,            IopIpcUnlockFile),
     LWMSG_DISPATCH_BLOCK(NT_IPC_MESSAGE_TYPE_QUERY_SECURITY_FILE,    IopIpcQuerySecurityFile),
     LWMSG_DISPATCH_BLOCK(NT_IPC_MESSAGE_TYPE_SET_SECURITY_FILE,      IopIpcSetSecurityFile),
+    LWMSG_DISPATCH_BLOCK(NT_IPC_MESSAGE_TYPE_OPEN_PIPE_CHANNEL,      IopIpcOpenPipeChannel),
     LWMSG_DISPATCH_END
 };
 
@@ -55,6 +55,16 @@ LwioSrvTransferConfigContents(
     PLWIO_CONFIG pSrcConfig
     );
 
+static
+PVOID
+LwioSrvConfigWatchThread(
+    PVOID pData
+    );
+
+static pthread_t gLwioConfigWatchThread;
+static BOOLEAN gbLwioConfigWatchStarted = FALSE;
+static DWORD gdwLwioConfigGeneration = 0;
+
 
 /***********************************************************************
  **********************************************************************/
@@ -99,6 +109,114 @@ error:
 }
 
 
+/***********************************************************************
+ **********************************************************************/
+
+NTSTATUS
+LwioSrvStartConfigWatch(
+    VOID
+    )
+{
+    NTSTATUS ntStatus = STATUS_SUCCESS;
+    int err = 0;
+
+    gdwLwioConfigGeneration = 0;
+
+    ntStatus = LwIoWaitForConfigChange(&gdwLwioConfigGeneration);
+    if (ntStatus)
+    {
+        LWIO_LOG_ERROR(
+            "Registry change notification is unavailable; configuration "
+            "changes need an explicit refresh [code:%d]",
+            ntStatus);
+
+        ntStatus = STATUS_SUCCESS;
+        goto cleanup;
+    }
+
+    err = pthread_create(
+              &gLwioConfigWatchThread,
+              NULL,
+              LwioSrvConfigWatchThread,
+              NULL);
+    if (err)
+    {
+        ntStatus = LwErrnoToNtStatus(err);
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    gbLwioConfigWatchStarted = TRUE;
+
+cleanup:
+
+    return ntStatus;
+
+error:
+
+    goto cleanup;
+}
+
+
+/***********************************************************************
+ **********************************************************************/
+
+VOID
+LwioSrvStopConfigWatch(
+    VOID
+    )
+{
+    if (gbLwioConfigWatchStarted)
+    {
+        LwIoCancelWaitForConfigChange();
+
+        pthread_join(gLwioConfigWatchThread, NULL);
+
+        gbLwioConfigWatchStarted = FALSE;
+    }
+}
+
+
+/***********************************************************************
+ **********************************************************************/
+
+static
+PVOID
+LwioSrvConfigWatchThread(
+    PVOID pData
+    )
+{
+    NTSTATUS ntStatus = STATUS_SUCCESS;
+
+    for (;;)
+    {
+        ntStatus = LwIoWaitForConfigChange(&gdwLwioConfigGeneration);
+        if (ntStatus == STATUS_CANCELLED)
+        {
+            break;
+        }
+        else if (ntStatus)
+        {
+            LWIO_LOG_ERROR(
+                "Stopped watching for configuration changes [code:%d]",
+                ntStatus);
+            break;
+        }
+
+        LWIO_LOG_VERBOSE("Configuration changed, refreshing");
+
+        ntStatus = LwioSrvRefreshConfig(&gLwioServerConfig);
+        if (ntStatus)
+        {
+            LWIO_LOG_ERROR(
+                "Failed to refresh configuration [code:%d]",
+                ntStatus);
+        }
+    }
+
+    return NULL;
+}
+
+
 /***********************************************************************
  **********************************************************************/
 
@@ -41,6 +41,20 @@ LwioSrvRefreshConfig(
     PLWIO_CONFIG pConfig
     );
 
+/*
+ * Re-read configuration whenever the registry reports a change under the
+ * lwio keys.  Call once the drivers are loaded.
+ */
+NTSTATUS
+LwioSrvStartConfigWatch(
+    VOID
+    );
+
+VOID
+LwioSrvStopConfigWatch(
+    VOID
+    );
+
 VOID
 LwIoSrvFreeConfig(
     IN OUT PLWIO_CONFIG pConfig
@@ -243,6 +243,10 @@ lwiod_main(
     dwError = SMBSrvInitialize();
     BAIL_ON_LWIO_ERROR(dwError);
 
+    ntStatus = LwioSrvStartConfigWatch();
+    dwError = LwNtStatusToWin32Error(ntStatus);
+    BAIL_ON_LWIO_ERROR(dwError);
+
     dwError = SMBSrvExecute();
     BAIL_ON_LWIO_ERROR(dwError);
 
@@ -250,6 +254,8 @@ cleanup:
 
     LWIO_LOG_VERBOSE("LWIO main cleaning up");
 
+    LwioSrvStopConfigWatch();
+
     IoCleanup();
 
     LWIO_LOG_INFO("LWIO Service exiting...");
@@ -150,6 +150,9 @@ LwIoSvcmStart(
     ntStatus = SMBSrvInitialize();
     BAIL_ON_NT_STATUS(ntStatus);
 
+    ntStatus = LwioSrvStartConfigWatch();
+    BAIL_ON_NT_STATUS(ntStatus);
+
     ntStatus = SMBSrvExecute();
     BAIL_ON_NT_STATUS(ntStatus);
 
@@ -169,6 +172,8 @@ LwIoSvcmStop(
 {
     LWIO_LOG_VERBOSE("LWIO main cleaning up");
 
+    LwioSrvStopConfigWatch();
+
     IoCleanup();
 
     if (pServer)
@@ -0,0 +1,679 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        channel.c
+ *
+ * Abstract:
+ *
+ *        Likewise Named Pipe File System Driver (NPFS)
+ *
+ *        Direct data channel for local pipe servers
+ *
+ *        A server may trade its end of a connected pipe instance for one
+ *        end of a socket pair.  Client writes go straight into the socket
+ *        and client reads are satisfied straight from it, so the server
+ *        process moves pipe data with plain read/write calls instead of
+ *        an I/O manager round trip per operation.  A task per channel
+ *        flushes client data the socket could not take immediately and
+ *        completes client reads that had to pend.
+ */
+
+#include "includes.h"
+
+static
+VOID
+NpfsChannelTask(
+    PLW_TASK pTask,
+    LW_PVOID pContext,
+    LW_TASK_EVENT_MASK WakeMask,
+    LW_TASK_EVENT_MASK* pWaitMask,
+    LW_LONG64* pllTime
+    );
+
+static
+NTSTATUS
+NpfsChannelFlush(
+    PNPFS_PIPE pPipe
+    );
+
+static
+VOID
+NpfsChannelCompleteReads(
+    PNPFS_PIPE pPipe
+    );
+
+static
+VOID
+NpfsChannelDrain(
+    PNPFS_PIPE pPipe
+    );
+
+static
+NTSTATUS
+NpfsChannelSend(
+    int Fd,
+    PVOID pBuffer,
+    ULONG Length,
+    PULONG pulBytesSent
+    );
+
+static
+NTSTATUS
+NpfsChannelRecv(
+    int Fd,
+    PVOID pBuffer,
+    ULONG Length,
+    PULONG pulBytesReceived
+    );
+
+NTSTATUS
+NpfsCommonOpenChannel(
+    PNPFS_IRP_CONTEXT pIrpContext,
+    PIRP pIrp
+    )
+{
+    NTSTATUS ntStatus = STATUS_SUCCESS;
+    PVOID pOutBuffer = pIrp->Args.IoFsControl.OutputBuffer;
+    ULONG OutLength = pIrp->Args.IoFsControl.OutputBufferLength;
+    PNPFS_CCB pSCB = NULL;
+    PNPFS_PIPE pPipe = NULL;
+    BOOL bReleasePipeLock = FALSE;
+    int Fds[2] = { -1, -1 };
+
+    if (!gpNpfsThreadPool)
+    {
+        ntStatus = STATUS_NOT_SUPPORTED;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    if (!pOutBuffer || OutLength < sizeof(Fds[1]))
+    {
+        ntStatus = STATUS_BUFFER_TOO_SMALL;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    ntStatus = NpfsGetCCB(pIrpContext->pIrp->FileHandle, &pSCB);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    if (pSCB->CcbType != NPFS_CCB_SERVER)
+    {
+        ntStatus = STATUS_INVALID_PARAMETER;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    pPipe = pSCB->pPipe;
+
+    ENTER_MUTEX(&pPipe->PipeMutex);
+    bReleasePipeLock = TRUE;
+
+    /* The server must not have reads outstanding through npfs,
+       or data could be split between the two paths */
+    if (pPipe->PipeServerState != PIPE_SERVER_CONNECTED ||
+        pPipe->ChannelFd >= 0 ||
+        !LwListIsEmpty(&pSCB->ReadIrpList))
+    {
+        ntStatus = STATUS_INVALID_PIPE_STATE;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, Fds) < 0)
+    {
+        ntStatus = LwErrnoToNtStatus(errno);
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    if (fcntl(Fds[0], F_SETFD, FD_CLOEXEC) < 0 ||
+        fcntl(Fds[1], F_SETFD, FD_CLOEXEC) < 0 ||
+        fcntl(Fds[0], F_SETFL, O_NONBLOCK) < 0)
+    {
+        ntStatus = LwErrnoToNtStatus(errno);
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    ntStatus = LwRtlCreateTask(
+                    gpNpfsThreadPool,
+                    &pPipe->pChannelTask,
+                    NULL,
+                    NpfsChannelTask,
+                    pPipe);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    pPipe->ChannelFd = Fds[0];
+    Fds[0] = -1;
+    pPipe->ChannelStatus = STATUS_SUCCESS;
+    pPipe->bChannelClosing = FALSE;
+    pPipe->bChannelShutdown = (pPipe->PipeClientState == PIPE_CLIENT_CLOSED);
+    pPipe->bChannelWriteShut = FALSE;
+
+    /* Anything the client wrote before now is still queued on the
+       server CCB; the task sends it ahead of any new data */
+    LwRtlWakeTask(pPipe->pChannelTask);
+
+    memcpy(pOutBuffer, &Fds[1], sizeof(Fds[1]));
+    Fds[1] = -1;
+
+    pIrp->IoStatusBlock.BytesTransferred = sizeof(Fds[1]);
+
+cleanup:
+
+    if (bReleasePipeLock)
+    {
+        LEAVE_MUTEX(&pPipe->PipeMutex);
+    }
+
+    if (Fds[0] >= 0)
+    {
+        close(Fds[0]);
+    }
+
+    if (Fds[1] >= 0)
+    {
+        close(Fds[1]);
+    }
+
+    pIrp->IoStatusBlock.Status = ntStatus;
+
+    return ntStatus;
+
+error:
+
+    goto cleanup;
+}
+
+BOOLEAN
+NpfsChannelIsActive(
+    PNPFS_PIPE pPipe
+    )
+{
+    return pPipe->ChannelFd >= 0 && !pPipe->bChannelClosing;
+}
+
+/* Called with the pipe mutex held */
+NTSTATUS
+NpfsChannelWrite(
+    PNPFS_PIPE pPipe,
+    PVOID pBuffer,
+    ULONG Length,
+    PULONG pulBytesTransferred
+    )
+{
+    NTSTATUS ntStatus = pPipe->ChannelStatus;
+    PNPFS_CCB pSCB = pPipe->pSCB;
+    ULONG ulBytesSent = 0;
+    ULONG ulBytesQueued = 0;
+
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    /* Only bypass the queue when it is empty to keep data in order */
+    if (NpfsMdlListIsEmpty(&pSCB->mdlList))
+    {
+        ntStatus = NpfsChannelSend(
+                        pPipe->ChannelFd,
+                        pBuffer,
+                        Length,
+                        &ulBytesSent);
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    if (ulBytesSent < Length)
+    {
+        ntStatus = NpfsEnqueueBuffer(
+                        &pSCB->mdlList,
+                        (PBYTE) pBuffer + ulBytesSent,
+                        Length - ulBytesSent,
+                        &ulBytesQueued);
+        BAIL_ON_NT_STATUS(ntStatus);
+
+        NpfsChannelWake(pPipe);
+    }
+
+    *pulBytesTransferred = ulBytesSent + ulBytesQueued;
+
+cleanup:
+
+    return ntStatus;
+
+error:
+
+    *pulBytesTransferred = 0;
+
+    goto cleanup;
+}
+
+/* Called with the pipe mutex held.  Returns STATUS_PENDING if the
+   server has not written anything yet. */
+NTSTATUS
+NpfsChannelReadFile(
+    PNPFS_CCB pCCB,
+    PNPFS_IRP_CONTEXT pIrpContext
+    )
+{
+    NTSTATUS ntStatus = 0;
+    PNPFS_PIPE pPipe = pCCB->pPipe;
+    PVOID pBuffer = NULL;
+    ULONG Length = 0;
+    ULONG ulBytesTransferred = 0;
+
+    switch (pIrpContext->pIrp->Type)
+    {
+        case IRP_TYPE_FS_CONTROL:
+
+            pBuffer = pIrpContext->pIrp->Args.IoFsControl.OutputBuffer;
+            Length = pIrpContext->pIrp->Args.IoFsControl.OutputBufferLength;
+
+            break;
+
+        default:
+
+            pBuffer = pIrpContext->pIrp->Args.ReadWrite.Buffer;
+            Length = pIrpContext->pIrp->Args.ReadWrite.Length;
+
+            break;
+    }
+
+    ntStatus = pPipe->ChannelStatus;
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    if (Length)
+    {
+        ntStatus = NpfsChannelRecv(
+                        pPipe->ChannelFd,
+                        pBuffer,
+                        Length,
+                        &ulBytesTransferred);
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    pIrpContext->pIrp->IoStatusBlock.BytesTransferred = ulBytesTransferred;
+
+error:
+
+    pIrpContext->pIrp->IoStatusBlock.Status = ntStatus;
+
+    return ntStatus;
+}
+
+VOID
+NpfsChannelWake(
+    PNPFS_PIPE pPipe
+    )
+{
+    if (pPipe->pChannelTask)
+    {
+        LwRtlWakeTask(pPipe->pChannelTask);
+    }
+}
+
+/* Called with the pipe mutex held when the client closes.  The server
+   sees end of file once everything the client wrote has been sent. */
+VOID
+NpfsChannelShutdown(
+    PNPFS_PIPE pPipe
+    )
+{
+    if (NpfsChannelIsActive(pPipe))
+    {
+        pPipe->bChannelShutdown = TRUE;
+        NpfsChannelWake(pPipe);
+    }
+}
+
+/* Called without the pipe mutex held when the server closes */
+VOID
+NpfsChannelClose(
+    PNPFS_PIPE pPipe
+    )
+{
+    PLW_TASK pTask = NULL;
+    int Fd = -1;
+
+    ENTER_MUTEX(&pPipe->PipeMutex);
+
+    if (!NpfsChannelIsActive(pPipe))
+    {
+        LEAVE_MUTEX(&pPipe->PipeMutex);
+        return;
+    }
+
+    /* Keep whatever the server wrote before closing so the
+       client can still read it from the CCB */
+    NpfsChannelDrain(pPipe);
+
+    pPipe->bChannelClosing = TRUE;
+    pTask = pPipe->pChannelTask;
+
+    LEAVE_MUTEX(&pPipe->PipeMutex);
+
+    LwRtlCancelTask(pTask);
+    LwRtlWaitTask(pTask);
+
+    ENTER_MUTEX(&pPipe->PipeMutex);
+
+    Fd = pPipe->ChannelFd;
+    pPipe->ChannelFd = -1;
+    pPipe->pChannelTask = NULL;
+
+    LEAVE_MUTEX(&pPipe->PipeMutex);
+
+    close(Fd);
+    LwRtlReleaseTask(&pTask);
+}
+
+static
+VOID
+NpfsChannelTask(
+    PLW_TASK pTask,
+    LW_PVOID pContext,
+    LW_TASK_EVENT_MASK WakeMask,
+    LW_TASK_EVENT_MASK* pWaitMask,
+    LW_LONG64* pllTime
+    )
+{
+    NTSTATUS ntStatus = STATUS_SUCCESS;
+    PNPFS_PIPE pPipe = (PNPFS_PIPE) pContext;
+
+    ENTER_MUTEX(&pPipe->PipeMutex);
+
+    if (WakeMask & LW_TASK_EVENT_CANCEL)
+    {
+        LwRtlSetTaskFd(pTask, pPipe->ChannelFd, 0);
+        *pWaitMask = LW_TASK_EVENT_COMPLETE;
+        goto cleanup;
+    }
+
+    *pWaitMask = LW_TASK_EVENT_EXPLICIT;
+
+    if (pPipe->ChannelStatus != STATUS_SUCCESS)
+    {
+        /* Go back to sleep until we are cancelled */
+        goto cleanup;
+    }
+
+    if (WakeMask & LW_TASK_EVENT_INIT)
+    {
+        ntStatus = LwRtlSetTaskFd(
+                        pTask,
+                        pPipe->ChannelFd,
+                        LW_TASK_EVENT_FD_READABLE | LW_TASK_EVENT_FD_WRITABLE);
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    ntStatus = NpfsChannelFlush(pPipe);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    NpfsChannelCompleteReads(pPipe);
+
+    if (pPipe->pSCB && !NpfsMdlListIsEmpty(&pPipe->pSCB->mdlList))
+    {
+        *pWaitMask |= LW_TASK_EVENT_FD_WRITABLE;
+    }
+
+    if (pPipe->pCCB && !LwListIsEmpty(&pPipe->pCCB->ReadIrpList))
+    {
+        *pWaitMask |= LW_TASK_EVENT_FD_READABLE;
+    }
+
+cleanup:
+
+    LEAVE_MUTEX(&pPipe->PipeMutex);
+
+    return;
+
+error:
+
+    LWIO_LOG_DEBUG("Pipe channel failed (status = 0x%08x)", ntStatus);
+
+    /* Fail pending and future client I/O on the channel */
+    pPipe->ChannelStatus = ntStatus;
+    NpfsChannelCompleteReads(pPipe);
+
+    *pWaitMask = LW_TASK_EVENT_EXPLICIT;
+
+    goto cleanup;
+}
+
+static
+NTSTATUS
+NpfsChannelFlush(
+    PNPFS_PIPE pPipe
+    )
+{
+    NTSTATUS ntStatus = 0;
+    PNPFS_CCB pSCB = pPipe->pSCB;
+    PNPFS_MDL pMdl = NULL;
+    ULONG ulBytesSent = 0;
+
+    while (pSCB && !NpfsMdlListIsEmpty(&pSCB->mdlList))
+    {
+        pMdl = LW_STRUCT_FROM_FIELD(pSCB->mdlList.Next, NPFS_MDL, link);
+
+        ntStatus = NpfsChannelSend(
+                        pPipe->ChannelFd,
+                        (PBYTE) pMdl->Buffer + pMdl->Offset,
+                        pMdl->Length - pMdl->Offset,
+                        &ulBytesSent);
+        BAIL_ON_NT_STATUS(ntStatus);
+
+        pMdl->Offset += ulBytesSent;
+
+        if (pMdl->Offset < pMdl->Length)
+        {
+            /* Socket is full; wait for it to become writable */
+            goto cleanup;
+        }
+
+        NpfsDequeueMdl(&pSCB->mdlList, &pMdl);
+        NpfsFreeMdl(pMdl);
+    }
+
+    if (pPipe->bChannelShutdown && !pPipe->bChannelWriteShut)
+    {
+        shutdown(pPipe->ChannelFd, SHUT_WR);
+        pPipe->bChannelWriteShut = TRUE;
+    }
+
+cleanup:
+
+    return ntStatus;
+
+error:
+
+    goto cleanup;
+}
+
+static
+VOID
+NpfsChannelCompleteReads(
+    PNPFS_PIPE pPipe
+    )
+{
+    NTSTATUS ntStatus = 0;
+    PNPFS_CCB pCCB = pPipe->pCCB;
+    PLW_LIST_LINKS pLink = NULL;
+    PNPFS_IRP_CONTEXT pReadContext = NULL;
+
+    while (pCCB && !LwListIsEmpty(&pCCB->ReadIrpList))
+    {
+        pLink = pCCB->ReadIrpList.Next;
+        pReadContext = LW_STRUCT_FROM_FIELD(pLink, NPFS_IRP_CONTEXT, Link);
+
+        ntStatus = NpfsChannelReadFile(pCCB, pReadContext);
+        if (ntStatus == STATUS_PENDING)
+        {
+            break;
+        }
+
+        LwListRemove(pLink);
+
+        IoIrpComplete(pReadContext->pIrp);
+
+        NpfsFreeIrpContext(pReadContext);
+    }
+}
+
+static
+VOID
+NpfsChannelDrain(
+    PNPFS_PIPE pPipe
+    )
+{
+    NTSTATUS ntStatus = 0;
+    PNPFS_CCB pCCB = pPipe->pCCB;
+    BYTE Buffer[4096];
+    ULONG ulBytesReceived = 0;
+    ULONG ulBytesQueued = 0;
+
+    while (pCCB && pPipe->ChannelStatus == STATUS_SUCCESS)
+    {
+        ntStatus = NpfsChannelRecv(
+                        pPipe->ChannelFd,
+                        Buffer,
+                        sizeof(Buffer),
+                        &ulBytesReceived);
+        if (ntStatus != STATUS_SUCCESS)
+        {
+            break;
+        }
+
+        ntStatus = NpfsEnqueueBuffer(
+                        &pCCB->mdlList,
+                        Buffer,
+                        ulBytesReceived,
+                        &ulBytesQueued);
+        if (ntStatus != STATUS_SUCCESS)
+        {
+            break;
+        }
+    }
+}
+
+static
+NTSTATUS
+NpfsChannelSend(
+    int Fd,
+    PVOID pBuffer,
+    ULONG Length,
+    PULONG pulBytesSent
+    )
+{
+    NTSTATUS ntStatus = 0;
+    ssize_t cbSent = 0;
+
+    do
+    {
+        cbSent = write(Fd, pBuffer, Length);
+    } while (cbSent < 0 && errno == EINTR);
+
+    if (cbSent < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            ntStatus = LwErrnoToNtStatus(errno);
+            BAIL_ON_NT_STATUS(ntStatus);
+        }
+
+        cbSent = 0;
+    }
+
+    *pulBytesSent = (ULONG) cbSent;
+
+cleanup:
+
+    return ntStatus;
+
+error:
+
+    *pulBytesSent = 0;
+
+    goto cleanup;
+}
+
+static
+NTSTATUS
+NpfsChannelRecv(
+    int Fd,
+    PVOID pBuffer,
+    ULONG Length,
+    PULONG pulBytesReceived
+    )
+{
+    NTSTATUS ntStatus = 0;
+    ssize_t cbReceived = 0;
+
+    do
+    {
+        cbReceived = read(Fd, pBuffer, Length);
+    } while (cbReceived < 0 && errno == EINTR);
+
+    if (cbReceived < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            ntStatus = STATUS_PENDING;
+        }
+        else
+        {
+            ntStatus = LwErrnoToNtStatus(errno);
+        }
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+    else if (cbReceived == 0)
+    {
+        /* Server closed its end */
+        ntStatus = STATUS_END_OF_FILE;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    *pulBytesReceived = (ULONG) cbReceived;
+
+cleanup:
+
+    return ntStatus;
+
+error:
+
+    *pulBytesReceived = 0;
+
+    goto cleanup;
+}
+
+/*
+local variables:
+mode: c
+c-basic-offset: 4
+indent-tabs-mode: nil
+tab-width: 4
+end:
+*/
@@ -139,6 +139,8 @@ NpfsServerCloseHandle(
 
     pPipe = pSCB->pPipe;
 
+    NpfsChannelClose(pPipe);
+
     ENTER_MUTEX(&pPipe->PipeMutex);
 
     pCCB = pPipe->pCCB;
@@ -195,6 +197,8 @@ NpfsClientCloseHandle(
 
     pPipe->PipeClientState = PIPE_CLIENT_CLOSED;
 
+    NpfsChannelShutdown(pPipe);
+
     while (pSCB && !LwListIsEmpty(&pSCB->ReadIrpList))
     {
         pLink = pSCB->ReadIrpList.Next;
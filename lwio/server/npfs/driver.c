@@ -66,6 +66,8 @@ NpfsDriverShutdown(
         gpServerLock = NULL;
     }
 
+    LwRtlFreeThreadPool(&gpNpfsThreadPool);
+
     IO_LOG_ENTER_LEAVE("");
 }
 
@@ -174,6 +176,9 @@ IO_DRIVER_ENTRY(npfs)(
     pthread_rwlock_init(&gServerLock, NULL);
     gpServerLock = &gServerLock;
 
+    ntStatus = LwRtlCreateThreadPool(&gpNpfsThreadPool, NULL);
+    GOTO_CLEANUP_ON_STATUS_EE(ntStatus, EE);
+
     ntStatus = IoDriverInitialize(DriverHandle,
                                   NULL,
                                   NpfsDriverShutdown,
@@ -49,4 +49,5 @@ extern LW_LIST_LINKS gFCBList;
 extern pthread_rwlock_t gServerLock;
 extern pthread_rwlock_t* gpServerLock;
 extern IO_DEVICE_HANDLE  ghDevice;
+extern PLW_THREAD_POOL  gpNpfsThreadPool;
 
@@ -131,6 +131,9 @@ NpfsCommonFsCtl(
     case IO_FSCTL_PIPE_TRANSCEIVE:
         ntStatus = NpfsCommonTransceive(pIrpContext, pIrp);
         break;
+    case IO_NPFS_FSCTL_OPEN_CHANNEL:
+        ntStatus = NpfsCommonOpenChannel(pIrpContext, pIrp);
+        break;
     default:
         ntStatus = STATUS_NOT_SUPPORTED;
         break;
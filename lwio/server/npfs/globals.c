@@ -36,3 +36,5 @@ pthread_rwlock_t  gServerLock;
 pthread_rwlock_t* gpServerLock = NULL;
 
 IO_DEVICE_HANDLE ghDevice = NULL;
+
+PLW_THREAD_POOL gpNpfsThreadPool = NULL;
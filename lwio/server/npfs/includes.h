@@ -51,6 +51,7 @@
 
 #include <lw/rtlstring.h>
 #include <lw/rtlgoto.h>
+#include <lw/threadpool.h>
 
 #include <lwio/iodriver.h>
 #include <lwio/iortl.h>
@@ -121,6 +121,7 @@ NpfsCreatePipe(
     pPipe->PipeServerState = PIPE_SERVER_INIT_STATE;
     pPipe->PipeClientState = PIPE_CLIENT_INIT_STATE;
     pPipe->pFCB = pFCB;
+    pPipe->ChannelFd = -1;
 
     NpfsAddRefFCB(pFCB);
 
@@ -23,6 +23,48 @@
  * license@likewise.com
  */
 
+// channel.c
+
+NTSTATUS
+NpfsCommonOpenChannel(
+    PNPFS_IRP_CONTEXT pIrpContext,
+    PIRP pIrp
+    );
+
+BOOLEAN
+NpfsChannelIsActive(
+    PNPFS_PIPE pPipe
+    );
+
+NTSTATUS
+NpfsChannelWrite(
+    PNPFS_PIPE pPipe,
+    PVOID pBuffer,
+    ULONG Length,
+    PULONG pulBytesTransferred
+    );
+
+NTSTATUS
+NpfsChannelReadFile(
+    PNPFS_CCB pCCB,
+    PNPFS_IRP_CONTEXT pIrpContext
+    );
+
+VOID
+NpfsChannelWake(
+    PNPFS_PIPE pPipe
+    );
+
+VOID
+NpfsChannelShutdown(
+    PNPFS_PIPE pPipe
+    );
+
+VOID
+NpfsChannelClose(
+    PNPFS_PIPE pPipe
+    );
+
 // close.c
 
 NTSTATUS
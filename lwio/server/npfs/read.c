@@ -218,6 +218,13 @@ NpfsServerReadFile(
     pPipe = pSCB->pPipe;
     ENTER_MUTEX(&pPipe->PipeMutex);
 
+    if (NpfsChannelIsActive(pPipe))
+    {
+        /* The server reads and writes through its channel */
+        ntStatus = STATUS_INVALID_PIPE_STATE;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
     switch(pPipe->PipeServerState)
     {
     case PIPE_SERVER_CONNECTED:
@@ -394,6 +401,17 @@ NpfsClientReadFile(
         {
             if (NpfsMdlListIsEmpty(&pCCB->mdlList))
             {
+                if (NpfsChannelIsActive(pPipe) &&
+                    LwListIsEmpty(&pCCB->ReadIrpList))
+                {
+                    ntStatus = NpfsChannelReadFile(pCCB, pIrpContext);
+                    if (ntStatus != STATUS_PENDING)
+                    {
+                        BAIL_ON_NT_STATUS(ntStatus);
+                        break;
+                    }
+                }
+
                 LwListInsertBefore(&pCCB->ReadIrpList, &pIrpContext->Link);
 
                 IoIrpMarkPending(
@@ -401,6 +419,9 @@ NpfsClientReadFile(
                     NpfsCancelReadFile,
                     pIrpContext);
 
+                /* Let the channel task complete it when data arrives */
+                NpfsChannelWake(pPipe);
+
                 ntStatus = STATUS_PENDING;
                 BAIL_ON_NT_STATUS(ntStatus);
             }
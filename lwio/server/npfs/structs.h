@@ -123,6 +123,14 @@ typedef struct _NPFS_PIPE
 
     PNPFS_IRP_CONTEXT pPendingServerConnect;
 
+    /* Direct data channel to a local server (see channel.c) */
+    int ChannelFd;
+    PLW_TASK pChannelTask;
+    NTSTATUS ChannelStatus;
+    BOOLEAN bChannelClosing;
+    BOOLEAN bChannelShutdown;
+    BOOLEAN bChannelWriteShut;
+
     LW_LIST_LINKS link;
 } NPFS_PIPE, *PNPFS_PIPE;
 
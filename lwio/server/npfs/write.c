@@ -139,6 +139,13 @@ NpfsServerWriteFile(
     pPipe = pSCB->pPipe;
     ENTER_MUTEX(&pPipe->PipeMutex);
 
+    if (NpfsChannelIsActive(pPipe))
+    {
+        /* The server reads and writes through its channel */
+        ntStatus = STATUS_INVALID_PIPE_STATE;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
     switch(pPipe->PipeClientState)
     {
     case PIPE_CLIENT_CONNECTED:
@@ -298,23 +305,34 @@ NpfsClientWriteFile_Connected(
     pPipe = pCCB->pPipe;
     pSCB = pPipe->pSCB;
 
-
-    ntStatus = NpfsEnqueueBuffer(
-                        &pSCB->mdlList,
-                        pBuffer,
-                        Length,
-                        &ulBytesTransferred);
-    BAIL_ON_NT_STATUS(ntStatus);
-
-    while (!LwListIsEmpty(&pSCB->ReadIrpList) &&
-           !NpfsMdlListIsEmpty(&pSCB->mdlList))
+    if (NpfsChannelIsActive(pPipe))
     {
-        pLink = pSCB->ReadIrpList.Next;
-        LwListRemove(pLink);
+        ntStatus = NpfsChannelWrite(
+                            pPipe,
+                            pBuffer,
+                            Length,
+                            &ulBytesTransferred);
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+    else
+    {
+        ntStatus = NpfsEnqueueBuffer(
+                            &pSCB->mdlList,
+                            pBuffer,
+                            Length,
+                            &ulBytesTransferred);
+        BAIL_ON_NT_STATUS(ntStatus);
 
-        pReadContext = LW_STRUCT_FROM_FIELD(pLink, NPFS_IRP_CONTEXT, Link);
+        while (!LwListIsEmpty(&pSCB->ReadIrpList) &&
+               !NpfsMdlListIsEmpty(&pSCB->mdlList))
+        {
+            pLink = pSCB->ReadIrpList.Next;
+            LwListRemove(pLink);
+
+            pReadContext = LW_STRUCT_FROM_FIELD(pLink, NPFS_IRP_CONTEXT, Link);
 
-        NpfsServerCompleteReadFile(pSCB, pReadContext);
+            NpfsServerCompleteReadFile(pSCB, pReadContext);
+        }
     }
 
     pthread_cond_signal(&pPipe->PipeCondition);
@@ -76,6 +76,8 @@ PvfsAllocateCCB(
     PVFS_INIT_LINKS(&pCCB->ScbList);
 
     pCCB->OplockState = PVFS_OPLOCK_STATE_NONE;
+    pCCB->bLeaseKeyPresent = FALSE;
+    pCCB->LeaseState = IO_LEASE_STATE_NONE;
 
     pCCB->fd = -1;
     PVFS_CLEAR_FILEID(pCCB->FileId);
@@ -562,3 +564,28 @@ PvfsRenameStream(
 {
     return PvfsRenameSCB(pCcb->pScb, pCcb, pNewStreamName);
 }
+
+
+/*****************************************************************************
+ ****************************************************************************/
+
+BOOLEAN
+PvfsCcbIsSameLeaseOwner(
+    IN PPVFS_CCB pCcb1,
+    IN PPVFS_CCB pCcb2
+    )
+{
+    if (pCcb1 == pCcb2)
+    {
+        return TRUE;
+    }
+
+    if (!pCcb1->bLeaseKeyPresent || !pCcb2->bLeaseKeyPresent)
+    {
+        return FALSE;
+    }
+
+    return (memcmp(&pCcb1->LeaseKey,
+                   &pCcb2->LeaseKey,
+                   sizeof(pCcb1->LeaseKey)) == 0);
+}
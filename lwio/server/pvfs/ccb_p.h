@@ -97,5 +97,11 @@ PvfsRenameCCB(
     IN PPVFS_FILE_NAME DestFileName
     );
 
+BOOLEAN
+PvfsCcbIsSameLeaseOwner(
+    IN PPVFS_CCB pCcb1,
+    IN PPVFS_CCB pCcb2
+    );
+
 #endif     /* _PVFS_CCB_P_H */
 
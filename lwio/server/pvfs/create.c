@@ -67,6 +67,13 @@ PvfsSetEcpFileInfo(
     PPVFS_CCB pCcb
     );
 
+static
+NTSTATUS
+PvfsGetEcpLeaseKey(
+    PIO_ECP_LIST pEcpList,
+    PPVFS_CCB pCcb
+    );
+
 /*****************************************************************************
  Main entry to the Create() routine for driver.  Splits work based on the
  CreateOptions.
@@ -1023,6 +1030,12 @@ PvfsAllocateCreateContext(
     ntError = PvfsAcquireAccessToken(pCreateCtx->pCcb, pSecCtx);
     BAIL_ON_NT_STATUS(ntError);
 
+    /* The lease key must be known before any oplock break processing
+       so that opens sharing a lease do not break each other */
+
+    ntError = PvfsGetEcpLeaseKey(Args.EcpList, pCreateCtx->pCcb);
+    BAIL_ON_NT_STATUS(ntError);
+
     pCreateCtx->pIrpContext = PvfsReferenceIrpContext(pIrpContext);
 
     pCreateCtx->Status = STATUS_SUCCESS;
@@ -1287,3 +1300,47 @@ error:
 }
 
 
+/*****************************************************************************
+ ****************************************************************************/
+
+static
+NTSTATUS
+PvfsGetEcpLeaseKey(
+    PIO_ECP_LIST pEcpList,
+    PPVFS_CCB pCcb
+    )
+{
+    NTSTATUS ntError = STATUS_SUCCESS;
+    PSRV_ECP_LEASE_KEY pLeaseKey = NULL;
+    ULONG ulEcpSize = 0;
+
+    ntError = IoRtlEcpListFind(
+                  pEcpList,
+                  SRV_ECP_TYPE_LEASE_KEY,
+                  OUT_PPVOID(&pLeaseKey),
+                  &ulEcpSize);
+    if (ntError != STATUS_NOT_FOUND)
+    {
+        BAIL_ON_NT_STATUS(ntError);
+
+        if (ulEcpSize != sizeof(*pLeaseKey))
+        {
+            ntError = STATUS_INVALID_PARAMETER;
+            BAIL_ON_NT_STATUS(ntError);
+        }
+
+        pCcb->LeaseKey = *pLeaseKey;
+        pCcb->bLeaseKeyPresent = TRUE;
+
+        ntError = IoRtlEcpListAcknowledge(pEcpList, SRV_ECP_TYPE_LEASE_KEY);
+        BAIL_ON_NT_STATUS(ntError);
+    }
+
+    ntError = STATUS_SUCCESS;
+
+cleanup:
+    return ntError;
+
+error:
+    goto cleanup;
+}
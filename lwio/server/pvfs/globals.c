@@ -67,6 +67,17 @@ PVFS_DRIVER_STATE gPvfsDriverState = {
 
     .ThreadPool = NULL,
 
+    .NotifyQueue =
+        {
+            .Mutex = PTHREAD_MUTEX_INITIALIZER,
+            .ReportList =
+                {
+                    .Next = &gPvfsDriverState.NotifyQueue.ReportList,
+                    .Prev = &gPvfsDriverState.NotifyQueue.ReportList
+                },
+            .bScheduled = FALSE
+        },
+
     .GidCache =
         {
             .Cache = { 0 },
@@ -467,7 +467,7 @@ error:
 
 static
 VOID
-PvfsNotifyProcessEvent(
+PvfsNotifyProcessEvents(
     PVOID pContext
     );
 
@@ -487,36 +487,59 @@ PvfsNotifyScheduleFullReport(
 {
     NTSTATUS ntError = STATUS_UNSUCCESSFUL;
     PPVFS_NOTIFY_REPORT_RECORD pReport = NULL;
+    BOOLEAN bLocked = FALSE;
 
     BAIL_ON_INVALID_PTR(pFcb, ntError);
 
     ntError = PvfsAllocateMemory(
                   (PVOID*)&pReport,
                   sizeof(PVFS_NOTIFY_REPORT_RECORD),
-                  FALSE);
+                  TRUE);
     BAIL_ON_NT_STATUS(ntError);
 
     pReport->pFcb = PvfsReferenceFCB(pFcb);
     pReport->Filter = Filter;
     pReport->Action = Action;
 
-    ntError = LwRtlCStringDuplicate(&pReport->pszFilename, pszFilename);
-    BAIL_ON_NT_STATUS(ntError);
+    /* Convert the name once here.  Every watcher is later served
+       from the same encoded entry */
 
-    ntError = LwRtlQueueWorkItem(
-                  gPvfsDriverState.ThreadPool,
-                  PvfsNotifyProcessEvent,
-                  pReport,
-                  0);
+    ntError = LwRtlWC16StringAllocateFromCString(
+                  &pReport->pwszFilename,
+                  pszFilename);
     BAIL_ON_NT_STATUS(ntError);
 
+    pReport->FilenameBytes =
+        (LwRtlWC16StringNumChars(pReport->pwszFilename) + 1) * sizeof(WCHAR);
+
+    /* Changes collect behind a single pending worker which picks up
+       everything reported by the time it runs */
+
+    LWIO_LOCK_MUTEX(bLocked, &gPvfsDriverState.NotifyQueue.Mutex);
+
+    if (!gPvfsDriverState.NotifyQueue.bScheduled)
+    {
+        ntError = LwRtlQueueWorkItem(
+                      gPvfsDriverState.ThreadPool,
+                      PvfsNotifyProcessEvents,
+                      NULL,
+                      0);
+        BAIL_ON_NT_STATUS(ntError);
+
+        gPvfsDriverState.NotifyQueue.bScheduled = TRUE;
+    }
+
+    LwListInsertTail(
+        &gPvfsDriverState.NotifyQueue.ReportList,
+        &pReport->ReportList);
+    pReport = NULL;
+
 error:
-    if (!NT_SUCCESS(ntError))
+    LWIO_UNLOCK_MUTEX(bLocked, &gPvfsDriverState.NotifyQueue.Mutex);
+
+    if (pReport)
     {
-        if (pReport)
-        {
-            PvfsNotifyFullReportCtxFree(&pReport);
-        }
+        PvfsNotifyFullReportCtxFree(&pReport);
     }
 
     return;
@@ -528,161 +551,505 @@ error:
 
 static
 VOID
-PvfsNotifyFullReportBuffer(
-    PPVFS_FCB pFcb,
-    PPVFS_FCB pReportParentFcb,
-    PPVFS_NOTIFY_REPORT_RECORD pReport
+PvfsNotifyBatchReports(
+    PLW_LIST_LINKS pReportList,
+    PLW_LIST_LINKS pBatchList
     );
 
 static
 VOID
-PvfsNotifyFullReportIrp(
-    PPVFS_FCB pFcb,
-    PPVFS_FCB pReportParentFcb,
-    PPVFS_NOTIFY_REPORT_RECORD pReport
+PvfsNotifyProcessBatch(
+    PPVFS_NOTIFY_REPORT_BATCH pBatch
+    );
+
+static
+VOID
+PvfsNotifyFreeBatch(
+    PPVFS_NOTIFY_REPORT_BATCH *ppBatch
     );
 
 static
 VOID
-PvfsNotifyProcessEvent(
+PvfsNotifyProcessEvents(
     PVOID pContext
     )
+{
+    LW_LIST_LINKS ReportList;
+    LW_LIST_LINKS BatchList;
+    PLW_LIST_LINKS pBatchLink = NULL;
+    PPVFS_NOTIFY_REPORT_BATCH pBatch = NULL;
+    BOOLEAN bLocked = FALSE;
+
+    LWIO_LOCK_MUTEX(bLocked, &gPvfsDriverState.NotifyQueue.Mutex);
+
+    /* Keep the worker marked as scheduled until the queue has been
+       drained so batches for the same directory are never processed
+       out of order */
+
+    while (!LwListIsEmpty(&gPvfsDriverState.NotifyQueue.ReportList))
+    {
+        LwListInit(&ReportList);
+        LwListInit(&BatchList);
+
+        while (!LwListIsEmpty(&gPvfsDriverState.NotifyQueue.ReportList))
+        {
+            LwListInsertTail(
+                &ReportList,
+                LwListRemoveHead(&gPvfsDriverState.NotifyQueue.ReportList));
+        }
+
+        LWIO_UNLOCK_MUTEX(bLocked, &gPvfsDriverState.NotifyQueue.Mutex);
+
+        PvfsNotifyBatchReports(&ReportList, &BatchList);
+
+        while (!LwListIsEmpty(&BatchList))
+        {
+            pBatchLink = LwListRemoveHead(&BatchList);
+            pBatch = LW_STRUCT_FROM_FIELD(
+                         pBatchLink,
+                         PVFS_NOTIFY_REPORT_BATCH,
+                         BatchList);
+
+            PvfsNotifyProcessBatch(pBatch);
+
+            PvfsNotifyFreeBatch(&pBatch);
+        }
+
+        LWIO_LOCK_MUTEX(bLocked, &gPvfsDriverState.NotifyQueue.Mutex);
+    }
+
+    gPvfsDriverState.NotifyQueue.bScheduled = FALSE;
+
+    LWIO_UNLOCK_MUTEX(bLocked, &gPvfsDriverState.NotifyQueue.Mutex);
+
+    return;
+}
+
+
+/*****************************************************************************
+ ****************************************************************************/
+
+static
+NTSTATUS
+PvfsNotifyEncodeBatch(
+    PPVFS_NOTIFY_REPORT_BATCH pBatch
+    );
+
+static
+VOID
+PvfsNotifyBatchReports(
+    PLW_LIST_LINKS pReportList,
+    PLW_LIST_LINKS pBatchList
+    )
 {
     NTSTATUS ntError = STATUS_SUCCESS;
-    PPVFS_NOTIFY_REPORT_RECORD pReport = (PPVFS_NOTIFY_REPORT_RECORD)pContext;
+    PLW_LIST_LINKS pBatchLink = NULL;
+    PLW_LIST_LINKS pNextLink = NULL;
+    PPVFS_NOTIFY_REPORT_BATCH pBatch = NULL;
+    PPVFS_NOTIFY_REPORT_RECORD pReport = NULL;
+    PPVFS_NOTIFY_REPORT_RECORD pLastReport = NULL;
     PPVFS_FCB pParentFcb = NULL;
-    PPVFS_FCB pCursor = NULL;
-    PPVFS_FCB pReportParentFcb = NULL;
 
-    BAIL_ON_INVALID_PTR(pReport, ntError);
+    while (!LwListIsEmpty(pReportList))
+    {
+        pReport = LW_STRUCT_FROM_FIELD(
+                      LwListRemoveHead(pReportList),
+                      PVFS_NOTIFY_REPORT_RECORD,
+                      ReportList);
+
+        /* Nobody can be watching a change without a parent directory */
+
+        pParentFcb = PvfsGetParentFCB(pReport->pFcb);
+        if (pParentFcb == NULL)
+        {
+            PvfsNotifyFullReportCtxFree(&pReport);
+            continue;
+        }
+
+        for (pBatchLink = LwListTraverse(pBatchList, NULL);
+             pBatchLink;
+             pBatchLink = LwListTraverse(pBatchList, pBatchLink))
+        {
+            pBatch = LW_STRUCT_FROM_FIELD(
+                         pBatchLink,
+                         PVFS_NOTIFY_REPORT_BATCH,
+                         BatchList);
+
+            if (pBatch->pParentFcb == pParentFcb)
+            {
+                break;
+            }
+        }
+
+        if (pBatchLink)
+        {
+            PvfsReleaseFCB(&pParentFcb);
+        }
+        else
+        {
+            ntError = PvfsAllocateMemory(
+                          (PVOID*)&pBatch,
+                          sizeof(PVFS_NOTIFY_REPORT_BATCH),
+                          TRUE);
+            if (!NT_SUCCESS(ntError))
+            {
+                PvfsReleaseFCB(&pParentFcb);
+                PvfsNotifyFullReportCtxFree(&pReport);
+                continue;
+            }
+
+            pBatch->pParentFcb = pParentFcb;
+            pParentFcb = NULL;
+
+            LwListInit(&pBatch->ReportList);
+            LwListInsertTail(pBatchList, &pBatch->BatchList);
+        }
+
+        /* A burst of identical changes (e.g. repeated writes to one
+           file) is only worth reporting once */
 
-    /* Simply walk up the ancestory and process the notify filter
-       record on top if there is a match */
+        if (!LwListIsEmpty(&pBatch->ReportList))
+        {
+            pLastReport = LW_STRUCT_FROM_FIELD(
+                              pBatch->ReportList.Prev,
+                              PVFS_NOTIFY_REPORT_RECORD,
+                              ReportList);
+
+            if ((pLastReport->Action == pReport->Action) &&
+                (pLastReport->FilenameBytes == pReport->FilenameBytes) &&
+                (memcmp(pLastReport->pwszFilename,
+                        pReport->pwszFilename,
+                        pReport->FilenameBytes) == 0))
+            {
+                pLastReport->Filter |= pReport->Filter;
+                PvfsNotifyFullReportCtxFree(&pReport);
+                continue;
+            }
+        }
+
+        LwListInsertTail(&pBatch->ReportList, &pReport->ReportList);
+        pBatch->ReportCount++;
+    }
 
-    pCursor = PvfsReferenceFCB(pReport->pFcb);
-    pReportParentFcb = PvfsGetParentFCB(pReport->pFcb);
+    /* Encode each directory's changes once for all of its watchers */
 
-    while ((pParentFcb = PvfsGetParentFCB(pCursor)) != NULL)
+    pBatchLink = LwListTraverse(pBatchList, NULL);
+
+    while (pBatchLink)
     {
-        PvfsReleaseFCB(&pCursor);
+        pNextLink = LwListTraverse(pBatchList, pBatchLink);
 
-        /* Process buffers before Irp so we don't doubly report
-           a change on a pending Irp that has requested buffering a
-           change log (which shouldn't start until the existing Irp
-           has been completed). */
+        pBatch = LW_STRUCT_FROM_FIELD(
+                     pBatchLink,
+                     PVFS_NOTIFY_REPORT_BATCH,
+                     BatchList);
 
-        PvfsNotifyFullReportBuffer(pParentFcb, pReportParentFcb, pReport);
-        PvfsNotifyFullReportIrp(pParentFcb, pReportParentFcb, pReport);
+        ntError = PvfsNotifyEncodeBatch(pBatch);
+        if (!NT_SUCCESS(ntError))
+        {
+            LwListRemove(pBatchLink);
+            PvfsNotifyFreeBatch(&pBatch);
+        }
 
-        pCursor = pParentFcb;
+        pBatchLink = pNextLink;
     }
 
+    return;
+}
+
 
-error:
-    if (pCursor)
+/*****************************************************************************
+ ****************************************************************************/
+
+static
+NTSTATUS
+PvfsNotifyEncodeBatch(
+    PPVFS_NOTIFY_REPORT_BATCH pBatch
+    )
+{
+    NTSTATUS ntError = STATUS_UNSUCCESSFUL;
+    PLW_LIST_LINKS pReportLink = NULL;
+    PPVFS_NOTIFY_REPORT_RECORD pReport = NULL;
+    PFILE_NOTIFY_INFORMATION pNotifyInfo = NULL;
+    ULONG Length = 0;
+
+    for (pReportLink = LwListTraverse(&pBatch->ReportList, NULL);
+         pReportLink;
+         pReportLink = LwListTraverse(&pBatch->ReportList, pReportLink))
     {
-        PvfsReleaseFCB(&pCursor);
+        pReport = LW_STRUCT_FROM_FIELD(
+                      pReportLink,
+                      PVFS_NOTIFY_REPORT_RECORD,
+                      ReportList);
+
+        pReport->EntryOffset = Length;
+        pReport->EntryLength = sizeof(*pNotifyInfo) + pReport->FilenameBytes;
+        PVFS_ALIGN_MEMORY(pReport->EntryLength, 8);
+
+        Length += pReport->EntryLength;
     }
 
-    if (pReportParentFcb)
+    ntError = PvfsAllocateMemory(&pBatch->pData, Length, TRUE);
+    BAIL_ON_NT_STATUS(ntError);
+
+    pBatch->Length = Length;
+
+    for (pReportLink = LwListTraverse(&pBatch->ReportList, NULL);
+         pReportLink;
+         pReportLink = LwListTraverse(&pBatch->ReportList, pReportLink))
     {
-        PvfsReleaseFCB(&pReportParentFcb);
+        pReport = LW_STRUCT_FROM_FIELD(
+                      pReportLink,
+                      PVFS_NOTIFY_REPORT_RECORD,
+                      ReportList);
+
+        pNotifyInfo = (PFILE_NOTIFY_INFORMATION)
+                      (pBatch->pData + pReport->EntryOffset);
+
+        pNotifyInfo->NextEntryOffset = pReport->EntryLength;
+        pNotifyInfo->Action = pReport->Action;
+        pNotifyInfo->FileNameLength = pReport->FilenameBytes;
+
+        memcpy(&pNotifyInfo->FileName,
+               pReport->pwszFilename,
+               pReport->FilenameBytes);
+
+        pBatch->LastEntryOffset = pReport->EntryOffset;
     }
 
-    if (pReport)
+    if (pNotifyInfo)
     {
-        PvfsNotifyFullReportCtxFree(&pReport);
+        pNotifyInfo->NextEntryOffset = 0;
+    }
+
+cleanup:
+    return ntError;
+
+error:
+    goto cleanup;
+}
+
+
+/*****************************************************************************
+ ****************************************************************************/
+
+static
+VOID
+PvfsNotifyFreeBatch(
+    PPVFS_NOTIFY_REPORT_BATCH *ppBatch
+    )
+{
+    PPVFS_NOTIFY_REPORT_BATCH pBatch = NULL;
+    PPVFS_NOTIFY_REPORT_RECORD pReport = NULL;
+
+    if (ppBatch && *ppBatch)
+    {
+        pBatch = *ppBatch;
+
+        while (!LwListIsEmpty(&pBatch->ReportList))
+        {
+            pReport = LW_STRUCT_FROM_FIELD(
+                          LwListRemoveHead(&pBatch->ReportList),
+                          PVFS_NOTIFY_REPORT_RECORD,
+                          ReportList);
+
+            PvfsNotifyFullReportCtxFree(&pReport);
+        }
+
+        if (pBatch->pParentFcb)
+        {
+            PvfsReleaseFCB(&pBatch->pParentFcb);
+        }
+
+        PVFS_FREE(&pBatch->pData);
+
+        PVFS_FREE(ppBatch);
     }
 
     return;
 }
 
+
 /*****************************************************************************
  ****************************************************************************/
 
 static
-NTSTATUS
-PvfsNotifyReportBuffer(
-    PPVFS_NOTIFY_FILTER_BUFFER pFilterBuffer,
-    FILE_ACTION Action,
-    PCSTR pszFilename
+VOID
+PvfsNotifyFullReportBatch(
+    PPVFS_FCB pFcb,
+    PPVFS_NOTIFY_REPORT_BATCH pBatch
     );
 
 static
 VOID
-PvfsNotifyFullReportBuffer(
-    PPVFS_FCB pFcb,
-    PPVFS_FCB pReportParentFcb,
-    PPVFS_NOTIFY_REPORT_RECORD pReport
+PvfsNotifyProcessBatch(
+    PPVFS_NOTIFY_REPORT_BATCH pBatch
+    )
+{
+    PPVFS_FCB pFcb = NULL;
+    PPVFS_FCB pParentFcb = NULL;
+
+    /* Simply walk up the ancestory starting at the directory that
+       changed and process the notify filter records on each */
+
+    pFcb = PvfsReferenceFCB(pBatch->pParentFcb);
+
+    while (pFcb)
+    {
+        PvfsNotifyFullReportBatch(pFcb, pBatch);
+
+        pParentFcb = PvfsGetParentFCB(pFcb);
+        PvfsReleaseFCB(&pFcb);
+
+        pFcb = pParentFcb;
+    }
+
+    return;
+}
+
+
+/*****************************************************************************
+ ****************************************************************************/
+
+static
+ULONG
+PvfsNotifyBatchBytesNeeded(
+    PPVFS_NOTIFY_REPORT_BATCH pBatch,
+    FILE_NOTIFY_CHANGE NotifyFilter,
+    PBOOLEAN pbAllMatch
+    )
+{
+    PLW_LIST_LINKS pReportLink = NULL;
+    PPVFS_NOTIFY_REPORT_RECORD pReport = NULL;
+    ULONG BytesNeeded = 0;
+    ULONG MatchCount = 0;
+
+    for (pReportLink = LwListTraverse(&pBatch->ReportList, NULL);
+         pReportLink;
+         pReportLink = LwListTraverse(&pBatch->ReportList, pReportLink))
+    {
+        pReport = LW_STRUCT_FROM_FIELD(
+                      pReportLink,
+                      PVFS_NOTIFY_REPORT_RECORD,
+                      ReportList);
+
+        if (pReport->Filter & NotifyFilter)
+        {
+            BytesNeeded += pReport->EntryLength;
+            MatchCount++;
+        }
+    }
+
+    *pbAllMatch = (MatchCount == pBatch->ReportCount);
+
+    return BytesNeeded;
+}
+
+
+/*****************************************************************************
+ ****************************************************************************/
+
+static
+BOOLEAN
+PvfsNotifyListHasCcb(
+    PLW_LIST_LINKS pFilterList,
+    PPVFS_CCB pCcb
     )
 {
-    NTSTATUS ntError = STATUS_UNSUCCESSFUL;
     PLW_LIST_LINKS pFilterLink = NULL;
     PPVFS_NOTIFY_FILTER_RECORD pFilter = NULL;
-    BOOLEAN bLocked = FALSE;
-
-    LWIO_LOCK_MUTEX(bLocked, &pFcb->BaseControlBlock.Mutex);
 
-    for (pFilterLink = PvfsListTraverse(pFcb->pNotifyListBuffer, NULL);
+    for (pFilterLink = LwListTraverse(pFilterList, NULL);
          pFilterLink;
-         pFilterLink = PvfsListTraverse(pFcb->pNotifyListBuffer, pFilterLink))
+         pFilterLink = LwListTraverse(pFilterList, pFilterLink))
     {
         pFilter = LW_STRUCT_FROM_FIELD(
                       pFilterLink,
                       PVFS_NOTIFY_FILTER_RECORD,
                       NotifyList);
 
-        /* Match the filter and depth */
-
-        if ((pFilter->NotifyFilter & pReport->Filter) &&
-            ((pFcb == pReportParentFcb) || pFilter->bWatchTree))
+        if (pFilter->pCcb == pCcb)
         {
-            ntError = PvfsNotifyReportBuffer(
-                          &pFilter->Buffer,
-                          pReport->Action,
-                          pReport->pszFilename);
-            break;
+            return TRUE;
         }
     }
 
-    LWIO_UNLOCK_MUTEX(bLocked, &pFcb->BaseControlBlock.Mutex);
-
-    return;
+    return FALSE;
 }
 
 
-
 /*****************************************************************************
  ****************************************************************************/
 
+static
+NTSTATUS
+PvfsNotifyReportBuffer(
+    PPVFS_NOTIFY_FILTER_BUFFER pFilterBuffer,
+    PPVFS_NOTIFY_REPORT_BATCH pBatch,
+    FILE_NOTIFY_CHANGE NotifyFilter
+    );
+
 static
 NTSTATUS
 PvfsNotifyReportIrp(
     PPVFS_IRP_CONTEXT pIrpContext,
-    FILE_ACTION Action,
-    PCSTR pszFilename
+    PPVFS_NOTIFY_REPORT_BATCH pBatch,
+    FILE_NOTIFY_CHANGE NotifyFilter
     );
 
 static
 VOID
-PvfsNotifyFullReportIrp(
+PvfsNotifyFullReportBatch(
     PPVFS_FCB pFcb,
-    PPVFS_FCB pReportParentFcb,
-    PPVFS_NOTIFY_REPORT_RECORD pReport
+    PPVFS_NOTIFY_REPORT_BATCH pBatch
     )
 {
     NTSTATUS ntError = STATUS_UNSUCCESSFUL;
     PLW_LIST_LINKS pFilterLink = NULL;
     PLW_LIST_LINKS pNextLink = NULL;
     PPVFS_NOTIFY_FILTER_RECORD pFilter = NULL;
+    LW_LIST_LINKS CompleteList;
+    LW_LIST_LINKS FreeList;
+    BOOLEAN bAllMatch = FALSE;
     BOOLEAN bActive = FALSE;
-    BOOLEAN bLocked =  FALSE;
+    BOOLEAN bLocked = FALSE;
+
+    LwListInit(&CompleteList);
+    LwListInit(&FreeList);
 
     LWIO_LOCK_MUTEX(bLocked, &pFcb->BaseControlBlock.Mutex);
 
+    /* Process buffers before Irps so we don't doubly report a change
+       on a pending Irp that has requested buffering a change log
+       (which shouldn't start until the existing Irp has been
+       completed). */
+
+    for (pFilterLink = PvfsListTraverse(pFcb->pNotifyListBuffer, NULL);
+         pFilterLink;
+         pFilterLink = PvfsListTraverse(pFcb->pNotifyListBuffer, pFilterLink))
+    {
+        pFilter = LW_STRUCT_FROM_FIELD(
+                      pFilterLink,
+                      PVFS_NOTIFY_FILTER_RECORD,
+                      NotifyList);
+
+        /* Match the depth */
+
+        if ((pFcb == pBatch->pParentFcb) || pFilter->bWatchTree)
+        {
+            ntError = PvfsNotifyReportBuffer(
+                          &pFilter->Buffer,
+                          pBatch,
+                          pFilter->NotifyFilter);
+        }
+    }
+
+    /* Pull every pending Irp the batch satisfies (one per handle) off
+       the queue in a single pass */
+
     pFilterLink = PvfsListTraverse(pFcb->pNotifyListIrp, NULL);
 
-    while(pFilterLink)
+    while (pFilterLink)
     {
         pFilter = LW_STRUCT_FROM_FIELD(
                       pFilterLink,
@@ -691,21 +1058,21 @@ PvfsNotifyFullReportIrp(
 
         pNextLink = PvfsListTraverse(pFcb->pNotifyListIrp, pFilterLink);
 
-        /* Continue if we don't match the filter and depth */
+        /* Continue if we don't match the depth and filter */
 
-        if (!((pFilter->NotifyFilter & pReport->Filter) &&
-              ((pFcb == pReportParentFcb) || pFilter->bWatchTree)))
+        if (!(((pFcb == pBatch->pParentFcb) || pFilter->bWatchTree) &&
+              (PvfsNotifyBatchBytesNeeded(
+                   pBatch,
+                   pFilter->NotifyFilter,
+                   &bAllMatch) > 0)) ||
+            PvfsNotifyListHasCcb(&CompleteList, pFilter->pCcb))
         {
-            pFilter = NULL;
             pFilterLink = pNextLink;
-
             continue;
         }
 
         PvfsListRemoveItem(pFcb->pNotifyListIrp, pFilterLink);
 
-        pFilterLink = NULL;
-
         PvfsQueueCancelIrpIfRequested(pFilter->pIrpContext);
 
         bActive = PvfsIrpContextMarkIfNotSetFlag(
@@ -713,52 +1080,73 @@ PvfsNotifyFullReportIrp(
                       PVFS_IRP_CTX_FLAG_CANCELLED,
                       PVFS_IRP_CTX_FLAG_ACTIVE);
 
-        if (!bActive)
-        {
-            PvfsFreeNotifyRecord(&pFilter);
-            pFilterLink = pNextLink;
+        LwListInsertTail(bActive ? &CompleteList : &FreeList, pFilterLink);
 
-            continue;
-        }
+        pFilterLink = pNextLink;
+    }
 
-        LWIO_UNLOCK_MUTEX(bLocked, &pFcb->BaseControlBlock.Mutex);
+    LWIO_UNLOCK_MUTEX(bLocked, &pFcb->BaseControlBlock.Mutex);
+
+    if (LwListIsEmpty(&CompleteList) && LwListIsEmpty(&FreeList))
+    {
+        goto cleanup;
+    }
+
+    for (pFilterLink = LwListTraverse(&CompleteList, NULL);
+         pFilterLink;
+         pFilterLink = LwListTraverse(&CompleteList, pFilterLink))
+    {
+        pFilter = LW_STRUCT_FROM_FIELD(
+                      pFilterLink,
+                      PVFS_NOTIFY_FILTER_RECORD,
+                      NotifyList);
 
         ntError = PvfsNotifyReportIrp(
                       pFilter->pIrpContext,
-                      pReport->Action,
-                      pReport->pszFilename);
-        BAIL_ON_NT_STATUS(ntError);
+                      pBatch,
+                      pFilter->NotifyFilter);
+    }
 
-        /* If we have been asked to buffer changes, move the Fitler Record
-           to the buffer list */
+    /* If we have been asked to buffer changes, move the Filter Record
+       to the buffer list */
+
+    LWIO_LOCK_MUTEX(bLocked, &pFcb->BaseControlBlock.Mutex);
+
+    while (!LwListIsEmpty(&CompleteList))
+    {
+        pFilterLink = LwListRemoveHead(&CompleteList);
+        pFilter = LW_STRUCT_FROM_FIELD(
+                      pFilterLink,
+                      PVFS_NOTIFY_FILTER_RECORD,
+                      NotifyList);
+
+        ntError = STATUS_NOT_FOUND;
 
         if (pFilter->Buffer.Length > 0)
         {
-            LWIO_LOCK_MUTEX(bLocked, &pFcb->BaseControlBlock.Mutex);
             ntError = PvfsListAddTail(pFcb->pNotifyListBuffer, pFilterLink);
-            LWIO_UNLOCK_MUTEX(bLocked, &pFcb->BaseControlBlock.Mutex);
-
-            BAIL_ON_NT_STATUS(ntError);
-
-            pFilter = NULL;
         }
 
-        /* We only process on matching IRP */
-        break;
+        if (!NT_SUCCESS(ntError))
+        {
+            LwListInsertTail(&FreeList, pFilterLink);
+        }
     }
 
-cleanup:
     LWIO_UNLOCK_MUTEX(bLocked, &pFcb->BaseControlBlock.Mutex);
 
-    if (pFilter)
+cleanup:
+    while (!LwListIsEmpty(&FreeList))
     {
+        pFilter = LW_STRUCT_FROM_FIELD(
+                      LwListRemoveHead(&FreeList),
+                      PVFS_NOTIFY_FILTER_RECORD,
+                      NotifyList);
+
         PvfsFreeNotifyRecord(&pFilter);
     }
 
     return;
-
-error:
-    goto cleanup;
 }
 
 
@@ -769,52 +1157,34 @@ static
 NTSTATUS
 PvfsNotifyReportIrp(
     PPVFS_IRP_CONTEXT pIrpContext,
-    FILE_ACTION Action,
-    PCSTR pszFilename
+    PPVFS_NOTIFY_REPORT_BATCH pBatch,
+    FILE_NOTIFY_CHANGE NotifyFilter
     )
 {
     NTSTATUS ntError = STATUS_UNSUCCESSFUL;
-    PVOID pBuffer = pIrpContext->pIrp->Args.ReadDirectoryChange.Buffer;
-    ULONG Length = pIrpContext->pIrp->Args.ReadDirectoryChange.Length;
-    PFILE_NOTIFY_INFORMATION pNotifyInfo = NULL;
-    LONG FilenameBytes = 0;
-    PWSTR pwszFilename = NULL;
-    ULONG BytesNeeded = 0;
-
-    ntError = LwRtlWC16StringAllocateFromCString(&pwszFilename, pszFilename);
-    BAIL_ON_NT_STATUS(ntError);
+    PVFS_NOTIFY_FILTER_BUFFER IrpBuffer = { 0 };
 
-    FilenameBytes = (LwRtlWC16StringNumChars(pwszFilename) + 1) * sizeof(WCHAR);
+    /* Encode straight into the caller's buffer */
 
-    BytesNeeded = sizeof(*pNotifyInfo) + FilenameBytes;
+    IrpBuffer.pData = pIrpContext->pIrp->Args.ReadDirectoryChange.Buffer;
+    IrpBuffer.Length = pIrpContext->pIrp->Args.ReadDirectoryChange.Length;
+    IrpBuffer.Status = STATUS_SUCCESS;
 
-    if (Length < BytesNeeded)
-    {
-        memset(pBuffer, 0x0, Length);
-        ntError = STATUS_NOTIFY_ENUM_DIR;
-        BAIL_ON_NT_STATUS(ntError);
-    }
-
-    pNotifyInfo = (PFILE_NOTIFY_INFORMATION)pBuffer;
-
-    pNotifyInfo->NextEntryOffset = 0;
-    pNotifyInfo->Action = Action;
-    pNotifyInfo->FileNameLength = FilenameBytes;
-
-    memcpy(&pNotifyInfo->FileName, pwszFilename, FilenameBytes);
+    ntError = PvfsNotifyReportBuffer(&IrpBuffer, pBatch, NotifyFilter);
+    BAIL_ON_NT_STATUS(ntError);
 
-    pIrpContext->pIrp->IoStatusBlock.BytesTransferred = BytesNeeded;
+    pIrpContext->pIrp->IoStatusBlock.BytesTransferred = IrpBuffer.Offset;
 
 cleanup:
     pIrpContext->pIrp->IoStatusBlock.Status = ntError;
 
     PvfsCompleteIrpContext(pIrpContext);
 
-    LwRtlWC16StringFree(&pwszFilename);
-
     return ntError;
 
 error:
+    memset(IrpBuffer.pData, 0x0, IrpBuffer.Length);
+
     goto cleanup;
 }
 
@@ -826,28 +1196,30 @@ static
 NTSTATUS
 PvfsNotifyReportBuffer(
     PPVFS_NOTIFY_FILTER_BUFFER pFilterBuffer,
-    FILE_ACTION Action,
-    PCSTR pszFilename
+    PPVFS_NOTIFY_REPORT_BATCH pBatch,
+    FILE_NOTIFY_CHANGE NotifyFilter
     )
 {
     NTSTATUS ntError = STATUS_UNSUCCESSFUL;
     PVOID pBuffer = pFilterBuffer->pData + pFilterBuffer->Offset;
     ULONG Length = pFilterBuffer->Length - pFilterBuffer->Offset;
     PFILE_NOTIFY_INFORMATION pNotifyInfo = NULL;
-    LONG FilenameBytes = 0;
-    PWSTR pwszFilename = NULL;
+    PLW_LIST_LINKS pReportLink = NULL;
+    PPVFS_NOTIFY_REPORT_RECORD pReport = NULL;
     ULONG BytesNeeded = 0;
+    ULONG Offset = 0;
+    BOOLEAN bAllMatch = FALSE;
 
     /* Don't bother if we have already overflowed the buffer */
 
-    BAIL_ON_NT_STATUS(pFilterBuffer->Status);
-
-    ntError = LwRtlWC16StringAllocateFromCString(&pwszFilename, pszFilename);
+    ntError = pFilterBuffer->Status;
     BAIL_ON_NT_STATUS(ntError);
 
-    FilenameBytes = (LwRtlWC16StringNumChars(pwszFilename) + 1) * sizeof(WCHAR);
-    BytesNeeded = sizeof(*pNotifyInfo) + FilenameBytes;
-    PVFS_ALIGN_MEMORY(BytesNeeded, 8);
+    BytesNeeded = PvfsNotifyBatchBytesNeeded(pBatch, NotifyFilter, &bAllMatch);
+    if (BytesNeeded == 0)
+    {
+        goto cleanup;
+    }
 
     if (Length < BytesNeeded)
     {
@@ -855,17 +1227,50 @@ PvfsNotifyReportBuffer(
         BAIL_ON_NT_STATUS(ntError);
     }
 
-    pNotifyInfo = (PFILE_NOTIFY_INFORMATION)pBuffer;
+    if (bAllMatch)
+    {
+        /* Every change in the batch applies so take the shared,
+           already chained entries as they are */
+
+        memcpy(pBuffer, pBatch->pData, pBatch->Length);
+
+        pNotifyInfo = (PFILE_NOTIFY_INFORMATION)
+                      (pBuffer + pBatch->LastEntryOffset);
+    }
+    else
+    {
+        for (pReportLink = LwListTraverse(&pBatch->ReportList, NULL);
+             pReportLink;
+             pReportLink = LwListTraverse(&pBatch->ReportList, pReportLink))
+        {
+            pReport = LW_STRUCT_FROM_FIELD(
+                          pReportLink,
+                          PVFS_NOTIFY_REPORT_RECORD,
+                          ReportList);
+
+            if (!(pReport->Filter & NotifyFilter))
+            {
+                continue;
+            }
+
+            pNotifyInfo = (PFILE_NOTIFY_INFORMATION)(pBuffer + Offset);
 
-    pNotifyInfo->NextEntryOffset = 0;
-    pNotifyInfo->Action = Action;
-    pNotifyInfo->FileNameLength = FilenameBytes;
+            memcpy(pNotifyInfo,
+                   pBatch->pData + pReport->EntryOffset,
+                   pReport->EntryLength);
 
-    memcpy(&pNotifyInfo->FileName, pwszFilename, FilenameBytes);
+            pNotifyInfo->NextEntryOffset = pReport->EntryLength;
+            Offset += pReport->EntryLength;
+        }
+
+        pNotifyInfo->NextEntryOffset = 0;
+    }
 
     if (pFilterBuffer->pNotify)
     {
-        ULONG NextEntry = PVFS_PTR_DIFF(pFilterBuffer->pNotify, pNotifyInfo);
+        ULONG NextEntry = PVFS_PTR_DIFF(
+                              (PBYTE)pFilterBuffer->pNotify,
+                              (PBYTE)pBuffer);
 
         pFilterBuffer->pNotify->NextEntryOffset = NextEntry;
     }
@@ -876,8 +1281,6 @@ PvfsNotifyReportBuffer(
 
 cleanup:
 
-    LwRtlWC16StringFree(&pwszFilename);
-
     return ntError;
 
 error:
@@ -906,7 +1309,7 @@ PvfsNotifyFullReportCtxFree(
             PvfsReleaseFCB(&pReport->pFcb);
         }
 
-        LwRtlCStringFree(&pReport->pszFilename);
+        LwRtlWC16StringFree(&pReport->pwszFilename);
 
         PVFS_FREE(ppReport);
     }
@@ -73,6 +73,14 @@ PvfsOplockGrantLevel2(
     PPVFS_CCB pCcb
     );
 
+static
+NTSTATUS
+PvfsOplockGrantLease(
+    PPVFS_IRP_CONTEXT pIrpContext,
+    PPVFS_CCB pCcb,
+    ULONG LeaseState
+    );
+
 NTSTATUS
 PvfsOplockRequest(
     IN     PPVFS_IRP_CONTEXT pIrpContext,
@@ -140,6 +148,13 @@ PvfsOplockRequest(
         ntError = PvfsOplockGrantLevel2(pIrpContext, pCcb);
         break;
 
+    case IO_OPLOCK_REQUEST_LEASE:
+        ntError = PvfsOplockGrantLease(
+                      pIrpContext,
+                      pCcb,
+                      pOplockRequest->LeaseState);
+        break;
+
     default:
         ntError = STATUS_INVALID_PARAMETER;
         break;
@@ -249,38 +264,63 @@ PvfsOplockBreakAck(
     switch (pOplockBreakResp->Response)
     {
     case IO_OPLOCK_BREAK_ACKNOWLEDGE:
-        /* Only have work if we broke to a level2 oplock */
-        if (pCcb->OplockBreakResult == IO_OPLOCK_BROKEN_TO_LEVEL_2)
+        /* Only have work if we broke to a level2 oplock or to a lease
+           state that still caches something.  The SRV only passes a
+           lease key on opens that request a lease, so a keyed handle
+           is always acknowledging a lease break */
+
+        ntError = STATUS_OPLOCK_NOT_GRANTED;
+
+        if (pCcb->bLeaseKeyPresent)
         {
-            ntError = PvfsOplockGrantLevel2(pIrpContext, pCcb);
+            /* Can only acknowledge (a subset of) the new lease state */
 
-            switch (ntError)
+            if (pOplockBreakResp->LeaseState & ~pCcb->LeaseState)
             {
-            case STATUS_SUCCESS:
-                pIrpContext->pScb = PvfsReferenceSCB(pScb);
-                pIrpContext->QueueType = PVFS_QUEUE_TYPE_OPLOCK;
-
-                LWIO_LOCK_MUTEX(bCcbLocked, &pCcb->ControlBlock);
-                pCcb->OplockState = PVFS_OPLOCK_STATE_GRANTED;
-                LWIO_UNLOCK_MUTEX(bCcbLocked, &pCcb->ControlBlock);
-
-                PvfsIrpMarkPending(
-                    pIrpContext,
-                    PvfsQueueCancelIrp,
-                    pIrpContext);
-                break;
-
-            case STATUS_OPLOCK_NOT_GRANTED:
-                ntError = STATUS_SUCCESS;
-                break;
-
-            default:
-                /* We may not actually want to bail here.  Needs more
-                   testing */
+                ntError = STATUS_INVALID_OPLOCK_PROTOCOL;
                 BAIL_ON_NT_STATUS(ntError);
-                break;
             }
 
+            pCcb->LeaseState = pOplockBreakResp->LeaseState;
+
+            if (pOplockBreakResp->LeaseState != IO_LEASE_STATE_NONE)
+            {
+                ntError = PvfsOplockGrantLease(
+                              pIrpContext,
+                              pCcb,
+                              pOplockBreakResp->LeaseState);
+            }
+        }
+        else if (pCcb->OplockBreakResult == IO_OPLOCK_BROKEN_TO_LEVEL_2)
+        {
+            ntError = PvfsOplockGrantLevel2(pIrpContext, pCcb);
+        }
+
+        switch (ntError)
+        {
+        case STATUS_SUCCESS:
+            pIrpContext->pScb = PvfsReferenceSCB(pScb);
+            pIrpContext->QueueType = PVFS_QUEUE_TYPE_OPLOCK;
+
+            LWIO_LOCK_MUTEX(bCcbLocked, &pCcb->ControlBlock);
+            pCcb->OplockState = PVFS_OPLOCK_STATE_GRANTED;
+            LWIO_UNLOCK_MUTEX(bCcbLocked, &pCcb->ControlBlock);
+
+            PvfsIrpMarkPending(
+                pIrpContext,
+                PvfsQueueCancelIrp,
+                pIrpContext);
+            break;
+
+        case STATUS_OPLOCK_NOT_GRANTED:
+            ntError = STATUS_SUCCESS;
+            break;
+
+        default:
+            /* We may not actually want to bail here.  Needs more
+               testing */
+            BAIL_ON_NT_STATUS(ntError);
+            break;
         }
         break;
 
@@ -642,6 +682,15 @@ PvfsOplockIsMine(
     PPVFS_OPLOCK_RECORD pOplock
     );
 
+static
+NTSTATUS
+PvfsOplockBreakLease(
+    IN  PPVFS_SCB pScb,
+    IN  PPVFS_OPLOCK_RECORD pOplock,
+    IN  ULONG NewLeaseState,
+    OUT PULONG pBreakResult
+    );
+
 /**
  * Return values
  *   STATUS_SUCCESS - No break or no deferred operation necessary
@@ -1003,6 +1052,7 @@ PvfsOplockBreakOnCreate(
     BOOLEAN bCcbLocked = FALSE;
     PIO_FSCTL_OPLOCK_REQUEST_OUTPUT_BUFFER pOutputBuffer = NULL;
     ULONG BreakResult = IO_OPLOCK_NOT_BROKEN;
+    ULONG NewLeaseState = IO_LEASE_STATE_NONE;
 
     /* Don't break our own oplock */
 
@@ -1078,6 +1128,35 @@ PvfsOplockBreakOnCreate(
         ntError = STATUS_SUCCESS;
         break;
 
+    case IO_OPLOCK_REQUEST_LEASE:
+        switch(pIrpContext->pIrp->Args.Create.CreateDisposition)
+        {
+        case FILE_SUPERSEDE:
+        case FILE_OVERWRITE:
+        case FILE_OVERWRITE_IF:
+            NewLeaseState = IO_LEASE_STATE_NONE;
+            break;
+        default:
+            /* Keep handle caching unless the client's cached handles
+               would make this open fail with a sharing violation */
+            NewLeaseState = pOplock->LeaseState & ~IO_LEASE_STATE_WRITE;
+            if (PvfsCcbHasShareModeConflict(
+                    pOplock->pCcb,
+                    pIrpContext->pIrp->Args.Create.ShareAccess,
+                    pIrpContext->pIrp->Args.Create.DesiredAccess))
+            {
+                NewLeaseState &= ~IO_LEASE_STATE_HANDLE;
+            }
+            break;
+        }
+
+        ntError = PvfsOplockBreakLease(
+                      pScb,
+                      pOplock,
+                      NewLeaseState,
+                      &BreakResult);
+        break;
+
     default:
         break;
     }
@@ -1162,6 +1241,14 @@ PvfsOplockBreakOnRead(
         ntError = STATUS_SUCCESS;
         break;
 
+    case IO_OPLOCK_REQUEST_LEASE:
+        ntError = PvfsOplockBreakLease(
+                      pScb,
+                      pOplock,
+                      pOplock->LeaseState & ~IO_LEASE_STATE_WRITE,
+                      &BreakResult);
+        break;
+
     default:
         break;
     }
@@ -1254,6 +1341,18 @@ PvfsOplockBreakOnWrite(
         ntError = STATUS_SUCCESS;
         break;
 
+    case IO_OPLOCK_REQUEST_LEASE:
+        /* Don't break our own lease */
+        if (!PvfsOplockIsMine(pCcb, pOplock))
+        {
+            ntError = PvfsOplockBreakLease(
+                          pScb,
+                          pOplock,
+                          IO_LEASE_STATE_NONE,
+                          &BreakResult);
+        }
+        break;
+
     default:
         break;
     }
@@ -1346,6 +1445,18 @@ PvfsOplockBreakOnLockControl(
         ntError = STATUS_SUCCESS;
         break;
 
+    case IO_OPLOCK_REQUEST_LEASE:
+        /* Don't break our own lease */
+        if (!PvfsOplockIsMine(pCcb, pOplock))
+        {
+            ntError = PvfsOplockBreakLease(
+                          pScb,
+                          pOplock,
+                          IO_LEASE_STATE_NONE,
+                          &BreakResult);
+        }
+        break;
+
     default:
         break;
     }
@@ -1438,6 +1549,18 @@ PvfsOplockBreakOnSetFileInformation(
         ntError = STATUS_SUCCESS;
         break;
 
+    case IO_OPLOCK_REQUEST_LEASE:
+        /* Don't break our own lease */
+        if (!PvfsOplockIsMine(pCcb, pOplock))
+        {
+            ntError = PvfsOplockBreakLease(
+                          pScb,
+                          pOplock,
+                          IO_LEASE_STATE_NONE,
+                          &BreakResult);
+        }
+        break;
+
     default:
         break;
     }
@@ -1624,7 +1747,8 @@ PvfsOplockGrantBatchOrLevel1(
                       pScb,
                       pIrpContext,
                       pCcb,
-                      OplockType);
+                      OplockType,
+                      IO_LEASE_STATE_NONE);
         BAIL_ON_NT_STATUS(ntError);
     }
 
@@ -1688,7 +1812,8 @@ PvfsOplockGrantLevel2(
                       pScb,
                       pIrpContext,
                       pCcb,
-                      IO_OPLOCK_REQUEST_OPLOCK_LEVEL_2);
+                      IO_OPLOCK_REQUEST_OPLOCK_LEVEL_2,
+                      IO_LEASE_STATE_NONE);
         BAIL_ON_NT_STATUS(ntError);
     }
 
@@ -1703,6 +1828,207 @@ error:
 
 
 
+/*****************************************************************************
+ ****************************************************************************/
+
+static
+NTSTATUS
+PvfsOplockGrantLease(
+    PPVFS_IRP_CONTEXT pIrpContext,
+    PPVFS_CCB pCcb,
+    ULONG LeaseState
+    )
+{
+    NTSTATUS ntError = STATUS_OPLOCK_NOT_GRANTED;
+    PPVFS_SCB pScb = NULL;
+    BOOLEAN bScbLocked = FALSE;
+    BOOLEAN bCcbLocked = FALSE;
+    PPVFS_OPLOCK_RECORD pOplock = NULL;
+    PLW_LIST_LINKS pOplockLink = NULL;
+
+    BAIL_ON_INVALID_PTR(pCcb->pScb, ntError);
+
+    pScb = pCcb->pScb;
+
+    /* Leases are tied to a client supplied key and always include
+       read caching */
+
+    if (!pCcb->bLeaseKeyPresent ||
+        !(LeaseState & IO_LEASE_STATE_READ) ||
+        (LeaseState & ~(IO_LEASE_STATE_READ |
+                        IO_LEASE_STATE_HANDLE |
+                        IO_LEASE_STATE_WRITE)))
+    {
+        ntError = STATUS_INVALID_PARAMETER;
+        BAIL_ON_NT_STATUS(ntError);
+    }
+
+    LWIO_LOCK_MUTEX(bScbLocked, &pScb->BaseControlBlock.Mutex);
+
+    /* Write caching with opens from another lease owner - FAIL */
+
+    if ((LeaseState & IO_LEASE_STATE_WRITE) &&
+        PvfsStreamHasOtherLeaseOwners(pScb, pCcb))
+    {
+        ntError = STATUS_OPLOCK_NOT_GRANTED;
+        BAIL_ON_NT_STATUS(ntError);
+    }
+
+    /* Exclusive oplock or another owner's write lease - FAIL */
+
+    while ((pOplockLink = PvfsListTraverse(pScb->pOplockList, pOplockLink)) != NULL)
+    {
+        pOplock = LW_STRUCT_FROM_FIELD(
+                      pOplockLink,
+                      PVFS_OPLOCK_RECORD,
+                      OplockList);
+
+        if (PvfsIrpContextCheckFlag(
+                pOplock->pIrpContext,
+                PVFS_IRP_CTX_FLAG_CANCELLED) ||
+            PvfsOplockIsMine(pCcb, pOplock))
+        {
+            continue;
+        }
+
+        if ((pOplock->OplockType == IO_OPLOCK_REQUEST_OPLOCK_BATCH) ||
+            (pOplock->OplockType == IO_OPLOCK_REQUEST_OPLOCK_LEVEL_1) ||
+            ((pOplock->OplockType == IO_OPLOCK_REQUEST_LEASE) &&
+             (pOplock->LeaseState & IO_LEASE_STATE_WRITE)))
+        {
+            ntError = STATUS_OPLOCK_NOT_GRANTED;
+            BAIL_ON_NT_STATUS(ntError);
+        }
+    }
+
+    /* The other handles on this lease share its new state */
+
+    pOplockLink = NULL;
+
+    while ((pOplockLink = PvfsListTraverse(pScb->pOplockList, pOplockLink)) != NULL)
+    {
+        pOplock = LW_STRUCT_FROM_FIELD(
+                      pOplockLink,
+                      PVFS_OPLOCK_RECORD,
+                      OplockList);
+
+        if ((pOplock->OplockType == IO_OPLOCK_REQUEST_LEASE) &&
+            PvfsOplockIsMine(pCcb, pOplock))
+        {
+            pOplock->LeaseState = LeaseState;
+
+            LWIO_LOCK_MUTEX(bCcbLocked, &pOplock->pCcb->ControlBlock);
+            pOplock->pCcb->LeaseState = LeaseState;
+            LWIO_UNLOCK_MUTEX(bCcbLocked, &pOplock->pCcb->ControlBlock);
+        }
+    }
+
+    /* GRANT */
+
+    PvfsIrpMarkPending(pIrpContext, PvfsQueueCancelIrp, pIrpContext);
+
+    ntError = PvfsAddOplockRecord(
+                  pScb,
+                  pIrpContext,
+                  pCcb,
+                  IO_OPLOCK_REQUEST_LEASE,
+                  LeaseState);
+    BAIL_ON_NT_STATUS(ntError);
+
+    LWIO_LOCK_MUTEX(bCcbLocked, &pCcb->ControlBlock);
+    pCcb->LeaseState = LeaseState;
+    LWIO_UNLOCK_MUTEX(bCcbLocked, &pCcb->ControlBlock);
+
+cleanup:
+    if (pScb)
+    {
+        LWIO_UNLOCK_MUTEX(bScbLocked, &pScb->BaseControlBlock.Mutex);
+    }
+
+    return ntError;
+
+error:
+    goto cleanup;
+}
+
+
+/*****************************************************************************
+ ****************************************************************************/
+
+/**
+ * Lower the lease held by pOplock to NewLeaseState.  Losing write or
+ * handle caching requires the client to acknowledge the break (the
+ * client may have to flush dirty data or close cached handles) and so
+ * returns STATUS_PENDING; dropping read caching completes immediately.
+ **/
+
+static
+NTSTATUS
+PvfsOplockBreakLease(
+    IN  PPVFS_SCB pScb,
+    IN  PPVFS_OPLOCK_RECORD pOplock,
+    IN  ULONG NewLeaseState,
+    OUT PULONG pBreakResult
+    )
+{
+    NTSTATUS ntError = STATUS_SUCCESS;
+    BOOLEAN bCcbLocked = FALSE;
+    PIO_FSCTL_OPLOCK_REQUEST_OUTPUT_BUFFER pOutputBuffer = NULL;
+    ULONG BreakResult = IO_OPLOCK_NOT_BROKEN;
+
+    NewLeaseState &= pOplock->LeaseState;
+
+    if (NewLeaseState == pOplock->LeaseState)
+    {
+        goto cleanup;
+    }
+
+    BreakResult = (NewLeaseState == IO_LEASE_STATE_NONE) ?
+                  IO_OPLOCK_BROKEN_TO_NONE :
+                  IO_OPLOCK_BROKEN_TO_LEVEL_2;
+
+    LWIO_LOCK_MUTEX(bCcbLocked, &pOplock->pCcb->ControlBlock);
+
+    if (pOplock->pCcb->OplockState != PVFS_OPLOCK_STATE_GRANTED)
+    {
+        ntError = STATUS_INVALID_OPLOCK_PROTOCOL;
+        LWIO_UNLOCK_MUTEX(bCcbLocked, &pOplock->pCcb->ControlBlock);
+        BAIL_ON_NT_STATUS(ntError);
+    }
+
+    if (pOplock->LeaseState & (IO_LEASE_STATE_WRITE|IO_LEASE_STATE_HANDLE))
+    {
+        pOplock->pCcb->OplockState = PVFS_OPLOCK_STATE_BREAK_IN_PROGRESS;
+        pScb->bOplockBreakInProgress = TRUE;
+
+        ntError = STATUS_PENDING;
+    }
+    else
+    {
+        pOplock->pCcb->OplockState = PVFS_OPLOCK_STATE_NONE;
+    }
+
+    pOplock->pCcb->OplockBreakResult = BreakResult;
+    pOplock->pCcb->LeaseState = NewLeaseState;
+
+    LWIO_UNLOCK_MUTEX(bCcbLocked, &pOplock->pCcb->ControlBlock);
+
+    pOutputBuffer = (PIO_FSCTL_OPLOCK_REQUEST_OUTPUT_BUFFER)
+                    pOplock->pIrpContext->pIrp->Args.IoFsControl.OutputBuffer;
+    pOutputBuffer->LeaseState = NewLeaseState;
+
+cleanup:
+    *pBreakResult = BreakResult;
+
+    return ntError;
+
+error:
+    BreakResult = IO_OPLOCK_NOT_BROKEN;
+
+    goto cleanup;
+}
+
+
 /*****************************************************************************
  ****************************************************************************/
 
@@ -1713,7 +2039,9 @@ PvfsOplockIsMine(
     PPVFS_OPLOCK_RECORD pOplock
     )
 {
-    return (pCcb == pOplock->pCcb);
+    /* All handles sharing a lease key are a single owner */
+
+    return PvfsCcbIsSameLeaseOwner(pCcb, pOplock->pCcb);
 }
 
 
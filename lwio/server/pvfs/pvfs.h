@@ -674,6 +674,13 @@ PvfsEnforceShareMode(
     IN ACCESS_MASK DesiredAccess
     );
 
+BOOLEAN
+PvfsCcbHasShareModeConflict(
+    IN PPVFS_CCB pCcb,
+    IN FILE_SHARE_FLAGS ShareAccess,
+    IN ACCESS_MASK DesiredAccess
+    );
+
 /* From locking.c */
 
 VOID
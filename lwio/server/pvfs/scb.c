@@ -717,6 +717,43 @@ PvfsStreamHasOtherOpens(
     return hasMultiplOpens;
 }
 
+/*****************************************************************************
+ ****************************************************************************/
+
+BOOLEAN
+PvfsStreamHasOtherLeaseOwners(
+    IN PPVFS_SCB pScb,
+    IN PPVFS_CCB pCcb
+    )
+{
+    BOOLEAN hasOtherOwners = FALSE;
+    BOOLEAN bScbReadLocked = FALSE;
+    PLW_LIST_LINKS pCursor = NULL;
+    PPVFS_CCB pOpenCcb = NULL;
+
+    LWIO_LOCK_RWMUTEX_SHARED(bScbReadLocked, &pScb->rwCcbLock);
+
+    while ((pCursor = PvfsListTraverse(pScb->pCcbList, pCursor)) != NULL)
+    {
+        pOpenCcb = LW_STRUCT_FROM_FIELD(pCursor, PVFS_CCB, ScbList);
+
+        if (IsSetFlag(pOpenCcb->Flags, PVFS_CCB_FLAG_CLOSE_IN_PROGRESS))
+        {
+            continue;
+        }
+
+        if (!PvfsCcbIsSameLeaseOwner(pCcb, pOpenCcb))
+        {
+            hasOtherOwners = TRUE;
+            break;
+        }
+    }
+
+    LWIO_UNLOCK_RWMUTEX(bScbReadLocked, &pScb->rwCcbLock);
+
+    return hasOtherOwners;
+}
+
 /*****************************************************************************
  ****************************************************************************/
 
@@ -770,7 +807,9 @@ PvfsStreamIsOplockedExclusive(
 
     if (pOplock &&
         ((pOplock->OplockType == IO_OPLOCK_REQUEST_OPLOCK_BATCH) ||
-         (pOplock->OplockType == IO_OPLOCK_REQUEST_OPLOCK_LEVEL_1)))
+         (pOplock->OplockType == IO_OPLOCK_REQUEST_OPLOCK_LEVEL_1) ||
+         ((pOplock->OplockType == IO_OPLOCK_REQUEST_LEASE) &&
+          (pOplock->LeaseState & IO_LEASE_STATE_WRITE))))
     {
         bExclusiveOplock = TRUE;
     }
@@ -797,7 +836,8 @@ PvfsAddOplockRecord(
     IN OUT PPVFS_SCB pScb,
     IN     PPVFS_IRP_CONTEXT pIrpContext,
     IN     PPVFS_CCB pCcb,
-    IN     ULONG OplockType
+    IN     ULONG OplockType,
+    IN     ULONG LeaseState
     )
 {
     NTSTATUS ntError = STATUS_UNSUCCESSFUL;
@@ -812,6 +852,7 @@ PvfsAddOplockRecord(
     PVFS_INIT_LINKS(&pOplock->OplockList);
 
     pOplock->OplockType = OplockType;
+    pOplock->LeaseState = LeaseState;
     pOplock->pCcb = PvfsReferenceCCB(pCcb);
     pOplock->pIrpContext = PvfsReferenceIrpContext(pIrpContext);
 
@@ -100,6 +100,12 @@ PvfsStreamHasOtherOpens(
     IN PPVFS_CCB pCcb
     );
 
+BOOLEAN
+PvfsStreamHasOtherLeaseOwners(
+    IN PPVFS_SCB pScb,
+    IN PPVFS_CCB pCcb
+    );
+
 BOOLEAN
 PvfsStreamIsOplocked(
     IN PPVFS_SCB pScb
@@ -139,7 +145,8 @@ PvfsAddOplockRecord(
     IN OUT PPVFS_SCB pScb,
     IN     PPVFS_IRP_CONTEXT pIrpContext,
     IN     PPVFS_CCB pCcb,
-    IN     ULONG OplockType
+    IN     ULONG OplockType,
+    IN     ULONG LeaseState
     );
 
 VOID
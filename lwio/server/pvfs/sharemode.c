@@ -332,3 +332,37 @@ error:
     goto cleanup;
 }
 
+
+/***********************************************************
+ **********************************************************/
+
+BOOLEAN
+PvfsCcbHasShareModeConflict(
+    IN PPVFS_CCB pCcb,
+    IN FILE_SHARE_FLAGS ShareAccess,
+    IN ACCESS_MASK DesiredAccess
+    )
+{
+    DWORD TableSize = sizeof(ShareModeTable) /
+                      sizeof(struct _SHARE_MODE_ACCESS_COMPATIBILITY);
+    int i = 0;
+
+    RtlMapGenericMask(&DesiredAccess, &gPvfsDriverState.GenericSecurityMap);
+
+    for (i=0; i<TableSize; i++)
+    {
+        if ((DesiredAccess & ShareModeTable[i].Access) &&
+            (!(pCcb->ShareFlags & ShareModeTable[i].ShareFlag)))
+        {
+            return TRUE;
+        }
+
+        if ((pCcb->AccessGranted & ShareModeTable[i].Access) &&
+            (!(ShareAccess & ShareModeTable[i].ShareFlag)))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
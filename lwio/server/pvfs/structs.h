@@ -475,6 +475,12 @@ struct _PVFS_CCB
     PVFS_OPLOCK_STATE OplockState;
     ULONG OplockBreakResult;
 
+    /* SMB2.1 lease key passed in on the create (if any) and the
+       lease state this handle was last granted or broken to */
+    BOOLEAN bLeaseKeyPresent;
+    SRV_ECP_LEASE_KEY LeaseKey;
+    ULONG LeaseState;
+
     FILE_NOTIFY_CHANGE ChangeEvent;
     LONG64 FileSize;
     ULONG WriteCount;
@@ -529,6 +535,7 @@ struct _PVFS_OPLOCK_RECORD
     LW_LIST_LINKS OplockList;
 
     ULONG OplockType;
+    ULONG LeaseState;
     PPVFS_CCB pCcb;
     PPVFS_IRP_CONTEXT pIrpContext;
 
@@ -569,13 +576,40 @@ typedef struct _PVFS_NOTIFY_FILTER_RECORD
 
 typedef struct _PVFS_NOTIFY_REPORT_RECORD
 {
+    LW_LIST_LINKS ReportList;
+
     PPVFS_FCB pFcb;
     FILE_NOTIFY_CHANGE Filter;
     FILE_ACTION Action;
-    PSTR pszFilename;
+    PWSTR pwszFilename;
+    ULONG FilenameBytes;
+
+    /* Location of the encoded FILE_NOTIFY_INFORMATION entry in the
+       owning batch's shared buffer */
+    ULONG EntryOffset;
+    ULONG EntryLength;
 
 } PVFS_NOTIFY_REPORT_RECORD, *PPVFS_NOTIFY_REPORT_RECORD;
 
+/* All changes reported against one directory since the last pass of
+   the notify worker.  Entries are encoded once into pData and chained
+   through NextEntryOffset so a watcher that wants every change can take
+   the whole buffer with a single copy */
+
+typedef struct _PVFS_NOTIFY_REPORT_BATCH
+{
+    LW_LIST_LINKS BatchList;
+
+    PPVFS_FCB pParentFcb;
+    LW_LIST_LINKS ReportList;
+    ULONG ReportCount;
+
+    PVOID pData;
+    ULONG Length;
+    ULONG LastEntryOffset;
+
+} PVFS_NOTIFY_REPORT_BATCH, *PPVFS_NOTIFY_REPORT_BATCH;
+
 
 /* SID/UID/GID caches */
 
@@ -666,6 +700,12 @@ typedef struct _PVFS_DRIVER_STATE
 
     PLW_THREAD_POOL ThreadPool;
 
+    struct {
+        pthread_mutex_t Mutex;
+        LW_LIST_LINKS ReportList;
+        BOOLEAN bScheduled;
+    } NotifyQueue;
+
     PVFS_ID_CACHE UidCache;
     PVFS_ID_CACHE GidCache;
 
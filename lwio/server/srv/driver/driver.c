@@ -265,6 +265,7 @@ SrvDriverRefresh(
 {
     NTSTATUS ntStatus = STATUS_SUCCESS;
 
+    ntStatus = SrvUtilsRefreshConfig();
     BAIL_ON_NT_STATUS(ntStatus);
 
 cleanup:
@@ -126,3 +126,26 @@
 
 #define SRV_ELEMENTS_DECREMENT_OPEN_FILES \
         SRV_ELEMENTS_DECREMENT_STAT(gSrvElements.stats.llNumOpenFiles)
+
+#ifdef HAVE_KRB5_MEMORY_RCACHE
+// Kerberos replay cache used for session setup unless the
+// environment already names one; "memory" is provided only by the
+// bundled krb5 and avoids a synced file write per authentication.
+// krb5 reads this from the environment, so it applies to every
+// acceptor in the process.
+#define SRV_KRB5_RCACHE_TYPE_VARIABLE "KRB5RCACHETYPE"
+#define SRV_KRB5_RCACHE_TYPE          "memory"
+#endif
+
+/*
+ * Timer wheels: SRV_TIMER_LEVELS levels of SRV_TIMER_SLOTS slots at
+ * SRV_TIMER_TICK (10 ms) resolution cover 2^24 ticks (about 46 hours).
+ * Later expiries are parked in the top level and re-filed when reached.
+ */
+#define SRV_TIMER_TICK \
+        (10 * WIRE_FACTOR_MILLISECS_TO_HUNDREDS_OF_NANOSECS)
+#define SRV_TIMER_SLOT_BITS  6
+#define SRV_TIMER_SLOTS      (1 << SRV_TIMER_SLOT_BITS)
+#define SRV_TIMER_SLOT_MASK  (SRV_TIMER_SLOTS - 1)
+#define SRV_TIMER_LEVELS     4
+#define SRV_TIMER_MAX_WHEELS 8
@@ -62,6 +62,14 @@ SrvElementsInit(
 
     mt_init_genrand(&gSrvElements.randGen, time(NULL));
 
+#ifdef HAVE_KRB5_MEMORY_RCACHE
+    if (setenv(SRV_KRB5_RCACHE_TYPE_VARIABLE, SRV_KRB5_RCACHE_TYPE, 0) < 0)
+    {
+        ntStatus = LwErrnoToNtStatus(errno);
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+#endif
+
     ntStatus = SrvElementsConfigSetupInitial();
     BAIL_ON_NT_STATUS(ntStatus);
 
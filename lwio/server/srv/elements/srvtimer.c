@@ -50,6 +50,12 @@
 
 #include "includes.h"
 
+static
+NTSTATUS
+SrvTimerWheelInit(
+    IN  PSRV_TIMER_WHEEL pWheel
+    );
+
 static
 PVOID
 SrvTimerMain(
@@ -57,42 +63,69 @@ SrvTimerMain(
     );
 
 static
-NTSTATUS
-SrvTimerGetNextRequest_inlock(
-    IN  PSRV_TIMER_CONTEXT  pContext,
-    OUT PSRV_TIMER_REQUEST* ppTimerRequest
+VOID
+SrvTimerAdvance_inlock(
+    IN OUT PSRV_TIMER_WHEEL pWheel,
+    IN     ULONG64          ullNowTick,
+    IN OUT PLW_LIST_LINKS   pExpired
     );
 
 static
-NTSTATUS
+VOID
+SrvTimerCascade_inlock(
+    IN OUT PSRV_TIMER_WHEEL pWheel,
+    IN     ULONG            ulLevel,
+    IN     ULONG            ulSlot
+    );
+
+static
+ULONG64
+SrvTimerGetWakeTick_inlock(
+    IN  PSRV_TIMER_WHEEL pWheel
+    );
+
+static
+VOID
+SrvTimerInsert_inlock(
+    IN OUT PSRV_TIMER_WHEEL   pWheel,
+    IN OUT PSRV_TIMER_REQUEST pTimerRequest
+    );
+
+static
+VOID
 SrvTimerDetachRequest_inlock(
-    IN OUT PSRV_TIMER_CONTEXT pContext,
+    IN OUT PSRV_TIMER_WHEEL   pWheel,
     IN OUT PSRV_TIMER_REQUEST pTimerRequest
     );
 
 static
 VOID
-SrvTimerFree(
-    IN  PSRV_TIMER_REQUEST pTimerRequest
+SrvTimerDispatch(
+    IN OUT PLW_LIST_LINKS pExpired
+    );
+
+static
+ULONG64
+SrvTimerExpiryToTick(
+    IN  LONG64 llExpiry
     );
 
 static
 VOID
-SrvTimerShutdownCB(
-    PSRV_TIMER_REQUEST pTimerRequest,
-    PVOID              pUserData
+SrvTimerFree(
+    IN  PSRV_TIMER_REQUEST pTimerRequest
     );
 
 static
 BOOLEAN
 SrvTimerMustStop_inlock(
-    IN  PSRV_TIMER_CONTEXT pContext
+    IN  PSRV_TIMER_WHEEL pWheel
     );
 
 static
 VOID
 SrvTimerStop(
-    IN  PSRV_TIMER_CONTEXT pContext
+    IN  PSRV_TIMER_WHEEL pWheel
     );
 
 NTSTATUS
@@ -101,25 +134,77 @@ SrvTimerInit(
     )
 {
     NTSTATUS status = STATUS_SUCCESS;
+    ULONG    ulNumWheels = LwRtlGetCpuCount();
+    ULONG    iWheel = 0;
+
+    memset(pTimer, 0, sizeof(*pTimer));
+
+    if (ulNumWheels < 1)
+    {
+        ulNumWheels = 1;
+    }
+    else if (ulNumWheels > SRV_TIMER_MAX_WHEELS)
+    {
+        ulNumWheels = SRV_TIMER_MAX_WHEELS;
+    }
+
+    status = SrvAllocateMemory(
+                    sizeof(SRV_TIMER_WHEEL) * ulNumWheels,
+                    (PVOID*)&pTimer->pWheels);
+    BAIL_ON_NT_STATUS(status);
+
+    pTimer->ulNumWheels = ulNumWheels;
+
+    for (iWheel = 0; iWheel < ulNumWheels; iWheel++)
+    {
+        status = SrvTimerWheelInit(&pTimer->pWheels[iWheel]);
+        BAIL_ON_NT_STATUS(status);
+    }
+
+error:
+
+    return status;
+}
+
+static
+NTSTATUS
+SrvTimerWheelInit(
+    IN  PSRV_TIMER_WHEEL pWheel
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    LONG64   llCurTime = 0LL;
+    ULONG    iLevel = 0;
+    ULONG    iSlot = 0;
 
-    memset(&pTimer->context, 0, sizeof(pTimer->context));
+    pthread_mutex_init(&pWheel->mutex, NULL);
+    pWheel->pMutex = &pWheel->mutex;
 
-    pthread_mutex_init(&pTimer->context.mutex, NULL);
-    pTimer->context.pMutex = &pTimer->context.mutex;
+    pthread_cond_init(&pWheel->event, NULL);
+    pWheel->pEvent = &pWheel->event;
 
-    pthread_cond_init(&pTimer->context.event, NULL);
-    pTimer->context.pEvent = &pTimer->context.event;
+    for (iLevel = 0; iLevel < SRV_TIMER_LEVELS; iLevel++)
+    {
+        for (iSlot = 0; iSlot < SRV_TIMER_SLOTS; iSlot++)
+        {
+            LwListInit(&pWheel->slots[iLevel][iSlot]);
+        }
+    }
 
-    pTimer->context.bStop = FALSE;
+    status = WireGetCurrentNTTime(&llCurTime);
+    BAIL_ON_NT_STATUS(status);
+
+    pWheel->ullCurrentTick = llCurTime / SRV_TIMER_TICK;
+    pWheel->bStop = FALSE;
 
     status = pthread_create(
-                    &pTimer->timerThread,
+                    &pWheel->timerThread,
                     NULL,
                     &SrvTimerMain,
-                    &pTimer->context);
+                    pWheel);
     BAIL_ON_NT_STATUS(status);
 
-    pTimer->pTimerThread = &pTimer->timerThread;
+    pWheel->pTimerThread = &pWheel->timerThread;
 
 error:
 
@@ -133,206 +218,322 @@ SrvTimerMain(
     )
 {
     NTSTATUS status = 0;
-    PSRV_TIMER_CONTEXT pContext = (PSRV_TIMER_CONTEXT)pData;
-    PSRV_TIMER_REQUEST pTimerRequest = NULL;
+    PSRV_TIMER_WHEEL pWheel = (PSRV_TIMER_WHEEL)pData;
+    LW_LIST_LINKS expired;
     LONG64 llCurTime = 0LL;
     BOOLEAN bInLock = FALSE;
 
     LWIO_LOG_DEBUG("Srv timer starting");
 
-    LWIO_LOCK_MUTEX(bInLock, &pContext->mutex);
+    LwListInit(&expired);
+
+    LWIO_LOCK_MUTEX(bInLock, &pWheel->mutex);
 
-    while (!SrvTimerMustStop_inlock(pContext))
+    while (!SrvTimerMustStop_inlock(pWheel))
     {
+        struct timespec ts = {.tv_sec = 0, .tv_nsec = 0};
+        ULONG64 ullWakeTick = 0;
         int errCode = 0;
-        BOOLEAN bRetryWait = FALSE;
 
-        // If we have a current timer request, check if it is time to service it
-        if (pTimerRequest)
-        {
-            status = WireGetCurrentNTTime(&llCurTime);
-            BAIL_ON_NT_STATUS(status);
+        pWheel->ullWakeTick = 0;
 
-            if (llCurTime >= pTimerRequest->llExpiry &&
-                !pTimerRequest->bCanceled)
-            {
-                SrvTimerDetachRequest_inlock(pContext, pTimerRequest);
+        status = WireGetCurrentNTTime(&llCurTime);
+        BAIL_ON_NT_STATUS(status);
 
-                LWIO_UNLOCK_MUTEX(bInLock, &pContext->mutex);
+        SrvTimerAdvance_inlock(pWheel, llCurTime / SRV_TIMER_TICK, &expired);
 
-                if (pTimerRequest->pfnTimerExpiredCB)
-                {
-                    // Timer has not been canceled
-                    pTimerRequest->pfnTimerExpiredCB(
-                                        pTimerRequest,
-                                        pTimerRequest->pUserData);
-                }
+        if (!LwListIsEmpty(&expired))
+        {
+            // Run the whole batch outside the lock, then look again
+            LWIO_UNLOCK_MUTEX(bInLock, &pWheel->mutex);
 
-                LWIO_LOCK_MUTEX(bInLock, &pContext->mutex);
-            }
+            SrvTimerDispatch(&expired);
 
-            SrvTimerRelease(pTimerRequest);
-            pTimerRequest = NULL;
+            LWIO_LOCK_MUTEX(bInLock, &pWheel->mutex);
+
+            continue;
         }
 
-        // Get the next timer request in queue
-        status = SrvTimerGetNextRequest_inlock(pContext, &pTimerRequest);
-        if (status == STATUS_NOT_FOUND)
+        ullWakeTick = SrvTimerGetWakeTick_inlock(pWheel);
+        if (ullWakeTick)
         {
-            // If the queue is empty wait for a day or until a request arrives
-            struct timespec tsLong = { .tv_sec = time(NULL) + 86400,
-                                       .tv_nsec = 0 };
+            status = WireNTTimeToTimeSpec(ullWakeTick * SRV_TIMER_TICK, &ts);
+            BAIL_ON_NT_STATUS(status);
+        }
+        else
+        {
+            // If the wheel is empty wait for a day or until a request arrives
+            ts.tv_sec = time(NULL) + 86400;
+            ullWakeTick = pWheel->ullCurrentTick +
+                          (86400LL * 1000 *
+                           WIRE_FACTOR_MILLISECS_TO_HUNDREDS_OF_NANOSECS) /
+                          SRV_TIMER_TICK;
+        }
 
-            status = STATUS_SUCCESS;
+        pWheel->ullWakeTick = ullWakeTick;
 
-            do
-            {
-                bRetryWait = FALSE;
+        errCode = pthread_cond_timedwait(
+                        &pWheel->event,
+                        &pWheel->mutex,
+                        &ts);
+        if (errCode != ETIMEDOUT)
+        {
+            status = LwErrnoToNtStatus(errCode);
+            BAIL_ON_NT_STATUS(status);
+        }
+    }
 
-                errCode = pthread_cond_timedwait(
-                                &pContext->event,
-                                &pContext->mutex,
-                                &tsLong);
+cleanup:
 
-                if (errCode == ETIMEDOUT)
-                {
-                    if (time(NULL) < tsLong.tv_sec)
-                    {
-                        bRetryWait = TRUE;
-                        continue;
-                    }
+    pWheel->ullWakeTick = 0;
 
-                    break;
-                }
+    LWIO_UNLOCK_MUTEX(bInLock, &pWheel->mutex);
+
+    LWIO_LOG_DEBUG("Srv timer stopping");
 
-                status = LwErrnoToNtStatus(errCode);
-                BAIL_ON_NT_STATUS(status);
+    return NULL;
 
-            } while (bRetryWait && !SrvTimerMustStop_inlock(pContext));
+error:
 
-            continue;
+    LWIO_LOG_ERROR("Srv timer stopping due to error [%d]", status);
+
+    goto cleanup;
+}
+
+/*
+ * Run the wheel up to and including ullNowTick, moving every request
+ * that fell due onto pExpired.
+ */
+static
+VOID
+SrvTimerAdvance_inlock(
+    IN OUT PSRV_TIMER_WHEEL pWheel,
+    IN     ULONG64          ullNowTick,
+    IN OUT PLW_LIST_LINKS   pExpired
+    )
+{
+    while (pWheel->ullCurrentTick <= ullNowTick)
+    {
+        ULONG ulSlot = pWheel->ullCurrentTick & SRV_TIMER_SLOT_MASK;
+        PLW_LIST_LINKS pSlot = &pWheel->slots[0][ulSlot];
+        ULONG iLevel = 0;
+
+        if (!pWheel->ulCount)
+        {
+            // Nothing queued; skip straight to the present
+            pWheel->ullCurrentTick = ullNowTick + 1;
+            break;
         }
-        BAIL_ON_NT_STATUS(status);
 
-        // At this point, we have a timer request - wait for its specified time
-        do
+        // At each wrap of a level, pull the next slot of the level
+        // above down into the finer levels
+        for (iLevel = 1; !ulSlot && (iLevel < SRV_TIMER_LEVELS); iLevel++)
         {
-            struct timespec ts = {.tv_sec = 0, .tv_nsec = 0};
-            bRetryWait = FALSE;
+            ulSlot = (pWheel->ullCurrentTick >>
+                      (iLevel * SRV_TIMER_SLOT_BITS)) & SRV_TIMER_SLOT_MASK;
 
-            status = WireNTTimeToTimeSpec(pTimerRequest->llExpiry, &ts);
-            BAIL_ON_NT_STATUS(status);
+            SrvTimerCascade_inlock(pWheel, iLevel, ulSlot);
+        }
 
-            errCode = pthread_cond_timedwait(
-                            &pContext->event,
-                            &pContext->mutex,
-                            &ts);
-            if (errCode == ETIMEDOUT)
-            {
-                status = WireGetCurrentNTTime(&llCurTime);
-                BAIL_ON_NT_STATUS(status);
+        while (!LwListIsEmpty(pSlot))
+        {
+            PSRV_TIMER_REQUEST pTimerRequest =
+                LW_STRUCT_FROM_FIELD(
+                    LwListRemoveHead(pSlot),
+                    SRV_TIMER_REQUEST,
+                    link);
+
+            pTimerRequest->bQueued = FALSE;
+            pWheel->ulLevelCount[0]--;
+            pWheel->ulCount--;
+
+            // The queue reference moves to the expiry batch
+            LwListInsertTail(pExpired, &pTimerRequest->link);
+        }
 
-                if (llCurTime < pTimerRequest->llExpiry)
-                {
-                    bRetryWait = TRUE;
-                    continue;
-                }
+        pWheel->ullCurrentTick++;
+    }
+}
 
-                break;
-            }
+static
+VOID
+SrvTimerCascade_inlock(
+    IN OUT PSRV_TIMER_WHEEL pWheel,
+    IN     ULONG            ulLevel,
+    IN     ULONG            ulSlot
+    )
+{
+    LW_LIST_LINKS pending;
+    PLW_LIST_LINKS pSlot = &pWheel->slots[ulLevel][ulSlot];
 
-            status = LwErrnoToNtStatus(errCode);
-            BAIL_ON_NT_STATUS(status);
+    LwListInit(&pending);
 
-        } while (bRetryWait && !SrvTimerMustStop_inlock(pContext));
+    while (!LwListIsEmpty(pSlot))
+    {
+        LwListInsertTail(&pending, LwListRemoveHead(pSlot));
+        pWheel->ulLevelCount[ulLevel]--;
+        pWheel->ulCount--;
     }
 
-cleanup:
+    while (!LwListIsEmpty(&pending))
+    {
+        SrvTimerInsert_inlock(
+            pWheel,
+            LW_STRUCT_FROM_FIELD(
+                LwListRemoveHead(&pending),
+                SRV_TIMER_REQUEST,
+                link));
+    }
+}
 
-    LWIO_UNLOCK_MUTEX(bInLock, &pContext->mutex);
+/*
+ * Tick the wheel thread must wake up at, or 0 if the wheel is empty.
+ * This is the next occupied level 0 slot, or the next level 0 wrap if
+ * only coarser levels hold requests.
+ */
+static
+ULONG64
+SrvTimerGetWakeTick_inlock(
+    IN  PSRV_TIMER_WHEEL pWheel
+    )
+{
+    ULONG64 ullWakeTick = 0;
+    ULONG   iLevel = 0;
+    ULONG   iTick = 0;
 
-    if (pTimerRequest)
+    if (pWheel->ulLevelCount[0])
     {
-        SrvTimerRelease(pTimerRequest);
-    }
+        for (iTick = 0; iTick < SRV_TIMER_SLOTS; iTick++)
+        {
+            ULONG ulSlot =
+                (pWheel->ullCurrentTick + iTick) & SRV_TIMER_SLOT_MASK;
 
-    LWIO_LOG_DEBUG("Srv timer stopping");
+            if (!LwListIsEmpty(&pWheel->slots[0][ulSlot]))
+            {
+                ullWakeTick = pWheel->ullCurrentTick + iTick;
+                break;
+            }
+        }
+    }
 
-    return NULL;
+    for (iLevel = 1; iLevel < SRV_TIMER_LEVELS; iLevel++)
+    {
+        if (pWheel->ulLevelCount[iLevel])
+        {
+            // The current tick may itself be a wrap not yet cascaded
+            ULONG64 ullWrapTick =
+                (pWheel->ullCurrentTick + SRV_TIMER_SLOT_MASK) &
+                ~((ULONG64)SRV_TIMER_SLOT_MASK);
 
-error:
+            if (!ullWakeTick || (ullWrapTick < ullWakeTick))
+            {
+                ullWakeTick = ullWrapTick;
+            }
 
-    LWIO_LOG_ERROR("Srv timer stopping due to error [%d]", status);
+            break;
+        }
+    }
 
-    goto cleanup;
+    return ullWakeTick;
 }
 
 static
-NTSTATUS
-SrvTimerGetNextRequest_inlock(
-    IN  PSRV_TIMER_CONTEXT  pContext,
-    OUT PSRV_TIMER_REQUEST* ppTimerRequest
+VOID
+SrvTimerInsert_inlock(
+    IN OUT PSRV_TIMER_WHEEL   pWheel,
+    IN OUT PSRV_TIMER_REQUEST pTimerRequest
     )
 {
-    NTSTATUS status = STATUS_SUCCESS;
-    PSRV_TIMER_REQUEST pTimerRequest = NULL;
+    ULONG64 ullTick = SrvTimerExpiryToTick(pTimerRequest->llExpiry);
+    ULONG64 ullDelta = 0;
+    ULONG   ulLevel = 0;
+    ULONG   ulSlot = 0;
 
-    if (!pContext->pRequests)
+    if (ullTick < pWheel->ullCurrentTick)
     {
-        status = STATUS_NOT_FOUND;
-        BAIL_ON_NT_STATUS(status);
+        // Already due; fire on the next pass
+        ullTick = pWheel->ullCurrentTick;
     }
 
-    pTimerRequest = pContext->pRequests;
-
-    InterlockedIncrement(&pTimerRequest->refCount);
+    ullDelta = ullTick - pWheel->ullCurrentTick;
 
-    *ppTimerRequest = pTimerRequest;
-
-cleanup:
+    while ((ulLevel < SRV_TIMER_LEVELS - 1) &&
+           (ullDelta >> ((ulLevel + 1) * SRV_TIMER_SLOT_BITS)))
+    {
+        ulLevel++;
+    }
 
-    return status;
+    if (ullDelta >> (SRV_TIMER_LEVELS * SRV_TIMER_SLOT_BITS))
+    {
+        // Beyond the wheel; park in the last slot it covers and
+        // re-file from the real expiry when that slot cascades
+        ullTick = pWheel->ullCurrentTick +
+                  (1ULL << (SRV_TIMER_LEVELS * SRV_TIMER_SLOT_BITS)) - 1;
+    }
 
-error:
+    ulSlot = (ullTick >> (ulLevel * SRV_TIMER_SLOT_BITS)) & SRV_TIMER_SLOT_MASK;
 
-    *ppTimerRequest = NULL;
+    LwListInsertTail(&pWheel->slots[ulLevel][ulSlot], &pTimerRequest->link);
 
-    goto cleanup;
+    pTimerRequest->bQueued = TRUE;
+    pTimerRequest->ulLevel = ulLevel;
+    pWheel->ulLevelCount[ulLevel]++;
+    pWheel->ulCount++;
 }
 
 static
-NTSTATUS
+VOID
 SrvTimerDetachRequest_inlock(
-    IN OUT PSRV_TIMER_CONTEXT pContext,
+    IN OUT PSRV_TIMER_WHEEL   pWheel,
     IN OUT PSRV_TIMER_REQUEST pTimerRequest
     )
 {
-    if (pTimerRequest->pPrev)
-    {
-        pTimerRequest->pPrev->pNext = pTimerRequest->pNext;
+    LwListRemove(&pTimerRequest->link);
 
-        if (pTimerRequest->pNext)
-        {
-            pTimerRequest->pNext->pPrev = pTimerRequest->pPrev;
-        }
-    }
-    else
+    pTimerRequest->bQueued = FALSE;
+    pWheel->ulLevelCount[pTimerRequest->ulLevel]--;
+    pWheel->ulCount--;
+}
+
+static
+VOID
+SrvTimerDispatch(
+    IN OUT PLW_LIST_LINKS pExpired
+    )
+{
+    while (!LwListIsEmpty(pExpired))
     {
-        pContext->pRequests = pTimerRequest->pNext;
+        PSRV_TIMER_REQUEST pTimerRequest =
+            LW_STRUCT_FROM_FIELD(
+                LwListRemoveHead(pExpired),
+                SRV_TIMER_REQUEST,
+                link);
 
-        if (pTimerRequest->pNext)
+        if (pTimerRequest->pfnTimerExpiredCB)
         {
-            pTimerRequest->pNext->pPrev = NULL;
+            pTimerRequest->pfnTimerExpiredCB(
+                                pTimerRequest,
+                                pTimerRequest->pUserData);
         }
-    }
 
-    pTimerRequest->pPrev = NULL;
-    pTimerRequest->pNext = NULL;
+        // Removed from timer queue
+        SrvTimerRelease(pTimerRequest);
+    }
+}
 
-    // Removed from timer queue
-    InterlockedDecrement(&pTimerRequest->refCount);
+/* Round up so that a request never fires before its expiry */
+static
+ULONG64
+SrvTimerExpiryToTick(
+    IN  LONG64 llExpiry
+    )
+{
+    if (llExpiry <= 0)
+    {
+        return 0;
+    }
 
-    return STATUS_SUCCESS;
+    return (llExpiry + SRV_TIMER_TICK - 1) / SRV_TIMER_TICK;
 }
 
 NTSTATUS
@@ -346,9 +547,9 @@ SrvTimerPostRequestSpecific(
 {
     NTSTATUS status = STATUS_SUCCESS;
     PSRV_TIMER_REQUEST pTimerRequest = NULL;
-    PSRV_TIMER_REQUEST pTimerIter = NULL;
-    PSRV_TIMER_REQUEST pPrev = NULL;
+    PSRV_TIMER_WHEEL pWheel = NULL;
     BOOLEAN bInLock = FALSE;
+    BOOLEAN bWake = FALSE;
 
     if (!llExpiry)
     {
@@ -366,45 +567,51 @@ SrvTimerPostRequestSpecific(
                     (PVOID*)&pTimerRequest);
     BAIL_ON_NT_STATUS(status);
 
+    pWheel = &pTimer->pWheels[
+                    (ULONG)InterlockedIncrement(&pTimer->lNextWheel) %
+                    pTimer->ulNumWheels];
+
     pTimerRequest->refCount = 1;
 
     pTimerRequest->llExpiry = llExpiry;
     pTimerRequest->pUserData = pUserData;
     pTimerRequest->pfnTimerExpiredCB = pfnTimerExpiredCB;
     pTimerRequest->bCanceled = FALSE;
+    pTimerRequest->pWheel = pWheel;
+    LwListInit(&pTimerRequest->link);
 
-    LWIO_LOCK_MUTEX(bInLock, &pTimer->context.mutex);
-
-    for (pTimerIter = pTimer->context.pRequests;
-         pTimerIter && (pTimerIter->llExpiry <= llExpiry);
-         pPrev = pTimerIter, pTimerIter = pTimerIter->pNext);
+    LWIO_LOCK_MUTEX(bInLock, &pWheel->mutex);
 
-    if (!pPrev)
-    {
-        pTimerRequest->pNext = pTimer->context.pRequests;
-        if (pTimer->context.pRequests)
-        {
-            pTimer->context.pRequests->pPrev = pTimerRequest;
-        }
-        pTimer->context.pRequests = pTimerRequest;
-    }
-    else
+    if (!pWheel->ulCount)
     {
-        pTimerRequest->pNext = pPrev->pNext;
-        pTimerRequest->pPrev = pPrev;
-        pPrev->pNext = pTimerRequest;
-        if (pTimerRequest->pNext)
+        // An idle wheel stops ticking; catch it up so the request is
+        // filed relative to the present
+        LONG64 llCurTime = 0LL;
+
+        status = WireGetCurrentNTTime(&llCurTime);
+        BAIL_ON_NT_STATUS(status);
+
+        if (pWheel->ullCurrentTick < llCurTime / SRV_TIMER_TICK)
         {
-            pTimerRequest->pNext->pPrev = pTimerRequest;
+            pWheel->ullCurrentTick = llCurTime / SRV_TIMER_TICK;
         }
     }
 
+    SrvTimerInsert_inlock(pWheel, pTimerRequest);
+
     // +1 for timer queue
     InterlockedIncrement(&pTimerRequest->refCount);
 
-    LWIO_UNLOCK_MUTEX(bInLock, &pTimer->context.mutex);
+    // Only disturb the wheel thread if it is asleep past this expiry
+    bWake = (pWheel->ullWakeTick &&
+             (SrvTimerExpiryToTick(llExpiry) < pWheel->ullWakeTick));
+
+    LWIO_UNLOCK_MUTEX(bInLock, &pWheel->mutex);
 
-    pthread_cond_signal(&pTimer->context.event);
+    if (bWake)
+    {
+        pthread_cond_signal(&pWheel->event);
+    }
 
     // +1 for caller
     InterlockedIncrement(&pTimerRequest->refCount);
@@ -413,7 +620,7 @@ SrvTimerPostRequestSpecific(
 
 cleanup:
 
-    LWIO_UNLOCK_MUTEX(bInLock, &pTimer->context.mutex);
+    LWIO_UNLOCK_MUTEX(bInLock, &pWheel->mutex);
 
     if (pTimerRequest)
     {
@@ -438,60 +645,34 @@ SrvTimerCancelRequestSpecific(
 {
     NTSTATUS status = STATUS_SUCCESS;
     BOOLEAN bInLock = FALSE;
-    PSRV_TIMER_REQUEST pIter = NULL;
-    PVOID              pUserData = NULL;
-
-    LWIO_LOCK_MUTEX(bInLock, &pTimer->context.mutex);
-
-    for (pIter = pTimer->context.pRequests;
-         pIter && (pIter != pTimerRequest);
-         pIter = pIter->pNext);
-
-    if (pIter)
-    {
-        PSRV_TIMER_REQUEST pPrev = pIter->pPrev;
-
-        if (pPrev)
-        {
-            pPrev->pNext = pIter->pNext;
-        }
-        else
-        {
-            pTimer->context.pRequests = pIter->pNext;
-        }
-
-        if (pIter->pNext)
-        {
-            pIter->pNext->pPrev = pPrev;
-        }
+    PSRV_TIMER_WHEEL pWheel = pTimerRequest->pWheel;
+    PVOID pUserData = NULL;
 
-        pIter->pPrev = NULL;
-        pIter->pNext = NULL;
+    LWIO_LOCK_MUTEX(bInLock, &pWheel->mutex);
 
-        pIter->pfnTimerExpiredCB = NULL;
-        pUserData = pIter->pUserData;
-        pIter->bCanceled = TRUE;
-    }
-    else
+    // Requests that already fell due are being (or were) dispatched
+    if (!pTimerRequest->bQueued)
     {
         status = STATUS_NOT_FOUND;
         BAIL_ON_NT_STATUS(status);
     }
 
-    LWIO_UNLOCK_MUTEX(bInLock, &pTimer->context.mutex);
+    SrvTimerDetachRequest_inlock(pWheel, pTimerRequest);
+
+    pTimerRequest->pfnTimerExpiredCB = NULL;
+    pUserData = pTimerRequest->pUserData;
+    pTimerRequest->bCanceled = TRUE;
 
-    pthread_cond_signal(&pTimer->context.event);
+    LWIO_UNLOCK_MUTEX(bInLock, &pWheel->mutex);
+
+    // Removed from timer queue
+    SrvTimerRelease(pTimerRequest);
 
     *ppUserData = pUserData;
 
 cleanup:
 
-    LWIO_UNLOCK_MUTEX(bInLock, &pTimer->context.mutex);
-
-    if (pIter)
-    {
-        SrvTimerRelease(pIter);
-    }
+    LWIO_UNLOCK_MUTEX(bInLock, &pWheel->mutex);
 
     return status;
 
@@ -527,39 +708,19 @@ SrvTimerIndicateStop(
     IN  PSRV_TIMER pTimer
     )
 {
-    NTSTATUS ntStatus = STATUS_SUCCESS;
-    PSRV_TIMER_REQUEST pTimerRequest = NULL;
+    ULONG iWheel = 0;
 
-    if (pTimer->pTimerThread)
+    for (iWheel = 0; iWheel < pTimer->ulNumWheels; iWheel++)
     {
-        SrvTimerStop(&pTimer->context);
-
-        // Wake up the timer thread
-        ntStatus = SrvTimerPostRequest(
-                        1LL,
-                        NULL,
-                        &SrvTimerShutdownCB,
-                        &pTimerRequest);
-        BAIL_ON_NT_STATUS(ntStatus);
-    }
-
-error:
+        PSRV_TIMER_WHEEL pWheel = &pTimer->pWheels[iWheel];
 
-    if (pTimerRequest)
-    {
-        SrvTimerRelease(pTimerRequest);
+        if (pWheel->pTimerThread)
+        {
+            SrvTimerStop(pWheel);
+        }
     }
 
-    return ntStatus;
-}
-
-static
-VOID
-SrvTimerShutdownCB(
-    PSRV_TIMER_REQUEST pTimerRequest,
-    PVOID              pUserData
-    )
-{
+    return STATUS_SUCCESS;
 }
 
 VOID
@@ -567,44 +728,80 @@ SrvTimerFreeContents(
     IN  PSRV_TIMER pTimer
     )
 {
-    if (pTimer->pTimerThread)
+    ULONG iWheel = 0;
+    ULONG iLevel = 0;
+    ULONG iSlot = 0;
+
+    for (iWheel = 0; iWheel < pTimer->ulNumWheels; iWheel++)
     {
-        SrvTimerStop(&pTimer->context);
+        PSRV_TIMER_WHEEL pWheel = &pTimer->pWheels[iWheel];
 
-        pthread_join(pTimer->timerThread, NULL);
-    }
+        if (pWheel->pTimerThread)
+        {
+            SrvTimerStop(pWheel);
 
-    if (pTimer->context.pEvent)
-    {
-        pthread_cond_destroy(&pTimer->context.event);
-        pTimer->context.pEvent = NULL;
-    }
+            pthread_join(pWheel->timerThread, NULL);
+            pWheel->pTimerThread = NULL;
+        }
 
-    while(pTimer->context.pRequests)
-    {
-        PSRV_TIMER_REQUEST pRequest = pTimer->context.pRequests;
+        if (pWheel->pEvent)
+        {
+            pthread_cond_destroy(&pWheel->event);
+            pWheel->pEvent = NULL;
+        }
 
-        pTimer->context.pRequests = pTimer->context.pRequests->pNext;
+        for (iLevel = 0; iLevel < SRV_TIMER_LEVELS; iLevel++)
+        {
+            for (iSlot = 0; iSlot < SRV_TIMER_SLOTS; iSlot++)
+            {
+                PLW_LIST_LINKS pSlot = &pWheel->slots[iLevel][iSlot];
+
+                if (!pSlot->Next)
+                {
+                    // Wheel never initialized
+                    continue;
+                }
+
+                while (!LwListIsEmpty(pSlot))
+                {
+                    PSRV_TIMER_REQUEST pRequest =
+                        LW_STRUCT_FROM_FIELD(
+                            LwListRemoveHead(pSlot),
+                            SRV_TIMER_REQUEST,
+                            link);
+
+                    pRequest->bQueued = FALSE;
 
-        SrvTimerRelease(pRequest);
+                    SrvTimerRelease(pRequest);
+                }
+            }
+        }
+
+        if (pWheel->pMutex)
+        {
+            pthread_mutex_destroy(&pWheel->mutex);
+            pWheel->pMutex = NULL;
+        }
     }
 
-    if (pTimer->context.pMutex)
+    if (pTimer->pWheels)
     {
-        pthread_mutex_destroy(&pTimer->context.mutex);
-        pTimer->context.pMutex = NULL;
+        SrvFreeMemory(pTimer->pWheels);
+        pTimer->pWheels = NULL;
     }
+
+    pTimer->ulNumWheels = 0;
 }
 
 static
 BOOLEAN
 SrvTimerMustStop_inlock(
-    IN  PSRV_TIMER_CONTEXT pContext
+    IN  PSRV_TIMER_WHEEL pWheel
     )
 {
     BOOLEAN bStop = FALSE;
 
-    bStop = pContext->bStop;
+    bStop = pWheel->bStop;
 
     return bStop;
 }
@@ -612,12 +809,14 @@ SrvTimerMustStop_inlock(
 static
 VOID
 SrvTimerStop(
-    IN  PSRV_TIMER_CONTEXT pContext
+    IN  PSRV_TIMER_WHEEL pWheel
     )
 {
-    pthread_mutex_lock(&pContext->mutex);
+    pthread_mutex_lock(&pWheel->mutex);
+
+    pWheel->bStop = TRUE;
 
-    pContext->bStop = TRUE;
+    pthread_mutex_unlock(&pWheel->mutex);
 
-    pthread_mutex_unlock(&pContext->mutex);
+    pthread_cond_signal(&pWheel->event);
 }
@@ -71,12 +71,16 @@ typedef struct _SRV_TIMER_REQUEST
     PFN_SRV_TIMER_CALLBACK pfnTimerExpiredCB;
     BOOLEAN                bCanceled;
 
-    struct _SRV_TIMER_REQUEST* pNext;
-    struct _SRV_TIMER_REQUEST* pPrev;
+    struct _SRV_TIMER_WHEEL* pWheel;
+
+    // Wheel slot while queued, expiry batch once due
+    LW_LIST_LINKS link;
+    BOOLEAN       bQueued;
+    ULONG         ulLevel;
 
 } SRV_TIMER_REQUEST;
 
-typedef struct _SRV_TIMER_CONTEXT
+typedef struct _SRV_TIMER_WHEEL
 {
     pthread_mutex_t  mutex;
     pthread_mutex_t* pMutex;
@@ -84,18 +88,28 @@ typedef struct _SRV_TIMER_CONTEXT
     pthread_cond_t   event;
     pthread_cond_t*  pEvent;
 
-    PSRV_TIMER_REQUEST pRequests;
+    pthread_t  timerThread;
+    pthread_t* pTimerThread;
+
+    // Every tick before this one has been dispatched
+    ULONG64 ullCurrentTick;
+    // Tick the wheel thread is sleeping until (0 while it is running)
+    ULONG64 ullWakeTick;
+
+    ULONG ulCount;
+    ULONG ulLevelCount[SRV_TIMER_LEVELS];
+    LW_LIST_LINKS slots[SRV_TIMER_LEVELS][SRV_TIMER_SLOTS];
 
     BOOLEAN bStop;
 
-} SRV_TIMER_CONTEXT, *PSRV_TIMER_CONTEXT;
+} SRV_TIMER_WHEEL, *PSRV_TIMER_WHEEL;
 
 typedef struct _SRV_TIMER
 {
-    pthread_t  timerThread;
-    pthread_t* pTimerThread;
-
-    SRV_TIMER_CONTEXT context;
+    // One wheel (and thread) per CPU; requests are spread round robin
+    PSRV_TIMER_WHEEL pWheels;
+    ULONG            ulNumWheels;
+    LONG             lNextWheel;
 
 } SRV_TIMER, *PSRV_TIMER;
 
@@ -64,6 +64,7 @@ typedef UCHAR SMB_OPLOCK_LEVEL;
 #define SMB_OPLOCK_LEVEL_I     0x01
 #define SMB_OPLOCK_LEVEL_BATCH 0x02
 #define SMB_OPLOCK_LEVEL_II    0x03
+#define SMB_OPLOCK_LEVEL_LEASE 0x04
 
 #define SMB_CN_MAX_BUFFER_SIZE 0x00010000
 
@@ -557,6 +558,10 @@ typedef struct _SRV_CLIENT_PROPERITES
     PWSTR  pwszNativeLanMan;
     PWSTR  pwszNativeDomain;
 
+    // SMB2 only
+    USHORT usDialect;
+    UCHAR  ClientGUID[16];
+
 } SRV_CLIENT_PROPERTIES, *PSRV_CLIENT_PROPERTIES;
 
 typedef struct _SRV_SOCKET *PLWIO_SRV_SOCKET;
@@ -428,6 +428,14 @@ SrvLogContextFree(
     PSRV_LOG_CONTEXT pLogContext
     );
 
+/*
+ * Re-reads the enhanced logging specification from the registry.
+ */
+NTSTATUS
+SrvUtilsRefreshConfig(
+    VOID
+    );
+
 NTSTATUS
 SrvUtilsShutdown(
     VOID
@@ -52,6 +52,7 @@
 
 #define SRV_NEGOTIATE_DIALECT_NTLM_0_12 "NT LM 0.12"
 #define SRV_NEGOTIATE_DIALECT_SMB_2     "SMB 2.002"
+#define SRV_NEGOTIATE_DIALECT_SMB_2_X   "SMB 2.???"
 
 #define SRV_DEFAULT_NUM_ASYNC_WORKERS             2
 #define SRV_DEFAULT_NUM_MAX_ASYNC_ITEMS_IN_QUEUE  20
@@ -120,24 +120,41 @@ SrvBuildNegotiateResponseForDialect(
     bSupportSMBV2 = SrvProtocolConfigIsSmb2Enabled();
     if (bSupportSMBV2)
     {
+        USHORT usDialect = 0;
+
+        /* Clients that know about SMB 2.1 offer the wildcard dialect and
+           expect to redo the negotiate in SMB2 to pick the real one */
+
         for (iDialect = 0; iDialect < ulNumDialects; iDialect++)
         {
             if (!strcmp(ppszDialectArray[iDialect],
-                        SRV_NEGOTIATE_DIALECT_SMB_2))
+                        SRV_NEGOTIATE_DIALECT_SMB_2_X))
             {
-                ntStatus = SrvBuildNegotiateResponse_SMB_V2(
-                                pConnection,
-                                pSmbRequest,
-                                &pSmbResponse);
-                BAIL_ON_NT_STATUS(ntStatus);
+                usDialect = SMB2_DIALECT_WILDCARD;
+                break;
+            }
+            else if (!strcmp(ppszDialectArray[iDialect],
+                             SRV_NEGOTIATE_DIALECT_SMB_2))
+            {
+                usDialect = SMB2_DIALECT_2_002;
+            }
+        }
 
-                ntStatus = SrvConnectionSetProtocolVersion(
-                                pConnection,
-                                SMB_PROTOCOL_VERSION_2);
-                BAIL_ON_NT_STATUS(ntStatus);
+        if (usDialect)
+        {
+            ntStatus = SrvBuildNegotiateResponse_SMB_V2(
+                            pConnection,
+                            pSmbRequest,
+                            usDialect,
+                            &pSmbResponse);
+            BAIL_ON_NT_STATUS(ntStatus);
 
-                goto done;
-            }
+            ntStatus = SrvConnectionSetProtocolVersion(
+                            pConnection,
+                            SMB_PROTOCOL_VERSION_2);
+            BAIL_ON_NT_STATUS(ntStatus);
+
+            goto done;
         }
     }
 
@@ -73,6 +73,7 @@ NTSTATUS
 SrvBuildNegotiateResponse_SMB_V2(
     IN  PLWIO_SRV_CONNECTION pConnection,
     IN  PSMB_PACKET          pSmbRequest,
+    IN  USHORT               usDialect,
     OUT PSMB_PACKET*         ppSmbResponse
     );
 
@@ -104,6 +104,12 @@ SrvRequestCreateOplocks_SMB_V2(
     PSRV_EXEC_CONTEXT pExecContext
     );
 
+static
+NTSTATUS
+SrvRequestCreateLease_SMB_V2(
+    PSRV_EXEC_CONTEXT pExecContext
+    );
+
 static
 VOID
 SrvPrepareCreateStateAsync_SMB_V2(
@@ -758,6 +764,55 @@ SrvBuildCreateState_SMB_V2(
 
                 break;
 
+            case SMB2_CONTEXT_ITEM_TYPE_LEASE:
+
+                /* Leases only exist from SMB 2.1 on, and the client
+                   signals it wants one through the oplock level */
+
+                if ((pConnection->clientProperties.usDialect <
+                                                SMB2_DIALECT_2_1) ||
+                    (pRequestHeader->ucOplockLevel != SMB2_OPLOCK_LEVEL_LEASE) ||
+                    SrvTree2IsNamedPipe(pCtxSmb2->pTree))
+                {
+                    break;
+                }
+
+                if (pContext->ulDataLength < sizeof(SMB2_LEASE_CREATE_CONTEXT))
+                {
+                    ntStatus = STATUS_INVALID_PARAMETER;
+                    BAIL_ON_NT_STATUS(ntStatus);
+                }
+
+                pCreateState->pLeaseContext = pContext;
+
+                memcpy(pCreateState->leaseKey.ClientGuid,
+                       pConnection->clientProperties.ClientGUID,
+                       sizeof(pCreateState->leaseKey.ClientGuid));
+                memcpy(pCreateState->leaseKey.LeaseKey,
+                       ((PSMB2_LEASE_CREATE_CONTEXT)pContext->pData)->leaseKey,
+                       sizeof(pCreateState->leaseKey.LeaseKey));
+
+                ntStatus = SrvLeaseCheckFile_SMB_V2(
+                                &pCreateState->leaseKey,
+                                &pCreateState->pFilename->Name);
+                BAIL_ON_NT_STATUS(ntStatus);
+
+                if (!pCreateState->pEcpList)
+                {
+                    ntStatus = IoRtlEcpListAllocate(&pCreateState->pEcpList);
+                    BAIL_ON_NT_STATUS(ntStatus);
+                }
+
+                ntStatus = IoRtlEcpListInsert(
+                                pCreateState->pEcpList,
+                                SRV_ECP_TYPE_LEASE_KEY,
+                                &pCreateState->leaseKey,
+                                sizeof(pCreateState->leaseKey),
+                                NULL);
+                BAIL_ON_NT_STATUS(ntStatus);
+
+                break;
+
             default:
 
                 break;
@@ -1005,6 +1060,15 @@ SrvRequestCreateOplocks_SMB_V2(
 
     pCreateState = (PSRV_CREATE_STATE_SMB_V2)pCtxSmb2->hState;
 
+    if (pCreateState->pLeaseContext &&
+        !(pCreateState->pNetworkOpenInfo->FileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        ntStatus = SrvRequestCreateLease_SMB_V2(pExecContext);
+        BAIL_ON_NT_STATUS(ntStatus);
+
+        goto cleanup;
+    }
+
     if (SrvTree2IsNamedPipe(pCreateState->pTree) ||
         (pCreateState->pNetworkOpenInfo->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) ||
         ((pCreateState->pRequestHeader->ucOplockLevel != SMB2_OPLOCK_LEVEL_I) &&
@@ -1125,6 +1189,173 @@ error:
     goto cleanup;
 }
 
+/**
+ * Ask for the requested lease state, settling for less while read
+ * caching is still on offer.  Every open under the same lease key is
+ * granted the union of what the lease already holds and what this
+ * open asked for.
+ **/
+
+static
+NTSTATUS
+SrvRequestCreateLease_SMB_V2(
+    PSRV_EXEC_CONTEXT pExecContext
+    )
+{
+    NTSTATUS                   ntStatus      = STATUS_SUCCESS;
+    PSRV_PROTOCOL_EXEC_CONTEXT pCtxProtocol  = pExecContext->pProtocolContext;
+    PSRV_EXEC_CONTEXT_SMB_V2   pCtxSmb2      = pCtxProtocol->pSmb2Context;
+    PSRV_CREATE_STATE_SMB_V2   pCreateState  = NULL;
+    PSRV_OPLOCK_STATE_SMB_V2   pOplockState  = NULL;
+    PSRV_LEASE_SMB_V2          pLease        = NULL;
+    PSMB2_LEASE_CREATE_CONTEXT pLeaseRequest = NULL; // Do not free
+    ULONG                      ulLeaseState  = SMB2_LEASE_NONE;
+    BOOLEAN                    bInLock       = FALSE;
+    BOOLEAN                    bContinue     = TRUE;
+
+    pCreateState  = (PSRV_CREATE_STATE_SMB_V2)pCtxSmb2->hState;
+    pLeaseRequest = (PSMB2_LEASE_CREATE_CONTEXT)pCreateState->pLeaseContext->pData;
+
+    ntStatus = SrvLeaseFind_SMB_V2(&pCreateState->leaseKey, TRUE, &pLease);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    ntStatus = SrvLeaseBindFile_SMB_V2(pLease, &pCreateState->pFilename->Name);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    LWIO_LOCK_MUTEX(bInLock, &pLease->mutex);
+    ulLeaseState = (pLeaseRequest->ulLeaseState | pLease->ulLeaseState) &
+                   (SMB2_LEASE_READ_CACHING |
+                    SMB2_LEASE_HANDLE_CACHING |
+                    SMB2_LEASE_WRITE_CACHING);
+    LWIO_UNLOCK_MUTEX(bInLock, &pLease->mutex);
+
+    if (!(ulLeaseState & SMB2_LEASE_READ_CACHING))
+    {
+        ulLeaseState = SMB2_LEASE_NONE;
+
+        goto done;
+    }
+
+    ntStatus = SrvBuildOplockState_SMB_V2(
+                    pExecContext->pConnection,
+                    pCtxSmb2->pSession,
+                    pCtxSmb2->pTree,
+                    pCreateState->pFile,
+                    &pOplockState);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    while (bContinue && (ulLeaseState & SMB2_LEASE_READ_CACHING))
+    {
+        pOplockState->oplockBuffer_in.OplockRequestType =
+                        IO_OPLOCK_REQUEST_LEASE;
+        pOplockState->oplockBuffer_in.LeaseState = ulLeaseState;
+
+        SrvPrepareOplockStateAsync_SMB_V2(pOplockState);
+
+        ntStatus = IoFsControlFile(
+                        pCreateState->pFile->hFile,
+                        pOplockState->pAcb,
+                        &pOplockState->ioStatusBlock,
+                        IO_FSCTL_OPLOCK_REQUEST,
+                        &pOplockState->oplockBuffer_in,
+                        sizeof(pOplockState->oplockBuffer_in),
+                        &pOplockState->oplockBuffer_out,
+                        sizeof(pOplockState->oplockBuffer_out));
+        switch (ntStatus)
+        {
+            case STATUS_OPLOCK_NOT_GRANTED:
+
+                SrvReleaseOplockStateAsync_SMB_V2(pOplockState); // completed sync
+
+                /* RWH -> RH -> R, RW -> R */
+
+                if (ulLeaseState & SMB2_LEASE_WRITE_CACHING)
+                {
+                    ulLeaseState &= ~SMB2_LEASE_WRITE_CACHING;
+                }
+                else if (ulLeaseState & SMB2_LEASE_HANDLE_CACHING)
+                {
+                    ulLeaseState &= ~SMB2_LEASE_HANDLE_CACHING;
+                }
+                else
+                {
+                    ulLeaseState = SMB2_LEASE_NONE;
+                }
+
+                break;
+
+            case STATUS_PENDING:
+
+                pOplockState->ulLeaseState = ulLeaseState;
+
+                SrvLeaseAddOplockState_SMB_V2(pLease, pOplockState);
+
+                InterlockedIncrement(&pOplockState->refCount);
+
+                ntStatus = SrvFile2SetOplockState(
+                               pCreateState->pFile,
+                               pOplockState,
+                               &SrvCancelOplockStateHandle_SMB_V2,
+                               &SrvReleaseOplockStateHandle_SMB_V2);
+                if (ntStatus != STATUS_SUCCESS)
+                {
+                    InterlockedDecrement(&pOplockState->refCount);
+                }
+                BAIL_ON_NT_STATUS(ntStatus);
+
+                SrvFile2SetOplockLevel(
+                        pCreateState->pFile,
+                        SMB_OPLOCK_LEVEL_LEASE);
+
+                LWIO_LOCK_MUTEX(bInLock, &pLease->mutex);
+                if (!pLease->bBreakInProgress)
+                {
+                    pLease->ulLeaseState = ulLeaseState;
+                }
+                LWIO_UNLOCK_MUTEX(bInLock, &pLease->mutex);
+
+                ntStatus = STATUS_SUCCESS;
+
+                bContinue = FALSE;
+
+                break;
+
+            default:
+
+                SrvReleaseOplockStateAsync_SMB_V2(pOplockState); // completed sync
+
+                BAIL_ON_NT_STATUS(ntStatus);
+
+                break;
+        }
+    }
+
+done:
+
+    pCreateState->ulLeaseState  = ulLeaseState;
+    pCreateState->ucOplockLevel = SMB_OPLOCK_LEVEL_LEASE;
+
+cleanup:
+
+    LWIO_UNLOCK_MUTEX(bInLock, &pLease->mutex);
+
+    if (pOplockState)
+    {
+        SrvReleaseOplockState_SMB_V2(pOplockState);
+    }
+
+    if (pLease)
+    {
+        SrvLeaseRelease_SMB_V2(pLease);
+    }
+
+    return ntStatus;
+
+error:
+
+    goto cleanup;
+}
+
 static
 VOID
 SrvPrepareCreateStateAsync_SMB_V2(
@@ -1388,6 +1619,12 @@ SrvBuildCreateResponse_SMB_V2(
 
             break;
 
+        case SMB_OPLOCK_LEVEL_LEASE:
+
+            pResponseHeader->ucOplockLevel = SMB2_OPLOCK_LEVEL_LEASE;
+
+            break;
+
         default:
 
             pResponseHeader->ucOplockLevel = SMB2_OPLOCK_LEVEL_NONE;
@@ -1448,6 +1685,35 @@ SrvBuildCreateResponse_SMB_V2(
 
                 break;
 
+            case SMB2_CONTEXT_ITEM_TYPE_LEASE:
+
+                if ((pCreateContextRequest == pCreateState->pLeaseContext) &&
+                    (pCreateState->ucOplockLevel == SMB_OPLOCK_LEVEL_LEASE))
+                {
+                    CHAR szName[] = SMB2_CONTEXT_NAME_LEASE;
+                    SMB2_LEASE_CREATE_CONTEXT leaseCC = {{0}};
+
+                    memcpy(leaseCC.leaseKey,
+                           pCreateState->leaseKey.LeaseKey,
+                           sizeof(leaseCC.leaseKey));
+                    leaseCC.ulLeaseState = pCreateState->ulLeaseState;
+
+                    ntStatus = SrvWriteCreateContext(
+                                    pOutBuffer,
+                                    ulOffset,
+                                    ulBytesAvailable,
+                                    (PBYTE)&szName[0],
+                                    strlen(szName),
+                                    (PBYTE)&leaseCC,
+                                    sizeof(leaseCC),
+                                    &ulAlignBytesUsed,
+                                    &ulCCBytesUsed,
+                                    &pCurCreateContext);
+                    BAIL_ON_NT_STATUS(ntStatus);
+                }
+
+                break;
+
             case SMB2_CONTEXT_ITEM_TYPE_DURABLE_HANDLE:
             case SMB2_CONTEXT_ITEM_TYPE_QUERY_DISK_ID:
             case SMB2_CONTEXT_ITEM_TYPE_EXT_ATTRS:
@@ -91,10 +91,12 @@
 #define SMB2_OPLOCK_LEVEL_I     0x08
 #define SMB2_OPLOCK_LEVEL_II    0x01
 #define SMB2_OPLOCK_LEVEL_NONE  0x00
+#define SMB2_OPLOCK_LEVEL_LEASE 0xFF
 
 typedef USHORT LW_SMB2_OPLOCK_ACTION;
 
-#define LW_SMB2_OPLOCK_ACTION_SEND_BREAK  0x0001
-#define LW_SMB2_OPLOCK_ACTION_PROCESS_ACK 0x0002
+#define LW_SMB2_OPLOCK_ACTION_SEND_BREAK       0x0001
+#define LW_SMB2_OPLOCK_ACTION_PROCESS_ACK      0x0002
+#define LW_SMB2_OPLOCK_ACTION_SEND_LEASE_BREAK 0x0003
 
 #endif /* __DEFS_H__ */
@@ -0,0 +1,858 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; tab-width: 4 -*-
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * Editor Settings: expandtabs and use 4 spaces for indentation */
+
+/*
+ * Copyright Likewise Software
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        lease.c
+ *
+ * Abstract:
+ *
+ *        Likewise IO (LWIO) - SRV
+ *
+ *        Protocols API - SMBV2
+ *
+ *        SMB 2.1 Leases
+ *
+ *        A lease is identified by the client GUID and the lease key the
+ *        client sends in the create context.  Every handle opened with
+ *        the same key shares the lease state, so the client gets one
+ *        break notification (and sends one acknowledgement) per lease
+ *        rather than one per handle.  The file system tracks each
+ *        handle separately; this table ties the handles back together.
+ *
+ */
+
+#include "includes.h"
+
+static
+int
+SrvLeaseCompare_SMB_V2(
+    PVOID pKey1,
+    PVOID pKey2
+    );
+
+static
+VOID
+SrvLeaseFree_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease
+    );
+
+static
+VOID
+SrvLeaseCancelTimer_SMB_V2(
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    );
+
+static
+NTSTATUS
+SrvLeaseCompleteBreak_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease,
+    ULONG             ulLeaseState,
+    BOOLEAN           bExpired
+    );
+
+static
+NTSTATUS
+SrvBuildLeaseBreakResponse_SMB_V2(
+    PSRV_EXEC_CONTEXT pExecContext,
+    PSRV_LEASE_SMB_V2 pLease,
+    ULONG             ulLeaseState
+    );
+
+NTSTATUS
+SrvLeaseInit_SMB_V2(
+    VOID
+    )
+{
+    return LwRtlRBTreeCreate(
+                &SrvLeaseCompare_SMB_V2,
+                NULL,
+                NULL,
+                &gProtocolGlobals_SMB_V2.pLeaseCollection);
+}
+
+VOID
+SrvLeaseShutdown_SMB_V2(
+    VOID
+    )
+{
+    if (gProtocolGlobals_SMB_V2.pLeaseCollection)
+    {
+        LwRtlRBTreeFree(gProtocolGlobals_SMB_V2.pLeaseCollection);
+        gProtocolGlobals_SMB_V2.pLeaseCollection = NULL;
+    }
+}
+
+NTSTATUS
+SrvLeaseFind_SMB_V2(
+    PSRV_ECP_LEASE_KEY pKey,
+    BOOLEAN            bCreate,
+    PSRV_LEASE_SMB_V2* ppLease
+    )
+{
+    NTSTATUS          ntStatus = STATUS_SUCCESS;
+    BOOLEAN           bInLock  = FALSE;
+    PSRV_LEASE_SMB_V2 pLease   = NULL;
+
+    LWIO_LOCK_MUTEX(bInLock, gProtocolGlobals_SMB_V2.pMutex);
+
+    ntStatus = LwRtlRBTreeFind(
+                    gProtocolGlobals_SMB_V2.pLeaseCollection,
+                    pKey,
+                    (PVOID*)&pLease);
+    if ((ntStatus == STATUS_NOT_FOUND) && bCreate)
+    {
+        ntStatus = SrvAllocateMemory(
+                        sizeof(SRV_LEASE_SMB_V2),
+                        (PVOID*)&pLease);
+        BAIL_ON_NT_STATUS(ntStatus);
+
+        pLease->refCount = 0;
+
+        pthread_mutex_init(&pLease->mutex, NULL);
+        pLease->pMutex = &pLease->mutex;
+
+        pLease->key = *pKey;
+
+        LwListInit(&pLease->oplockStateList);
+
+        ntStatus = LwRtlRBTreeAdd(
+                        gProtocolGlobals_SMB_V2.pLeaseCollection,
+                        &pLease->key,
+                        pLease);
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    InterlockedIncrement(&pLease->refCount);
+
+    *ppLease = pLease;
+
+cleanup:
+
+    LWIO_UNLOCK_MUTEX(bInLock, gProtocolGlobals_SMB_V2.pMutex);
+
+    return ntStatus;
+
+error:
+
+    *ppLease = NULL;
+
+    if (pLease && !pLease->refCount)
+    {
+        SrvLeaseFree_SMB_V2(pLease);
+    }
+
+    goto cleanup;
+}
+
+PSRV_LEASE_SMB_V2
+SrvLeaseAcquire_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease
+    )
+{
+    InterlockedIncrement(&pLease->refCount);
+
+    return pLease;
+}
+
+VOID
+SrvLeaseRelease_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease
+    )
+{
+    BOOLEAN bInLock = FALSE;
+
+    /* Lookups take their reference under the table lock, so the last
+       reference has to be dropped under it too */
+
+    LWIO_LOCK_MUTEX(bInLock, gProtocolGlobals_SMB_V2.pMutex);
+
+    if (InterlockedDecrement(&pLease->refCount) == 0)
+    {
+        LwRtlRBTreeRemove(
+                gProtocolGlobals_SMB_V2.pLeaseCollection,
+                &pLease->key);
+
+        LWIO_UNLOCK_MUTEX(bInLock, gProtocolGlobals_SMB_V2.pMutex);
+
+        SrvLeaseFree_SMB_V2(pLease);
+    }
+
+    LWIO_UNLOCK_MUTEX(bInLock, gProtocolGlobals_SMB_V2.pMutex);
+}
+
+/**
+ * Refuse to open a file under a lease key which is held on another
+ * file (MS-SMB2 3.3.5.9.8).  Called before the file is opened so that
+ * a refused create has no side effects.
+ **/
+
+NTSTATUS
+SrvLeaseCheckFile_SMB_V2(
+    PSRV_ECP_LEASE_KEY pKey,
+    PUNICODE_STRING    pFileName
+    )
+{
+    NTSTATUS          ntStatus = STATUS_SUCCESS;
+    BOOLEAN           bInLock  = FALSE;
+    PSRV_LEASE_SMB_V2 pLease   = NULL;
+
+    ntStatus = SrvLeaseFind_SMB_V2(pKey, FALSE, &pLease);
+    if (ntStatus == STATUS_NOT_FOUND)
+    {
+        ntStatus = STATUS_SUCCESS;
+        goto cleanup;
+    }
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    LWIO_LOCK_MUTEX(bInLock, &pLease->mutex);
+
+    if (pLease->fileName.Buffer &&
+        !LwRtlUnicodeStringIsEqual(&pLease->fileName, pFileName, FALSE))
+    {
+        ntStatus = STATUS_INVALID_PARAMETER;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+cleanup:
+
+    if (pLease)
+    {
+        LWIO_UNLOCK_MUTEX(bInLock, &pLease->mutex);
+
+        SrvLeaseRelease_SMB_V2(pLease);
+    }
+
+    return ntStatus;
+
+error:
+
+    goto cleanup;
+}
+
+/**
+ * Tie the lease to the file an open is being granted it on.  A
+ * concurrent create may have tied it to another file after this one
+ * passed SrvLeaseCheckFile_SMB_V2; the open then gets no lease.
+ **/
+
+NTSTATUS
+SrvLeaseBindFile_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease,
+    PUNICODE_STRING   pFileName
+    )
+{
+    NTSTATUS ntStatus = STATUS_SUCCESS;
+    BOOLEAN  bInLock  = FALSE;
+
+    LWIO_LOCK_MUTEX(bInLock, &pLease->mutex);
+
+    if (!pLease->fileName.Buffer)
+    {
+        ntStatus = SrvAllocateUnicodeString(pFileName, &pLease->fileName);
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+    else if (!LwRtlUnicodeStringIsEqual(&pLease->fileName, pFileName, FALSE))
+    {
+        ntStatus = STATUS_INVALID_PARAMETER;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+cleanup:
+
+    LWIO_UNLOCK_MUTEX(bInLock, &pLease->mutex);
+
+    return ntStatus;
+
+error:
+
+    goto cleanup;
+}
+
+VOID
+SrvLeaseAddOplockState_SMB_V2(
+    PSRV_LEASE_SMB_V2        pLease,
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    )
+{
+    BOOLEAN bInLock = FALSE;
+
+    pOplockState->pLease = SrvLeaseAcquire_SMB_V2(pLease);
+
+    LWIO_LOCK_MUTEX(bInLock, &pLease->mutex);
+    LwListInsertTail(&pLease->oplockStateList, &pOplockState->leaseLinks);
+    LWIO_UNLOCK_MUTEX(bInLock, &pLease->mutex);
+}
+
+VOID
+SrvLeaseRemoveOplockState_SMB_V2(
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    )
+{
+    PSRV_LEASE_SMB_V2 pLease  = pOplockState->pLease;
+    BOOLEAN           bInLock = FALSE;
+
+    if (pLease)
+    {
+        LWIO_LOCK_MUTEX(bInLock, &pLease->mutex);
+        LwListRemove(&pOplockState->leaseLinks);
+        LWIO_UNLOCK_MUTEX(bInLock, &pLease->mutex);
+
+        pOplockState->pLease = NULL;
+
+        SrvLeaseRelease_SMB_V2(pLease);
+    }
+}
+
+NTSTATUS
+SrvLeaseAcknowledgeBreak_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease,
+    ULONG             ulLeaseState
+    )
+{
+    return SrvLeaseCompleteBreak_SMB_V2(pLease, ulLeaseState, FALSE);
+}
+
+NTSTATUS
+SrvLeaseExpireBreak_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease
+    )
+{
+    return SrvLeaseCompleteBreak_SMB_V2(pLease, 0, TRUE);
+}
+
+/**
+ * Complete an outstanding lease break.  Every handle on the lease that
+ * is waiting for the client has its file system break acknowledged
+ * with the new lease state.  When the break timed out the client is
+ * assumed to have accepted the state it was offered.
+ *
+ * The acknowledgement is checked against what the notification
+ * offered.  If another handle broke after it went out, the client may
+ * legitimately keep more than the lease can now allow; the break then
+ * stays open and a second notification asks the client to drop the
+ * rest, as MS-SMB2 3.3.4.7 describes.
+ **/
+
+static
+NTSTATUS
+SrvLeaseCompleteBreak_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease,
+    ULONG             ulLeaseState,
+    BOOLEAN           bExpired
+    )
+{
+    NTSTATUS                  ntStatus       = STATUS_SUCCESS;
+    NTSTATUS                  ntStatus1      = STATUS_SUCCESS;
+    BOOLEAN                   bInLock        = FALSE;
+    PLW_LIST_LINKS            pLink          = NULL;
+    PSRV_OPLOCK_STATE_SMB_V2* ppOplockStates = NULL;
+    PSRV_OPLOCK_STATE_SMB_V2  pCarrierState  = NULL;
+    ULONG                     ulNumStates    = 0;
+    ULONG                     iState         = 0;
+    BOOLEAN                   bFollowUp      = FALSE;
+
+    LWIO_LOCK_MUTEX(bInLock, &pLease->mutex);
+
+    if (!pLease->bBreakInProgress)
+    {
+        /* A late timer is harmless; the client already answered */
+        ntStatus = bExpired ? STATUS_SUCCESS : STATUS_UNSUCCESSFUL;
+        goto cleanup;
+    }
+
+    if (bExpired)
+    {
+        ulLeaseState = pLease->ulBreakToState;
+    }
+    else if (ulLeaseState & ~pLease->ulNotifiedState)
+    {
+        ntStatus = STATUS_REQUEST_NOT_ACCEPTED;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    bFollowUp = (ulLeaseState & ~pLease->ulBreakToState) != 0;
+
+    pLease->ulLeaseState = ulLeaseState;
+
+    if (bFollowUp)
+    {
+        /* Nothing is on offer until the second notification goes out */
+        pLease->ulNotifiedState = 0;
+    }
+    else
+    {
+        pLease->bBreakInProgress = FALSE;
+    }
+
+    for (pLink = pLease->oplockStateList.Next;
+         pLink != &pLease->oplockStateList;
+         pLink = pLink->Next)
+    {
+        ulNumStates++;
+    }
+
+    if (ulNumStates)
+    {
+        ntStatus = SrvAllocateMemory(
+                        sizeof(PSRV_OPLOCK_STATE_SMB_V2) * ulNumStates,
+                        (PVOID*)&ppOplockStates);
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    ulNumStates = 0;
+
+    for (pLink = pLease->oplockStateList.Next;
+         pLink != &pLease->oplockStateList;
+         pLink = pLink->Next)
+    {
+        PSRV_OPLOCK_STATE_SMB_V2 pOplockState =
+            LW_STRUCT_FROM_FIELD(pLink, SRV_OPLOCK_STATE_SMB_V2, leaseLinks);
+
+        if (!pOplockState->bBreakRequestSent)
+        {
+            continue;
+        }
+
+        /* The list does not hold a reference; skip anything that is
+           already on its way to being freed */
+
+        if (InterlockedIncrement(&pOplockState->refCount) == 1)
+        {
+            InterlockedDecrement(&pOplockState->refCount);
+            continue;
+        }
+
+        ppOplockStates[ulNumStates++] = pOplockState;
+    }
+
+    /* Any handle on the lease will do to send the second break from */
+
+    for (pLink = pLease->oplockStateList.Next;
+         bFollowUp && !pCarrierState && pLink != &pLease->oplockStateList;
+         pLink = pLink->Next)
+    {
+        PSRV_OPLOCK_STATE_SMB_V2 pOplockState =
+            LW_STRUCT_FROM_FIELD(pLink, SRV_OPLOCK_STATE_SMB_V2, leaseLinks);
+
+        if (InterlockedIncrement(&pOplockState->refCount) == 1)
+        {
+            InterlockedDecrement(&pOplockState->refCount);
+            continue;
+        }
+
+        pCarrierState = pOplockState;
+    }
+
+    LWIO_UNLOCK_MUTEX(bInLock, &pLease->mutex);
+
+    for (iState = 0; iState < ulNumStates; iState++)
+    {
+        PSRV_OPLOCK_STATE_SMB_V2 pOplockState = ppOplockStates[iState];
+
+        SrvLeaseCancelTimer_SMB_V2(pOplockState);
+
+        if (bFollowUp)
+        {
+            /* Give the client the full timeout to answer the second
+               break before these handles are broken without it */
+            ntStatus1 = SrvPostOplockBreakTimer_SMB_V2(pOplockState);
+        }
+        else
+        {
+            pOplockState->ulLeaseState = ulLeaseState;
+
+            ntStatus1 = SrvAcknowledgeOplockBreak_SMB_V2(pOplockState, NULL, FALSE);
+        }
+        if (ntStatus1 && !ntStatus)
+        {
+            ntStatus = ntStatus1;
+        }
+
+        SrvReleaseOplockState_SMB_V2(pOplockState);
+    }
+
+    if (bFollowUp)
+    {
+        if (pCarrierState)
+        {
+            ntStatus1 = SrvEnqueueLeaseBreakTask_SMB_V2(pCarrierState);
+        }
+        else
+        {
+            /* No handle left to reach the client through */
+            ntStatus1 = SrvLeaseCompleteBreak_SMB_V2(pLease, 0, TRUE);
+        }
+        if (ntStatus1 && !ntStatus)
+        {
+            ntStatus = ntStatus1;
+        }
+    }
+
+cleanup:
+
+    LWIO_UNLOCK_MUTEX(bInLock, &pLease->mutex);
+
+    if (pCarrierState)
+    {
+        SrvReleaseOplockState_SMB_V2(pCarrierState);
+    }
+
+    SRV_SAFE_FREE_MEMORY(ppOplockStates);
+
+    return ntStatus;
+
+error:
+
+    goto cleanup;
+}
+
+NTSTATUS
+SrvProcessLeaseBreak_SMB_V2(
+    PSRV_EXEC_CONTEXT pExecContext
+    )
+{
+    NTSTATUS                   ntStatus       = STATUS_SUCCESS;
+    PLWIO_SRV_CONNECTION       pConnection    = pExecContext->pConnection;
+    PSRV_PROTOCOL_EXEC_CONTEXT pCtxProtocol   = pExecContext->pProtocolContext;
+    PSRV_EXEC_CONTEXT_SMB_V2   pCtxSmb2       = pCtxProtocol->pSmb2Context;
+    ULONG                      iMsg           = pCtxSmb2->iMsg;
+    PSRV_MESSAGE_SMB_V2        pSmbRequest    = &pCtxSmb2->pRequests[iMsg];
+    PSMB2_LEASE_BREAK_HEADER   pRequestHeader = NULL; // Do not free
+    PLWIO_SRV_SESSION_2        pSession       = NULL;
+    PSRV_LEASE_SMB_V2          pLease         = NULL;
+    SRV_ECP_LEASE_KEY          leaseKey       = {{0}};
+
+    ntStatus = SrvConnection2FindSession_SMB_V2(
+                            pCtxSmb2,
+                            pConnection,
+                            pSmbRequest->pHeader->ullSessionId,
+                            &pSession);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    ntStatus = SMB2UnmarshalLeaseBreakRequest(pSmbRequest, &pRequestHeader);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    memcpy(leaseKey.ClientGuid,
+           pConnection->clientProperties.ClientGUID,
+           sizeof(leaseKey.ClientGuid));
+    memcpy(leaseKey.LeaseKey,
+           pRequestHeader->leaseKey,
+           sizeof(leaseKey.LeaseKey));
+
+    ntStatus = SrvLeaseFind_SMB_V2(&leaseKey, FALSE, &pLease);
+    if (ntStatus == STATUS_NOT_FOUND)
+    {
+        ntStatus = STATUS_OBJECT_NAME_NOT_FOUND;
+    }
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    ntStatus = SrvLeaseAcknowledgeBreak_SMB_V2(
+                    pLease,
+                    pRequestHeader->ulLeaseState);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    ntStatus = SrvBuildLeaseBreakResponse_SMB_V2(
+                    pExecContext,
+                    pLease,
+                    pRequestHeader->ulLeaseState);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+cleanup:
+
+    if (pLease)
+    {
+        SrvLeaseRelease_SMB_V2(pLease);
+    }
+
+    if (pSession)
+    {
+        SrvSession2Release(pSession);
+    }
+
+    return ntStatus;
+
+error:
+
+    goto cleanup;
+}
+
+NTSTATUS
+SrvBuildLeaseBreakNotification_SMB_V2(
+    PSRV_EXEC_CONTEXT pExecContext,
+    PSRV_LEASE_SMB_V2 pLease,
+    USHORT            usEpoch,
+    ULONG             ulCurrentLeaseState,
+    ULONG             ulNewLeaseState,
+    ULONG             ulFlags
+    )
+{
+    NTSTATUS                   ntStatus      = STATUS_SUCCESS;
+    PSRV_PROTOCOL_EXEC_CONTEXT pCtxProtocol  = pExecContext->pProtocolContext;
+    PSRV_EXEC_CONTEXT_SMB_V2   pCtxSmb2      = pCtxProtocol->pSmb2Context;
+    ULONG                      iMsg          = pCtxSmb2->iMsg;
+    PSRV_MESSAGE_SMB_V2        pSmbRequest   = &pCtxSmb2->pRequests[iMsg];
+    PSRV_MESSAGE_SMB_V2        pSmbResponse  = &pCtxSmb2->pResponses[iMsg];
+    PSMB2_LEASE_BREAK_NOTIFICATION_HEADER pNotifyHeader = NULL; // Do not free
+    PBYTE pOutBuffer       = pSmbResponse->pBuffer;
+    ULONG ulBytesAvailable = pSmbResponse->ulBytesAvailable;
+    ULONG ulOffset         = 0;
+    ULONG ulTotalBytesUsed = 0;
+
+    ntStatus = SMB2MarshalHeader(
+                        pOutBuffer,
+                        ulOffset,
+                        ulBytesAvailable,
+                        COM2_BREAK,
+                        pSmbRequest->pHeader->usEpoch,
+                        0,  /* Credits     */
+                        0L, /* Process Id  */
+                        pSmbRequest->pHeader->ullCommandSequence,
+                        0L,  /* Tree Id    */
+                        0LL, /* Session Id */
+                        0LL, /* Async Id   */
+                        STATUS_SUCCESS,
+                        TRUE,
+                        LwIsSetFlag(
+                            pSmbRequest->pHeader->ulFlags,
+                            SMB2_FLAGS_RELATED_OPERATION),
+                        &pSmbResponse->pHeader,
+                        &pSmbResponse->ulHeaderSize);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    pOutBuffer       += pSmbResponse->ulHeaderSize;
+    ulOffset         += pSmbResponse->ulHeaderSize;
+    ulBytesAvailable -= pSmbResponse->ulHeaderSize;
+    ulTotalBytesUsed += pSmbResponse->ulHeaderSize;
+
+    if (ulBytesAvailable < sizeof(SMB2_LEASE_BREAK_NOTIFICATION_HEADER))
+    {
+        ntStatus = STATUS_INVALID_NETWORK_RESPONSE;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    pNotifyHeader = (PSMB2_LEASE_BREAK_NOTIFICATION_HEADER)pOutBuffer;
+
+    pNotifyHeader->usLength = sizeof(SMB2_LEASE_BREAK_NOTIFICATION_HEADER);
+    /* Reserved in SMB 2.1 */
+    pNotifyHeader->usEpoch  = 0;
+    pNotifyHeader->ulFlags  = ulFlags;
+    memcpy(pNotifyHeader->leaseKey,
+           pLease->key.LeaseKey,
+           sizeof(pNotifyHeader->leaseKey));
+    pNotifyHeader->ulCurrentLeaseState = ulCurrentLeaseState;
+    pNotifyHeader->ulNewLeaseState     = ulNewLeaseState;
+    pNotifyHeader->ulBreakReason       = 0;
+    pNotifyHeader->ulAccessMaskHint    = 0;
+    pNotifyHeader->ulShareMaskHint     = 0;
+
+    ulBytesAvailable -= sizeof(SMB2_LEASE_BREAK_NOTIFICATION_HEADER);
+    ulTotalBytesUsed += sizeof(SMB2_LEASE_BREAK_NOTIFICATION_HEADER);
+
+    pSmbResponse->ulMessageSize = ulTotalBytesUsed;
+
+    LWIO_LOG_DEBUG(
+        "Lease break [epoch:%u][state:0x%x -> 0x%x][flags:0x%x]",
+        usEpoch,
+        ulCurrentLeaseState,
+        ulNewLeaseState,
+        ulFlags);
+
+cleanup:
+
+    return ntStatus;
+
+error:
+
+    if (ulTotalBytesUsed)
+    {
+        pSmbResponse->pHeader      = NULL;
+        pSmbResponse->ulHeaderSize = 0;
+        memset(pSmbResponse->pBuffer, 0, ulTotalBytesUsed);
+    }
+
+    pSmbResponse->ulMessageSize = 0;
+
+    goto cleanup;
+}
+
+static
+NTSTATUS
+SrvBuildLeaseBreakResponse_SMB_V2(
+    PSRV_EXEC_CONTEXT pExecContext,
+    PSRV_LEASE_SMB_V2 pLease,
+    ULONG             ulLeaseState
+    )
+{
+    NTSTATUS                   ntStatus      = STATUS_SUCCESS;
+    PSRV_PROTOCOL_EXEC_CONTEXT pCtxProtocol  = pExecContext->pProtocolContext;
+    PSRV_EXEC_CONTEXT_SMB_V2   pCtxSmb2      = pCtxProtocol->pSmb2Context;
+    ULONG                      iMsg          = pCtxSmb2->iMsg;
+    PSRV_MESSAGE_SMB_V2        pSmbRequest   = &pCtxSmb2->pRequests[iMsg];
+    PSRV_MESSAGE_SMB_V2        pSmbResponse  = &pCtxSmb2->pResponses[iMsg];
+    PSMB2_LEASE_BREAK_HEADER   pLeaseBreakHeader = NULL; // Do not free
+    PBYTE pOutBuffer       = pSmbResponse->pBuffer;
+    ULONG ulBytesAvailable = pSmbResponse->ulBytesAvailable;
+    ULONG ulOffset         = 0;
+    ULONG ulTotalBytesUsed = 0;
+
+    ntStatus = SrvCreditorAdjustCredits(
+                    pExecContext->pConnection->pCreditor,
+                    pSmbRequest->pHeader->ullCommandSequence,
+                    pExecContext->ullAsyncId,
+                    pSmbRequest->pHeader->usCredits,
+                    &pExecContext->usCreditsGranted);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    ntStatus = SMB2MarshalHeader(
+                        pOutBuffer,
+                        ulOffset,
+                        ulBytesAvailable,
+                        COM2_BREAK,
+                        pSmbRequest->pHeader->usEpoch,
+                        pExecContext->usCreditsGranted,
+                        pSmbRequest->pHeader->ulPid,
+                        pSmbRequest->pHeader->ullCommandSequence,
+                        pSmbRequest->pHeader->ulTid,
+                        pCtxSmb2->pSession->ullUid,
+                        0LL, /* Async Id */
+                        STATUS_SUCCESS,
+                        TRUE,
+                        LwIsSetFlag(
+                            pSmbRequest->pHeader->ulFlags,
+                            SMB2_FLAGS_RELATED_OPERATION),
+                        &pSmbResponse->pHeader,
+                        &pSmbResponse->ulHeaderSize);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    pOutBuffer       += pSmbResponse->ulHeaderSize;
+    ulOffset         += pSmbResponse->ulHeaderSize;
+    ulBytesAvailable -= pSmbResponse->ulHeaderSize;
+    ulTotalBytesUsed += pSmbResponse->ulHeaderSize;
+
+    if (ulBytesAvailable < sizeof(SMB2_LEASE_BREAK_HEADER))
+    {
+        ntStatus = STATUS_INVALID_NETWORK_RESPONSE;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    pLeaseBreakHeader = (PSMB2_LEASE_BREAK_HEADER)pOutBuffer;
+
+    pLeaseBreakHeader->usLength         = sizeof(SMB2_LEASE_BREAK_HEADER);
+    pLeaseBreakHeader->usReserved       = 0;
+    pLeaseBreakHeader->ulFlags          = 0;
+    memcpy(pLeaseBreakHeader->leaseKey,
+           pLease->key.LeaseKey,
+           sizeof(pLeaseBreakHeader->leaseKey));
+    pLeaseBreakHeader->ulLeaseState     = ulLeaseState;
+    pLeaseBreakHeader->ullLeaseDuration = 0LL;
+
+    ulBytesAvailable -= sizeof(SMB2_LEASE_BREAK_HEADER);
+    ulTotalBytesUsed += sizeof(SMB2_LEASE_BREAK_HEADER);
+
+    pSmbResponse->ulMessageSize = ulTotalBytesUsed;
+
+cleanup:
+
+    return ntStatus;
+
+error:
+
+    if (ulTotalBytesUsed)
+    {
+        pSmbResponse->pHeader      = NULL;
+        pSmbResponse->ulHeaderSize = 0;
+        memset(pSmbResponse->pBuffer, 0, ulTotalBytesUsed);
+    }
+
+    pSmbResponse->ulMessageSize = 0;
+
+    goto cleanup;
+}
+
+static
+VOID
+SrvLeaseCancelTimer_SMB_V2(
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    )
+{
+    BOOLEAN bInLock = FALSE;
+
+    LWIO_LOCK_MUTEX(bInLock, &pOplockState->mutex);
+
+    if (pOplockState->pTimerRequest)
+    {
+        PSRV_OPLOCK_STATE_SMB_V2 pOplockState2 = NULL;
+
+        SrvTimerCancelRequest(
+            pOplockState->pTimerRequest,
+            (PVOID*)&pOplockState2);
+
+        if (pOplockState2)
+        {
+            SrvReleaseOplockState_SMB_V2(pOplockState2);
+        }
+
+        SrvTimerRelease(pOplockState->pTimerRequest);
+        pOplockState->pTimerRequest = NULL;
+    }
+
+    LWIO_UNLOCK_MUTEX(bInLock, &pOplockState->mutex);
+}
+
+static
+int
+SrvLeaseCompare_SMB_V2(
+    PVOID pKey1,
+    PVOID pKey2
+    )
+{
+    return memcmp(pKey1, pKey2, sizeof(SRV_ECP_LEASE_KEY));
+}
+
+static
+VOID
+SrvLeaseFree_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease
+    )
+{
+    if (pLease->pMutex)
+    {
+        pthread_mutex_destroy(&pLease->mutex);
+    }
+
+    SRV_FREE_UNICODE_STRING(&pLease->fileName);
+
+    SrvFreeMemory(pLease);
+}
@@ -76,6 +76,9 @@ SrvProtocolInit_SMB_V2(
     status = SrvConfigSetupInitial_SMB_V2();
     BAIL_ON_NT_STATUS(status);
 
+    status = SrvLeaseInit_SMB_V2();
+    BAIL_ON_NT_STATUS(status);
+
 error:
 
     return status;
@@ -1129,6 +1132,8 @@ SrvProtocolShutdown_SMB_V2(
     VOID
     )
 {
+    SrvLeaseShutdown_SMB_V2();
+
     if (gProtocolGlobals_SMB_V2.pMutex)
     {
         pthread_mutex_destroy(&gProtocolGlobals_SMB_V2.mutex);
@@ -52,6 +52,7 @@ static
 NTSTATUS
 SrvMarshalNegotiateResponse_SMB_V2(
     PLWIO_SRV_CONNECTION pConnection,
+    USHORT               usDialect,
     PBYTE                pSessionKey,
     ULONG                ulSessionKeyLength,
     PSRV_MESSAGE_SMB_V2  pSmbResponse
@@ -72,6 +73,7 @@ SrvProcessNegotiate_SMB_V2(
     PSMB2_NEGOTIATE_REQUEST_HEADER pNegotiateRequestHeader = NULL;// Do not free
     PUSHORT pusDialects      = NULL; // Do not free
     USHORT  iDialect         = 0;
+    USHORT  usDialect        = 0;
 
     if (pExecContext->bInline)
     {
@@ -115,38 +117,47 @@ SrvProcessNegotiate_SMB_V2(
         BAIL_ON_NT_STATUS(ntStatus);
     }
 
+    /* Pick the highest dialect we support */
+
     for (; iDialect < pNegotiateRequestHeader->usDialectCount; iDialect++)
     {
-        USHORT usDialect = pusDialects[iDialect];
-
-        if (usDialect == 0x0202)
+        if ((pusDialects[iDialect] == SMB2_DIALECT_2_1) ||
+            ((pusDialects[iDialect] == SMB2_DIALECT_2_002) &&
+             (usDialect != SMB2_DIALECT_2_1)))
         {
-            SRV_LOG_DEBUG(
-                    pExecContext->pLogContext,
-                    SMB_PROTOCOL_VERSION_2,
-                    pSmbRequest->pHeader->command,
-                    "Negotiate dialect selected: ",
-                    "command(%u),uid(%llu),cmd-seq(%llu),pid(%u),tid(%u),"
-                    "credits(%u),flags(0x%x),chain-offset(%u),dialect(0x%x)",
-                    pSmbRequest->pHeader->command,
-                    (long long)pSmbRequest->pHeader->ullSessionId,
-                    (long long)pSmbRequest->pHeader->ullCommandSequence,
-                    pSmbRequest->pHeader->ulPid,
-                    pSmbRequest->pHeader->ulTid,
-                    pSmbRequest->pHeader->usCredits,
-                    pSmbRequest->pHeader->ulFlags,
-                    pSmbRequest->pHeader->ulChainOffset,
-                    usDialect);
-
-            break;
+            usDialect = pusDialects[iDialect];
         }
     }
 
-    if (iDialect < pNegotiateRequestHeader->usDialectCount)
+    if (usDialect)
     {
         PBYTE pNegHintsBlob = NULL; /* Do not free */
         ULONG ulNegHintsLength = 0;
 
+        SRV_LOG_DEBUG(
+                pExecContext->pLogContext,
+                SMB_PROTOCOL_VERSION_2,
+                pSmbRequest->pHeader->command,
+                "Negotiate dialect selected: ",
+                "command(%u),uid(%llu),cmd-seq(%llu),pid(%u),tid(%u),"
+                "credits(%u),flags(0x%x),chain-offset(%u),dialect(0x%x)",
+                pSmbRequest->pHeader->command,
+                (long long)pSmbRequest->pHeader->ullSessionId,
+                (long long)pSmbRequest->pHeader->ullCommandSequence,
+                pSmbRequest->pHeader->ulPid,
+                pSmbRequest->pHeader->ulTid,
+                pSmbRequest->pHeader->usCredits,
+                pSmbRequest->pHeader->ulFlags,
+                pSmbRequest->pHeader->ulChainOffset,
+                usDialect);
+
+        /* Leases are keyed by the client GUID */
+
+        pConnection->clientProperties.usDialect = usDialect;
+        memcpy(pConnection->clientProperties.ClientGUID,
+               pNegotiateRequestHeader->clientGUID,
+               sizeof(pConnection->clientProperties.ClientGUID));
+
         ntStatus = SrvGssNegHints(&pNegHintsBlob, &ulNegHintsLength);
 
         /* Microsoft clients ignore the security blob on the neg prot response
@@ -156,6 +167,7 @@ SrvProcessNegotiate_SMB_V2(
         {
             ntStatus = SrvMarshalNegotiateResponse_SMB_V2(
                             pConnection,
+                            usDialect,
                             pNegHintsBlob,
                             ulNegHintsLength,
                             pSmbResponse);
@@ -182,6 +194,7 @@ NTSTATUS
 SrvBuildNegotiateResponse_SMB_V2(
     IN  PLWIO_SRV_CONNECTION pConnection,
     IN  PSMB_PACKET          pSmbRequest,
+    IN  USHORT               usDialect,
     OUT PSMB_PACKET*         ppSmbResponse
     )
 {
@@ -222,6 +235,7 @@ SrvBuildNegotiateResponse_SMB_V2(
 
         ntStatus = SrvMarshalNegotiateResponse_SMB_V2(
                         pConnection,
+                        usDialect,
                         pNegHintsBlob,
                         ulNegHintsLength,
                         &response);
@@ -259,6 +273,7 @@ static
 NTSTATUS
 SrvMarshalNegotiateResponse_SMB_V2(
     PLWIO_SRV_CONNECTION pConnection,
+    USHORT               usDialect,
     PBYTE                pSessionKey,
     ULONG                ulSessionKeyLength,
     PSRV_MESSAGE_SMB_V2  pSmbResponse
@@ -322,7 +337,7 @@ SrvMarshalNegotiateResponse_SMB_V2(
     ulBytesAvailable -= sizeof(SMB2_NEGOTIATE_RESPONSE_HEADER);
     ulTotalBytesUsed += sizeof(SMB2_NEGOTIATE_RESPONSE_HEADER);
 
-    pNegotiateHeader->usDialect = 0x0202;
+    pNegotiateHeader->usDialect = usDialect;
 
     pNegotiateHeader->ucFlags = 0;
 
@@ -341,6 +356,11 @@ SrvMarshalNegotiateResponse_SMB_V2(
 
     pNegotiateHeader->ulCapabilities = 0;
 
+    if (usDialect == SMB2_DIALECT_2_1)
+    {
+        pNegotiateHeader->ulCapabilities |= SMB2_GLOBAL_CAP_LEASING;
+    }
+
     ntStatus = WireGetCurrentNTTime(&llCurTime);
     BAIL_ON_NT_STATUS(ntStatus);
 
@@ -65,6 +65,21 @@ SrvBuildOplockBreakResponse_SMB_V2(
     UCHAR                    ucOplockLevel
     );
 
+static
+NTSTATUS
+SrvSendLeaseBreak_SMB_V2(
+    PSRV_EXEC_CONTEXT        pExecContext,
+    PLWIO_SRV_FILE_2         pFile,
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    );
+
+static
+NTSTATUS
+SrvSendLeaseFollowUpBreak_SMB_V2(
+    PSRV_EXEC_CONTEXT        pExecContext,
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    );
+
 static
 VOID
 SrvOplockExpiredCB_SMB_V2(
@@ -211,6 +226,17 @@ SrvProcessOplock_SMB_V2(
                 BAIL_ON_NT_STATUS(ntStatus);
             }
 
+            if (pOplockState->pLease)
+            {
+                ntStatus = SrvSendLeaseBreak_SMB_V2(
+                                pExecContext,
+                                pFile,
+                                pOplockState);
+                BAIL_ON_NT_STATUS(ntStatus);
+
+                break;
+            }
+
             switch (pOplockState->oplockBuffer_out.OplockBreakResult)
             {
                 case IO_OPLOCK_BROKEN_TO_NONE:
@@ -245,30 +271,9 @@ SrvProcessOplock_SMB_V2(
             {
                 case SMB_OPLOCK_LEVEL_I:
                 case SMB_OPLOCK_LEVEL_BATCH:
-                    {
-                        LONG64 llExpiry = 0LL;
-
-                        ntStatus = WireGetCurrentNTTime(&llExpiry);
-                        BAIL_ON_NT_STATUS(ntStatus);
-
-                        /* configured timeout will be in milliseconds */
-                        llExpiry +=
-                            (SrvConfigGetOplockTimeout_SMB_V2() *
-                                WIRE_FACTOR_MILLISECS_TO_HUNDREDS_OF_NANOSECS);
-
-                        InterlockedIncrement(&pOplockState->refCount);
-
-                        ntStatus = SrvTimerPostRequest(
-                                        llExpiry,
-                                        pOplockState,
-                                        &SrvOplockExpiredCB_SMB_V2,
-                                        &pOplockState->pTimerRequest);
-                        if (ntStatus != STATUS_SUCCESS)
-                        {
-                            InterlockedDecrement(&pOplockState->refCount);
-                        }
-                        BAIL_ON_NT_STATUS(ntStatus);
-                    }
+
+                    ntStatus = SrvPostOplockBreakTimer_SMB_V2(pOplockState);
+                    BAIL_ON_NT_STATUS(ntStatus);
 
                     break;
 
@@ -301,6 +306,31 @@ SrvProcessOplock_SMB_V2(
 
             break;
 
+        case LW_SMB2_OPLOCK_ACTION_SEND_LEASE_BREAK:
+
+            LWIO_LOCK_RWMUTEX_SHARED(bFileLocked, &pFile->mutex);
+
+            pOplockState = (PSRV_OPLOCK_STATE_SMB_V2)pFile->hOplockState;
+            if (pOplockState)
+            {
+                InterlockedIncrement(&pOplockState->refCount);
+            }
+
+            LWIO_UNLOCK_RWMUTEX(bFileLocked, &pFile->mutex);
+
+            /* A handle closed since this was queued leaves the lease to
+               the break timers */
+
+            if (pOplockState && pOplockState->pLease)
+            {
+                ntStatus = SrvSendLeaseFollowUpBreak_SMB_V2(
+                                pExecContext,
+                                pOplockState);
+                BAIL_ON_NT_STATUS(ntStatus);
+            }
+
+            break;
+
         case LW_SMB2_OPLOCK_ACTION_PROCESS_ACK:
 
             LWIO_LOCK_RWMUTEX_SHARED(bFileLocked, &pFile->mutex);
@@ -313,7 +343,15 @@ SrvProcessOplock_SMB_V2(
             }
             LWIO_UNLOCK_RWMUTEX(bFileLocked, &pFile->mutex);
 
-            if (pOplockState)
+            if (pOplockState && pOplockState->pLease)
+            {
+                /* The client never answered; break every handle on
+                   the lease as though it had */
+
+                ntStatus = SrvLeaseExpireBreak_SMB_V2(pOplockState->pLease);
+                BAIL_ON_NT_STATUS(ntStatus);
+            }
+            else if (pOplockState)
             {
                 ntStatus = SrvAcknowledgeOplockBreak_SMB_V2(pOplockState,
                                                             NULL,
@@ -376,6 +414,11 @@ SrvProcessOplockBreak_SMB_V2(
     PSRV_OPLOCK_STATE_SMB_V2   pOplockState  = NULL;
     BOOLEAN                    bFileLocked   = FALSE;
 
+    if (SMB2IsLeaseBreakRequest(pSmbRequest))
+    {
+        return SrvProcessLeaseBreak_SMB_V2(pExecContext);
+    }
+
     ntStatus = SrvConnection2FindSession_SMB_V2(
                             pCtxSmb2,
                             pConnection,
@@ -568,6 +611,13 @@ SrvAcknowledgeOplockBreak_SMB_V2(
             break;
     }
 
+    if (pOplockState->pLease)
+    {
+        ucOplockLevel = SMB_OPLOCK_LEVEL_LEASE;
+
+        pOplockState->oplockBuffer_ack.LeaseState = pOplockState->ulLeaseState;
+    }
+
     if (bFileIsClosed)
     {
         pOplockState->oplockBuffer_ack.Response = IO_OPLOCK_BREAK_CLOSE_PENDING;
@@ -643,6 +693,222 @@ error:
     goto cleanup;
 }
 
+/**
+ * The file system breaks each handle separately, but the client sees a
+ * single lease.  The first handle to break sends the notification; any
+ * handle that held write or handle caching then waits for the client's
+ * lease break acknowledgement before its own break is acknowledged.
+ **/
+
+static
+NTSTATUS
+SrvSendLeaseBreak_SMB_V2(
+    PSRV_EXEC_CONTEXT        pExecContext,
+    PLWIO_SRV_FILE_2         pFile,
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    )
+{
+    NTSTATUS          ntStatus            = STATUS_SUCCESS;
+    PSRV_LEASE_SMB_V2 pLease              = pOplockState->pLease;
+    ULONG             ulNewLeaseState     = 0;
+    ULONG             ulCurrentLeaseState = 0;
+    USHORT            usEpoch             = 0;
+    BOOLEAN           bInLock             = FALSE;
+    BOOLEAN           bNotify             = FALSE;
+    BOOLEAN           bNotifyAckRequired  = FALSE;
+    BOOLEAN           bAckRequired        = FALSE;
+    BOOLEAN           bAckNow             = FALSE;
+
+    ulNewLeaseState = pOplockState->oplockBuffer_out.LeaseState;
+
+    bAckRequired = (pOplockState->ulLeaseState &
+                    (SMB2_LEASE_WRITE_CACHING|SMB2_LEASE_HANDLE_CACHING)) != 0;
+
+    LWIO_LOCK_MUTEX(bInLock, &pLease->mutex);
+
+    if (pLease->bBreakInProgress)
+    {
+        /* Fold this handle into the outstanding break.  The client was
+           offered ulNotifiedState; anything it keeps beyond the narrower
+           target is taken back with a second break once it answers */
+        pLease->ulBreakToState &= ulNewLeaseState;
+    }
+    else if (pLease->ulLeaseState & ~ulNewLeaseState)
+    {
+        bNotify             = TRUE;
+        ulCurrentLeaseState = pLease->ulLeaseState;
+        ulNewLeaseState    &= ulCurrentLeaseState;
+        usEpoch             = ++pLease->usEpoch;
+
+        if (ulCurrentLeaseState &
+            (SMB2_LEASE_WRITE_CACHING|SMB2_LEASE_HANDLE_CACHING))
+        {
+            bNotifyAckRequired       = TRUE;
+            pLease->bBreakInProgress = TRUE;
+            pLease->ulNotifiedState  = ulNewLeaseState;
+            pLease->ulBreakToState   = ulNewLeaseState;
+        }
+        else
+        {
+            pLease->ulLeaseState = ulNewLeaseState;
+        }
+    }
+    else
+    {
+        /* The client already gave up the state this handle is losing */
+        bAckNow = bAckRequired;
+    }
+
+    pOplockState->bBreakRequestSent = bAckRequired && !bAckNow;
+
+    LWIO_UNLOCK_MUTEX(bInLock, &pLease->mutex);
+
+    if (bNotify)
+    {
+        ntStatus = SrvBuildLeaseBreakNotification_SMB_V2(
+                        pExecContext,
+                        pLease,
+                        usEpoch,
+                        ulCurrentLeaseState,
+                        ulNewLeaseState,
+                        (bNotifyAckRequired ?
+                            SMB2_NOTIFY_BREAK_LEASE_FLAG_ACK_REQUIRED : 0));
+        BAIL_ON_NT_STATUS(ntStatus);
+
+        if (bNotifyAckRequired && pOplockState->bBreakRequestSent)
+        {
+            ntStatus = SrvPostOplockBreakTimer_SMB_V2(pOplockState);
+            BAIL_ON_NT_STATUS(ntStatus);
+        }
+    }
+
+    if (bAckNow)
+    {
+        pOplockState->ulLeaseState = ulNewLeaseState;
+
+        ntStatus = SrvAcknowledgeOplockBreak_SMB_V2(pOplockState, NULL, FALSE);
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+    else if (!bAckRequired)
+    {
+        /* Read caching breaks to none without an acknowledgement */
+
+        PSRV_OPLOCK_STATE_SMB_V2 pOplockState2 = NULL;
+
+        pOplockState2 =
+            (PSRV_OPLOCK_STATE_SMB_V2)SrvFile2RemoveOplockState(pFile);
+        if (pOplockState2)
+        {
+            SrvReleaseOplockState_SMB_V2(pOplockState2);
+        }
+    }
+
+error:
+
+    return ntStatus;
+}
+
+/**
+ * Take back what the client kept when it acknowledged a lease break
+ * whose target narrowed after the notification went out.
+ **/
+
+static
+NTSTATUS
+SrvSendLeaseFollowUpBreak_SMB_V2(
+    PSRV_EXEC_CONTEXT        pExecContext,
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    )
+{
+    NTSTATUS          ntStatus            = STATUS_SUCCESS;
+    PSRV_LEASE_SMB_V2 pLease              = pOplockState->pLease;
+    ULONG             ulNewLeaseState     = 0;
+    ULONG             ulCurrentLeaseState = 0;
+    USHORT            usEpoch             = 0;
+    BOOLEAN           bInLock             = FALSE;
+    BOOLEAN           bNotify             = FALSE;
+    BOOLEAN           bNotifyAckRequired  = FALSE;
+
+    LWIO_LOCK_MUTEX(bInLock, &pLease->mutex);
+
+    if (pLease->bBreakInProgress &&
+        (pLease->ulLeaseState & ~pLease->ulBreakToState))
+    {
+        bNotify             = TRUE;
+        ulCurrentLeaseState = pLease->ulLeaseState;
+        ulNewLeaseState     = pLease->ulBreakToState;
+        usEpoch             = ++pLease->usEpoch;
+
+        bNotifyAckRequired = (ulCurrentLeaseState &
+                              (SMB2_LEASE_WRITE_CACHING|
+                               SMB2_LEASE_HANDLE_CACHING)) != 0;
+        if (bNotifyAckRequired)
+        {
+            pLease->ulNotifiedState = ulNewLeaseState;
+        }
+    }
+
+    LWIO_UNLOCK_MUTEX(bInLock, &pLease->mutex);
+
+    if (bNotify)
+    {
+        ntStatus = SrvBuildLeaseBreakNotification_SMB_V2(
+                        pExecContext,
+                        pLease,
+                        usEpoch,
+                        ulCurrentLeaseState,
+                        ulNewLeaseState,
+                        (bNotifyAckRequired ?
+                            SMB2_NOTIFY_BREAK_LEASE_FLAG_ACK_REQUIRED : 0));
+        BAIL_ON_NT_STATUS(ntStatus);
+
+        if (!bNotifyAckRequired)
+        {
+            /* Only read caching was left; no answer is coming */
+            ntStatus = SrvLeaseExpireBreak_SMB_V2(pLease);
+            BAIL_ON_NT_STATUS(ntStatus);
+        }
+    }
+
+error:
+
+    return ntStatus;
+}
+
+NTSTATUS
+SrvPostOplockBreakTimer_SMB_V2(
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    )
+{
+    NTSTATUS ntStatus = STATUS_SUCCESS;
+    LONG64   llExpiry = 0LL;
+
+    ntStatus = WireGetCurrentNTTime(&llExpiry);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    /* configured timeout will be in milliseconds */
+    llExpiry +=
+        (SrvConfigGetOplockTimeout_SMB_V2() *
+            WIRE_FACTOR_MILLISECS_TO_HUNDREDS_OF_NANOSECS);
+
+    InterlockedIncrement(&pOplockState->refCount);
+
+    ntStatus = SrvTimerPostRequest(
+                    llExpiry,
+                    pOplockState,
+                    &SrvOplockExpiredCB_SMB_V2,
+                    &pOplockState->pTimerRequest);
+    if (ntStatus != STATUS_SUCCESS)
+    {
+        InterlockedDecrement(&pOplockState->refCount);
+    }
+    BAIL_ON_NT_STATUS(ntStatus);
+
+error:
+
+    return ntStatus;
+}
+
 static
 NTSTATUS
 SrvBuildOplockBreakNotification_SMB_V2(
@@ -930,6 +1196,35 @@ error:
     return ntStatus;
 }
 
+NTSTATUS
+SrvEnqueueLeaseBreakTask_SMB_V2(
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    )
+{
+    NTSTATUS          ntStatus     = STATUS_SUCCESS;
+    PSRV_EXEC_CONTEXT pExecContext = NULL;
+
+    ntStatus = SrvBuildOplockExecContext_SMB_V2(
+                    pOplockState,
+                    LW_SMB2_OPLOCK_ACTION_SEND_LEASE_BREAK,
+                    &pExecContext);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    ntStatus = SrvScheduleExecContext(pExecContext);
+
+error:
+
+    if (!NT_SUCCESS(ntStatus))
+    {
+        if (pExecContext)
+        {
+            SrvReleaseExecContext(pExecContext);
+        }
+    }
+
+    return ntStatus;
+}
+
 static
 VOID
 SrvCancelOplockState_SMB_V2(
@@ -1006,6 +1301,11 @@ SrvFreeOplockState_SMB_V2(
                     &pOplockState->pAcb->AsyncCancelContext);
     }
 
+    if (pOplockState->pLease)
+    {
+        SrvLeaseRemoveOplockState_SMB_V2(pOplockState);
+    }
+
     if (pOplockState->pConnection)
     {
         SrvConnectionRelease(pOplockState->pConnection);
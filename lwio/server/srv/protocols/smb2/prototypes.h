@@ -202,6 +202,84 @@ SrvProcessIOCTL_SMB_V2(
     PSRV_EXEC_CONTEXT pContext
     );
 
+// lease.c
+
+NTSTATUS
+SrvLeaseInit_SMB_V2(
+    VOID
+    );
+
+VOID
+SrvLeaseShutdown_SMB_V2(
+    VOID
+    );
+
+NTSTATUS
+SrvLeaseFind_SMB_V2(
+    PSRV_ECP_LEASE_KEY pKey,
+    BOOLEAN            bCreate,
+    PSRV_LEASE_SMB_V2* ppLease
+    );
+
+PSRV_LEASE_SMB_V2
+SrvLeaseAcquire_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease
+    );
+
+VOID
+SrvLeaseRelease_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease
+    );
+
+NTSTATUS
+SrvLeaseCheckFile_SMB_V2(
+    PSRV_ECP_LEASE_KEY pKey,
+    PUNICODE_STRING    pFileName
+    );
+
+NTSTATUS
+SrvLeaseBindFile_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease,
+    PUNICODE_STRING   pFileName
+    );
+
+VOID
+SrvLeaseAddOplockState_SMB_V2(
+    PSRV_LEASE_SMB_V2        pLease,
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    );
+
+VOID
+SrvLeaseRemoveOplockState_SMB_V2(
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    );
+
+NTSTATUS
+SrvLeaseAcknowledgeBreak_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease,
+    ULONG             ulLeaseState
+    );
+
+NTSTATUS
+SrvLeaseExpireBreak_SMB_V2(
+    PSRV_LEASE_SMB_V2 pLease
+    );
+
+NTSTATUS
+SrvProcessLeaseBreak_SMB_V2(
+    PSRV_EXEC_CONTEXT pExecContext
+    );
+
+NTSTATUS
+SrvBuildLeaseBreakNotification_SMB_V2(
+    PSRV_EXEC_CONTEXT pExecContext,
+    PSRV_LEASE_SMB_V2 pLease,
+    USHORT            usEpoch,
+    ULONG             ulCurrentLeaseState,
+    ULONG             ulNewLeaseState,
+    ULONG             ulFlags
+    );
+
 // libmain.c
 
 NTSTATUS
@@ -360,6 +438,16 @@ SrvAcknowledgeOplockBreak_SMB_V2(
     BOOLEAN bFileIsClosed
     );
 
+NTSTATUS
+SrvPostOplockBreakTimer_SMB_V2(
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    );
+
+NTSTATUS
+SrvEnqueueLeaseBreakTask_SMB_V2(
+    PSRV_OPLOCK_STATE_SMB_V2 pOplockState
+    );
+
 VOID
 SrvCancelOplockStateHandle_SMB_V2(
     HANDLE hOplockState
@@ -742,6 +830,17 @@ SMB2UnmarshalOplockBreakRequest(
     IN OUT PSMB2_OPLOCK_BREAK_HEADER* ppRequestHeader
     );
 
+BOOLEAN
+SMB2IsLeaseBreakRequest(
+    IN     PSRV_MESSAGE_SMB_V2        pSmbRequest
+    );
+
+NTSTATUS
+SMB2UnmarshalLeaseBreakRequest(
+    IN     PSRV_MESSAGE_SMB_V2       pSmbRequest,
+    IN OUT PSMB2_LEASE_BREAK_HEADER* ppRequestHeader
+    );
+
 NTSTATUS
 SMB2MarshalFindResponse(
     PBYTE                       pBuffer,
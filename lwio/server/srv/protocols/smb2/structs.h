@@ -234,6 +234,15 @@ typedef struct __SMB2_MAXIMAL_ACCESS_MASK_CREATE_CONTEXT
 } __attribute__((__packed__))  SMB2_MAXIMAL_ACCESS_MASK_CREATE_CONTEXT,
                              *PSMB2_MAXIMAL_ACCESS_MASK_CREATE_CONTEXT;
 
+typedef struct __SMB2_LEASE_CREATE_CONTEXT
+{
+    UCHAR   leaseKey[16];
+    ULONG   ulLeaseState;
+    ULONG   ulLeaseFlags;
+    ULONG64 ullLeaseDuration;
+} __attribute__((__packed__))  SMB2_LEASE_CREATE_CONTEXT,
+                             *PSMB2_LEASE_CREATE_CONTEXT;
+
 typedef struct __SMB2_CLOSE_REQUEST_HEADER
 {
     USHORT   usLength;
@@ -514,6 +523,33 @@ typedef struct __SMB2_OPLOCK_BREAK_HEADER
 } __attribute__((__packed__)) SMB2_OPLOCK_BREAK_HEADER,
                              *PSMB2_OPLOCK_BREAK_HEADER;
 
+typedef struct __SMB2_LEASE_BREAK_NOTIFICATION_HEADER
+{
+    USHORT   usLength;
+    USHORT   usEpoch;
+    ULONG    ulFlags;
+    UCHAR    leaseKey[16];
+    ULONG    ulCurrentLeaseState;
+    ULONG    ulNewLeaseState;
+    ULONG    ulBreakReason;
+    ULONG    ulAccessMaskHint;
+    ULONG    ulShareMaskHint;
+} __attribute__((__packed__)) SMB2_LEASE_BREAK_NOTIFICATION_HEADER,
+                             *PSMB2_LEASE_BREAK_NOTIFICATION_HEADER;
+
+/* Used for both the lease break acknowledgement and its response */
+
+typedef struct __SMB2_LEASE_BREAK_HEADER
+{
+    USHORT   usLength;
+    USHORT   usReserved;
+    ULONG    ulFlags;
+    UCHAR    leaseKey[16];
+    ULONG    ulLeaseState;
+    ULONG64  ullLeaseDuration;
+} __attribute__((__packed__)) SMB2_LEASE_BREAK_HEADER,
+                             *PSMB2_LEASE_BREAK_HEADER;
+
 typedef struct __SMB2_ERROR_RESPONSE_HEADER
 {
     USHORT usLength;
@@ -774,6 +810,37 @@ typedef struct _SRV_OPLOCK_INFO
     UCHAR oplockLevel;
 } SRV_OPLOCK_INFO, *PSRV_OPLOCK_INFO;
 
+/* One per (client guid, lease key), shared by every handle that
+   opened the file with that key */
+
+typedef struct _SRV_LEASE_SMB_V2
+{
+    LONG                    refCount;
+
+    pthread_mutex_t         mutex;
+    pthread_mutex_t*        pMutex;
+
+    SRV_ECP_LEASE_KEY       key;
+
+    /* The file the lease was first granted on; no other file may be
+       opened under its key */
+    UNICODE_STRING          fileName;
+
+    ULONG                   ulLeaseState;
+    /* What the outstanding notification offered the client;
+       ulBreakToState can narrow below it as more handles break */
+    ULONG                   ulNotifiedState;
+    ULONG                   ulBreakToState;
+    BOOLEAN                 bBreakInProgress;
+
+    /* SMB 2.1 has no epoch on the wire; kept so that breaks can be
+       told apart in the logs */
+    USHORT                  usEpoch;
+
+    LW_LIST_LINKS           oplockStateList;
+
+} SRV_LEASE_SMB_V2, *PSRV_LEASE_SMB_V2;
+
 typedef struct _SRV_OPLOCK_STATE_SMB_V2
 {
     LONG                    refCount;
@@ -796,6 +863,10 @@ typedef struct _SRV_OPLOCK_STATE_SMB_V2
 
     PSRV_TIMER_REQUEST      pTimerRequest;
 
+    PSRV_LEASE_SMB_V2       pLease;
+    LW_LIST_LINKS           leaseLinks;      // protected by pLease->mutex
+    ULONG                   ulLeaseState;
+
     IO_FSCTL_OPLOCK_REQUEST_INPUT_BUFFER   oplockBuffer_in;
     IO_FSCTL_OPLOCK_REQUEST_OUTPUT_BUFFER  oplockBuffer_out;
     IO_FSCTL_OPLOCK_BREAK_ACK_INPUT_BUFFER oplockBuffer_ack;
@@ -843,6 +914,10 @@ typedef struct _SRV_CREATE_STATE_SMB_V2
 
     PSRV_CREATE_CONTEXT          pExtAContext;
 
+    PSRV_CREATE_CONTEXT          pLeaseContext;
+    SRV_ECP_LEASE_KEY            leaseKey;
+    ULONG                        ulLeaseState;
+
     FILE_NETWORK_OPEN_INFORMATION  networkOpenInfo;
     PFILE_NETWORK_OPEN_INFORMATION pNetworkOpenInfo;
 
@@ -1305,6 +1380,8 @@ typedef struct _SRV_RUNTIME_GLOBALS_SMB_V2
     pthread_rwlock_t*    pConfigLock;
     SRV_CONFIG_SMB_V2    config;
 
+    PLWRTL_RB_TREE       pLeaseCollection;   // protected by mutex
+
 } SRV_RUNTIME_GLOBALS_SMB_V2, *PSRV_RUNTIME_GLOBALS_SMB_V2;
 
 #endif /* __STRUCTS_H__ */
@@ -1981,6 +1981,59 @@ error:
     goto cleanup;
 }
 
+BOOLEAN
+SMB2IsLeaseBreakRequest(
+    IN     PSRV_MESSAGE_SMB_V2        pSmbRequest
+    )
+{
+    PBYTE pDataCursor = pSmbRequest->pBuffer + pSmbRequest->ulHeaderSize;
+    ULONG ulBytesAvailable = pSmbRequest->ulMessageSize - pSmbRequest->ulHeaderSize;
+
+    /* Oplock and lease break acknowledgements share a command and are
+       told apart by the structure size */
+
+    return ((ulBytesAvailable >= sizeof(USHORT)) &&
+            (*((PUSHORT)pDataCursor) == sizeof(SMB2_LEASE_BREAK_HEADER)));
+}
+
+NTSTATUS
+SMB2UnmarshalLeaseBreakRequest(
+    IN     PSRV_MESSAGE_SMB_V2       pSmbRequest,
+    IN OUT PSMB2_LEASE_BREAK_HEADER* ppRequestHeader
+    )
+{
+    NTSTATUS ntStatus = STATUS_SUCCESS;
+    PBYTE pDataCursor = pSmbRequest->pBuffer + pSmbRequest->ulHeaderSize;
+    ULONG ulBytesAvailable = pSmbRequest->ulMessageSize - pSmbRequest->ulHeaderSize;
+    PSMB2_LEASE_BREAK_HEADER pHeader = NULL; // Do not free
+
+    if (ulBytesAvailable < sizeof(SMB2_LEASE_BREAK_HEADER))
+    {
+        ntStatus = STATUS_INVALID_NETWORK_RESPONSE;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    pHeader = (PSMB2_LEASE_BREAK_HEADER)pDataCursor;
+
+    if (pHeader->usLength != sizeof(SMB2_LEASE_BREAK_HEADER))
+    {
+        ntStatus = STATUS_INVALID_NETWORK_RESPONSE;
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
+
+    *ppRequestHeader = pHeader;
+
+cleanup:
+
+    return ntStatus;
+
+error:
+
+    *ppRequestHeader = NULL;
+
+    goto cleanup;
+}
+
 NTSTATUS
 SMB2MarshalFindResponse(
     IN OUT PBYTE                       pBuffer,
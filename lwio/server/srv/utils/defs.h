@@ -47,25 +47,15 @@
  *
  */
 
-#define REG_KEY_PATH_SRV_LOGGING_W \
-              {'s','e','r','v','i','c','e','s','\\',         \
-               'l','w','i','o','\\',                         \
-               'p','a','r','a','m','e','t','e','r','s','\\', \
-               'd','r','i','v','e','r','s','\\',             \
-               's','r','v','\\',                             \
-               'l','o','g','g','i','n','g',0}
+#define REG_KEY_PATH_SRV_LOGGING \
+            "Services\\lwio\\Parameters\\Drivers\\srv\\logging"
 
-#define REG_VALUE_SRV_LOGGING_ENABLED_W \
-            {'E','n','a','b','l','e','L','o','g','g','i','n','g',0}
-
-#define REG_VALUE_SRV_MAX_REQ_LOG_LEN_W \
-            {'M','a','x','R','e','q','u','e','s','t','L','o','g','L','e','n','g','t','h',0}
+#define REG_VALUE_SRV_LOGGING_ENABLED   "EnableLogging"
+#define REG_VALUE_SRV_MAX_REQ_LOG_LEN   "MaxRequestLogLength"
+#define REG_VALUE_SRV_FILTERS           "Filters"
 
 #define SRV_REQ_MAX_LOG_LEN_DEFAULT  256
 
-#define REG_VALUE_SRV_FILTERS_W \
-            {'F','i','l','t','e','r','s',0}
-
 typedef enum
 {
     SRV_LOG_FILTER_TOKEN_TYPE_STAR = 0,
@@ -67,6 +67,44 @@ error:
     return ntStatus;
 }
 
+NTSTATUS
+SrvUtilsRefreshConfig(
+    VOID
+    )
+{
+    NTSTATUS ntStatus = STATUS_SUCCESS;
+    BOOLEAN bInLock  = FALSE;
+    PSRV_LOG_SPEC pLogSpec = NULL;
+    PSRV_LOG_SPEC pOldLogSpec = NULL;
+
+    if (!gSrvUtilsGlobals.pMutex)
+    {
+        // Not initialized yet; initialization reads the current values
+        goto error;
+    }
+
+    ntStatus = SrvLogSpecCreate(&pLogSpec);
+    BAIL_ON_NT_STATUS(ntStatus);
+
+    LWIO_LOCK_RWMUTEX_EXCLUSIVE(bInLock, &gSrvUtilsGlobals.mutex);
+
+    // Contexts that acquired the old specification keep their reference
+    pOldLogSpec = gSrvUtilsGlobals.pLogSpec;
+    gSrvUtilsGlobals.pLogSpec = pLogSpec;
+    pLogSpec = pOldLogSpec;
+
+    LWIO_UNLOCK_RWMUTEX(bInLock, &gSrvUtilsGlobals.mutex);
+
+error:
+
+    if (pLogSpec)
+    {
+        SrvLogSpecRelease(pLogSpec);
+    }
+
+    return ntStatus;
+}
+
 NTSTATUS
 SrvUtilsShutdown(
     VOID
@@ -95,7 +95,7 @@
 static
 NTSTATUS
 SrvLogSpecProcessFilter(
-    PWSTR         pwszFilter,
+    PSTR          pszFilter,
     PSRV_LOG_SPEC pLogSpec
     );
 
@@ -234,58 +234,31 @@ SrvLogSpecCreate(
     )
 {
     NTSTATUS ntStatus = STATUS_SUCCESS;
-    HANDLE   hRegConnection    = NULL;
-    HKEY     hRootKey          = NULL;
-    HKEY     hKey              = NULL;
-    wchar16_t wszHKTM[]        = HKEY_THIS_MACHINE_W;
-    wchar16_t wszLoggingKey[]  = REG_KEY_PATH_SRV_LOGGING_W;
-    wchar16_t wszEnableLogging[] = REG_VALUE_SRV_LOGGING_ENABLED_W;
-    wchar16_t wszMaxReqLogLen[]  = REG_VALUE_SRV_MAX_REQ_LOG_LEN_W;
-    DWORD     dwEnableLogging    = FALSE;
+    PLWIO_CONFIG_REG pReg = NULL;
+    BOOLEAN   bEnableLogging     = FALSE;
     DWORD     dwMaxReqLogLen     = SRV_REQ_MAX_LOG_LEN_DEFAULT;
-    DWORD     dwDataType         = REG_DWORD;
-    DWORD     dwValueLen         = sizeof(dwEnableLogging);
-    ULONG     ulValueLen         = MAX_VALUE_LENGTH;
-    BYTE      pData[MAX_VALUE_LENGTH] = {0};
-    PWSTR*    ppwszValues             = NULL;
+    PSTR*     ppszValues         = NULL;
     PSRV_LOG_SPEC pLogSpec = NULL;
 
-    ntStatus = NtRegOpenServer(&hRegConnection);
+    // Served from the process-wide lwio configuration cache
+    ntStatus = LwIoOpenConfig(REG_KEY_PATH_SRV_LOGGING, NULL, &pReg);
     BAIL_ON_NT_STATUS(ntStatus);
 
-    ntStatus = NtRegOpenKeyExW(
-                    hRegConnection,
-                    NULL,
-                    &wszHKTM[0],
-                    0,
-                    KEY_READ,
-                    &hRootKey);
-    BAIL_ON_NT_STATUS(ntStatus);
-
-    ntStatus = NtRegOpenKeyExW(
-                    hRegConnection,
-                    hRootKey,
-                    &wszLoggingKey[0],
-                    0,
-                    KEY_READ,
-                    &hKey);
-    BAIL_ON_NT_STATUS(ntStatus);
-
-    ntStatus = NtRegGetValueW(
-                    hRegConnection,
-                    hKey,
-                    NULL,
-                    &wszEnableLogging[0],
-                    RRF_RT_REG_DWORD,
-                    &dwDataType,
-                    &dwEnableLogging,
-                    &dwValueLen);
+    ntStatus = LwIoReadConfigBoolean(
+                    pReg,
+                    REG_VALUE_SRV_LOGGING_ENABLED,
+                    FALSE,
+                    &bEnableLogging);
+    if (ntStatus == STATUS_OBJECT_NAME_NOT_FOUND)
+    {
+        // Enhanced logging has not been configured
+        ntStatus = STATUS_SUCCESS;
+    }
     BAIL_ON_NT_STATUS(ntStatus);
 
-    if (dwEnableLogging)
+    if (bEnableLogging)
     {
-        wchar16_t wszFilters[] = REG_VALUE_SRV_FILTERS_W;
-        INT       iValue       = 0;
+        INT iValue = 0;
 
         ntStatus = SrvAllocateMemory(sizeof(SRV_LOG_SPEC), (PVOID*)&pLogSpec);
         BAIL_ON_NT_STATUS(ntStatus);
@@ -293,18 +266,13 @@ SrvLogSpecCreate(
         pLogSpec->refCount = 1;
         pLogSpec->dwMaxRequestLogLength = SRV_REQ_MAX_LOG_LEN_DEFAULT;
 
-        dwDataType = REG_DWORD;
-        dwValueLen = sizeof(dwMaxReqLogLen);
-
-        ntStatus = NtRegGetValueW(
-                        hRegConnection,
-                        hKey,
-                        NULL,
-                        &wszMaxReqLogLen[0],
-                        RRF_RT_REG_DWORD,
-                        &dwDataType,
-                        &dwMaxReqLogLen,
-                        &dwValueLen);
+        ntStatus = LwIoReadConfigDword(
+                        pReg,
+                        REG_VALUE_SRV_MAX_REQ_LOG_LEN,
+                        FALSE,
+                        0,
+                        0xFFFFFFFF,
+                        &dwMaxReqLogLen);
         if (ntStatus == STATUS_SUCCESS)
         {
             // TODO: Should we limit this length based on a maximum value?
@@ -319,27 +287,16 @@ SrvLogSpecCreate(
         pLogSpec->pDefaultSpec->defaultLogLevel_smb1 = LWIO_LOG_LEVEL_ERROR;
         pLogSpec->pDefaultSpec->defaultLogLevel_smb2 = LWIO_LOG_LEVEL_ERROR;
 
-        dwDataType = REG_MULTI_SZ;
-
-        ntStatus = NtRegGetValueW(
-                        hRegConnection,
-                        hKey,
-                        NULL,
-                        &wszFilters[0],
-                        RRF_RT_REG_MULTI_SZ,
-                        &dwDataType,
-                        pData,
-                        &ulValueLen);
+        ntStatus = LwIoReadConfigMultiString(
+                        pReg,
+                        REG_VALUE_SRV_FILTERS,
+                        FALSE,
+                        &ppszValues);
         BAIL_ON_NT_STATUS(ntStatus);
 
-        ntStatus = NtRegByteArrayToMultiStrs(pData, ulValueLen, &ppwszValues);
-        BAIL_ON_NT_STATUS(ntStatus);
-
-        for (; ppwszValues[iValue]; iValue++)
+        for (; ppszValues[iValue]; iValue++)
         {
-            PWSTR pwszValue = &ppwszValues[iValue][0];
-
-            ntStatus = SrvLogSpecProcessFilter(pwszValue, pLogSpec);
+            ntStatus = SrvLogSpecProcessFilter(ppszValues[iValue], pLogSpec);
             BAIL_ON_NT_STATUS(ntStatus);
         }
     }
@@ -348,25 +305,9 @@ SrvLogSpecCreate(
 
 cleanup:
 
-    if (ppwszValues)
-    {
-        RegFreeMultiStrsW(ppwszValues);
-    }
-
-    if (hRegConnection)
-    {
-        if (hKey)
-        {
-            NtRegCloseKey(hRegConnection, hKey);
-        }
+    LwIoMultiStringFree(&ppszValues);
 
-        if (hRootKey)
-        {
-            NtRegCloseKey(hRegConnection, hRootKey);
-        }
-
-        NtRegCloseServer(hRegConnection);
-    }
+    LwIoCloseConfig(pReg);
 
     return ntStatus;
 
@@ -391,17 +332,13 @@ error:
 static
 NTSTATUS
 SrvLogSpecProcessFilter(
-    PWSTR         pwszFilter,  /* IN     */
+    PSTR          pszFilter,   /* IN     */
     PSRV_LOG_SPEC pLogSpec     /* IN OUT */
     )
 {
     NTSTATUS ntStatus = STATUS_SUCCESS;
-    PSTR     pszFilter = NULL;
     PSRV_LOG_FILTER pLogFilter = NULL;
 
-    ntStatus = SrvWc16sToMbs(pwszFilter, &pszFilter);
-    BAIL_ON_NT_STATUS(ntStatus);
-
     ntStatus = SrvLogSpecParseFilter(pszFilter, &pLogFilter);
     BAIL_ON_NT_STATUS(ntStatus);
 
@@ -415,8 +352,6 @@ cleanup:
         SrvLogFilterFree(pLogFilter);
     }
 
-    SRV_SAFE_FREE_MEMORY(pszFilter);
-
     return ntStatus;
 
 error:
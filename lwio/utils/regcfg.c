@@ -47,8 +47,42 @@ struct __LWIO_CONFIG_REG
     HKEY hKey;
     PSTR pszConfigKey;
     PSTR pszPolicyKey;
+    // Process-wide, not owned
+    PLWREG_CONFIG_CACHE pCache;
 };
 
+/*
+ * Values under these keys are served from an in-process cache that lwreg
+ * invalidates on change, so refreshes do not cost a round trip per value.
+ */
+static PCSTR gLwIoConfigCacheKeys[] =
+{
+    "Services\\lwio",
+    "Policy\\Services\\lwio"
+};
+
+static pthread_mutex_t gLwIoConfigCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static HANDLE ghLwIoConfigCacheConnection = NULL;
+static PLWREG_CONFIG_CACHE gpLwIoConfigCache = NULL;
+
+static
+PLWREG_CONFIG_CACHE
+LwIoGetConfigCache(
+    VOID
+    );
+
+static
+NTSTATUS
+LwIoGetConfigValue(
+    PLWIO_CONFIG_REG pReg,
+    PCSTR pszKey,
+    PCSTR pszName,
+    REG_DATA_TYPE_FLAGS Flags,
+    PDWORD pdwType,
+    PVOID pvData,
+    PDWORD pcbData
+    );
+
 /**
  * Read configuration values from the registry
  *
@@ -194,17 +228,23 @@ LwIoOpenConfig(
         BAIL_ON_NT_STATUS(ntStatus);
     }
 
-    ntStatus = NtRegOpenServer(&pReg->hConnection);
-    BAIL_ON_NT_STATUS(ntStatus);
+    // The cache carries its own connection, so only open one without it
+    pReg->pCache = LwIoGetConfigCache();
 
-    ntStatus = NtRegOpenKeyExA(
-            pReg->hConnection,
-            NULL,
-            HKEY_THIS_MACHINE,
-            0,
-            KEY_READ,
-            &(pReg->hKey));
-    BAIL_ON_NT_STATUS(ntStatus);
+    if (!pReg->pCache)
+    {
+        ntStatus = NtRegOpenServer(&pReg->hConnection);
+        BAIL_ON_NT_STATUS(ntStatus);
+
+        ntStatus = NtRegOpenKeyExA(
+                pReg->hConnection,
+                NULL,
+                HKEY_THIS_MACHINE,
+                0,
+                KEY_READ,
+                &(pReg->hKey));
+        BAIL_ON_NT_STATUS(ntStatus);
+    }
 
 cleanup:
 
@@ -270,9 +310,8 @@ LwIoReadConfigString(
 
         dwSize = sizeof(szValue);
         memset(szValue, 0, dwSize);
-        ntStatus = NtRegGetValueA(
-                    pReg->hConnection,
-                    pReg->hKey,
+        ntStatus = LwIoGetConfigValue(
+                    pReg,
                     pReg->pszPolicyKey,
                     pszName,
                     RRF_RT_REG_SZ,
@@ -289,9 +328,8 @@ LwIoReadConfigString(
     {
         dwSize = sizeof(szValue);
         memset(szValue, 0, dwSize);
-        ntStatus = NtRegGetValueA(
-                    pReg->hConnection,
-                    pReg->hKey,
+        ntStatus = LwIoGetConfigValue(
+                    pReg,
                     pReg->pszConfigKey,
                     pszName,
                     RRF_RT_REG_SZ,
@@ -342,9 +380,8 @@ LwIoReadConfigMultiString(
 
         dwSize = sizeof(szValue);
         memset(szValue, 0, dwSize);
-        ntStatus = NtRegGetValueA(
-                    pReg->hConnection,
-                    pReg->hKey,
+        ntStatus = LwIoGetConfigValue(
+                    pReg,
                     pReg->pszPolicyKey,
                     pszName,
                     RRF_RT_REG_MULTI_SZ,
@@ -361,9 +398,8 @@ LwIoReadConfigMultiString(
     {
         dwSize = sizeof(szValue);
         memset(szValue, 0, dwSize);
-        ntStatus = NtRegGetValueA(
-                    pReg->hConnection,
-                    pReg->hKey,
+        ntStatus = LwIoGetConfigValue(
+                    pReg,
                     pReg->pszConfigKey,
                     pszName,
                     RRF_RT_REG_MULTI_SZ,
@@ -415,9 +451,8 @@ LwIoReadConfigDword(
         }
 
         dwSize = sizeof(dwValue);
-        ntStatus = NtRegGetValueA(
-                    pReg->hConnection,
-                    pReg->hKey,
+        ntStatus = LwIoGetConfigValue(
+                    pReg,
                     pReg->pszPolicyKey,
                     pszName,
                     RRF_RT_REG_DWORD,
@@ -433,9 +468,8 @@ LwIoReadConfigDword(
     if (!bGotValue)
     {
         dwSize = sizeof(dwValue);
-        ntStatus = NtRegGetValueA(
-                    pReg->hConnection,
-                    pReg->hKey,
+        ntStatus = LwIoGetConfigValue(
+                    pReg,
                     pReg->pszConfigKey,
                     pszName,
                     RRF_RT_REG_DWORD,
@@ -547,6 +581,115 @@ error:
 
 
 
+
+static
+PLWREG_CONFIG_CACHE
+LwIoGetConfigCache(
+    VOID
+    )
+{
+    NTSTATUS ntStatus = STATUS_SUCCESS;
+
+    pthread_mutex_lock(&gLwIoConfigCacheLock);
+
+    if (!gpLwIoConfigCache)
+    {
+        if (!ghLwIoConfigCacheConnection)
+        {
+            ntStatus = NtRegOpenServer(&ghLwIoConfigCacheConnection);
+        }
+
+        if (!ntStatus)
+        {
+            // Kept for the life of the process
+            ntStatus = NtRegOpenConfigCache(
+                            ghLwIoConfigCacheConnection,
+                            sizeof(gLwIoConfigCacheKeys) /
+                            sizeof(gLwIoConfigCacheKeys[0]),
+                            gLwIoConfigCacheKeys,
+                            &gpLwIoConfigCache);
+        }
+
+        // On failure configuration is simply read without a cache
+    }
+
+    pthread_mutex_unlock(&gLwIoConfigCacheLock);
+
+    return gpLwIoConfigCache;
+}
+
+/**
+ * Wait for a change under the lwio configuration keys
+ *
+ * @param[in,out] pdwGeneration 0 to fetch a baseline without waiting (this
+ *                              also clears an earlier cancel), then whatever
+ *                              the previous call returned
+ *
+ * @return STATUS_SUCCESS when configuration should be re-read,
+ *         STATUS_CANCELLED after LwIoCancelWaitForConfigChange, or an
+ *         error when change notification is not available.
+ */
+NTSTATUS
+LwIoWaitForConfigChange(
+    PDWORD pdwGeneration
+    )
+{
+    PLWREG_CONFIG_CACHE pCache = LwIoGetConfigCache();
+
+    if (!pCache)
+    {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    return NtRegConfigCacheWaitForChange(pCache, pdwGeneration);
+}
+
+VOID
+LwIoCancelWaitForConfigChange(
+    VOID
+    )
+{
+    pthread_mutex_lock(&gLwIoConfigCacheLock);
+
+    NtRegConfigCacheCancelWait(gpLwIoConfigCache);
+
+    pthread_mutex_unlock(&gLwIoConfigCacheLock);
+}
+
+static
+NTSTATUS
+LwIoGetConfigValue(
+    PLWIO_CONFIG_REG pReg,
+    PCSTR pszKey,
+    PCSTR pszName,
+    REG_DATA_TYPE_FLAGS Flags,
+    PDWORD pdwType,
+    PVOID pvData,
+    PDWORD pcbData
+    )
+{
+    if (pReg->pCache)
+    {
+        return NtRegConfigCacheGetValueA(
+                    pReg->pCache,
+                    pszKey,
+                    pszName,
+                    Flags,
+                    pdwType,
+                    pvData,
+                    pcbData);
+    }
+
+    return NtRegGetValueA(
+                pReg->hConnection,
+                pReg->hKey,
+                pszKey,
+                pszName,
+                Flags,
+                pdwType,
+                pvData,
+                pcbData);
+}
 /*
 local variables:
 mode: c
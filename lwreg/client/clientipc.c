@@ -1585,6 +1585,324 @@ cleanup:
 error:
     goto cleanup;
 }
+
+NTSTATUS
+RegTransactBeginTransaction(
+    IN HANDLE hRegConnection
+    )
+{
+    NTSTATUS status = 0;
+    // Do not free pStatus
+    PREG_IPC_STATUS pStatus = NULL;
+
+    LWMsgParams in = LWMSG_PARAMS_INITIALIZER;
+    LWMsgParams out = LWMSG_PARAMS_INITIALIZER;
+    LWMsgCall* pCall = NULL;
+
+    status = RegIpcAcquireCall(hRegConnection, &pCall);
+    BAIL_ON_NT_STATUS(status);
+
+    in.tag = REG_Q_BEGIN_TRANSACTION;
+    in.data = NULL;
+
+    status = MAP_LWMSG_ERROR(lwmsg_call_dispatch(pCall, &in, &out, NULL, NULL));
+    BAIL_ON_NT_STATUS(status);
+
+    switch (out.tag)
+    {
+        case REG_R_BEGIN_TRANSACTION:
+            break;
+
+        case REG_R_ERROR:
+            pStatus = (PREG_IPC_STATUS) out.data;
+            status = pStatus->status;
+            BAIL_ON_NT_STATUS(status);
+            break;
+
+        default:
+            status = STATUS_INVALID_PARAMETER;
+            BAIL_ON_NT_STATUS(status);
+    }
+
+cleanup:
+    if (pCall)
+    {
+        lwmsg_call_destroy_params(pCall, &out);
+        lwmsg_call_release(pCall);
+    }
+
+    return status;
+
+error:
+    goto cleanup;
+}
+
+NTSTATUS
+RegTransactEndTransaction(
+    IN HANDLE hRegConnection,
+    IN BOOLEAN bCommit
+    )
+{
+    NTSTATUS status = 0;
+    REG_IPC_END_TRANSACTION_REQ EndTransactionReq = {0};
+    // Do not free pStatus
+    PREG_IPC_STATUS pStatus = NULL;
+
+    LWMsgParams in = LWMSG_PARAMS_INITIALIZER;
+    LWMsgParams out = LWMSG_PARAMS_INITIALIZER;
+    LWMsgCall* pCall = NULL;
+
+    status = RegIpcAcquireCall(hRegConnection, &pCall);
+    BAIL_ON_NT_STATUS(status);
+
+    EndTransactionReq.bCommit = bCommit;
+
+    in.tag = REG_Q_END_TRANSACTION;
+    in.data = &EndTransactionReq;
+
+    status = MAP_LWMSG_ERROR(lwmsg_call_dispatch(pCall, &in, &out, NULL, NULL));
+    BAIL_ON_NT_STATUS(status);
+
+    switch (out.tag)
+    {
+        case REG_R_END_TRANSACTION:
+            break;
+
+        case REG_R_ERROR:
+            pStatus = (PREG_IPC_STATUS) out.data;
+            status = pStatus->status;
+            BAIL_ON_NT_STATUS(status);
+            break;
+
+        default:
+            status = STATUS_INVALID_PARAMETER;
+            BAIL_ON_NT_STATUS(status);
+    }
+
+cleanup:
+    if (pCall)
+    {
+        lwmsg_call_destroy_params(pCall, &out);
+        lwmsg_call_release(pCall);
+    }
+
+    return status;
+
+error:
+    goto cleanup;
+}
+
+NTSTATUS
+RegTransactNotifyChangeKey(
+    IN HANDLE hRegConnection,
+    IN HKEY hKey,
+    IN DWORD dwSubKeyCount,
+    IN OPTIONAL PWSTR* ppSubKeys,
+    IN BOOLEAN bWatchSubtree,
+    IN DWORD dwSequence,
+    OUT PDWORD pdwSequence
+    )
+{
+    NTSTATUS status = 0;
+    REG_IPC_NOTIFY_CHANGE_KEY_REQ NotifyReq = {0};
+    // Do not free pNotifyResp
+    PREG_IPC_NOTIFY_CHANGE_KEY_RESPONSE pNotifyResp = NULL;
+    // Do not free pStatus
+    PREG_IPC_STATUS pStatus = NULL;
+
+    LWMsgParams in = LWMSG_PARAMS_INITIALIZER;
+    LWMsgParams out = LWMSG_PARAMS_INITIALIZER;
+    LWMsgCall* pCall = NULL;
+
+    status = RegIpcAcquireCall(hRegConnection, &pCall);
+    BAIL_ON_NT_STATUS(status);
+
+    NotifyReq.hKey = hKey;
+    NotifyReq.dwSubKeyCount = dwSubKeyCount;
+    NotifyReq.ppSubKeys = ppSubKeys;
+    NotifyReq.bWatchSubtree = bWatchSubtree;
+    NotifyReq.dwSequence = dwSequence;
+
+    in.tag = REG_Q_NOTIFY_CHANGE_KEY;
+    in.data = &NotifyReq;
+
+    status = MAP_LWMSG_ERROR(lwmsg_call_dispatch(pCall, &in, &out, NULL, NULL));
+    BAIL_ON_NT_STATUS(status);
+
+    switch (out.tag)
+    {
+        case REG_R_NOTIFY_CHANGE_KEY:
+            pNotifyResp = (PREG_IPC_NOTIFY_CHANGE_KEY_RESPONSE) out.data;
+            *pdwSequence = pNotifyResp->dwSequence;
+            break;
+
+        case REG_R_ERROR:
+            pStatus = (PREG_IPC_STATUS) out.data;
+            status = pStatus->status;
+            BAIL_ON_NT_STATUS(status);
+            break;
+
+        default:
+            status = STATUS_INVALID_PARAMETER;
+            BAIL_ON_NT_STATUS(status);
+    }
+
+cleanup:
+    if (pCall)
+    {
+        lwmsg_call_destroy_params(pCall, &out);
+        lwmsg_call_release(pCall);
+    }
+
+    return status;
+
+error:
+    goto cleanup;
+}
+
+static
+VOID
+RegIpcNotifyChangeKeyComplete(
+    LWMsgCall* pCall,
+    LWMsgStatus callStatus,
+    void* data
+    )
+{
+    PREG_CLIENT_NOTIFY_CALL pNotifyCall = data;
+    NTSTATUS status = MAP_LWMSG_ERROR(callStatus);
+    DWORD dwSequence = 0;
+
+    if (callStatus == LWMSG_STATUS_CANCELLED)
+    {
+        status = STATUS_CANCELLED;
+    }
+
+    if (!status)
+    {
+        switch (pNotifyCall->out.tag)
+        {
+            case REG_R_NOTIFY_CHANGE_KEY:
+                dwSequence = ((PREG_IPC_NOTIFY_CHANGE_KEY_RESPONSE)
+                              pNotifyCall->out.data)->dwSequence;
+                break;
+
+            case REG_R_ERROR:
+                status = ((PREG_IPC_STATUS) pNotifyCall->out.data)->status;
+                break;
+
+            default:
+                status = STATUS_INVALID_PARAMETER;
+                break;
+        }
+    }
+
+    pNotifyCall->pfnComplete(pNotifyCall->pContext, status, dwSequence);
+}
+
+NTSTATUS
+RegTransactBeginNotifyChangeKey(
+    IN HANDLE hRegConnection,
+    IN HKEY hKey,
+    IN DWORD dwSubKeyCount,
+    IN OPTIONAL PWSTR* ppSubKeys,
+    IN BOOLEAN bWatchSubtree,
+    IN DWORD dwSequence,
+    IN PREG_NOTIFY_CHANGE_KEY_COMPLETE pfnComplete,
+    IN PVOID pContext,
+    OUT PREG_CLIENT_NOTIFY_CALL* ppNotifyCall
+    )
+{
+    NTSTATUS status = 0;
+    LWMsgStatus callStatus = LWMSG_STATUS_SUCCESS;
+    PREG_CLIENT_NOTIFY_CALL pNotifyCall = NULL;
+    static const LWMsgParams init = LWMSG_PARAMS_INITIALIZER;
+
+    status = LW_RTL_ALLOCATE((PVOID*)&pNotifyCall, REG_CLIENT_NOTIFY_CALL, sizeof(*pNotifyCall));
+    BAIL_ON_NT_STATUS(status);
+
+    pNotifyCall->in = init;
+    pNotifyCall->out = init;
+    pNotifyCall->pfnComplete = pfnComplete;
+    pNotifyCall->pContext = pContext;
+
+    status = RegIpcAcquireCall(hRegConnection, &pNotifyCall->pCall);
+    BAIL_ON_NT_STATUS(status);
+
+    pNotifyCall->NotifyReq.hKey = hKey;
+    pNotifyCall->NotifyReq.dwSubKeyCount = dwSubKeyCount;
+    pNotifyCall->NotifyReq.ppSubKeys = ppSubKeys;
+    pNotifyCall->NotifyReq.bWatchSubtree = bWatchSubtree;
+    pNotifyCall->NotifyReq.dwSequence = dwSequence;
+
+    pNotifyCall->in.tag = REG_Q_NOTIFY_CHANGE_KEY;
+    pNotifyCall->in.data = &pNotifyCall->NotifyReq;
+
+    callStatus = lwmsg_call_dispatch(
+                    pNotifyCall->pCall,
+                    &pNotifyCall->in,
+                    &pNotifyCall->out,
+                    RegIpcNotifyChangeKeyComplete,
+                    pNotifyCall);
+    switch (callStatus)
+    {
+        case LWMSG_STATUS_PENDING:
+            break;
+
+        case LWMSG_STATUS_SUCCESS:
+            // Answered without waiting; report it the same way
+            RegIpcNotifyChangeKeyComplete(
+                    pNotifyCall->pCall,
+                    callStatus,
+                    pNotifyCall);
+            break;
+
+        default:
+            status = MAP_LWMSG_ERROR(callStatus);
+            BAIL_ON_NT_STATUS(status);
+    }
+
+    *ppNotifyCall = pNotifyCall;
+
+cleanup:
+
+    return status;
+
+error:
+
+    RegTransactFreeNotifyChangeKey(pNotifyCall);
+    *ppNotifyCall = NULL;
+
+    goto cleanup;
+}
+
+VOID
+RegTransactCancelNotifyChangeKey(
+    IN PREG_CLIENT_NOTIFY_CALL pNotifyCall
+    )
+{
+    if (pNotifyCall && pNotifyCall->pCall)
+    {
+        lwmsg_call_cancel(pNotifyCall->pCall);
+    }
+}
+
+VOID
+RegTransactFreeNotifyChangeKey(
+    IN PREG_CLIENT_NOTIFY_CALL pNotifyCall
+    )
+{
+    if (pNotifyCall)
+    {
+        if (pNotifyCall->pCall)
+        {
+            lwmsg_call_destroy_params(pNotifyCall->pCall, &pNotifyCall->out);
+            lwmsg_call_release(pNotifyCall->pCall);
+        }
+
+        LWREG_SAFE_FREE_MEMORY(pNotifyCall);
+    }
+}
+
 /*
 local variables:
 mode: c
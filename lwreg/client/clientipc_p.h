@@ -59,6 +59,23 @@ typedef struct __REG_CLIENT_CONNECTION_CONTEXT
     LWMsgSession* pSession;
 } REG_CLIENT_CONNECTION_CONTEXT, *PREG_CLIENT_CONNECTION_CONTEXT;
 
+typedef VOID
+(*PREG_NOTIFY_CHANGE_KEY_COMPLETE)(
+    IN PVOID pContext,
+    IN NTSTATUS status,
+    IN DWORD dwSequence
+    );
+
+typedef struct __REG_CLIENT_NOTIFY_CALL
+{
+    LWMsgCall* pCall;
+    LWMsgParams in;
+    LWMsgParams out;
+    REG_IPC_NOTIFY_CHANGE_KEY_REQ NotifyReq;
+    PREG_NOTIFY_CHANGE_KEY_COMPLETE pfnComplete;
+    PVOID pContext;
+} REG_CLIENT_NOTIFY_CALL, *PREG_CLIENT_NOTIFY_CALL;
+
 NTSTATUS
 RegTransactEnumRootKeysW(
     IN HANDLE hConnection,
@@ -246,5 +263,57 @@ RegTransactDeleteValueAttributesW(
     IN PCWSTR pwszValueName
     );
 
+NTSTATUS
+RegTransactBeginTransaction(
+    IN HANDLE hRegConnection
+    );
+
+NTSTATUS
+RegTransactEndTransaction(
+    IN HANDLE hRegConnection,
+    IN BOOLEAN bCommit
+    );
+
+NTSTATUS
+RegTransactNotifyChangeKey(
+    IN HANDLE hRegConnection,
+    IN HKEY hKey,
+    IN DWORD dwSubKeyCount,
+    IN OPTIONAL PWSTR* ppSubKeys,
+    IN BOOLEAN bWatchSubtree,
+    IN DWORD dwSequence,
+    OUT PDWORD pdwSequence
+    );
+
+/*
+ * Asynchronous form of RegTransactNotifyChangeKey.  On success
+ * pfnComplete runs exactly once, possibly before this returns and
+ * otherwise in an lwmsg thread where it must not block or call back into
+ * the registry.  ppSubKeys must stay valid until then.  The call is freed
+ * with RegTransactFreeNotifyChangeKey after pfnComplete has run.
+ */
+NTSTATUS
+RegTransactBeginNotifyChangeKey(
+    IN HANDLE hRegConnection,
+    IN HKEY hKey,
+    IN DWORD dwSubKeyCount,
+    IN OPTIONAL PWSTR* ppSubKeys,
+    IN BOOLEAN bWatchSubtree,
+    IN DWORD dwSequence,
+    IN PREG_NOTIFY_CHANGE_KEY_COMPLETE pfnComplete,
+    IN PVOID pContext,
+    OUT PREG_CLIENT_NOTIFY_CALL* ppNotifyCall
+    );
+
+VOID
+RegTransactCancelNotifyChangeKey(
+    IN PREG_CLIENT_NOTIFY_CALL pNotifyCall
+    );
+
+VOID
+RegTransactFreeNotifyChangeKey(
+    IN PREG_CLIENT_NOTIFY_CALL pNotifyCall
+    );
+
 #endif /* __CLIENTIPC_P_H__ */
 
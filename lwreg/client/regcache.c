@@ -0,0 +1,790 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software    2004-2008
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the license, or (at
+ * your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+ * General Public License for more details.  You should have received a copy
+ * of the GNU Lesser General Public License along with this program.  If
+ * not, see <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * LESSER GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        regcache.c
+ *
+ * Abstract:
+ *
+ *        Registry
+ *
+ *        Client-side configuration value cache
+ *
+ */
+#include "client.h"
+
+typedef struct _LWREG_CONFIG_CACHE_ENTRY
+{
+    struct _LWREG_CONFIG_CACHE_ENTRY* pNext;
+    PSTR pszSubKey;
+    PSTR pszValueName;
+    REG_DATA_TYPE_FLAGS Flags;
+    // Misses are cached too; most config values are never set
+    NTSTATUS status;
+    DWORD dwType;
+    DWORD cbData;
+    PBYTE pData;
+} LWREG_CONFIG_CACHE_ENTRY, *PLWREG_CONFIG_CACHE_ENTRY;
+
+struct _LWREG_CONFIG_CACHE
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    HANDLE hConnection;
+    HKEY hRootKey;
+
+    PSTR* ppszKeys;
+    // Kept for the lifetime of the cache since a pending notify call
+    // refers to them
+    PWSTR* ppwszKeys;
+    DWORD dwKeyCount;
+
+    PREG_CLIENT_NOTIFY_CALL pNotifyCall;
+    DWORD dwSequence;
+    // A notify call is outstanding; entries may only be trusted while
+    // it is
+    BOOLEAN bArmed;
+    BOOLEAN bArming;
+    // Wakes and fails NtRegConfigCacheWaitForChange until the next
+    // baseline fetch
+    BOOLEAN bCancelWait;
+
+    // Bumped on every invalidation so that a value read over IPC is not
+    // inserted after the cache was flushed underneath it
+    DWORD dwGeneration;
+
+    PLWREG_CONFIG_CACHE_ENTRY pEntries;
+};
+
+// How often a waiter retries arming while the server is unreachable
+#define LWREG_CONFIG_CACHE_REARM_SECS 5
+
+static
+VOID
+RegConfigCacheNotifyComplete(
+    IN PVOID pContext,
+    IN NTSTATUS status,
+    IN DWORD dwSequence
+    );
+
+static
+VOID
+RegConfigCacheArm(
+    IN PLWREG_CONFIG_CACHE pCache
+    );
+
+static
+BOOLEAN
+RegConfigCacheCovers(
+    IN PLWREG_CONFIG_CACHE pCache,
+    IN PCSTR pszSubKey
+    );
+
+static
+PLWREG_CONFIG_CACHE_ENTRY
+RegConfigCacheFind_inlock(
+    IN PLWREG_CONFIG_CACHE pCache,
+    IN PCSTR pszSubKey,
+    IN OPTIONAL PCSTR pszValueName,
+    IN REG_DATA_TYPE_FLAGS Flags
+    );
+
+static
+NTSTATUS
+RegConfigCacheCopyOut(
+    IN NTSTATUS status,
+    IN DWORD dwType,
+    IN DWORD cbData,
+    IN PBYTE pData,
+    OUT OPTIONAL PDWORD pdwType,
+    OUT OPTIONAL PVOID pvData,
+    IN OUT OPTIONAL PDWORD pcbData
+    );
+
+static
+VOID
+RegConfigCacheFlush_inlock(
+    IN PLWREG_CONFIG_CACHE pCache
+    );
+
+static
+VOID
+RegConfigCacheFreeEntry(
+    IN PLWREG_CONFIG_CACHE_ENTRY pEntry
+    );
+
+NTSTATUS
+NtRegOpenConfigCache(
+    IN HANDLE hRegConnection,
+    IN DWORD dwKeyCount,
+    IN PCSTR* ppszKeys,
+    OUT PLWREG_CONFIG_CACHE* ppCache
+    )
+{
+    NTSTATUS status = 0;
+    PLWREG_CONFIG_CACHE pCache = NULL;
+    DWORD iKey = 0;
+
+    if (!hRegConnection || !dwKeyCount || !ppszKeys || !ppCache)
+    {
+        status = STATUS_INVALID_PARAMETER;
+        BAIL_ON_NT_STATUS(status);
+    }
+
+    status = LW_RTL_ALLOCATE((PVOID*)&pCache, LWREG_CONFIG_CACHE, sizeof(*pCache));
+    BAIL_ON_NT_STATUS(status);
+
+    pthread_mutex_init(&pCache->mutex, NULL);
+    pthread_cond_init(&pCache->cond, NULL);
+
+    pCache->hConnection = hRegConnection;
+    // 0 is what waiters pass to fetch a baseline
+    pCache->dwGeneration = 1;
+
+    status = LW_RTL_ALLOCATE((PVOID*)&pCache->ppszKeys, PSTR, sizeof(*pCache->ppszKeys) * dwKeyCount);
+    BAIL_ON_NT_STATUS(status);
+
+    status = LW_RTL_ALLOCATE((PVOID*)&pCache->ppwszKeys, PWSTR, sizeof(*pCache->ppwszKeys) * dwKeyCount);
+    BAIL_ON_NT_STATUS(status);
+
+    for (iKey = 0; iKey < dwKeyCount; iKey++)
+    {
+        status = LwRtlCStringDuplicate(&pCache->ppszKeys[iKey], ppszKeys[iKey]);
+        BAIL_ON_NT_STATUS(status);
+
+        status = LwRtlWC16StringAllocateFromCString(&pCache->ppwszKeys[iKey], ppszKeys[iKey]);
+        BAIL_ON_NT_STATUS(status);
+
+        pCache->dwKeyCount++;
+    }
+
+    status = NtRegOpenKeyExA(
+                hRegConnection,
+                NULL,
+                HKEY_THIS_MACHINE,
+                0,
+                KEY_READ,
+                &pCache->hRootKey);
+    BAIL_ON_NT_STATUS(status);
+
+    // Nothing can be cached until the first notify call is armed
+    RegConfigCacheArm(pCache);
+
+    *ppCache = pCache;
+
+cleanup:
+
+    return status;
+
+error:
+
+    if (pCache)
+    {
+        NtRegCloseConfigCache(pCache);
+    }
+
+    if (ppCache)
+    {
+        *ppCache = NULL;
+    }
+
+    goto cleanup;
+}
+
+NTSTATUS
+NtRegConfigCacheGetValueA(
+    IN PLWREG_CONFIG_CACHE pCache,
+    IN PCSTR pszSubKey,
+    IN OPTIONAL PCSTR pszValueName,
+    IN OPTIONAL REG_DATA_TYPE_FLAGS Flags,
+    OUT OPTIONAL PDWORD pdwType,
+    OUT OPTIONAL PVOID pvData,
+    IN OUT OPTIONAL PDWORD pcbData
+    )
+{
+    NTSTATUS status = 0;
+    NTSTATUS valueStatus = 0;
+    BOOLEAN bArm = FALSE;
+    BOOLEAN bCacheable = FALSE;
+    DWORD dwGeneration = 0;
+    PLWREG_CONFIG_CACHE_ENTRY pEntry = NULL;
+    DWORD dwType = REG_NONE;
+    DWORD cbData = MAX_VALUE_LENGTH;
+    BYTE data[MAX_VALUE_LENGTH];
+
+    if (!pCache || !pszSubKey || (pvData && !pcbData))
+    {
+        status = STATUS_INVALID_PARAMETER;
+        BAIL_ON_NT_STATUS(status);
+    }
+
+    if (!RegConfigCacheCovers(pCache, pszSubKey))
+    {
+        status = NtRegGetValueA(
+                    pCache->hConnection,
+                    pCache->hRootKey,
+                    pszSubKey,
+                    pszValueName,
+                    Flags,
+                    pdwType,
+                    pvData,
+                    pcbData);
+        goto cleanup;
+    }
+
+    pthread_mutex_lock(&pCache->mutex);
+
+    if (!pCache->bArmed && !pCache->bArming)
+    {
+        pCache->bArming = TRUE;
+        bArm = TRUE;
+    }
+
+    pthread_mutex_unlock(&pCache->mutex);
+
+    // Re-arm outside the lock; the completion callback takes it
+    if (bArm)
+    {
+        RegConfigCacheArm(pCache);
+    }
+
+    pthread_mutex_lock(&pCache->mutex);
+
+    if (pCache->bArmed)
+    {
+        pEntry = RegConfigCacheFind_inlock(pCache, pszSubKey, pszValueName, Flags);
+        if (pEntry)
+        {
+            status = RegConfigCacheCopyOut(
+                        pEntry->status,
+                        pEntry->dwType,
+                        pEntry->cbData,
+                        pEntry->pData,
+                        pdwType,
+                        pvData,
+                        pcbData);
+            pthread_mutex_unlock(&pCache->mutex);
+            goto cleanup;
+        }
+
+        bCacheable = TRUE;
+        dwGeneration = pCache->dwGeneration;
+    }
+
+    pthread_mutex_unlock(&pCache->mutex);
+
+    valueStatus = NtRegGetValueA(
+                    pCache->hConnection,
+                    pCache->hRootKey,
+                    pszSubKey,
+                    pszValueName,
+                    Flags,
+                    &dwType,
+                    data,
+                    &cbData);
+    if (valueStatus)
+    {
+        dwType = REG_NONE;
+        cbData = 0;
+    }
+
+    if (bCacheable &&
+        (valueStatus == STATUS_SUCCESS ||
+         valueStatus == STATUS_OBJECT_NAME_NOT_FOUND))
+    {
+        status = LW_RTL_ALLOCATE((PVOID*)&pEntry, LWREG_CONFIG_CACHE_ENTRY, sizeof(*pEntry));
+        if (!status)
+        {
+            status = LwRtlCStringDuplicate(&pEntry->pszSubKey, pszSubKey);
+        }
+        if (!status && pszValueName)
+        {
+            status = LwRtlCStringDuplicate(&pEntry->pszValueName, pszValueName);
+        }
+        if (!status && cbData)
+        {
+            status = LW_RTL_ALLOCATE((PVOID*)&pEntry->pData, BYTE, cbData);
+        }
+
+        if (!status)
+        {
+            pEntry->Flags = Flags;
+            pEntry->status = valueStatus;
+            pEntry->dwType = dwType;
+            pEntry->cbData = cbData;
+            if (cbData)
+            {
+                memcpy(pEntry->pData, data, cbData);
+            }
+
+            pthread_mutex_lock(&pCache->mutex);
+
+            if (pCache->bArmed &&
+                pCache->dwGeneration == dwGeneration &&
+                !RegConfigCacheFind_inlock(pCache, pszSubKey, pszValueName, Flags))
+            {
+                pEntry->pNext = pCache->pEntries;
+                pCache->pEntries = pEntry;
+                pEntry = NULL;
+            }
+
+            pthread_mutex_unlock(&pCache->mutex);
+        }
+
+        // Failing to cache is not the caller's problem
+        status = STATUS_SUCCESS;
+    }
+
+    status = RegConfigCacheCopyOut(
+                valueStatus,
+                dwType,
+                cbData,
+                data,
+                pdwType,
+                pvData,
+                pcbData);
+
+cleanup:
+
+    if (pEntry && bCacheable)
+    {
+        RegConfigCacheFreeEntry(pEntry);
+    }
+
+    return status;
+
+error:
+
+    goto cleanup;
+}
+
+NTSTATUS
+NtRegConfigCacheWaitForChange(
+    IN PLWREG_CONFIG_CACHE pCache,
+    IN OUT PDWORD pdwGeneration
+    )
+{
+    NTSTATUS status = 0;
+    BOOLEAN bArm = FALSE;
+    struct timespec timeout = {0};
+
+    if (!pCache || !pdwGeneration)
+    {
+        status = STATUS_INVALID_PARAMETER;
+        BAIL_ON_NT_STATUS(status);
+    }
+
+    pthread_mutex_lock(&pCache->mutex);
+
+    if (!*pdwGeneration)
+    {
+        // A new watcher starts from a clean slate
+        pCache->bCancelWait = FALSE;
+    }
+
+    for (;;)
+    {
+        if (pCache->bCancelWait)
+        {
+            status = STATUS_CANCELLED;
+            break;
+        }
+
+        if (*pdwGeneration && *pdwGeneration != pCache->dwGeneration)
+        {
+            break;
+        }
+
+        if (!pCache->bArmed && !pCache->bArming)
+        {
+            pCache->bArming = TRUE;
+            bArm = TRUE;
+        }
+
+        if (bArm)
+        {
+            pthread_mutex_unlock(&pCache->mutex);
+            RegConfigCacheArm(pCache);
+            pthread_mutex_lock(&pCache->mutex);
+
+            bArm = FALSE;
+
+            // A new baseline bumps the generation
+            if (*pdwGeneration)
+            {
+                continue;
+            }
+        }
+
+        if (!*pdwGeneration)
+        {
+            // Only fetching the baseline
+            break;
+        }
+
+        if (pCache->bArmed)
+        {
+            pthread_cond_wait(&pCache->cond, &pCache->mutex);
+        }
+        else
+        {
+            // Arming failed or is under way in another thread; retry
+            // later rather than miss a change for good
+            clock_gettime(CLOCK_REALTIME, &timeout);
+            timeout.tv_sec += LWREG_CONFIG_CACHE_REARM_SECS;
+
+            pthread_cond_timedwait(&pCache->cond, &pCache->mutex, &timeout);
+        }
+    }
+
+    *pdwGeneration = pCache->dwGeneration;
+
+    pthread_mutex_unlock(&pCache->mutex);
+
+cleanup:
+
+    return status;
+
+error:
+
+    goto cleanup;
+}
+
+VOID
+NtRegConfigCacheCancelWait(
+    IN PLWREG_CONFIG_CACHE pCache
+    )
+{
+    if (!pCache)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pCache->mutex);
+
+    pCache->bCancelWait = TRUE;
+    pthread_cond_broadcast(&pCache->cond);
+
+    pthread_mutex_unlock(&pCache->mutex);
+}
+
+VOID
+NtRegCloseConfigCache(
+    IN PLWREG_CONFIG_CACHE pCache
+    )
+{
+    DWORD iKey = 0;
+
+    if (!pCache)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pCache->mutex);
+
+    if (pCache->bArmed)
+    {
+        pthread_mutex_unlock(&pCache->mutex);
+
+        RegTransactCancelNotifyChangeKey(pCache->pNotifyCall);
+
+        pthread_mutex_lock(&pCache->mutex);
+
+        while (pCache->bArmed)
+        {
+            pthread_cond_wait(&pCache->cond, &pCache->mutex);
+        }
+    }
+
+    RegConfigCacheFlush_inlock(pCache);
+
+    pthread_mutex_unlock(&pCache->mutex);
+
+    RegTransactFreeNotifyChangeKey(pCache->pNotifyCall);
+
+    if (pCache->hRootKey)
+    {
+        NtRegCloseKey(pCache->hConnection, pCache->hRootKey);
+    }
+
+    for (iKey = 0; iKey < pCache->dwKeyCount; iKey++)
+    {
+        LwRtlCStringFree(&pCache->ppszKeys[iKey]);
+        LwRtlWC16StringFree(&pCache->ppwszKeys[iKey]);
+    }
+    LWREG_SAFE_FREE_MEMORY(pCache->ppszKeys);
+    LWREG_SAFE_FREE_MEMORY(pCache->ppwszKeys);
+
+    pthread_cond_destroy(&pCache->cond);
+    pthread_mutex_destroy(&pCache->mutex);
+
+    LWREG_SAFE_FREE_MEMORY(pCache);
+}
+
+static
+VOID
+RegConfigCacheArm(
+    IN PLWREG_CONFIG_CACHE pCache
+    )
+{
+    NTSTATUS status = 0;
+    PREG_CLIENT_NOTIFY_CALL pOldCall = NULL;
+    PREG_CLIENT_NOTIFY_CALL pNotifyCall = NULL;
+    DWORD dwSequence = 0;
+
+    pthread_mutex_lock(&pCache->mutex);
+
+    // The previous call has completed (bArmed is clear), so it can go
+    pOldCall = pCache->pNotifyCall;
+    pCache->pNotifyCall = NULL;
+    dwSequence = pCache->dwSequence;
+
+    pthread_mutex_unlock(&pCache->mutex);
+
+    RegTransactFreeNotifyChangeKey(pOldCall);
+
+    if (!dwSequence)
+    {
+        // No baseline yet (first use, or the server went away); anything
+        // read from now on is newer than what the server hands back here.
+        status = RegTransactNotifyChangeKey(
+                    pCache->hConnection,
+                    pCache->hRootKey,
+                    pCache->dwKeyCount,
+                    pCache->ppwszKeys,
+                    TRUE,
+                    0,
+                    &dwSequence);
+        BAIL_ON_NT_STATUS(status);
+    }
+
+    pthread_mutex_lock(&pCache->mutex);
+
+    if (!pCache->dwSequence)
+    {
+        // Whatever changed while there was no baseline went unreported,
+        // so waiters must re-read as if it had been
+        RegConfigCacheFlush_inlock(pCache);
+        pthread_cond_broadcast(&pCache->cond);
+    }
+
+    pCache->dwSequence = dwSequence;
+    pCache->bArmed = TRUE;
+
+    pthread_mutex_unlock(&pCache->mutex);
+
+    status = RegTransactBeginNotifyChangeKey(
+                pCache->hConnection,
+                pCache->hRootKey,
+                pCache->dwKeyCount,
+                pCache->ppwszKeys,
+                TRUE,
+                dwSequence,
+                RegConfigCacheNotifyComplete,
+                pCache,
+                &pNotifyCall);
+    if (status)
+    {
+        pthread_mutex_lock(&pCache->mutex);
+        pCache->bArmed = FALSE;
+        pthread_mutex_unlock(&pCache->mutex);
+
+        BAIL_ON_NT_STATUS(status);
+    }
+
+    pthread_mutex_lock(&pCache->mutex);
+    pCache->pNotifyCall = pNotifyCall;
+    pthread_mutex_unlock(&pCache->mutex);
+
+cleanup:
+
+    pthread_mutex_lock(&pCache->mutex);
+    pCache->bArming = FALSE;
+    pthread_cond_broadcast(&pCache->cond);
+    pthread_mutex_unlock(&pCache->mutex);
+
+    return;
+
+error:
+
+    // Reads go to the server until a later read manages to re-arm
+    goto cleanup;
+}
+
+static
+VOID
+RegConfigCacheNotifyComplete(
+    IN PVOID pContext,
+    IN NTSTATUS status,
+    IN DWORD dwSequence
+    )
+{
+    PLWREG_CONFIG_CACHE pCache = pContext;
+
+    // Runs in an lwmsg thread: no IPC from here, only drop what is stale
+    pthread_mutex_lock(&pCache->mutex);
+
+    RegConfigCacheFlush_inlock(pCache);
+
+    pCache->dwSequence = status ? 0 : dwSequence;
+    pCache->bArmed = FALSE;
+    pthread_cond_broadcast(&pCache->cond);
+
+    pthread_mutex_unlock(&pCache->mutex);
+}
+
+static
+BOOLEAN
+RegConfigCacheCovers(
+    IN PLWREG_CONFIG_CACHE pCache,
+    IN PCSTR pszSubKey
+    )
+{
+    DWORD iKey = 0;
+    size_t sLen = 0;
+
+    for (iKey = 0; iKey < pCache->dwKeyCount; iKey++)
+    {
+        sLen = strlen(pCache->ppszKeys[iKey]);
+
+        if (!strncasecmp(pszSubKey, pCache->ppszKeys[iKey], sLen) &&
+            (pszSubKey[sLen] == '\0' || pszSubKey[sLen] == '\\'))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static
+PLWREG_CONFIG_CACHE_ENTRY
+RegConfigCacheFind_inlock(
+    IN PLWREG_CONFIG_CACHE pCache,
+    IN PCSTR pszSubKey,
+    IN OPTIONAL PCSTR pszValueName,
+    IN REG_DATA_TYPE_FLAGS Flags
+    )
+{
+    PLWREG_CONFIG_CACHE_ENTRY pEntry = NULL;
+
+    for (pEntry = pCache->pEntries; pEntry; pEntry = pEntry->pNext)
+    {
+        if (pEntry->Flags == Flags &&
+            !strcasecmp(pEntry->pszSubKey, pszSubKey) &&
+            (pEntry->pszValueName && pszValueName ?
+             !strcasecmp(pEntry->pszValueName, pszValueName) :
+             pEntry->pszValueName == pszValueName))
+        {
+            return pEntry;
+        }
+    }
+
+    return NULL;
+}
+
+static
+NTSTATUS
+RegConfigCacheCopyOut(
+    IN NTSTATUS status,
+    IN DWORD dwType,
+    IN DWORD cbData,
+    IN PBYTE pData,
+    OUT OPTIONAL PDWORD pdwType,
+    OUT OPTIONAL PVOID pvData,
+    IN OUT OPTIONAL PDWORD pcbData
+    )
+{
+    if (!status && pvData && *pcbData < cbData)
+    {
+        status = STATUS_BUFFER_TOO_SMALL;
+    }
+
+    if (status)
+    {
+        dwType = REG_NONE;
+        cbData = status == STATUS_BUFFER_TOO_SMALL ? cbData : 0;
+    }
+    else if (pvData)
+    {
+        memcpy(pvData, pData, cbData);
+    }
+
+    if (pdwType)
+    {
+        *pdwType = dwType;
+    }
+
+    if (pcbData)
+    {
+        *pcbData = cbData;
+    }
+
+    return status;
+}
+
+static
+VOID
+RegConfigCacheFlush_inlock(
+    IN PLWREG_CONFIG_CACHE pCache
+    )
+{
+    PLWREG_CONFIG_CACHE_ENTRY pEntry = NULL;
+
+    while (pCache->pEntries)
+    {
+        pEntry = pCache->pEntries;
+        pCache->pEntries = pEntry->pNext;
+
+        RegConfigCacheFreeEntry(pEntry);
+    }
+
+    if (++pCache->dwGeneration == 0)
+    {
+        pCache->dwGeneration++;
+    }
+}
+
+static
+VOID
+RegConfigCacheFreeEntry(
+    IN PLWREG_CONFIG_CACHE_ENTRY pEntry
+    )
+{
+    LwRtlCStringFree(&pEntry->pszSubKey);
+    LwRtlCStringFree(&pEntry->pszValueName);
+    LWREG_SAFE_FREE_MEMORY(pEntry->pData);
+    LWREG_SAFE_FREE_MEMORY(pEntry);
+}
@@ -867,3 +867,56 @@ LwRegDeleteValueAttributesW(
                 )
                 );
 }
+
+REG_API
+DWORD
+LwRegBeginTransaction(
+    IN HANDLE hRegConnection
+    )
+{
+    return RegNtStatusToWin32Error(
+            NtRegBeginTransaction(hRegConnection)
+            );
+}
+
+REG_API
+DWORD
+LwRegCommitTransaction(
+    IN HANDLE hRegConnection
+    )
+{
+    return RegNtStatusToWin32Error(
+            NtRegCommitTransaction(hRegConnection)
+            );
+}
+
+REG_API
+DWORD
+LwRegRollbackTransaction(
+    IN HANDLE hRegConnection
+    )
+{
+    return RegNtStatusToWin32Error(
+            NtRegRollbackTransaction(hRegConnection)
+            );
+}
+
+REG_API
+DWORD
+LwRegNotifyChangeKeyValue(
+    IN HANDLE hRegConnection,
+    IN HKEY hKey,
+    IN OPTIONAL PCWSTR pwszSubKey,
+    IN BOOLEAN bWatchSubtree,
+    IN OUT PDWORD pdwSequence
+    )
+{
+    return RegNtStatusToWin32Error(
+            NtRegNotifyChangeKeyValue(
+                hRegConnection,
+                hKey,
+                pwszSubKey,
+                bWatchSubtree,
+                pdwSequence)
+            );
+}
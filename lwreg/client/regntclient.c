@@ -1451,3 +1451,70 @@ NtRegDeleteValueAttributesW(
             );
 }
 
+NTSTATUS
+NtRegBeginTransaction(
+    IN HANDLE hRegConnection
+    )
+{
+    return RegTransactBeginTransaction(hRegConnection);
+}
+
+NTSTATUS
+NtRegCommitTransaction(
+    IN HANDLE hRegConnection
+    )
+{
+    return RegTransactEndTransaction(hRegConnection, TRUE);
+}
+
+NTSTATUS
+NtRegRollbackTransaction(
+    IN HANDLE hRegConnection
+    )
+{
+    return RegTransactEndTransaction(hRegConnection, FALSE);
+}
+
+NTSTATUS
+NtRegNotifyChangeKeyValue(
+    IN HANDLE hRegConnection,
+    IN HKEY hKey,
+    IN OPTIONAL PCWSTR pwszSubKey,
+    IN BOOLEAN bWatchSubtree,
+    IN OUT PDWORD pdwSequence
+    )
+{
+    NTSTATUS status = 0;
+    PWSTR pwszSubKeyCopy = NULL;
+
+    if (!pdwSequence)
+    {
+        status = STATUS_INVALID_PARAMETER;
+        BAIL_ON_NT_STATUS(status);
+    }
+
+    if (pwszSubKey)
+    {
+        status = LwRtlWC16StringDuplicate(&pwszSubKeyCopy, pwszSubKey);
+        BAIL_ON_NT_STATUS(status);
+    }
+
+    status = RegTransactNotifyChangeKey(
+                hRegConnection,
+                hKey,
+                pwszSubKeyCopy ? 1 : 0,
+                pwszSubKeyCopy ? &pwszSubKeyCopy : NULL,
+                bWatchSubtree,
+                *pdwSequence,
+                pdwSequence);
+    BAIL_ON_NT_STATUS(status);
+
+cleanup:
+    LWREG_SAFE_FREE_MEMORY(pwszSubKeyCopy);
+
+    return status;
+
+error:
+    goto cleanup;
+}
+
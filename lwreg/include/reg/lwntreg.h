@@ -477,6 +477,101 @@ LwNtRegDeleteValueAttributesW(
     IN PCWSTR pwszValueName
     );
 
+/*
+ * Group the following writes on this connection into one database
+ * transaction. Calls nest; only the outermost commit writes the batch.
+ * Writes and transactions from other connections are held by the server
+ * until the batch ends. Closing the connection rolls back.
+ */
+NTSTATUS
+LwNtRegBeginTransaction(
+    IN HANDLE hRegConnection
+    );
+
+NTSTATUS
+LwNtRegCommitTransaction(
+    IN HANDLE hRegConnection
+    );
+
+NTSTATUS
+LwNtRegRollbackTransaction(
+    IN HANDLE hRegConnection
+    );
+
+/*
+ * Wait until the key (or pSubKey below it) changes.  *pdwSequence is the
+ * change sequence returned by the previous call, or 0 to just fetch the
+ * current one without waiting.  The call returns at once when a matching
+ * change happened since that sequence or when the server can no longer
+ * tell, so callers should simply re-read and call again.  Needs KEY_NOTIFY.
+ */
+NTSTATUS
+LwNtRegNotifyChangeKeyValue(
+    IN HANDLE hRegConnection,
+    IN HKEY hKey,
+    IN OPTIONAL PCWSTR pwszSubKey,
+    IN BOOLEAN bWatchSubtree,
+    IN OUT PDWORD pdwSequence
+    );
+
+typedef struct _LWREG_CONFIG_CACHE LWREG_CONFIG_CACHE, *PLWREG_CONFIG_CACHE;
+
+/*
+ * In-process cache of values below the given keys of HKEY_THIS_MACHINE.
+ * Entries are dropped as soon as the registry reports a change under any
+ * of the keys, so a cached read is never older than the last change.
+ * Reads outside the keys go straight to the server.  Settings a process
+ * derived from earlier reads only change when it re-reads them; see
+ * LwNtRegConfigCacheWaitForChange.
+ */
+NTSTATUS
+LwNtRegOpenConfigCache(
+    IN HANDLE hRegConnection,
+    IN DWORD dwKeyCount,
+    IN PCSTR* ppszKeys,
+    OUT PLWREG_CONFIG_CACHE* ppCache
+    );
+
+/*
+ * Same contract as LwNtRegGetValueA against HKEY_THIS_MACHINE.
+ */
+NTSTATUS
+LwNtRegConfigCacheGetValueA(
+    IN PLWREG_CONFIG_CACHE pCache,
+    IN PCSTR pszSubKey,
+    IN OPTIONAL PCSTR pszValueName,
+    IN OPTIONAL REG_DATA_TYPE_FLAGS Flags,
+    OUT OPTIONAL PDWORD pdwType,
+    OUT OPTIONAL PVOID pvData,
+    IN OUT OPTIONAL PDWORD pcbData
+    );
+
+/*
+ * Wait until something under the cached keys changes.  *pdwGeneration is
+ * the value returned by the previous call, or 0 to just fetch the current
+ * one; re-read configuration after each return.  Returns STATUS_CANCELLED
+ * once LwNtRegConfigCacheCancelWait has been called, until the next
+ * baseline fetch.
+ */
+NTSTATUS
+LwNtRegConfigCacheWaitForChange(
+    IN PLWREG_CONFIG_CACHE pCache,
+    IN OUT PDWORD pdwGeneration
+    );
+
+VOID
+LwNtRegConfigCacheCancelWait(
+    IN PLWREG_CONFIG_CACHE pCache
+    );
+
+/*
+ * Must not race with reads or waits on the same cache.
+ */
+VOID
+LwNtRegCloseConfigCache(
+    IN PLWREG_CONFIG_CACHE pCache
+    );
+
 
 #ifndef LW_STRICT_NAMESPACE
 #define NtRegOpenServer LwNtRegOpenServer
@@ -540,6 +635,15 @@ LwNtRegDeleteValueAttributesW(
 #define NtRegGetValueAttributesW LwNtRegGetValueAttributesW
 #define NtRegDeleteValueAttributesA LwNtRegDeleteValueAttributesA
 #define NtRegDeleteValueAttributesW LwNtRegDeleteValueAttributesW
+#define NtRegBeginTransaction LwNtRegBeginTransaction
+#define NtRegCommitTransaction LwNtRegCommitTransaction
+#define NtRegRollbackTransaction LwNtRegRollbackTransaction
+#define NtRegNotifyChangeKeyValue LwNtRegNotifyChangeKeyValue
+#define NtRegOpenConfigCache LwNtRegOpenConfigCache
+#define NtRegConfigCacheGetValueA LwNtRegConfigCacheGetValueA
+#define NtRegConfigCacheWaitForChange LwNtRegConfigCacheWaitForChange
+#define NtRegConfigCacheCancelWait LwNtRegConfigCacheCancelWait
+#define NtRegCloseConfigCache LwNtRegCloseConfigCache
 
 #endif /* ! LW_STRICT_NAMESPACE */
 
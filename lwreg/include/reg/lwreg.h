@@ -493,6 +493,30 @@ LwRegDeleteValueAttributesW(
     IN PCWSTR pwszValueName
     );
 
+DWORD
+LwRegBeginTransaction(
+    IN HANDLE hRegConnection
+    );
+
+DWORD
+LwRegCommitTransaction(
+    IN HANDLE hRegConnection
+    );
+
+DWORD
+LwRegRollbackTransaction(
+    IN HANDLE hRegConnection
+    );
+
+DWORD
+LwRegNotifyChangeKeyValue(
+    IN HANDLE hRegConnection,
+    IN HKEY hKey,
+    IN OPTIONAL PCWSTR pwszSubKey,
+    IN BOOLEAN bWatchSubtree,
+    IN OUT PDWORD pdwSequence
+    );
+
 
 #ifndef LW_STRICT_NAMESPACE
 #define RegOpenServer LwRegOpenServer
@@ -557,6 +581,10 @@ LwRegDeleteValueAttributesW(
 #define RegGetValueAttributesW LwRegGetValueAttributesW
 #define RegDeleteValueAttributesA LwRegDeleteValueAttributesA
 #define RegDeleteValueAttributesW LwRegDeleteValueAttributesW
+#define RegBeginTransaction LwRegBeginTransaction
+#define RegCommitTransaction LwRegCommitTransaction
+#define RegRollbackTransaction LwRegRollbackTransaction
+#define RegNotifyChangeKeyValue LwRegNotifyChangeKeyValue
 
 #endif /* ! LW_STRICT_NAMESPACE */
 
@@ -94,7 +94,13 @@ typedef enum __REG_IPC_TAG
     REG_Q_GET_VALUEW_ATTRIBUTES,
     REG_R_GET_VALUEW_ATTRIBUTES,
     REG_Q_DELETE_VALUEW_ATTRIBUTES,
-    REG_R_DELETE_VALUEW_ATTRIBUTES
+    REG_R_DELETE_VALUEW_ATTRIBUTES,
+    REG_Q_BEGIN_TRANSACTION,
+    REG_R_BEGIN_TRANSACTION,
+    REG_Q_END_TRANSACTION,
+    REG_R_END_TRANSACTION,
+    REG_Q_NOTIFY_CHANGE_KEY,
+    REG_R_NOTIFY_CHANGE_KEY
 } REG_IPC_TAG;
 
 /* Opaque type -- actual definition in state_p.h - LSA_SRV_ENUM_STATE */
@@ -513,6 +519,34 @@ typedef struct __REG_IPC_GET_VALUE_ATTRS_RESPONSE
     PLWREG_VALUE_ATTRIBUTES pValueAttributes;
 } REG_IPC_GET_VALUE_ATTRS_RESPONSE, *PREG_IPC_GET_VALUE_ATTRS_RESPONSE;
 
+// IN BOOLEAN bCommit
+typedef struct __REG_IPC_END_TRANSACTION_REQ
+{
+    BOOLEAN bCommit;
+} REG_IPC_END_TRANSACTION_REQ, *PREG_IPC_END_TRANSACTION_REQ;
+
+/******************************************************************************/
+
+// IN HKEY hKey,
+// IN DWORD dwSubKeyCount,
+// IN OPTIONAL PWSTR* ppSubKeys,
+// IN BOOLEAN bWatchSubtree,
+// IN DWORD dwSequence
+typedef struct __REG_IPC_NOTIFY_CHANGE_KEY_REQ
+{
+    HKEY hKey;
+    DWORD dwSubKeyCount;
+    PWSTR* ppSubKeys;
+    BOOLEAN bWatchSubtree;
+    DWORD dwSequence;
+} REG_IPC_NOTIFY_CHANGE_KEY_REQ, *PREG_IPC_NOTIFY_CHANGE_KEY_REQ;
+
+// OUT DWORD dwSequence
+typedef struct __REG_IPC_NOTIFY_CHANGE_KEY_RESPONSE
+{
+    DWORD dwSequence;
+} REG_IPC_NOTIFY_CHANGE_KEY_RESPONSE, *PREG_IPC_NOTIFY_CHANGE_KEY_RESPONSE;
+
 
 
 
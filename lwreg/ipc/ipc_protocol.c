@@ -806,6 +806,56 @@ static LWMsgTypeSpec gRegGetValueAttrsResp[] =
     LWMSG_TYPE_END
 };
 
+static LWMsgTypeSpec gRegEndTransactionSpec[] =
+{
+    // BOOLEAN bCommit
+
+    LWMSG_STRUCT_BEGIN(REG_IPC_END_TRANSACTION_REQ),
+
+    LWMSG_MEMBER_UINT8(REG_IPC_END_TRANSACTION_REQ, bCommit),
+
+    LWMSG_STRUCT_END,
+    LWMSG_TYPE_END
+};
+
+static LWMsgTypeSpec gRegNotifyChangeKeySpec[] =
+{
+    // HKEY hKey;
+    // DWORD dwSubKeyCount;
+    // PWSTR* ppSubKeys;
+    // BOOLEAN bWatchSubtree;
+    // DWORD dwSequence;
+
+    LWMSG_STRUCT_BEGIN(REG_IPC_NOTIFY_CHANGE_KEY_REQ),
+
+    LWMSG_MEMBER_HANDLE(REG_IPC_NOTIFY_CHANGE_KEY_REQ, hKey, HKEY),
+    LWMSG_ATTR_HANDLE_LOCAL_FOR_RECEIVER,
+
+    LWMSG_MEMBER_UINT32(REG_IPC_NOTIFY_CHANGE_KEY_REQ, dwSubKeyCount),
+    LWMSG_MEMBER_POINTER_BEGIN(REG_IPC_NOTIFY_CHANGE_KEY_REQ, ppSubKeys),
+    LWMSG_PWSTR,
+    LWMSG_POINTER_END,
+    LWMSG_ATTR_LENGTH_MEMBER(REG_IPC_NOTIFY_CHANGE_KEY_REQ, dwSubKeyCount),
+
+    LWMSG_MEMBER_UINT8(REG_IPC_NOTIFY_CHANGE_KEY_REQ, bWatchSubtree),
+    LWMSG_MEMBER_UINT32(REG_IPC_NOTIFY_CHANGE_KEY_REQ, dwSequence),
+
+    LWMSG_STRUCT_END,
+    LWMSG_TYPE_END
+};
+
+static LWMsgTypeSpec gRegNotifyChangeKeyRespSpec[] =
+{
+    // DWORD dwSequence;
+
+    LWMSG_STRUCT_BEGIN(REG_IPC_NOTIFY_CHANGE_KEY_RESPONSE),
+
+    LWMSG_MEMBER_UINT32(REG_IPC_NOTIFY_CHANGE_KEY_RESPONSE, dwSequence),
+
+    LWMSG_STRUCT_END,
+    LWMSG_TYPE_END
+};
+
 
 /******************************************************************************/
 
@@ -856,6 +906,14 @@ static LWMsgProtocolSpec gRegIPCSpec[] =
     LWMSG_MESSAGE(REG_R_GET_VALUEW_ATTRIBUTES, gRegGetValueAttrsResp),
     LWMSG_MESSAGE(REG_Q_DELETE_VALUEW_ATTRIBUTES, gRegDeleteValueAttrsSpec),
     LWMSG_MESSAGE(REG_R_DELETE_VALUEW_ATTRIBUTES, NULL),
+    /*Transaction APIs*/
+    LWMSG_MESSAGE(REG_Q_BEGIN_TRANSACTION, NULL),
+    LWMSG_MESSAGE(REG_R_BEGIN_TRANSACTION, NULL),
+    LWMSG_MESSAGE(REG_Q_END_TRANSACTION, gRegEndTransactionSpec),
+    LWMSG_MESSAGE(REG_R_END_TRANSACTION, NULL),
+    /*Change notification APIs*/
+    LWMSG_MESSAGE(REG_Q_NOTIFY_CHANGE_KEY, gRegNotifyChangeKeySpec),
+    LWMSG_MESSAGE(REG_R_NOTIFY_CHANGE_KEY, gRegNotifyChangeKeyRespSpec),
 
     LWMSG_PROTOCOL_END
 };
@@ -54,6 +54,10 @@ extern REG_SRV_API_CONFIG gAPIConfig;
 
 extern PREGPROV_PROVIDER_FUNCTION_TABLE gpRegProvider;
 
+extern REG_SRV_TRANSACTION_STATE gRegSrvTransaction;
+
+extern REG_SRV_NOTIFY_STATE gRegSrvNotify;
+
 #endif /* __EXTERNS_P_H__ */
 
 /*
@@ -61,3 +61,14 @@ GENERIC_MAPPING gRegKeyGenericMapping = {
 };
 
 PLW_MAP_SECURITY_CONTEXT gpRegLwMapSecurityCtx = NULL;
+
+REG_SRV_TRANSACTION_STATE gRegSrvTransaction =
+{
+    .mutex         = PTHREAD_MUTEX_INITIALIZER,
+    .ppWaitersTail = &gRegSrvTransaction.pWaiters
+};
+
+REG_SRV_NOTIFY_STATE gRegSrvNotify =
+{
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
@@ -48,6 +48,15 @@
  */
 #include "api.h"
 
+static
+LWMsgStatus
+RegSrvIpcAdmitWrite(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    LWMsgPeerCallFunction pfnWrite
+    );
+
 static
 NTSTATUS
 RegSrvIpcCheckPermissions(
@@ -236,6 +245,9 @@ RegSrvCloseServer(
 {
     PREG_SRV_API_STATE pServerState = (PREG_SRV_API_STATE)hServer;
 
+    // Roll back a batch the client left open
+    RegSrvReleaseTransaction(hServer);
+
     if (pServerState->hEventLog != (HANDLE)NULL)
     {
        //RegSrvCloseEventLog(pServerState->hEventLog);
@@ -327,8 +339,9 @@ error:
     goto cleanup;
 }
 
+static
 LWMsgStatus
-RegSrvIpcCreateKeyEx(
+RegSrvIpcCreateKeyExInternal(
     LWMsgCall* pCall,
     const LWMsgParams* pIn,
     LWMsgParams* pOut,
@@ -396,6 +409,17 @@ error:
     goto cleanup;
 }
 
+LWMsgStatus
+RegSrvIpcCreateKeyEx(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    )
+{
+    return RegSrvIpcAdmitWrite(pCall, pIn, pOut, RegSrvIpcCreateKeyExInternal);
+}
+
 LWMsgStatus
 RegSrvIpcOpenKeyExW(
     LWMsgCall* pCall,
@@ -493,8 +517,9 @@ error:
     goto cleanup;
 }
 
+static
 LWMsgStatus
-RegSrvIpcDeleteKey(
+RegSrvIpcDeleteKeyInternal(
     LWMsgCall* pCall,
     const LWMsgParams* pIn,
     LWMsgParams* pOut,
@@ -533,6 +558,17 @@ error:
     goto cleanup;
 }
 
+LWMsgStatus
+RegSrvIpcDeleteKey(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    )
+{
+    return RegSrvIpcAdmitWrite(pCall, pIn, pOut, RegSrvIpcDeleteKeyInternal);
+}
+
 LWMsgStatus
 RegSrvIpcEnumKeyExW(
     LWMsgCall* pCall,
@@ -734,8 +770,9 @@ error:
     goto cleanup;
 }
 
+static
 LWMsgStatus
-RegSrvIpcDeleteKeyValue(
+RegSrvIpcDeleteKeyValueInternal(
     LWMsgCall* pCall,
     const LWMsgParams* pIn,
     LWMsgParams* pOut,
@@ -775,7 +812,19 @@ error:
 }
 
 LWMsgStatus
-RegSrvIpcDeleteTree(
+RegSrvIpcDeleteKeyValue(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    )
+{
+    return RegSrvIpcAdmitWrite(pCall, pIn, pOut, RegSrvIpcDeleteKeyValueInternal);
+}
+
+static
+LWMsgStatus
+RegSrvIpcDeleteTreeInternal(
     LWMsgCall* pCall,
     const LWMsgParams* pIn,
     LWMsgParams* pOut,
@@ -812,9 +861,21 @@ error:
     goto cleanup;
 }
 
+LWMsgStatus
+RegSrvIpcDeleteTree(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    )
+{
+    return RegSrvIpcAdmitWrite(pCall, pIn, pOut, RegSrvIpcDeleteTreeInternal);
+}
 
+
+static
 LWMsgStatus
-RegSrvIpcDeleteValue(
+RegSrvIpcDeleteValueInternal(
     LWMsgCall* pCall,
     const LWMsgParams* pIn,
     LWMsgParams* pOut,
@@ -852,6 +913,17 @@ error:
     goto cleanup;
 }
 
+LWMsgStatus
+RegSrvIpcDeleteValue(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    )
+{
+    return RegSrvIpcAdmitWrite(pCall, pIn, pOut, RegSrvIpcDeleteValueInternal);
+}
+
 LWMsgStatus
 RegSrvIpcEnumValueW(
     LWMsgCall* pCall,
@@ -980,8 +1052,9 @@ error:
     goto cleanup;
 }
 
+static
 LWMsgStatus
-RegSrvIpcSetValueExW(
+RegSrvIpcSetValueExWInternal(
     LWMsgCall* pCall,
     const LWMsgParams* pIn,
     LWMsgParams* pOut,
@@ -1024,7 +1097,19 @@ error:
 }
 
 LWMsgStatus
-RegSrvIpcSetKeySecurity(
+RegSrvIpcSetValueExW(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    )
+{
+    return RegSrvIpcAdmitWrite(pCall, pIn, pOut, RegSrvIpcSetValueExWInternal);
+}
+
+static
+LWMsgStatus
+RegSrvIpcSetKeySecurityInternal(
     LWMsgCall* pCall,
     const LWMsgParams* pIn,
     LWMsgParams* pOut,
@@ -1061,6 +1146,17 @@ error:
     goto cleanup;
 }
 
+LWMsgStatus
+RegSrvIpcSetKeySecurity(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    )
+{
+    return RegSrvIpcAdmitWrite(pCall, pIn, pOut, RegSrvIpcSetKeySecurityInternal);
+}
+
 LWMsgStatus
 RegSrvIpcGetKeySecurity(
     LWMsgCall* pCall,
@@ -1115,8 +1211,9 @@ error:
     goto cleanup;
 }
 
+static
 LWMsgStatus
-RegSrvIpcSetValueAttibutesW(
+RegSrvIpcSetValueAttibutesWInternal(
     LWMsgCall* pCall,
     const LWMsgParams* pIn,
     LWMsgParams* pOut,
@@ -1155,6 +1252,17 @@ error:
     goto cleanup;
 }
 
+LWMsgStatus
+RegSrvIpcSetValueAttibutesW(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    )
+{
+    return RegSrvIpcAdmitWrite(pCall, pIn, pOut, RegSrvIpcSetValueAttibutesWInternal);
+}
+
 LWMsgStatus
 RegSrvIpcGetValueAttibutesW(
     LWMsgCall* pCall,
@@ -1218,8 +1326,9 @@ error:
     goto cleanup;
 }
 
+static
 LWMsgStatus
-RegSrvIpcDeleteValueAttibutesW(
+RegSrvIpcDeleteValueAttibutesWInternal(
     LWMsgCall* pCall,
     const LWMsgParams* pIn,
     LWMsgParams* pOut,
@@ -1258,3 +1367,318 @@ error:
     goto cleanup;
 }
 
+LWMsgStatus
+RegSrvIpcDeleteValueAttibutesW(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    )
+{
+    return RegSrvIpcAdmitWrite(pCall, pIn, pOut, RegSrvIpcDeleteValueAttibutesWInternal);
+}
+
+// Runs an admitted write, or answers a begin, and completes the call
+static
+VOID
+RegSrvIpcResumeTransactionWait(
+    PVOID pData,
+    NTSTATUS status
+    )
+{
+    PREG_SRV_IPC_TRANSACTION_CONTEXT pContext = pData;
+    PREG_IPC_STATUS pStatus = NULL;
+    LWMsgStatus lwmsgStatus = LWMSG_STATUS_SUCCESS;
+
+    if (!status && pContext->pfnWrite)
+    {
+        lwmsgStatus = pContext->pfnWrite(
+                            pContext->pCall,
+                            pContext->pIn,
+                            pContext->pOut,
+                            NULL);
+
+        RegSrvTransactionLeaveWrite(&pContext->waiter);
+    }
+    else if (!status)
+    {
+        pContext->pOut->tag = REG_R_BEGIN_TRANSACTION;
+        pContext->pOut->data = NULL;
+    }
+    else
+    {
+        status = RegSrvIpcCreateError(status, &pStatus);
+        if (!status)
+        {
+            pContext->pOut->tag = REG_R_ERROR;
+            pContext->pOut->data = pStatus;
+        }
+        lwmsgStatus = MAP_REG_ERROR_IPC(status);
+    }
+
+    lwmsg_call_complete(pContext->pCall, lwmsgStatus);
+
+    LWREG_SAFE_FREE_MEMORY(pContext);
+}
+
+static
+VOID
+RegSrvIpcCancelTransactionWait(
+    LWMsgCall* pCall,
+    PVOID pData
+    )
+{
+    PREG_SRV_IPC_TRANSACTION_CONTEXT pContext = pData;
+
+    if (RegSrvCancelTransactionWait(&pContext->waiter))
+    {
+        lwmsg_call_complete(pContext->pCall, LWMSG_STATUS_CANCELLED);
+
+        LWREG_SAFE_FREE_MEMORY(pContext);
+    }
+}
+
+static
+NTSTATUS
+RegSrvIpcCreateTransactionContext(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    LWMsgPeerCallFunction pfnWrite,
+    PREG_SRV_IPC_TRANSACTION_CONTEXT* ppContext
+    )
+{
+    NTSTATUS status = 0;
+    PREG_SRV_IPC_TRANSACTION_CONTEXT pContext = NULL;
+
+    status = LW_RTL_ALLOCATE((PVOID*)&pContext, REG_SRV_IPC_TRANSACTION_CONTEXT, sizeof(*pContext));
+    BAIL_ON_NT_STATUS(status);
+
+    pContext->pCall = pCall;
+    pContext->pIn = pIn;
+    pContext->pOut = pOut;
+    pContext->pfnWrite = pfnWrite;
+    pContext->waiter.pfnCallback = RegSrvIpcResumeTransactionWait;
+    pContext->waiter.pContext = pContext;
+
+    // The reply is always sent through RegSrvIpcResumeTransactionWait,
+    // either right away or when the batch blocking the call ends.  The
+    // call is pended rather than waited for so that the dispatch threads
+    // stay free for the batch owner's own calls.
+    lwmsg_call_pend(pCall, RegSrvIpcCancelTransactionWait, pContext);
+
+    *ppContext = pContext;
+
+error:
+
+    return status;
+}
+
+static
+LWMsgStatus
+RegSrvIpcAdmitWrite(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    LWMsgPeerCallFunction pfnWrite
+    )
+{
+    NTSTATUS status = 0;
+    PREG_SRV_IPC_TRANSACTION_CONTEXT pContext = NULL;
+
+    status = RegSrvIpcCreateTransactionContext(
+                    pCall,
+                    pIn,
+                    pOut,
+                    pfnWrite,
+                    &pContext);
+    BAIL_ON_NT_STATUS(status);
+
+    status = RegSrvTransactionEnterWrite(
+                    RegSrvIpcGetSessionData(pCall),
+                    &pContext->waiter);
+    if (status != STATUS_PENDING)
+    {
+        RegSrvIpcResumeTransactionWait(pContext, status);
+    }
+
+    return LWMSG_STATUS_PENDING;
+
+error:
+
+    return MAP_REG_ERROR_IPC(status);
+}
+
+LWMsgStatus
+RegSrvIpcBeginTransaction(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    )
+{
+    NTSTATUS status = 0;
+    PREG_SRV_IPC_TRANSACTION_CONTEXT pContext = NULL;
+
+    status = RegSrvIpcCreateTransactionContext(
+                    pCall,
+                    pIn,
+                    pOut,
+                    NULL,
+                    &pContext);
+    BAIL_ON_NT_STATUS(status);
+
+    status = RegSrvBeginTransaction(
+                    RegSrvIpcGetSessionData(pCall),
+                    &pContext->waiter);
+    if (status != STATUS_PENDING)
+    {
+        RegSrvIpcResumeTransactionWait(pContext, status);
+    }
+
+    return LWMSG_STATUS_PENDING;
+
+error:
+
+    return MAP_REG_ERROR_IPC(status);
+}
+
+LWMsgStatus
+RegSrvIpcEndTransaction(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    )
+{
+    NTSTATUS status = 0;
+    PREG_IPC_END_TRANSACTION_REQ pReq = pIn->data;
+    PREG_IPC_STATUS pStatus = NULL;
+
+    status = RegSrvEndTransaction(
+            RegSrvIpcGetSessionData(pCall),
+            pReq->bCommit);
+
+    if (!status)
+    {
+        pOut->tag = REG_R_END_TRANSACTION;
+        pOut->data = NULL;
+    }
+    else
+    {
+        status = RegSrvIpcCreateError(status, &pStatus);
+        BAIL_ON_NT_STATUS(status);
+
+        pOut->tag = REG_R_ERROR;
+        pOut->data = pStatus;
+    }
+
+cleanup:
+
+    return MAP_REG_ERROR_IPC(status);
+
+error:
+    goto cleanup;
+}
+
+static
+VOID
+RegSrvIpcCompleteNotifyChangeKey(
+    PVOID pData,
+    NTSTATUS status,
+    DWORD dwSequence
+    )
+{
+    PREG_SRV_IPC_NOTIFY_CONTEXT pContext = pData;
+    PREG_IPC_NOTIFY_CHANGE_KEY_RESPONSE pRegResp = NULL;
+    PREG_IPC_STATUS pStatus = NULL;
+
+    if (!status)
+    {
+        status = LW_RTL_ALLOCATE((PVOID*)&pRegResp, REG_IPC_NOTIFY_CHANGE_KEY_RESPONSE, sizeof(*pRegResp));
+        if (!status)
+        {
+            pRegResp->dwSequence = dwSequence;
+
+            pContext->pOut->tag = REG_R_NOTIFY_CHANGE_KEY;
+            pContext->pOut->data = pRegResp;
+        }
+    }
+
+    if (status)
+    {
+        status = RegSrvIpcCreateError(status, &pStatus);
+        if (!status)
+        {
+            pContext->pOut->tag = REG_R_ERROR;
+            pContext->pOut->data = pStatus;
+        }
+    }
+
+    lwmsg_call_complete(pContext->pCall, MAP_REG_ERROR_IPC(status));
+
+    LWREG_SAFE_FREE_MEMORY(pContext);
+}
+
+static
+VOID
+RegSrvIpcCancelNotifyChangeKey(
+    LWMsgCall* pCall,
+    PVOID pData
+    )
+{
+    PREG_SRV_IPC_NOTIFY_CONTEXT pContext = pData;
+
+    if (RegSrvCancelNotifyChangeKey(pContext->pWatch))
+    {
+        lwmsg_call_complete(pContext->pCall, LWMSG_STATUS_CANCELLED);
+
+        LWREG_SAFE_FREE_MEMORY(pContext);
+    }
+}
+
+LWMsgStatus
+RegSrvIpcNotifyChangeKey(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    )
+{
+    NTSTATUS status = 0;
+    PREG_IPC_NOTIFY_CHANGE_KEY_REQ pReq = pIn->data;
+    PREG_SRV_IPC_NOTIFY_CONTEXT pContext = NULL;
+    DWORD dwSequence = 0;
+
+    status = LW_RTL_ALLOCATE((PVOID*)&pContext, REG_SRV_IPC_NOTIFY_CONTEXT, sizeof(*pContext));
+    BAIL_ON_NT_STATUS(status);
+
+    pContext->pCall = pCall;
+    pContext->pOut = pOut;
+
+    // The reply is always sent through RegSrvIpcCompleteNotifyChangeKey,
+    // either right away or when a matching write comes in.
+    lwmsg_call_pend(pCall, RegSrvIpcCancelNotifyChangeKey, pContext);
+
+    status = RegSrvNotifyChangeKey(
+            RegSrvIpcGetSessionData(pCall),
+            pReq->hKey,
+            pReq->dwSubKeyCount,
+            pReq->ppSubKeys,
+            pReq->bWatchSubtree,
+            pReq->dwSequence,
+            RegSrvIpcCompleteNotifyChangeKey,
+            pContext,
+            &dwSequence,
+            &pContext->pWatch);
+    if (status != STATUS_PENDING)
+    {
+        RegSrvIpcCompleteNotifyChangeKey(pContext, status, dwSequence);
+    }
+
+    return LWMSG_STATUS_PENDING;
+
+error:
+
+    return MAP_REG_ERROR_IPC(status);
+}
@@ -200,6 +200,30 @@ RegSrvIpcDeleteValueAttibutesW(
     void* data
     );
 
+LWMsgStatus
+RegSrvIpcBeginTransaction(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    );
+
+LWMsgStatus
+RegSrvIpcEndTransaction(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    );
+
+LWMsgStatus
+RegSrvIpcNotifyChangeKey(
+    LWMsgCall* pCall,
+    const LWMsgParams* pIn,
+    LWMsgParams* pOut,
+    void* data
+    );
+
 VOID
 RegSrvFreeHandle(
     PVOID pData
@@ -69,6 +69,9 @@ static LWMsgDispatchSpec gMessageHandlers[] =
     LWMSG_DISPATCH_BLOCK(REG_Q_SET_VALUEW_ATTRIBUTES, RegSrvIpcSetValueAttibutesW),
     LWMSG_DISPATCH_BLOCK(REG_Q_GET_VALUEW_ATTRIBUTES, RegSrvIpcGetValueAttibutesW),
     LWMSG_DISPATCH_BLOCK(REG_Q_DELETE_VALUEW_ATTRIBUTES, RegSrvIpcDeleteValueAttibutesW),
+    LWMSG_DISPATCH_BLOCK(REG_Q_BEGIN_TRANSACTION, RegSrvIpcBeginTransaction),
+    LWMSG_DISPATCH_BLOCK(REG_Q_END_TRANSACTION, RegSrvIpcEndTransaction),
+    LWMSG_DISPATCH_NONBLOCK(REG_Q_NOTIFY_CHANGE_KEY, RegSrvIpcNotifyChangeKey),
     LWMSG_DISPATCH_END
 };
 
@@ -101,6 +104,10 @@ RegSrvApiInit(
         BAIL_ON_REG_ERROR(dwError);
     }
 
+    // Start from the clock so that sequences handed out before a restart
+    // are unlikely to look current afterwards
+    gRegSrvNotify.dwSequence = (DWORD)time(NULL);
+
 cleanup:
 
     return dwError;
@@ -122,6 +129,8 @@ RegSrvApiShutdown(
     VOID
     )
 {
+    RegSrvNotifyShutdown();
+
     RegSrvFreeProviders();
 
 #if defined(REG_USE_FILE)
@@ -0,0 +1,510 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright Likewise Software    2004-2008
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.  You should have received a copy of the GNU General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * LIKEWISE SOFTWARE MAKES THIS SOFTWARE AVAILABLE UNDER OTHER LICENSING
+ * TERMS AS WELL.  IF YOU HAVE ENTERED INTO A SEPARATE LICENSE AGREEMENT
+ * WITH LIKEWISE SOFTWARE, THEN YOU MAY ELECT TO USE THE SOFTWARE UNDER THE
+ * TERMS OF THAT SOFTWARE LICENSE AGREEMENT INSTEAD OF THE TERMS OF THE GNU
+ * GENERAL PUBLIC LICENSE, NOTWITHSTANDING THE ABOVE NOTICE.  IF YOU
+ * HAVE QUESTIONS, OR WISH TO REQUEST A COPY OF THE ALTERNATE LICENSING
+ * TERMS OFFERED BY LIKEWISE SOFTWARE, PLEASE CONTACT LIKEWISE SOFTWARE AT
+ * license@likewisesoftware.com
+ */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        regnotify.c
+ *
+ * Abstract:
+ *
+ *        Registry
+ *
+ *        Key change notification
+ *
+ */
+#include "api.h"
+
+static
+VOID
+RegSrvNotifyRecordChange_inlock(
+    IN OPTIONAL PWSTR pwszKeyPath,
+    IN BOOLEAN bSubtree,
+    OUT PREG_SRV_NOTIFY_WATCH* ppFired
+    );
+
+static
+BOOLEAN
+RegSrvNotifyWatchMatches(
+    IN PREG_SRV_NOTIFY_WATCH pWatch,
+    IN OPTIONAL PCWSTR pwszKeyPath,
+    IN BOOLEAN bSubtree
+    );
+
+static
+BOOLEAN
+RegSrvNotifyPathIsWithin(
+    IN PCWSTR pwszPath,
+    IN PCWSTR pwszParent
+    );
+
+static
+VOID
+RegSrvNotifyFireWatches(
+    IN PREG_SRV_NOTIFY_WATCH pWatches,
+    IN DWORD dwSequence
+    );
+
+static
+VOID
+RegSrvNotifyFreeWatch(
+    IN PREG_SRV_NOTIFY_WATCH pWatch
+    );
+
+NTSTATUS
+RegSrvNotifyChangeKey(
+    IN HANDLE Handle,
+    IN HKEY hKey,
+    IN DWORD dwSubKeyCount,
+    IN OPTIONAL PWSTR* ppSubKeys,
+    IN BOOLEAN bWatchSubtree,
+    IN DWORD dwSequence,
+    IN PREG_SRV_NOTIFY_CALLBACK pfnCallback,
+    IN PVOID pContext,
+    OUT PDWORD pdwSequence,
+    OUT PREG_SRV_NOTIFY_WATCH* ppWatch
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    BOOLEAN bInLock = FALSE;
+    PREG_KEY_HANDLE pKeyHandle = (PREG_KEY_HANDLE)hKey;
+    PREG_SRV_NOTIFY_WATCH pWatch = NULL;
+    PREG_SRV_NOTIFY_CHANGE pChange = NULL;
+    DWORD dwBehind = 0;
+    DWORD iPath = 0;
+    DWORD iChange = 0;
+
+    if (!Handle || !pKeyHandle || !pKeyHandle->pKey ||
+        LW_IS_NULL_OR_EMPTY_STR(pKeyHandle->pKey->pwszKeyName) ||
+        (dwSubKeyCount && !ppSubKeys) || !pfnCallback)
+    {
+        status = STATUS_INVALID_PARAMETER;
+        BAIL_ON_NT_STATUS(status);
+    }
+
+    status = RegSrvAccessCheckKeyHandle(pKeyHandle, KEY_NOTIFY);
+    BAIL_ON_NT_STATUS(status);
+
+    status = LW_RTL_ALLOCATE((PVOID*)&pWatch, REG_SRV_NOTIFY_WATCH, sizeof(*pWatch));
+    BAIL_ON_NT_STATUS(status);
+
+    pWatch->dwKeyPathCount = dwSubKeyCount ? dwSubKeyCount : 1;
+    pWatch->bWatchSubtree = bWatchSubtree;
+    pWatch->pfnCallback = pfnCallback;
+    pWatch->pContext = pContext;
+
+    status = LW_RTL_ALLOCATE((PVOID*)&pWatch->ppwszKeyPaths,
+                             PWSTR,
+                             sizeof(*pWatch->ppwszKeyPaths) *
+                             pWatch->dwKeyPathCount);
+    BAIL_ON_NT_STATUS(status);
+
+    for (iPath = 0; iPath < pWatch->dwKeyPathCount; iPath++)
+    {
+        if (!dwSubKeyCount || LW_IS_NULL_OR_EMPTY_STR(ppSubKeys[iPath]))
+        {
+            status = LwRtlWC16StringDuplicate(
+                            &pWatch->ppwszKeyPaths[iPath],
+                            pKeyHandle->pKey->pwszKeyName);
+        }
+        else
+        {
+            status = LwRtlWC16StringAllocatePrintfW(
+                            &pWatch->ppwszKeyPaths[iPath],
+                            L"%ws\\%ws",
+                            pKeyHandle->pKey->pwszKeyName,
+                            ppSubKeys[iPath]);
+        }
+        BAIL_ON_NT_STATUS(status);
+    }
+
+    LWREG_LOCK_MUTEX(bInLock, &gRegSrvNotify.mutex);
+
+    *pdwSequence = gRegSrvNotify.dwSequence;
+
+    // A zero sequence only asks for the current one.  A sequence older
+    // than the history (or one this server never issued, e.g. from before
+    // a restart) cannot be checked, so the caller is told to re-read.
+    dwBehind = gRegSrvNotify.dwSequence - dwSequence;
+
+    if (!dwSequence || dwBehind > gRegSrvNotify.dwHistoryCount)
+    {
+        goto cleanup;
+    }
+
+    for (iChange = 1; iChange <= dwBehind; iChange++)
+    {
+        pChange = &gRegSrvNotify.history[
+                        (gRegSrvNotify.dwHistoryNext +
+                         REG_SRV_NOTIFY_HISTORY_SIZE - iChange) %
+                        REG_SRV_NOTIFY_HISTORY_SIZE];
+
+        if (RegSrvNotifyWatchMatches(pWatch,
+                                     pChange->pwszKeyPath,
+                                     pChange->bSubtree))
+        {
+            goto cleanup;
+        }
+    }
+
+    // The watch can fire as soon as the lock is dropped, so the caller's
+    // reference has to be in place before that.
+    pWatch->pNext = gRegSrvNotify.pWatches;
+    gRegSrvNotify.pWatches = pWatch;
+    *ppWatch = pWatch;
+    pWatch = NULL;
+
+    status = STATUS_PENDING;
+
+cleanup:
+
+    LWREG_UNLOCK_MUTEX(bInLock, &gRegSrvNotify.mutex);
+
+    if (pWatch)
+    {
+        RegSrvNotifyFreeWatch(pWatch);
+    }
+
+    return status;
+
+error:
+
+    goto cleanup;
+}
+
+BOOLEAN
+RegSrvCancelNotifyChangeKey(
+    IN PREG_SRV_NOTIFY_WATCH pWatch
+    )
+{
+    BOOLEAN bInLock = FALSE;
+    PREG_SRV_NOTIFY_WATCH* ppCursor = NULL;
+    BOOLEAN bFound = FALSE;
+
+    if (!pWatch)
+    {
+        return FALSE;
+    }
+
+    LWREG_LOCK_MUTEX(bInLock, &gRegSrvNotify.mutex);
+
+    for (ppCursor = &gRegSrvNotify.pWatches;
+         *ppCursor;
+         ppCursor = &(*ppCursor)->pNext)
+    {
+        if (*ppCursor == pWatch)
+        {
+            *ppCursor = pWatch->pNext;
+            bFound = TRUE;
+            break;
+        }
+    }
+
+    LWREG_UNLOCK_MUTEX(bInLock, &gRegSrvNotify.mutex);
+
+    // A watch that is no longer queued has fired or is firing and belongs
+    // to RegSrvNotifyFireWatches.
+    if (bFound)
+    {
+        RegSrvNotifyFreeWatch(pWatch);
+    }
+
+    return bFound;
+}
+
+VOID
+RegSrvNotifyKeyChanged(
+    IN HKEY hKey,
+    IN OPTIONAL PCWSTR pSubKey,
+    IN BOOLEAN bSubtree
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    BOOLEAN bInLock = FALSE;
+    PREG_KEY_HANDLE pKeyHandle = (PREG_KEY_HANDLE)hKey;
+    PWSTR pwszKeyPath = NULL;
+    PREG_SRV_NOTIFY_WATCH pFired = NULL;
+    DWORD dwSequence = 0;
+
+    if (pKeyHandle && pKeyHandle->pKey &&
+        !LW_IS_NULL_OR_EMPTY_STR(pKeyHandle->pKey->pwszKeyName))
+    {
+        if (LW_IS_NULL_OR_EMPTY_STR(pSubKey))
+        {
+            status = LwRtlWC16StringDuplicate(
+                            &pwszKeyPath,
+                            pKeyHandle->pKey->pwszKeyName);
+        }
+        else
+        {
+            status = LwRtlWC16StringAllocatePrintfW(
+                            &pwszKeyPath,
+                            L"%ws\\%ws",
+                            pKeyHandle->pKey->pwszKeyName,
+                            pSubKey);
+        }
+    }
+    else if (!LW_IS_NULL_OR_EMPTY_STR(pSubKey))
+    {
+        status = LwRtlWC16StringDuplicate(&pwszKeyPath, pSubKey);
+    }
+
+    if (status)
+    {
+        // Without the path every watcher has to assume it was hit
+        REG_LOG_ERROR("Failed to record registry change [status 0x%x]",
+                      status);
+        pwszKeyPath = NULL;
+    }
+
+    LWREG_LOCK_MUTEX(bInLock, &gRegSrvNotify.mutex);
+
+    RegSrvNotifyRecordChange_inlock(pwszKeyPath, bSubtree, &pFired);
+    dwSequence = gRegSrvNotify.dwSequence;
+
+    LWREG_UNLOCK_MUTEX(bInLock, &gRegSrvNotify.mutex);
+
+    RegSrvNotifyFireWatches(pFired, dwSequence);
+}
+
+VOID
+RegSrvNotifyAllKeysChanged(
+    VOID
+    )
+{
+    BOOLEAN bInLock = FALSE;
+    PREG_SRV_NOTIFY_WATCH pFired = NULL;
+    DWORD dwSequence = 0;
+
+    LWREG_LOCK_MUTEX(bInLock, &gRegSrvNotify.mutex);
+
+    RegSrvNotifyRecordChange_inlock(NULL, TRUE, &pFired);
+    dwSequence = gRegSrvNotify.dwSequence;
+
+    LWREG_UNLOCK_MUTEX(bInLock, &gRegSrvNotify.mutex);
+
+    RegSrvNotifyFireWatches(pFired, dwSequence);
+}
+
+VOID
+RegSrvNotifyShutdown(
+    VOID
+    )
+{
+    BOOLEAN bInLock = FALSE;
+    PREG_SRV_NOTIFY_WATCH pWatch = NULL;
+    DWORD iChange = 0;
+
+    LWREG_LOCK_MUTEX(bInLock, &gRegSrvNotify.mutex);
+
+    // Stopping the IPC server cancels every pending call, so anything
+    // left here has nobody to answer to.
+    while (gRegSrvNotify.pWatches)
+    {
+        pWatch = gRegSrvNotify.pWatches;
+        gRegSrvNotify.pWatches = pWatch->pNext;
+
+        RegSrvNotifyFreeWatch(pWatch);
+    }
+
+    for (iChange = 0; iChange < REG_SRV_NOTIFY_HISTORY_SIZE; iChange++)
+    {
+        LWREG_SAFE_FREE_MEMORY(gRegSrvNotify.history[iChange].pwszKeyPath);
+    }
+
+    gRegSrvNotify.dwHistoryCount = 0;
+    gRegSrvNotify.dwHistoryNext = 0;
+
+    LWREG_UNLOCK_MUTEX(bInLock, &gRegSrvNotify.mutex);
+}
+
+static
+VOID
+RegSrvNotifyRecordChange_inlock(
+    IN OPTIONAL PWSTR pwszKeyPath,
+    IN BOOLEAN bSubtree,
+    OUT PREG_SRV_NOTIFY_WATCH* ppFired
+    )
+{
+    PREG_SRV_NOTIFY_CHANGE pChange = NULL;
+    PREG_SRV_NOTIFY_WATCH* ppCursor = NULL;
+    PREG_SRV_NOTIFY_WATCH pWatch = NULL;
+    PREG_SRV_NOTIFY_WATCH pFired = NULL;
+
+    // Zero is reserved for "no sequence yet"
+    if (++gRegSrvNotify.dwSequence == 0)
+    {
+        gRegSrvNotify.dwSequence = 1;
+    }
+
+    pChange = &gRegSrvNotify.history[gRegSrvNotify.dwHistoryNext];
+
+    LWREG_SAFE_FREE_MEMORY(pChange->pwszKeyPath);
+    pChange->dwSequence = gRegSrvNotify.dwSequence;
+    pChange->pwszKeyPath = pwszKeyPath;
+    pChange->bSubtree = bSubtree;
+
+    gRegSrvNotify.dwHistoryNext =
+        (gRegSrvNotify.dwHistoryNext + 1) % REG_SRV_NOTIFY_HISTORY_SIZE;
+    if (gRegSrvNotify.dwHistoryCount < REG_SRV_NOTIFY_HISTORY_SIZE)
+    {
+        gRegSrvNotify.dwHistoryCount++;
+    }
+
+    ppCursor = &gRegSrvNotify.pWatches;
+
+    while (*ppCursor)
+    {
+        pWatch = *ppCursor;
+
+        if (RegSrvNotifyWatchMatches(pWatch, pwszKeyPath, bSubtree))
+        {
+            *ppCursor = pWatch->pNext;
+            pWatch->pNext = pFired;
+            pFired = pWatch;
+        }
+        else
+        {
+            ppCursor = &pWatch->pNext;
+        }
+    }
+
+    *ppFired = pFired;
+}
+
+static
+BOOLEAN
+RegSrvNotifyWatchMatches(
+    IN PREG_SRV_NOTIFY_WATCH pWatch,
+    IN OPTIONAL PCWSTR pwszKeyPath,
+    IN BOOLEAN bSubtree
+    )
+{
+    DWORD iPath = 0;
+    PCWSTR pwszWatched = NULL;
+
+    if (!pwszKeyPath)
+    {
+        return TRUE;
+    }
+
+    for (iPath = 0; iPath < pWatch->dwKeyPathCount; iPath++)
+    {
+        pwszWatched = pWatch->ppwszKeyPaths[iPath];
+
+        // A change below the key counts for subtree watches; removing a
+        // parent takes the watched key with it.
+        if (LwRtlWC16StringIsEqual(pwszKeyPath, pwszWatched, FALSE) ||
+            (pWatch->bWatchSubtree &&
+             RegSrvNotifyPathIsWithin(pwszKeyPath, pwszWatched)) ||
+            (bSubtree &&
+             RegSrvNotifyPathIsWithin(pwszWatched, pwszKeyPath)))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static
+BOOLEAN
+RegSrvNotifyPathIsWithin(
+    IN PCWSTR pwszPath,
+    IN PCWSTR pwszParent
+    )
+{
+    wchar16_t c1 = 0;
+    wchar16_t c2 = 0;
+
+    // Key names compare case-insensitively
+    for (; *pwszParent; pwszPath++, pwszParent++)
+    {
+        c1 = *pwszPath;
+        c2 = *pwszParent;
+
+        if (c1 >= 'a' && c1 <= 'z')
+        {
+            c1 = c1 - 'a' + 'A';
+        }
+        if (c2 >= 'a' && c2 <= 'z')
+        {
+            c2 = c2 - 'a' + 'A';
+        }
+        if (c1 != c2)
+        {
+            return FALSE;
+        }
+    }
+
+    return *pwszPath == 0 || *pwszPath == '\\';
+}
+
+static
+VOID
+RegSrvNotifyFireWatches(
+    IN PREG_SRV_NOTIFY_WATCH pWatches,
+    IN DWORD dwSequence
+    )
+{
+    PREG_SRV_NOTIFY_WATCH pWatch = NULL;
+
+    while (pWatches)
+    {
+        pWatch = pWatches;
+        pWatches = pWatch->pNext;
+
+        pWatch->pfnCallback(pWatch->pContext, STATUS_SUCCESS, dwSequence);
+
+        RegSrvNotifyFreeWatch(pWatch);
+    }
+}
+
+static
+VOID
+RegSrvNotifyFreeWatch(
+    IN PREG_SRV_NOTIFY_WATCH pWatch
+    )
+{
+    DWORD iPath = 0;
+
+    if (pWatch->ppwszKeyPaths)
+    {
+        for (iPath = 0; iPath < pWatch->dwKeyPathCount; iPath++)
+        {
+            LWREG_SAFE_FREE_MEMORY(pWatch->ppwszKeyPaths[iPath]);
+        }
+        LWREG_SAFE_FREE_MEMORY(pWatch->ppwszKeyPaths);
+    }
+
+    LWREG_SAFE_FREE_MEMORY(pWatch);
+}
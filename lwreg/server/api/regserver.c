@@ -126,7 +126,10 @@ RegSrvCreateKeyEx(
     OUT OPTIONAL PDWORD pdwDisposition
     )
 {
-    return gpRegProvider->pfnRegSrvCreateKeyEx(
+    NTSTATUS status = STATUS_SUCCESS;
+    DWORD dwDisposition = 0;
+
+    status = gpRegProvider->pfnRegSrvCreateKeyEx(
                                            Handle,
                                            hKey,
                                            pSubKey,
@@ -137,7 +140,19 @@ RegSrvCreateKeyEx(
                                            pSecurityDescriptor,
                                            ulSecDescLen,
                                            phkResult,
-                                           pdwDisposition);
+                                           &dwDisposition);
+
+    if (!status && dwDisposition == REG_CREATED_NEW_KEY)
+    {
+        RegSrvNotifyKeyChanged(hKey, pSubKey, FALSE);
+    }
+
+    if (pdwDisposition)
+    {
+        *pdwDisposition = dwDisposition;
+    }
+
+    return status;
 }
 
 NTSTATUS
@@ -174,9 +189,18 @@ RegSrvDeleteKey(
     PCWSTR pSubKey
     )
 {
-	return gpRegProvider->pfnRegSrvDeleteKey(Handle,
+    NTSTATUS status = STATUS_SUCCESS;
+
+    status = gpRegProvider->pfnRegSrvDeleteKey(Handle,
 											 hKey,
 											 pSubKey);
+
+    if (!status)
+    {
+        RegSrvNotifyKeyChanged(hKey, pSubKey, TRUE);
+    }
+
+    return status;
 }
 
 NTSTATUS
@@ -187,10 +211,19 @@ RegSrvDeleteKeyValue(
     PCWSTR pValueName
     )
 {
-	return gpRegProvider->pfnRegSrvDeleteKeyValue(Handle,
+    NTSTATUS status = STATUS_SUCCESS;
+
+    status = gpRegProvider->pfnRegSrvDeleteKeyValue(Handle,
 												  hKey,
 												  pSubKey,
 												  pValueName);
+
+    if (!status)
+    {
+        RegSrvNotifyKeyChanged(hKey, pSubKey, FALSE);
+    }
+
+    return status;
 }
 
 NTSTATUS
@@ -200,9 +233,18 @@ RegSrvDeleteValue(
     PCWSTR pValueName
     )
 {
-	return gpRegProvider->pfnRegSrvDeleteValue(Handle,
+    NTSTATUS status = STATUS_SUCCESS;
+
+    status = gpRegProvider->pfnRegSrvDeleteValue(Handle,
                                                hKey,
                                                pValueName);
+
+    if (!status)
+    {
+        RegSrvNotifyKeyChanged(hKey, NULL, FALSE);
+    }
+
+    return status;
 }
 
 NTSTATUS
@@ -241,7 +283,9 @@ RegSrvSetValueExW(
     DWORD cbData
     )
 {
-   return gpRegProvider->pfnRegSrvSetValueExW(
+    NTSTATUS status = STATUS_SUCCESS;
+
+    status = gpRegProvider->pfnRegSrvSetValueExW(
             Handle,
             hKey,
             pValueName,
@@ -249,6 +293,13 @@ RegSrvSetValueExW(
             dwType,
             pData,
             cbData);
+
+    if (!status)
+    {
+        RegSrvNotifyKeyChanged(hKey, NULL, FALSE);
+    }
+
+    return status;
 }
 
 NTSTATUS
@@ -339,10 +390,19 @@ RegSrvDeleteTree(
     PCWSTR pSubKey
     )
 {
-	return gpRegProvider->pfnRegSrvDeleteTree(
+    NTSTATUS status = STATUS_SUCCESS;
+
+    status = gpRegProvider->pfnRegSrvDeleteTree(
             Handle,
             hKey,
             pSubKey);
+
+    if (!status)
+    {
+        RegSrvNotifyKeyChanged(hKey, pSubKey, TRUE);
+    }
+
+    return status;
 }
 
 NTSTATUS
@@ -374,12 +434,21 @@ RegSrvSetKeySecurity(
     IN ULONG ulSecDescLength
     )
 {
-    return gpRegProvider->pfnRegSrvSetKeySecurity(
+    NTSTATUS status = STATUS_SUCCESS;
+
+    status = gpRegProvider->pfnRegSrvSetKeySecurity(
     		Handle,
     		hKey,
     		SecurityInformation,
     		pSecurityDescriptor,
     		ulSecDescLength);
+
+    if (!status)
+    {
+        RegSrvNotifyKeyChanged(hKey, NULL, FALSE);
+    }
+
+    return status;
 }
 
 NTSTATUS
@@ -411,12 +480,21 @@ RegSrvSetValueAttributesW(
     IN PLWREG_VALUE_ATTRIBUTES pValueAttributes
     )
 {
-   return gpRegProvider->pfnRegSrvSetValueAttributes(
+    NTSTATUS status = STATUS_SUCCESS;
+
+    status = gpRegProvider->pfnRegSrvSetValueAttributes(
            hRegConnection,
             hKey,
             pSubKey,
             pValueName,
             pValueAttributes);
+
+    if (!status)
+    {
+        RegSrvNotifyKeyChanged(hKey, pSubKey, FALSE);
+    }
+
+    return status;
 }
 
 NTSTATUS
@@ -446,15 +524,374 @@ RegSrvDeleteValueAttributesW(
     IN PCWSTR pwszValueName
     )
 {
-    return gpRegProvider->pfnRegSrvDeleteValueAttributes(
+    NTSTATUS status = STATUS_SUCCESS;
+
+    status = gpRegProvider->pfnRegSrvDeleteValueAttributes(
             hRegConnection,
              hKey,
              pwszSubKey,
              pwszValueName);
+
+    if (!status)
+    {
+        RegSrvNotifyKeyChanged(hKey, pwszSubKey, FALSE);
+    }
+
+    return status;
+}
+
+
+
+
+//
+// Registry Transaction Server APIs
+//
+static
+VOID
+RegSrvTransactionQueue_inlock(
+    IN HANDLE Handle,
+    IN BOOLEAN bBegin,
+    IN OUT PREG_SRV_TRANSACTION_WAITER pWaiter
+    )
+{
+    pWaiter->pNext = NULL;
+    pWaiter->Handle = Handle;
+    pWaiter->bBegin = bBegin;
+    pWaiter->bWriting = FALSE;
+    pWaiter->status = STATUS_SUCCESS;
+
+    *gRegSrvTransaction.ppWaitersTail = pWaiter;
+    gRegSrvTransaction.ppWaitersTail = &pWaiter->pNext;
+}
+
+// Lets queued waiters go in arrival order for as long as nobody owns the
+// batch.  A begin has to wait for the admitted writes to finish first, and
+// everything behind it waits with it.  The waiters are handed back through
+// ppResumed and must be reported after the lock is dropped.
+static
+VOID
+RegSrvTransactionDispatch_inlock(
+    OUT PREG_SRV_TRANSACTION_WAITER* ppResumed
+    )
+{
+    PREG_SRV_TRANSACTION_WAITER pWaiter = NULL;
+    PREG_SRV_TRANSACTION_WAITER* ppResumedTail = ppResumed;
+
+    *ppResumed = NULL;
+
+    while (!gRegSrvTransaction.hOwner && gRegSrvTransaction.pWaiters)
+    {
+        pWaiter = gRegSrvTransaction.pWaiters;
+
+        if (pWaiter->bBegin && gRegSrvTransaction.dwWriters)
+        {
+            break;
+        }
+
+        gRegSrvTransaction.pWaiters = pWaiter->pNext;
+        if (!gRegSrvTransaction.pWaiters)
+        {
+            gRegSrvTransaction.ppWaitersTail = &gRegSrvTransaction.pWaiters;
+        }
+
+        if (pWaiter->bBegin)
+        {
+            pWaiter->status = gpRegProvider->pfnRegSrvBeginTransaction(
+                                    pWaiter->Handle);
+            if (!pWaiter->status)
+            {
+                gRegSrvTransaction.hOwner = pWaiter->Handle;
+                gRegSrvTransaction.dwDepth = 1;
+            }
+        }
+        else
+        {
+            pWaiter->bWriting = TRUE;
+            gRegSrvTransaction.dwWriters++;
+        }
+
+        pWaiter->pNext = NULL;
+        *ppResumedTail = pWaiter;
+        ppResumedTail = &pWaiter->pNext;
+    }
+}
+
+static
+VOID
+RegSrvTransactionResume(
+    IN PREG_SRV_TRANSACTION_WAITER pResumed
+    )
+{
+    PREG_SRV_TRANSACTION_WAITER pWaiter = NULL;
+
+    // A resumed write runs its provider call from its callback, and the
+    // callback may free the waiter.
+    while (pResumed)
+    {
+        pWaiter = pResumed;
+        pResumed = pWaiter->pNext;
+
+        pWaiter->pfnCallback(pWaiter->pContext, pWaiter->status);
+    }
+}
+
+static
+NTSTATUS
+RegSrvTransactionFinish_inlock(
+    IN BOOLEAN bCommit,
+    OUT PREG_SRV_TRANSACTION_WAITER* ppResumed
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+
+    status = gpRegProvider->pfnRegSrvEndTransaction(
+                gRegSrvTransaction.hOwner,
+                bCommit);
+
+    gRegSrvTransaction.hOwner = NULL;
+    gRegSrvTransaction.dwDepth = 0;
+
+    RegSrvTransactionDispatch_inlock(ppResumed);
+
+    return status;
+}
+
+NTSTATUS
+RegSrvBeginTransaction(
+    IN HANDLE Handle,
+    IN OUT PREG_SRV_TRANSACTION_WAITER pWaiter
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    BOOLEAN bInLock = FALSE;
+
+    if (!Handle)
+    {
+        status = STATUS_INVALID_HANDLE;
+        BAIL_ON_NT_STATUS(status);
+    }
+
+    LWREG_LOCK_MUTEX(bInLock, &gRegSrvTransaction.mutex);
+
+    if (gRegSrvTransaction.hOwner == Handle)
+    {
+        gRegSrvTransaction.dwDepth++;
+        goto cleanup;
+    }
+
+    // Another session owns the batch or is still writing outside it; queue
+    // rather than fail so that concurrent writers do not have to retry.
+    if (gRegSrvTransaction.hOwner ||
+        gRegSrvTransaction.dwWriters ||
+        gRegSrvTransaction.pWaiters)
+    {
+        RegSrvTransactionQueue_inlock(Handle, TRUE, pWaiter);
+        status = STATUS_PENDING;
+        goto cleanup;
+    }
+
+    status = gpRegProvider->pfnRegSrvBeginTransaction(Handle);
+    BAIL_ON_NT_STATUS(status);
+
+    gRegSrvTransaction.hOwner = Handle;
+    gRegSrvTransaction.dwDepth = 1;
+
+cleanup:
+
+    LWREG_UNLOCK_MUTEX(bInLock, &gRegSrvTransaction.mutex);
+
+    return status;
+
+error:
+
+    goto cleanup;
+}
+
+NTSTATUS
+RegSrvEndTransaction(
+    IN HANDLE Handle,
+    IN BOOLEAN bCommit
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    BOOLEAN bInLock = FALSE;
+    BOOLEAN bRolledBack = FALSE;
+    PREG_SRV_TRANSACTION_WAITER pResumed = NULL;
+
+    LWREG_LOCK_MUTEX(bInLock, &gRegSrvTransaction.mutex);
+
+    if (!Handle || gRegSrvTransaction.hOwner != Handle)
+    {
+        status = STATUS_TRANSACTION_NO_MATCH;
+        BAIL_ON_NT_STATUS(status);
+    }
+
+    // Nested commits only unwind; a rollback at any depth discards the
+    // whole batch.
+    if (bCommit && --gRegSrvTransaction.dwDepth > 0)
+    {
+        goto cleanup;
+    }
+
+    bRolledBack = !bCommit;
+
+    status = RegSrvTransactionFinish_inlock(bCommit, &pResumed);
+    BAIL_ON_NT_STATUS(status);
+
+cleanup:
+
+    LWREG_UNLOCK_MUTEX(bInLock, &gRegSrvTransaction.mutex);
+
+    // Watchers were told about the writes as they happened; after a
+    // rollback nobody can say which keys went back, so tell everyone.
+    if (bRolledBack)
+    {
+        RegSrvNotifyAllKeysChanged();
+    }
+
+    RegSrvTransactionResume(pResumed);
+
+    return status;
+
+error:
+
+    goto cleanup;
+}
+
+VOID
+RegSrvReleaseTransaction(
+    IN HANDLE Handle
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    BOOLEAN bInLock = FALSE;
+    BOOLEAN bRolledBack = FALSE;
+    PREG_SRV_TRANSACTION_WAITER pResumed = NULL;
+
+    LWREG_LOCK_MUTEX(bInLock, &gRegSrvTransaction.mutex);
+
+    if (Handle && gRegSrvTransaction.hOwner == Handle)
+    {
+        bRolledBack = TRUE;
+        status = RegSrvTransactionFinish_inlock(FALSE, &pResumed);
+        if (status)
+        {
+            REG_LOG_ERROR("Failed to roll back registry transaction of "
+                          "closed session [status 0x%x]", status);
+        }
+    }
+
+    LWREG_UNLOCK_MUTEX(bInLock, &gRegSrvTransaction.mutex);
+
+    if (bRolledBack)
+    {
+        RegSrvNotifyAllKeysChanged();
+    }
+
+    RegSrvTransactionResume(pResumed);
+}
+
+// Writes from a session that does not own the batch wait for the owner to
+// end it, so they never land in (or commit) somebody else's transaction.
+// Only the bookkeeping is done under the lock; the writes themselves run
+// concurrently as before.
+NTSTATUS
+RegSrvTransactionEnterWrite(
+    IN HANDLE Handle,
+    IN OUT PREG_SRV_TRANSACTION_WAITER pWaiter
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    BOOLEAN bInLock = FALSE;
+
+    LWREG_LOCK_MUTEX(bInLock, &gRegSrvTransaction.mutex);
+
+    pWaiter->bWriting = FALSE;
+
+    if (Handle && gRegSrvTransaction.hOwner == Handle)
+    {
+        goto cleanup;
+    }
+
+    // Queue behind anyone already waiting so a begin is not starved
+    if (gRegSrvTransaction.hOwner || gRegSrvTransaction.pWaiters)
+    {
+        RegSrvTransactionQueue_inlock(Handle, FALSE, pWaiter);
+        status = STATUS_PENDING;
+        goto cleanup;
+    }
+
+    pWaiter->bWriting = TRUE;
+    gRegSrvTransaction.dwWriters++;
+
+cleanup:
+
+    LWREG_UNLOCK_MUTEX(bInLock, &gRegSrvTransaction.mutex);
+
+    return status;
 }
 
+VOID
+RegSrvTransactionLeaveWrite(
+    IN OUT PREG_SRV_TRANSACTION_WAITER pWaiter
+    )
+{
+    BOOLEAN bInLock = FALSE;
+    PREG_SRV_TRANSACTION_WAITER pResumed = NULL;
 
+    if (!pWaiter->bWriting)
+    {
+        return;
+    }
 
+    LWREG_LOCK_MUTEX(bInLock, &gRegSrvTransaction.mutex);
+
+    pWaiter->bWriting = FALSE;
+
+    if (--gRegSrvTransaction.dwWriters == 0)
+    {
+        RegSrvTransactionDispatch_inlock(&pResumed);
+    }
+
+    LWREG_UNLOCK_MUTEX(bInLock, &gRegSrvTransaction.mutex);
+
+    RegSrvTransactionResume(pResumed);
+}
+
+// Nothing needs dispatching here: anything queued behind a cancelled begin
+// was waiting on writes that are still running, and the last of those
+// dispatches the queue.
+BOOLEAN
+RegSrvCancelTransactionWait(
+    IN PREG_SRV_TRANSACTION_WAITER pWaiter
+    )
+{
+    BOOLEAN bInLock = FALSE;
+    PREG_SRV_TRANSACTION_WAITER* ppCursor = NULL;
+    BOOLEAN bFound = FALSE;
+
+    LWREG_LOCK_MUTEX(bInLock, &gRegSrvTransaction.mutex);
+
+    for (ppCursor = &gRegSrvTransaction.pWaiters;
+         *ppCursor;
+         ppCursor = &(*ppCursor)->pNext)
+    {
+        if (*ppCursor == pWaiter)
+        {
+            *ppCursor = pWaiter->pNext;
+            if (!*ppCursor)
+            {
+                gRegSrvTransaction.ppWaitersTail = ppCursor;
+            }
+            bFound = TRUE;
+            break;
+        }
+    }
+
+    LWREG_UNLOCK_MUTEX(bInLock, &gRegSrvTransaction.mutex);
+
+    return bFound;
+}
 
 // Key Context (key handle) helper utility functions
 void
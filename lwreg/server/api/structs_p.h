@@ -59,4 +59,91 @@ typedef struct _REG_SRV_API_CONFIG {
 
 } REG_SRV_API_CONFIG, *PREG_SRV_API_CONFIG;
 
+/*
+ * At most one client session owns the provider batch transaction at a time.
+ * Writes and begins from other sessions queue until the owner ends it, and
+ * a begin also waits for writes from other sessions that are still running.
+ */
+typedef struct _REG_SRV_TRANSACTION_STATE {
+
+    pthread_mutex_t mutex;
+
+    HANDLE  hOwner;
+    DWORD   dwDepth;
+
+    // Admitted writes from sessions other than the owner
+    DWORD   dwWriters;
+
+    // Waiters in arrival order
+    PREG_SRV_TRANSACTION_WAITER  pWaiters;
+    PREG_SRV_TRANSACTION_WAITER* ppWaitersTail;
+
+} REG_SRV_TRANSACTION_STATE, *PREG_SRV_TRANSACTION_STATE;
+
+/*
+ * Every successful write bumps the change sequence and records the key
+ * it touched.  A watcher that presents the sequence it last saw is
+ * answered from the history when a matching change already happened;
+ * otherwise it waits on the watch list until one does.
+ */
+struct _REG_SRV_NOTIFY_WATCH {
+
+    struct _REG_SRV_NOTIFY_WATCH* pNext;
+
+    // Full key paths being watched
+    PWSTR*  ppwszKeyPaths;
+    DWORD   dwKeyPathCount;
+    BOOLEAN bWatchSubtree;
+
+    PREG_SRV_NOTIFY_CALLBACK pfnCallback;
+    PVOID   pContext;
+
+};
+
+typedef struct _REG_SRV_NOTIFY_CHANGE {
+
+    DWORD   dwSequence;
+    // NULL when every key may have changed (transaction rollback)
+    PWSTR   pwszKeyPath;
+    // The change removed the key together with its subkeys
+    BOOLEAN bSubtree;
+
+} REG_SRV_NOTIFY_CHANGE, *PREG_SRV_NOTIFY_CHANGE;
+
+#define REG_SRV_NOTIFY_HISTORY_SIZE 64
+
+typedef struct _REG_SRV_NOTIFY_STATE {
+
+    pthread_mutex_t mutex;
+
+    DWORD dwSequence;
+
+    REG_SRV_NOTIFY_CHANGE history[REG_SRV_NOTIFY_HISTORY_SIZE];
+    DWORD dwHistoryCount;
+    DWORD dwHistoryNext;
+
+    PREG_SRV_NOTIFY_WATCH pWatches;
+
+} REG_SRV_NOTIFY_STATE, *PREG_SRV_NOTIFY_STATE;
+
+typedef struct _REG_SRV_IPC_NOTIFY_CONTEXT {
+
+    LWMsgCall*   pCall;
+    LWMsgParams* pOut;
+    PREG_SRV_NOTIFY_WATCH pWatch;
+
+} REG_SRV_IPC_NOTIFY_CONTEXT, *PREG_SRV_IPC_NOTIFY_CONTEXT;
+
+typedef struct _REG_SRV_IPC_TRANSACTION_CONTEXT {
+
+    REG_SRV_TRANSACTION_WAITER waiter;
+
+    LWMsgCall*         pCall;
+    const LWMsgParams* pIn;
+    LWMsgParams*       pOut;
+    // The write to run once admitted, NULL for a begin
+    LWMsgPeerCallFunction pfnWrite;
+
+} REG_SRV_IPC_TRANSACTION_CONTEXT, *PREG_SRV_IPC_TRANSACTION_CONTEXT;
+
 #endif /* __STRUCTS_H__ */
@@ -245,6 +245,19 @@ NTSTATUS
     PCWSTR pwszValueName
     );
 
+typedef
+NTSTATUS
+(*PFNRegSrvBeginTransaction)(
+    HANDLE hRegConnection
+    );
+
+typedef
+NTSTATUS
+(*PFNRegSrvEndTransaction)(
+    HANDLE hRegConnection,
+    BOOLEAN bCommit
+    );
+
 typedef struct __REGPROV_PROVIDER_FUNCTION_TABLE
 {
     PFNRegSrvCreateKeyEx           pfnRegSrvCreateKeyEx;
@@ -265,6 +278,8 @@ typedef struct __REGPROV_PROVIDER_FUNCTION_TABLE
     PFNRegSrvSetValueAttributes    pfnRegSrvSetValueAttributes;
     PFNRegSrvGetValueAttributes    pfnRegSrvGetValueAttributes;
     PFNRegSrvDeleteValueAttributes pfnRegSrvDeleteValueAttributes;
+    PFNRegSrvBeginTransaction      pfnRegSrvBeginTransaction;
+    PFNRegSrvEndTransaction        pfnRegSrvEndTransaction;
 } REGPROV_PROVIDER_FUNCTION_TABLE, *PREGPROV_PROVIDER_FUNCTION_TABLE;
 
 typedef
@@ -401,6 +401,131 @@ RegSrvDeleteValueAttributesW(
     IN PCWSTR pwszValueName
     );
 
+// Batch transactions
+typedef VOID
+(*PREG_SRV_TRANSACTION_CALLBACK)(
+    IN PVOID pContext,
+    IN NTSTATUS status
+    );
+
+/*
+ * A write or begin from a session that cannot go ahead while another
+ * session owns the batch.  The caller owns the memory and fills in
+ * pfnCallback and pContext; the rest belongs to regserver.c.
+ */
+typedef struct _REG_SRV_TRANSACTION_WAITER {
+
+    struct _REG_SRV_TRANSACTION_WAITER* pNext;
+
+    HANDLE   Handle;
+    BOOLEAN  bBegin;
+    // Counted as a write running outside the batch
+    BOOLEAN  bWriting;
+    NTSTATUS status;
+
+    PREG_SRV_TRANSACTION_CALLBACK pfnCallback;
+    PVOID    pContext;
+
+} REG_SRV_TRANSACTION_WAITER, *PREG_SRV_TRANSACTION_WAITER;
+
+/*
+ * The write functions above do not look at the batch; callers admit each
+ * write with RegSrvTransactionEnterWrite and end it with
+ * RegSrvTransactionLeaveWrite.  Entering returns STATUS_SUCCESS when the
+ * write can go ahead now, or STATUS_PENDING once it is queued behind
+ * another session's batch.  A queued waiter is reported exactly once
+ * through pfnCallback, when the batch ends, unless
+ * RegSrvCancelTransactionWait takes it back first.  The callback runs on
+ * the thread that ended the batch, without any lock held.
+ */
+NTSTATUS
+RegSrvTransactionEnterWrite(
+    IN HANDLE Handle,
+    IN OUT PREG_SRV_TRANSACTION_WAITER pWaiter
+    );
+
+VOID
+RegSrvTransactionLeaveWrite(
+    IN OUT PREG_SRV_TRANSACTION_WAITER pWaiter
+    );
+
+// Queues the same way as a write when another session owns the batch
+// or writes from other sessions are still running.
+NTSTATUS
+RegSrvBeginTransaction(
+    IN HANDLE Handle,
+    IN OUT PREG_SRV_TRANSACTION_WAITER pWaiter
+    );
+
+BOOLEAN
+RegSrvCancelTransactionWait(
+    IN PREG_SRV_TRANSACTION_WAITER pWaiter
+    );
+
+NTSTATUS
+RegSrvEndTransaction(
+    IN HANDLE Handle,
+    IN BOOLEAN bCommit
+    );
+
+VOID
+RegSrvReleaseTransaction(
+    IN HANDLE Handle
+    );
+
+// Change notification
+typedef struct _REG_SRV_NOTIFY_WATCH
+    REG_SRV_NOTIFY_WATCH, *PREG_SRV_NOTIFY_WATCH;
+
+typedef VOID
+(*PREG_SRV_NOTIFY_CALLBACK)(
+    IN PVOID pContext,
+    IN NTSTATUS status,
+    IN DWORD dwSequence
+    );
+
+/*
+ * Returns STATUS_SUCCESS with the current sequence in *pdwSequence when a
+ * change past dwSequence is already known, or STATUS_PENDING once the
+ * watch is queued.  A queued watch is reported exactly once through
+ * pfnCallback unless RegSrvCancelNotifyChangeKey takes it back first.
+ */
+NTSTATUS
+RegSrvNotifyChangeKey(
+    IN HANDLE Handle,
+    IN HKEY hKey,
+    IN DWORD dwSubKeyCount,
+    IN OPTIONAL PWSTR* ppSubKeys,
+    IN BOOLEAN bWatchSubtree,
+    IN DWORD dwSequence,
+    IN PREG_SRV_NOTIFY_CALLBACK pfnCallback,
+    IN PVOID pContext,
+    OUT PDWORD pdwSequence,
+    OUT PREG_SRV_NOTIFY_WATCH* ppWatch
+    );
+
+BOOLEAN
+RegSrvCancelNotifyChangeKey(
+    IN PREG_SRV_NOTIFY_WATCH pWatch
+    );
+
+VOID
+RegSrvNotifyKeyChanged(
+    IN HKEY hKey,
+    IN OPTIONAL PCWSTR pSubKey,
+    IN BOOLEAN bSubtree
+    );
+
+VOID
+RegSrvNotifyAllKeysChanged(
+    VOID
+    );
+
+VOID
+RegSrvNotifyShutdown(
+    VOID
+    );
+
 // Key context (key handle) utility functions
 BOOLEAN
 RegSrvIsValidKeyName(
@@ -71,7 +71,9 @@ REGPROV_PROVIDER_FUNCTION_TABLE gRegSqliteProviderAPITable =
         &SqliteGetKeySecurity,
         &SqliteSetValueAttributes,
         &SqliteGetValueAttributes,
-        &SqliteDeleteValueAttributes
+        &SqliteDeleteValueAttributes,
+        &SqliteBeginTransaction,
+        &SqliteEndTransaction
 };
 
 REG_SRV_SQLITE_KEYLOOKUP gActiveKeyList =
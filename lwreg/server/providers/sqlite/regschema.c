@@ -268,7 +268,7 @@ SqliteGetValueAttributes_Internal(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -351,7 +351,7 @@ SqliteGetValueAttributes_Internal(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -393,7 +393,7 @@ error:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
-                 "rollback",
+                 REG_DB_ROLLBACK(pConn),
                  NULL,
                  NULL,
                  NULL);
@@ -321,6 +321,11 @@ RegDbSetup(
 	NTSTATUS status = STATUS_SUCCESS;
     PSTR pszError = NULL;
 
+    status = RegSqliteExec(pSqlHandle,
+                           REG_DB_JOURNAL_MODE,
+                           &pszError);
+    BAIL_ON_SQLITE3_ERROR(status, pszError);
+
     status = RegSqliteExec(pSqlHandle,
                            REG_DB_CREATE_TABLES,
                            &pszError);
@@ -893,7 +898,7 @@ RegDbStoreRegValues(
 
     status = sqlite3_exec(
     		        pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -907,7 +912,7 @@ RegDbStoreRegValues(
 
     status = sqlite3_exec(
     		        pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -928,7 +933,7 @@ cleanup:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
- 				 "rollback",
+ 				 REG_DB_ROLLBACK(pConn),
  				 NULL,
 				 NULL,
 				 NULL);
@@ -953,7 +958,7 @@ RegDbUpdateRegValues(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -966,7 +971,7 @@ RegDbUpdateRegValues(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -986,7 +991,7 @@ error:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
-                 "rollback",
+                 REG_DB_ROLLBACK(pConn),
                  NULL,
                  NULL,
                  NULL);
@@ -1010,7 +1015,7 @@ RegDbOpenKey(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1023,7 +1028,7 @@ RegDbOpenKey(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1044,7 +1049,7 @@ error:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
-                 "rollback",
+                 REG_DB_ROLLBACK(pConn),
                  NULL,
                  NULL,
                  NULL);
@@ -1108,7 +1113,7 @@ RegDbCreateKey(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1125,7 +1130,7 @@ RegDbCreateKey(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1163,7 +1168,7 @@ error:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
-                 "rollback",
+                 REG_DB_ROLLBACK(pConn),
                  NULL,
                  NULL,
                  NULL);
@@ -1255,7 +1260,7 @@ RegDbSetKeyValue(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1305,7 +1310,7 @@ RegDbSetKeyValue(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1335,7 +1340,7 @@ error:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
-                 "rollback",
+                 REG_DB_ROLLBACK(pConn),
                  NULL,
                  NULL,
                  NULL);
@@ -1376,7 +1381,7 @@ RegDbGetKeyValue(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1393,7 +1398,7 @@ RegDbGetKeyValue(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1413,7 +1418,7 @@ error:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
-                 "rollback",
+                 REG_DB_ROLLBACK(pConn),
                  NULL,
                  NULL,
                  NULL);
@@ -1439,7 +1444,7 @@ RegDbDeleteKey(
 
     status = sqlite3_exec(
     		        pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1453,7 +1458,7 @@ RegDbDeleteKey(
 
     status = sqlite3_exec(
     		        pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1474,7 +1479,7 @@ cleanup:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
- 				 "rollback",
+ 				 REG_DB_ROLLBACK(pConn),
  				 NULL,
 				 NULL,
 				 NULL);
@@ -1824,7 +1829,7 @@ RegDbUpdateKeyAcl(
 
     status = sqlite3_exec(
     		        pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1882,7 +1887,7 @@ RegDbUpdateKeyAcl(
 
     status = sqlite3_exec(
     		        pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1905,7 +1910,7 @@ cleanup:
 		sqlite3_free(pszError);
 	}
 	sqlite3_exec(pConn->pDb,
-				 "rollback",
+				 REG_DB_ROLLBACK(pConn),
 				 NULL,
 				 NULL,
 				 NULL);
@@ -1932,7 +1937,7 @@ RegDbGetKeyAclByKeyId(
 
 	status = sqlite3_exec(
 					pConn->pDb,
-					"begin;",
+					REG_DB_BEGIN(pConn),
 					NULL,
 					NULL,
 					&pszError);
@@ -1952,7 +1957,7 @@ RegDbGetKeyAclByKeyId(
 
     status = sqlite3_exec(
     		        pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1974,7 +1979,7 @@ error:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
- 				 "rollback",
+ 				 REG_DB_ROLLBACK(pConn),
  				 NULL,
 				 NULL,
 				 NULL);
@@ -2020,7 +2025,7 @@ RegDbFixAcls(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -2186,7 +2191,7 @@ RegDbFixAcls(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -2211,7 +2216,7 @@ error:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
-                 "rollback",
+                 REG_DB_ROLLBACK(pConn),
                  NULL,
                  NULL,
                  NULL);
@@ -2370,6 +2375,122 @@ RegDbFlushNOP(
     return 0;
 }
 
+NTSTATUS
+RegDbBeginBatch(
+    IN REG_DB_HANDLE hDb
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    PREG_DB_CONNECTION pConn = (PREG_DB_CONNECTION)hDb;
+    PSTR pszError = NULL;
+    BOOLEAN bInLock = FALSE;
+
+    ENTER_SQLITE_LOCK(&pConn->lock, bInLock);
+
+    if (pConn->bInBatch)
+    {
+        status = STATUS_INVALID_DEVICE_STATE;
+        BAIL_ON_NT_STATUS(status);
+    }
+
+    status = sqlite3_exec(
+                    pConn->pDb,
+                    "begin;",
+                    NULL,
+                    NULL,
+                    &pszError);
+    BAIL_ON_SQLITE3_ERROR(status, pszError);
+
+    pConn->bInBatch = TRUE;
+
+cleanup:
+
+    LEAVE_SQLITE_LOCK(&pConn->lock, bInLock);
+
+    return status;
+
+error:
+
+    if (pszError)
+    {
+        sqlite3_free(pszError);
+    }
+
+    goto cleanup;
+}
+
+NTSTATUS
+RegDbEndBatch(
+    IN REG_DB_HANDLE hDb,
+    IN BOOLEAN bCommit
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    PREG_DB_CONNECTION pConn = (PREG_DB_CONNECTION)hDb;
+    PSTR pszError = NULL;
+    BOOLEAN bInLock = FALSE;
+
+    ENTER_SQLITE_LOCK(&pConn->lock, bInLock);
+
+    if (!pConn->bInBatch)
+    {
+        status = STATUS_TRANSACTION_NO_MATCH;
+        BAIL_ON_NT_STATUS(status);
+    }
+
+    if (bCommit)
+    {
+        status = sqlite3_exec(
+                        pConn->pDb,
+                        "commit;",
+                        NULL,
+                        NULL,
+                        &pszError);
+        BAIL_ON_SQLITE3_ERROR(status, pszError);
+    }
+    else
+    {
+        status = sqlite3_exec(
+                        pConn->pDb,
+                        "rollback;",
+                        NULL,
+                        NULL,
+                        &pszError);
+        BAIL_ON_SQLITE3_ERROR(status, pszError);
+    }
+
+    pConn->bInBatch = FALSE;
+
+cleanup:
+
+    LEAVE_SQLITE_LOCK(&pConn->lock, bInLock);
+
+    return status;
+
+error:
+
+    if (pszError)
+    {
+        sqlite3_free(pszError);
+    }
+    if (pConn->bInBatch)
+    {
+        // A failed commit leaves the transaction open; undo it so the
+        // connection is usable again.
+        if (bCommit)
+        {
+            sqlite3_exec(pConn->pDb,
+                         "rollback;",
+                         NULL,
+                         NULL,
+                         NULL);
+        }
+        pConn->bInBatch = FALSE;
+    }
+
+    goto cleanup;
+}
+
 static
 NTSTATUS
 RegDbUpdateKeyAclContent_inlock(
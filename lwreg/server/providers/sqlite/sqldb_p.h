@@ -53,10 +53,33 @@
     "delete from " REG_DB_TABLE_NAME_CACHE_TAGS " where CacheId NOT IN " \
         "CacheId NOT IN ( select CacheId from " REG_DB_TABLE_NAME_ENTRIES " );\n"
 
+/*
+ * The journal is truncated in place rather than deleted at every commit,
+ * which saves a create/unlink pair per write transaction.
+ */
+#define REG_DB_JOURNAL_MODE "PRAGMA journal_mode=PERSIST;"
+
+/*
+ * Every write operation runs its statements in its own transaction. While a
+ * client batch is open on the connection the outer transaction is already
+ * active, so each operation becomes a savepoint inside it instead; a failed
+ * operation then only undoes its own changes.
+ */
+#define REG_DB_BEGIN(pConn) \
+    ((pConn)->bInBatch ? "savepoint regop;" : "begin;")
+
+#define REG_DB_END(pConn) \
+    ((pConn)->bInBatch ? "release regop;" : "end")
+
+#define REG_DB_ROLLBACK(pConn) \
+    ((pConn)->bInBatch ? "rollback to regop; release regop;" : "rollback")
+
 typedef struct _REG_DB_CONNECTION
 {
     sqlite3 *pDb;
     pthread_rwlock_t lock;
+    // TRUE while an outer batch transaction is open (see RegDbBeginBatch)
+    BOOLEAN bInBatch;
 
     // registry user view related sql statement
 
@@ -441,6 +464,17 @@ RegDbFlushNOP(
     REG_DB_HANDLE hDb
     );
 
+NTSTATUS
+RegDbBeginBatch(
+    IN REG_DB_HANDLE hDb
+    );
+
+NTSTATUS
+RegDbEndBatch(
+    IN REG_DB_HANDLE hDb,
+    IN BOOLEAN bCommit
+    );
+
 
 //Inlock db utility functions
 NTSTATUS
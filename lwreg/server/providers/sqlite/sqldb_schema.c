@@ -210,7 +210,7 @@ RegDbStoreRegValueAttributes(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -325,7 +325,7 @@ RegDbStoreRegValueAttributes(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -351,7 +351,7 @@ cleanup:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
-                 "rollback",
+                 REG_DB_ROLLBACK(pConn),
                  NULL,
                  NULL,
                  NULL);
@@ -423,7 +423,7 @@ RegDbUpdateRegValueAttributes(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -529,7 +529,7 @@ RegDbUpdateRegValueAttributes(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -555,7 +555,7 @@ cleanup:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
-                 "rollback",
+                 REG_DB_ROLLBACK(pConn),
                  NULL,
                  NULL,
                  NULL);
@@ -641,7 +641,7 @@ RegDbGetValueAttributes(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -658,7 +658,7 @@ RegDbGetValueAttributes(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -679,7 +679,7 @@ error:
     }
     sqlite3_exec(
              pConn->pDb,
-            "rollback",
+            REG_DB_ROLLBACK(pConn),
              NULL,
              NULL,
              NULL);
@@ -881,7 +881,7 @@ RegDbQueryDefaultValuesCount(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -895,7 +895,7 @@ RegDbQueryDefaultValuesCount(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -916,7 +916,7 @@ cleanup:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
-                 "rollback",
+                 REG_DB_ROLLBACK(pConn),
                  NULL,
                  NULL,
                  NULL);
@@ -1033,7 +1033,7 @@ RegDbQueryDefaultValues(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1050,7 +1050,7 @@ RegDbQueryDefaultValues(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1071,7 +1071,7 @@ cleanup:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
-                 "rollback",
+                 REG_DB_ROLLBACK(pConn),
                  NULL,
                  NULL,
                  NULL);
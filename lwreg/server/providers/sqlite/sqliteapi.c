@@ -1017,7 +1017,7 @@ SqliteDeleteValue(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1059,7 +1059,7 @@ SqliteDeleteValue(
 
     status = sqlite3_exec(
                     pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1084,7 +1084,7 @@ error:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
-                 "rollback",
+                 REG_DB_ROLLBACK(pConn),
                  NULL,
                  NULL,
                  NULL);
@@ -1321,7 +1321,7 @@ SqliteDeleteTree(
 
     status = sqlite3_exec(
     		        pConn->pDb,
-                    "begin;",
+                    REG_DB_BEGIN(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1360,7 +1360,7 @@ SqliteDeleteTree(
 
     status = sqlite3_exec(
     		        pConn->pDb,
-                    "end",
+                    REG_DB_END(pConn),
                     NULL,
                     NULL,
                     &pszError);
@@ -1386,7 +1386,7 @@ error:
         sqlite3_free(pszError);
     }
     sqlite3_exec(pConn->pDb,
-	 			 "rollback",
+	 			 REG_DB_ROLLBACK(pConn),
 	 			 NULL,
 	 		     NULL,
 			     NULL);
@@ -1394,6 +1394,34 @@ error:
     goto cleanup;
 }
 
+NTSTATUS
+SqliteBeginTransaction(
+    IN HANDLE Handle
+    )
+{
+    return RegDbBeginBatch(ghCacheConnection);
+}
+
+NTSTATUS
+SqliteEndTransaction(
+    IN HANDLE Handle,
+    IN BOOLEAN bCommit
+    )
+{
+    NTSTATUS status = STATUS_SUCCESS;
+
+    status = RegDbEndBatch(ghCacheConnection, bCommit);
+
+    if (!bCommit || status)
+    {
+        // Keys and values cached while the batch was open may no longer
+        // exist in the database
+        SqliteCacheResetAll();
+    }
+
+    return status;
+}
+
 NTSTATUS
 SqliteQueryMultipleValues(
     IN HANDLE Handle,
@@ -145,6 +145,17 @@ SqliteDeleteTree(
     PCWSTR pSubKey
     );
 
+NTSTATUS
+SqliteBeginTransaction(
+    IN HANDLE Handle
+    );
+
+NTSTATUS
+SqliteEndTransaction(
+    IN HANDLE Handle,
+    IN BOOLEAN bCommit
+    );
+
 NTSTATUS
 SqliteGetValue(
     IN HANDLE Handle,
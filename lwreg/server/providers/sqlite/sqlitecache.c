@@ -916,6 +916,46 @@ SqliteReleaseDbKeyInfo_inlock(
     }
 }
 
+/* Drop every cached key index and force active keys to reload their
+ * subkey, value and security information from the database; used after a
+ * batch transaction is rolled back.
+ */
+VOID
+SqliteCacheResetAll(
+    VOID
+    )
+{
+    BOOLEAN bInLock = FALSE;
+    BOOLEAN bInKeyLock = FALSE;
+    REG_HASH_ITERATOR hashIterator;
+    REG_HASH_ENTRY* pHashEntry = NULL;
+    PREG_KEY_CONTEXT pKeyResult = NULL;
+
+    LWREG_LOCK_MUTEX(bInLock, &gRegDbKeyList.mutex);
+
+    RegHashRemoveAll(gRegDbKeyList.pKeyList);
+
+    LWREG_UNLOCK_MUTEX(bInLock, &gRegDbKeyList.mutex);
+
+    LWREG_LOCK_MUTEX(bInLock, &gActiveKeyList.mutex);
+
+    RegHashGetIterator(gActiveKeyList.pKeyList, &hashIterator);
+
+    while ((pHashEntry = RegHashNext(&hashIterator)) != NULL)
+    {
+        pKeyResult = (PREG_KEY_CONTEXT)pHashEntry->pValue;
+
+        RegSrvResetSubKeyInfo(pKeyResult);
+        RegSrvResetValueInfo(pKeyResult);
+
+        LWREG_LOCK_RWMUTEX_EXCLUSIVE(bInKeyLock, &pKeyResult->mutex);
+        pKeyResult->bHasSdInfo = FALSE;
+        LWREG_UNLOCK_RWMUTEX(bInKeyLock, &pKeyResult->mutex);
+    }
+
+    LWREG_UNLOCK_MUTEX(bInLock, &gActiveKeyList.mutex);
+}
+
 
 NTSTATUS
 SqliteCacheKeyDefaultValuesInfo_inlock(
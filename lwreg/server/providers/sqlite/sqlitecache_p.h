@@ -261,5 +261,10 @@ SqliteReleaseDbKeyInfo_inlock(
     PREG_DB_KEY pRegKey
     );
 
+VOID
+SqliteCacheResetAll(
+    VOID
+    );
+
 
 #endif // __SQLITECACHE__P_H_
@@ -355,10 +355,16 @@ RegShellImportFile(
     DWORD lineNum = 0;
     REGSHELL_UTIL_IMPORT_CONTEXT importCtx = {0};
     CHAR cErrorBuf[512] = {0};
+    BOOLEAN bInTransaction = FALSE;
 
     dwError = RegParseOpen(rsItem->args[0], NULL, NULL, &parseH);
     BAIL_ON_REG_ERROR(dwError);
 
+    /* Import the whole file as one transaction */
+    dwError = RegBeginTransaction(hReg);
+    BAIL_ON_REG_ERROR(dwError);
+    bInTransaction = TRUE;
+
     importCtx.hReg = hReg;
     importCtx.eImportMode = eMode;
 
@@ -372,12 +378,20 @@ RegShellImportFile(
     dwError = RegParseRegistry(parseH);
     BAIL_ON_REG_ERROR(dwError);
 
+    bInTransaction = FALSE;
+    dwError = RegCommitTransaction(hReg);
+    BAIL_ON_REG_ERROR(dwError);
+
     RegParseClose(parseH);
 
 cleanup:
     return dwError;
 
 error:
+    if (bInTransaction)
+    {
+        RegRollbackTransaction(hReg);
+    }
     RegParseGetLineNumber(parseH, &lineNum);
     sprintf(cErrorBuf, "lwregshell: import failed (line=%d)", lineNum);
     RegPrintError(cErrorBuf, dwError);
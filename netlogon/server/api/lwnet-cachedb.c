@@ -52,6 +52,19 @@
 
 struct _LWNET_CACHE_DB_HANDLE_DATA {
     PDLINKEDLIST pCacheList;
+    // Registry value names (PSTR) of entries that were removed from
+    // pCacheList since the last flush.
+    PDLINKEDLIST pDeletedList;
+    // Set when the registry copy can no longer be patched entry by
+    // entry (legacy per-field layout, undecodable values or a failed
+    // flush), so the next flush rewrites the whole cache key.
+    BOOLEAN bIsFullFlushNeeded;
+    BOOLEAN bIsWrite;
+    LWMsgDataContext* pDataContext;
+    // Serializes flushes so that an older snapshot can never be
+    // written over a newer one.
+    pthread_mutex_t FlushLock;
+    pthread_mutex_t* pFlushLock;
     // This RW lock helps us to ensure that we don't stomp
     // ourselves while giving up good parallel access.
     // Note, however, that SQLite might still return busy errors
@@ -79,6 +92,7 @@ LWMsgTypeSpec gLWNetCacheEntrySpec[] =
     LWMSG_MEMBER_UINT32(LWNET_DC_INFO, dwPingTime),
     LWMSG_MEMBER_UINT32(LWNET_DC_INFO, dwDomainControllerAddressType),
     LWMSG_MEMBER_UINT32(LWNET_DC_INFO, dwFlags),
+    LWMSG_MEMBER_UINT32(LWNET_DC_INFO, dwVersion),
     LWMSG_MEMBER_UINT16(LWNET_DC_INFO, wLMToken),
     LWMSG_MEMBER_UINT16(LWNET_DC_INFO, wNTToken),
     LWMSG_MEMBER_PSTR(LWNET_DC_INFO, pszDomainControllerName),
@@ -99,6 +113,14 @@ LWMsgTypeSpec gLWNetCacheEntrySpec[] =
     LWMSG_TYPE_END
 };
 
+// Registry value snapshot of one dirty cache entry, taken under the
+// cache lock and written out after the lock is dropped.
+typedef struct _LWNET_CACHE_DB_FLUSH_ITEM {
+    PSTR pszValueName;
+    PVOID pBuffer;
+    size_t sBufferSize;
+} LWNET_CACHE_DB_FLUSH_ITEM, *PLWNET_CACHE_DB_FLUSH_ITEM;
+
 // ISSUE-2008/07/01-dalmeida -- For now, use exlusive locking as we need to
 // verify actual thread safety wrt things like error strings and such.
 #define RW_LOCK_ACQUIRE_READ(Lock) \
@@ -131,10 +153,34 @@ LWNetCacheDbReadFromRegistry(
     LWNET_CACHE_DB_HANDLE dbHandle
     );
 
+static
+DWORD
+LWNetCacheDbReadLegacyFromRegistry(
+    HANDLE hReg,
+    LWNET_CACHE_DB_HANDLE dbHandle
+    );
+
 static
 DWORD
 LWNetCacheDbWriteToRegistry(
-    PDLINKEDLIST pCacheList
+    IN BOOLEAN bIsFullFlush,
+    IN PDLINKEDLIST pDeletedList,
+    IN PLWNET_CACHE_DB_FLUSH_ITEM pItems,
+    IN DWORD dwItemCount
+    );
+
+static
+DWORD
+LWNetCacheDbGetValueName(
+    IN PLWNET_CACHE_DB_ENTRY pEntry,
+    OUT PSTR* ppszValueName
+    );
+
+static
+VOID
+LWNetCacheDbForEachStringDestroy(
+    IN PVOID pData,
+    IN PVOID pContext
     );
 
 static
@@ -144,6 +190,12 @@ LWNetCacheDbForEachEntryDestroy(
     IN PVOID pContext
     );
 
+static
+VOID
+LWNetCacheDbEntryFreeContents(
+    IN OUT PLWNET_CACHE_DB_ENTRY pEntry
+    );
+
 static
 VOID
 LWNetCacheDbEntryFree(
@@ -161,7 +213,8 @@ LWNetCacheDbUpdate(
     IN LWNET_UNIX_TIME_T LastPinged,
     IN BOOLEAN IsBackoffToWritableDc,
     IN OPTIONAL LWNET_UNIX_TIME_T LastBackoffToWritableDc,
-    IN PLWNET_DC_INFO pDcInfo
+    IN PLWNET_DC_INFO pDcInfo,
+    IN BOOLEAN bIsDirty
     );
 
 #if ENABLE_CACHEDB_DEBUG
@@ -267,12 +320,29 @@ LWNetCacheDbOpen(
 
     dbHandle->pLock = &dbHandle->Lock;
 
+    lError = pthread_mutex_init(&dbHandle->FlushLock, NULL);
+    dwError = LwMapErrnoToLwError(lError);
+    BAIL_ON_LWNET_ERROR(dwError);
+
+    dbHandle->pFlushLock = &dbHandle->FlushLock;
+    dbHandle->bIsWrite = bIsWrite;
+
+    dwError = MAP_LWMSG_ERROR(lwmsg_data_context_new(
+                                  NULL,
+                                  &dbHandle->pDataContext));
+    BAIL_ON_LWNET_ERROR(dwError);
+
     dwError = LWNetCacheDbReadFromRegistry(dbHandle);
     BAIL_ON_LWNET_ERROR(dwError);
 
 error:
     if (dwError)
     {
+        if (dbHandle)
+        {
+            // Never persist a partially loaded cache.
+            dbHandle->bIsWrite = FALSE;
+        }
         LWNetCacheDbClose(&dbHandle);
     }    
     *pDbHandle = dbHandle;
@@ -288,15 +358,35 @@ LWNetCacheDbClose(
 
     if (dbHandle)
     {
+        if (dbHandle->pLock && dbHandle->pFlushLock &&
+            dbHandle->pDataContext)
+        {
+            LWNetCacheDbFlush(dbHandle);
+        }
         if (dbHandle->pCacheList)
         {
-            LWNetCacheDbWriteToRegistry(dbHandle->pCacheList);
             LWNetDLinkedListForEach(
                 dbHandle->pCacheList,
                 LWNetCacheDbForEachEntryDestroy,
                 NULL);
             LWNetDLinkedListFree(dbHandle->pCacheList);
         }
+        if (dbHandle->pDeletedList)
+        {
+            LWNetDLinkedListForEach(
+                dbHandle->pDeletedList,
+                LWNetCacheDbForEachStringDestroy,
+                NULL);
+            LWNetDLinkedListFree(dbHandle->pDeletedList);
+        }
+        if (dbHandle->pDataContext)
+        {
+            lwmsg_data_context_delete(dbHandle->pDataContext);
+        }
+        if (dbHandle->pFlushLock)
+        {
+            pthread_mutex_destroy(dbHandle->pFlushLock);
+        }
         if (dbHandle->pLock)
         {
             pthread_rwlock_destroy(dbHandle->pLock);
@@ -319,6 +409,37 @@ LWNetCacheDbForEachEntryDestroy(
     LWNetCacheDbEntryFree(pEntry);
 }
 
+static
+VOID
+LWNetCacheDbForEachStringDestroy(
+    IN PVOID pData,
+    IN PVOID pContext
+    )
+{
+    PSTR pszString = (PSTR)pData;
+    LWNET_SAFE_FREE_STRING(pszString);
+}
+
+static
+VOID
+LWNetCacheDbEntryFreeContents(
+    IN OUT PLWNET_CACHE_DB_ENTRY pEntry
+    )
+{
+    LWNET_SAFE_FREE_STRING(pEntry->pszDnsDomainName);
+    LWNET_SAFE_FREE_STRING(pEntry->pszSiteName);
+    LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszDomainControllerName);
+    LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszDomainControllerAddress);
+    LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszNetBIOSDomainName);
+    LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszFullyQualifiedDomainName);
+    LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszDnsForestName);
+    LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszDCSiteName);
+    LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszClientSiteName);
+    LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszNetBIOSHostName);
+    LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszUserName);
+    memset(pEntry, 0, sizeof(*pEntry));
+}
+
 static
 VOID
 LWNetCacheDbEntryFree(
@@ -327,17 +448,7 @@ LWNetCacheDbEntryFree(
 {
     if (pEntry)
     {
-        LWNET_SAFE_FREE_STRING(pEntry->pszDnsDomainName);
-        LWNET_SAFE_FREE_STRING(pEntry->pszSiteName);
-        LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszDomainControllerName);
-        LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszDomainControllerAddress);
-        LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszNetBIOSDomainName);
-        LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszFullyQualifiedDomainName);
-        LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszDnsForestName);
-        LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszDCSiteName);
-        LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszClientSiteName);
-        LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszNetBIOSHostName);
-        LWNET_SAFE_FREE_STRING(pEntry->DcInfo.pszUserName);
+        LWNetCacheDbEntryFreeContents(pEntry);
         LWNET_SAFE_FREE_MEMORY(pEntry);
     }
 }
@@ -668,15 +779,21 @@ LWNetCacheDbReadFromRegistry(
     )
 {
     DWORD dwError = 0;
+    LWMsgStatus status = LWMSG_STATUS_SUCCESS;
     HANDLE hReg = NULL;
-    LW_WCHAR **ppSubKeys = NULL;
-    PSTR pszError = NULL;
+    HKEY hRootKey = NULL;
+    HKEY hCacheKey = NULL;
     DWORD dwSubKeyCount = 0;
+    DWORD dwValueCount = 0;
+    DWORD dwMaxValueNameLen = 0;
+    DWORD dwMaxValueLen = 0;
+    DWORD dwValueNameLen = 0;
+    DWORD dwValueLen = 0;
+    DWORD dwType = 0;
     DWORD i = 0;
-    HKEY pNetLogonKey = NULL;
-    LWNET_CACHE_DB_ENTRY cacheEntry;
-
-    memset(&cacheEntry, 0, sizeof(cacheEntry));
+    PSTR pszValueName = NULL;
+    PBYTE pValue = NULL;
+    PLWNET_CACHE_DB_ENTRY pEntry = NULL;
 
     /* Open connection to registry */
     dwError = RegOpenServer(&hReg);
@@ -687,7 +804,7 @@ LWNetCacheDbReadFromRegistry(
                   HKEY_THIS_MACHINE,
                   LWNET_NETLOGON_REGISTRY_KEY "\\" LWNET_CACHE_REGISTRY_KEY);
 
-    /* cachedb entry does not exist until netlogond is stopped, so this
+    /* cachedb entry does not exist until the first cache update, so this
      * is not an error when this entry is not found.
      */
     if (dwError)
@@ -696,6 +813,167 @@ LWNetCacheDbReadFromRegistry(
         goto cleanup;
     }
 
+    dwError = RegOpenKeyExA(
+                  hReg,
+                  NULL,
+                  HKEY_THIS_MACHINE,
+                  0,
+                  KEY_READ,
+                  &hRootKey);
+    BAIL_ON_LWNET_ERROR(dwError);
+
+    dwError = RegOpenKeyExA(
+                  hReg,
+                  hRootKey,
+                  LWNET_NETLOGON_REGISTRY_KEY "\\" LWNET_CACHE_REGISTRY_KEY,
+                  0,
+                  KEY_READ,
+                  &hCacheKey);
+    BAIL_ON_LWNET_ERROR(dwError);
+
+    dwError = RegQueryInfoKeyA(
+                  hReg,
+                  hCacheKey,
+                  NULL,
+                  NULL,
+                  NULL,
+                  &dwSubKeyCount,
+                  NULL,
+                  NULL,
+                  &dwValueCount,
+                  &dwMaxValueNameLen,
+                  &dwMaxValueLen,
+                  NULL,
+                  NULL);
+    BAIL_ON_LWNET_ERROR(dwError);
+
+    if (dwValueCount)
+    {
+        dwError = LWNetAllocateMemory(
+                      dwMaxValueNameLen + 1,
+                      OUT_PPVOID(&pszValueName));
+        BAIL_ON_LWNET_ERROR(dwError);
+
+        dwError = LWNetAllocateMemory(
+                      dwMaxValueLen ? dwMaxValueLen : 1,
+                      OUT_PPVOID(&pValue));
+        BAIL_ON_LWNET_ERROR(dwError);
+    }
+
+    /*
+     * Each cached entry is stored as a single REG_BINARY value holding
+     * the entry marshalled with gLWNetCacheEntrySpec.
+     */
+    for (i = 0; i < dwValueCount; i++)
+    {
+        dwValueNameLen = dwMaxValueNameLen + 1;
+        dwValueLen = dwMaxValueLen;
+
+        dwError = RegEnumValueA(
+                      hReg,
+                      hCacheKey,
+                      i,
+                      pszValueName,
+                      &dwValueNameLen,
+                      NULL,
+                      &dwType,
+                      pValue,
+                      &dwValueLen);
+        BAIL_ON_LWNET_ERROR(dwError);
+
+        if (dwType != REG_BINARY)
+        {
+            continue;
+        }
+
+        status = lwmsg_data_unmarshal_flat(
+                     dbHandle->pDataContext,
+                     gLWNetCacheEntrySpec,
+                     pValue,
+                     dwValueLen,
+                     OUT_PPVOID(&pEntry));
+        if (status)
+        {
+            LWNET_LOG_WARNING("Warning: invalid cache registry value '%s'",
+                              pszValueName);
+            dbHandle->bIsFullFlushNeeded = TRUE;
+            continue;
+        }
+
+        dwError = LWNetCacheDbUpdate(
+                      dbHandle,
+                      pEntry->pszDnsDomainName,
+                      pEntry->pszSiteName,
+                      pEntry->QueryType,
+                      pEntry->LastDiscovered,
+                      pEntry->LastPinged,
+                      pEntry->IsBackoffToWritableDc,
+                      pEntry->LastBackoffToWritableDc,
+                      &pEntry->DcInfo,
+                      FALSE);
+        BAIL_ON_LWNET_ERROR(dwError);
+
+        lwmsg_data_free_graph(
+            dbHandle->pDataContext,
+            gLWNetCacheEntrySpec,
+            pEntry);
+        pEntry = NULL;
+    }
+
+    /* Subkeys are entries saved in the old per-field layout */
+    if (dwSubKeyCount)
+    {
+        dwError = LWNetCacheDbReadLegacyFromRegistry(hReg, dbHandle);
+        BAIL_ON_LWNET_ERROR(dwError);
+    }
+
+cleanup:
+    if (pEntry)
+    {
+        lwmsg_data_free_graph(
+            dbHandle->pDataContext,
+            gLWNetCacheEntrySpec,
+            pEntry);
+    }
+    if (hReg)
+    {
+        if (hCacheKey)
+        {
+            RegCloseKey(hReg, hCacheKey);
+        }
+        if (hRootKey)
+        {
+            RegCloseKey(hReg, hRootKey);
+        }
+        RegCloseServer(hReg);
+    }
+    LWNET_SAFE_FREE_MEMORY(pszValueName);
+    LWNET_SAFE_FREE_MEMORY(pValue);
+
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+
+static
+DWORD
+LWNetCacheDbReadLegacyFromRegistry(
+    HANDLE hReg,
+    LWNET_CACHE_DB_HANDLE dbHandle
+    )
+{
+    DWORD dwError = 0;
+    LW_WCHAR **ppSubKeys = NULL;
+    PSTR pszError = NULL;
+    DWORD dwSubKeyCount = 0;
+    DWORD i = 0;
+    HKEY pNetLogonKey = NULL;
+    LWNET_CACHE_DB_ENTRY cacheEntry;
+
+    memset(&cacheEntry, 0, sizeof(cacheEntry));
+
     dwError = RegUtilGetKeys(
                   hReg,
                   HKEY_THIS_MACHINE,
@@ -719,6 +997,8 @@ LWNetCacheDbReadFromRegistry(
                       hReg,
                       pNetLogonKey,
                       &cacheEntry);
+        RegCloseKey(hReg, pNetLogonKey);
+        pNetLogonKey = NULL;
         if (dwError == LWREG_ERROR_NO_SUCH_KEY_OR_VALUE)
         {
             LwWc16sToMbs(ppSubKeys[i],
@@ -729,12 +1009,11 @@ LWNetCacheDbReadFromRegistry(
                                   "'%s'", pszError);
                 LWNET_SAFE_FREE_MEMORY(pszError);
             }
+            LWNetCacheDbEntryFreeContents(&cacheEntry);
             dwError = 0;
             continue;
         }
         BAIL_ON_LWNET_ERROR(dwError);
-        RegCloseKey(hReg, pNetLogonKey);
-        pNetLogonKey = NULL;
 
         dwError = LWNetCacheDbUpdate(
                       dbHandle,
@@ -745,18 +1024,19 @@ LWNetCacheDbReadFromRegistry(
                       cacheEntry.LastPinged,
                       cacheEntry.IsBackoffToWritableDc,
                       cacheEntry.LastBackoffToWritableDc,
-                      &cacheEntry.DcInfo);
+                      &cacheEntry.DcInfo,
+                      FALSE);
         BAIL_ON_LWNET_ERROR(dwError);
-        memset(&cacheEntry, 0, sizeof(cacheEntry));
+        LWNetCacheDbEntryFreeContents(&cacheEntry);
     }
+
+    /* Convert the whole cache key to the new layout on the next flush */
+    dbHandle->bIsFullFlushNeeded = TRUE;
+
 cleanup:
-    if (hReg)
+    if (pNetLogonKey)
     {
-        if (pNetLogonKey)
-        {
-            RegCloseKey(hReg, pNetLogonKey);
-        }
-        RegCloseServer(hReg);
+        RegCloseKey(hReg, pNetLogonKey);
     }
 
     if (ppSubKeys)
@@ -768,6 +1048,8 @@ cleanup:
         LWNET_SAFE_FREE_MEMORY(ppSubKeys);
     }
 
+    LWNetCacheDbEntryFreeContents(&cacheEntry);
+
     return dwError;
 
 error:
@@ -775,200 +1057,305 @@ error:
 }
 
 
+static
 DWORD
-LWNetCacheDbRegistryWriteValue(
-    HANDLE hReg,
-    PSTR pszSubKey,
-    PSTR pszValueName,
-    DWORD dwType,
-    PVOID pValue,
-    DWORD dwValueLen)
+LWNetCacheDbGetValueName(
+    IN PLWNET_CACHE_DB_ENTRY pEntry,
+    OUT PSTR* ppszValueName
+    )
 {
+    return LwAllocateStringPrintf(
+               ppszValueName,
+               "%s%s%s-%d",
+               pEntry->pszDnsDomainName ? pEntry->pszDnsDomainName : "",
+               pEntry->pszSiteName ? "-" : "",
+               pEntry->pszSiteName ? pEntry->pszSiteName : "",
+               (int) pEntry->QueryType);
+}
+
+
+static
+DWORD
+LWNetCacheDbWriteToRegistry(
+    IN BOOLEAN bIsFullFlush,
+    IN PDLINKEDLIST pDeletedList,
+    IN PLWNET_CACHE_DB_FLUSH_ITEM pItems,
+    IN DWORD dwItemCount
+    )
+{
+    HANDLE hReg = NULL;
+    HKEY hRootKey = NULL;
+    HKEY hCacheKey = NULL;
     DWORD dwError = 0;
-    DWORD dwDataLen = 0;
-    DWORD dwData = 0;
-    PVOID pData = NULL;
-    PSTR pszValue = NULL;
+    DWORD i = 0;
+    BOOLEAN bInTransaction = FALSE;
 
-    switch (dwType)
-    {
-        case REG_SZ:
-            pszValue = *((PSTR *) pValue);
-            if (pszValue)
-            {
-                dwDataLen = strlen(pszValue);
-                pData = pszValue;
-            }
-            else
-            {
-                pszValue = "";
-                dwDataLen = 0;
-                pData = (PVOID) pszValue;
-            }
-            break;
+    /* Open connection to registry */
+    dwError = RegOpenServer(&hReg);
+    BAIL_ON_LWNET_ERROR(dwError);
 
-        case REG_DWORD:
-        default:
-            if (dwValueLen == sizeof(WORD))
-            {
-                dwData = *((WORD *) pValue);
-            }
-            else
-            {
-                dwData = *((DWORD *) pValue);
-            }
-            pData = (PVOID) &dwData;
-            dwDataLen = sizeof(DWORD);
-            break;
+    /*
+     * Write the whole flush as one registry transaction. If that is not
+     * possible, fall back to writing each value on its own.
+     */
+    dwError = RegBeginTransaction(hReg);
+    if (dwError)
+    {
+        LWNET_LOG_VERBOSE("Could not start registry transaction [%d]",
+                          dwError);
+        dwError = 0;
+    }
+    else
+    {
+        bInTransaction = TRUE;
+    }
 
-        case REG_BINARY:
-            dwDataLen = dwValueLen;
-            pData = (PVOID) pValue;
-            break;
+    if (bIsFullFlush)
+    {
+        /* Don't care if this fails, just remove the old cache if it exists */
+        RegUtilDeleteTree(hReg,
+                          HKEY_THIS_MACHINE,
+                          LWNET_NETLOGON_REGISTRY_KEY,
+                          LWNET_CACHE_REGISTRY_KEY);
     }
 
-    dwError = RegUtilSetValue(
+    dwError = RegUtilAddKey(
                   hReg,
                   HKEY_THIS_MACHINE,
-                  LWNET_NETLOGON_REGISTRY_KEY "\\" LWNET_CACHE_REGISTRY_KEY,
-                  pszSubKey,
-                  pszValueName,
-                  dwType,
-                  pData,
-                  dwDataLen);
+                  LWNET_NETLOGON_REGISTRY_KEY,
+                  LWNET_CACHE_REGISTRY_KEY);
     BAIL_ON_LWNET_ERROR(dwError);
 
-cleanup:
-    return dwError;
-
-error:
-    goto cleanup;
-}
-
-
-DWORD
-LWNetCacheDbRegistryWriteValues(
-    HANDLE hReg,
-    PSTR pszSubKey,
-    PLWNET_CACHE_DB_ENTRY pEntry)
-{
-
-    DWORD dwError = 0;
-    DWORD index = 0;
-    DWORD dwArrayEntries = 0;
-    PLWNET_CACHE_REGISTRY_VALUE valueArray = NULL;
+    dwError = RegOpenKeyExA(
+                  hReg,
+                  NULL,
+                  HKEY_THIS_MACHINE,
+                  0,
+                  KEY_READ,
+                  &hRootKey);
+    BAIL_ON_LWNET_ERROR(dwError);
 
-    dwError = LWNetCacheDbRegistryInitValueArray(
-                  pEntry,
-                  &valueArray,
-                  &dwArrayEntries);
+    dwError = RegOpenKeyExA(
+                  hReg,
+                  hRootKey,
+                  LWNET_NETLOGON_REGISTRY_KEY "\\" LWNET_CACHE_REGISTRY_KEY,
+                  0,
+                  KEY_ALL_ACCESS,
+                  &hCacheKey);
     BAIL_ON_LWNET_ERROR(dwError);
 
-    for (index=0; index<dwArrayEntries; index++)
+    /*
+     * Deletions go first so that an entry which was scavenged and then
+     * re-added within the same flush ends up present.
+     */
+    for (; !bIsFullFlush && pDeletedList; pDeletedList = pDeletedList->pNext)
     {
-        dwError = LWNetCacheDbRegistryWriteValue(
+        dwError = RegDeleteValueA(
                       hReg,
-                      pszSubKey,
-                      valueArray[index].pszValueName,
-                      valueArray[index].dwType,
-                      valueArray[index].pValue,
-                      valueArray[index].dwValueLen);
+                      hCacheKey,
+                      (PCSTR) pDeletedList->pItem);
+        if (dwError == LWREG_ERROR_NO_SUCH_KEY_OR_VALUE)
+        {
+            dwError = 0;
+        }
+        BAIL_ON_LWNET_ERROR(dwError);
+    }
+
+    for (i = 0; i < dwItemCount; i++)
+    {
+        dwError = RegSetValueExA(
+                      hReg,
+                      hCacheKey,
+                      pItems[i].pszValueName,
+                      0,
+                      REG_BINARY,
+                      pItems[i].pBuffer,
+                      (DWORD) pItems[i].sBufferSize);
+        BAIL_ON_LWNET_ERROR(dwError);
+    }
+
+    if (bInTransaction)
+    {
+        bInTransaction = FALSE;
+        dwError = RegCommitTransaction(hReg);
         BAIL_ON_LWNET_ERROR(dwError);
     }
 
 cleanup:
-    LWNET_SAFE_FREE_MEMORY(valueArray);
+    if (hReg)
+    {
+        if (hCacheKey)
+        {
+            RegCloseKey(hReg, hCacheKey);
+        }
+        if (hRootKey)
+        {
+            RegCloseKey(hReg, hRootKey);
+        }
+        RegCloseServer(hReg);
+    }
+
     return dwError;
 
 error:
+    if (bInTransaction)
+    {
+        RegRollbackTransaction(hReg);
+    }
+
+    LWNET_LOG_ERROR("Failed to save cache %s [%d]",
+                    HKEY_THIS_MACHINE "\\" LWNET_CACHE_REGISTRY_KEY,
+                    dwError);
+
     goto cleanup;
 }
 
 
-static
 DWORD
-LWNetCacheDbWriteToRegistry(
-    PDLINKEDLIST pCacheList
+LWNetCacheDbFlush(
+    IN LWNET_CACHE_DB_HANDLE DbHandle
     )
 {
-    HANDLE hReg = NULL;
-    HKEY pRootKey = NULL;
     DWORD dwError = 0;
-    PSTR pszNewCacheKey = NULL;
-    PVOID pData = NULL;
-    PLWNET_CACHE_DB_ENTRY pCacheDbEntry = NULL;
+    BOOLEAN isAcquired = FALSE;
+    BOOLEAN isFlushAcquired = FALSE;
+    BOOLEAN bIsFullFlush = FALSE;
+    PLWNET_CACHE_DB_FLUSH_ITEM pItems = NULL;
+    DWORD dwItemCount = 0;
+    DWORD i = 0;
+    PDLINKEDLIST pDeletedList = NULL;
+    PDLINKEDLIST pListEntry = NULL;
+    PLWNET_CACHE_DB_ENTRY pEntry = NULL;
 
-    /* Open connection to registry */
-    dwError = RegOpenServer(&hReg);
-    BAIL_ON_LWNET_ERROR(dwError);
+    if (!DbHandle->bIsWrite)
+    {
+        goto cleanup;
+    }
 
-    /* Don't care if this fails, just remove the old cache if it exists */
-    RegUtilDeleteTree(hReg,
-                      HKEY_THIS_MACHINE,
-                      LWNET_NETLOGON_REGISTRY_KEY,
-                      LWNET_CACHE_REGISTRY_KEY);
+    pthread_mutex_lock(DbHandle->pFlushLock);
+    isFlushAcquired = TRUE;
 
-    dwError = RegUtilAddKey(
-                  hReg,
-                  HKEY_THIS_MACHINE,
-                  LWNET_NETLOGON_REGISTRY_KEY,
-                  LWNET_CACHE_REGISTRY_KEY);
-    BAIL_ON_LWNET_ERROR(dwError);
+    RW_LOCK_ACQUIRE_WRITE(DbHandle->pLock);
+    isAcquired = TRUE;
 
-    /*
-     * Create new keys for every cached entry, and fill in the values under
-     * each key
-     */
-    while (pCacheList)
+    bIsFullFlush = DbHandle->bIsFullFlushNeeded;
+
+    for (pListEntry = DbHandle->pCacheList;
+         pListEntry;
+         pListEntry = pListEntry->pNext)
+    {
+        pEntry = (PLWNET_CACHE_DB_ENTRY)pListEntry->pItem;
+
+        if (bIsFullFlush || pEntry->bIsDirty)
+        {
+            dwItemCount++;
+        }
+    }
+
+    if (!dwItemCount && !DbHandle->pDeletedList && !bIsFullFlush)
+    {
+        goto cleanup;
+    }
+
+    if (dwItemCount)
     {
-        /* Create new registry subkey for each cached entry */
-        pCacheDbEntry = (PLWNET_CACHE_DB_ENTRY) pCacheList->pItem;
-
-        dwError = LwAllocateStringPrintf(
-                       &pszNewCacheKey,
-                      "%s%s%s-%d",
-                       pCacheDbEntry->pszDnsDomainName ?
-                           pCacheDbEntry->pszDnsDomainName : "",
-                       pCacheDbEntry->pszSiteName ? "-" : "",
-                       pCacheDbEntry->pszSiteName ?
-                           pCacheDbEntry->pszSiteName : "",
-                       (int) pCacheDbEntry->QueryType);
+        dwError = LWNetAllocateMemory(
+                      sizeof(*pItems) * dwItemCount,
+                      OUT_PPVOID(&pItems));
         BAIL_ON_LWNET_ERROR(dwError);
+    }
 
-        dwError = RegUtilAddKey(
-                      hReg,
-                      HKEY_THIS_MACHINE,
-                      LWNET_NETLOGON_REGISTRY_KEY "\\" LWNET_CACHE_REGISTRY_KEY,
-                      pszNewCacheKey);
+    i = 0;
+    for (pListEntry = DbHandle->pCacheList;
+         pListEntry;
+         pListEntry = pListEntry->pNext)
+    {
+        pEntry = (PLWNET_CACHE_DB_ENTRY)pListEntry->pItem;
+
+        if (!bIsFullFlush && !pEntry->bIsDirty)
+        {
+            continue;
+        }
+
+        dwError = LWNetCacheDbGetValueName(pEntry, &pItems[i].pszValueName);
         BAIL_ON_LWNET_ERROR(dwError);
 
-        /* Add to registry the current entries */
-        dwError = LWNetCacheDbRegistryWriteValues(
-                      hReg,
-                      pszNewCacheKey,
-                      pCacheDbEntry);
+        dwError = MAP_LWMSG_ERROR(lwmsg_data_marshal_flat_alloc(
+                                      DbHandle->pDataContext,
+                                      gLWNetCacheEntrySpec,
+                                      pEntry,
+                                      &pItems[i].pBuffer,
+                                      &pItems[i].sBufferSize));
         BAIL_ON_LWNET_ERROR(dwError);
-        LWNET_SAFE_FREE_MEMORY(pszNewCacheKey);
 
-        pCacheList = pCacheList->pNext;
+        i++;
+    }
+
+    for (pListEntry = DbHandle->pCacheList;
+         pListEntry;
+         pListEntry = pListEntry->pNext)
+    {
+        pEntry = (PLWNET_CACHE_DB_ENTRY)pListEntry->pItem;
+        pEntry->bIsDirty = FALSE;
+    }
+
+    pDeletedList = DbHandle->pDeletedList;
+    DbHandle->pDeletedList = NULL;
+    DbHandle->bIsFullFlushNeeded = FALSE;
+
+    RW_LOCK_RELEASE_WRITE(DbHandle->pLock);
+    isAcquired = FALSE;
+
+    dwError = LWNetCacheDbWriteToRegistry(
+                  bIsFullFlush,
+                  pDeletedList,
+                  pItems,
+                  dwItemCount);
+    if (dwError)
+    {
+        /*
+         * We do not know how much of the snapshot made it, so
+         * rewrite everything next time.
+         */
+        RW_LOCK_ACQUIRE_WRITE(DbHandle->pLock);
+        isAcquired = TRUE;
+
+        DbHandle->bIsFullFlushNeeded = TRUE;
     }
+    BAIL_ON_LWNET_ERROR(dwError);
 
 cleanup:
-    if (pRootKey)
+    if (isAcquired)
+    {
+        RW_LOCK_RELEASE_WRITE(DbHandle->pLock);
+    }
+    if (isFlushAcquired)
+    {
+        pthread_mutex_unlock(DbHandle->pFlushLock);
+    }
+
+    if (pItems)
+    {
+        for (i = 0; i < dwItemCount; i++)
+        {
+            LWNET_SAFE_FREE_STRING(pItems[i].pszValueName);
+            LWNET_SAFE_FREE_MEMORY(pItems[i].pBuffer);
+        }
+        LWNET_SAFE_FREE_MEMORY(pItems);
+    }
+
+    if (pDeletedList)
     {
-        RegCloseKey(hReg, pRootKey);
+        LWNetDLinkedListForEach(
+            pDeletedList,
+            LWNetCacheDbForEachStringDestroy,
+            NULL);
+        LWNetDLinkedListFree(pDeletedList);
     }
-    RegCloseServer(hReg);
-    LWNET_SAFE_FREE_MEMORY(pData);
-    LWNET_SAFE_FREE_MEMORY(pszNewCacheKey);
 
     return dwError;
 
 error:
-    LWNET_LOG_ERROR("Failed to save cache %s [%d]",
-                    HKEY_THIS_MACHINE "\\" LWNET_CACHE_REGISTRY_KEY,
-                    dwError);
-
     goto cleanup;
 }
 
@@ -1184,7 +1571,8 @@ LWNetCacheDbUpdate(
     IN LWNET_UNIX_TIME_T LastPinged,
     IN BOOLEAN IsBackoffToWritableDc,
     IN OPTIONAL LWNET_UNIX_TIME_T LastBackoffToWritableDc,
-    IN PLWNET_DC_INFO pDcInfo
+    IN PLWNET_DC_INFO pDcInfo,
+    IN BOOLEAN bIsDirty
     )
 {
     DWORD dwError = 0;
@@ -1214,6 +1602,7 @@ LWNetCacheDbUpdate(
     }
 
     pNewEntry->QueryType = QueryType;
+    pNewEntry->bIsDirty = bIsDirty;
 
     pNewEntry->LastDiscovered = LastDiscovered;
     pNewEntry->LastPinged = LastPinged;
@@ -1342,8 +1731,11 @@ LWNetCacheDbScavenge(
     PDLINKEDLIST pListEntry = NULL;
     PDLINKEDLIST pNextListEntry = NULL;
     BOOLEAN isAcquired = FALSE;
+    PSTR pszValueName = NULL;
 
     dwError = LWNetGetSystemTime(&now);
+    BAIL_ON_LWNET_ERROR(dwError);
+
     positiveTimeLimit = now + PositiveCacheAge;
 
     RW_LOCK_ACQUIRE_WRITE(DbHandle->pLock);
@@ -1357,6 +1749,15 @@ LWNetCacheDbScavenge(
 
         if (pEntry->LastPinged < positiveTimeLimit)
         {
+            dwError = LWNetCacheDbGetValueName(pEntry, &pszValueName);
+            BAIL_ON_LWNET_ERROR(dwError);
+
+            dwError = LWNetDLinkedListAppend(
+                          &DbHandle->pDeletedList,
+                          pszValueName);
+            BAIL_ON_LWNET_ERROR(dwError);
+            pszValueName = NULL;
+
             LWNetDLinkedListDelete(
                 &DbHandle->pCacheList,
                 pEntry);
@@ -1367,11 +1768,14 @@ LWNetCacheDbScavenge(
         pListEntry = pNextListEntry;
     }
 
+error:
     if (isAcquired)
     {
         RW_LOCK_RELEASE_WRITE(DbHandle->pLock);
     }
 
+    LWNET_SAFE_FREE_STRING(pszValueName);
+
     return dwError;
 }
 
@@ -1574,7 +1978,8 @@ LWNetCacheUpdate(
                     LastPinged,
                     IsBackoffToWritableDc,
                     LastBackoffToWritableDc,
-                    pDcInfo);
+                    pDcInfo,
+                    TRUE);
     BAIL_ON_LWNET_ERROR(dwError);
 
     if (pDcInfo->pszDCSiteName &&
@@ -1589,10 +1994,20 @@ LWNetCacheUpdate(
                         LastPinged,
                         IsBackoffToWritableDc,
                         LastBackoffToWritableDc,
-                        pDcInfo);
+                        pDcInfo,
+                        TRUE);
         BAIL_ON_LWNET_ERROR(dwError);
     }
 
+    // Persist right away so that a crash does not lose the update.
+    // Only the entries changed above are written.
+    dwError = LWNetCacheDbFlush(gDbHandle);
+    if (dwError)
+    {
+        LWNET_LOG_WARNING("Failed to persist DC cache update [%u]", dwError);
+        dwError = 0;
+    }
+
 error:
     return dwError;
 }
@@ -1603,5 +2018,14 @@ LWNetCacheScavenge(
     IN LWNET_UNIX_TIME_T NegativeCacheAge
     )
 {
-    return LWNetCacheDbScavenge(gDbHandle, PositiveCacheAge, NegativeCacheAge);
+    DWORD dwError = 0;
+
+    dwError = LWNetCacheDbScavenge(gDbHandle, PositiveCacheAge, NegativeCacheAge);
+    BAIL_ON_LWNET_ERROR(dwError);
+
+    dwError = LWNetCacheDbFlush(gDbHandle);
+    BAIL_ON_LWNET_ERROR(dwError);
+
+error:
+    return dwError;
 }
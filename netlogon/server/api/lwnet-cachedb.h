@@ -81,6 +81,10 @@ typedef struct _LWNET_CACHE_DB_ENTRY {
     LWNET_UNIX_TIME_T LastBackoffToWritableDc;
 
     LWNET_DC_INFO DcInfo;
+
+    // Not persisted.  Set while the entry differs from its
+    // registry copy.
+    BOOLEAN bIsDirty;
 } LWNET_CACHE_DB_ENTRY, *PLWNET_CACHE_DB_ENTRY;
 
 
@@ -130,6 +134,11 @@ LWNetCacheDbQuery(
     OUT PLWNET_UNIX_TIME_T LastBackoffToWritableDc
     );
 
+DWORD
+LWNetCacheDbFlush(
+    IN LWNET_CACHE_DB_HANDLE DbHandle
+    );
+
 DWORD
 LWNetCacheDbScavenge(
     IN LWNET_CACHE_DB_HANDLE DbHandle,
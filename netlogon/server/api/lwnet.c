@@ -549,6 +549,7 @@ LWNetSrvPingCLdapArray(
     DWORD dwActualConnCount = 0;
     DWORD dwUsedServers = 0;
     DWORD dwIndexConn = 0;
+    BOOLEAN bShortPoll = FALSE;
     struct pollfd *Readfds = NULL;
 
     // The basic scheme is a big loop over:
@@ -560,7 +561,9 @@ LWNetSrvPingCLdapArray(
     // When starting CLDAP searches, a portion of the
     // available connections will be started followed
     // by a short poll until the maximum number of
-    // connections has been used.  Once the maximum
+    // connections has been used.  A batch that draws
+    // no response doubles the size of the next batch.
+    // Once the maximum
     // number of connections are in use, the polling
     // timeout will be the single search timeout for
     // the oldest connection.  This will start the
@@ -639,17 +642,21 @@ LWNetSrvPingCLdapArray(
             // If there are more connections available,
             // use a short timeout
             dwTimeoutMilliseconds = LWNET_CLDAP_SHORT_POLL_TIMEOUT_MILLISECONDS;
+            bShortPoll = TRUE;
         }
         else
         {
+            bShortPoll = FALSE;
+
             if (pConnections[0].StartTime +
                 dwSingleConnTimeoutMilliseconds > CurrentTime)
             {
-                // Use the remaining time for the oldest connection
+                // Use the remaining time for the oldest connection,
+                // but do not wait past the overall stop time
                 dwTimeoutMilliseconds = pConnections[0].StartTime +
                                         dwSingleConnTimeoutMilliseconds -
                                         CurrentTime;
-                dwTimeoutMilliseconds = CT_MIN(dwSingleConnTimeoutMilliseconds, StopTime - CurrentTime);
+                dwTimeoutMilliseconds = CT_MIN(dwTimeoutMilliseconds, StopTime - CurrentTime);
             }
             else
             {
@@ -688,6 +695,13 @@ LWNetSrvPingCLdapArray(
                                 dwActualConnCount,
                                 pConnections,
                                 Readfds);
+
+        if (bShortPoll)
+        {
+            // Nothing usable came back from the servers started so
+            // far, so they are slow or down.  Start more at once.
+            dwIncrementalConnCount = CT_MIN(dwIncrementalConnCount * 2, dwMaxConnCount);
+        }
     }
 
 error:
@@ -775,19 +789,201 @@ LWNetSrvGetDCNameDiscoverInternal(
     IN DWORD dwBlackListCount,
     IN OPTIONAL PSTR* ppszAddressBlackList,
     IN PLWNET_DC_LIST_QUERY_METHOD pfnDCListQuery,
+    IN OPTIONAL PLWNET_DC_LIST_PREFETCH pPrefetch,
     OUT PLWNET_DC_INFO* ppDcInfo,
     OUT OPTIONAL PDNS_SERVER_INFO* ppServerArray,
     OUT OPTIONAL PDWORD pdwServerCount,
     OUT PBOOLEAN bFailedFindWritable
     );
+
+static
+VOID
+LWNetSrvReleaseDCListPrefetch(
+    IN OUT PLWNET_DC_LIST_PREFETCH pPrefetch
+    )
+{
+    if (LwInterlockedDecrement(&pPrefetch->RefCount) == 0)
+    {
+        LWNET_SAFE_FREE_STRING(pPrefetch->pszDnsDomainName);
+        LWNET_SAFE_FREE_STRING(pPrefetch->pszSiteName);
+        LWNET_SAFE_FREE_MEMORY(pPrefetch->pServerArray);
+        LWNetFreeMemory(pPrefetch);
+    }
+}
+
+static
+PVOID
+LWNetSrvDCListPrefetchThread(
+    PVOID pContext
+    )
+{
+    PLWNET_DC_LIST_PREFETCH pPrefetch = (PLWNET_DC_LIST_PREFETCH) pContext;
+
+    pPrefetch->dwError = LWNetDnsSrvQuery(
+                             pPrefetch->pszDnsDomainName,
+                             pPrefetch->pszSiteName,
+                             pPrefetch->dwDsFlags,
+                             &pPrefetch->pServerArray,
+                             &pPrefetch->dwServerCount);
+
+    LWNetSrvReleaseDCListPrefetch(pPrefetch);
+
+    return NULL;
+}
+
+//
+// Drop the requester's reference.  A lookup which is still running is
+// left to finish on its own; the thread frees the prefetch when done.
+//
+static
+VOID
+LWNetSrvFreeDCListPrefetch(
+    IN OUT PLWNET_DC_LIST_PREFETCH pPrefetch
+    )
+{
+    if (pPrefetch)
+    {
+        if (pPrefetch->bThreadStarted)
+        {
+            pthread_detach(pPrefetch->Thread);
+            pPrefetch->bThreadStarted = FALSE;
+        }
+        LWNetSrvReleaseDCListPrefetch(pPrefetch);
+    }
+}
+
+//
+// Start looking up the DC list of the client site reported by the
+// last discovery of this domain, if there is one in the cache.  The
+// site rarely changes, so by the time the CLDAP response names it the
+// list is usually already there.  No prefetch is not an error.
+//
+static
 DWORD
-LWNetSrvGetDCNameDiscover(
+LWNetSrvStartDCListPrefetch(
+    IN PCSTR pszDnsDomainName,
+    IN DWORD dwDsFlags,
+    OUT PLWNET_DC_LIST_PREFETCH* ppPrefetch
+    )
+{
+    DWORD dwError = 0;
+    PLWNET_DC_LIST_PREFETCH pPrefetch = NULL;
+    PLWNET_DC_INFO pCachedDcInfo = NULL;
+    LWNET_UNIX_TIME_T lastDiscovered = 0;
+    LWNET_UNIX_TIME_T lastPinged = 0;
+    BOOLEAN isBackoffToWritableDc = FALSE;
+    LWNET_UNIX_TIME_T lastBackoffToWritableDc = 0;
+
+    dwError = LWNetCacheQuery(pszDnsDomainName, NULL, dwDsFlags,
+                              &pCachedDcInfo, &lastDiscovered, &lastPinged,
+                              &isBackoffToWritableDc,
+                              &lastBackoffToWritableDc);
+    BAIL_ON_LWNET_ERROR(dwError);
+
+    if (!pCachedDcInfo ||
+        IsNullOrEmptyString(pCachedDcInfo->pszClientSiteName))
+    {
+        goto error;
+    }
+
+    dwError = LWNetAllocateMemory(sizeof(*pPrefetch), OUT_PPVOID(&pPrefetch));
+    BAIL_ON_LWNET_ERROR(dwError);
+
+    pPrefetch->RefCount = 1;
+
+    dwError = LWNetAllocateString(pszDnsDomainName,
+                                  &pPrefetch->pszDnsDomainName);
+    BAIL_ON_LWNET_ERROR(dwError);
+
+    dwError = LWNetAllocateString(pCachedDcInfo->pszClientSiteName,
+                                  &pPrefetch->pszSiteName);
+    BAIL_ON_LWNET_ERROR(dwError);
+
+    pPrefetch->dwDsFlags = dwDsFlags;
+
+    // The thread's reference
+    pPrefetch->RefCount++;
+
+    dwError = LwErrnoToWin32Error(pthread_create(&pPrefetch->Thread,
+                                                 NULL,
+                                                 LWNetSrvDCListPrefetchThread,
+                                                 pPrefetch));
+    if (dwError)
+    {
+        pPrefetch->RefCount--;
+    }
+    BAIL_ON_LWNET_ERROR(dwError);
+
+    pPrefetch->bThreadStarted = TRUE;
+
+error:
+    LWNET_SAFE_FREE_DC_INFO(pCachedDcInfo);
+
+    if (dwError || (pPrefetch && !pPrefetch->bThreadStarted))
+    {
+        LWNetSrvFreeDCListPrefetch(pPrefetch);
+        pPrefetch = NULL;
+    }
+
+    *ppPrefetch = pPrefetch;
+
+    return dwError;
+}
+
+//
+// Hand over the prefetched DC list if it is for pszSiteName and the
+// lookup succeeded.  Otherwise the caller should query for itself.
+//
+static
+BOOLEAN
+LWNetSrvTakeDCListPrefetch(
+    IN OPTIONAL PLWNET_DC_LIST_PREFETCH pPrefetch,
+    IN OPTIONAL PCSTR pszSiteName,
+    OUT PDNS_SERVER_INFO* ppServerArray,
+    OUT PDWORD pdwServerCount
+    )
+{
+    if (!pPrefetch ||
+        IsNullOrEmptyString(pszSiteName) ||
+        strcasecmp(pPrefetch->pszSiteName, pszSiteName))
+    {
+        return FALSE;
+    }
+
+    if (pPrefetch->bThreadStarted)
+    {
+        pthread_join(pPrefetch->Thread, NULL);
+        pPrefetch->bThreadStarted = FALSE;
+    }
+
+    if (pPrefetch->dwError || !pPrefetch->pServerArray)
+    {
+        return FALSE;
+    }
+
+    LWNET_LOG_VERBOSE("Using prefetched DC list for site '%s' of domain '%s'",
+                      pPrefetch->pszSiteName,
+                      pPrefetch->pszDnsDomainName);
+
+    *ppServerArray = pPrefetch->pServerArray;
+    *pdwServerCount = pPrefetch->dwServerCount;
+
+    pPrefetch->pServerArray = NULL;
+    pPrefetch->dwServerCount = 0;
+
+    return TRUE;
+}
+
+static
+DWORD
+LWNetSrvGetDCNameDiscoverWithPrefetch(
     IN PCSTR pszDnsDomainName,
     IN OPTIONAL PCSTR pszSiteName,
     IN OPTIONAL PCSTR pszPrimaryDomain,
     IN DWORD dwDsFlags,
     IN DWORD dwBlackListCount,
     IN OPTIONAL PSTR* ppszAddressBlackList,
+    IN OPTIONAL PLWNET_DC_LIST_PREFETCH pPrefetch,
     OUT PLWNET_DC_INFO* ppDcInfo,
     OUT OPTIONAL PDNS_SERVER_INFO* ppServerArray,
     OUT OPTIONAL PDWORD pdwServerCount,
@@ -806,6 +1002,7 @@ LWNetSrvGetDCNameDiscover(
                   dwBlackListCount,
                   ppszAddressBlackList,
                   LWNetGetPreferredDcList,
+                  NULL,
                   ppDcInfo,
                   ppServerArray,
                   pdwServerCount,
@@ -825,6 +1022,7 @@ LWNetSrvGetDCNameDiscover(
                   dwBlackListCount,
                   ppszAddressBlackList,
                   LWNetDnsSrvQuery,
+                  pPrefetch,
                   ppDcInfo,
                   ppServerArray,
                   pdwServerCount,
@@ -840,6 +1038,34 @@ error:
     goto cleanup;
 }
 
+DWORD
+LWNetSrvGetDCNameDiscover(
+    IN PCSTR pszDnsDomainName,
+    IN OPTIONAL PCSTR pszSiteName,
+    IN OPTIONAL PCSTR pszPrimaryDomain,
+    IN DWORD dwDsFlags,
+    IN DWORD dwBlackListCount,
+    IN OPTIONAL PSTR* ppszAddressBlackList,
+    OUT PLWNET_DC_INFO* ppDcInfo,
+    OUT OPTIONAL PDNS_SERVER_INFO* ppServerArray,
+    OUT OPTIONAL PDWORD pdwServerCount,
+    OUT PBOOLEAN pbFailedFindWritable
+    )
+{
+    return LWNetSrvGetDCNameDiscoverWithPrefetch(
+               pszDnsDomainName,
+               pszSiteName,
+               pszPrimaryDomain,
+               dwDsFlags,
+               dwBlackListCount,
+               ppszAddressBlackList,
+               NULL,
+               ppDcInfo,
+               ppServerArray,
+               pdwServerCount,
+               pbFailedFindWritable);
+}
+
 static
 DWORD
 LWNetSrvGetDCNameDiscoverInternal(
@@ -850,6 +1076,7 @@ LWNetSrvGetDCNameDiscoverInternal(
     IN DWORD dwBlackListCount,
     IN OPTIONAL PSTR* ppszAddressBlackList,
     IN PLWNET_DC_LIST_QUERY_METHOD pfnDCListQuery,
+    IN OPTIONAL PLWNET_DC_LIST_PREFETCH pPrefetch,
     OUT PLWNET_DC_INFO* ppDcInfo,
     OUT OPTIONAL PDNS_SERVER_INFO* ppServerArray,
     OUT OPTIONAL PDWORD pdwServerCount,
@@ -861,8 +1088,11 @@ LWNetSrvGetDCNameDiscoverInternal(
 //    - DNS query for desired site & required DC type (pdc, kdc, gc).
 //      - note that if no site is specified, use "un-sited" lookup.
 //    - If no site specified:
+//      - meanwhile, DNS query for the client site cached by the last
+//        discovery, on a separate thread
 //      - CLDAP to one DC to get actual site
 //      - use new site info that to do DNS query for updated DC list
+//        (or take the prefetched list if it is for that site)
 //    - CLDAP to DCs in parallel to find the first responder
 //      (meeting any additional criteria -- writable, etc)
 //
@@ -877,14 +1107,35 @@ LWNetSrvGetDCNameDiscoverInternal(
     PDNS_SERVER_INFO pSiteServerArray = NULL;
     DWORD dwSiteServerCount = 0;
     BOOLEAN bFailedFindWritable = FALSE;
+    PLWNET_DC_LIST_PREFETCH pSitePrefetch = NULL;
+
+    if (IsNullOrEmptyString(pszSiteName) &&
+        pfnDCListQuery == LWNetDnsSrvQuery)
+    {
+        dwError = LWNetSrvStartDCListPrefetch(pszDnsDomainName,
+                                              dwDsFlags,
+                                              &pSitePrefetch);
+        if (dwError)
+        {
+            LWNET_LOG_DEBUG("Failed to prefetch site DC list for domain '%s' (error = %u)",
+                            pszDnsDomainName, dwError);
+            dwError = 0;
+        }
+    }
 
     // Get server list
-    dwError = pfnDCListQuery(pszDnsDomainName,
-                             pszSiteName,
-                             dwDsFlags,
-                             &pServerArray,
-                             &dwServerCount);
-    BAIL_ON_LWNET_ERROR(dwError);
+    if (!LWNetSrvTakeDCListPrefetch(pPrefetch,
+                                    pszSiteName,
+                                    &pServerArray,
+                                    &dwServerCount))
+    {
+        dwError = pfnDCListQuery(pszDnsDomainName,
+                                 pszSiteName,
+                                 dwDsFlags,
+                                 &pServerArray,
+                                 &dwServerCount);
+        BAIL_ON_LWNET_ERROR(dwError);
+    }
 
     LWNetFilterFromBlackList(
         dwBlackListCount,
@@ -963,12 +1214,22 @@ LWNetSrvGetDCNameDiscoverInternal(
             !pszSiteName &&
             pDcInfo->pszClientSiteName)
         {
-            dwError = pfnDCListQuery(
-                          pszDnsDomainName,
-                          pDcInfo->pszClientSiteName,
-                          dwDsFlags,
-                          &pSiteServerArray,
-                          &dwSiteServerCount);
+            if (LWNetSrvTakeDCListPrefetch(pSitePrefetch,
+                                           pDcInfo->pszClientSiteName,
+                                           &pSiteServerArray,
+                                           &dwSiteServerCount))
+            {
+                dwError = 0;
+            }
+            else
+            {
+                dwError = pfnDCListQuery(
+                              pszDnsDomainName,
+                              pDcInfo->pszClientSiteName,
+                              dwDsFlags,
+                              &pSiteServerArray,
+                              &dwSiteServerCount);
+            }
             if (dwError == 0)
             {
                 // Use the site-specific DC.
@@ -988,15 +1249,17 @@ LWNetSrvGetDCNameDiscoverInternal(
     }
 
     // Now we need to use the client site to find a site-specific DC.
-    dwError = LWNetSrvGetDCNameDiscover(pszDnsDomainName,
-                                        pDcInfo->pszClientSiteName,
-                                        pszPrimaryDomain,
-                                        dwDsFlags,
-                                        dwBlackListCount,
-                                        ppszAddressBlackList,
-                                        &pSiteDcInfo,
-                                        &pSiteServerArray, &dwSiteServerCount,
-                                        &bFailedFindWritable);
+    dwError = LWNetSrvGetDCNameDiscoverWithPrefetch(
+                  pszDnsDomainName,
+                  pDcInfo->pszClientSiteName,
+                  pszPrimaryDomain,
+                  dwDsFlags,
+                  dwBlackListCount,
+                  ppszAddressBlackList,
+                  pSitePrefetch,
+                  &pSiteDcInfo,
+                  &pSiteServerArray, &dwSiteServerCount,
+                  &bFailedFindWritable);
     if (NERR_DCNotFound == dwError)
     {
         if (bFailedFindWritable)
@@ -1029,6 +1292,7 @@ cleanup:
     LWNET_SAFE_FREE_DC_INFO(pSiteDcInfo);
     LWNET_SAFE_FREE_MEMORY(pSiteServerArray);
     LWNET_SAFE_FREE_MEMORY(pServersInPrimaryDomain);
+    LWNetSrvFreeDCListPrefetch(pSitePrefetch);
     dwSiteServerCount = 0;
 
     if (dwError)
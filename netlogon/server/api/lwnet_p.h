@@ -66,7 +66,9 @@ typedef struct _PACKED_ARRAY
 // short poll timeout controls how long to wait between
 // batches.  This prevents the entire set of connections
 // from being started in cases where there is a fast
-// response.
+// response.  Each batch that gets no response within
+// the short poll doubles the size of the next one, so
+// a list full of unreachable servers is covered quickly.
 #define LWNET_CLDAP_SHORT_POLL_TIMEOUT_MILLISECONDS 100
 #define LWNET_CLDAP_MINIMUM_INCREMENTAL_CONNECTIONS 20
 
@@ -87,6 +89,22 @@ typedef struct _LWNET_CLDAP_CONNECTION_CONTEXT {
     PDNS_SERVER_INFO pServerInfo;
 } LWNET_CLDAP_CONNECTION_CONTEXT, *PLWNET_CLDAP_CONNECTION_CONTEXT;
 
+// DNS SRV lookup of a site's DC list run on a worker thread
+// while the domain-wide DCs are being pinged.  The requester and the
+// thread each hold a reference, so a requester with no use for the
+// result can let go without waiting for the lookup.
+typedef struct _LWNET_DC_LIST_PREFETCH {
+    LONG RefCount;
+    pthread_t Thread;
+    BOOLEAN bThreadStarted;
+    PSTR pszDnsDomainName;
+    PSTR pszSiteName;
+    DWORD dwDsFlags;
+    DWORD dwError;
+    PDNS_SERVER_INFO pServerArray;
+    DWORD dwServerCount;
+} LWNET_DC_LIST_PREFETCH, *PLWNET_DC_LIST_PREFETCH;
+
 BOOLEAN
 LWNetSrvIsMatchingDcInfo(
     IN PLWNET_DC_INFO pDcInfo,
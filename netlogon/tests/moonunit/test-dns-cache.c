@@ -0,0 +1,385 @@
+/*
+ * Exercises the netlogon SRV answer cache against a stub DNS server on
+ * the loopback: concurrent lookups of one question coalescing into a
+ * single query, answers expiring with their TTL, and NXDOMAIN and empty
+ * answers being cached as negative answers.
+ */
+
+#include "includes.h"
+#include <moonunit/moonunit.h>
+
+#define THREADS 8
+
+typedef enum _STUB_MODE {
+    STUB_MODE_SRV,
+    STUB_MODE_NXDOMAIN,
+    STUB_MODE_EMPTY
+} STUB_MODE;
+
+typedef struct _STUB_ZONE {
+    PCSTR pszQuestion;
+    STUB_MODE Mode;
+    DWORD dwTTL;
+    DWORD dwDelayMs;
+    DWORD dwQueries;
+} STUB_ZONE, *PSTUB_ZONE;
+
+static STUB_ZONE gZones[] = {
+    { "_ldap._tcp.ttl.test",      STUB_MODE_SRV,      2,  0,   0 },
+    { "_ldap._tcp.coalesce.test", STUB_MODE_SRV,      60, 500, 0 },
+    { "_ldap._tcp.missing.test",  STUB_MODE_NXDOMAIN, 0,  0,   0 },
+    { "_ldap._tcp.empty.test",    STUB_MODE_EMPTY,    0,  0,   0 },
+};
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static int gStubSocket = -1;
+static DWORD gdwFailures = 0;
+
+static PSTUB_ZONE
+find_zone(PCSTR pszQuestion)
+{
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(gZones) / sizeof(gZones[0]); i++)
+    {
+        if (!strcasecmp(gZones[i].pszQuestion, pszQuestion))
+        {
+            return &gZones[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Lookup threads count failures for the test to assert on */
+static VOID
+record_failure(VOID)
+{
+    pthread_mutex_lock(&gLock);
+    gdwFailures++;
+    pthread_mutex_unlock(&gLock);
+}
+
+static DWORD
+query_count(PCSTR pszQuestion)
+{
+    DWORD dwQueries = 0;
+
+    pthread_mutex_lock(&gLock);
+    dwQueries = find_zone(pszQuestion)->dwQueries;
+    pthread_mutex_unlock(&gLock);
+
+    return dwQueries;
+}
+
+static size_t
+put_word(PBYTE pBuffer, size_t offset, WORD wValue)
+{
+    pBuffer[offset] = (BYTE) (wValue >> 8);
+    pBuffer[offset + 1] = (BYTE) wValue;
+    return offset + 2;
+}
+
+static size_t
+put_dword(PBYTE pBuffer, size_t offset, DWORD dwValue)
+{
+    offset = put_word(pBuffer, offset, (WORD) (dwValue >> 16));
+    return put_word(pBuffer, offset, (WORD) dwValue);
+}
+
+/* Answers one query; the response echoes the question section. */
+static size_t
+build_response(PBYTE pQuery, size_t querySize, PBYTE pResponse)
+{
+    CHAR szName[256] = { 0 };
+    size_t nameLength = 0;
+    size_t offset = 12;
+    size_t questionEnd = 0;
+    size_t rdataOffset = 0;
+    size_t targetOffset = 0;
+    PSTUB_ZONE pZone = NULL;
+    STUB_MODE mode = STUB_MODE_NXDOMAIN;
+    DWORD dwDelayMs = 0;
+    DWORD dwTTL = 0;
+
+    while (offset < querySize && pQuery[offset])
+    {
+        BYTE labelLength = pQuery[offset++];
+
+        if (nameLength)
+        {
+            szName[nameLength++] = '.';
+        }
+        memcpy(szName + nameLength, pQuery + offset, labelLength);
+        nameLength += labelLength;
+        offset += labelLength;
+    }
+    questionEnd = offset + 1 + 4;
+
+    pthread_mutex_lock(&gLock);
+    pZone = find_zone(szName);
+    if (pZone)
+    {
+        pZone->dwQueries++;
+        mode = pZone->Mode;
+        dwDelayMs = pZone->dwDelayMs;
+        dwTTL = pZone->dwTTL;
+    }
+    pthread_mutex_unlock(&gLock);
+
+    if (dwDelayMs)
+    {
+        usleep(dwDelayMs * 1000);
+    }
+
+    memcpy(pResponse, pQuery, questionEnd);
+    // QR, opcode 0, AA, RD copied, RA, rcode
+    pResponse[2] = 0x84 | (pQuery[2] & 0x01);
+    pResponse[3] = 0x80 | (mode == STUB_MODE_NXDOMAIN ? 3 : 0);
+    put_word(pResponse, 6, mode == STUB_MODE_SRV ? 1 : 0);
+    put_word(pResponse, 8, 0);
+    put_word(pResponse, 10, mode == STUB_MODE_SRV ? 1 : 0);
+
+    offset = questionEnd;
+    if (mode != STUB_MODE_SRV)
+    {
+        return offset;
+    }
+
+    // SRV answer pointing back at the question name
+    offset = put_word(pResponse, offset, 0xC00C);
+    offset = put_word(pResponse, offset, ns_t_srv);
+    offset = put_word(pResponse, offset, ns_c_in);
+    offset = put_dword(pResponse, offset, dwTTL);
+    rdataOffset = offset;
+    offset = put_word(pResponse, offset, 0);
+    offset = put_word(pResponse, offset, 0);
+    offset = put_word(pResponse, offset, 100);
+    offset = put_word(pResponse, offset, 389);
+    targetOffset = offset;
+    memcpy(pResponse + offset, "\003dc1\004test\000", 10);
+    offset += 10;
+    put_word(pResponse, rdataOffset, (WORD) (offset - rdataOffset - 2));
+
+    // Glue so the target does not need resolving
+    offset = put_word(pResponse, offset, 0xC000 | (WORD) targetOffset);
+    offset = put_word(pResponse, offset, ns_t_a);
+    offset = put_word(pResponse, offset, ns_c_in);
+    offset = put_dword(pResponse, offset, dwTTL);
+    offset = put_word(pResponse, offset, 4);
+    inet_pton(AF_INET, "192.0.2.10", pResponse + offset);
+    offset += 4;
+
+    return offset;
+}
+
+typedef struct _STUB_REQUEST {
+    BYTE Query[512];
+    size_t QuerySize;
+    struct sockaddr_in Peer;
+} STUB_REQUEST, *PSTUB_REQUEST;
+
+static PVOID
+stub_answer(PVOID pContext)
+{
+    PSTUB_REQUEST pRequest = pContext;
+    BYTE response[512] = { 0 };
+    size_t responseSize = 0;
+
+    responseSize = build_response(pRequest->Query, pRequest->QuerySize, response);
+
+    sendto(gStubSocket, response, responseSize, 0,
+           (struct sockaddr*) &pRequest->Peer, sizeof(pRequest->Peer));
+
+    free(pRequest);
+
+    return NULL;
+}
+
+/* Hands every query to its own thread so a delayed answer does not
+   hold up the others. */
+static PVOID
+stub_server(PVOID pUnused)
+{
+    for (;;)
+    {
+        PSTUB_REQUEST pRequest = calloc(1, sizeof(*pRequest));
+        socklen_t peerLength = sizeof(pRequest->Peer);
+        ssize_t received = 0;
+        pthread_t thread;
+
+        if (!pRequest)
+        {
+            break;
+        }
+
+        received = recvfrom(gStubSocket, pRequest->Query, sizeof(pRequest->Query), 0,
+                            (struct sockaddr*) &pRequest->Peer, &peerLength);
+        if (received < 12)
+        {
+            free(pRequest);
+            continue;
+        }
+        pRequest->QuerySize = received;
+
+        if (pthread_create(&thread, NULL, stub_answer, pRequest))
+        {
+            free(pRequest);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    return NULL;
+}
+
+static USHORT
+start_stub_server(void)
+{
+    struct sockaddr_in address = { 0 };
+    socklen_t addressLength = sizeof(address);
+    pthread_t thread;
+
+    gStubSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    MU_ASSERT(gStubSocket >= 0);
+
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    MU_ASSERT_EQUAL(
+        MU_TYPE_INTEGER,
+        bind(gStubSocket, (struct sockaddr*) &address, sizeof(address)),
+        0);
+    MU_ASSERT_EQUAL(
+        MU_TYPE_INTEGER,
+        getsockname(gStubSocket, (struct sockaddr*) &address, &addressLength),
+        0);
+
+    MU_ASSERT_EQUAL(
+        MU_TYPE_INTEGER,
+        pthread_create(&thread, NULL, stub_server, NULL),
+        0);
+    pthread_detach(thread);
+
+    return ntohs(address.sin_port);
+}
+
+static DWORD
+lookup(PCSTR pszQuestion, DWORD dwDsFlags)
+{
+    DWORD dwError = 0;
+    PDNS_SERVER_INFO pServerArray = NULL;
+    DWORD dwServerCount = 0;
+
+    dwError = LWNetDnsSrvQueryByQuestion(
+                  pszQuestion,
+                  NULL,
+                  dwDsFlags,
+                  &pServerArray,
+                  &dwServerCount);
+    if (!dwError)
+    {
+        if (dwServerCount != 1 ||
+            strcmp(pServerArray[0].pszName, "dc1.test") ||
+            strcmp(pServerArray[0].pszAddress, "192.0.2.10"))
+        {
+            record_failure();
+        }
+    }
+
+    LWNET_SAFE_FREE_MEMORY(pServerArray);
+
+    return dwError;
+}
+
+static PVOID
+coalesce_thread(PVOID pUnused)
+{
+    if (lookup("_ldap._tcp.coalesce.test", 0))
+    {
+        record_failure();
+    }
+
+    return NULL;
+}
+
+MU_FIXTURE_SETUP(DnsCache)
+{
+#if HAVE_DECL_RES_NINIT
+    gdwFailures = 0;
+
+    MU_ASSERT_EQUAL(
+        MU_TYPE_INTEGER,
+        LWNetDnsSetNameServer("127.0.0.1", start_stub_server()),
+        0);
+#else
+    MU_SKIP("Needs res_ninit to point the resolver at the stub server");
+#endif
+}
+
+MU_FIXTURE_TEARDOWN(DnsCache)
+{
+    LWNetDnsSetNameServer(NULL, 0);
+}
+
+MU_TEST(DnsCache, Coalesce)
+{
+    pthread_t threads[THREADS];
+    int i = 0;
+
+    for (i = 0; i < THREADS; i++)
+    {
+        MU_ASSERT_EQUAL(
+            MU_TYPE_INTEGER,
+            pthread_create(&threads[i], NULL, coalesce_thread, NULL),
+            0);
+    }
+
+    for (i = 0; i < THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, gdwFailures, 0);
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, query_count("_ldap._tcp.coalesce.test"), 1);
+}
+
+MU_TEST(DnsCache, Ttl)
+{
+    PCSTR pszQuestion = "_ldap._tcp.ttl.test";
+
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, lookup(pszQuestion, 0), 0);
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, lookup(pszQuestion, 0), 0);
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, query_count(pszQuestion), 1);
+
+    sleep(3);
+
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, lookup(pszQuestion, 0), 0);
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, query_count(pszQuestion), 2);
+
+    // Forced rediscovery always goes to the server
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, lookup(pszQuestion, DS_FORCE_REDISCOVERY), 0);
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, query_count(pszQuestion), 3);
+
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, gdwFailures, 0);
+}
+
+static void
+check_negative(PCSTR pszQuestion)
+{
+    MU_ASSERT(lookup(pszQuestion, 0) != 0);
+    MU_ASSERT(lookup(pszQuestion, 0) != 0);
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, query_count(pszQuestion), 1);
+
+    MU_ASSERT(lookup(pszQuestion, DS_FORCE_REDISCOVERY) != 0);
+    MU_ASSERT_EQUAL(MU_TYPE_INTEGER, query_count(pszQuestion), 2);
+}
+
+MU_TEST(DnsCache, NxDomain)
+{
+    check_negative("_ldap._tcp.missing.test");
+}
+
+MU_TEST(DnsCache, EmptyAnswer)
+{
+    check_negative("_ldap._tcp.empty.test");
+}
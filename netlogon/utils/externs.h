@@ -50,5 +50,12 @@
 
 extern LOGINFO gLwnetLogInfo;
 
+extern pthread_mutex_t gLwnetDnsCacheLock;
+extern pthread_cond_t gLwnetDnsCacheCondition;
+extern PLWNET_DNS_CACHE_ENTRY gpLwnetDnsCache;
+extern DWORD gdwLwnetDnsCacheCount;
+extern BOOLEAN gbLwnetDnsNameServerSet;
+extern struct sockaddr_in gLwnetDnsNameServer;
+
 #endif /* __EXTERNS_H__ */
 
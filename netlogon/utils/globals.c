@@ -60,3 +60,11 @@ LOGINFO gLwnetLogInfo =
 
 pthread_mutex_t gLwnetResolverLock = PTHREAD_MUTEX_INITIALIZER;
 
+pthread_mutex_t gLwnetDnsCacheLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t gLwnetDnsCacheCondition = PTHREAD_COND_INITIALIZER;
+PLWNET_DNS_CACHE_ENTRY gpLwnetDnsCache = NULL;
+DWORD gdwLwnetDnsCacheCount = 0;
+// Set only by the LWNetDnsSetNameServer test hook
+BOOLEAN gbLwnetDnsNameServerSet = FALSE;
+struct sockaddr_in gLwnetDnsNameServer;
+
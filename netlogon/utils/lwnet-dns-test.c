@@ -0,0 +1,48 @@
+/* Editor Settings: expandtabs and use 4 spaces for indentation
+ * ex: set softtabstop=4 tabstop=8 expandtab shiftwidth=4: *
+ * -*- mode: c, c-basic-offset: 4 -*- */
+
+/*
+ * Copyright (C) Likewise Software. All rights reserved.
+ *
+ * Module Name:
+ *
+ *        lwnet-dns-test.c
+ *
+ * Abstract:
+ *
+ *        Likewise Site Manager
+ *
+ *        DNS test hooks, linked into tests only
+ *
+ */
+#include "includes.h"
+
+DWORD
+LWNetDnsSetNameServer(
+    IN OPTIONAL PCSTR pszAddress,
+    IN USHORT usPort
+    )
+{
+    DWORD dwError = 0;
+    struct sockaddr_in address = { 0 };
+
+    if (pszAddress)
+    {
+        address.sin_family = AF_INET;
+        address.sin_port = htons(usPort);
+        if (inet_pton(AF_INET, pszAddress, &address.sin_addr) != 1)
+        {
+            dwError = ERROR_INVALID_PARAMETER;
+            BAIL_ON_LWNET_ERROR(dwError);
+        }
+    }
+
+    pthread_mutex_lock(&gLwnetDnsCacheLock);
+    gLwnetDnsNameServer = address;
+    gbLwnetDnsNameServerSet = pszAddress ? TRUE : FALSE;
+    pthread_mutex_unlock(&gLwnetDnsCacheLock);
+
+error:
+    return dwError;
+}
@@ -82,6 +82,7 @@ LWNetDnsGetHostInfoEx(
     PSTR pszHostname = NULL;
     PSTR pszDomain = NULL;
     PSTR pszFqdn = NULL;
+    BOOLEAN bInLock = FALSE;
 
     if (!ppszHostname && !ppszFqdn && !ppszDomain)
     {
@@ -116,6 +117,11 @@ LWNetDnsGetHostInfoEx(
         goto error;
     }
 
+    // gethostbyname returns static storage and, without res_ninit,
+    // shares the global resolver state, so hold the resolver lock
+    // until everything needed from it has been copied.
+    LWNET_LOCK_RESOLVER_API(bInLock);
+
     host = gethostbyname(szBuffer);
     if ( !host )
     {
@@ -192,6 +198,8 @@ LWNetDnsGetHostInfoEx(
     }
 
 error:
+    LWNET_UNLOCK_RESOLVER_API(bInLock);
+
     if (dwError)
     {
         LWNET_SAFE_FREE_STRING(pszHostname);
@@ -1282,6 +1290,67 @@ error:
     return dwError;
 }
 
+DWORD
+LWNetDnsCopyServerArray(
+    IN PDNS_SERVER_INFO pServerArray,
+    IN DWORD dwServerCount,
+    OUT PDNS_SERVER_INFO* ppServerArray
+    )
+// Copies an array built by LWNetDnsBuildServerArray into a single
+// allocation of the same layout.  Call LWNET_SAFE_FREE_MEMORY on it.
+{
+    DWORD dwError = 0;
+    PDNS_SERVER_INFO pCopy = NULL;
+    DWORD dwRequiredSize = dwServerCount * sizeof(DNS_SERVER_INFO);
+    PSTR pStringLocation = NULL;
+    size_t len = 0;
+    DWORD i = 0;
+
+    for (i = 0; i < dwServerCount; i++)
+    {
+        // Consecutive entries for one host share its name string
+        if (i == 0 || pServerArray[i].pszName != pServerArray[i - 1].pszName)
+        {
+            dwRequiredSize += strlen(pServerArray[i].pszName) + 1;
+        }
+        dwRequiredSize += strlen(pServerArray[i].pszAddress) + 1;
+    }
+
+    dwError = LWNetAllocateMemory(dwRequiredSize, (PVOID*)&pCopy);
+    BAIL_ON_LWNET_ERROR(dwError);
+
+    pStringLocation = CT_PTR_ADD(pCopy, dwServerCount * sizeof(DNS_SERVER_INFO));
+    for (i = 0; i < dwServerCount; i++)
+    {
+        if (i == 0 || pServerArray[i].pszName != pServerArray[i - 1].pszName)
+        {
+            len = strlen(pServerArray[i].pszName) + 1;
+            memcpy(pStringLocation, pServerArray[i].pszName, len);
+            pCopy[i].pszName = pStringLocation;
+            pStringLocation += len;
+        }
+        else
+        {
+            pCopy[i].pszName = pCopy[i - 1].pszName;
+        }
+
+        len = strlen(pServerArray[i].pszAddress) + 1;
+        memcpy(pStringLocation, pServerArray[i].pszAddress, len);
+        pCopy[i].pszAddress = pStringLocation;
+        pStringLocation += len;
+    }
+
+error:
+    if (dwError)
+    {
+        LWNET_SAFE_FREE_MEMORY(pCopy);
+    }
+
+    *ppServerArray = pCopy;
+
+    return dwError;
+}
+
 VOID
 LWNetDnsFreeSRVInfoRecordInList(
     IN OUT PVOID pRecord,
@@ -1356,7 +1425,14 @@ LWNetDnsQueryWithBuffer(
     struct __res_state *res = &_res;
 #endif
 
+#if !HAVE_DECL_RES_NINIT
+    // Only the global resolver state needs serializing; with
+    // res_ninit each lookup has its own, so a slow DNS server
+    // does not hold up lookups on other threads.  The only other
+    // user of shared resolver state in this file,
+    // LWNetDnsGetHostInfoEx, takes the lock on every platform.
     LWNET_LOCK_RESOLVER_API(bInLock);
+#endif
 
 #if HAVE_DECL_RES_NINIT
     if (res_ninit(res) != 0)
@@ -1368,6 +1444,16 @@ LWNetDnsQueryWithBuffer(
         BAIL_ON_LWNET_ERROR(dwError);
     }
 
+#if HAVE_DECL_RES_NINIT
+    pthread_mutex_lock(&gLwnetDnsCacheLock);
+    if (gbLwnetDnsNameServerSet)
+    {
+        res->nsaddr_list[0] = gLwnetDnsNameServer;
+        res->nscount = 1;
+    }
+    pthread_mutex_unlock(&gLwnetDnsCacheLock);
+#endif
+
     if (dwBufferSize < CT_MIN(sizeof(DNS_RESPONSE_HEADER), MAX_DNS_UDP_BUFFER))
     {
         dwError = ERROR_INVALID_PARAMETER;
@@ -1563,13 +1649,13 @@ error:
     goto cleanup;
 }
 
+static
 DWORD
-LWNetDnsSrvQueryByQuestion(
+LWNetDnsSrvQueryByQuestionUncached(
     IN PCSTR pszQuestion,
-    IN OPTIONAL PCSTR pszSiteName,
-    IN DWORD dwDsFlags,
     OUT PDNS_SERVER_INFO* ppServerArray,
-    OUT PDWORD pdwServerCount
+    OUT PDWORD pdwServerCount,
+    OUT PDWORD pdwTTL
     )
 // Call LWNET_SAFE_FREE_MEMORY on returned server array
 {
@@ -1581,16 +1667,11 @@ LWNetDnsSrvQueryByQuestion(
     PDLINKEDLIST pAnswersList = NULL;
     PDLINKEDLIST pAdditionalsList = NULL;
     PDLINKEDLIST pSRVRecordList = NULL;
+    PDLINKEDLIST pListMember = NULL;
     PDNS_SERVER_INFO pServerArray = NULL;
     DWORD dwServerCount = 0;
-
-    if (IsNullOrEmptyString(pszQuestion) ||
-        !ppServerArray ||
-        !pdwServerCount)
-    {
-        dwError = ERROR_INVALID_PARAMETER;
-        BAIL_ON_LWNET_ERROR(dwError);
-    }
+    DWORD dwTTL = 0;
+    BOOLEAN bHaveTTL = FALSE;
 
     dwError = LWNetAllocateMemory(dwBufferSize, &pBuffer);
     BAIL_ON_LWNET_ERROR(dwError);
@@ -1630,12 +1711,277 @@ LWNetDnsSrvQueryByQuestion(
                                        &pServerArray, &dwServerCount);
     BAIL_ON_LWNET_ERROR(dwError);
 
+    for (pListMember = pAnswersList; pListMember; pListMember = pListMember->pNext)
+    {
+        PDNS_RECORD pRecord = (PDNS_RECORD)pListMember->pItem;
+
+        if (!bHaveTTL || pRecord->dwTTL < dwTTL)
+        {
+            dwTTL = pRecord->dwTTL;
+            bHaveTTL = TRUE;
+        }
+    }
+
 error:
     LWNET_SAFE_FREE_MEMORY(pBuffer);
     LWNET_SAFE_FREE_DNS_RECORD_LINKED_LIST(pAnswersList);
     LWNET_SAFE_FREE_DNS_RECORD_LINKED_LIST(pAdditionalsList);
     LWNET_SAFE_FREE_SRV_INFO_LINKED_LIST(pSRVRecordList);
 
+    if (dwError)
+    {
+        LWNET_SAFE_FREE_MEMORY(pServerArray);
+        dwServerCount = 0;
+        dwTTL = 0;
+    }
+
+    *ppServerArray = pServerArray;
+    *pdwServerCount = dwServerCount;
+    *pdwTTL = dwTTL;
+
+    return dwError;
+}
+
+
+
+static
+VOID
+LWNetDnsCacheFreeEntry(
+    IN OUT PLWNET_DNS_CACHE_ENTRY pEntry
+    )
+{
+    LWNET_SAFE_FREE_STRING(pEntry->pszQuestion);
+    LWNET_SAFE_FREE_MEMORY(pEntry->pServerArray);
+    LWNetFreeMemory(pEntry);
+}
+
+// Must hold gLwnetDnsCacheLock
+static
+PLWNET_DNS_CACHE_ENTRY
+LWNetDnsCacheFind(
+    IN PCSTR pszQuestion
+    )
+{
+    PLWNET_DNS_CACHE_ENTRY pEntry = NULL;
+
+    for (pEntry = gpLwnetDnsCache; pEntry; pEntry = pEntry->pNext)
+    {
+        if (!strcasecmp(pEntry->pszQuestion, pszQuestion))
+        {
+            break;
+        }
+    }
+
+    return pEntry;
+}
+
+// Must hold gLwnetDnsCacheLock.  Drops expired entries and, if the
+// cache is still full, the first one not being looked up or waited on.
+static
+VOID
+LWNetDnsCachePrune(
+    IN LWNET_UNIX_TIME_T now
+    )
+{
+    PLWNET_DNS_CACHE_ENTRY* ppLink = &gpLwnetDnsCache;
+    PLWNET_DNS_CACHE_ENTRY pEntry = NULL;
+
+    while ((pEntry = *ppLink) != NULL)
+    {
+        if (!pEntry->bInProgress && !pEntry->dwWaiters && pEntry->Expiration <= now)
+        {
+            *ppLink = pEntry->pNext;
+            LWNetDnsCacheFreeEntry(pEntry);
+            gdwLwnetDnsCacheCount--;
+        }
+        else
+        {
+            ppLink = &pEntry->pNext;
+        }
+    }
+
+    for (ppLink = &gpLwnetDnsCache;
+         gdwLwnetDnsCacheCount >= LWNET_DNS_CACHE_MAXIMUM_ENTRIES &&
+         (pEntry = *ppLink) != NULL;)
+    {
+        if (!pEntry->bInProgress && !pEntry->dwWaiters)
+        {
+            *ppLink = pEntry->pNext;
+            LWNetDnsCacheFreeEntry(pEntry);
+            gdwLwnetDnsCacheCount--;
+        }
+        else
+        {
+            ppLink = &pEntry->pNext;
+        }
+    }
+}
+
+DWORD
+LWNetDnsSrvQueryByQuestion(
+    IN PCSTR pszQuestion,
+    IN OPTIONAL PCSTR pszSiteName,
+    IN DWORD dwDsFlags,
+    OUT PDNS_SERVER_INFO* ppServerArray,
+    OUT PDWORD pdwServerCount
+    )
+// Call LWNET_SAFE_FREE_MEMORY on returned server array
+//
+// Results are shared through a process-wide cache that honors the
+// record TTLs (see lwnet-dns_p.h).  Only one thread at a time queries
+// DNS for a given question; others wait for its answer and get it,
+// errors included, even when it is not cached for later callers.
+// DS_FORCE_REDISCOVERY bypasses cached answers.
+{
+    DWORD dwError = 0;
+    BOOLEAN bInLock = FALSE;
+    LWNET_UNIX_TIME_T now = 0;
+    PLWNET_DNS_CACHE_ENTRY pEntry = NULL;
+    PDNS_SERVER_INFO pServerArray = NULL;
+    DWORD dwServerCount = 0;
+    DWORD dwTTL = 0;
+    DWORD dwQueryError = 0;
+    PDNS_SERVER_INFO pCachedServerArray = NULL;
+    BOOLEAN bWaited = FALSE;
+
+    if (IsNullOrEmptyString(pszQuestion) ||
+        !ppServerArray ||
+        !pdwServerCount)
+    {
+        dwError = ERROR_INVALID_PARAMETER;
+        BAIL_ON_LWNET_ERROR(dwError);
+    }
+
+    pthread_mutex_lock(&gLwnetDnsCacheLock);
+    bInLock = TRUE;
+
+    for (;;)
+    {
+        dwError = LWNetGetSystemTime(&now);
+        BAIL_ON_LWNET_ERROR(dwError);
+
+        pEntry = LWNetDnsCacheFind(pszQuestion);
+        if (!pEntry || !pEntry->bInProgress)
+        {
+            break;
+        }
+
+        // The waiter count keeps the entry from being pruned, so it is
+        // the same entry once the lookup finishes.
+        pEntry->dwWaiters++;
+        pthread_cond_wait(&gLwnetDnsCacheCondition, &gLwnetDnsCacheLock);
+        pEntry->dwWaiters--;
+        bWaited = TRUE;
+    }
+
+    if (pEntry &&
+        (bWaited ||
+         (pEntry->Expiration > now &&
+          !(dwDsFlags & DS_FORCE_REDISCOVERY))))
+    {
+        LWNET_LOG_VERBOSE("Using %s DNS answer for '%s'",
+                          bWaited ? "shared" : "cached", pszQuestion);
+
+        dwError = pEntry->dwError;
+        BAIL_ON_LWNET_ERROR(dwError);
+
+        if (pEntry->dwServerCount)
+        {
+            dwError = LWNetDnsCopyServerArray(
+                          pEntry->pServerArray,
+                          pEntry->dwServerCount,
+                          &pServerArray);
+            BAIL_ON_LWNET_ERROR(dwError);
+
+            dwServerCount = pEntry->dwServerCount;
+        }
+
+        goto error;
+    }
+
+    if (!pEntry)
+    {
+        LWNetDnsCachePrune(now);
+
+        dwError = LWNetAllocateMemory(sizeof(*pEntry), OUT_PPVOID(&pEntry));
+        BAIL_ON_LWNET_ERROR(dwError);
+
+        dwError = LWNetAllocateString(pszQuestion, &pEntry->pszQuestion);
+        if (dwError)
+        {
+            LWNetFreeMemory(pEntry);
+            pEntry = NULL;
+        }
+        BAIL_ON_LWNET_ERROR(dwError);
+
+        pEntry->pNext = gpLwnetDnsCache;
+        gpLwnetDnsCache = pEntry;
+        gdwLwnetDnsCacheCount++;
+    }
+
+    pEntry->bInProgress = TRUE;
+
+    pthread_mutex_unlock(&gLwnetDnsCacheLock);
+    bInLock = FALSE;
+
+    dwQueryError = LWNetDnsSrvQueryByQuestionUncached(
+                       pszQuestion,
+                       &pServerArray,
+                       &dwServerCount,
+                       &dwTTL);
+
+    if (!dwQueryError && dwServerCount)
+    {
+        // Failing to cache the answer is not fatal; it just is not cached.
+        if (LWNetDnsCopyServerArray(
+                pServerArray,
+                dwServerCount,
+                &pCachedServerArray))
+        {
+            dwTTL = 0;
+        }
+    }
+    else if (dwQueryError == DNS_ERROR_BAD_PACKET ||
+             (!dwQueryError && !dwServerCount))
+    {
+        dwTTL = LWNET_DNS_CACHE_NEGATIVE_TTL_SECONDS;
+    }
+    else
+    {
+        dwTTL = 0;
+    }
+
+    dwError = LWNetGetSystemTime(&now);
+    if (dwError)
+    {
+        dwTTL = 0;
+        dwError = 0;
+    }
+
+    pthread_mutex_lock(&gLwnetDnsCacheLock);
+    bInLock = TRUE;
+
+    LWNET_SAFE_FREE_MEMORY(pEntry->pServerArray);
+    pEntry->pServerArray = pCachedServerArray;
+    pEntry->dwServerCount = pCachedServerArray ? dwServerCount : 0;
+    pEntry->dwError = dwQueryError;
+    pEntry->Expiration = now + CT_MIN(dwTTL, LWNET_DNS_CACHE_MAXIMUM_TTL_SECONDS);
+    pEntry->bInProgress = FALSE;
+    pCachedServerArray = NULL;
+
+    pthread_cond_broadcast(&gLwnetDnsCacheCondition);
+
+    dwError = dwQueryError;
+    BAIL_ON_LWNET_ERROR(dwError);
+
+error:
+    if (bInLock)
+    {
+        pthread_mutex_unlock(&gLwnetDnsCacheLock);
+    }
+
+    LWNET_SAFE_FREE_MEMORY(pCachedServerArray);
+
     if (dwError)
     {
         LWNET_SAFE_FREE_MEMORY(pServerArray);
@@ -1653,4 +1999,3 @@ error:
 
     return dwError;
 }
-
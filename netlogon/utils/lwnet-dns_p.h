@@ -140,6 +140,42 @@ typedef struct _DNS_RESPONSE_HEADER
 
 #define MAX_DNS_UDP_BUFFER 512
 
+// SRV query results are cached for the smallest TTL of the
+// answer records, but never longer than the maximum here.
+// Failed lookups and empty answers are cached for the
+// negative TTL so a missing or unreachable zone is not
+// queried again on every discovery.
+#define LWNET_DNS_CACHE_MAXIMUM_TTL_SECONDS 600
+#define LWNET_DNS_CACHE_NEGATIVE_TTL_SECONDS 30
+#define LWNET_DNS_CACHE_MAXIMUM_ENTRIES 128
+
+typedef struct _LWNET_DNS_CACHE_ENTRY
+{
+    struct _LWNET_DNS_CACHE_ENTRY* pNext;
+    PSTR pszQuestion;
+    // Set while one thread performs the lookup; other
+    // threads asking the same question wait for it.
+    BOOLEAN bInProgress;
+    // Threads waiting on the lookup in progress.  They take its
+    // result whatever the TTL, and the entry is not pruned under them.
+    DWORD dwWaiters;
+    DWORD dwError;
+    LWNET_UNIX_TIME_T Expiration;
+    PDNS_SERVER_INFO pServerArray;
+    DWORD dwServerCount;
+} LWNET_DNS_CACHE_ENTRY, *PLWNET_DNS_CACHE_ENTRY;
+
+// Test only: sends SRV queries to the given IPv4 name server and
+// port instead of the ones in resolv.conf, or restores resolv.conf
+// when pszAddress is NULL.  Only honored where res_ninit is available.
+// Defined in lwnet-dns-test.c, which is built into the tests and not
+// into liblwnetutils.
+DWORD
+LWNetDnsSetNameServer(
+    IN OPTIONAL PCSTR pszAddress,
+    IN USHORT usPort
+    );
+
 DWORD
 LWNetDnsGetHostInfoEx(
     OUT OPTIONAL PSTR* ppszHostname,
@@ -284,6 +320,13 @@ LWNetDnsFreeSRVInfoRecord(
     IN OUT PDNS_SRV_INFO_RECORD pRecord
     );
 
+DWORD
+LWNetDnsCopyServerArray(
+    IN PDNS_SERVER_INFO pServerArray,
+    IN DWORD dwServerCount,
+    OUT PDNS_SERVER_INFO* ppServerArray
+    );
+
 VOID
 LWNetDnsFreeDnsRecordLinkedList(
     IN OUT PDLINKEDLIST DnsRecordList